@@ -2,44 +2,28 @@ dnl $Id: tcc.m4,v 1.6 2007/08/20 18:02:12 chfl Exp $
 
 
 dnl
-dnl look for TCC library headers
+dnl look for the TCC Library in some standard prefixes, ac_TCC_path is
+dnl left empty if it is only found in the default search paths
 dnl
 AC_DEFUN([AC_TCC_PATH],
-[ AC_MSG_CHECKING([for TCC Library headers])
+[ AC_MSG_CHECKING([for TCC Library prefix])
+  ac_TCC_path=
   for ac_dir in             \
-    /usr/local/include      \
-    /usr/include            \
-    /usr/local/share        \
+    /usr/local              \
     /opt                    \
+    /opt/tcc                \
     ;                       \
   do
-    if test -r "$ac_dir/libtcc.h"; then
-      ac_TCC_includes="$ac_dir"
-      with_libtcc="$ac_dir"
-      TCC_CPPFLAGS="-I$ac_TCC_includes"
-      AC_MSG_RESULT([yes])
-      break
-    fi
-  done
-
-  AC_MSG_CHECKING([for TCC Library])
-  ac_dir=`echo "$ac_TCC_includes" | sed s/include/lib/`
-  for ac_extension in a so sl dylib; do
-    if test -r $ac_dir/libtcc.$ac_extension; then
-      TCC_LDFLAGS="-L$ac_dir"
-      if test "$HOST_TYPE" = darwin; then
-        TCC_RPATH=
-      else
-        TCC_RPATH="-Wl,-rpath,$ac_dir"
-      fi
-
-dnl !!! -m32 is required for tcc but in conflict with all others
-      TCC_LIBS="-ldl -ltcc"
-dnl      TCC_LIBS=""
-      AC_MSG_RESULT([yes])
+    if test -r "$ac_dir/include/libtcc.h"; then
+      ac_TCC_path="$ac_dir"
       break
     fi
   done
+  if test -n "$ac_TCC_path"; then
+    AC_MSG_RESULT([$ac_TCC_path])
+  else
+    AC_MSG_RESULT([default search paths])
+  fi
 ])
 
 dnl
@@ -58,61 +42,74 @@ AC_DEFUN([CONFIG_LIB_TCC],
   TCC_LDFLAGS=
   TCC_RPATH=
   TCC_LIBS=
+  tcc_prefix=
   if test "$with_libtcc" = yes; then
+    dnl leave the default search paths alone
     AC_TCC_PATH
-  else
-    TCC_CPPFLAGS="-I$with_libtcc/include"
-    TCC_LDFLAGS="-L$with_libtcc/lib"
+    tcc_prefix="$ac_TCC_path"
+  elif test "$with_libtcc" != no; then
+    tcc_prefix="$with_libtcc"
+  fi
+  if test -n "$tcc_prefix"; then
+    TCC_CPPFLAGS="-I$tcc_prefix/include"
+    TCC_LDFLAGS="-L$tcc_prefix/lib"
     if test "$HOST_TYPE" = darwin; then
       TCC_RPATH=
     else
-      TCC_RPATH="-Wl,-rpath,$with_libtcc/lib"
+      TCC_RPATH="-Wl,-rpath,$tcc_prefix/lib"
     fi
+  fi
+  if test "$with_libtcc" != no; then
     TCC_LIBS="-ldl -ltcc"
   fi
 
 dnl !!! -m32 is required for tcc on x86_64 but in conflict with all others
 
   dnl check if TCC Library is functional
-  AC_MSG_CHECKING([for correct functioning of TCC])
-  AC_LANG_PUSH(C)
-  dnl cach values of some global variables
-  tcc_save_CPPFLAGS="$CPPFLAGS"
-  tcc_save_LDFLAGS="$LDFLAGS"
-  tcc_save_LIBS="$LIBS"
-  dnl add TCC specific stuff to global variables
-  CPPFLAGS="$CPPFLAGS $TCC_CPPFLAGS"
-  LDFLAGS="$LDFLAGS $TCC_RPATH $TCC_LDFLAGS"
-  LIBS=" $TCC_LIBS $LIBS"
-  dnl set headers and test program
-  tcc_headers="#include <libtcc.h>"
-  tcc_testprg="TCCState *s;s = tcc_new();"
-  dnl can we link a mini program with libtcc?
-  AC_TRY_LINK([$tcc_headers],
-     [$tcc_testprg],
-     [tcc_functional=yes],
-     [tcc_functional=no])
+  tcc_functional=no
+  if test "$with_libtcc" != no; then
+    AC_MSG_CHECKING([for correct functioning of TCC])
+    AC_LANG_PUSH(C)
+    dnl cach values of some global variables
+    tcc_save_CPPFLAGS="$CPPFLAGS"
+    tcc_save_LDFLAGS="$LDFLAGS"
+    tcc_save_LIBS="$LIBS"
+    dnl add TCC specific stuff to global variables
+    CPPFLAGS="$CPPFLAGS $TCC_CPPFLAGS"
+    LDFLAGS="$LDFLAGS $TCC_RPATH $TCC_LDFLAGS"
+    LIBS=" $TCC_LIBS $LIBS"
+    dnl set headers and test program
+    tcc_headers="#include <libtcc.h>"
+    tcc_testprg="TCCState *s;s = tcc_new();"
+    dnl can we link a mini program with libtcc?
+    AC_TRY_LINK([$tcc_headers],
+       [$tcc_testprg],
+       [tcc_functional=yes],
+       [tcc_functional=no])
 
-  if test "$tcc_functional" = yes; then
-    AC_MSG_RESULT([$tcc_functional])
-  else
-    AC_MSG_RESULT([$tcc_functional:
-                   CPPFLAGS=$CPPFLAGS
-                   LDFLAGS=$LDFLAGS
-                   LIBS=$LIBS])
-    AC_MSG_RESULT([Can not link to TCC Library: online compilation disabled!])
+    if test "$tcc_functional" = yes; then
+      AC_MSG_RESULT([$tcc_functional])
+    else
+      AC_MSG_RESULT([$tcc_functional:
+                     CPPFLAGS=$CPPFLAGS
+                     LDFLAGS=$LDFLAGS
+                     LIBS=$LIBS])
+      AC_MSG_RESULT([Can not link to TCC Library: online compilation disabled!])
+    fi
+    dnl reset global variables to cached values
+    CPPFLAGS=$tcc_save_CPPFLAGS
+    LDFLAGS=$tcc_save_LDFLAGS
+    LIBS=$tcc_save_LIBS
+    AC_LANG_POP(C)
   fi
-  dnl reset global variables to cached values
-  CPPFLAGS=$tcc_save_CPPFLAGS
-  LDFLAGS=$tcc_save_LDFLAGS
-  LIBS=$tcc_save_LIBS
-  AC_LANG_POP(C)
   if test "$tcc_functional" = yes; then
     dnl add the CPPFLAGS and LDFLAGS for tcc online compilation
-    AC_DEFINE_UNQUOTED([TCC_CPPFLAGS], "${with_libtcc}/include",
-              [TCC include directories])
-    AC_DEFINE_UNQUOTED([TCC_LDFLAGS], "${with_libtcc}/lib",
-              [TCC lib directories])
+    if test -n "$tcc_prefix"; then
+      AC_DEFINE_UNQUOTED([TCC_CPPFLAGS], "${tcc_prefix}/include",
+                [TCC include directories])
+      AC_DEFINE_UNQUOTED([TCC_LDFLAGS], "${tcc_prefix}/lib",
+                [TCC lib directories])
+    fi
     AC_DEFINE_UNQUOTED([TCC_LIBS], "tcc",
               [TCC libs])
     AC_DEFINE([USE_TCC], 1, [Define to 1 to use the TCC Library])
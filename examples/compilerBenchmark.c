@@ -0,0 +1,136 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* 
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ * The original code contained here was initially developed by:
+ *
+ *     Rainer Machne
+ *
+ * Contributor(s):
+ */
+
+/* compares compilation and integration times of the system compiler
+   (gcc) and in-memory compilation with libtcc, and of interpreted
+   model functions */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <sbmlsolver/odeSolver.h>
+#include <sbmlsolver/solverError.h>
+
+/* wall clock time in seconds, includes compiler subprocesses */
+static double wallTime(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+static void benchmark(odeModel_t *om, cvodeSettings_t *set,
+		      const char *name, int compile,
+		      compilerBackend_t backend, int runs)
+{
+  int i;
+  double compileTime = 0., integrationTime = 0., start;
+  integratorInstance_t *ii;
+
+  CvodeSettings_setCompileFunctions(set, compile);
+  if ( compile && !ODEModel_setCompileBackend(om, backend) )
+  {
+    printf("%-12s not available\n", name);
+    return;
+  }
+
+  for ( i=0; i<runs; i++ )
+  {
+    if ( compile )
+    {
+      start = wallTime();
+      if ( !ODEModel_compileCVODEFunctions(om) )
+      {
+	printf("%-12s compilation failed\n", name);
+	SolverError_dumpAndClearErrors();
+	return;
+      }
+      compileTime += wallTime() - start;
+    }
+
+    ii = IntegratorInstance_create(om, set);
+    start = wallTime();
+    IntegratorInstance_integrate(ii);
+    integrationTime += wallTime() - start;
+    IntegratorInstance_free(ii);
+    SolverError_dumpAndClearErrors();
+  }
+
+  printf("%-12s compilation %10.4f s   integration %10.4f s\n",
+	 name, compileTime/runs, integrationTime/runs);
+}
+
+int main (int argc, char *argv[])
+{
+  int runs;
+  double endtime;
+  odeModel_t *om;
+  cvodeSettings_t *set;
+
+  if ( argc < 2 )
+  {
+    fprintf(stderr,
+	    "usage: %s sbml-model-file [end-time [runs]]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  endtime = argc > 2 ? atof(argv[2]) : 100.;
+  runs = argc > 3 ? atoi(argv[3]) : 5;
+  if ( runs < 1 )
+    runs = 1;
+
+  om = ODEModel_createFromFile(argv[1]);
+  if ( om == NULL )
+  {
+    SolverError_dumpAndClearErrors();
+    exit(EXIT_FAILURE);
+  }
+  ODEModel_constructJacobian(om);
+
+  set = CvodeSettings_create();
+  CvodeSettings_setTime(set, endtime, 1000);
+  CvodeSettings_setJacobian(set, 1);
+  CvodeSettings_setStoreResults(set, 0);
+
+  printf("%s, %d runs to time %g:\n", argv[1], runs, endtime);
+  benchmark(om, set, "interpreted", 0, COMPILER_SYSTEM, runs);
+  benchmark(om, set, "gcc", 1, COMPILER_SYSTEM, runs);
+  benchmark(om, set, "libtcc", 1, COMPILER_LIBTCC, runs);
+
+  CvodeSettings_free(set);
+  ODEModel_free(om);
+
+  return (EXIT_SUCCESS);
+}
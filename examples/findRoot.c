@@ -71,10 +71,10 @@ main (int argc, char *argv[]){
 
   om = ODEModel_create(m);
   ii = IntegratorInstance_create(om, set);
-  /**!!! the KINSOL implementation in SOSlib is experimental,
-         and can't be used in software but feel free to experiment.
-	 Source code is in src/nullSolver.c !!!**/
+  /** searches a steady state by Newton's method, with conservation
+      laws from the initial values; source code is in src/nullSolver.c **/
   IntegratorInstance_nullSolver(ii);
+  IntegratorInstance_printNullSolverStatistics(ii, stdout);
   
   if ( SolverError_getNum(FATAL_ERROR_TYPE) ) {
     printf("Integration not sucessful!\n");
@@ -340,40 +340,16 @@ void addConstant64 (directCode_t*c, double value)
 /*!!! TODO : init result to 0 and write correct error message !!!*/
 double getAST_Name(ASTNode_t *n, cvodeData_t *data)
 {
-  int i, j;
-  double found = 0, datafound, findtol=1e-5, result;
-  time_series_t *ts = data->model->time_series;
+  int j;
+  double found = 0, result;
   
   if ( ASTNode_isSetIndex(n) )
   {
     if (ASTNode_isSetData(n))
     {
-      /* if continuous data is observed, obtain interpolated result */  
-      if ( (data->model->discrete_observation_data != 1) ||
-	   (data->model->compute_vector_v != 1) )
-      {
-	result = call(ASTNode_getIndex(n),
-		      data->currenttime, ts);
-      }
-      else  /* if discrete data is observed, simply obtain value from time_series */
-      {
-	datafound = 0;
-	i = data->TimeSeriesIndex;
-	if  ( fabs(data->currenttime - ts->time[i]) < findtol )
-	{
-	  result = ts->data[ASTNode_getIndex(n)][i];
-	  datafound++;
-	}
-	if (datafound != 1)
-	{
-	  /*				SolverError_error(FATAL_ERROR_TYPE,
-					SOLVER_ERROR_AST_EVALUATION_FAILED_DISCRETE_DATA,
-					"use of discrete time series data failed; none or several time points matching current time"); */
-	  result = 0; /*  break;  */
-	}
-	else
-	  found = 1;
-      }
+      /* interpolated for continuous data, indexed by the current
+	 data row for discrete data */
+      result = CvodeData_getTimeSeriesValue(data, ASTNode_getIndex(n));
     }
     else
     {
@@ -415,33 +391,9 @@ double getAST_Name(ASTNode_t *n, cvodeData_t *data)
 /* extern function for the case AST_NAME */
 /*!!! TODO : init result to 0 and write correct error message !!!*/
 double getAST_Name_setData(ASTNode_t *n, cvodeData_t *data) {
-	int i, j;
-	double found = 0, datafound, findtol=1e-5, result;
-	time_series_t *ts = data->model->time_series;
-	
-	/* if continuous data is observed, obtain interpolated result */  
-	if ((data->model->discrete_observation_data != 1) || (data->model->compute_vector_v != 1)) {
-		result = call(ASTNode_getIndex(n), data->currenttime, ts);
-		}
-		else  /* if discrete data is observed, simply obtain value from time_series */
-		{
-		datafound = 0;
-		i = data->TimeSeriesIndex;
-		if (fabs(data->currenttime - ts->time[i]) < findtol) {
-			result = ts->data[ASTNode_getIndex(n)][i];
-			datafound++;
-			}
-		if (datafound != 1) {
-/*			SolverError_error(FATAL_ERROR_TYPE,
-			SOLVER_ERROR_AST_EVALUATION_FAILED_DISCRETE_DATA,
-				"use of discrete time series data failed; none or several time points matching current time"); */
-			result = 0; /*  break;  */
-			}
-			else
-			found = 1;
-		}
-
-	return result;
+	/* interpolated for continuous data, indexed by the current
+	   data row for discrete data */
+	return CvodeData_getTimeSeriesValue(data, ASTNode_getIndex(n));
 	}
 
 double getAST_Name_Time(cvodeData_t *data) {
@@ -0,0 +1,580 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+/* fork, kill and shared anonymous mappings are POSIX and BSD
+   extensions, which are hidden in strict ANSI C mode */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#define _DARWIN_C_SOURCE
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup batchProcesses Batch Integration in Worker Processes
+  \ingroup integrator
+  \brief This module contains a batch integration of design points
+  in a pool of worker processes, which isolates the caller from
+  crashes and hanging integrations of single design points.
+
+  The workers are forked from the calling process after the model
+  has been compiled, and share its memory copy-on-write. Each worker
+  integrates the design points it is sent by the calling process,
+  the supervisor, and writes the results to a shared memory arena.
+  Workers that die or exceed the time limit are replaced and their
+  design points are marked as failed. Without fork and mmap, the
+  design points are integrated one by one in the calling process.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/compiler.h"
+#include "sbmlsolver/odeModel.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/integratorInstance.h"
+#include "sbmlsolver/batchProcesses.h"
+
+#if defined(HAVE_FORK) && defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && \
+    defined(HAVE_SYS_WAIT_H) && defined(HAVE_UNISTD_H) && defined(HAVE_POLL_H)
+#define USE_BATCH_PROCESSES 1
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <poll.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+/* without anonymous mappings, the arena is a shared mapping of
+   /dev/zero */
+#if !defined(MAP_ANONYMOUS) && defined(HAVE_FCNTL_H)
+#include <fcntl.h>
+#elif !defined(MAP_ANONYMOUS)
+#undef USE_BATCH_PROCESSES
+#endif
+#endif
+
+/* results of all design points: status and last output step of
+   each point, followed by blocks of times and values, with nout+1
+   output steps for each of the nvalues values */
+typedef struct batchArena
+{
+  int npoints;
+  int nvalues;
+  int nout;
+  size_t size;
+  void *mem;
+  int *status;
+  int *iout;
+  double *block;
+} batchArena_t;
+
+#ifdef USE_BATCH_PROCESSES
+/* a worker process and the pipes to send it design points and to
+   receive the finished ones, pid 0 if not running */
+typedef struct batchWorker
+{
+  pid_t pid;
+  int cmd;
+  int done;
+  int point;
+  time_t start;
+} batchWorker_t;
+
+static int BatchWorker_start(batchWorker_t *, int nworkers, int w,
+			     integratorInstance_t *, int nrparams,
+			     variableIndex_t **vi, double **params,
+			     batchArena_t *);
+static void BatchWorker_stop(batchWorker_t *, int force);
+static int BatchWorker_assign(batchWorker_t *, int point);
+#endif
+
+static int BatchArena_create(batchArena_t *, int npoints, int nvalues,
+			     int nout);
+static void BatchArena_free(batchArena_t *);
+static double *BatchArena_getBlock(batchArena_t *, int point);
+static cvodeResults_t *BatchArena_getResults(batchArena_t *, cvodeData_t *,
+					     int point);
+static void IntegratorInstance_batchPoint(integratorInstance_t *,
+					  int nrparams, variableIndex_t **vi,
+					  double *params, batchArena_t *,
+					  int point);
+
+
+/** Integrates a series of design points in a pool of worker
+    processes.
+
+    For each design point i, a worker resets its copy of the
+    integratorInstance, sets the nrparams variables vi (e.g.
+    parameters or initial values) to the values params[i] and
+    integrates the time course. The workers are forked after the
+    model functions have been compiled, at most nworkers at a time
+    (the number of processors if nworkers < 1). A worker that dies,
+    e.g. by a crash in compiled code, or that doesn't finish a design
+    point within timeout seconds (no limit if timeout <= 0) is
+    replaced by a new worker.
+
+    The time courses of all values are returned in results[i], which
+    the caller has to free with CvodeResults_free, and status[i] is
+    set to the batchStatus of design point i. results[i] is NULL if
+    the worker crashed or timed out, and for failed integrations it
+    contains the output times reached. Sensitivities are not
+    returned. Returns the number of completed design points.
+*/
+
+SBML_ODESOLVER_API int IntegratorInstance_batchProcesses(integratorInstance_t *engine, int nrparams, variableIndex_t **vi, int nrdesignpoints, double **params, int nworkers, double timeout, cvodeResults_t **results, int *status)
+{
+  int i, ncompleted, next;
+  batchArena_t arena;
+#ifdef USE_BATCH_PROCESSES
+  int w, n, r, k, point, nbusy;
+  batchWorker_t *worker;
+  struct pollfd *fds;
+  int *fdsWorker;
+  void (*sigpipe)(int);
+#endif
+
+  if ( !engine->opt->StoreResults || engine->opt->Indefinitely )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Batch integration in worker processes requires "
+		      "stored results of a finite time course.");
+    return 0;
+  }
+
+  if ( !BatchArena_create(&arena, nrdesignpoints, engine->data->nvalues,
+			  engine->opt->PrintStep) )
+    return 0;
+
+  /* compile before forking, such that all workers share the code */
+  if ( engine->opt->compileFunctions &&
+       ODEModel_getCompiledCVODERHSFunction(engine->om) == NULL )
+  {
+    BatchArena_free(&arena);
+    return 0;
+  }
+
+  next = 0;
+#ifdef USE_BATCH_PROCESSES
+  if ( nworkers < 1 )
+    nworkers = Compiler_getNumProcessors();
+  if ( nworkers > nrdesignpoints )
+    nworkers = nrdesignpoints;
+
+  ASSIGN_NEW_MEMORY_BLOCK(worker, nworkers+1, batchWorker_t, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(fds, nworkers+1, struct pollfd, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(fdsWorker, nworkers+1, int, 0);
+
+  /* a write to a dead worker must not kill the supervisor */
+  sigpipe = signal(SIGPIPE, SIG_IGN);
+
+  for ( w=0; w<nworkers && next<nrdesignpoints; w++ )
+    if ( BatchWorker_start(worker, nworkers, w, engine, nrparams, vi, params,
+			   &arena) &&
+	 BatchWorker_assign(&worker[w], next) )
+      next++;
+
+  while ( 1 )
+  {
+    nbusy = 0;
+    for ( w=0; w<nworkers; w++ )
+    {
+      if ( worker[w].pid == 0 || worker[w].point < 0 )
+	continue;
+      fds[nbusy].fd = worker[w].done;
+      fds[nbusy].events = POLLIN;
+      fds[nbusy].revents = 0;
+      fdsWorker[nbusy] = w;
+      nbusy++;
+    }
+    /* all done, or no worker could be started */
+    if ( nbusy == 0 )
+      break;
+
+    r = poll(fds, nbusy, timeout > 0.0 ? 100 : -1);
+    if ( r < 0 && errno != EINTR )
+      break;
+
+    for ( n=0; r>0 && n<nbusy; n++ )
+    {
+      if ( fds[n].revents == 0 )
+	continue;
+      w = fdsWorker[n];
+      point = worker[w].point;
+
+      k = read(worker[w].done, &i, sizeof(int));
+      if ( k == sizeof(int) && i == point )
+	worker[w].point = -1;
+      else
+      {
+	/* the worker died */
+	BatchWorker_stop(&worker[w], 1);
+	if ( arena.status[point] == BATCH_PENDING )
+	  arena.status[point] = BATCH_CRASHED;
+	if ( next < nrdesignpoints )
+	  BatchWorker_start(worker, nworkers, w, engine, nrparams, vi, params,
+			    &arena);
+      }
+    }
+
+    /* kill workers exceeding the time limit */
+    if ( timeout > 0.0 )
+      for ( w=0; w<nworkers; w++ )
+      {
+	point = worker[w].point;
+	if ( worker[w].pid == 0 || point < 0 ||
+	     difftime(time(NULL), worker[w].start) <= timeout )
+	  continue;
+	BatchWorker_stop(&worker[w], 1);
+	if ( arena.status[point] == BATCH_PENDING )
+	  arena.status[point] = BATCH_TIMEOUT;
+	if ( next < nrdesignpoints )
+	  BatchWorker_start(worker, nworkers, w, engine, nrparams, vi, params,
+			    &arena);
+      }
+
+    /* send the next design points to idle workers, stop the others */
+    for ( w=0; w<nworkers; w++ )
+    {
+      if ( worker[w].pid == 0 || worker[w].point >= 0 )
+	continue;
+      if ( next < nrdesignpoints && BatchWorker_assign(&worker[w], next) )
+	next++;
+      else
+	BatchWorker_stop(&worker[w], 0);
+    }
+  }
+
+  for ( w=0; w<nworkers; w++ )
+    BatchWorker_stop(&worker[w], 1);
+  signal(SIGPIPE, sigpipe);
+  free(worker);
+  free(fds);
+  free(fdsWorker);
+#else
+  (void) nworkers;
+  (void) timeout;
+#endif
+
+  /* design points left, if no workers are available */
+  for ( i=next; i<nrdesignpoints; i++ )
+    IntegratorInstance_batchPoint(engine, nrparams, vi, params[i], &arena, i);
+
+  ncompleted = 0;
+  for ( i=0; i<nrdesignpoints; i++ )
+  {
+    if ( status != NULL )
+      status[i] = arena.status[i];
+    if ( arena.status[i] == BATCH_COMPLETED )
+      ncompleted++;
+    results[i] = NULL;
+    if ( arena.status[i] == BATCH_COMPLETED ||
+	 arena.status[i] == BATCH_FAILED )
+      results[i] = BatchArena_getResults(&arena, engine->data, i);
+  }
+
+  BatchArena_free(&arena);
+
+  return ncompleted;
+}
+
+
+/** Returns 1 if IntegratorInstance_batchProcesses integrates the
+    design points in worker processes, which isolate the caller from
+    crashes and hanging integrations, and 0 if they are integrated in
+    the calling process on this platform
+*/
+
+SBML_ODESOLVER_API int BatchProcesses_isIsolated(void)
+{
+#ifdef USE_BATCH_PROCESSES
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+
+/************* internal functions ************/
+
+/* integrates design point `point' with the integratorInstance and
+   writes its results to the arena */
+static void IntegratorInstance_batchPoint(integratorInstance_t *engine,
+					  int nrparams, variableIndex_t **vi,
+					  double *params, batchArena_t *arena,
+					  int point)
+{
+  int j, k, flag, nout = arena->nout;
+  double *block;
+  cvodeResults_t *results;
+
+  IntegratorInstance_reset(engine);
+  for ( j=0; j<nrparams; j++ )
+    IntegratorInstance_setVariableValue(engine, vi[j], params[j]);
+
+  flag = IntegratorInstance_integrate(engine);
+  SolverError_clear();
+
+  results = engine->results;
+  if ( results == NULL )
+  {
+    arena->status[point] = BATCH_FAILED;
+    return;
+  }
+
+  block = BatchArena_getBlock(arena, point);
+  for ( k=0; k<=results->nout; k++ )
+  {
+    block[k] = results->time[k];
+    for ( j=0; j<arena->nvalues; j++ )
+      block[(j+1)*(nout+1)+k] = results->value[j][k];
+  }
+  arena->iout[point] = results->nout;
+  arena->status[point] = flag ? BATCH_COMPLETED : BATCH_FAILED;
+}
+
+
+/* allocates the arena, shared with forked processes if available;
+   returns 1 on success and 0 on failure */
+static int BatchArena_create(batchArena_t *arena, int npoints, int nvalues,
+			     int nout)
+{
+  size_t header;
+#if defined(USE_BATCH_PROCESSES) && !defined(MAP_ANONYMOUS)
+  int fd;
+#endif
+
+  arena->npoints = npoints;
+  arena->nvalues = nvalues;
+  arena->nout = nout;
+
+  /* doubles start at a multiple of their size */
+  header = 2*(npoints+1)*sizeof(int);
+  header = (header + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+  arena->size = header +
+    (size_t) npoints * (nvalues+1) * (nout+1) * sizeof(double);
+
+#ifdef USE_BATCH_PROCESSES
+#ifdef MAP_ANONYMOUS
+  arena->mem = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+#else
+  fd = open("/dev/zero", O_RDWR);
+  arena->mem = fd < 0 ? MAP_FAILED :
+    mmap(NULL, arena->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if ( fd >= 0 )
+    close(fd);
+#endif
+  if ( arena->mem == MAP_FAILED )
+  {
+    SolverError_error(FATAL_ERROR_TYPE,
+		      SOLVER_ERROR_NO_MORE_MEMORY_AVAILABLE,
+		      "Can't map %lu bytes of shared memory for "
+		      "the batch results.", (unsigned long) arena->size);
+    arena->mem = NULL;
+    return 0;
+  }
+  memset(arena->mem, 0, arena->size);
+#else
+  ASSIGN_NEW_MEMORY_BLOCK(arena->mem, arena->size, char, 0);
+#endif
+
+  arena->status = (int *) arena->mem;
+  arena->iout = arena->status + npoints + 1;
+  arena->block = (double *) ((char *) arena->mem + header);
+
+  return 1;
+}
+
+
+/* releases the memory of the arena */
+static void BatchArena_free(batchArena_t *arena)
+{
+  if ( arena->mem == NULL )
+    return;
+#ifdef USE_BATCH_PROCESSES
+  munmap(arena->mem, arena->size);
+#else
+  free(arena->mem);
+#endif
+  arena->mem = NULL;
+}
+
+
+/* returns the times and values of design point `point' */
+static double *BatchArena_getBlock(batchArena_t *arena, int point)
+{
+  return arena->block +
+    (size_t) point * (arena->nvalues+1) * (arena->nout+1);
+}
+
+
+/* returns new cvodeResults with the time courses of design point
+   `point' */
+static cvodeResults_t *BatchArena_getResults(batchArena_t *arena,
+					     cvodeData_t *data, int point)
+{
+  int j, k, nout = arena->nout;
+  double *block;
+  cvodeResults_t *results;
+
+  results = CvodeResults_create(data, nout);
+  if ( results == NULL )
+    return NULL;
+
+  block = BatchArena_getBlock(arena, point);
+  results->nout = arena->iout[point];
+  for ( k=0; k<=results->nout; k++ )
+  {
+    results->time[k] = block[k];
+    for ( j=0; j<arena->nvalues; j++ )
+      results->value[j][k] = block[(j+1)*(nout+1)+k];
+  }
+
+  return results;
+}
+
+
+#ifdef USE_BATCH_PROCESSES
+/* forks worker w, which integrates the design points sent by the
+   supervisor until it receives -1; returns 1 on success and 0 if the
+   worker could not be started */
+static int BatchWorker_start(batchWorker_t *worker, int nworkers, int w,
+			     integratorInstance_t *engine, int nrparams,
+			     variableIndex_t **vi, double **params,
+			     batchArena_t *arena)
+{
+  int v, point, cmd[2], done[2];
+  pid_t pid;
+
+  worker[w].pid = 0;
+  worker[w].point = -1;
+
+  if ( pipe(cmd) != 0 )
+    return 0;
+  if ( pipe(done) != 0 )
+  {
+    close(cmd[0]);
+    close(cmd[1]);
+    return 0;
+  }
+
+  /* buffered output would be written twice */
+  fflush(NULL);
+  pid = fork();
+  if ( pid < 0 )
+  {
+    close(cmd[0]);
+    close(cmd[1]);
+    close(done[0]);
+    close(done[1]);
+    return 0;
+  }
+
+  if ( pid == 0 )
+  {
+    /* worker: only keeps its own pipe ends */
+    for ( v=0; v<nworkers; v++ )
+      if ( v != w && worker[v].pid != 0 )
+      {
+	close(worker[v].cmd);
+	close(worker[v].done);
+      }
+    close(cmd[1]);
+    close(done[0]);
+
+    while ( read(cmd[0], &point, sizeof(int)) == sizeof(int) && point >= 0 )
+    {
+      IntegratorInstance_batchPoint(engine, nrparams, vi, params[point],
+				    arena, point);
+      if ( write(done[1], &point, sizeof(int)) != sizeof(int) )
+	break;
+    }
+    _exit(0);
+  }
+
+  close(cmd[0]);
+  close(done[1]);
+  worker[w].pid = pid;
+  worker[w].cmd = cmd[1];
+  worker[w].done = done[0];
+
+  return 1;
+}
+
+
+/* sends a design point to an idle worker; returns 1 on success, or
+   stops the worker and returns 0 */
+static int BatchWorker_assign(batchWorker_t *worker, int point)
+{
+  if ( worker->pid == 0 )
+    return 0;
+
+  if ( write(worker->cmd, &point, sizeof(int)) != sizeof(int) )
+  {
+    BatchWorker_stop(worker, 1);
+    return 0;
+  }
+  worker->point = point;
+  worker->start = time(NULL);
+
+  return 1;
+}
+
+
+/* stops a worker, either by sending -1 or, if `force' is set, by
+   killing it, and waits for its end */
+static void BatchWorker_stop(batchWorker_t *worker, int force)
+{
+  int stop = -1, status;
+
+  if ( worker->pid == 0 )
+    return;
+
+  if ( force )
+    kill(worker->pid, SIGKILL);
+  else if ( write(worker->cmd, &stop, sizeof(int)) != sizeof(int) )
+    kill(worker->pid, SIGKILL);
+
+  close(worker->cmd);
+  close(worker->done);
+  while ( waitpid(worker->pid, &status, 0) < 0 && errno == EINTR )
+    ;
+  worker->pid = 0;
+  worker->point = -1;
+}
+#endif
+
+/*! @} */
+/* End of file */
@@ -0,0 +1,192 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup batchStream Streaming Batch Integration
+  \ingroup integrator
+  \brief This module contains a batch integration of design points
+  that passes the results of each design point to a callback
+  function as soon as it is finished.
+
+  Unlike Model_odeSolverBatch, no results are kept for the whole
+  batch: the callback receives a view of the time courses of
+  selected observables and their final values and extrema, and the
+  memory is reused for the next design point. With stored results
+  switched off (CvodeSettings_setStoreResults), a batch run needs
+  constant memory independent of the number of design points and
+  output times.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/integratorInstance.h"
+#include "sbmlsolver/sensSolver.h"
+#include "sbmlsolver/batchStream.h"
+
+static void BatchPoint_observe(batchPoint_t *, integratorInstance_t *,
+			       double *final, double *min, double *max,
+			       int first);
+
+
+/** Integrates a series of design points and calls the callback for
+    each of them.
+
+    For each design point i, the integratorInstance is reset, the
+    nrparams variables vi (e.g. parameters or initial values) are set
+    to the values params[i] and the time course is integrated. Then
+    the callback is called with a batchPoint view of the results of
+    the nobs observables and the user data. If an objective function
+    was set via IntegratorInstance_setObjectiveFunction, its value is
+    passed as well. The view is only valid during the call.
+
+    The batch run stops early if the callback returns 0. Returns the
+    number of design points passed to the callback, or -1 on failure.
+*/
+
+SBML_ODESOLVER_API int IntegratorInstance_batchStream(integratorInstance_t *engine, int nrparams, variableIndex_t **vi, int nrdesignpoints, double **params, int nobs, variableIndex_t **observable, batchCallback_t callback, void *userData)
+{
+  int i, j, flag, ncalls;
+  double *final, *min, *max;
+  const double **value;
+  batchPoint_t view;
+  cvodeResults_t *results;
+
+  if ( engine->opt->Indefinitely )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Streaming batch integration requires a finite "
+		      "time course.");
+    return -1;
+  }
+
+  /* at least one element, also without observables */
+  ASSIGN_NEW_MEMORY_BLOCK(final, nobs+1, double, -1);
+  ASSIGN_NEW_MEMORY_BLOCK(min, nobs+1, double, -1);
+  ASSIGN_NEW_MEMORY_BLOCK(max, nobs+1, double, -1);
+  ASSIGN_NEW_MEMORY_BLOCK(value, nobs+1, const double *, -1);
+
+  view.nrparams = nrparams;
+  view.nobs = nobs;
+  view.observable = observable;
+  view.final = final;
+  view.min = min;
+  view.max = max;
+
+  ncalls = 0;
+  for ( i=0; i<nrdesignpoints; i++ )
+  {
+    IntegratorInstance_reset(engine);
+    for ( j=0; j<nrparams; j++ )
+      IntegratorInstance_setVariableValue(engine, vi[j], params[i][j]);
+
+    /* extrema over all output times, starting at the initial values */
+    BatchPoint_observe(&view, engine, final, min, max, 1);
+    flag = 1;
+    while ( !IntegratorInstance_timeCourseCompleted(engine) )
+    {
+      flag = IntegratorInstance_integrateOneStep(engine);
+      if ( !flag )
+	break;
+      BatchPoint_observe(&view, engine, final, min, max, 0);
+    }
+
+    view.point = i;
+    view.params = params[i];
+    view.completed = flag;
+    view.nout = engine->solver->iout - 1;
+    view.time = NULL;
+    view.value = NULL;
+    results = engine->results;
+    if ( engine->opt->StoreResults && results != NULL )
+    {
+      view.nout = results->nout;
+      view.time = results->time;
+      for ( j=0; j<nobs; j++ )
+	value[j] = results->value[observable[j]->index];
+      view.value = value;
+    }
+
+    /* the objective function is a quadrature of the forward run */
+    view.hasObjective = 0;
+    view.objective = 0.0;
+    if ( flag && engine->om->ObjectiveFunction != NULL &&
+	 engine->solver->q != NULL &&
+	 IntegratorInstance_CVODEQuad(engine) )
+    {
+      IntegratorInstance_writeQuad(engine, &view.objective);
+      view.hasObjective = 1;
+    }
+
+    /* a failure is passed to the callback via view.completed,
+       such that the batch run can continue */
+    if ( !flag )
+      SolverError_clear();
+
+    ncalls++;
+    if ( !callback(&view, userData) )
+      break;
+  }
+
+  free(final);
+  free(min);
+  free(max);
+  free(value);
+
+  return ncalls;
+}
+
+
+/************* internal functions ************/
+
+/* updates final values and extrema of the observables with the
+   current values of the integratorInstance, first initializes */
+static void BatchPoint_observe(batchPoint_t *view, integratorInstance_t *engine,
+			       double *final, double *min, double *max,
+			       int first)
+{
+  int j;
+  double x;
+
+  for ( j=0; j<view->nobs; j++ )
+  {
+    x = IntegratorInstance_getVariableValue(engine, view->observable[j]);
+    final[j] = x;
+    if ( first || x < min[j] )
+      min[j] = x;
+    if ( first || x > max[j] )
+      max[j] = x;
+  }
+}
+
+/*! @} */
+/* End of file */
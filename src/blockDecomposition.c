@@ -0,0 +1,927 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup blockDecomposition Block Decomposition
+  \ingroup integrator
+  \brief This module decomposes the ODE system of a model into
+  strongly connected blocks, which are integrated separately in
+  dependency order.
+
+  The ODE variables read by each ODE, directly or through assignment
+  rules, form a dependency graph. Its strongly connected components,
+  found by Tarjan's algorithm, are the blocks of mutually dependent
+  variables, which are ordered block-triangularly: each block only
+  reads variables of blocks before it. A block is integrated over the
+  whole time course by its own CVODES solver, with its own tolerances,
+  method and linear solver, whose Newton matrix only spans the
+  variables of the block. The upstream variables it reads are taken
+  from the dense output of their blocks, the interpolating
+  polynomials of all CVODES steps, which are stored when a block is
+  integrated. Blocks of the same level only read blocks of lower
+  levels and are integrated concurrently. Models with events or
+  algebraic rules are not supported.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cvodes/cvodes.h>
+#include <cvodes/cvodes_dense.h>
+#include <nvector/nvector_serial.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/processAST.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/compiler.h"
+#include "sbmlsolver/threadPool.h"
+#include "sbmlsolver/blockDecomposition.h"
+
+#include "private/error.h"
+
+/* the blocks of a level, integrated by the threads of a pool, each
+   with its own data for the evaluation */
+typedef struct blockLevel
+{
+  blockDecomposition_t *bd;
+  threadPool_t *pool;
+  cvodeData_t **data;
+  int first;
+} blockLevel_t;
+
+/* a block in integration, the user data of its solver */
+typedef struct blockTask
+{
+  blockDecomposition_t *bd;
+  odeBlock_t *blk;
+  cvodeData_t *data;
+} blockTask_t;
+
+static void *realloc_or_die(void *, size_t);
+static void BlockDecomposition_collect(const ASTNode_t *, int *mark, int stamp,
+				       int *list, int *n);
+static int BlockDecomposition_dependencies(odeModel_t *, const int *ode,
+					   int nodes, int *mark, int stamp,
+					   int *list);
+static int BlockDecomposition_analyse(blockDecomposition_t *);
+static void BlockDecomposition_task(void *, int);
+static int OdeBlock_integrate(blockDecomposition_t *, odeBlock_t *,
+			      cvodeData_t *);
+static void OdeBlock_storeStep(odeBlock_t *, void *cvode_mem, double t,
+			       int order, N_Vector dky);
+static double OdeBlock_value(const odeBlock_t *, int i, double t);
+static void OdeBlock_setValues(blockTask_t *, realtype t, N_Vector y);
+static int OdeBlock_f(realtype t, N_Vector y, N_Vector ydot, void *f_data);
+static int OdeBlock_jacobian(int N, realtype t,
+			     N_Vector y, N_Vector fy, DlsMat J, void *jac_data,
+			     N_Vector vtemp1, N_Vector vtemp2, N_Vector vtemp3);
+
+
+/** Creates the block decomposition of the ODE system of the
+    integratorInstance.
+
+    The blocks are integrated from its current values, its initial
+    values before its integration, over its output times. Each block
+    gets the tolerances and the method of the settings of the
+    integratorInstance, BDF for the built-in solvers, and the
+    Jacobian entries within the block, if the integratorInstance uses
+    the Jacobian. Returns NULL on failure.
+*/
+
+SBML_ODESOLVER_API blockDecomposition_t *IntegratorInstance_createBlockDecomposition(integratorInstance_t *engine)
+{
+  int b, i;
+  odeModel_t *om = engine->om;
+  cvodeSettings_t *opt = engine->opt;
+  blockDecomposition_t *bd;
+  odeBlock_t *blk;
+
+  if ( om->nevents > 0 || om->nalg > 0 || om->hasCycle )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Block decomposition is not available for models "
+		      "with events, algebraic rules or algebraic cycles.");
+    return NULL;
+  }
+  if ( opt->Indefinitely )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Block decomposition requires output times, "
+		      "indefinite integration is not supported.");
+    return NULL;
+  }
+
+  ASSIGN_NEW_MEMORY(bd, struct blockDecomposition, NULL);
+  bd->om = om;
+  bd->opt = opt;
+
+  bd->data = CvodeData_create(om);
+  if ( bd->data == NULL )
+  {
+    free(bd);
+    return NULL;
+  }
+  bd->data->opt = opt;
+  for ( i=0; i<bd->data->nvalues; i++ )
+    bd->data->value[i] = engine->data->value[i];
+
+  bd->results = CvodeResults_create(bd->data, opt->PrintStep);
+  if ( bd->results == NULL || !BlockDecomposition_analyse(bd) )
+  {
+    BlockDecomposition_free(bd);
+    return NULL;
+  }
+
+  for ( b=0; b<bd->nblocks; b++ )
+  {
+    blk = &bd->blocks[b];
+    blk->abstol = opt->Error;
+    blk->reltol = opt->RError;
+    blk->method = opt->CvodeMethod == 1;
+    blk->iteration = opt->IterMethod == 1;
+    blk->useJacobian = engine->UseJacobian && om->jacobian;
+  }
+
+  return bd;
+}
+
+
+/** Returns the number of blocks
+*/
+
+SBML_ODESOLVER_API int BlockDecomposition_getNumBlocks(const blockDecomposition_t *bd)
+{
+  return bd->nblocks;
+}
+
+
+/** Returns the number of levels of blocks: blocks of one level are
+    integrated concurrently
+*/
+
+SBML_ODESOLVER_API int BlockDecomposition_getNumLevels(const blockDecomposition_t *bd)
+{
+  return bd->nlevels;
+}
+
+
+/** Returns the block of the ODE variable with the given index, or -1
+    for invalid indices
+*/
+
+SBML_ODESOLVER_API int BlockDecomposition_getBlock(const blockDecomposition_t *bd, int variable)
+{
+  if ( variable < 0 || variable >= bd->om->neq )
+    return -1;
+  return bd->block[variable];
+}
+
+
+/** Returns the number of ODE variables of a block, or 0 for invalid
+    blocks
+*/
+
+SBML_ODESOLVER_API int BlockDecomposition_getBlockSize(const blockDecomposition_t *bd, int block)
+{
+  if ( block < 0 || block >= bd->nblocks )
+    return 0;
+  return bd->blocks[block].size;
+}
+
+
+/** Sets the absolute and relative tolerances of a block, returns 0
+    for invalid blocks
+*/
+
+SBML_ODESOLVER_API int BlockDecomposition_setBlockErrors(blockDecomposition_t *bd, int block, double abstol, double reltol)
+{
+  if ( block < 0 || block >= bd->nblocks )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Block %d does not exist, the decomposition has "
+		      "%d blocks.", block, bd->nblocks);
+    return 0;
+  }
+  bd->blocks[block].abstol = abstol;
+  bd->blocks[block].reltol = reltol;
+  return 1;
+}
+
+
+/** Sets the method, BDF (0) or ADAMS-MOULTON (1), and the nonlinear
+    solver iteration, Newton (0) with a dense linear solver or
+    functional iteration (1) without, of a block; returns 0 for
+    invalid blocks
+*/
+
+SBML_ODESOLVER_API int BlockDecomposition_setBlockMethod(blockDecomposition_t *bd, int block, int method, int iteration)
+{
+  if ( block < 0 || block >= bd->nblocks )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Block %d does not exist, the decomposition has "
+		      "%d blocks.", block, bd->nblocks);
+    return 0;
+  }
+  bd->blocks[block].method = method == 1;
+  bd->blocks[block].iteration = iteration == 1;
+  return 1;
+}
+
+
+/** Sets whether the Newton matrix of a block is computed from the
+    Jacobian entries of the block (1) or by CVODES' difference
+    quotients (0); returns 0 for invalid blocks and if the Jacobian of
+    the model is not available
+*/
+
+SBML_ODESOLVER_API int BlockDecomposition_setBlockJacobian(blockDecomposition_t *bd, int block, int useJacobian)
+{
+  if ( block < 0 || block >= bd->nblocks )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Block %d does not exist, the decomposition has "
+		      "%d blocks.", block, bd->nblocks);
+    return 0;
+  }
+  if ( useJacobian && !bd->om->jacobian )
+  {
+    SolverError_error(WARNING_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "The Jacobian matrix is not available, block %d "
+		      "uses difference quotients.", block);
+    bd->blocks[block].useJacobian = 0;
+    return 0;
+  }
+  bd->blocks[block].useJacobian = useJacobian != 0;
+  return 1;
+}
+
+
+/** Integrates all blocks over the output times, level by level with
+    up to nthreads threads, one per processor for nthreads < 1, and
+    stores the values at the output times in the results.
+
+    Returns 1 on success and 0 if the integration of a block failed.
+*/
+
+SBML_ODESOLVER_API int BlockDecomposition_integrate(blockDecomposition_t *bd, int nthreads)
+{
+  int b, i, k, l, w, nworkers, completed;
+  odeModel_t *om = bd->om;
+  cvodeSettings_t *opt = bd->opt;
+  cvodeData_t *data;
+  blockLevel_t level;
+
+  nworkers = nthreads < 1 ? Compiler_getNumProcessors() : nthreads;
+  if ( nworkers > bd->nblocks )
+    nworkers = bd->nblocks;
+  if ( nworkers < 1 )
+    nworkers = 1;
+  level.bd = bd;
+  level.pool = ThreadPool_create(nworkers);
+  if ( level.pool == NULL )
+    return 0;
+  nworkers = ThreadPool_getNumThreads(level.pool);
+
+  /* one data structure per thread for the evaluation */
+  ASSIGN_NEW_MEMORY_BLOCK(level.data, nworkers, cvodeData_t *, 0);
+  for ( w=0; w<nworkers; w++ )
+  {
+    level.data[w] = data = CvodeData_create(om);
+    if ( data == NULL )
+      break;
+    data->opt = opt;
+    for ( i=0; i<data->nvalues; i++ )
+      data->value[i] = bd->data->value[i];
+  }
+
+  for ( b=0; b<bd->nblocks; b++ )
+    bd->blocks[b].completed = 0;
+
+  completed = w == nworkers;
+  for ( l=0; completed && l<bd->nlevels; l++ )
+  {
+    level.first = bd->levelStart[l];
+    ThreadPool_run(level.pool, bd->levelStart[l+1] - bd->levelStart[l],
+		   BlockDecomposition_task, &level);
+
+    for ( b=bd->levelStart[l]; b<bd->levelStart[l+1]; b++ )
+      if ( !bd->blocks[b].completed )
+      {
+	SolverError_error(ERROR_ERROR_TYPE,
+			  SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+			  "Integration of block %d of %d variables "
+			  "failed.", b, bd->blocks[b].size);
+	completed = 0;
+      }
+  }
+
+  /* all values at the output times */
+  if ( completed )
+  {
+    data = level.data[0];
+    for ( k=0; k<=opt->PrintStep; k++ )
+    {
+      data->currenttime = opt->TimePoints[k];
+      for ( i=0; i<om->neq; i++ )
+	data->value[i] = OdeBlock_value(&bd->blocks[bd->block[i]],
+					bd->local[i], opt->TimePoints[k]);
+      for ( i=0; i<om->nass; i++ )
+      {
+	nonzeroElem_t *ordered = om->assignmentOrder[i];
+	data->value[ordered->i] = evaluateAST(ordered->ij, data);
+      }
+      bd->results->time[k] = opt->TimePoints[k];
+      for ( i=0; i<data->nvalues; i++ )
+	bd->results->value[i][k] = data->value[i];
+    }
+    bd->results->nout = opt->PrintStep;
+  }
+
+  for ( w=0; w<nworkers; w++ )
+    if ( level.data[w] != NULL )
+      CvodeData_free(level.data[w]);
+  free(level.data);
+  ThreadPool_free(level.pool);
+
+  return completed;
+}
+
+
+/** Returns the value of an ODE variable at time t from the dense
+    output of its block, after a successful integration
+*/
+
+SBML_ODESOLVER_API double BlockDecomposition_getValue(const blockDecomposition_t *bd, int variable, double t)
+{
+  return OdeBlock_value(&bd->blocks[bd->block[variable]],
+			bd->local[variable], t);
+}
+
+
+/** Returns the values of all variables and parameters at the output
+    times of the last successful integration
+*/
+
+SBML_ODESOLVER_API const cvodeResults_t *BlockDecomposition_getResults(const blockDecomposition_t *bd)
+{
+  return bd->results;
+}
+
+
+/** Frees the block decomposition
+*/
+
+SBML_ODESOLVER_API void BlockDecomposition_free(blockDecomposition_t *bd)
+{
+  int b;
+  odeBlock_t *blk;
+
+  if ( bd == NULL )
+    return;
+
+  if ( bd->blocks != NULL )
+    for ( b=0; b<bd->nblocks; b++ )
+    {
+      blk = &bd->blocks[b];
+      free(blk->variable);
+      free(blk->input);
+      free(blk->rule);
+      free(blk->jacobian);
+      free(blk->time);
+      free(blk->order);
+      free(blk->offset);
+      free(blk->dense);
+    }
+  free(bd->blocks);
+  free(bd->levelStart);
+  free(bd->block);
+  free(bd->local);
+  if ( bd->results != NULL )
+    CvodeResults_free(bd->results);
+  if ( bd->data != NULL )
+    CvodeData_free(bd->data);
+  free(bd);
+}
+
+
+/************* internal functions ************/
+
+static void *realloc_or_die(void *ptr, size_t size)
+{
+  void *p = realloc(ptr, size);
+  if (!p) report_error_and_die("failed to realloc");
+  return p;
+}
+
+
+/* appends the indices in node, which are not yet marked with stamp,
+   to list and marks them */
+static void BlockDecomposition_collect(const ASTNode_t *node, int *mark,
+				       int stamp, int *list, int *n)
+{
+  unsigned int i;
+  int idx;
+
+  if ( ASTNode_isSetIndex(node) )
+  {
+    idx = ASTNode_getIndex(node);
+    if ( mark[idx] != stamp )
+    {
+      mark[idx] = stamp;
+      list[(*n)++] = idx;
+    }
+  }
+  for ( i=0; i<ASTNode_getNumChildren(node); i++ )
+    BlockDecomposition_collect(ASTNode_getChild(node, i), mark, stamp,
+			       list, n);
+}
+
+
+/* writes the indices of all values read by the nodes ODEs in ode,
+   directly or through assignment rules, to list and returns their
+   number */
+static int BlockDecomposition_dependencies(odeModel_t *om, const int *ode,
+					   int nodes, int *mark, int stamp,
+					   int *list)
+{
+  int i, k, n = 0;
+
+  for ( i=0; i<nodes; i++ )
+    BlockDecomposition_collect(om->ode[ode[i]], mark, stamp, list, &n);
+
+  /* the list grows by the values read by the rules */
+  for ( k=0; k<n; k++ )
+    if ( list[k] >= om->neq && list[k] < om->neq + om->nass )
+      BlockDecomposition_collect(om->assignment[list[k] - om->neq],
+				 mark, stamp, list, &n);
+
+  return n;
+}
+
+
+/* finds the strongly connected components of the dependency graph
+   of the ODE variables with Tarjan's algorithm, without recursion,
+   and orders them into blocks by level */
+static int BlockDecomposition_analyse(blockDecomposition_t *bd)
+{
+  int b, c, i, j, k, l, n, v, w, neq, nvalues, nadj, sp, csp, count, ncomp;
+  int *mark, *list, *adjStart, *adj;
+  int *index, *low, *onstack, *stack, *callstack, *edge, *comp, *level, *pos;
+  int *member;
+  odeModel_t *om = bd->om;
+  odeBlock_t *blk;
+
+  neq = om->neq;
+  nvalues = om->neq + om->nass + om->nconst;
+  ASSIGN_NEW_MEMORY_BLOCK(mark, nvalues+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(list, nvalues+1, int, 0);
+
+  /* the edges from each ODE variable to the ODE variables its ODE
+     reads */
+  ASSIGN_NEW_MEMORY_BLOCK(adjStart, neq+1, int, 0);
+  adj = NULL;
+  nadj = 0;
+  for ( i=0; i<neq; i++ )
+  {
+    n = BlockDecomposition_dependencies(om, &i, 1, mark, i+1, list);
+    adj = realloc_or_die(adj, (nadj + n + 1) * sizeof(int));
+    for ( k=0; k<n; k++ )
+      if ( list[k] < neq && list[k] != i )
+	adj[nadj++] = list[k];
+    adjStart[i+1] = nadj;
+  }
+
+  /* Tarjan's algorithm: a component is completed after all
+     components it reads, i.e. upstream first */
+  ASSIGN_NEW_MEMORY_BLOCK(index, neq+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(low, neq+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(onstack, neq+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(stack, neq+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(callstack, neq+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(edge, neq+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(comp, neq+1, int, 0);
+  count = ncomp = sp = 0;
+  for ( i=0; i<neq; i++ )
+  {
+    if ( index[i] )
+      continue;
+    index[i] = low[i] = ++count;
+    stack[sp++] = i;
+    onstack[i] = 1;
+    callstack[0] = i;
+    edge[0] = adjStart[i];
+    csp = 1;
+    while ( csp > 0 )
+    {
+      v = callstack[csp-1];
+      if ( edge[csp-1] < adjStart[v+1] )
+      {
+	w = adj[edge[csp-1]++];
+	if ( !index[w] )
+	{
+	  index[w] = low[w] = ++count;
+	  stack[sp++] = w;
+	  onstack[w] = 1;
+	  callstack[csp] = w;
+	  edge[csp] = adjStart[w];
+	  csp++;
+	}
+	else if ( onstack[w] && index[w] < low[v] )
+	  low[v] = index[w];
+      }
+      else
+      {
+	csp--;
+	if ( csp > 0 && low[v] < low[callstack[csp-1]] )
+	  low[callstack[csp-1]] = low[v];
+	if ( low[v] == index[v] )
+	{
+	  do
+	  {
+	    w = stack[--sp];
+	    onstack[w] = 0;
+	    comp[w] = ncomp;
+	  } while ( w != v );
+	  ncomp++;
+	}
+      }
+    }
+  }
+  free(index);
+  free(low);
+  free(onstack);
+  free(stack);
+  free(callstack);
+  free(edge);
+
+  /* levels of the components, in the order of their completion:
+     the variables are sorted by component into member */
+  ASSIGN_NEW_MEMORY_BLOCK(level, ncomp+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(pos, ncomp+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(member, neq+1, int, 0);
+  for ( v=0; v<neq; v++ )
+    if ( comp[v] + 1 < ncomp )
+      pos[comp[v]+1]++;
+  for ( c=1; c<ncomp; c++ )
+    pos[c] += pos[c-1];
+  for ( v=0; v<neq; v++ )
+    member[pos[comp[v]]++] = v;
+  bd->nlevels = ncomp > 0;
+  for ( c=0, n=0; c<ncomp; c++ )
+    for ( ; n<pos[c]; n++ )
+      for ( k=adjStart[member[n]]; k<adjStart[member[n]+1]; k++ )
+      {
+	w = adj[k];
+	if ( comp[w] != c && level[comp[w]] + 1 > level[c] )
+	  level[c] = level[comp[w]] + 1;
+	if ( level[c] + 1 > bd->nlevels )
+	  bd->nlevels = level[c] + 1;
+      }
+  free(adjStart);
+  free(adj);
+
+  /* the blocks, sorted by level and by completion within levels */
+  bd->nblocks = ncomp;
+  ASSIGN_NEW_MEMORY_BLOCK(bd->levelStart, bd->nlevels+1, int, 0);
+  for ( c=0; c<ncomp; c++ )
+    bd->levelStart[level[c]+1]++;
+  for ( l=0; l<bd->nlevels; l++ )
+    bd->levelStart[l+1] += bd->levelStart[l];
+  for ( l=0; l<bd->nlevels; l++ )
+    member[l] = bd->levelStart[l];
+  for ( c=0; c<ncomp; c++ )
+    pos[c] = member[level[c]]++;
+  free(member);
+
+  ASSIGN_NEW_MEMORY_BLOCK(bd->blocks, ncomp+1, odeBlock_t, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(bd->block, neq+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(bd->local, neq+1, int, 0);
+  for ( v=0; v<neq; v++ )
+  {
+    b = bd->block[v] = pos[comp[v]];
+    bd->blocks[b].level = level[comp[v]];
+    bd->local[v] = bd->blocks[b].size++;
+  }
+  free(pos);
+  free(level);
+  free(comp);
+
+  for ( b=0; b<ncomp; b++ )
+  {
+    blk = &bd->blocks[b];
+    ASSIGN_NEW_MEMORY_BLOCK(blk->variable, blk->size, int, 0);
+  }
+  for ( v=0; v<neq; v++ )
+    bd->blocks[bd->block[v]].variable[bd->local[v]] = v;
+
+  /* the upstream variables and the rules read by each block, the
+     stamps continue those of the ODE variables */
+  for ( b=0; b<ncomp; b++ )
+  {
+    blk = &bd->blocks[b];
+    n = BlockDecomposition_dependencies(om, blk->variable, blk->size,
+					mark, neq+1+b, list);
+    for ( k=0; k<n; k++ )
+      if ( list[k] < neq && bd->block[list[k]] != b )
+	blk->ninputs++;
+      else if ( list[k] >= neq && list[k] < neq + om->nass )
+	blk->nrules++;
+    ASSIGN_NEW_MEMORY_BLOCK(blk->input, blk->ninputs+1, int, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(blk->rule, blk->nrules+1, nonzeroElem_t *, 0);
+    for ( k=0, j=0; k<n; k++ )
+      if ( list[k] < neq && bd->block[list[k]] != b )
+	blk->input[j++] = list[k];
+    for ( k=0, j=0; k<om->nass; k++ )
+      if ( mark[om->assignmentOrder[k]->i] == neq+1+b )
+	blk->rule[j++] = om->assignmentOrder[k];
+  }
+  free(mark);
+  free(list);
+
+  /* the Jacobian entries within the blocks */
+  if ( om->jacobian )
+  {
+    for ( k=0; k<om->sparsesize; k++ )
+    {
+      nonzeroElem_t *nonzero = om->jacobSparse[k];
+      if ( bd->block[nonzero->i] == bd->block[nonzero->j] )
+	bd->blocks[bd->block[nonzero->i]].njacobian++;
+    }
+    for ( b=0; b<ncomp; b++ )
+    {
+      blk = &bd->blocks[b];
+      ASSIGN_NEW_MEMORY_BLOCK(blk->jacobian, blk->njacobian+1,
+			      nonzeroElem_t *, 0);
+      blk->njacobian = 0;
+    }
+    for ( k=0; k<om->sparsesize; k++ )
+    {
+      nonzeroElem_t *nonzero = om->jacobSparse[k];
+      blk = &bd->blocks[bd->block[nonzero->i]];
+      if ( bd->block[nonzero->i] == bd->block[nonzero->j] )
+	blk->jacobian[blk->njacobian++] = nonzero;
+    }
+  }
+
+  return 1;
+}
+
+
+/* integrates block task of the current level with the data of the
+   calling thread */
+static void BlockDecomposition_task(void *arg, int task)
+{
+  blockLevel_t *level = arg;
+  odeBlock_t *blk = &level->bd->blocks[level->first + task];
+
+  blk->completed = OdeBlock_integrate(level->bd, blk,
+				      level->data[ThreadPool_getThread(level->pool)]);
+}
+
+
+/* integrates a block over the output times with its own CVODES
+   solver and stores its dense output; errors are not reported, as
+   the integration may run in a thread */
+static int OdeBlock_integrate(blockDecomposition_t *bd, odeBlock_t *blk,
+			      cvodeData_t *data)
+{
+  int i, q, flag;
+  double t, t0, tout;
+  void *cvode_mem;
+  N_Vector y, dky;
+  blockTask_t task;
+
+  t0 = bd->opt->TimePoints[0];
+  tout = bd->opt->TimePoints[bd->opt->PrintStep];
+  task.bd = bd;
+  task.blk = blk;
+  task.data = data;
+
+  y = N_VNew_Serial(blk->size);
+  dky = N_VNew_Serial(blk->size);
+  if ( y == NULL || dky == NULL )
+  {
+    if ( y != NULL )
+      N_VDestroy_Serial(y);
+    return 0;
+  }
+
+  /* the initial values are the first step */
+  for ( i=0; i<blk->size; i++ )
+    NV_Ith_S(y, i) = bd->data->value[blk->variable[i]];
+  blk->nsteps = blk->ndense = 0;
+  OdeBlock_storeStep(blk, NULL, t0, 0, y);
+
+  cvode_mem = CVodeCreate(blk->method ? CV_ADAMS : CV_BDF,
+			  blk->iteration ? CV_FUNCTIONAL : CV_NEWTON);
+  flag = cvode_mem == NULL ? CV_MEM_NULL : CV_SUCCESS;
+  if ( flag == CV_SUCCESS )
+    flag = CVodeInit(cvode_mem, OdeBlock_f, t0, y);
+  if ( flag == CV_SUCCESS )
+    flag = CVodeSStolerances(cvode_mem, blk->reltol, blk->abstol);
+  if ( flag == CV_SUCCESS )
+    flag = CVodeSetUserData(cvode_mem, &task);
+  if ( flag == CV_SUCCESS )
+    flag = CVodeSetMaxNumSteps(cvode_mem, bd->opt->Mxstep);
+  /* the dense output of the upstream blocks ends at tout */
+  if ( flag == CV_SUCCESS )
+    flag = CVodeSetStopTime(cvode_mem, tout);
+  if ( flag == CV_SUCCESS && !blk->iteration )
+  {
+    flag = CVDense(cvode_mem, blk->size);
+    if ( flag == CVDLS_SUCCESS )
+      flag = CVDlsSetDenseJacFn(cvode_mem, blk->useJacobian ?
+				OdeBlock_jacobian : NULL);
+  }
+
+  t = t0;
+  while ( flag >= CV_SUCCESS && t < tout )
+  {
+    flag = CVode(cvode_mem, tout, y, &t, CV_ONE_STEP);
+    if ( flag >= CV_SUCCESS )
+      flag = CVodeGetLastOrder(cvode_mem, &q);
+    if ( flag >= CV_SUCCESS )
+      OdeBlock_storeStep(blk, cvode_mem, t, q, dky);
+  }
+
+  if ( cvode_mem != NULL )
+    CVodeFree(&cvode_mem);
+  N_VDestroy_Serial(y);
+  N_VDestroy_Serial(dky);
+
+  return flag >= CV_SUCCESS;
+}
+
+
+/* stores the interpolating polynomial of the last step of CVODES,
+   ending at t, as Taylor coefficients at t; without cvode_mem, the
+   constant values of dky are stored */
+static void OdeBlock_storeStep(odeBlock_t *blk, void *cvode_mem, double t,
+			       int order, N_Vector dky)
+{
+  int i, k, n = blk->nsteps;
+  double factorial = 1.0, *c;
+
+  if ( n == blk->allocated )
+  {
+    blk->allocated = blk->allocated ? 2 * blk->allocated : 64;
+    blk->time = realloc_or_die(blk->time,
+			       blk->allocated * sizeof(double));
+    blk->order = realloc_or_die(blk->order, blk->allocated * sizeof(int));
+    blk->offset = realloc_or_die(blk->offset,
+				 blk->allocated * sizeof(int));
+  }
+  if ( blk->ndense + (order+1) * blk->size > blk->ndenseAllocated )
+  {
+    blk->ndenseAllocated = 2 * (blk->ndense + (order+1) * blk->size);
+    blk->dense = realloc_or_die(blk->dense,
+				blk->ndenseAllocated * sizeof(double));
+  }
+
+  blk->time[n] = t;
+  blk->order[n] = order;
+  blk->offset[n] = blk->ndense;
+  for ( k=0; k<=order; k++ )
+  {
+    if ( cvode_mem != NULL )
+      CVodeGetDky(cvode_mem, t, k, dky);
+    if ( k > 0 )
+      factorial *= k;
+    c = blk->dense + blk->ndense + k * blk->size;
+    for ( i=0; i<blk->size; i++ )
+      c[i] = NV_Ith_S(dky, i) / factorial;
+  }
+  blk->ndense += (order+1) * blk->size;
+  blk->nsteps++;
+}
+
+
+/* returns the value of variable i of a block at time t from the step
+   covering t, the first or last step before or after its dense
+   output */
+static double OdeBlock_value(const odeBlock_t *blk, int i, double t)
+{
+  int k, mid, lo = 0, hi = blk->nsteps - 1;
+  double dt, value, *c;
+
+  /* the first step ending at or after t */
+  while ( lo < hi )
+  {
+    mid = (lo + hi) / 2;
+    if ( blk->time[mid] < t )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  c = blk->dense + blk->offset[lo] + i;
+  dt = t - blk->time[lo];
+  value = 0.0;
+  for ( k=blk->order[lo]; k>=0; k-- )
+    value = value * dt + c[k * blk->size];
+
+  return value;
+}
+
+
+/* writes the variables of the block, the upstream variables at time t
+   and the rules read by the block to the values of the task */
+static void OdeBlock_setValues(blockTask_t *task, realtype t, N_Vector y)
+{
+  int i, j;
+  blockDecomposition_t *bd = task->bd;
+  odeBlock_t *blk = task->blk;
+  cvodeData_t *data = task->data;
+  realtype *ydata = NV_DATA_S(y);
+
+  data->currenttime = t;
+
+  for ( i=0; i<blk->size; i++ )
+    data->value[blk->variable[i]] = ydata[i];
+
+  for ( i=0; i<blk->ninputs; i++ )
+  {
+    j = blk->input[i];
+    data->value[j] = OdeBlock_value(&bd->blocks[bd->block[j]],
+				    bd->local[j], t);
+  }
+
+  for ( i=0; i<blk->nrules; i++ )
+    data->value[blk->rule[i]->i] = evaluateAST(blk->rule[i]->ij, data);
+}
+
+
+/* the ODEs of a block */
+static int OdeBlock_f(realtype t, N_Vector y, N_Vector ydot, void *f_data)
+{
+  int i;
+  blockTask_t *task = f_data;
+  realtype *dydata = NV_DATA_S(ydot);
+
+  OdeBlock_setValues(task, t, y);
+
+  for ( i=0; i<task->blk->size; i++ )
+    dydata[i] = evaluateAST(task->bd->om->ode[task->blk->variable[i]],
+			    task->data);
+
+  return (0);
+}
+
+
+/* the Jacobian entries within a block */
+static int OdeBlock_jacobian(int N, realtype t,
+			     N_Vector y, N_Vector fy, DlsMat J, void *jac_data,
+			     N_Vector vtemp1, N_Vector vtemp2, N_Vector vtemp3)
+{
+  int k;
+  blockTask_t *task = jac_data;
+  blockDecomposition_t *bd = task->bd;
+  odeBlock_t *blk = task->blk;
+
+  OdeBlock_setValues(task, t, y);
+
+  for ( k=0; k<blk->njacobian; k++ )
+  {
+    nonzeroElem_t *nonzero = blk->jacobian[k];
+    DENSE_ELEM(J, bd->local[nonzero->i], bd->local[nonzero->j]) =
+      evaluateAST(nonzero->ij, task->data);
+  }
+
+  return (0);
+}
+
+/*! @} */
+/* End of file */
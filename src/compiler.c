@@ -56,9 +56,20 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 
 #endif /* end _WIN32 */
 
+#if USE_TCC == 1 && defined(HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
 
 #ifdef _WIN32
 
@@ -292,21 +303,103 @@ compiled_code_t *Compiler_compile_with_xlc(const char *sourceCode)
 
 #else /* default case is compile with gcc */
 
+/* runs the n shell commands, at most one per processor at a time;
+   returns the number of commands that failed, or -1 if the
+   compiler subprocesses could not be started */
+static int Compiler_runCommands(int n, char **commands)
+{
+  int i, failed = 0;
+#if defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H) && defined(HAVE_UNISTD_H)
+  int next = 0, first = 0, nproc, status;
+  pid_t *pid;
+
+  if ( n == 1 )
+    return system(commands[0]) == 0 ? 0 : 1;
+
+  nproc = Compiler_getNumProcessors();
+  ASSIGN_NEW_MEMORY_BLOCK(pid, n, pid_t, -1);
+
+  while ( first < n )
+  {
+    /* start commands while processors are free */
+    while ( next < n && next - first < nproc )
+    {
+      pid[next] = fork();
+      if ( pid[next] == 0 )
+      {
+	execl("/bin/sh", "sh", "-c", commands[next], (char *) NULL);
+	_exit(127);
+      }
+      if ( pid[next] < 0 )
+      {
+	/* wait for the running ones, then give up */
+	for ( i=first; i<next; i++ )
+	  waitpid(pid[i], &status, 0);
+	free(pid);
+	return -1;
+      }
+      next++;
+    }
+
+    /* collect the oldest */
+    if ( waitpid(pid[first], &status, 0) < 0 ||
+	 !WIFEXITED(status) || WEXITSTATUS(status) != 0 )
+      failed++;
+    first++;
+  }
+  free(pid);
+#else
+  for ( i=0; i<n; i++ )
+  {
+    int result = system(commands[i]);
+    if ( result == -1 )
+      return -1;
+    if ( result != 0 )
+      failed++;
+  }
+#endif
+  return failed;
+}
+
+/* returns a newly allocated string `base'`i'`ext' */
+static char *Compiler_fileName(const char *base, int i, const char *ext)
+{
+  char *name;
+
+  ASSIGN_NEW_MEMORY_BLOCK(name, strlen(base)+strlen(ext)+24, char, NULL);
+  if ( i < 0 )
+    sprintf(name, "%s%s", base, ext);
+  else
+    sprintf(name, "%s_%d%s", base, i, ext);
+  return name;
+}
+
 /**
-   Returns a pointer to code that is compiled from the given source code
+   Returns a pointer to code that is compiled from the given source
+   codes: each source is compiled to an object file with the given
+   optimization level, in parallel, and the objects are linked into
+   one shared library.  A single source is compiled and linked in
+   one step.
 */
-compiled_code_t *Compiler_compile_with_gcc(const char *sourceCode)
+static compiled_code_t *Compiler_compileSources_with_gcc(int n, const char **sources, const int *levels)
 {
   compiled_code_t *code = NULL;
   char gccFileName[MAX_PATH+1] = "g++";
-  int result;
+  int i, result, level, linking = 0;
+  size_t len;
   char *tmpFileName = NULL;
-  char *cFileName   = NULL;
+  char **cFileName = NULL;
+  char **oFileName = NULL;
   char *dllFileName = NULL;
-  char *oFileName   = NULL;
+  char **command = NULL;
+  char *link;
   FILE *cFile;
-  char command[4*MAX_PATH];
   void *dllHandle;
+#if defined (__APPLE__) && defined (__MACH__)
+  const char *shared = "-dynamiclib";
+#else
+  const char *shared = "-shared";
+#endif
   
   /* generate a unique temprorary filename template */
   ASSIGN_NEW_MEMORY_BLOCK(tmpFileName, (MAX_PATH+1), char, NULL);
@@ -317,75 +410,113 @@ compiled_code_t *Compiler_compile_with_gcc(const char *sourceCode)
 #endif
   
   /* generate needed file names from the template*/
-  ASSIGN_NEW_MEMORY_BLOCK(cFileName, (strlen(tmpFileName)+3), char, NULL);
-  strcpy(cFileName, tmpFileName);
-  strcat(cFileName, ".c");
-  ASSIGN_NEW_MEMORY_BLOCK(oFileName, (strlen(tmpFileName)+3), char, NULL);
-  strcpy(oFileName, tmpFileName);
-  strcat(oFileName, ".o");  
-  ASSIGN_NEW_MEMORY_BLOCK(dllFileName,
-			  (strlen(tmpFileName)+strlen(SHAREDLIBEXT)+1),
-			  char, NULL);
-  strcpy(dllFileName, tmpFileName);
-  strcat(dllFileName, SHAREDLIBEXT);
-
-  /* open file and dump source code to it */
-  cFile = fopen(cFileName, "w");
-  
-  if (!cFile)
+  ASSIGN_NEW_MEMORY_BLOCK(cFileName, n, char *, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(oFileName, n, char *, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(command, n, char *, NULL);
+  for ( i=0; i<n; i++ )
   {
-    SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_OPEN_FILE,
-		      "Could not open file %s - %s!",
-		      cFileName, strerror(errno));  
-    free(cFileName);
-    free(oFileName);
-    free(dllFileName);
-    return NULL;
+    cFileName[i] = Compiler_fileName(tmpFileName, n == 1 ? -1 : i, ".c");
+    oFileName[i] = Compiler_fileName(tmpFileName, n == 1 ? -1 : i, ".o");
   }
+  dllFileName = Compiler_fileName(tmpFileName, -1, SHAREDLIBEXT);
 
-  fprintf(cFile, "%s", sourceCode);
-  fclose(cFile);
+  /* open files and dump source code to them */
+  for ( i=0; i<n; i++ )
+  {
+    cFile = fopen(cFileName[i], "w");
+    if ( !cFile )
+    {
+      SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_OPEN_FILE,
+			"Could not open file %s - %s!",
+			cFileName[i], strerror(errno));
+      n = i; /* clean up files written so far */
+      result = 1;
+      goto cleanup;
+    }
+    fprintf(cFile, "%s", sources[i]);
+    fclose(cFile);
+  }
 
-  /* construct command for compiling */
-#if defined (__APPLE__) && defined (__MACH__)
-  sprintf(command,
-	  "%s -I%s -I%s -I%s -I../src -pipe -O -dynamiclib -fPIC -o %s %s -L../src -L%s -L%s -L%s -lODES -lsbml -lm",
- 	  gccFileName,
-	  SOSLIB_CPPFLAGS, /* changed order: SOSLIB first */
-	  SUNDIALS_CPPFLAGS,
-	  SBML_CPPFLAGS,
-	  dllFileName,
-	  cFileName,
-	  SUNDIALS_LDFLAGS,
-	  SBML_LDFLAGS,
-	  SOSLIB_LDFLAGS);
-#else
-  sprintf(command,
-	  "%s -I%s -I%s -I%s -I../src -pipe -O -shared -fPIC -o %s %s -L../src -L%s -L%s -L%s -lODES -lsbml -lm",
- 	  gccFileName,
-	  SOSLIB_CPPFLAGS, /* changed order: SOSLIB first */
-	  SUNDIALS_CPPFLAGS,
-	  SBML_CPPFLAGS,
-	  dllFileName,
-	  cFileName,
-	  SUNDIALS_LDFLAGS,
-	  SBML_LDFLAGS,
-	  SOSLIB_LDFLAGS);
+  /* construct commands for compiling, a single source is compiled
+     and linked at once */
+  len = strlen(gccFileName) + strlen(SOSLIB_CPPFLAGS) +
+    strlen(SUNDIALS_CPPFLAGS) + strlen(SBML_CPPFLAGS) +
+    strlen(SUNDIALS_LDFLAGS) + strlen(SBML_LDFLAGS) +
+    strlen(SOSLIB_LDFLAGS) + strlen(dllFileName) + 2*MAX_PATH;
+  for ( i=0; i<n; i++ )
+  {
+    level = levels != NULL ? levels[i] : COMPILER_DEFAULT_OPTIMIZATION;
+    ASSIGN_NEW_MEMORY_BLOCK(command[i], len, char, NULL);
+    if ( n == 1 )
+      sprintf(command[i],
+	      "%s -I%s -I%s -I%s -I../src -pipe -O%d %s -fPIC -o %s %s -L../src -L%s -L%s -L%s -lODES -lsbml -lm",
+	      gccFileName,
+	      SOSLIB_CPPFLAGS, /* changed order: SOSLIB first */
+	      SUNDIALS_CPPFLAGS,
+	      SBML_CPPFLAGS,
+	      level,
+	      shared,
+	      dllFileName,
+	      cFileName[i],
+	      SUNDIALS_LDFLAGS,
+	      SBML_LDFLAGS,
+	      SOSLIB_LDFLAGS);
+    else
+      sprintf(command[i],
+	      "%s -I%s -I%s -I%s -I../src -pipe -O%d -fPIC -c -o %s %s",
+	      gccFileName,
+	      SOSLIB_CPPFLAGS, /* changed order: SOSLIB first */
+	      SUNDIALS_CPPFLAGS,
+	      SBML_CPPFLAGS,
+	      level,
+	      oFileName[i],
+	      cFileName[i]);
+#ifdef _DEBUG
+    Warn(NULL, "Command: %s\n", command[i]);
 #endif
+  }
  
+  /* compile sources, in parallel */
+  result = Compiler_runCommands(n, command);
+
+  /* link objects to shared library */
+  if ( result == 0 && n > 1 )
+  {
+    for ( i=0; i<n; i++ )
+      len += strlen(oFileName[i]) + 1;
+    ASSIGN_NEW_MEMORY_BLOCK(link, len, char, NULL);
+    sprintf(link, "%s %s -fPIC -o %s", gccFileName, shared, dllFileName);
+    for ( i=0; i<n; i++ )
+    {
+      strcat(link, " ");
+      strcat(link, oFileName[i]);
+    }
+    sprintf(link + strlen(link), " -L../src -L%s -L%s -L%s -lODES -lsbml -lm",
+	    SUNDIALS_LDFLAGS,
+	    SBML_LDFLAGS,
+	    SOSLIB_LDFLAGS);
 #ifdef _DEBUG
-  Warn(NULL, "Command: %s\n", command);
+    Warn(NULL, "Command: %s\n", link);
 #endif
-  
-  /* compile source to shared library */
-  result = system(command);
+    linking = 1;
+    result = Compiler_runCommands(1, &link);
+    free(link);
+  }
 
+ cleanup:
   /* clean up compilation intermediates */
   free(tmpFileName);
-  remove(cFileName);
+  for ( i=0; i<n; i++ )
+  {
+    remove(cFileName[i]);
+    free(cFileName[i]);
+    remove(oFileName[i]);
+    free(oFileName[i]);
+    free(command[i]);
+  }
   free(cFileName);
-  remove(oFileName);
   free(oFileName);
+  free(command);
 
   /* handle possible errors */
   if (result != 0)
@@ -393,10 +524,15 @@ compiled_code_t *Compiler_compile_with_gcc(const char *sourceCode)
     if (result == -1)
       SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_GCC_FORK_FAILED,
 			"forking gcc compiler subprocess failed!");
+    else if (linking)
+      SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_COMPILATION_FAILED,
+			"linking the objects of %d sources into "
+			"shared library %s failed!", n, dllFileName);
     else 
       SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_COMPILATION_FAILED,
-			"compiling failed with errno %d - %s!",
-			result, strerror(result));    
+			"compiling failed for %d of %d sources!",
+			result, n);
+    free(dllFileName);
     return (NULL);
   }
   
@@ -420,28 +556,192 @@ compiled_code_t *Compiler_compile_with_gcc(const char *sourceCode)
   return (code);
 }
 
+/**
+   Returns a pointer to code that is compiled from the given source code
+*/
+compiled_code_t *Compiler_compile_with_gcc(const char *sourceCode)
+{
+  return Compiler_compileSources_with_gcc(1, &sourceCode, NULL);
+}
+
 #endif /* end _WIN32 */
 
 /**
    Returns a pointer to code that is compiled from the given source code
 */
 compiled_code_t *Compiler_compile(const char *sourceCode)
+{
+  return Compiler_compileSources(1, &sourceCode, NULL);
+}
+
+#if USE_TCC == 1
+
+#ifdef HAVE_PTHREAD
+/* libtcc uses global state while compiling, so only one model is
+   compiled at a time; the resulting states are independent */
+static pthread_mutex_t Compiler_tccMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* stores libtcc error messages */
+static void Compiler_tccError(void *opaque, const char *msg)
+{
+  (void) opaque;
+  SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_COMPILATION_FAILED,
+		    "tcc: %s", msg);
+}
+
+/**
+   Returns a pointer to code that is compiled in memory by libtcc
+   from the given source codes, without temporary files or compiler
+   subprocesses; each call creates its own TCCState.  Optimization
+   levels are not supported by tcc.
+*/
+static compiled_code_t *Compiler_compileSources_with_libtcc(int n, const char **sources)
 {
   compiled_code_t *code = NULL;
+  TCCState *s;
+  int i, result = -1;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&Compiler_tccMutex);
+#endif
+
+  s = tcc_new();
+  if ( s != NULL )
+  {
+    tcc_set_error_func(s, NULL, Compiler_tccError);
+    tcc_set_output_type(s, TCC_OUTPUT_MEMORY);
+    tcc_add_include_path(s, SOSLIB_CPPFLAGS); /* SOSLIB first */
+    tcc_add_include_path(s, SUNDIALS_CPPFLAGS);
+    tcc_add_include_path(s, SBML_CPPFLAGS);
+    tcc_add_include_path(s, "../src");
+
+    /* each source is a separate translation unit */
+    for ( i=0, result=0; i<n && result == 0; i++ )
+      result = tcc_compile_string(s, sources[i]);
+
+    /* libODES and libm symbols are resolved from the running process */
+    if ( result == 0 )
+#ifdef TCC_RELOCATE_AUTO
+      result = tcc_relocate(s, TCC_RELOCATE_AUTO);
+#else
+      result = tcc_relocate(s);
+#endif
+  }
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&Compiler_tccMutex);
+#endif
+
+  if ( result != 0 )
+  {
+    SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_COMPILATION_FAILED,
+		      "in-memory compilation with libtcc failed!");
+    if ( s != NULL )
+      tcc_delete(s);
+    return (NULL);
+  }
+
+  ASSIGN_NEW_MEMORY(code, compiled_code_t, NULL);
+  code->s = s;
+  code->dllHandle = NULL;
+  code->dllFileName = NULL;
+
+  return (code);
+}
+
+#endif /* USE_TCC == 1 */
+
+/**
+   Returns 1 if the given compiler backend is available, 0 otherwise
+*/
+int Compiler_hasBackend(compilerBackend_t backend)
+{
+  if ( backend == COMPILER_SYSTEM )
+    return 1;
+#if USE_TCC == 1
+  if ( backend == COMPILER_LIBTCC )
+    return 1;
+#endif
+  return 0;
+}
+
+/**
+   Returns the number of processors online, i.e. the number of
+   compiler processes run in parallel by Compiler_compileSources
+*/
+int Compiler_getNumProcessors(void)
+{
+  long n = 1;
+#if defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return n < 1 ? 1 : (int) n;
+}
+
+/**
+   Returns a pointer to code compiled from n source codes, each with
+   its own optimization level, linked into one library
+*/
+compiled_code_t *Compiler_compileSources(int n, const char **sources, const int *levels)
+{
+  return Compiler_compileSourcesWithBackend(COMPILER_SYSTEM, n, sources, levels);
+}
+
+/**
+   Returns a pointer to code compiled from n source codes with the
+   given backend; if the system compiler fails, e.g. on hosts without
+   a toolchain, libtcc is used if available
+*/
+compiled_code_t *Compiler_compileSourcesWithBackend(compilerBackend_t backend, int n, const char **sources, const int *levels)
+{
+  compiled_code_t *code = NULL;
+
+  if ( !Compiler_hasBackend(backend) )
+  {
+    SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_COMPILATION_FAILED,
+		      "compiler backend %d is not available!", backend);
+    return NULL;
+  }
+
+#if USE_TCC == 1
+  if ( backend == COMPILER_LIBTCC )
+    return Compiler_compileSources_with_libtcc(n, sources);
+#endif
+
+#if COMPILER_MULTIPLE_SOURCES == 1
+
+  code = Compiler_compileSources_with_gcc(n, sources, levels);
+
+#else
+
+  if ( n != 1 )
+  {
+    SolverError_error(WARNING_ERROR_TYPE, SOLVER_ERROR_COMPILATION_FAILED,
+		      "compiling %d separate sources is not supported "
+		      "on this platform!", n);
+    return NULL;
+  }
 
 #ifdef _WIN32
 
-  /* code = Compiler_compile_with_tcc(sourceCode); */
+  /* code = Compiler_compile_with_tcc(sources[0]); */
 
 #elif defined(_AIX) || defined(__AIX) || defined(__AIX__) || defined(__aix) || defined(__aix__) /* AIX use xlc_r */
 
-  code = Compiler_compile_with_xlc(sourceCode);
+  code = Compiler_compile_with_xlc(sources[0]);
   
 #else
 
-  code = Compiler_compile_with_gcc(sourceCode);
+  code = Compiler_compile_with_gcc(sources[0]);
 
 #endif /* end _WIN32 */
+#endif /* COMPILER_MULTIPLE_SOURCES */
+
+#if USE_TCC == 1
+  if ( code == NULL )
+    code = Compiler_compileSources_with_libtcc(n, sources);
+#endif
 
   return (code);
 }
@@ -453,6 +753,18 @@ void *CompiledCode_getFunction(compiled_code_t *code, const char *symbol)
 {
   void *result = NULL;
 
+#if USE_TCC == 1
+  if ( code->s != NULL )
+  {
+    result = tcc_get_symbol(code->s, symbol);
+    if ( result == NULL )
+      SolverError_error(FATAL_ERROR_TYPE, SOLVER_ERROR_DL_SYMBOL_UNDEFINED,
+			"tcc_get_symbol(): couldn't get symbol %s",
+			symbol);
+    return (result);
+  }
+#endif
+
 #ifdef _WIN32
   
   result = GetProcAddress(code->dllHandle, symbol);
@@ -488,6 +800,15 @@ void *CompiledCode_getFunction(compiled_code_t *code, const char *symbol)
 void CompiledCode_free(compiled_code_t *code)
 {
 
+#if USE_TCC == 1
+  if ( code->s != NULL )
+  {
+    tcc_delete(code->s);
+    free(code);
+    return;
+  }
+#endif
+
 #ifdef _WIN32
 
   FreeLibrary(code->dllHandle);
@@ -0,0 +1,1111 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup continuation Parameter Continuation of Steady States
+  \ingroup integrator
+  \brief This module traces a branch of steady states f(x, p) = 0 of
+  the ODE system in one parameter p by pseudo-arclength continuation.
+
+  Each step predicts the next point along the tangent of the branch
+  and corrects it by Newton's method on the steady state equations,
+  bordered by the arclength condition, such that the branch can be
+  followed around folds. The corrector starts from the previous
+  point, and typically converges in a few iterations. The Jacobian
+  matrix and df/dp are evaluated from their symbolic forms, if
+  available, and by difference quotients otherwise. Conservation
+  laws are found as by the steady state solver, and their totals
+  stay at those of the initial values.
+
+  The stability of each point is given by the eigenvalues of the
+  Jacobian matrix on the manifold of the conservation laws. Folds
+  are detected as sign changes of the parameter component of the
+  tangent, and Hopf bifurcations as complex pairs of eigenvalues
+  crossing the imaginary axis.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#include <sundials/sundials_dense.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/processAST.h"
+#include "sbmlsolver/odeModel.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/cvodeSolver.h"
+#include "sbmlsolver/nullSolver.h"
+#include "sbmlsolver/continuation.h"
+
+/* maximal Newton iterations of the corrector, iterations below which
+   the step size grows and its growth factor, and the bounds of the
+   step size relative to the initial step */
+#define CONT_MAXITER 10
+#define CONT_FASTITER 3
+#define CONT_GROW 1.5
+#define CONT_MINSTEP 1e-6
+#define CONT_MAXSTEP 10.0
+/* eigenvalues with real parts below this tolerance, relative to the
+   norm of the Jacobian matrix, are considered to be zero */
+#define CONT_EIGTOL 1e-8
+/* maximal QR iterations per eigenvalue */
+#define CONT_MAXQR 30
+
+/* work arrays of the continuation, the unknowns are y = (x, p) */
+typedef struct continuationWork
+{
+  int n;              /* number of ODEs */
+  int idx;            /* index of the parameter in the values */
+  int sens;           /* column of df/dp in the symbolic matrix, or -1 */
+  realtype *y;        /* current point */
+  realtype *ytrial;   /* corrector iterate, the next point */
+  realtype *yp;       /* predicted point */
+  realtype *t;        /* tangent at y */
+  realtype *tnew;     /* tangent at ytrial */
+  realtype *f;        /* ODE values */
+  realtype *fp;       /* df/dp */
+  realtype *g;        /* residual of the bordered system */
+  realtype **B;       /* bordered Jacobian matrix, and its LU factors */
+  int *pivot;         /* pivots of the LU factorization */
+  int nind;           /* number of independent variables */
+  int *ind;           /* the independent variables */
+  realtype **A;       /* Jacobian matrix of the independent variables */
+  realtype *wr, *wi;  /* eigenvalues of A */
+} continuationWork_t;
+
+/* the stability of a point, see Continuation_stability */
+typedef struct continuationPointInfo
+{
+  int nunstable;      /* eigenvalues with positive real part */
+  int ncomplex;       /* ... and non-zero imaginary part */
+  realtype mu;        /* real part of the complex eigenvalue closest
+			 to the imaginary axis */
+  realtype omega;     /* its imaginary part */
+} continuationPointInfo_t;
+
+static continuationWork_t *Continuation_createWork(nullSolver_t *, int n);
+static void Continuation_freeWork(continuationWork_t *);
+static int Continuation_residual(integratorInstance_t *,
+				 continuationWork_t *, realtype *y,
+				 realtype *g);
+static int Continuation_jacobian(integratorInstance_t *,
+				 continuationWork_t *, realtype *y,
+				 realtype *row);
+static int Continuation_correct(integratorInstance_t *,
+				continuationWork_t *);
+static void Continuation_tangent(continuationWork_t *, realtype *t);
+static int Continuation_stability(integratorInstance_t *,
+				  continuationWork_t *,
+				  continuationPointInfo_t *);
+static realtype Continuation_wrmsNorm(integratorInstance_t *, int n,
+				      realtype *v, realtype *y);
+static void Continuation_interpolate(int n, realtype *y0, realtype *t0,
+				     realtype *y1, realtype *t1,
+				     realtype h, realtype u, realtype *y);
+static int Continuation_addBifurcation(continuationBranch_t *,
+				       bifurcationType_t, realtype *y,
+				       realtype omega);
+static void Continuation_balance(realtype **a, int n);
+static void Continuation_hessenberg(realtype **a, int n);
+static int Continuation_eigenvalues(realtype **a, int n,
+				    realtype *wr, realtype *wi);
+
+
+/** Traces the branch of steady states in the parameter vi, from the
+    steady state at the current values.
+
+    The steady state at the current values is searched as by
+    IntegratorInstance_nullSolver, and followed by pseudo-arclength
+    continuation until the parameter leaves the interval [pmin, pmax]
+    or maxpoints points were found. vi must be a constant of the
+    model, whose current value is within [pmin, pmax]. ds is the
+    initial step size, i.e. the arclength in the space of the ODE
+    variables and the parameter, where the sign gives the initial
+    direction of the parameter. The step size adapts to the
+    convergence of the corrector, between 1e-6 and 10 times |ds|.
+
+    Returns the branch with the stability of each point and the
+    detected bifurcations, or NULL if no steady state was found at
+    the current values or the arguments are invalid. If the
+    corrector fails with the minimal step size, a warning is
+    produced and the branch ends at the last point. The current
+    values are set to the steady state at the initial parameter
+    value. The branch must be freed with ContinuationBranch_free.
+*/
+
+SBML_ODESOLVER_API continuationBranch_t *IntegratorInstance_continuation(integratorInstance_t *engine, variableIndex_t *vi, double pmin, double pmax, double ds, int maxpoints)
+{
+  int i, j, k, n, niter;
+  realtype h, hmin, hmax, u, *tmp;
+  odeModel_t *om = engine->om;
+  cvodeData_t *data = engine->data;
+  odeSense_t *os = engine->os;
+  continuationBranch_t *cb;
+  continuationWork_t *w;
+  continuationPointInfo_t prev, cur;
+
+  n = om->neq;
+  if ( vi == NULL || vi->index < om->neq + om->nass )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_REQUESTED_PARAMETER_NOT_FOUND,
+		      "Continuation: %s is not a constant parameter.",
+		      vi == NULL ? "(null)" : om->names[vi->index]);
+    return NULL;
+  }
+  if ( n == 0 || !(pmin < pmax) || ds == 0.0 || maxpoints < 1 ||
+       data->value[vi->index] < pmin || data->value[vi->index] > pmax )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Continuation: %s = %g must be within [%g, %g], "
+		      "with a non-zero step size.", om->names[vi->index],
+		      data->value[vi->index], pmin, pmax);
+    return NULL;
+  }
+
+  /* the first point */
+  if ( !IntegratorInstance_nullSolver(engine) )
+    return NULL;
+
+  w = Continuation_createWork(engine->solver->ns, n);
+  if ( w == NULL )
+    return NULL;
+  w->idx = vi->index;
+  w->sens = -1;
+  if ( os != NULL && os->sensitivity )
+    for ( j=0; j<os->nsens; j++ )
+      if ( os->index_sens[j] == w->idx && os->index_sensP[j] != -1 )
+	w->sens = os->index_sensP[j];
+
+  ASSIGN_NEW_MEMORY(cb, continuationBranch_t, NULL);
+  cb->om = om;
+  cb->neq = n;
+  cb->index = w->idx;
+  cb->ncons = engine->solver->ns->ncons;
+  ASSIGN_NEW_MEMORY_BLOCK(cb->p, maxpoints, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(cb->x, maxpoints, double *, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(cb->nunstable, maxpoints, int, NULL);
+  /* each new point can add a fold and a Hopf bifurcation */
+  ASSIGN_NEW_MEMORY_BLOCK(cb->bifurcation, 2*maxpoints, bifurcationPoint_t,
+			  NULL);
+
+  for ( i=0; i<n; i++ )
+    w->y[i] = data->value[i];
+  w->y[n] = data->value[w->idx];
+
+  /* the initial tangent points into the direction of ds */
+  for ( i=0; i<n; i++ )
+    w->tnew[i] = 0.0;
+  w->tnew[n] = 1.0;
+  if ( !Continuation_jacobian(engine, w, w->y, w->tnew) ||
+       denseGETRF(w->B, n+1, n+1, w->pivot) != 0 ||
+       !Continuation_stability(engine, w, &prev) )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+		      "Continuation: the Jacobian matrix is singular at "
+		      "the initial steady state.");
+    Continuation_freeWork(w);
+    ContinuationBranch_free(cb);
+    return NULL;
+  }
+  Continuation_tangent(w, w->t);
+  if ( ds < 0.0 )
+    for ( i=0; i<=n; i++ )
+      w->t[i] = -w->t[i];
+
+  ASSIGN_NEW_MEMORY_BLOCK(cb->x[0], n, double, NULL);
+  for ( i=0; i<n; i++ )
+    cb->x[0][i] = w->y[i];
+  cb->p[0] = w->y[n];
+  cb->nunstable[0] = prev.nunstable;
+  cb->npoints = 1;
+
+  h = fabs(ds);
+  hmin = CONT_MINSTEP * h;
+  hmax = CONT_MAXSTEP * h;
+  while ( cb->npoints < maxpoints )
+  {
+    /* predictor along the tangent and corrector on the plane
+       orthogonal to the tangent */
+    for ( i=0; i<=n; i++ )
+      w->yp[i] = w->ytrial[i] = w->y[i] + h*w->t[i];
+    niter = Continuation_correct(engine, w);
+    if ( niter > 0 )
+    {
+      cb->nni += niter;
+      if ( w->ytrial[n] < pmin || w->ytrial[n] > pmax )
+	break;
+      /* the tangent at the new point keeps the direction */
+      if ( !Continuation_jacobian(engine, w, w->ytrial, w->t) ||
+	   denseGETRF(w->B, n+1, n+1, w->pivot) != 0 ||
+	   !Continuation_stability(engine, w, &cur) )
+	niter = 0;
+    }
+    if ( niter == 0 )
+    {
+      cb->nfail++;
+      h *= 0.5;
+      if ( h < hmin )
+      {
+	SolverError_error(WARNING_ERROR_TYPE,
+			  SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+			  "Continuation stopped at %s = %g: the corrector "
+			  "did not converge.", om->names[w->idx], w->y[n]);
+	break;
+      }
+      continue;
+    }
+    Continuation_tangent(w, w->tnew);
+
+    /* bifurcations between the last and the new point */
+    k = cb->npoints;
+    if ( (w->t[n] > 0.0) != (w->tnew[n] > 0.0) )
+    {
+      u = w->t[n] / (w->t[n] - w->tnew[n]);
+      Continuation_interpolate(n, w->y, w->t, w->ytrial, w->tnew, h, u,
+			       w->yp);
+      if ( !Continuation_addBifurcation(cb, BIFURCATION_FOLD, w->yp, 0.0) )
+	break;
+    }
+    if ( cur.ncomplex != prev.ncomplex &&
+	 abs(cur.nunstable - prev.nunstable) == 2 )
+    {
+      u = prev.mu / (prev.mu - cur.mu);
+      Continuation_interpolate(n, w->y, w->t, w->ytrial, w->tnew, h, u,
+			       w->yp);
+      if ( !Continuation_addBifurcation(cb, BIFURCATION_HOPF, w->yp,
+					(1.0-u)*prev.omega + u*cur.omega) )
+	break;
+    }
+
+    ASSIGN_NEW_MEMORY_BLOCK(cb->x[k], n, double, NULL);
+    for ( i=0; i<n; i++ )
+      cb->x[k][i] = w->ytrial[i];
+    cb->p[k] = w->ytrial[n];
+    cb->nunstable[k] = cur.nunstable;
+    cb->npoints++;
+
+    tmp = w->y;
+    w->y = w->ytrial;
+    w->ytrial = tmp;
+    tmp = w->t;
+    w->t = w->tnew;
+    w->tnew = tmp;
+    prev = cur;
+
+    if ( niter <= CONT_FASTITER )
+      h = h*CONT_GROW < hmax ? h*CONT_GROW : hmax;
+  }
+
+  /* back to the first point */
+  for ( i=0; i<n; i++ )
+    data->value[i] = cb->x[0][i];
+  data->value[w->idx] = cb->p[0];
+  data->allRulesUpdated = 0;
+  engine->isValid = 0;
+
+  Continuation_freeWork(w);
+
+  return cb;
+}
+
+
+/** Returns the number of points of the branch
+*/
+
+SBML_ODESOLVER_API int ContinuationBranch_getNumPoints(const continuationBranch_t *cb)
+{
+  return cb->npoints;
+}
+
+
+/** Returns the parameter value at point i of the branch
+*/
+
+SBML_ODESOLVER_API double ContinuationBranch_getParameter(const continuationBranch_t *cb, int i)
+{
+  return cb->p[i];
+}
+
+
+/** Returns the value of the ODE variable vi at point i of the
+    branch
+*/
+
+SBML_ODESOLVER_API double ContinuationBranch_getValue(const continuationBranch_t *cb, int i, const variableIndex_t *vi)
+{
+  if ( vi->index >= cb->neq )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_SYMBOL_IS_NOT_IN_MODEL,
+		      "Continuation: %s is not an ODE variable.",
+		      cb->om->names[vi->index]);
+    return 0.0;
+  }
+  return cb->x[i][vi->index];
+}
+
+
+/** Returns 1 if the steady state at point i of the branch is stable,
+    i.e. all eigenvalues of the Jacobian matrix have negative real
+    parts, and 0 otherwise
+*/
+
+SBML_ODESOLVER_API int ContinuationBranch_isStable(const continuationBranch_t *cb, int i)
+{
+  return cb->nunstable[i] == 0;
+}
+
+
+/** Returns the number of bifurcations detected along the branch
+*/
+
+SBML_ODESOLVER_API int ContinuationBranch_getNumBifurcations(const continuationBranch_t *cb)
+{
+  return cb->nbifurcations;
+}
+
+
+/** Returns the type of bifurcation i of the branch
+*/
+
+SBML_ODESOLVER_API bifurcationType_t ContinuationBranch_getBifurcationType(const continuationBranch_t *cb, int i)
+{
+  return cb->bifurcation[i].type;
+}
+
+
+/** Returns the parameter value of bifurcation i of the branch
+*/
+
+SBML_ODESOLVER_API double ContinuationBranch_getBifurcationParameter(const continuationBranch_t *cb, int i)
+{
+  return cb->bifurcation[i].p;
+}
+
+
+/** Prints the branch as a table of the parameter, the ODE variables
+    and the stability of each point, followed by the bifurcations
+*/
+
+SBML_ODESOLVER_API void ContinuationBranch_print(const continuationBranch_t *cb, FILE *f)
+{
+  int i, k;
+  bifurcationPoint_t *bp;
+
+  fprintf(f, "#%s", cb->om->names[cb->index]);
+  for ( i=0; i<cb->neq; i++ )
+    fprintf(f, " %s", cb->om->names[i]);
+  fprintf(f, " stable\n");
+  for ( k=0; k<cb->npoints; k++ )
+  {
+    fprintf(f, "%g", cb->p[k]);
+    for ( i=0; i<cb->neq; i++ )
+      fprintf(f, " %g", cb->x[k][i]);
+    fprintf(f, " %d\n", cb->nunstable[k] == 0);
+  }
+
+  for ( k=0; k<cb->nbifurcations; k++ )
+  {
+    bp = &cb->bifurcation[k];
+    if ( bp->type == BIFURCATION_FOLD )
+      fprintf(f, "## fold at %s = %g\n", cb->om->names[cb->index], bp->p);
+    else
+      fprintf(f, "## Hopf bifurcation at %s = %g, omega = %g\n",
+	      cb->om->names[cb->index], bp->p, bp->omega);
+  }
+  fprintf(f, "## points = %d, nni = %ld, nfail = %ld\n",
+	  cb->npoints, cb->nni, cb->nfail);
+}
+
+
+/** Frees a branch
+*/
+
+SBML_ODESOLVER_API void ContinuationBranch_free(continuationBranch_t *cb)
+{
+  int i;
+
+  if ( cb == NULL )
+    return;
+
+  if ( cb->x != NULL )
+    for ( i=0; i<cb->npoints; i++ )
+      free(cb->x[i]);
+  if ( cb->bifurcation != NULL )
+    for ( i=0; i<cb->nbifurcations; i++ )
+      free(cb->bifurcation[i].x);
+  free(cb->p);
+  free(cb->x);
+  free(cb->nunstable);
+  free(cb->bifurcation);
+  free(cb);
+}
+
+
+/************* internal functions ************/
+
+/* creates the work arrays for n ODEs, with the conservation laws of
+   the steady state solver; returns NULL on failure */
+static continuationWork_t *Continuation_createWork(nullSolver_t *ns, int n)
+{
+  int i;
+  continuationWork_t *w;
+
+  ASSIGN_NEW_MEMORY(w, continuationWork_t, NULL);
+  w->n = n;
+  ASSIGN_NEW_MEMORY_BLOCK(w->y, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->ytrial, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->yp, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->t, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->tnew, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->f, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->fp, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->g, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->pivot, n+1, int, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->ind, n, int, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->wr, n, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->wi, n, realtype, NULL);
+  w->B = newDenseMat(n+1, n+1);
+  CVODE_HANDLE_ERROR((void *)w->B, "newDenseMat", 0);
+  w->A = newDenseMat(n, n);
+  CVODE_HANDLE_ERROR((void *)w->A, "newDenseMat", 0);
+
+  w->nind = 0;
+  for ( i=0; i<n; i++ )
+    if ( ns->law[i] == -1 )
+      w->ind[w->nind++] = i;
+
+  return w;
+}
+
+
+/* frees the work arrays */
+static void Continuation_freeWork(continuationWork_t *w)
+{
+  free(w->y);
+  free(w->ytrial);
+  free(w->yp);
+  free(w->t);
+  free(w->tnew);
+  free(w->f);
+  free(w->fp);
+  free(w->g);
+  free(w->pivot);
+  free(w->ind);
+  free(w->wr);
+  free(w->wi);
+  if ( w->B != NULL )
+    destroyMat(w->B);
+  if ( w->A != NULL )
+    destroyMat(w->A);
+  free(w);
+}
+
+
+/* evaluates the steady state equations at y = (x, p) into g, where
+   the ODE of each dependent variable is replaced by its conservation
+   law; returns the flag of the RHS function */
+static int Continuation_residual(integratorInstance_t *engine,
+				 continuationWork_t *w, realtype *y,
+				 realtype *g)
+{
+  int i, k, flag;
+  realtype sum;
+  nullSolver_t *ns = engine->solver->ns;
+
+  engine->data->value[w->idx] = y[w->n];
+  flag = IntegratorInstance_nsRhs(ns, engine->data, y, g);
+  if ( flag != 0 )
+    return flag;
+
+  for ( k=0; k<ns->ncons; k++ )
+  {
+    sum = 0.0;
+    for ( i=0; i<w->n; i++ )
+      sum += ns->cons[k][i] * y[i];
+    g[ns->dep[k]] = sum - ns->total[k];
+  }
+
+  return 0;
+}
+
+
+/* evaluates the bordered Jacobian matrix of the steady state
+   equations at y = (x, p) into B, with the given last row, and the
+   Jacobian matrix of the ODEs into the steady state solver;
+   returns 1 on success and 0 on failure */
+static int Continuation_jacobian(integratorInstance_t *engine,
+				 continuationWork_t *w, realtype *y,
+				 realtype *row)
+{
+  int i, j, k, n;
+  realtype inc, save;
+  cvodeData_t *data = engine->data;
+  odeSense_t *os = engine->os;
+  nullSolver_t *ns = engine->solver->ns;
+
+  n = w->n;
+  data->value[w->idx] = y[n];
+  if ( IntegratorInstance_nsRhs(ns, data, y, w->f) != 0 ||
+       !IntegratorInstance_nsJacobian(engine, y, w->f, 0) )
+    return 0;
+
+  /* df/dp */
+  if ( w->sens != -1 )
+  {
+    for ( i=0; i<n; i++ )
+    {
+      data->value[i] = y[i];
+      w->fp[i] = 0.0;
+    }
+    for ( k=0; k<os->sparsesize; k++ )
+    {
+      nonzeroElem_t *nonzero = os->sensSparse[k];
+      if ( nonzero->j == w->sens )
+	w->fp[nonzero->i] = evaluateAST(nonzero->ij, data);
+    }
+  }
+  else
+  {
+    save = y[n];
+    inc = sqrt(UNIT_ROUNDOFF) * (fabs(save) > 0.0 ? fabs(save) : 1.0);
+    data->value[w->idx] = save + inc;
+    if ( IntegratorInstance_nsRhs(ns, data, y, w->fp) != 0 )
+    {
+      data->value[w->idx] = save;
+      return 0;
+    }
+    data->value[w->idx] = save;
+    for ( i=0; i<n; i++ )
+      w->fp[i] = (w->fp[i] - w->f[i]) / inc;
+    /* restore assignment rules */
+    if ( IntegratorInstance_nsRhs(ns, data, y, w->f) != 0 )
+      return 0;
+  }
+
+  for ( j=0; j<n; j++ )
+    for ( i=0; i<n; i++ )
+      w->B[j][i] = ns->J[j][i];
+  for ( i=0; i<n; i++ )
+    w->B[n][i] = w->fp[i];
+  for ( k=0; k<ns->ncons; k++ )
+  {
+    for ( j=0; j<n; j++ )
+      w->B[j][ns->dep[k]] = ns->cons[k][j];
+    w->B[n][ns->dep[k]] = 0.0;
+  }
+  for ( j=0; j<=n; j++ )
+    w->B[j][n] = row[j];
+
+  return 1;
+}
+
+
+/* Newton's method for the steady state equations and the arclength
+   condition t * (y - yp) = 0 from the predicted point yp into
+   ytrial; returns the number of iterations if converged, and 0
+   otherwise */
+static int Continuation_correct(integratorInstance_t *engine,
+				continuationWork_t *w)
+{
+  int i, iter, n;
+  realtype sum;
+
+  n = w->n;
+  for ( iter=1; iter<=CONT_MAXITER; iter++ )
+  {
+    if ( Continuation_residual(engine, w, w->ytrial, w->g) != 0 ||
+	 !Continuation_jacobian(engine, w, w->ytrial, w->t) ||
+	 denseGETRF(w->B, n+1, n+1, w->pivot) != 0 )
+      return 0;
+    sum = 0.0;
+    for ( i=0; i<=n; i++ )
+      sum += w->t[i] * (w->ytrial[i] - w->yp[i]);
+    for ( i=0; i<n; i++ )
+      w->g[i] = -w->g[i];
+    w->g[n] = -sum;
+    denseGETRS(w->B, n+1, w->pivot, w->g);
+    for ( i=0; i<=n; i++ )
+      w->ytrial[i] += w->g[i];
+
+    if ( Continuation_wrmsNorm(engine, n+1, w->g, w->ytrial) <= 1.0 )
+      return Continuation_residual(engine, w, w->ytrial, w->f) == 0 ?
+	iter : 0;
+  }
+
+  return 0;
+}
+
+
+/* solves the factorized bordered system for the unit tangent t at
+   the point of the factorization, with the direction of its last
+   row */
+static void Continuation_tangent(continuationWork_t *w, realtype *t)
+{
+  int i, n;
+  realtype norm;
+
+  n = w->n;
+  for ( i=0; i<n; i++ )
+    t[i] = 0.0;
+  t[n] = 1.0;
+  denseGETRS(w->B, n+1, w->pivot, t);
+
+  norm = 0.0;
+  for ( i=0; i<=n; i++ )
+    norm += t[i]*t[i];
+  norm = sqrt(norm);
+  for ( i=0; i<=n; i++ )
+    t[i] /= norm;
+}
+
+
+/* calculates the eigenvalues of the Jacobian matrix of the steady
+   state solver on the manifold of the conservation laws, i.e. of the
+   independent variables with x_dep = total - c * x_ind, and counts
+   those with positive real part; returns 1 on success and 0 if the
+   QR algorithm didn't converge */
+static int Continuation_stability(integratorInstance_t *engine,
+				  continuationWork_t *w,
+				  continuationPointInfo_t *info)
+{
+  int a, b, k, m;
+  realtype norm, sum, tol;
+  nullSolver_t *ns = engine->solver->ns;
+  realtype **J = ns->J;
+
+  m = w->nind;
+  info->nunstable = info->ncomplex = 0;
+  info->mu = info->omega = 0.0;
+  if ( m == 0 )
+    return 1;
+
+  norm = 0.0;
+  for ( a=0; a<m; a++ )
+  {
+    sum = 0.0;
+    for ( b=0; b<m; b++ )
+    {
+      w->A[b][a] = J[w->ind[b]][w->ind[a]];
+      for ( k=0; k<ns->ncons; k++ )
+	w->A[b][a] -= J[ns->dep[k]][w->ind[a]] * ns->cons[k][w->ind[b]];
+      sum += fabs(w->A[b][a]);
+    }
+    if ( sum > norm )
+      norm = sum;
+  }
+
+  Continuation_balance(w->A, m);
+  Continuation_hessenberg(w->A, m);
+  if ( !Continuation_eigenvalues(w->A, m, w->wr, w->wi) )
+    return 0;
+
+  tol = CONT_EIGTOL * norm;
+  info->mu = HUGE_VAL;
+  for ( a=0; a<m; a++ )
+  {
+    if ( w->wr[a] > tol )
+    {
+      info->nunstable++;
+      if ( w->wi[a] != 0.0 )
+	info->ncomplex++;
+    }
+    if ( w->wi[a] > 0.0 && fabs(w->wr[a]) < fabs(info->mu) )
+    {
+      info->mu = w->wr[a];
+      info->omega = w->wi[a];
+    }
+  }
+  if ( info->mu == HUGE_VAL )
+    info->mu = 0.0;
+
+  return 1;
+}
+
+
+/* weighted root mean square norm of a step v at y, with the weights
+   of CVODES and a lower bound at the round-off level of y */
+static realtype Continuation_wrmsNorm(integratorInstance_t *engine, int n,
+				      realtype *v, realtype *y)
+{
+  int i;
+  realtype sum, r, floor;
+
+  floor = 0.0;
+  for ( i=0; i<n; i++ )
+    if ( fabs(y[i]) > floor )
+      floor = fabs(y[i]);
+  floor = floor > 0.0 ? 1e3 * UNIT_ROUNDOFF * floor : UNIT_ROUNDOFF;
+  sum = 0.0;
+  for ( i=0; i<n; i++ )
+  {
+    r = v[i] / (engine->opt->Error + engine->opt->RError * fabs(y[i]) + floor);
+    sum += r*r;
+  }
+
+  return sqrt(sum/n);
+}
+
+
+/* cubic Hermite interpolation of the branch between y0 and y1 with
+   tangents t0 and t1 and arclength h at u in [0, 1] into y */
+static void Continuation_interpolate(int n, realtype *y0, realtype *t0,
+				     realtype *y1, realtype *t1,
+				     realtype h, realtype u, realtype *y)
+{
+  int i;
+  realtype h00, h10, h01, h11;
+
+  h00 = (1.0 + 2.0*u) * (1.0 - u) * (1.0 - u);
+  h10 = u * (1.0 - u) * (1.0 - u);
+  h01 = u * u * (3.0 - 2.0*u);
+  h11 = u * u * (u - 1.0);
+  for ( i=0; i<=n; i++ )
+    y[i] = h00*y0[i] + h10*h*t0[i] + h01*y1[i] + h11*h*t1[i];
+}
+
+
+/* appends a bifurcation at y = (x, p) before the next point of the
+   branch; returns 1 on success and 0 on failure */
+static int Continuation_addBifurcation(continuationBranch_t *cb,
+				       bifurcationType_t type, realtype *y,
+				       realtype omega)
+{
+  int i;
+  bifurcationPoint_t *bp;
+
+  bp = &cb->bifurcation[cb->nbifurcations];
+  ASSIGN_NEW_MEMORY_BLOCK(bp->x, cb->neq, double, 0);
+  for ( i=0; i<cb->neq; i++ )
+    bp->x[i] = y[i];
+  bp->p = y[cb->neq];
+  bp->type = type;
+  bp->point = cb->npoints;
+  bp->omega = omega;
+  cb->nbifurcations++;
+
+  return 1;
+}
+
+
+/* The eigenvalues of a real matrix are found by balancing, reduction
+   to upper Hessenberg form by elimination, and the shifted QR
+   algorithm (EISPACK balanc, elmhes and hqr); the matrices are
+   column-wise, a[j][i] is the element in row i and column j */
+
+/* balances the rows and columns of a by powers of 2 */
+static void Continuation_balance(realtype **a, int n)
+{
+  int i, j, done;
+  realtype r, c, g, f, s;
+
+  done = 0;
+  while ( !done )
+  {
+    done = 1;
+    for ( i=0; i<n; i++ )
+    {
+      r = c = 0.0;
+      for ( j=0; j<n; j++ )
+	if ( j != i )
+	{
+	  c += fabs(a[i][j]);
+	  r += fabs(a[j][i]);
+	}
+      if ( c == 0.0 || r == 0.0 )
+	continue;
+
+      g = r / 2.0;
+      f = 1.0;
+      s = c + r;
+      while ( c < g )
+      {
+	f *= 2.0;
+	c *= 4.0;
+      }
+      g = r * 2.0;
+      while ( c > g )
+      {
+	f /= 2.0;
+	c /= 4.0;
+      }
+      if ( (c + r)/f < 0.95*s )
+      {
+	done = 0;
+	for ( j=0; j<n; j++ )
+	  a[j][i] /= f;
+	for ( j=0; j<n; j++ )
+	  a[i][j] *= f;
+      }
+    }
+  }
+}
+
+
+/* reduces a to upper Hessenberg form by elimination with pivoting */
+static void Continuation_hessenberg(realtype **a, int n)
+{
+  int i, j, m;
+  realtype x, y, tmp;
+
+  for ( m=1; m<n-1; m++ )
+  {
+    x = 0.0;
+    i = m;
+    for ( j=m; j<n; j++ )
+      if ( fabs(a[m-1][j]) > fabs(x) )
+      {
+	x = a[m-1][j];
+	i = j;
+      }
+    if ( i != m )
+    {
+      for ( j=m-1; j<n; j++ )
+      {
+	tmp = a[j][i];
+	a[j][i] = a[j][m];
+	a[j][m] = tmp;
+      }
+      for ( j=0; j<n; j++ )
+      {
+	tmp = a[i][j];
+	a[i][j] = a[m][j];
+	a[m][j] = tmp;
+      }
+    }
+    if ( x == 0.0 )
+      continue;
+    for ( i=m+1; i<n; i++ )
+    {
+      y = a[m-1][i];
+      if ( y == 0.0 )
+	continue;
+      y /= x;
+      a[m-1][i] = 0.0;
+      for ( j=m; j<n; j++ )
+	a[j][i] -= y * a[j][m];
+      for ( j=0; j<n; j++ )
+	a[m][j] += y * a[i][j];
+    }
+  }
+}
+
+
+/* finds the eigenvalues wr + i wi of the upper Hessenberg matrix a,
+   which is destroyed, where complex conjugate pairs are consecutive
+   with the positive imaginary part first; returns 1 on success and
+   0 if the QR iterations didn't converge */
+static int Continuation_eigenvalues(realtype **a, int n,
+				    realtype *wr, realtype *wi)
+{
+  int nn, m, l, k, j, its, i, mmin;
+  realtype z, y, x, w, v, u, t, s, r, q, p, anorm;
+
+  /* 1-based indices as in EISPACK */
+#define H(i, j) a[(j)-1][(i)-1]
+
+  anorm = 0.0;
+  for ( i=1; i<=n; i++ )
+    for ( j=(i > 1 ? i-1 : 1); j<=n; j++ )
+      anorm += fabs(H(i, j));
+
+  p = q = r = 0.0;
+  nn = n;
+  t = 0.0;
+  while ( nn >= 1 )
+  {
+    its = 0;
+    do
+    {
+      /* look for a single small subdiagonal element */
+      for ( l=nn; l>=2; l-- )
+      {
+	s = fabs(H(l-1, l-1)) + fabs(H(l, l));
+	if ( s == 0.0 )
+	  s = anorm;
+	if ( fabs(H(l, l-1)) + s == s )
+	{
+	  H(l, l-1) = 0.0;
+	  break;
+	}
+      }
+      x = H(nn, nn);
+      if ( l == nn )
+      {
+	/* one root found */
+	wr[nn-1] = x + t;
+	wi[nn-1] = 0.0;
+	nn--;
+      }
+      else
+      {
+	y = H(nn-1, nn-1);
+	w = H(nn, nn-1) * H(nn-1, nn);
+	if ( l == nn-1 )
+	{
+	  /* two roots found */
+	  p = 0.5 * (y - x);
+	  q = p*p + w;
+	  z = sqrt(fabs(q));
+	  x += t;
+	  if ( q >= 0.0 )
+	  {
+	    z = p + (p >= 0.0 ? fabs(z) : -fabs(z));
+	    wr[nn-2] = wr[nn-1] = x + z;
+	    if ( z != 0.0 )
+	      wr[nn-1] = x - w/z;
+	    wi[nn-2] = wi[nn-1] = 0.0;
+	  }
+	  else
+	  {
+	    wr[nn-2] = wr[nn-1] = x + p;
+	    wi[nn-2] = z;
+	    wi[nn-1] = -z;
+	  }
+	  nn -= 2;
+	}
+	else
+	{
+	  if ( its == CONT_MAXQR )
+	    return 0;
+	  if ( its == 10 || its == 20 )
+	  {
+	    /* exceptional shift */
+	    t += x;
+	    for ( i=1; i<=nn; i++ )
+	      H(i, i) -= x;
+	    s = fabs(H(nn, nn-1)) + fabs(H(nn-1, nn-2));
+	    y = x = 0.75*s;
+	    w = -0.4375*s*s;
+	  }
+	  its++;
+	  /* form shift and look for two consecutive small subdiagonal
+	     elements */
+	  for ( m=nn-2; m>=l; m-- )
+	  {
+	    z = H(m, m);
+	    r = x - z;
+	    s = y - z;
+	    p = (r*s - w) / H(m+1, m) + H(m, m+1);
+	    q = H(m+1, m+1) - z - r - s;
+	    r = H(m+2, m+1);
+	    s = fabs(p) + fabs(q) + fabs(r);
+	    p /= s;
+	    q /= s;
+	    r /= s;
+	    if ( m == l )
+	      break;
+	    u = fabs(H(m, m-1)) * (fabs(q) + fabs(r));
+	    v = fabs(p) * (fabs(H(m-1, m-1)) + fabs(z) + fabs(H(m+1, m+1)));
+	    if ( u + v == v )
+	      break;
+	  }
+	  for ( i=m+2; i<=nn; i++ )
+	  {
+	    H(i, i-2) = 0.0;
+	    if ( i != m+2 )
+	      H(i, i-3) = 0.0;
+	  }
+	  /* double QR step on rows l to nn and columns m to nn */
+	  for ( k=m; k<=nn-1; k++ )
+	  {
+	    if ( k != m )
+	    {
+	      p = H(k, k-1);
+	      q = H(k+1, k-1);
+	      r = 0.0;
+	      if ( k != nn-1 )
+		r = H(k+2, k-1);
+	      if ( (x = fabs(p) + fabs(q) + fabs(r)) != 0.0 )
+	      {
+		p /= x;
+		q /= x;
+		r /= x;
+	      }
+	    }
+	    s = sqrt(p*p + q*q + r*r);
+	    if ( p < 0.0 )
+	      s = -s;
+	    if ( s == 0.0 )
+	      continue;
+	    if ( k == m )
+	    {
+	      if ( l != m )
+		H(k, k-1) = -H(k, k-1);
+	    }
+	    else
+	      H(k, k-1) = -s*x;
+	    p += s;
+	    x = p/s;
+	    y = q/s;
+	    z = r/s;
+	    q /= p;
+	    r /= p;
+	    for ( j=k; j<=nn; j++ )
+	    {
+	      p = H(k, j) + q*H(k+1, j);
+	      if ( k != nn-1 )
+	      {
+		p += r*H(k+2, j);
+		H(k+2, j) -= p*z;
+	      }
+	      H(k+1, j) -= p*y;
+	      H(k, j) -= p*x;
+	    }
+	    mmin = nn < k+3 ? nn : k+3;
+	    for ( i=l; i<=mmin; i++ )
+	    {
+	      p = x*H(i, k) + y*H(i, k+1);
+	      if ( k != nn-1 )
+	      {
+		p += z*H(i, k+2);
+		H(i, k+2) -= p*r;
+	      }
+	      H(i, k+1) -= p*q;
+	      H(i, k) -= p;
+	    }
+	  }
+	}
+      }
+    } while ( l < nn-1 );
+  }
+
+#undef H
+
+  return 1;
+}
+
+
+/*! @} */
+/* End of file */
@@ -61,6 +61,7 @@
 #include "sbmlsolver/solverError.h"
 
 #include "sbmlsolver/variableIndex.h"
+#include "sbmlsolver/odePartition.h"
 
 
 
@@ -96,11 +97,18 @@ static cvodeData_t *CvodeData_allocate(int nvalues, int nevents, int neq)
   data->p_orig  = NULL;
   /* default: don't use data->p */
   data->use_p = 0;
+
+  /* created on first evaluation of observation data */
+  data->TimeSeriesCursor = NULL;
   
   /* Adjoint-specific */
   /*!!! should this be moved to adjoint specific initiation? */
   ASSIGN_NEW_MEMORY_BLOCK(data->adjvalue, nvalues, double, NULL);
+  data->adjPrecond = NULL;
 
+  /* created with the CVODES structures if threads are requested */
+  data->pool = NULL;
+  data->partition = NULL;
 
   return data ;
 }
@@ -146,6 +154,10 @@ SBML_ODESOLVER_API cvodeData_t *CvodeData_create(odeModel_t *om)
   /* set pointer to input model */
   data->model = om ;
 
+  /* queue for firing times of time-only event triggers */
+  if ( om->ntimedEvents )
+    data->eventQueue = EventQueue_create();
+
   return data;
 }
 
@@ -202,6 +214,113 @@ SBML_ODESOLVER_API void CvodeData_free(cvodeData_t * data)
 }
 
 
+/* Returns the observation data value of ODE variable `index' at the
+   current time: the spline interpolation for continuous data, via the
+   integrator's own interval cursor, or the value in data row
+   TimeSeriesIndex for discrete data */
+
+double CvodeData_getTimeSeriesValue(cvodeData_t *data, int index)
+{
+  int i;
+  time_series_t *ts = data->model->time_series;
+
+  /* if continuous data is observed, obtain interpolated result */
+  if ( (data->model->discrete_observation_data != 1) ||
+       (data->model->compute_vector_v != 1) )
+  {
+    /* (re)create the cursor if the model's data has been replaced */
+    if ( data->TimeSeriesCursor == NULL ||
+	 data->TimeSeriesCursor->ts != ts )
+    {
+      free_cursor(data->TimeSeriesCursor);
+      data->TimeSeriesCursor = create_cursor(ts);
+      if ( data->TimeSeriesCursor == NULL )
+	return 0;
+    }
+    return call_cursor(index, data->currenttime, data->TimeSeriesCursor);
+  }
+
+  /* if discrete data is observed, simply obtain value from the
+     current data row */
+  i = data->TimeSeriesIndex;
+  if ( i < 0 || i >= ts->n_time )
+  {
+    SolverError_error(FATAL_ERROR_TYPE,
+		      SOLVER_ERROR_AST_EVALUATION_FAILED_DISCRETE_DATA,
+		      "use of discrete time series data failed; "
+		      "no data row %d", i);
+    return 0;
+  }
+  return ts->data[index][i];
+}
+
+
+/* Adds `scale' times the vector v of the linear objective, evaluated
+   at the current time and values, to the array `out' of size neq;
+   via the compiled vector v if functions are compiled */
+
+SBML_ODESOLVER_API void CvodeData_addVectorV(cvodeData_t *data, double *out, double scale)
+{
+  int i;
+  odeModel_t *om = data->model;
+  VectorVFn vector_v = NULL;
+
+  if ( data->opt != NULL && data->opt->compileFunctions )
+    vector_v = ODEModel_getCompiledVectorVFunction(om);
+
+  if ( vector_v != NULL )
+    vector_v(data, out, scale);
+  else
+    for ( i=0; i<om->neq; i++ )
+      out[i] += scale * evaluateAST(om->vector_v[i], data);
+}
+
+
+/* Returns the general objective function evaluated at the current
+   time and values; via the compiled objective if functions are
+   compiled */
+
+double CvodeData_evaluateObjective(cvodeData_t *data)
+{
+  ObjectiveFn objective = NULL;
+
+  if ( data->opt != NULL && data->opt->compileFunctions )
+    objective = ODEModel_getCompiledObjectiveFunction(data->model);
+
+  if ( objective != NULL )
+    return objective(data);
+
+  return evaluateAST(data->model->ObjectiveFunction, data);
+}
+
+
+/* Schedules the firing times of those time-only event triggers
+   (see ODEModel_setTimedEvents) that are not yet fired and lie
+   ahead of the current time; the integrator stops exactly at these
+   times. Called upon initialization and when constants change. */
+
+void CvodeData_scheduleEvents(cvodeData_t *data)
+{
+  int i;
+  double time;
+  odeModel_t *om = data->model;
+
+  if ( data->eventQueue == NULL )
+    return;
+
+  EventQueue_clear(data->eventQueue);
+  for ( i=0; i<data->nevents; i++ )
+  {
+    if ( om->eventTimeChild[i] == -1 || data->trigger[i] )
+      continue;
+    time = evaluateAST(ASTNode_getChild(om->event[i],
+					om->eventTimeChild[i]), data);
+    if ( time > data->currenttime )
+      EventQueue_push(data->eventQueue, time, i);
+  }
+}
+
+
 /** Returns the number of time points for which results exist
  */
 
@@ -377,6 +496,9 @@ CvodeData_initialize(cvodeData_t *data, cvodeSettings_t *opt, odeModel_t *om, in
   /* evaluate event triggers and set flags with their initial state */
   for ( i=0; i<data->nevents; i++ )
     data->trigger[i] = evaluateAST(om->event[i], data);
+
+  /* and schedule time-only triggers */
+  CvodeData_scheduleEvents(data);
     
   /* RESULTS: Now we should have all variables, and can allocate the
      results structure, where the time series will be stored ...  */
@@ -538,6 +660,7 @@ static void CvodeData_freeStructures(cvodeData_t * data)
 
   /* free adjoint sensitivity */
   if ( data->adjvalue != NULL ) free(data->adjvalue );
+  if ( data->adjPrecond != NULL ) free(data->adjPrecond);
   
   /* free results structure */
   CvodeResults_free(data->results);
@@ -547,6 +670,14 @@ static void CvodeData_freeStructures(cvodeData_t * data)
   
   /* free event trigger flags */
   free(data->trigger);
+  EventQueue_free(data->eventQueue);
+
+  /* free interpolation state */
+  free_cursor(data->TimeSeriesCursor);
+
+  /* stop threads */
+  ODEPartition_free(data->partition);
+  ThreadPool_free(data->pool);
 
 }
 
@@ -46,6 +46,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <limits.h>
 
 /* Header Files for CVODE */
 #include <cvodes/cvodes.h>
@@ -58,16 +60,52 @@
 #include "sbmlsolver/solverError.h"
 #include "sbmlsolver/cvodeSolver.h"
 #include "sbmlsolver/sensSolver.h"
+#include "sbmlsolver/odePartition.h"
+#include "sbmlsolver/nvectorThreaded.h"
 
 #include "private/macro.h"
 
+/* automatic method switching (CvodeMethod 2): minimal number of steps
+   between two stiffness checks, maximal rate of convergence failures
+   of the functional iteration, and bounds of h*rho, the step size
+   times a bound of the Jacobian's spectral radius, above which Adams
+   is considered stability limited, and below which it is stable again */
+#define AUTO_MIN_STEPS 20
+#define AUTO_CONVFAIL 0.2
+#define AUTO_STIFF 0.5
+#define AUTO_NONSTIFF 0.05
+
+/* adjoint checkpointing with a memory budget: approximate sizes in
+   bytes of the bookkeeping of one checkpoint and of one interpolation
+   data point besides their vectors, and the number of steps per
+   output time assumed without other information */
+#define ADJ_CKPNT_OVERHEAD 256
+#define ADJ_DATA_OVERHEAD 32
+#define ADJ_STEPS_PER_OUTPUT 10
+
 static int fQ(realtype t, N_Vector y, N_Vector qdot, void *fQ_data);
 static int f(realtype t, N_Vector y, N_Vector ydot, void *f_data);
+static int fRoot(realtype t, N_Vector y, realtype *gout, void *g_data);
 static int JacODE(int N, realtype t,
 		  N_Vector y, N_Vector fy, DlsMat J, void *jac_data,
 		  N_Vector vtemp1, N_Vector vtemp2, N_Vector vtemp3);
+static int fThreaded(realtype t, N_Vector y, N_Vector ydot, void *f_data);
+static int JacThreaded(int N, realtype t,
+		       N_Vector y, N_Vector fy, DlsMat J, void *jac_data,
+		       N_Vector vtemp1, N_Vector vtemp2, N_Vector vtemp3);
+static int IntegratorInstance_createPartition(integratorInstance_t *);
 static void
 IntegratorInstance_freeQuadrature(integratorInstance_t *);
+static int IntegratorInstance_restartAtRoot(integratorInstance_t *);
+static int IntegratorInstance_cvodeTo(integratorInstance_t *, realtype tout,
+				      int dense, realtype *tstop, int *flag);
+static int IntegratorInstance_cvodeEventStop(integratorInstance_t *);
+static int IntegratorInstance_useAutoMethod(const integratorInstance_t *);
+static void IntegratorInstance_checkStiffness(integratorInstance_t *);
+static realtype IntegratorInstance_getSpectralBound(integratorInstance_t *);
+static int IntegratorInstance_getCVODECounters(void *, long int *);
+static void IntegratorInstance_saveCVODECounters(cvodeSolver_t *);
+static void IntegratorInstance_chooseCheckpoints(integratorInstance_t *);
 
 /** Calls CVODE to move the current simulation one time step.
 
@@ -80,13 +118,20 @@ to avoid the if statements in the wrapper function.
 
 SBML_ODESOLVER_API int IntegratorInstance_cvodeOneStep(integratorInstance_t *engine)
 {
-  int i, flag, CV_MODE = CV_NORMAL;
+  int i, flag, useTStop, dense;
+  realtype tevent, *tstop;
   realtype *ydata = NULL;
     
   cvodeSolver_t *solver = engine->solver;
   cvodeData_t *data = engine->data;
   cvodeSettings_t *opt = engine->opt;
   odeModel_t *om = engine->om;
+
+  /* automatic method switching: a new method requires
+     new solver structures */
+  if ( engine->isValid && !engine->AdjointPhase &&
+       IntegratorInstance_useAutoMethod(engine) )
+    IntegratorInstance_checkStiffness(engine);
   
   if ( !engine->isValid )
   { 
@@ -104,16 +149,10 @@ SBML_ODESOLVER_API int IntegratorInstance_cvodeOneStep(integratorInstance_t *eng
      keep the solver from integrating far ahead current
      time, this will however reduce integration speed, and
      might not be necessary in all cases */
-  /*!!! this is probably required for all RHS expressions which
-   can lead to discontinuities, AND !!! maybe this is only required
-   for those discontinuities which depend explicitly on time ??? 
-   an alternative to using the TSTOP mode might be to just update the
-   respective equations within this function!!! */
-  if ( opt->SetTStop || om->npiecewise )
-  {
-    CV_MODE = CV_NORMAL;
-    CVodeSetStopTime(solver->cvode_mem, solver->tout);
-  }  
+  /* piecewise expressions in the RHS are discontinuities, which
+     are located via root functions of their conditions if possible
+     (solver->nroots), and otherwise also require TSTOP mode */
+  useTStop = opt->SetTStop || (om->npiecewise && !solver->nroots);
 
   if (!engine->clockStarted)
   {
@@ -128,14 +167,50 @@ SBML_ODESOLVER_API int IntegratorInstance_cvodeOneStep(integratorInstance_t *eng
     {  
       /* CVodeF is needed in the forward phase if the adjoint soln is
 	 desired  */  
+      if ( useTStop )
+	CVodeSetStopTime(solver->cvode_mem, solver->tout);
       flag = CVodeF(solver->cvode_mem, solver->tout,
 		    solver->y, &(solver->t), CV_NORMAL, &(opt->ncheck));     
+      CVodeGetNumSteps(solver->cvode_mem, &(solver->nstF));
     }
     else
     {
-      /* calling CVODE */
-      flag = CVode(solver->cvode_mem, solver->tout,
-		   solver->y, &(solver->t), CV_MODE);
+      flag = CV_SUCCESS;
+      /* dense output: output times don't restrict the step size,
+	 unless the solver must stop there anyway */
+      dense = opt->DenseOutput && !useTStop;
+
+      /* stop exactly at the firing times of time-only event
+	 triggers before tout, and process events there */
+      while ( engine->processEvents &&
+	      IntegratorInstance_getNextEventTime(engine, &tevent) &&
+	      tevent < solver->tout )
+      {
+	if ( !IntegratorInstance_cvodeTo(engine, tevent, dense,
+					 &tevent, &flag) )
+	  return 0;
+	if ( flag < CV_SUCCESS )
+	  break;
+	if ( !IntegratorInstance_cvodeEventStop(engine) )
+	  return 0;
+      }
+
+      if ( flag >= CV_SUCCESS )
+      {
+	/* never step beyond tout in TSTOP mode, nor beyond the
+	   next event, an event firing at tout is processed as usual */
+	tstop = NULL;
+	if ( useTStop )
+	  tstop = &(solver->tout);
+	else if ( engine->processEvents &&
+		  IntegratorInstance_getNextEventTime(engine, &tevent) )
+	  tstop = &tevent;
+
+	/* calling CVODE */
+	if ( !IntegratorInstance_cvodeTo(engine, solver->tout, dense,
+					 tstop, &flag) )
+	  return 0;
+      }
     }
     
     
@@ -412,7 +487,7 @@ SBML_ODESOLVER_API int IntegratorInstance_cvodeOneStep(integratorInstance_t *eng
 int
 IntegratorInstance_createCVODESolverStructures(integratorInstance_t *engine)
 {
-  int i, flag, neq, method, iteration, quadReinit;
+  int i, flag, neq, method, iteration, quadReinit, cvodeMethod;
   odeModel_t *om = engine->om;
   odeSense_t *os = engine->os;
   cvodeData_t *data = engine->data;
@@ -469,23 +544,14 @@ IntegratorInstance_createCVODESolverStructures(integratorInstance_t *engine)
     neq = engine->om->neq; /* number of equations */
 
     /* get compiled functions ! */
-    if ( opt->compileFunctions )
-    {
-      /* this is currently the call leading to compilation
-	 of odeModel_t RHS functions ! */
-      rhsFunction = ODEModel_getCompiledCVODERHSFunction(om);
-      if ( !rhsFunction ) return 0; /* error */
-    }
-    else
-    {
-      rhsFunction = f ;
-#ifdef ARITHMETIC_TEST
-      fprintf(stderr, "\nWARNING: USING EXPERIMENTAL ONLINE COMPILER\n\n");
-#endif
-    }      
+    rhsFunction = IntegratorInstance_getRHSFunction(engine);
+    if ( !rhsFunction ) return 0; /* error */
+
     if ( engine->UseJacobian )
     {
-      if ( opt->compileFunctions )
+      if ( data->partition != NULL )
+	jacODE = JacThreaded;
+      else if ( opt->compileFunctions )
       { 
 
 	jacODE = ODEModel_getCompiledCVODEJacobianFunction(om); 
@@ -504,13 +570,21 @@ IntegratorInstance_createCVODESolverStructures(integratorInstance_t *engine)
      */
     if ( solver->y == NULL )
     {
-      solver->y = N_VNew_Serial(neq);
+      /* the vector operations of CVODES run on the threads
+	 of the partition, for clones of y */
+      if ( data->pool != NULL )
+	solver->y = N_VNew_Threaded(neq, data->pool);
+      else
+	solver->y = N_VNew_Serial(neq);
       CVODE_HANDLE_ERROR((void *)solver->y, "N_VNew_Serial for y", 0);
     }
 
     if ( solver->abstol == NULL )
     {
-      solver->abstol = N_VNew_Serial(neq);
+      if ( data->pool != NULL )
+	solver->abstol = N_VNew_Threaded(neq, data->pool);
+      else
+	solver->abstol = N_VNew_Serial(neq);
       CVODE_HANDLE_ERROR((void *)solver->abstol,
 			 "N_VNew_Serial for abstol", 0);
     }
@@ -541,19 +615,49 @@ IntegratorInstance_createCVODESolverStructures(integratorInstance_t *engine)
      * CV_NEWTON      Newton iteration method\n
      * CV_FUNCTIONAL  functional iteration method\n
      */
-    if ( opt->CvodeMethod == 1 ) method = CV_ADAMS;
-    else method = CV_BDF;
-    
-    if ( opt->IterMethod == 1 ) iteration = CV_FUNCTIONAL;
-    else iteration = CV_NEWTON;
+    if ( IntegratorInstance_useAutoMethod(engine) )
+    {
+      /* automatic switching: Adams-Moulton with functional iteration
+	 for non-stiff and BDF with Newton iteration for stiff phases */
+      cvodeMethod = !solver->stiff;
+      iteration = solver->stiff ? CV_NEWTON : CV_FUNCTIONAL;
+    }
+    else
+    {
+      cvodeMethod = opt->CvodeMethod == 1;
+      iteration = opt->IterMethod == 1 ? CV_FUNCTIONAL : CV_NEWTON;
+    }
+    method = cvodeMethod ? CV_ADAMS : CV_BDF;
+
+    /* collect statistics per method over a run, CVODES counters
+       are reset by CVodeReInit */
+    if ( solver->statsRun != engine->run )
+    {
+      for ( i=0; i<6; i++ )
+	solver->methodStats[0][i] = solver->methodStats[1][i] = 0;
+      solver->statsRun = engine->run;
+      solver->nstCheck = solver->ncfnCheck = 0;
+    }
+    else if ( solver->cvode_mem != NULL )
+      IntegratorInstance_saveCVODECounters(solver);
 
+    /* the method can't be changed on ReInit: create new
+       CVODES structures for a new method */
+    if ( solver->cvode_mem != NULL &&
+	 (solver->method != cvodeMethod || solver->iteration != iteration) )
+    {
+      IntegratorInstance_freeQuadrature(engine);
+      IntegratorInstance_freeForwardSensitivity(engine);
+      CVodeFree(&(solver->cvode_mem));
+      solver->cvode_mem = NULL;
+    }
 
-     /*!!? problem with ReInit: can't use new method !??
-       -> use additional methodIsValid option */
     if ( solver->cvode_mem == NULL )
     {
       solver->cvode_mem = CVodeCreate(method, iteration);
       CVODE_HANDLE_ERROR((void *)(solver->cvode_mem), "CVodeCreate", 0);
+      solver->method = cvodeMethod;
+      solver->iteration = iteration;
 
      /*!!! max. order should be set here, problem: "maxord affects the
        memory requirements for the internal cvodes memory block, its
@@ -602,6 +706,14 @@ IntegratorInstance_createCVODESolverStructures(integratorInstance_t *engine)
     flag = CVodeSetMaxNumSteps(solver->cvode_mem, opt->Mxstep);
     CVODE_HANDLE_ERROR(&flag, "CVodeSetMaxNumSteps", 1);   
 
+    /**
+     * Set the initial step size, e.g. of a restored snapshot,
+     * for this initialization only
+     */
+    flag = CVodeSetInitStep(solver->cvode_mem, solver->hin);
+    CVODE_HANDLE_ERROR(&flag, "CVodeSetInitStep", 1);
+    solver->hin = 0.0;
+
     /**
      * Link the main integrator with the CVDENSE linear solver
      */
@@ -689,10 +801,24 @@ IntegratorInstance_createCVODESolverStructures(integratorInstance_t *engine)
        calling CVodeF  */
     if ( opt->DoAdjoint )
     {
-      
-	  flag = CVodeAdjInit(solver->cvode_mem, opt->nSaveSteps, CV_HERMITE);
-	  CVODE_HANDLE_ERROR(&flag, "CVodeAdjInit", 0);
+      IntegratorInstance_chooseCheckpoints(engine);
+      flag = CVodeAdjInit(solver->cvode_mem, solver->nSaveSteps,
+			  solver->interpolation);
+      CVODE_HANDLE_ERROR(&flag, "CVodeAdjInit", 0);
     }
+
+    /* ROOT FUNCTIONS: let CVODES locate the switching times of
+       piecewise conditions, unless TSTOP mode is requested anyway,
+       some condition has no root function, or the restart at a root
+       would have to carry quadratures or adjoint checkpoints */
+    solver->nroots = 0;
+    if ( om->nroots && !om->npiecewiseUnrooted && !opt->SetTStop &&
+	 !opt->DoAdjoint && !solver->q && !solver->qS && !solver->qFIM )
+      solver->nroots = om->nroots;
+
+    flag = CVodeRootInit(solver->cvode_mem, solver->nroots,
+			 solver->nroots ? fRoot : NULL);
+    CVODE_HANDLE_ERROR(&flag, "CVodeRootInit", 1);
   } 
 
   /* ERROR HANDLING CODE if SensSolver construction failed */
@@ -702,6 +828,62 @@ IntegratorInstance_createCVODESolverStructures(integratorInstance_t *engine)
   return 1; /* OK */
 }
 
+/* returns the RHS function f(x,p,t) = dx/dt in the form used by CVODES,
+   compiled if requested, or NULL if compilation failed */
+CVRhsFn IntegratorInstance_getRHSFunction(integratorInstance_t *engine)
+{
+  CVRhsFn rhsFunction;
+
+  if ( engine->opt->nthreads < 0 || engine->opt->nthreads > 1 )
+  {
+    if ( !IntegratorInstance_createPartition(engine) )
+      return NULL;
+    return fThreaded;
+  }
+
+  if ( engine->opt->compileFunctions )
+    /* this is currently the call leading to compilation
+       of odeModel_t RHS functions ! */
+    rhsFunction = ODEModel_getCompiledCVODERHSFunction(engine->om);
+  else
+  {
+    rhsFunction = f ;
+#ifdef ARITHMETIC_TEST
+    fprintf(stderr, "\nWARNING: USING EXPERIMENTAL ONLINE COMPILER\n\n");
+#endif
+  }
+
+  return rhsFunction;
+}
+
+/* creates the thread pool and the partition of the model for the
+   threaded evaluation, see CvodeSettings_setThreads, compiled if
+   requested; returns 1 if successful or if they exist, 0 otherwise */
+static int IntegratorInstance_createPartition(integratorInstance_t *engine)
+{
+  cvodeData_t *data = engine->data;
+
+  if ( data->partition != NULL )
+    return 1;
+
+  data->pool = ThreadPool_create(engine->opt->nthreads);
+  if ( data->pool == NULL )
+    return 0;
+
+  data->partition = ODEPartition_create(engine->om, data->pool,
+					ODEPARTITION_MIN_COST);
+  if ( data->partition != NULL &&
+       (!engine->opt->compileFunctions ||
+	ODEModel_compilePartitionFunctions(engine->om, data->partition)) )
+    return 1;
+
+  ODEPartition_free(data->partition);
+  data->partition = NULL;
+  ThreadPool_free(data->pool);
+  data->pool = NULL;
+  return 0;
+}
+
 /* frees N_V vector structures, and the cvode_mem solver */
 static void IntegratorInstance_freeQuadrature(integratorInstance_t *engine)
 {
@@ -726,6 +908,355 @@ static void IntegratorInstance_freeQuadrature(integratorInstance_t *engine)
 
 }
 
+/* calls CVODE to integrate to tout, restarting at roots of piecewise
+   conditions on the way, and passes on the CVODE flag; CVODE doesn't
+   step beyond tstop, if given (tstop >= tout); with dense output CVODE
+   takes its own internal steps (CV_ONE_STEP) until it passes tout and
+   the solution at tout is interpolated from the step history (CVodeGetDky);
+   returns 0 if a restart failed, 1 otherwise */
+static int IntegratorInstance_cvodeTo(integratorInstance_t *engine,
+				      realtype tout, int dense,
+				      realtype *tstop, int *flag)
+{
+  int nsteps;
+  realtype tcur;
+  cvodeSolver_t *solver = engine->solver;
+
+  /* the last internal step already passed tout */
+  *flag = CVodeGetCurrentTime(solver->cvode_mem, &tcur);
+  if ( *flag == CV_SUCCESS && tcur >= tout )
+  {
+    *flag = CVodeGetDky(solver->cvode_mem, tout, 0, solver->y);
+    solver->t = tout;
+    return 1;
+  }
+
+  if ( tstop != NULL )
+    CVodeSetStopTime(solver->cvode_mem, *tstop);
+
+  if ( !dense )
+  {
+    *flag = CVode(solver->cvode_mem, tout,
+		  solver->y, &(solver->t), CV_NORMAL);
+
+    /* a piecewise condition switched: restart CVODES at the
+       discontinuity and continue to tout; an outdated stop time
+       before tout has been cleared upon return */
+    while ( *flag == CV_ROOT_RETURN ||
+	    (*flag == CV_TSTOP_RETURN && solver->t < tout) )
+    {
+      if ( *flag == CV_ROOT_RETURN &&
+	   !IntegratorInstance_restartAtRoot(engine) )
+	return 0;
+      *flag = CVode(solver->cvode_mem, tout,
+		    solver->y, &(solver->t), CV_NORMAL);
+    }
+
+    return 1;
+  }
+
+  /* dense output: single internal steps, Mxstep now limits the
+     number of steps between output times here */
+  nsteps = 0;
+  tcur = solver->t;
+  while ( tcur < tout )
+  {
+    if ( nsteps++ >= engine->opt->Mxstep )
+    {
+      *flag = CV_TOO_MUCH_WORK;
+      return 1;
+    }
+    *flag = CVode(solver->cvode_mem, tout,
+		  solver->y, &(solver->t), CV_ONE_STEP);
+    if ( *flag < CV_SUCCESS )
+      return 1;
+    if ( *flag == CV_ROOT_RETURN &&
+	 !IntegratorInstance_restartAtRoot(engine) )
+      return 0;
+    tcur = solver->t;
+  }
+
+  *flag = CVodeGetDky(solver->cvode_mem, tout, 0, solver->y);
+  solver->t = tout;
+
+  return 1;
+}
+
+/* processes events at the firing time of a time-only trigger, where
+   CVODES has been stopped between output times, and restarts CVODES
+   if the events changed the ODE system; returns 1 if the integration
+   can continue, 0 otherwise */
+static int IntegratorInstance_cvodeEventStop(integratorInstance_t *engine)
+{
+  int i;
+  cvodeSolver_t *solver = engine->solver;
+  cvodeData_t *data = engine->data;
+
+  data->currenttime = solver->t;
+  for ( i=0; i<engine->om->neq; i++ )
+    data->value[i] = NV_Ith_S(solver->y, i);
+
+  /* current sensitivities are the initial values after a restart */
+  if ( engine->opt->Sensitivity )
+    if ( IntegratorInstance_getForwardSens(engine) != CV_SUCCESS )
+      return 0;
+
+  data->allRulesUpdated = 0;
+  if ( !IntegratorInstance_handleEvents(engine) )
+    return 0;
+
+  if ( !engine->isValid )
+  {
+    solver->t0 = solver->t;
+    if ( !IntegratorInstance_createCVODESolverStructures(engine) )
+      return 0;
+  }
+
+  return 1;
+}
+
+/* restarts CVODES at a root of a piecewise condition returned in
+   solver->t and solver->y, such that no step is taken across the
+   discontinuity, forward sensitivities are carried over */
+static int IntegratorInstance_restartAtRoot(integratorInstance_t *engine)
+{
+  int flag, sensMethod;
+  realtype t;
+  cvodeSolver_t *solver = engine->solver;
+  cvodeSettings_t *opt = engine->opt;
+
+  if ( opt->Sensitivity && solver->yS != NULL )
+  {
+    flag = CVodeGetSens(solver->cvode_mem, &t, solver->yS);
+    CVODE_HANDLE_ERROR(&flag, "CVodeGetSens", 1);
+  }
+
+  IntegratorInstance_saveCVODECounters(solver);
+  flag = CVodeReInit(solver->cvode_mem, solver->t, solver->y);
+  CVODE_HANDLE_ERROR(&flag, "CVodeReInit", 1);
+
+  if ( opt->Sensitivity && solver->yS != NULL )
+  {
+    sensMethod = CV_SIMULTANEOUS;
+    if ( opt->SensMethod == 1 ) sensMethod = CV_STAGGERED;
+    else if ( opt->SensMethod == 2 ) sensMethod = CV_STAGGERED1;
+
+    flag = CVodeSensReInit(solver->cvode_mem, sensMethod, solver->yS);
+    CVODE_HANDLE_ERROR(&flag, "CVodeSensReInit", 1);
+  }
+
+  return 1;
+}
+
+/* automatic method switching is requested and possible, i.e. no
+   quadratures or adjoint checkpoints need to be carried over to new
+   solver structures */
+static int IntegratorInstance_useAutoMethod(const integratorInstance_t *engine)
+{
+  cvodeSettings_t *opt = engine->opt;
+  odeModel_t *om = engine->om;
+
+  return opt->CvodeMethod == 2 && !opt->DoAdjoint &&
+    om->ObjectiveFunction == NULL &&
+    !(opt->Sensitivity && (opt->doFIM || om->vector_v != NULL));
+}
+
+/* LSODA-style stiffness detection at output times: switches from
+   Adams-Moulton to BDF when the functional iteration fails to converge
+   or the step size is limited by stability, and back when Adams would
+   be stable at the current step size or, without Jacobian matrix, when
+   BDF takes steps not much larger than Adams did; a switch invalidates
+   the solver structures, which are then recreated at the current time */
+static void IntegratorInstance_checkStiffness(integratorInstance_t *engine)
+{
+  int stiff;
+  long int nst, nni, ncfn;
+  realtype h, rho;
+  cvodeSolver_t *solver = engine->solver;
+
+  if ( CVodeGetNumSteps(solver->cvode_mem, &nst) != CV_SUCCESS ||
+       CVodeGetNonlinSolvStats(solver->cvode_mem, &nni, &ncfn) != CV_SUCCESS ||
+       CVodeGetCurrentStep(solver->cvode_mem, &h) != CV_SUCCESS )
+    return;
+
+  /* too few steps since the last check */
+  if ( nst - solver->nstCheck < AUTO_MIN_STEPS )
+    return;
+
+  rho = IntegratorInstance_getSpectralBound(engine);
+  stiff = solver->stiff;
+
+  if ( !solver->stiff )
+  {
+    if ( ncfn - solver->ncfnCheck > AUTO_CONVFAIL*(nst - solver->nstCheck) ||
+	 (rho >= 0.0 && h*rho > AUTO_STIFF) )
+      stiff = 1;
+  }
+  else if ( rho >= 0.0 ? h*rho < AUTO_NONSTIFF : h < 2.0*solver->hAdams )
+    stiff = 0;
+
+  solver->nstCheck = nst;
+  solver->ncfnCheck = ncfn;
+
+  if ( stiff != solver->stiff )
+  {
+    if ( stiff )
+      solver->hAdams = h;
+    solver->stiff = stiff;
+    solver->nswitch++;
+    engine->isValid = 0;
+  }
+}
+
+/* returns a bound of the spectral radius of the Jacobian matrix at the
+   current values (Gershgorin's circles), or -1 if no Jacobian matrix
+   is available */
+static realtype IntegratorInstance_getSpectralBound(integratorInstance_t *engine)
+{
+  int i;
+  realtype rho, *rowsum;
+  nonzeroElem_t *nonzero;
+  odeModel_t *om = engine->om;
+
+  if ( !engine->UseJacobian )
+    return -1.0;
+
+  ASSIGN_NEW_MEMORY_BLOCK(rowsum, om->neq, realtype, -1.0);
+  for ( i=0; i<om->sparsesize; i++ )
+  {
+    nonzero = om->jacobSparse[i];
+    rowsum[nonzero->i] += fabs(evaluateAST(nonzero->ij, engine->data));
+  }
+
+  rho = 0.0;
+  for ( i=0; i<om->neq; i++ )
+    if ( rowsum[i] > rho )
+      rho = rowsum[i];
+  free(rowsum);
+
+  return rho;
+}
+
+/* writes nst, nfe, nni, ncfn, netf and nje of the CVODES structures
+   cvode_mem to counters, returns 1 on success and 0 otherwise */
+static int IntegratorInstance_getCVODECounters(void *cvode_mem,
+					       long int *counters)
+{
+  if ( CVodeGetNumSteps(cvode_mem, &counters[0]) != CV_SUCCESS ||
+       CVodeGetNumRhsEvals(cvode_mem, &counters[1]) != CV_SUCCESS ||
+       CVodeGetNonlinSolvStats(cvode_mem, &counters[2],
+			       &counters[3]) != CV_SUCCESS ||
+       CVodeGetNumErrTestFails(cvode_mem, &counters[4]) != CV_SUCCESS ||
+       CVDlsGetNumJacEvals(cvode_mem, &counters[5]) != CVDLS_SUCCESS )
+    return 0;
+  return 1;
+}
+
+/* adds the CVODES counters to the statistics of the current method,
+   before CVodeReInit or a new method resets them */
+static void IntegratorInstance_saveCVODECounters(cvodeSolver_t *solver)
+{
+  int i;
+  long int counters[6];
+
+  if ( IntegratorInstance_getCVODECounters(solver->cvode_mem, counters) )
+    for ( i=0; i<6; i++ )
+      solver->methodStats[solver->method][i] += counters[i];
+
+  solver->nstCheck = solver->ncfnCheck = 0;
+}
+
+/* chooses the number of steps between checkpoints and the
+   interpolation type of the forward phase of the adjoint solver:
+   the largest spacing, i.e. the fewest checkpoints to restart from
+   in the backward phase, whose memory fits into the budget opt->AdjMemory for the
+   expected number of steps; without a budget, opt->nSaveSteps with
+   Hermite interpolation */
+static void IntegratorInstance_chooseCheckpoints(integratorInstance_t *engine)
+{
+  int i, interpolation[2];
+  double nst, nd, ck, dt, b, disc;
+  cvodeSolver_t *solver = engine->solver;
+  cvodeSettings_t *opt = engine->opt;
+
+  solver->nSaveSteps = opt->nSaveSteps;
+  solver->interpolation = CV_HERMITE;
+  if ( opt->AdjMemory <= 0.0 )
+    return;
+
+  /* expected number of forward steps */
+  if ( opt->AdjExpectedSteps > 0 )
+    nst = opt->AdjExpectedSteps;
+  else if ( solver->nstF > 0 )
+    nst = solver->nstF;
+  else
+    nst = ADJ_STEPS_PER_OUTPUT * (opt->PrintStep > 0 ? opt->PrintStep : 1);
+
+  /* Hermite interpolation is preferred for BDF (stiff problems),
+     the higher order polynomial interpolation for Adams-Moulton */
+  interpolation[0] = solver->method ? CV_POLYNOMIAL : CV_HERMITE;
+  interpolation[1] = CV_POLYNOMIAL;
+
+  /* memory(nd) = (nst/nd)*C + (nd+1)*D <= AdjMemory, where C and D
+     are the sizes of a checkpoint and of an interpolation data point,
+     has the largest solution nd = (b + sqrt(b^2 - 4*D*nst*C))/(2*D) */
+  ck = IntegratorInstance_getCheckpointMemory(engine, 1, 0, 0);
+  for ( i=0; i<2; i++ )
+  {
+    /* memory of one data point: that of nd=1 without 2 points */
+    dt = IntegratorInstance_getCheckpointMemory(engine, 0, 1,
+						interpolation[i]) / 2.0;
+    b = opt->AdjMemory - dt;
+    disc = b*b - 4.0*dt*nst*ck;
+    if ( b > 0.0 && disc >= 0.0 )
+    {
+      nd = (b + sqrt(disc)) / (2.0*dt);
+      solver->interpolation = interpolation[i];
+      break;
+    }
+  }
+
+  if ( i == 2 )
+  {
+    /* minimal memory, exceeding the budget */
+    solver->interpolation = CV_POLYNOMIAL;
+    nd = sqrt(nst * ck / dt);
+    SolverError_error(WARNING_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "The adjoint memory budget of %g bytes is too small "
+		      "for %g forward steps, at least %g bytes will be used.",
+		      opt->AdjMemory, nst,
+		      IntegratorInstance_getCheckpointMemory(engine,
+			(int) ceil(nst/nd), (int) nd, CV_POLYNOMIAL));
+  }
+
+  /* no more steps between checkpoints than expected at all */
+  if ( nd > nst )
+    nd = nst;
+  solver->nSaveSteps = nd < 1.0 ? 1 : (nd > INT_MAX ? INT_MAX : (int) nd);
+}
+
+
+/* estimates the memory in bytes of ncheck checkpoints and the
+   interpolation data of nd steps for the adjoint solver */
+double IntegratorInstance_getCheckpointMemory(const integratorInstance_t *engine, int ncheck, int nd, int interpolation)
+{
+  int neq, qmax;
+  double ck, dt;
+
+  neq = engine->om->neq;
+  /* a checkpoint holds the Nordsieck history array of up to the
+     maximum order, Adams-Moulton: 12, BDF: 5 */
+  qmax = engine->solver->method ? 12 : 5;
+  ck = (qmax + 2) * neq * sizeof(realtype) + ADJ_CKPNT_OVERHEAD;
+  /* Hermite interpolation stores x and dx/dt, polynomial only x */
+  dt = (interpolation == CV_HERMITE ? 2 : 1) * neq * sizeof(realtype) +
+    ADJ_DATA_OVERHEAD;
+
+  return ncheck * ck + (nd > 0 ? nd + 1 : 0) * dt;
+}
+
+
 /* frees N_V vector structures, and the cvode_mem solver */
 void IntegratorInstance_freeCVODESolverStructures(integratorInstance_t *engine)
 {
@@ -850,8 +1381,8 @@ void IntegratorInstance_freeAdjointSensitivity(integratorInstance_t *engine)
 
 SBML_ODESOLVER_API int IntegratorInstance_printCVODEStatistics(const integratorInstance_t *engine, FILE *f)
 {
-  int flag;
-  long int nst, nfe, nsetups, nje, nni, ncfn, netf;
+  int i, m, flag;
+  long int nst, nfe, nsetups, nje, nni, ncfn, netf, counters[6];
 
   cvodeSettings_t *opt = engine->opt;
   cvodeSolver_t *solver = engine->solver;
@@ -882,6 +1413,32 @@ SBML_ODESOLVER_API int IntegratorInstance_printCVODEStatistics(const integratorI
 	  nst, nfe, nsetups, nje); 
   fprintf(f, "## nni = %-6ld ncfn = %-6ld netf = %ld\n",
 	  nni, ncfn, netf);
+
+  /* statistics of the whole run per method, including
+     former (re)initializations */
+  if ( opt->CvodeMethod == 2 )
+  {
+    fprintf(f, "## Automatic Method Switching: %d switches\n",
+	    solver->nswitch);
+    for ( m=0; m<2; m++ )
+    {
+      for ( i=0; i<6; i++ )
+	counters[i] = solver->methodStats[m][i];
+      if ( m == solver->method )
+      {
+	counters[0] += nst;
+	counters[1] += nfe;
+	counters[2] += nni;
+	counters[3] += ncfn;
+	counters[4] += netf;
+	counters[5] += nje;
+      }
+      fprintf(f, "## %-5s nst = %-6ld nfe = %-6ld nni = %-6ld "
+	      "ncfn = %-6ld netf = %-6ld nje = %ld\n", m ? "ADAMS" : "BDF",
+	      counters[0], counters[1], counters[2],
+	      counters[3], counters[4], counters[5]);
+    }
+  }
     
   if ((opt->Sensitivity) | (opt->DoAdjoint))
     return(IntegratorInstance_printCVODESStatistics(engine, f));
@@ -1034,6 +1591,48 @@ static int f(realtype t, N_Vector y, N_Vector ydot, void *f_data)
   return (0);
 }
 
+/**
+   Root function: g(t,x) = a - b for the conditions a op b of
+   piecewise expressions in the ODE system.
+
+   This function is called by CVODE's root finding, which thus
+   locates the time where a condition switches, i.e. where the
+   right hand side of the ODE system is discontinuous.
+*/
+
+static int fRoot(realtype t, N_Vector y, realtype *gout, void *g_data)
+{
+  int i;
+  realtype *ydata;
+  cvodeData_t *data;
+  data  = (cvodeData_t *) g_data;
+  ydata = NV_DATA_S(y);
+
+  /* update time  */
+  data->currenttime = t;
+
+  /** UPDATE ODE VARIABLES from CVODE */
+  for ( i=0; i<data->model->neq; i++ ) 
+    data->value[i] = ydata[i];
+
+  /** UPDATE ASSIGNMENT RULES, the conditions can depend on all */
+  for ( i=0; i<data->model->nass; i++ )
+  {
+    nonzeroElem_t *ordered = data->model->assignmentOrder[i];
+#ifdef ARITHMETIC_TEST
+    data->value[ordered->i] = ordered->ijcode->evaluate(data);    
+#else
+    data->value[ordered->i] = evaluateAST(ordered->ij, data);
+#endif    
+  }
+
+  /** evaluate root functions */
+  for ( i=0; i<data->model->nroots; i++ )
+    gout[i] = evaluateAST(data->model->root[i], data);
+
+  return (0);
+}
+
 /**
    Jacobian routine: Compute J(t,x) = df/dx
    
@@ -1089,6 +1688,75 @@ static int JacODE(int N, realtype t,
 }
 
 
+/**
+   Threaded f routine: Compute f(t,x) = df/dx with the threads of the
+   partition of the model in cvodeData, level by level for the
+   assignment rules and then for the ODEs, as the f routine does
+   serially, which is used when p is modified by CVODES.
+*/
+
+static int fThreaded(realtype t, N_Vector y, N_Vector ydot, void *f_data)
+{
+  int i;
+  realtype *ydata;
+  cvodeData_t *data;
+  data  = (cvodeData_t *) f_data;
+  ydata = NV_DATA_S(y);
+
+  if ( data->use_p )
+    return f(t, y, ydot, f_data);
+
+  /* update time  */
+  data->currenttime = t;
+
+  /** UPDATE ODE VARIABLES from CVODE */
+  for ( i=0; i<data->model->neq; i++ )
+    data->value[i] = ydata[i];
+
+  /** check whether any variables are negative */
+  if ( data->opt->DetectNegState  )
+    for ( i=0; i<data->model->neq; i++ )
+      if (data->value[i] < 0)
+	return (1);
+
+  ODEPartition_evaluateRules(data->partition, data);
+  ODEPartition_evaluateODEs(data->partition, data, NV_DATA_S(ydot));
+
+  return (0);
+}
+
+/**
+   Threaded Jacobian routine: Compute J(t,x) = df/dx with the threads
+   of the partition of the model in cvodeData, see JacODE, which is
+   used when p is modified by CVODES or the Jacobian was constructed
+   after the partition.
+*/
+
+static int JacThreaded(int N, realtype t,
+		       N_Vector y, N_Vector fy, DlsMat J, void *jac_data,
+		       N_Vector vtemp1, N_Vector vtemp2, N_Vector vtemp3)
+{
+  int i;
+  realtype *ydata;
+  cvodeData_t *data;
+  data  = (cvodeData_t *) jac_data;
+  ydata = NV_DATA_S(y);
+
+  if ( data->use_p || !data->partition->jacobian )
+    return JacODE(N, t, y, fy, J, jac_data, vtemp1, vtemp2, vtemp3);
+
+  /** update ODE variables from CVODE */
+  for ( i=0; i<data->model->neq; i++ ) data->value[i] = ydata[i];
+
+  /** update time */
+  data->currenttime = t;
+
+  /** evaluate Jacobian J = df/dx */
+  ODEPartition_evaluateJacobian(data->partition, data, J->cols);
+
+  return (0);
+}
+
 
 static int fQ(realtype t, N_Vector y, N_Vector qdot, void *fQ_data)
 {
@@ -1110,7 +1778,7 @@ static int fQ(realtype t, N_Vector y, N_Vector qdot, void *fQ_data)
   data->currenttime = t;
 
   /* only the first component matters */
-  dqdata[0] = evaluateAST(engine->om->ObjectiveFunction, data);
+  dqdata[0] = CvodeData_evaluateObjective(data);
 
   return (0);
 }
@@ -207,6 +207,8 @@ IntegratorInstance_createIDASolverStructures(integratorInstance_t *engine)
 {
   int i, flag, neq, nalg;
   realtype *ydata, *abstoldata, *dydata;
+  IDAResFn resFunction = fRes;
+  IDADlsDenseJacFn jacFunction = JacRes;
   
   odeModel_t *om = engine->om;
   cvodeData_t *data = engine->data;
@@ -231,6 +233,19 @@ IntegratorInstance_createIDASolverStructures(integratorInstance_t *engine)
     engine->UseJacobian = om->jacobian;
   }
   /* construct algebraic `Jacobian' (or do that in constructJacobian */
+
+  /* get compiled functions, the jacobian might have been
+     constructed after the model code had been compiled */
+  if ( opt->compileFunctions )
+  {
+    if ( !om->compiledIDAResidualFunction ||
+	 (engine->UseJacobian && !om->compiledIDAJacobianFunction) )
+      if ( !ODEModel_compileCVODEFunctions(om) )
+	return 0; /* error */
+    resFunction = om->compiledIDAResidualFunction;
+    if ( engine->UseJacobian )
+      jacFunction = om->compiledIDAJacobianFunction;
+  }
   
   /* CVODESolverStructures from former runs must be freed */
   if ( engine->run > 1 )
@@ -287,7 +302,7 @@ IntegratorInstance_createIDASolverStructures(integratorInstance_t *engine)
    * y          the dependent variable vector
    * dy         the ODE value vector
    */
-  flag = IDAInit(solver->cvode_mem, fRes, solver->t0, solver->y,
+  flag = IDAInit(solver->cvode_mem, resFunction, solver->t0, solver->y,
                  solver->dy);
   CVODE_HANDLE_ERROR(&flag, "IDAInit", 1);
   /*
@@ -315,10 +330,10 @@ IntegratorInstance_createIDASolverStructures(integratorInstance_t *engine)
    * Set the routine used by the IDADense linear solver
    * to approximate the Jacobian matrix to ...
    */
-  if ( opt->UseJacobian == 1 ) {
+  if ( engine->UseJacobian == 1 ) {
     /* ... user-supplied routine JacRes : put JacRes instead of NULL
        when working */
-    flag = IDADlsSetDenseJacFn(solver->cvode_mem, JacRes);
+    flag = IDADlsSetDenseJacFn(solver->cvode_mem, jacFunction);
     CVODE_HANDLE_ERROR(&flag, "IDADlsSetDenseJacFn", 1);
   }
      
@@ -0,0 +1,409 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup ensemble Ensemble Integration:  x(t) of W Parameter Sets
+  \ingroup integrator
+  \brief This module contains an integrator for W runs of the same
+  model with different parameter values or initial conditions
+  (lanes), which are advanced in lockstep.
+
+  All values are stored lane-contiguous, such that the compiled
+  ODEs evaluate each equation for all lanes in one loop, which the
+  compiler vectorizes. The lanes share the step size of the embedded
+  Runge-Kutta 5(4) pair of Dormand and Prince of the built-in RK45
+  solver, which is controlled by the largest error of all lanes. The results of each lane are stored
+  in a cvodeResults structure. Models with events are not supported.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <nvector/nvector_serial.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/processAST.h"
+#include "sbmlsolver/odeModel.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/rkSolver.h"
+#include "sbmlsolver/ensembleSolver.h"
+
+static int EnsembleSolver_rhs(realtype t, N_Vector y, N_Vector dy,
+			      void *ens);
+static void EnsembleSolver_updateAssignments(ensembleSolver_t *);
+static void EnsembleSolver_storeResults(ensembleSolver_t *);
+
+
+/** Creates an ensemble of `nlanes' integration runs of the model
+    with the passed settings, all lanes start from the initial values
+    of the model.
+
+    The ODEs and assignment rules of all lanes are compiled, if
+    compilation is requested via CvodeSettings_setCompileFunctions.
+    Returns NULL for models with events or algebraic cycles, for
+    indefinite integration and on failures.
+*/
+
+SBML_ODESOLVER_API ensembleSolver_t *EnsembleSolver_create(odeModel_t *om, cvodeSettings_t *opt, int nlanes)
+{
+  int i, l;
+  ensembleSolver_t *ens;
+
+  if ( nlanes < 1 )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Ensemble integration requires at least one lane, "
+		      "%d requested.", nlanes);
+    return NULL;
+  }
+  if ( om->nevents > 0 || om->hasCycle )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Ensemble integration is not available for models "
+		      "with events or algebraic cycles.");
+    return NULL;
+  }
+  if ( opt->Indefinitely )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Ensemble integration requires output times, "
+		      "indefinite integration is not supported.");
+    return NULL;
+  }
+
+  ASSIGN_NEW_MEMORY(ens, struct ensembleSolver, NULL);
+  ens->om = om;
+  ens->opt = opt;
+  ens->nlanes = nlanes;
+  ens->neq = om->neq;
+
+  ens->data = CvodeData_create(om);
+  if ( ens->data == NULL || !CvodeData_initialize(ens->data, opt, om, 0) )
+  {
+    EnsembleSolver_free(ens);
+    return NULL;
+  }
+  ens->nvalues = ens->data->nvalues;
+
+  /* at least one element, also for models without ODEs */
+  ASSIGN_NEW_MEMORY_BLOCK(ens->initialValue, ens->nvalues+1, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(ens->value, nlanes*ens->nvalues+1, double, NULL);
+
+  ens->rk = RKSolver_create(ens->neq, nlanes);
+  if ( ens->rk == NULL )
+  {
+    EnsembleSolver_free(ens);
+    return NULL;
+  }
+  ens->rk->method = 3;
+  ens->rk->rhs = EnsembleSolver_rhs;
+
+  ASSIGN_NEW_MEMORY_BLOCK(ens->results, nlanes, cvodeResults_t *, NULL);
+  for ( l=0; l<nlanes; l++ )
+  {
+    ens->results[l] = CvodeResults_create(ens->data, opt->PrintStep);
+    if ( ens->results[l] == NULL )
+    {
+      EnsembleSolver_free(ens);
+      return NULL;
+    }
+  }
+
+  if ( opt->compileFunctions )
+  {
+    if ( !ODEModel_compileEnsembleFunctions(om) )
+    {
+      EnsembleSolver_free(ens);
+      return NULL;
+    }
+    ens->rhs = om->compiledEnsembleRhsFunction;
+    ens->assignment = om->compiledEnsembleAssignmentFunction;
+  }
+
+  for ( i=0; i<ens->nvalues; i++ )
+    ens->initialValue[i] = ens->data->value[i];
+  EnsembleSolver_reset(ens);
+
+  return ens;
+}
+
+
+/** Resets all lanes to the initial values of the model and the
+    initial time, the statistics are kept
+*/
+
+SBML_ODESOLVER_API void EnsembleSolver_reset(ensembleSolver_t *ens)
+{
+  int i, l, W = ens->nlanes;
+
+  for ( i=0; i<ens->nvalues; i++ )
+    for ( l=0; l<W; l++ )
+      ens->value[W*i+l] = ens->initialValue[i];
+
+  for ( l=0; l<W; l++ )
+    ens->results[l]->nout = 0;
+
+  ens->t = ens->opt->TimePoints[0];
+  ens->rk->h = 0.0;
+  ens->iout = 0;
+}
+
+
+/** Sets the value of a variable or parameter in one lane.
+
+    Values can be set before the integration of the ensemble starts,
+    after creation or after EnsembleSolver_reset. Returns 1 on
+    success and 0 for assigned variables or invalid lanes.
+*/
+
+SBML_ODESOLVER_API int EnsembleSolver_setValue(ensembleSolver_t *ens, variableIndex_t *vi, int lane, double value)
+{
+  odeModel_t *om = ens->om;
+
+  if ( lane < 0 || lane >= ens->nlanes )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Lane %d does not exist in an ensemble of %d lanes.",
+		      lane, ens->nlanes);
+    return 0;
+  }
+  if ( vi->index >= om->neq && vi->index < om->neq+om->nass )
+  {
+    SolverError_error(WARNING_ERROR_TYPE,
+		      SOLVER_ERROR_ATTEMPT_TO_SET_ASSIGNED_VALUE,
+		      "Attempted to set a new value for an assigned "
+		      "variable: %s. This is not possible. New value ignored!",
+		      om->names[vi->index]);
+    return 0;
+  }
+
+  ens->value[ens->nlanes*vi->index+lane] = value;
+  return 1;
+}
+
+
+/** Returns the current value of a variable or parameter in one lane
+*/
+
+SBML_ODESOLVER_API double EnsembleSolver_getValue(const ensembleSolver_t *ens, variableIndex_t *vi, int lane)
+{
+  return ens->value[ens->nlanes*vi->index+lane];
+}
+
+
+/** Integrates all lanes from the initial time over all output times
+    of the settings and stores the results of each lane.
+
+    Returns 1 on success and 0 on failure, when the results contain
+    the output times reached so far.
+*/
+
+SBML_ODESOLVER_API int EnsembleSolver_integrate(ensembleSolver_t *ens)
+{
+  int i, n = ens->nlanes*ens->neq;
+  cvodeSettings_t *opt = ens->opt;
+  rkSolver_t *rk = ens->rk;
+
+  if ( ens->iout == 0 )
+  {
+    EnsembleSolver_updateAssignments(ens);
+    EnsembleSolver_storeResults(ens);
+    for ( i=0; i<n; i++ )
+      rk->y[i] = ens->value[i];
+    rk->f0Valid = 0;
+  }
+
+  while ( ens->iout < opt->PrintStep )
+  {
+    if ( !RKSolver_integrateTo(rk, opt, &ens->t,
+			       opt->TimePoints[ens->iout+1], ens) )
+      return 0;
+
+    ens->iout++;
+    for ( i=0; i<n; i++ )
+      ens->value[i] = rk->y[i];
+    EnsembleSolver_updateAssignments(ens);
+    EnsembleSolver_storeResults(ens);
+  }
+
+  return 1;
+}
+
+
+/** Returns the results of one lane
+*/
+
+SBML_ODESOLVER_API const cvodeResults_t *EnsembleSolver_getResults(const ensembleSolver_t *ens, int lane)
+{
+  if ( lane < 0 || lane >= ens->nlanes )
+    return NULL;
+  return ens->results[lane];
+}
+
+
+/** Prints some final statistics of the ensemble integration
+*/
+
+SBML_ODESOLVER_API void EnsembleSolver_printStatistics(const ensembleSolver_t *ens, FILE *f)
+{
+  cvodeSettings_t *opt = ens->opt;
+
+  fprintf(f, "\n## Integration Parameters:\n");
+  fprintf(f, "## mxstep   = %d rel.err. = %g abs.err. = %g \n",
+	  opt->Mxstep, opt->RError, opt->Error);
+  fprintf(f, "## Ensemble Statistics (%d lanes, %s):\n", ens->nlanes,
+	  ens->rhs != NULL ? "compiled" : "interpreted");
+  fprintf(f, "## nst = %-6ld nfe  = %-6ld netf = %ld\n",
+	  ens->rk->nst, ens->rk->nfe, ens->rk->netf);
+}
+
+
+/** Frees the ensemble and its results, but not the model and the
+    settings
+*/
+
+SBML_ODESOLVER_API void EnsembleSolver_free(ensembleSolver_t *ens)
+{
+  int l;
+
+  if ( ens == NULL )
+    return;
+
+  if ( ens->results != NULL )
+  {
+    for ( l=0; l<ens->nlanes; l++ )
+      if ( ens->results[l] != NULL )
+	CvodeResults_free(ens->results[l]);
+    free(ens->results);
+  }
+  free(ens->initialValue);
+  free(ens->value);
+  RKSolver_free(ens->rk);
+  if ( ens->data != NULL )
+    CvodeData_free(ens->data);
+  free(ens);
+}
+
+
+/************* internal functions ************/
+
+/* evaluates the ODEs of all lanes at time t, either by the compiled
+   ensemble function or lane by lane via the interpreted equations;
+   the RHS function of the RK45 solver of the ensemble */
+static int EnsembleSolver_rhs(realtype t, N_Vector yv, N_Vector dyv,
+			      void *user_data)
+{
+  int i, j, l;
+  ensembleSolver_t *ens = user_data;
+  int W = ens->nlanes;
+  odeModel_t *om = ens->om;
+  cvodeData_t *data = ens->data;
+  nonzeroElem_t *ordered;
+  realtype *y = NV_DATA_S(yv), *dy = NV_DATA_S(dyv);
+
+  if ( ens->rhs != NULL )
+  {
+    ens->rhs(W, t, data, ens->value, y, dy);
+    return 0;
+  }
+
+  data->currenttime = t;
+  for ( l=0; l<W; l++ )
+  {
+    for ( j=0; j<ens->nvalues; j++ )
+      data->value[j] = ens->value[W*j+l];
+    for ( i=0; i<ens->neq; i++ )
+      data->value[i] = y[W*i+l];
+    for ( i=0; i<om->nassbeforeodes; i++ )
+    {
+      ordered = om->assignmentsBeforeODEs[i];
+      data->value[ordered->i] = evaluateAST(ordered->ij, data);
+    }
+    for ( i=0; i<ens->neq; i++ )
+      dy[W*i+l] = evaluateAST(om->ode[i], data);
+  }
+
+  return 0;
+}
+
+
+/* evaluates all assignment rules of all lanes at the current time */
+static void EnsembleSolver_updateAssignments(ensembleSolver_t *ens)
+{
+  int i, j, l, W = ens->nlanes;
+  odeModel_t *om = ens->om;
+  cvodeData_t *data = ens->data;
+  nonzeroElem_t *ordered;
+
+  data->currenttime = ens->t;
+
+  if ( ens->assignment != NULL )
+  {
+    ens->assignment(W, data, ens->value);
+    return;
+  }
+
+  for ( l=0; l<W; l++ )
+  {
+    for ( j=0; j<ens->nvalues; j++ )
+      data->value[j] = ens->value[W*j+l];
+    for ( i=0; i<om->nass; i++ )
+    {
+      ordered = om->assignmentOrder[i];
+      data->value[ordered->i] = evaluateAST(ordered->ij, data);
+      ens->value[W*ordered->i+l] = data->value[ordered->i];
+    }
+  }
+}
+
+
+/* stores time and values of all lanes at output step iout */
+static void EnsembleSolver_storeResults(ensembleSolver_t *ens)
+{
+  int j, l, W = ens->nlanes;
+  cvodeResults_t *results;
+
+  for ( l=0; l<W; l++ )
+  {
+    results = ens->results[l];
+    results->nout = ens->iout;
+    results->time[ens->iout] = ens->t;
+    for ( j=0; j<ens->nvalues; j++ )
+      results->value[j][ens->iout] = ens->value[W*j+l];
+  }
+}
+
+
+/*! @} */
+/* End of file */
@@ -106,10 +106,8 @@ SBML_ODESOLVER_API void setUserDefinedFunction(double(*udf)(char*, int, double*)
 SBML_ODESOLVER_API double evaluateAST(ASTNode_t *n, cvodeData_t *data)
 {
   int i, j, childnum;
-  int found, datafound;
+  int found;
   int true;
-  time_series_t *ts=data->model->time_series;
-  double findtol=1e-5;
  
   ASTNodeType_t type;
   /* ASTNode_t **child; */
@@ -165,36 +163,9 @@ SBML_ODESOLVER_API double evaluateAST(ASTNode_t *n, cvodeData_t *data)
     {
       if ( ASTNode_isSetData(n) )
       {
-
-        /* if continuous data is observed, obtain interpolated result */  
-        if ( (data->model->discrete_observation_data != 1) || (data->model->compute_vector_v != 1) )
-	{
-	  result = call(ASTNode_getIndex(n),
-			data->currenttime, ts);
-
-	}
-	else  /* if discrete data is observed, simply obtain value from time_series */
-	{
-          datafound = 0;
-          i = data->TimeSeriesIndex;
-        
-	    if ( fabs(data->currenttime - ts->time[i]) < findtol )
-	    {    
-	      result = ts->data[ASTNode_getIndex(n)][i];
-              datafound++;
-	    }
-	
-          if ( datafound != 1)
-	  {	            
-	    SolverError_error(FATAL_ERROR_TYPE,
-			SOLVER_ERROR_AST_EVALUATION_FAILED_DISCRETE_DATA,
-			"use of discrete time series data failed; none or several time points matching current time");
-	    result = 0;
-           /*  break;  */
-	  }
-          else found = 1;
-
-	}
+	/* observation data: interpolated for continuous data,
+	   indexed by the current data row for discrete data */
+	result = CvodeData_getTimeSeriesValue(data, ASTNode_getIndex(n));
       }
       else
       {
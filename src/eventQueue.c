@@ -0,0 +1,156 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* 
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sbmlsolver/eventQueue.h"
+
+#include "private/error.h"
+
+#include <stdlib.h>
+
+/** a scheduled event */
+typedef struct eventTime
+{
+  double time;
+  int event;
+} eventTime_t;
+
+/** a binary min-heap of event firing times */
+struct eventQueue
+{
+  eventTime_t *heap;
+  int size;
+  int capacity;
+};
+
+static void *realloc_or_die(void *ptr, size_t size)
+{
+  void *p = realloc(ptr, size);
+  if (!p) report_error_and_die("failed to realloc");
+  return p;
+}
+
+/* orders by time, and simultaneous events by their index */
+static int EventQueue_less(const eventTime_t *a, const eventTime_t *b)
+{
+  return a->time < b->time || (a->time == b->time && a->event < b->event);
+}
+
+/** create an empty event queue */
+eventQueue_t *EventQueue_create(void)
+{
+  eventQueue_t *queue;
+
+  queue = calloc(1, sizeof(*queue));
+  if (!queue) report_error_and_die("failed to calloc");
+  return queue;
+}
+
+/** free an event queue */
+void EventQueue_free(eventQueue_t *queue)
+{
+  if (!queue) return;
+  free(queue->heap);
+  free(queue);
+}
+
+/** remove all events from the queue */
+void EventQueue_clear(eventQueue_t *queue)
+{
+  queue->size = 0;
+}
+
+/** schedule the given event at the given time */
+void EventQueue_push(eventQueue_t *queue, double time, int event)
+{
+  int i, parent;
+  eventTime_t e;
+
+  if (queue->size == queue->capacity) {
+    queue->capacity = queue->capacity ? 2 * queue->capacity : 8;
+    queue->heap = realloc_or_die(queue->heap,
+				 queue->capacity * sizeof(eventTime_t));
+  }
+  e.time = time;
+  e.event = event;
+
+  /* sift up */
+  i = queue->size++;
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (!EventQueue_less(&e, &queue->heap[parent])) break;
+    queue->heap[i] = queue->heap[parent];
+    i = parent;
+  }
+  queue->heap[i] = e;
+}
+
+/** remove the earliest event from a non-empty queue */
+void EventQueue_pop(eventQueue_t *queue)
+{
+  int i, child;
+  eventTime_t e;
+
+  e = queue->heap[--queue->size];
+
+  /* sift down */
+  i = 0;
+  while ((child = 2 * i + 1) < queue->size) {
+    if (child + 1 < queue->size &&
+	EventQueue_less(&queue->heap[child + 1], &queue->heap[child]))
+      child++;
+    if (!EventQueue_less(&queue->heap[child], &e)) break;
+    queue->heap[i] = queue->heap[child];
+    i = child;
+  }
+  queue->heap[i] = e;
+}
+
+/** return 1 if no events are scheduled */
+int EventQueue_isEmpty(const eventQueue_t *queue)
+{
+  return queue->size == 0;
+}
+
+/** return the number of scheduled events */
+int EventQueue_getSize(const eventQueue_t *queue)
+{
+  return queue->size;
+}
+
+/** return the time of the earliest event of a non-empty queue */
+double EventQueue_getTime(const eventQueue_t *queue)
+{
+  return queue->heap[0].time;
+}
+
+/** return the index of the earliest event of a non-empty queue */
+int EventQueue_getEvent(const eventQueue_t *queue)
+{
+  return queue->heap[0].event;
+}
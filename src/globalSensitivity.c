@@ -0,0 +1,626 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup globalSensitivity Global Sensitivity Analysis
+  \ingroup odeSolver
+  \brief This module contains space-filling designs of parameter
+  values for varySettings and the estimation of variance-based
+  (Sobol) sensitivity indices from batch runs.
+
+  Latin hypercube designs sample each parameter range in n strata.
+  Saltelli designs for N base samples consist of N*(k+2) design
+  points for k parameters: the points of two independent samples A
+  and B, followed by k points of A with one parameter taken from B.
+  A and B are taken from a Sobol sequence (Joe and Kuo direction
+  numbers) for up to 10 parameters, and from two Latin hypercubes
+  otherwise. The first order (Saltelli 2010) and total (Jansen 1999)
+  indices are accumulated per base sample, without storing the time
+  courses of all design points.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/integratorInstance.h"
+#include "sbmlsolver/batchProcesses.h"
+#include "sbmlsolver/batchStream.h"
+#include "sbmlsolver/globalSensitivity.h"
+
+/* dimensions of the built-in Sobol sequence */
+#define SOBOL_MAXDIM 21
+#define SOBOL_BITS 32
+
+/* base samples per batch of worker processes */
+#define SOBOL_CHUNK 256
+
+/* Joe and Kuo (2008) direction numbers, new-joe-kuo-6.21201, for
+   dimensions 2 to 21: degree s and coefficients a of the primitive
+   polynomial, and the initial direction numbers m_1..m_s; the first
+   dimension is the van der Corput sequence */
+static const int sobolDegree[SOBOL_MAXDIM-1] =
+  { 1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6, 7, 7 };
+static const int sobolPoly[SOBOL_MAXDIM-1] =
+  { 0, 1, 1, 2, 1, 4, 2, 4, 7, 11, 13, 14, 1, 13, 16, 19, 22, 25, 1, 4 };
+static const int sobolM[SOBOL_MAXDIM-1][7] = {
+  { 1 },
+  { 1, 3 },
+  { 1, 3, 1 },
+  { 1, 1, 1 },
+  { 1, 1, 3, 3 },
+  { 1, 3, 5, 13 },
+  { 1, 1, 5, 5, 17 },
+  { 1, 1, 5, 5, 5 },
+  { 1, 1, 7, 11, 19 },
+  { 1, 1, 5, 1, 1 },
+  { 1, 1, 1, 3, 11 },
+  { 1, 3, 5, 5, 31 },
+  { 1, 3, 3, 9, 7, 49 },
+  { 1, 1, 1, 15, 21, 21 },
+  { 1, 3, 1, 13, 27, 49 },
+  { 1, 1, 1, 15, 7, 5 },
+  { 1, 3, 1, 15, 13, 25 },
+  { 1, 1, 5, 5, 19, 61 },
+  { 1, 3, 7, 11, 23, 15, 103 },
+  { 1, 3, 7, 13, 13, 15, 69 }
+};
+
+/* the design points of one base sample and their outputs */
+typedef struct sobolGroup
+{
+  int nobs;
+  int output;
+  int failed;
+  double **f;          /* outputs of the k+2 design points */
+  sobolIndices_t *si;
+} sobolGroup_t;
+
+static double Random_uniform(unsigned long *);
+static void Sobol_directions(int dim, unsigned long *v);
+static int Design_latinHypercube(int n, int k, double **u, unsigned long *);
+static double Design_scale(double u, double lower, double upper, int logscale);
+static int Design_checkRanges(varySettings_t *, const double *lower,
+			      const double *upper, const int *logscale);
+static void SobolGroup_finish(sobolGroup_t *);
+static int SobolGroup_stream(const batchPoint_t *, void *);
+
+
+/** Fills all design points of the varySettings with a Latin
+    hypercube sample of the parameter ranges [lower[i], upper[i]].
+
+    The ranges of parameters with logscale[i] set are sampled
+    uniformly in log space and must be positive; logscale may be
+    NULL for linear ranges. The sample is determined by the seed.
+    Returns 1 on success and 0 on failure.
+*/
+
+SBML_ODESOLVER_API int VarySettings_setLatinHypercube(varySettings_t *vs, const double *lower, const double *upper, const int *logscale, unsigned long seed)
+{
+  int i, j, k = vs->nrparams, n = vs->nrdesignpoints;
+  double **u;
+
+  if ( !Design_checkRanges(vs, lower, upper, logscale) )
+    return 0;
+
+  ASSIGN_NEW_MEMORY_BLOCK(u, n+1, double *, 0);
+  for ( i=0; i<n; i++ )
+    ASSIGN_NEW_MEMORY_BLOCK(u[i], k+1, double, 0);
+
+  Design_latinHypercube(n, k, u, &seed);
+  for ( i=0; i<n; i++ )
+  {
+    for ( j=0; j<k; j++ )
+      vs->params[i][j] = Design_scale(u[i][j], lower[j], upper[j],
+				      logscale != NULL && logscale[j]);
+    free(u[i]);
+  }
+  free(u);
+  vs->cnt_points = n;
+
+  return 1;
+}
+
+
+/** Fills all design points of the varySettings with a Saltelli
+    design for N = nrdesignpoints/(nrparams+2) base samples of the
+    parameter ranges [lower[i], upper[i]], see
+    VarySettings_setLatinHypercube for the ranges.
+
+    Design point j*(k+2) is the j-th point of sample A, point
+    j*(k+2)+1 the j-th point of sample B, and point j*(k+2)+2+i is
+    the j-th point of A with parameter i taken from B. The seed is
+    only used for more than 10 parameters, where A and B are Latin
+    hypercubes. Returns 1 on success and 0 on failure, e.g. if
+    nrdesignpoints is not a multiple of nrparams+2.
+*/
+
+SBML_ODESOLVER_API int VarySettings_setSaltelliDesign(varySettings_t *vs, const double *lower, const double *upper, const int *logscale, unsigned long seed)
+{
+  int i, j, b, c, d, row, k = vs->nrparams, n;
+  unsigned long **v, *x;
+  double **u, **ua, **ub;
+
+  if ( !Design_checkRanges(vs, lower, upper, logscale) )
+    return 0;
+  if ( k < 1 || vs->nrdesignpoints % (k+2) != 0 )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_VARY_SETTINGS,
+		      "A Saltelli design for %d parameters requires a "
+		      "multiple of %d design points, %d allocated.",
+		      k, k+2, vs->nrdesignpoints);
+    return 0;
+  }
+  n = vs->nrdesignpoints / (k+2);
+
+  /* columns 0..k-1 hold A, columns k..2k-1 hold B */
+  ASSIGN_NEW_MEMORY_BLOCK(u, n, double *, 0);
+  for ( i=0; i<n; i++ )
+    ASSIGN_NEW_MEMORY_BLOCK(u[i], 2*k, double, 0);
+
+  if ( 2*k <= SOBOL_MAXDIM )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(v, 2*k, unsigned long *, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(x, 2*k, unsigned long, 0);
+    for ( d=0; d<2*k; d++ )
+    {
+      ASSIGN_NEW_MEMORY_BLOCK(v[d], SOBOL_BITS, unsigned long, 0);
+      Sobol_directions(d, v[d]);
+    }
+    /* Gray code order, skipping the first point 0 */
+    for ( i=0; i<n; i++ )
+    {
+      for ( c=0, b=i; b & 1; b >>= 1 )
+	c++;
+      for ( d=0; d<2*k; d++ )
+      {
+	x[d] ^= v[d][c];
+	u[i][d] = (double) x[d] / 4294967296.0;
+      }
+    }
+    for ( d=0; d<2*k; d++ )
+      free(v[d]);
+    free(v);
+    free(x);
+  }
+  else
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(ua, n, double *, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ub, n, double *, 0);
+    for ( i=0; i<n; i++ )
+    {
+      ua[i] = u[i];
+      ub[i] = u[i] + k;
+    }
+    Design_latinHypercube(n, k, ua, &seed);
+    Design_latinHypercube(n, k, ub, &seed);
+    free(ua);
+    free(ub);
+  }
+
+  for ( i=0; i<n; i++ )
+  {
+    row = i*(k+2);
+    for ( j=0; j<k; j++ )
+    {
+      vs->params[row][j] = Design_scale(u[i][j], lower[j], upper[j],
+					logscale != NULL && logscale[j]);
+      vs->params[row+1][j] = Design_scale(u[i][k+j], lower[j], upper[j],
+					  logscale != NULL && logscale[j]);
+    }
+    for ( c=0; c<k; c++ )
+      for ( j=0; j<k; j++ )
+	vs->params[row+2+c][j] = vs->params[j == c ? row+1 : row][j];
+    free(u[i]);
+  }
+  free(u);
+  vs->cnt_points = vs->nrdesignpoints;
+
+  return 1;
+}
+
+
+/** Creates empty estimators of the Sobol indices of nrparams
+    parameters for nobs outputs
+*/
+
+SBML_ODESOLVER_API sobolIndices_t *SobolIndices_create(int nrparams, int nobs)
+{
+  int i;
+  sobolIndices_t *si;
+
+  ASSIGN_NEW_MEMORY(si, struct sobolIndices, NULL);
+  si->nrparams = nrparams;
+  si->nobs = nobs;
+  ASSIGN_NEW_MEMORY_BLOCK(si->mean, nobs+1, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(si->m2, nobs+1, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(si->first, nrparams+1, double *, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(si->total, nrparams+1, double *, NULL);
+  for ( i=0; i<nrparams; i++ )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(si->first[i], nobs+1, double, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(si->total[i], nobs+1, double, NULL);
+  }
+
+  return si;
+}
+
+
+/** Adds the outputs of one base sample: fA and fB are the outputs
+    of the points of sample A and B, and fAB[i] the outputs of the
+    point of A with parameter i taken from B
+*/
+
+SBML_ODESOLVER_API void SobolIndices_addSample(sobolIndices_t *si, const double *fA, const double *fB, double **fAB)
+{
+  int i, j, n;
+  double delta;
+
+  si->nsamples++;
+  for ( j=0; j<si->nobs; j++ )
+  {
+    /* running variance of all outputs of A and B (Welford) */
+    n = 2*si->nsamples - 1;
+    delta = fA[j] - si->mean[j];
+    si->mean[j] += delta / n;
+    si->m2[j] += delta * (fA[j] - si->mean[j]);
+    n++;
+    delta = fB[j] - si->mean[j];
+    si->mean[j] += delta / n;
+    si->m2[j] += delta * (fB[j] - si->mean[j]);
+
+    for ( i=0; i<si->nrparams; i++ )
+    {
+      si->first[i][j] += fB[j] * (fAB[i][j] - fA[j]);
+      si->total[i][j] += (fA[j] - fAB[i][j]) * (fA[j] - fAB[i][j]);
+    }
+  }
+}
+
+
+/** Returns the number of accumulated base samples
+*/
+
+SBML_ODESOLVER_API int SobolIndices_getNumSamples(const sobolIndices_t *si)
+{
+  return si->nsamples;
+}
+
+
+/** Returns the estimated variance of output obs
+*/
+
+SBML_ODESOLVER_API double SobolIndices_getVariance(const sobolIndices_t *si, int obs)
+{
+  if ( si->nsamples < 1 )
+    return 0.0;
+  return si->m2[obs] / (2*si->nsamples - 1);
+}
+
+
+/** Returns the first order index of parameter param for output obs,
+    the fraction of the variance caused by the parameter alone; 0 if
+    the output doesn't vary
+*/
+
+SBML_ODESOLVER_API double SobolIndices_getFirstOrder(const sobolIndices_t *si, int param, int obs)
+{
+  double var = SobolIndices_getVariance(si, obs);
+
+  if ( var <= 0.0 )
+    return 0.0;
+  return si->first[param][obs] / si->nsamples / var;
+}
+
+
+/** Returns the total index of parameter param for output obs, the
+    fraction of the variance caused by the parameter including all
+    its interactions; 0 if the output doesn't vary
+*/
+
+SBML_ODESOLVER_API double SobolIndices_getTotal(const sobolIndices_t *si, int param, int obs)
+{
+  double var = SobolIndices_getVariance(si, obs);
+
+  if ( var <= 0.0 )
+    return 0.0;
+  return si->total[param][obs] / (2.0*si->nsamples) / var;
+}
+
+
+/** Frees the estimators
+*/
+
+SBML_ODESOLVER_API void SobolIndices_free(sobolIndices_t *si)
+{
+  int i;
+
+  if ( si == NULL )
+    return;
+  for ( i=0; i<si->nrparams; i++ )
+  {
+    free(si->first[i]);
+    free(si->total[i]);
+  }
+  free(si->first);
+  free(si->total);
+  free(si->mean);
+  free(si->m2);
+  free(si);
+}
+
+
+/** Integrates the design points of a Saltelli design (see
+    VarySettings_setSaltelliDesign) and adds the outputs of the nobs
+    observables, their final value, minimum or maximum (sobolOutput)
+    to the estimators of the Sobol indices.
+
+    The design points are integrated one after the other via
+    IntegratorInstance_batchStream if nworkers is 1 or results are
+    not stored, and otherwise
+    in chunks of base samples via IntegratorInstance_batchProcesses
+    by nworkers worker processes (all processors if nworkers < 1).
+    Base samples with failed integrations are skipped. Returns the
+    number of base samples added, or -1 on failure.
+*/
+
+SBML_ODESOLVER_API int IntegratorInstance_sobolIndices(integratorInstance_t *engine, int nrparams, variableIndex_t **vi, int nrdesignpoints, double **params, int nobs, variableIndex_t **observable, int output, int nworkers, sobolIndices_t *si)
+{
+  int i, j, l, n, start, npoints, idx, nsamples, flag;
+  int *status;
+  double x;
+  sobolGroup_t group;
+  cvodeResults_t **results, *res;
+
+  if ( nrdesignpoints % (nrparams+2) != 0 || si->nrparams != nrparams ||
+       si->nobs != nobs )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_VARY_SETTINGS,
+		      "Sobol indices require a Saltelli design of %d "
+		      "parameters and estimators for %d outputs.",
+		      nrparams, nobs);
+    return -1;
+  }
+
+  nsamples = si->nsamples;
+  group.nobs = nobs;
+  group.output = output;
+  group.failed = 0;
+  group.si = si;
+  ASSIGN_NEW_MEMORY_BLOCK(group.f, nrparams+2, double *, -1);
+  for ( i=0; i<nrparams+2; i++ )
+    ASSIGN_NEW_MEMORY_BLOCK(group.f[i], nobs+1, double, -1);
+
+  flag = 1;
+  if ( nworkers == 1 || !engine->opt->StoreResults )
+    flag = IntegratorInstance_batchStream(engine, nrparams, vi,
+					  nrdesignpoints, params, nobs,
+					  observable, SobolGroup_stream,
+					  &group) >= 0;
+  else
+  {
+    npoints = SOBOL_CHUNK * (nrparams+2);
+    ASSIGN_NEW_MEMORY_BLOCK(results, npoints, cvodeResults_t *, -1);
+    ASSIGN_NEW_MEMORY_BLOCK(status, npoints, int, -1);
+
+    for ( start=0; start<nrdesignpoints; start+=npoints )
+    {
+      n = nrdesignpoints - start < npoints ? nrdesignpoints - start : npoints;
+      for ( i=0; i<n; i++ )
+      {
+	results[i] = NULL;
+	status[i] = BATCH_PENDING;
+      }
+      IntegratorInstance_batchProcesses(engine, nrparams, vi, n,
+					params + start, nworkers, 0.0,
+					results, status);
+      for ( i=0; i<n; i++ )
+      {
+	res = results[i];
+	if ( status[i] != BATCH_COMPLETED )
+	  group.failed = 1;
+	else
+	  for ( j=0; j<nobs; j++ )
+	  {
+	    idx = observable[j]->index;
+	    group.f[i % (nrparams+2)][j] = res->value[idx][res->nout];
+	    for ( l=0; l<res->nout && output != SOBOL_FINAL; l++ )
+	    {
+	      x = res->value[idx][l];
+	      if ( (output == SOBOL_MIN && x < group.f[i % (nrparams+2)][j]) ||
+		   (output == SOBOL_MAX && x > group.f[i % (nrparams+2)][j]) )
+		group.f[i % (nrparams+2)][j] = x;
+	    }
+	  }
+	if ( res != NULL )
+	  CvodeResults_free(res);
+	if ( i % (nrparams+2) == nrparams+1 )
+	  SobolGroup_finish(&group);
+      }
+    }
+    free(results);
+    free(status);
+  }
+
+  for ( i=0; i<nrparams+2; i++ )
+    free(group.f[i]);
+  free(group.f);
+
+  return flag ? si->nsamples - nsamples : -1;
+}
+
+
+/************* internal functions ************/
+
+/* adds the outputs of a finished base sample to the estimators,
+   unless one of its design points failed */
+static void SobolGroup_finish(sobolGroup_t *group)
+{
+  if ( group->failed )
+    group->si->nskipped++;
+  else
+    SobolIndices_addSample(group->si, group->f[0], group->f[1],
+			   group->f + 2);
+  group->failed = 0;
+}
+
+
+/* batchCallback of the streaming batch run, stores the outputs of
+   a design point and finishes base samples */
+static int SobolGroup_stream(const batchPoint_t *view, void *userData)
+{
+  int j, k;
+  sobolGroup_t *group = (sobolGroup_t *) userData;
+
+  k = group->si->nrparams;
+  if ( !view->completed )
+    group->failed = 1;
+  for ( j=0; j<group->nobs; j++ )
+    group->f[view->point % (k+2)][j] =
+      group->output == SOBOL_MIN ? view->min[j] :
+      group->output == SOBOL_MAX ? view->max[j] : view->final[j];
+
+  if ( view->point % (k+2) == k+1 )
+    SobolGroup_finish(group);
+
+  return 1;
+}
+
+
+/* checks the parameter ranges of a design, log ranges must be
+   positive */
+static int Design_checkRanges(varySettings_t *vs, const double *lower,
+			      const double *upper, const int *logscale)
+{
+  int j;
+
+  for ( j=0; j<vs->nrparams; j++ )
+    if ( !(lower[j] <= upper[j]) ||
+	 (logscale != NULL && logscale[j] && lower[j] <= 0.0) )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_VARY_SETTINGS,
+			"Invalid range [%g, %g] of parameter %d.",
+			lower[j], upper[j], j);
+      return 0;
+    }
+
+  return 1;
+}
+
+
+/* maps u in [0,1) to the parameter range, linearly or in log space */
+static double Design_scale(double u, double lower, double upper, int logscale)
+{
+  if ( logscale )
+    return exp(log(lower) + u * (log(upper) - log(lower)));
+  return lower + u * (upper - lower);
+}
+
+
+/* writes a Latin hypercube sample of n points in [0,1)^k to u: each
+   column is a random permutation of the n strata, with a random
+   position in the stratum; returns 1 on success and 0 on failure */
+static int Design_latinHypercube(int n, int k, double **u, unsigned long *seed)
+{
+  int i, j, r, tmp, *perm;
+
+  ASSIGN_NEW_MEMORY_BLOCK(perm, n+1, int, 0);
+  for ( j=0; j<k; j++ )
+  {
+    for ( i=0; i<n; i++ )
+      perm[i] = i;
+    /* Fisher-Yates shuffle */
+    for ( i=n-1; i>0; i-- )
+    {
+      r = (int) (Random_uniform(seed) * (i+1));
+      if ( r > i )
+	r = i;
+      tmp = perm[i];
+      perm[i] = perm[r];
+      perm[r] = tmp;
+    }
+    for ( i=0; i<n; i++ )
+      u[i][j] = (perm[i] + Random_uniform(seed)) / n;
+  }
+  free(perm);
+
+  return 1;
+}
+
+
+/* uniform random numbers in (0,1) from the 32 bit xorshift
+   generator of Marsaglia, the state must not be 0 */
+static double Random_uniform(unsigned long *state)
+{
+  unsigned long x = *state & 0xffffffffUL;
+
+  if ( x == 0 )
+    x = 2463534242UL;
+  x ^= (x << 13) & 0xffffffffUL;
+  x ^= x >> 17;
+  x ^= (x << 5) & 0xffffffffUL;
+  *state = x;
+
+  return (x + 0.5) / 4294967296.0;
+}
+
+
+/* direction numbers v[0..31] of Sobol dimension dim, scaled to 32
+   bits */
+static void Sobol_directions(int dim, unsigned long *v)
+{
+  int b, i, s, a;
+
+  if ( dim == 0 )
+  {
+    for ( b=0; b<SOBOL_BITS; b++ )
+      v[b] = 1UL << (SOBOL_BITS-1-b);
+    return;
+  }
+
+  s = sobolDegree[dim-1];
+  a = sobolPoly[dim-1];
+  for ( b=0; b<s; b++ )
+    v[b] = (unsigned long) sobolM[dim-1][b] << (SOBOL_BITS-1-b);
+  for ( b=s; b<SOBOL_BITS; b++ )
+  {
+    v[b] = v[b-s] ^ (v[b-s] >> s);
+    for ( i=1; i<s; i++ )
+      if ( (a >> (s-1-i)) & 1 )
+	v[b] ^= v[b-i];
+  }
+}
+
+/*! @} */
+/* End of file */
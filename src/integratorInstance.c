@@ -54,7 +54,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <cvodes/cvodes.h>
-#include <kinsol/kinsol.h>
 #include <cvodes/cvodes_dense.h>
 #include <nvector/nvector_serial.h>
 
@@ -67,6 +66,8 @@
 #include "sbmlsolver/integratorInstance.h"
 #include "sbmlsolver/cvodeSolver.h"
 #include "sbmlsolver/sensSolver.h"
+#include "sbmlsolver/rkSolver.h"
+#include "sbmlsolver/nullSolver.h"
 
 /* local integratorInstance allocation and initialization */ 
 static int
@@ -90,6 +91,12 @@ IntegratorInstance_processEventsAndAssignments(integratorInstance_t *);
 static void
 IntegratorInstance_setVariableValueByIndex(integratorInstance_t *, int, double);
 
+/* evaluates assignment rules, compiled or interpreted */
+static void
+IntegratorInstance_updateAssignments(integratorInstance_t *);
+static void
+IntegratorInstance_updateAssignmentsBeforeODEs(integratorInstance_t *);
+
 
 /***************** functions common to all solvers ************************/
 
@@ -221,6 +228,10 @@ static integratorInstance_t *IntegratorInstance_allocate(cvodeData_t *data,
   engine->solver->cvode_mem = NULL;
   engine->solver->abstol = NULL;
   engine->solver->q = NULL;
+  engine->solver->nroots = 0;
+  engine->solver->method = 0;
+  engine->solver->statsRun = 0;
+  engine->solver->hin = 0.0;
 
   /* set sensitivity structure to NULL */
   engine->solver->yS = NULL;
@@ -234,6 +245,12 @@ static integratorInstance_t *IntegratorInstance_allocate(cvodeData_t *data,
   engine->solver->qA = NULL;
   engine->solver->abstolA = NULL;
   engine->solver->abstolQA = NULL;
+  engine->solver->nSaveSteps = 0;
+  engine->solver->interpolation = 0;
+  engine->solver->nstF = 0;
+  /* set built-in solver structures to NULL */
+  engine->solver->rk = NULL;
+  engine->solver->ns = NULL;
 
   engine->os = NULL;
 /*   engine->solver->nsens = 0; */
@@ -386,6 +403,11 @@ static int IntegratorInstance_initializeSolver(integratorInstance_t *engine,
     /* set up loop variables */
     solver->iout=1;        /* counts integration steps, start with 1 */
 
+    /* automatic method switching starts non-stiff */
+    solver->stiff = 0;
+    solver->nswitch = 0;
+    solver->hAdams = 0.0;
+
  
     /* write initial conditions to results structure */
     if ( opt->StoreResults )
@@ -481,11 +503,7 @@ SBML_ODESOLVER_API void IntegratorInstance_copyVariableState(integratorInstance_
     target->isValid = 0;
 
     /* update assignments */
-    for ( i=0; i<om->nass; i++ )
-    {
-      nonzeroElem_t *ordered = om->assignmentOrder[i];
-      targetData->value[ordered->i] = evaluateAST(ordered->ij, targetData);
-    }
+    IntegratorInstance_updateAssignments(target);
     targetData->allRulesUpdated = 1;
   }
 }
@@ -569,7 +587,6 @@ SBML_ODESOLVER_API const char *IntegratorInstance_getVariableName(integratorInst
 
 SBML_ODESOLVER_API double IntegratorInstance_getVariableValue(integratorInstance_t *engine, variableIndex_t *vi)
 {
-  int i;
   odeModel_t *om = engine->om;
   cvodeData_t *data = engine->data;
 
@@ -579,11 +596,7 @@ SBML_ODESOLVER_API double IntegratorInstance_getVariableValue(integratorInstance
   if ( !data->allRulesUpdated &&
        (vi->index >= om->neq && vi->index < om->neq+om->nass) )
   {
-    for ( i=0; i<om->nass; i++ )
-    {
-      nonzeroElem_t *ordered = om->assignmentOrder[i];
-      data->value[ordered->i] = evaluateAST(ordered->ij, data);
-    }
+    IntegratorInstance_updateAssignments(engine);
     data->allRulesUpdated = 1;
   }
   return data->value[vi->index];
@@ -1014,8 +1027,8 @@ SBML_ODESOLVER_API int IntegratorInstance_simpleOneStep(integratorInstance_t *en
   /* just increase the time */
   engine->solver->t = engine->solver->tout;
 
-  if ( engine->processEvents && engine->opt->compileFunctions &&
-       !engine->om->compiledEventFunction )
+  /* compiled events and assignment rules */
+  if ( engine->opt->compileFunctions && !engine->om->compiledEventFunction )
     ODEModel_compileCVODEFunctions(engine->om); /*!!! TODO : handle error */
 
   /* ... and call the default update function */
@@ -1076,6 +1089,69 @@ IntegratorInstance_processEventsAndAssignments(integratorInstance_t *engine)
   return fired;
 }
 
+/* Evaluates event triggers and executes the assignments of fired
+   events at the current time, via the compiled event function if
+   requested. Used by the default update after each time step, and by
+   solvers that stop at the firing time of time-only triggers.
+   Returns 1 if the solver can proceed, 0 if otherwise (HaltOnEvent).
+*/
+int IntegratorInstance_handleEvents(integratorInstance_t *engine)
+{
+  int i, fired;
+  char *buffer;
+  cvodeData_t *data = engine->data;
+  cvodeSettings_t *opt = engine->opt;
+  odeModel_t *om = engine->om;
+
+  if ( opt->compileFunctions ) 
+    fired = om->compiledEventFunction(data, &(engine->isValid));   
+  else
+    fired = IntegratorInstance_processEventsAndAssignments(engine);
+
+  if ( fired && opt->HaltOnEvent )
+  {
+    for ( i=0; i!= data->nevents; i++ )
+    {
+      if ( data->trigger[i] )
+      {
+	buffer = SBML_formulaToString(om->event[i]);
+	SolverError_error(ERROR_ERROR_TYPE,
+			  SOLVER_ERROR_EVENT_TRIGGER_FIRED,
+			  "Event Trigger %d (%s) fired at time %g. "
+			  "Aborting simulation.",
+			  i, buffer, data->currenttime);
+	free(buffer);
+      }
+    }
+    return 0; /* stop integration */
+  }
+
+  return 1;
+}
+
+/* writes the earliest firing time of time-only event triggers ahead
+   of the current time to *time and returns 1, or returns 0 if no
+   such event is scheduled; for solvers that stop at these times */
+int IntegratorInstance_getNextEventTime(integratorInstance_t *engine,
+					double *time)
+{
+  eventQueue_t *queue = engine->data->eventQueue;
+
+  if ( queue == NULL )
+    return 0;
+
+  /* drop events that are due */
+  while ( !EventQueue_isEmpty(queue) &&
+	  EventQueue_getTime(queue) <= engine->solver->t )
+    EventQueue_pop(queue);
+
+  if ( EventQueue_isEmpty(queue) )
+    return 0;
+
+  *time = EventQueue_getTime(queue);
+  return 1;
+}
+
 /** Default function for updating data, to be used by solvers after
     they have calculate x(t) and updated the time.
 
@@ -1087,8 +1163,7 @@ IntegratorInstance_processEventsAndAssignments(integratorInstance_t *engine)
 
 int IntegratorInstance_updateData(integratorInstance_t *engine)
 {
-  int i, flag = 1, fired;
-  char *buffer;
+  int i, flag = 1;
   cvodeSolver_t *solver = engine->solver;
   cvodeData_t *data = engine->data;
   cvodeSettings_t *opt = engine->opt;
@@ -1104,30 +1179,7 @@ int IntegratorInstance_updateData(integratorInstance_t *engine)
 
   /* HANDLE EVENTS */
   if ( engine->processEvents )
-  {
-    if ( opt->compileFunctions ) 
-      fired = om->compiledEventFunction(data, &(engine->isValid));   
-    else
-      fired = IntegratorInstance_processEventsAndAssignments(engine);
-
-    if ( fired && opt->HaltOnEvent )
-    {
-      for ( i=0; i!= data->nevents; i++ )
-      {
-	if ( data->trigger[i] )
-	{
-	  buffer = SBML_formulaToString(om->event[i]);
-	  SolverError_error(ERROR_ERROR_TYPE,
-			    SOLVER_ERROR_EVENT_TRIGGER_FIRED,
-			    "Event Trigger %d (%s) fired at time %g. "
-			    "Aborting simulation.",
-			    i, buffer, data->currenttime);
-	  free(buffer);
-	}
-      }
-      flag = 0; /* stop integration */
-    }
-  }
+    flag = IntegratorInstance_handleEvents(engine);
   
   /* NOT ALL RULES ARE UP-TO-DATE ! */
   /* this avoids unnecessary update of all rules, if the values
@@ -1145,15 +1197,7 @@ int IntegratorInstance_updateData(integratorInstance_t *engine)
        that have not been handled by events - observables? !! */
     if ( !data->allRulesUpdated )
     {
-      for ( i=0; i<om->nass; i++ )
-      {
-	nonzeroElem_t *ordered = om->assignmentOrder[i];
-#ifdef ARITHMETIC_TEST
-	data->value[ordered->i] = ordered->ijcode->evaluate(data);
-#else
-	data->value[ordered->i] = evaluateAST(ordered->ij, data);
-#endif
-      }
+      IntegratorInstance_updateAssignments(engine);
       data->allRulesUpdated = 1;
     }
 
@@ -1201,7 +1245,7 @@ int IntegratorInstance_updateData(integratorInstance_t *engine)
       data->TimeSeriesIndex = opt->OffSet + d.quot;
       
       NV_Ith_S(solver->q, 0) = NV_Ith_S(solver->q, 0)
-	+ evaluateAST( data->model->ObjectiveFunction, data);
+	+ CvodeData_evaluateObjective(data);
       om->compute_vector_v=0;
     }
 
@@ -1299,13 +1343,10 @@ int IntegratorInstance_updateAdjData(integratorInstance_t *engine)
     d = div(solver->iout, 1+opt->InterStep);
     data->TimeSeriesIndex =
       data->model->time_series->n_time-1-(opt->OffSet + d.quot);
+    CvodeData_addVectorV(data, data->adjvalue, -1.0);
+    /* also need to update solver->yA */
     for ( i=0; i<om->neq; i++ )
-    { 
-       data->adjvalue[i] = data->adjvalue[i] -
-	 evaluateAST(data->model->vector_v[i], data);
-       /* also need to update solver->yA */
-        NV_Ith_S(solver->yA, i) = data->adjvalue[i];    
-    }
+      NV_Ith_S(solver->yA, i) = data->adjvalue[i];
     om->compute_vector_v=0;
 
     /* compute quadrature: quad for the computed step is now added to qA  */
@@ -1442,7 +1483,7 @@ SBML_ODESOLVER_API int IntegratorInstance_checkTrigger(integratorInstance_t *eng
 SBML_ODESOLVER_API int IntegratorInstance_checkSteadyState(integratorInstance_t *engine)
 {
   int i;
-  double dy_mean, dy_var, dy_std;
+  double dy_mean, dy_var, dy_std, f, sums[3];
   cvodeData_t *data = engine->data;
   odeModel_t *om = engine->om;
   cvodeSettings_t *opt= engine->opt;
@@ -1454,32 +1495,31 @@ SBML_ODESOLVER_API int IntegratorInstance_checkSteadyState(integratorInstance_t
   }
 
   if ( !data->allRulesUpdated )
-    for ( i=0; i<om->nassbeforeodes; i++ )
-    {
-      nonzeroElem_t *ordered = om->assignmentsBeforeODEs[i];
-#ifdef ARITHMETIC_TEST
-      data->value[ordered->i] = ordered->ijcode->evaluate(data);    
-#else
-      data->value[ordered->i] = evaluateAST(ordered->ij, data);
-#endif    
-    }
+    IntegratorInstance_updateAssignmentsBeforeODEs(engine);
   
   /* calculate the mean and standard deviation of rates of change and
-     store in cvodeData_t * */
-  dy_mean = 0.0;
-  dy_var = 0.0;
-  dy_std = 0.0;
-  
-  for ( i=0; i<om->neq; i++ ) 
-    dy_mean += fabs(evaluateAST(om->ode[i],data));
-
-  dy_mean = dy_mean / om->neq;
-  for ( i=0; i<om->neq; i++ )
+     store in cvodeData_t *; each rate is evaluated only once, into
+     the sums of |f|, f and f^2 */
+  if ( opt->compileFunctions && om->compiledSteadyStateFunction )
+    om->compiledSteadyStateFunction(data, sums);
+  else
   {
-    double d = evaluateAST(om->ode[i],data) - dy_mean;
-    dy_var += d*d;
+    sums[0] = sums[1] = sums[2] = 0.0;
+    for ( i=0; i<om->neq; i++ )
+    {
+      f = evaluateAST(om->ode[i],data);
+      sums[0] += fabs(f);
+      sums[1] += f;
+      sums[2] += f*f;
+    }
   }
 
+  /* variance of rates around the mean of absolute rates,
+     sum (f - mean)^2 = sum f^2 - 2 mean sum f + neq mean^2 */
+  dy_mean = sums[0] / om->neq;
+  dy_var = sums[2] - 2*dy_mean*sums[1] + om->neq*dy_mean*dy_mean;
+  if ( dy_var < 0.0 ) /* rounding */
+    dy_var = 0.0;
   dy_var = dy_var / (om->neq -1);
   dy_std = sqrt(dy_var);
 
@@ -1544,7 +1584,6 @@ static
 void IntegratorInstance_setVariableValueByIndex(integratorInstance_t *engine,
 						int idx, double value)
 {
-  int i;
   odeModel_t *om;
   cvodeData_t *data;
   cvodeSettings_t *opt;
@@ -1580,17 +1619,70 @@ void IntegratorInstance_setVariableValueByIndex(integratorInstance_t *engine,
   if ( idx < om->neq || opt->ResetCvodeOnEvent ) 
     engine->isValid = 0; 
 
+  /* constants can shift the firing times of time-only triggers */
+  if ( idx >= om->neq+om->nass )
+    CvodeData_scheduleEvents(data);
+
   /* and finally assignment rules, potentially depending on that variable
      need to be evaluated */
   /*!!! TODO : could could be optimized using the dependencyMatrix
         or a DAG structure of dependencies to be yet created ? */
+  IntegratorInstance_updateAssignments(engine);
+  data->allRulesUpdated = 1;
+
+}
+
+/* evaluates all assignment rules in topological order, via the
+   compiled assignment code if functions are compiled */
+static void
+IntegratorInstance_updateAssignments(integratorInstance_t *engine)
+{
+  int i;
+  odeModel_t *om = engine->om;
+  cvodeData_t *data = engine->data;
+
+  if ( engine->opt->compileFunctions && om->compiledAssignmentFunction )
+  {
+    om->compiledAssignmentFunction(data);
+    return;
+  }
+
   for ( i=0; i<om->nass; i++ )
   {
     nonzeroElem_t *ordered = om->assignmentOrder[i];
+#ifdef ARITHMETIC_TEST
+    data->value[ordered->i] = ordered->ijcode->evaluate(data);
+#else
     data->value[ordered->i] = evaluateAST(ordered->ij, data);
+#endif
   }
-  data->allRulesUpdated = 1;
+}
+
+/* evaluates the assignment rules required for ODE evaluation, via
+   the compiled assignment code if functions are compiled */
+static void
+IntegratorInstance_updateAssignmentsBeforeODEs(integratorInstance_t *engine)
+{
+  int i;
+  odeModel_t *om = engine->om;
+  cvodeData_t *data = engine->data;
 
+  if ( engine->opt->compileFunctions &&
+       om->compiledAssignmentsBeforeODEsFunction )
+  {
+    om->compiledAssignmentsBeforeODEsFunction(data);
+    return;
+  }
+
+  for ( i=0; i<om->nassbeforeodes; i++ )
+  {
+    nonzeroElem_t *ordered = om->assignmentsBeforeODEs[i];
+#ifdef ARITHMETIC_TEST
+    data->value[ordered->i] = ordered->ijcode->evaluate(data);
+#else
+    data->value[ordered->i] = evaluateAST(ordered->ij, data);
+#endif
+  }
 }
 
 
@@ -1619,6 +1711,9 @@ SBML_ODESOLVER_API int IntegratorInstance_integrateOneStep(integratorInstance_t
   /* for models without ODEs, we just need to increase the time */
   if ( engine->om->neq == 0 ) 
     return IntegratorInstance_simpleOneStep(engine);
+  /* call built-in Runge-Kutta or Rosenbrock Solver */
+  else if ( IntegratorInstance_useRKSolver(engine) )
+    return IntegratorInstance_rkOneStep(engine);
   /* call CVODE Solver */
   else 
     return IntegratorInstance_cvodeOneStep(engine);
@@ -1646,6 +1741,9 @@ SBML_ODESOLVER_API int IntegratorInstance_integrateOneStepWithoutEventProcessing
   /* for models without ODEs, we just need to increase the time */
   if ( engine->om->neq == 0 ) 
     return IntegratorInstance_simpleOneStep(engine);
+  /* call built-in Runge-Kutta or Rosenbrock Solver */
+  else if ( IntegratorInstance_useRKSolver(engine) )
+    return IntegratorInstance_rkOneStep(engine);
   /* call CVODE Solver */
   else 
     return IntegratorInstance_cvodeOneStep(engine);
@@ -1696,7 +1794,11 @@ SBML_ODESOLVER_API void IntegratorInstance_free(integratorInstance_t *engine)
 	if (!engine) return;
   /* solver specific switches */
   if (engine->om && engine->om->neq)
+  {
     IntegratorInstance_freeCVODESolverStructures(engine);
+    IntegratorInstance_freeRKSolverStructures(engine);
+    IntegratorInstance_freeNullSolverStructures(engine);
+  }
 
   /* if (om->algebraic) ?? */
   /* if (opt->Sensitivity) ?? */
@@ -1767,6 +1869,8 @@ SBML_ODESOLVER_API void IntegratorInstance_printStatistics(const integratorInsta
     
   if (!om->neq)
     fprintf(f, "## No statistics available for models without ODEs.\n");
+  else if (IntegratorInstance_useRKSolver(engine))
+    IntegratorInstance_printRKStatistics(engine, f);
   else 
     IntegratorInstance_printCVODEStatistics(engine, f);
 }
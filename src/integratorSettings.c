@@ -151,6 +151,7 @@ SBML_ODESOLVER_API cvodeSettings_t *CvodeSettings_createWith(double Time, int Pr
   else
     set->MaxOrder = 12;
   set->compileFunctions = 0;
+  set->nthreads = 0;
   set->ResetCvodeOnEvent = 1;
   CvodeSettings_setSwitches(set, UseJacobian, Indefinitely,
 			    HaltOnEvent, HaltOnSteadyState, StoreResults,
@@ -168,6 +169,11 @@ SBML_ODESOLVER_API cvodeSettings_t *CvodeSettings_createWith(double Time, int Pr
 
   /* Default: not doing adjoint solution  */
   set->DoAdjoint = 0;
+  /* checkpoints every nSaveSteps steps */
+  set->AdjMemory = 0.0;
+  set->AdjExpectedSteps = 0;
+  /* dense linear solver for the backward phase */
+  set->AdjLinearSolver = 0;
   /* set->AdjointPhase = 0; */
  
   /* default: use continuous observation */
@@ -175,6 +181,9 @@ SBML_ODESOLVER_API cvodeSettings_t *CvodeSettings_createWith(double Time, int Pr
 
   /* deactivate TSTOP mode of CVODE */
   set->SetTStop = 0;
+
+  /* return to each output time */
+  set->DenseOutput = 0;
    
   /* do not trigger numerical refinement upon detection of negative state values */
   set->DetectNegState = 0;
@@ -203,7 +212,9 @@ SBML_ODESOLVER_API cvodeSettings_t *CvodeSettings_clone(cvodeSettings_t *set)
   CvodeSettings_setIterMethod(clone, set->IterMethod);
 
   clone->compileFunctions = set->compileFunctions;
+  clone->nthreads = set->nthreads;
   clone->ResetCvodeOnEvent = set->ResetCvodeOnEvent;
+  clone->DenseOutput = set->DenseOutput;
   
   /* Unless indefinite integration is chosen, generate a TimePoints array  */
   if  ( !clone->Indefinitely ) {    
@@ -309,20 +320,80 @@ SBML_ODESOLVER_API void CvodeSettings_setnSaveSteps(cvodeSettings_t *set, int nS
   set->nSaveSteps = nSaveSteps;
 }
 
+
+/** Sets a memory budget for the forward phase of the adjoint solver,
+    instead of a fixed number of steps between checkpoints.
+
+    memory: budget in bytes for checkpoints and interpolation data,
+    0 to use the steps set by CvodeSettings_setnSaveSteps,\n
+    nsteps: expected number of forward steps, 0 to use the number of
+    steps of the former forward phase of an integratorInstance or an
+    estimate of 10 steps per output time.
+
+    The number of steps between checkpoints and the interpolation type
+    are then chosen such that the forward solution is recomputed as
+    little as possible during the backward phase, with Hermite
+    interpolation for BDF and polynomial interpolation (half the
+    memory) for Adams-Moulton or small budgets. The estimated memory
+    and recomputation are printed by
+    IntegratorInstance_printCVODESStatistics.
+*/
+
+SBML_ODESOLVER_API void CvodeSettings_setAdjMemory(cvodeSettings_t *set, double memory, int nsteps)
+{
+  set->AdjMemory = memory;
+  set->AdjExpectedSteps = nsteps;
+}
+
+/** Sets the linear solver of the Newton iteration in the backward
+    phase of the adjoint solver.
+
+    0: dense direct solver (default),\n
+    1: matrix-free Krylov solver (SPGMR), which uses the sparse product
+    of the adjoint Jacobian -[df/dx]^T with a vector and a diagonal
+    (Jacobi) preconditioner; this avoids the dense adjoint Jacobian
+    and its factorization, and is faster for large sparse models.
+*/
+
+SBML_ODESOLVER_API void CvodeSettings_setAdjLinearSolver(cvodeSettings_t *set, int i)
+{
+  if ( 0 <= i && i < 2 ) set->AdjLinearSolver = i;
+  else set->AdjLinearSolver = 0;
+}
+
 /** Set method non-linear solver methods, and its maximum order (currently
     the latter cannot really be set, but default to 5 for BDF or 12 for
     Adams-Moulton!!
     
-    CvodeMethod: 0: BDF (default); 1: Adams-Moulton,\n
+    CvodeMethod: 0: BDF (default); 1: Adams-Moulton,
+    2: automatic switching, 3: built-in Runge-Kutta (RK45),
+    4: built-in Rosenbrock,\n
     MaxOrder: maximum order (default: 5 for BDF, 12 for Adams-Moulton.
 
+    With automatic switching the integration starts with the
+    Adams-Moulton method and functional iteration, and switches to
+    BDF with Newton iteration when the problem becomes stiff, and back
+    again when the stiffness has vanished (similar to LSODA). Stiffness
+    is estimated from the step size and convergence failures of the
+    current method, and from a bound of the Jacobian matrix' spectral
+    radius, if the Jacobian is available. The iteration method setting
+    is ignored then. Adjoint runs and runs with quadratures (objective
+    functions, FIM) can't switch methods and use BDF.
+
+    The built-in solvers don't use CVODES: the Dormand-Prince RK45 pair
+    for non-stiff and the Rosenbrock 2(3) method of ode23s (with the
+    Jacobian matrix, see CvodeSettings_setJacobian) for stiff ODEs. They
+    avoid the CVODES overhead for small models. Sensitivity analysis,
+    adjoint runs and objective functions still use CVODES with BDF.
 */
 
 SBML_ODESOLVER_API void CvodeSettings_setMethod(cvodeSettings_t *set, int CvodeMethod, int MaxOrder)
 {
   /* CvodeMethod == 0: default BDF method
-     Method == 1: Adams-Moulton method */
-  if ( 0 <= CvodeMethod &&  CvodeMethod < 2 )
+     Method == 1: Adams-Moulton method
+     Method == 2: automatic switching
+     Method == 3, 4: built-in RK45 and Rosenbrock solvers */
+  if ( 0 <= CvodeMethod &&  CvodeMethod < 5 )
   {
     set->CvodeMethod = CvodeMethod;
     set->MaxOrder = MaxOrder;
@@ -376,6 +447,18 @@ SBML_ODESOLVER_API void CvodeSettings_setCompileFunctions(cvodeSettings_t *set,
 }
 
 
+/** Sets the number of threads which evaluate the ODEs, the Jacobian
+    and the vector operations of CVODES for very large models: 0 or 1
+    for serial evaluation (default), a negative number for one thread
+    per processor. Takes effect when the CVODES structures of an
+    integratorInstance are first created.
+*/
+SBML_ODESOLVER_API void CvodeSettings_setThreads(cvodeSettings_t *set, int nthreads)
+{
+  set->nthreads = nthreads;
+}
+
+
 /** Activates the TSTOP mode of CVODES. This is highly recommended when
     IntegratorInstance_setVariableValue affects ODE right hand side
     equations (e.g. rate laws), PLEASE CLICK AND READ MORE BELOW
@@ -384,12 +467,34 @@ SBML_ODESOLVER_API void CvodeSettings_setCompileFunctions(cvodeSettings_t *set,
     for very "unstiff" (easy-to-solve) models, for which CVODE internally can
     integrate far beyond the next time step. It will then not evaluate the
     right hand side of the ODE system for one or more output time steps and
-    thus not realize the change.   */
+    thus not realize the change.
+
+    Discontinuities due to piecewise expressions are located by root
+    functions of their conditions instead; TSTOP mode is then only
+    used if some condition can not be expressed as a root function.
+    Setting TStop switches the root functions off. */
 SBML_ODESOLVER_API void CvodeSettings_setTStop(cvodeSettings_t *set, int i)
 {
   set->SetTStop = i;
 }
 
+
+/** Activates dense output: CVODES then takes its internal steps in
+    CV_ONE_STEP mode, independently of the requested output times, and
+    values and forward sensitivities at output times are interpolated
+    from the solver's history (CVodeGetDky, CVodeGetSensDky). Very fine
+    output grids then hardly cost any extra solver work. The maximum
+    number of steps (Mxstep) still applies between two output times.
+
+    Output times are still hard stops, if TSTOP mode is required
+    (see CvodeSettings_setTStop) and for adjoint runs.
+*/
+
+SBML_ODESOLVER_API void CvodeSettings_setDenseOutput(cvodeSettings_t *set, int i)
+{
+  set->DenseOutput = i;
+}
+
 /** Sets integration switches in cvodeSettings. WARNING: this
     function's type signature will change with time, as new settings
     will be required for other solvers!
@@ -1001,6 +1106,14 @@ SBML_ODESOLVER_API int CvodeSettings_getCompileFunctions(cvodeSettings_t *set)
   return set->compileFunctions;
 }
 
+/** returns the number of threads evaluating the ODEs, the Jacobian
+    and the vector operations of CVODES
+*/
+SBML_ODESOLVER_API int CvodeSettings_getThreads(cvodeSettings_t *set)
+{
+  return set->nthreads;
+}
+
 /** returns whether the CVODE integrator will be freed and restarted eveytime a event occurs
 */
 SBML_ODESOLVER_API int CvodeSettings_getResetCvodeOnEvent(cvodeSettings_t *set)
@@ -1008,14 +1121,18 @@ SBML_ODESOLVER_API int CvodeSettings_getResetCvodeOnEvent(cvodeSettings_t *set)
   return set->ResetCvodeOnEvent;
 }
 
-/** Get non-linear solver method (BDF or ADAMS-MOULTON)
+/** Get non-linear solver method (BDF, ADAMS-MOULTON, AUTO, RK45
+    or ROSENBROCK)
 */
 
 SBML_ODESOLVER_API const char *CvodeSettings_getMethod(const cvodeSettings_t *set)
 {
   static const char *meth[] = {
     "BDF",
-    "ADAMS-MOULTON"
+    "ADAMS-MOULTON",
+    "AUTO",
+    "RK45",
+    "ROSENBROCK"
   };
   return meth[set->CvodeMethod];
 }
@@ -1061,6 +1178,40 @@ SBML_ODESOLVER_API int CvodeSettings_getIndefinitely(cvodeSettings_t *set)
 }
 
 
+/** Returns 1, if output values are interpolated from CVODES internal
+    steps (dense output) and 0 if CVODES returns at each output time
+*/
+
+SBML_ODESOLVER_API int CvodeSettings_getDenseOutput(cvodeSettings_t *set)
+{
+  return set->DenseOutput;
+}
+
+
+/** Returns the memory budget in bytes for the forward phase of the
+    adjoint solver, 0 if checkpoints are set every nSaveSteps steps
+*/
+
+SBML_ODESOLVER_API double CvodeSettings_getAdjMemory(cvodeSettings_t *set)
+{
+  return set->AdjMemory;
+}
+
+
+/** Get the linear solver of the backward phase of the adjoint
+    solver (DENSE or SPGMR)
+*/
+
+SBML_ODESOLVER_API const char *CvodeSettings_getAdjLinearSolver(const cvodeSettings_t *set)
+{
+  static const char *solver[] = {
+    "DENSE",
+    "SPGMR"
+  };
+  return solver[set->AdjLinearSolver];
+}
+
+
 /** Returns 1, if integration should stop upon an event trigger
     and 0 if integration should continue after evaluation of
     event assignments
@@ -0,0 +1,531 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup snapshot Snapshots of the Integrator State
+  \ingroup integrator
+  \brief This module contains functions to capture the state of a
+  forward integration run and to continue from it later, in the same
+  or in another integratorInstance of the same model.
+
+  A snapshot holds the time, all values, sensitivities, quadratures,
+  event trigger flags and the step size of the solver. Restoring it
+  re-initializes the solver at the captured time. The built-in
+  one-step solvers continue exactly as the captured instance would,
+  CVODES restarts at order 1 with the captured step size. Snapshots
+  can be written to a file, e.g. to continue long runs after a crash.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cvodes/cvodes.h>
+#include <nvector/nvector_serial.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/odeModel.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/cvodeSolver.h"
+#include "sbmlsolver/rkSolver.h"
+#include "sbmlsolver/integratorSnapshot.h"
+
+/* first line of snapshot files */
+#define SNAPSHOT_HEADER "SOSlib-integrator-snapshot"
+#define SNAPSHOT_VERSION 1
+
+static N_Vector IntegratorInstance_getQuadrature(integratorInstance_t *,
+						 int *);
+static int IntegratorSnapshot_allocate(integratorSnapshot_t *);
+static void IntegratorSnapshot_writeDoubles(FILE *, const char *,
+					    const double *, int);
+static int IntegratorSnapshot_readLabel(FILE *, const char *);
+static int IntegratorSnapshot_readDoubles(FILE *, const char *,
+					  double *, int);
+
+
+/** Captures the state of a forward integration run.
+
+    Returns a new snapshot, to be freed by IntegratorSnapshot_free,
+    or NULL on failure. The snapshot shares the odeModel of the
+    integratorInstance, which must not be freed before the snapshot
+    has been restored. The stored time course (see
+    IntegratorInstance_getResults) is not part of the snapshot.
+*/
+
+SBML_ODESOLVER_API integratorSnapshot_t *IntegratorInstance_snapshot(integratorInstance_t *engine)
+{
+  int i, j;
+  long int nst;
+  N_Vector q;
+  integratorSnapshot_t *snap;
+  cvodeData_t *data = engine->data;
+  cvodeSolver_t *solver = engine->solver;
+
+  if ( engine->AdjointPhase )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Snapshots are not available for the backward phase "
+		      "of the adjoint solver.");
+    return NULL;
+  }
+
+  ASSIGN_NEW_MEMORY(snap, integratorSnapshot_t, NULL);
+  snap->om = engine->om;
+  snap->neq = data->neq;
+  snap->nvalues = data->nvalues;
+  snap->nevents = data->nevents;
+  snap->nsens =
+    engine->os != NULL && data->sensitivity != NULL ? data->nsens : 0;
+  snap->nfim = data->FIM != NULL ? data->nsens : 0;
+  q = IntegratorInstance_getQuadrature(engine, &(snap->quadrature));
+  snap->nq = q != NULL ? NV_LENGTH_S(q) : 0;
+
+  if ( !IntegratorSnapshot_allocate(snap) )
+  {
+    IntegratorSnapshot_free(snap);
+    return NULL;
+  }
+
+  snap->t = solver->t;
+  snap->tout = solver->tout;
+  snap->iout = solver->iout;
+  for ( i=0; i<snap->nvalues; i++ )
+    snap->value[i] = data->value[i];
+  for ( i=0; i<snap->neq; i++ )
+    for ( j=0; j<snap->nsens; j++ )
+      snap->sensitivity[i*snap->nsens + j] = data->sensitivity[i][j];
+  for ( i=0; i<snap->nfim; i++ )
+    for ( j=0; j<snap->nfim; j++ )
+      snap->FIM[i*snap->nfim + j] = data->FIM[i][j];
+  for ( i=0; i<snap->nevents; i++ )
+    snap->trigger[i] = data->trigger[i];
+  snap->steadystate = data->steadystate;
+
+  /* step size and order of a running solver, otherwise the
+     solver will choose its initial step size */
+  snap->stiff = solver->stiff;
+  if ( engine->isValid && snap->neq > 0 )
+  {
+    if ( IntegratorInstance_useRKSolver(engine) )
+    {
+      if ( solver->rk != NULL )
+	snap->h = solver->rk->h;
+    }
+    else if ( solver->cvode_mem != NULL &&
+	      CVodeGetNumSteps(solver->cvode_mem, &nst) == CV_SUCCESS &&
+	      nst > 0 )
+    {
+      CVodeGetCurrentStep(solver->cvode_mem, &(snap->h));
+      CVodeGetLastOrder(solver->cvode_mem, &(snap->order));
+      /* quadratures of continuous data are integrated by CVODES */
+      if ( q != NULL && engine->opt->observation_data_type == 0 &&
+	   CVodeGetQuadDky(solver->cvode_mem, solver->t, 0, q)
+	   != CV_SUCCESS )
+      {
+	SolverError_error(ERROR_ERROR_TYPE,
+			  SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+			  "Snapshot: the quadratures are not available at "
+			  "time %g", solver->t);
+	IntegratorSnapshot_free(snap);
+	return NULL;
+      }
+    }
+  }
+  for ( i=0; i<snap->nq; i++ )
+    snap->q[i] = NV_Ith_S(q, i);
+
+  return snap;
+}
+
+
+/** Continues from a snapshot: sets the time and state of the
+    integratorInstance and re-initializes its solver.
+
+    The integratorInstance must be of the same odeModel as the
+    captured instance (or, for snapshots read from a file, of a model
+    with the same numbers of values and events), with the same
+    sensitivity settings. The integration can then be continued via
+    the IntegratorInstance_integrate* functions. Returns 1 on
+    success, 0 otherwise.
+*/
+
+SBML_ODESOLVER_API int IntegratorInstance_restore(integratorInstance_t *engine, const integratorSnapshot_t *snap)
+{
+  int i, j, quadrature, flag;
+  N_Vector q;
+  cvodeData_t *data = engine->data;
+  cvodeSolver_t *solver = engine->solver;
+  cvodeSettings_t *opt = engine->opt;
+
+  if ( (snap->om != NULL && snap->om != engine->om) ||
+       snap->neq != data->neq || snap->nvalues != data->nvalues ||
+       snap->nevents != data->nevents )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_ATTEMPTING_TO_COPY_VARIABLE_STATE_BETWEEN_INSTANCES_OF_DIFFERENT_MODELS,
+		      "Attempting to restore a snapshot of a different "
+		      "model");
+    return 0;
+  }
+
+  if ( snap->nsens !=
+       (engine->os != NULL && data->sensitivity != NULL ? data->nsens : 0) )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Attempting to restore a snapshot with %d "
+		      "sensitivities into an integrator with other "
+		      "sensitivity settings", snap->nsens);
+    return 0;
+  }
+
+  if ( engine->AdjointPhase || opt->DoAdjoint )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Snapshots can not be restored for the adjoint "
+		      "solver, as its checkpoints are not captured.");
+    return 0;
+  }
+
+  if ( !opt->Indefinitely && snap->iout > solver->nout + 1 )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Attempting to restore a snapshot after output "
+		      "step %d into an integrator with %d output steps",
+		      snap->iout - 1, solver->nout);
+    return 0;
+  }
+
+  /* time and values */
+  solver->t0 = solver->t = snap->t;
+  solver->tout = snap->tout;
+  solver->iout = snap->iout;
+  data->currenttime = snap->t;
+  for ( i=0; i<snap->nvalues; i++ )
+    data->value[i] = snap->value[i];
+  data->allRulesUpdated = 0;
+  for ( i=0; i<snap->neq; i++ )
+    for ( j=0; j<snap->nsens; j++ )
+      data->sensitivity[i][j] = snap->sensitivity[i*snap->nsens + j];
+  if ( data->FIM != NULL && snap->nfim == data->nsens )
+    for ( i=0; i<snap->nfim; i++ )
+      for ( j=0; j<snap->nfim; j++ )
+	data->FIM[i][j] = snap->FIM[i*snap->nfim + j];
+
+  /* events */
+  for ( i=0; i<snap->nevents; i++ )
+    data->trigger[i] = snap->trigger[i];
+  data->steadystate = snap->steadystate;
+  CvodeData_scheduleEvents(data);
+
+  /* re-initialize the solver at the captured time */
+  solver->stiff = snap->stiff;
+  engine->isValid = 0;
+  if ( snap->neq == 0 )
+    return 1;
+
+  if ( IntegratorInstance_useRKSolver(engine) )
+  {
+    if ( !IntegratorInstance_createRKSolverStructures(engine) )
+      return 0;
+    solver->rk->h = snap->h;
+    return 1;
+  }
+
+  solver->hin = snap->h;
+  if ( !IntegratorInstance_createCVODESolverStructures(engine) )
+    return 0;
+
+  /* quadratures are started from 0 by the solver initialization */
+  q = IntegratorInstance_getQuadrature(engine, &quadrature);
+  if ( q != NULL && quadrature == snap->quadrature &&
+       NV_LENGTH_S(q) == snap->nq )
+  {
+    for ( i=0; i<snap->nq; i++ )
+      NV_Ith_S(q, i) = snap->q[i];
+    flag = CVodeQuadReInit(solver->cvode_mem, q);
+    CVODE_HANDLE_ERROR(&flag, "CVodeQuadReInit", 1);
+  }
+
+  return 1;
+}
+
+
+/** Creates a new integratorInstance of the same odeModel and
+    settings, which continues from the current state of the passed
+    integratorInstance.
+
+    The time course stored so far is copied to the new instance. Both
+    instances can be integrated independently afterwards, e.g. to
+    compare interventions after a common initial phase. Returns the
+    new integratorInstance or NULL on failure.
+*/
+
+SBML_ODESOLVER_API integratorInstance_t *IntegratorInstance_fork(integratorInstance_t *engine)
+{
+  int i, j, k, nout;
+  integratorSnapshot_t *snap;
+  integratorInstance_t *copy;
+  cvodeResults_t *source, *target;
+
+  snap = IntegratorInstance_snapshot(engine);
+  if ( snap == NULL )
+    return NULL;
+
+  copy = IntegratorInstance_create(engine->om, engine->opt);
+  if ( copy == NULL || !IntegratorInstance_restore(copy, snap) )
+  {
+    IntegratorInstance_free(copy);
+    IntegratorSnapshot_free(snap);
+    return NULL;
+  }
+  IntegratorSnapshot_free(snap);
+
+  /* copy the time course up to the current time */
+  source = engine->results;
+  target = copy->results;
+  if ( source != NULL && target != NULL )
+  {
+    nout = source->nout;
+    target->nout = nout;
+    for ( k=0; k<=nout; k++ )
+      target->time[k] = source->time[k];
+    for ( i=0; i<target->nvalues; i++ )
+      for ( k=0; k<=nout; k++ )
+	target->value[i][k] = source->value[i][k];
+    if ( source->sensitivity != NULL && target->sensitivity != NULL )
+      for ( i=0; i<target->neq; i++ )
+	for ( j=0; j<target->nsens; j++ )
+	  for ( k=0; k<=nout; k++ )
+	    target->sensitivity[i][j][k] = source->sensitivity[i][j][k];
+  }
+
+  return copy;
+}
+
+
+/** Returns the time of a snapshot
+*/
+
+SBML_ODESOLVER_API double IntegratorSnapshot_getTime(const integratorSnapshot_t *snap)
+{
+  return snap->t;
+}
+
+
+/** Writes a snapshot to a file, as text with all digits.
+
+    Returns 1 on success and 0 if writing failed.
+*/
+
+SBML_ODESOLVER_API int IntegratorSnapshot_write(const integratorSnapshot_t *snap, FILE *f)
+{
+  int i;
+
+  fprintf(f, "%s %d\n", SNAPSHOT_HEADER, SNAPSHOT_VERSION);
+  fprintf(f, "dimensions %d %d %d %d %d %d %d\n", snap->neq, snap->nvalues,
+	  snap->nsens, snap->nevents, snap->quadrature, snap->nq,
+	  snap->nfim);
+  fprintf(f, "time %.17g %.17g %d\n", snap->t, snap->tout, snap->iout);
+  fprintf(f, "solver %.17g %d %d %d\n", snap->h, snap->order,
+	  snap->stiff, snap->steadystate);
+  IntegratorSnapshot_writeDoubles(f, "values", snap->value, snap->nvalues);
+  IntegratorSnapshot_writeDoubles(f, "sensitivities", snap->sensitivity,
+				  snap->neq * snap->nsens);
+  IntegratorSnapshot_writeDoubles(f, "quadratures", snap->q, snap->nq);
+  IntegratorSnapshot_writeDoubles(f, "FIM", snap->FIM,
+				  snap->nfim * snap->nfim);
+  fprintf(f, "triggers");
+  for ( i=0; i<snap->nevents; i++ )
+    fprintf(f, " %d", snap->trigger[i]);
+  fprintf(f, "\n");
+
+  if ( ferror(f) )
+  {
+    SolverError_error(ERROR_ERROR_TYPE, SOLVER_ERROR_OPEN_FILE,
+		      "Writing the integrator snapshot failed");
+    return 0;
+  }
+  return 1;
+}
+
+
+/** Reads a snapshot written by IntegratorSnapshot_write.
+
+    Returns a new snapshot, to be freed by IntegratorSnapshot_free, or
+    NULL if the file is not a valid snapshot. The snapshot can be
+    restored into an integratorInstance of the model it was taken
+    from.
+*/
+
+SBML_ODESOLVER_API integratorSnapshot_t *IntegratorSnapshot_read(FILE *f)
+{
+  int i, version, ok;
+  integratorSnapshot_t *snap;
+
+  ASSIGN_NEW_MEMORY(snap, integratorSnapshot_t, NULL);
+
+  ok = IntegratorSnapshot_readLabel(f, SNAPSHOT_HEADER) &&
+    fscanf(f, "%d", &version) == 1 && version == SNAPSHOT_VERSION &&
+    IntegratorSnapshot_readLabel(f, "dimensions") &&
+    fscanf(f, "%d %d %d %d %d %d %d", &(snap->neq), &(snap->nvalues),
+	   &(snap->nsens), &(snap->nevents), &(snap->quadrature),
+	   &(snap->nq), &(snap->nfim)) == 7 &&
+    snap->neq >= 0 && snap->nvalues >= snap->neq && snap->nsens >= 0 &&
+    snap->nevents >= 0 && snap->nq >= 0 && snap->nfim >= 0 &&
+    IntegratorSnapshot_allocate(snap) &&
+    IntegratorSnapshot_readLabel(f, "time") &&
+    fscanf(f, "%lf %lf %d", &(snap->t), &(snap->tout), &(snap->iout)) == 3 &&
+    IntegratorSnapshot_readLabel(f, "solver") &&
+    fscanf(f, "%lf %d %d %d", &(snap->h), &(snap->order), &(snap->stiff),
+	   &(snap->steadystate)) == 4 &&
+    IntegratorSnapshot_readDoubles(f, "values", snap->value, snap->nvalues) &&
+    IntegratorSnapshot_readDoubles(f, "sensitivities", snap->sensitivity,
+				   snap->neq * snap->nsens) &&
+    IntegratorSnapshot_readDoubles(f, "quadratures", snap->q, snap->nq) &&
+    IntegratorSnapshot_readDoubles(f, "FIM", snap->FIM,
+				   snap->nfim * snap->nfim) &&
+    IntegratorSnapshot_readLabel(f, "triggers");
+
+  for ( i=0; ok && i<snap->nevents; i++ )
+    ok = fscanf(f, "%d", &(snap->trigger[i])) == 1;
+
+  if ( !ok )
+  {
+    SolverError_error(ERROR_ERROR_TYPE, SOLVER_ERROR_OPEN_FILE,
+		      "Reading the integrator snapshot failed, the "
+		      "file is not a valid snapshot");
+    IntegratorSnapshot_free(snap);
+    return NULL;
+  }
+
+  return snap;
+}
+
+
+/** Frees a snapshot
+*/
+
+SBML_ODESOLVER_API void IntegratorSnapshot_free(integratorSnapshot_t *snap)
+{
+  if ( snap == NULL )
+    return;
+
+  free(snap->value);
+  free(snap->sensitivity);
+  free(snap->q);
+  free(snap->FIM);
+  free(snap->trigger);
+  free(snap);
+}
+
+
+/* returns the active quadrature vector of the CVODES solver and
+   its type (see integratorSnapshot_t), or NULL */
+static N_Vector IntegratorInstance_getQuadrature(integratorInstance_t *engine,
+						 int *quadrature)
+{
+  cvodeSolver_t *solver = engine->solver;
+
+  *quadrature = 0;
+  if ( solver->q != NULL )
+    *quadrature = 1;
+  else if ( solver->qS != NULL )
+    *quadrature = 2;
+  else if ( solver->qFIM != NULL )
+    *quadrature = 3;
+
+  return *quadrature == 1 ? solver->q :
+    *quadrature == 2 ? solver->qS : *quadrature == 3 ? solver->qFIM : NULL;
+}
+
+
+/* allocates the arrays of a snapshot for its dimensions,
+   returns 1 on success and 0 on failure */
+static int IntegratorSnapshot_allocate(integratorSnapshot_t *snap)
+{
+  if ( snap->nvalues > 0 )
+    ASSIGN_NEW_MEMORY_BLOCK(snap->value, snap->nvalues, double, 0);
+  if ( snap->neq * snap->nsens > 0 )
+    ASSIGN_NEW_MEMORY_BLOCK(snap->sensitivity, snap->neq * snap->nsens,
+			    double, 0);
+  if ( snap->nq > 0 )
+    ASSIGN_NEW_MEMORY_BLOCK(snap->q, snap->nq, double, 0);
+  if ( snap->nfim > 0 )
+    ASSIGN_NEW_MEMORY_BLOCK(snap->FIM, snap->nfim * snap->nfim, double, 0);
+  if ( snap->nevents > 0 )
+    ASSIGN_NEW_MEMORY_BLOCK(snap->trigger, snap->nevents, int, 0);
+  return 1;
+}
+
+
+/* writes a labelled line of n doubles */
+static void IntegratorSnapshot_writeDoubles(FILE *f, const char *label,
+					    const double *x, int n)
+{
+  int i;
+
+  fprintf(f, "%s", label);
+  for ( i=0; i<n; i++ )
+    fprintf(f, " %.17g", x[i]);
+  fprintf(f, "\n");
+}
+
+
+/* reads the next word and compares it with label,
+   returns 1 if they are equal and 0 otherwise */
+static int IntegratorSnapshot_readLabel(FILE *f, const char *label)
+{
+  char word[64];
+
+  return fscanf(f, " %63s", word) == 1 && strcmp(word, label) == 0;
+}
+
+
+/* reads a labelled line of n doubles,
+   returns 1 on success and 0 on failure */
+static int IntegratorSnapshot_readDoubles(FILE *f, const char *label,
+					  double *x, int n)
+{
+  int i;
+
+  if ( !IntegratorSnapshot_readLabel(f, label) )
+    return 0;
+  for ( i=0; i<n; i++ )
+    if ( fscanf(f, "%lf", &(x[i])) != 1 )
+      return 0;
+  return 1;
+}
+
+/*! @} */
+/* End of file */
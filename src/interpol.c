@@ -11,9 +11,29 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+
+#ifdef HAVE_SYS_STAT_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+
 #include "sbmlsolver/util.h"
 #include "sbmlsolver/solverError.h"
 #include "private/data.h"
@@ -55,6 +75,10 @@ void free_data(time_series_t* ts)
     free(ts->mess);
     free(ts->warn); 
 
+    /* free spline coefficients */
+    free(ts->spline_var);
+    free(ts->coeff);
+
     /* free */
     free(ts);
 
@@ -141,23 +165,565 @@ void test_interpol(time_series_t* ts)
 
 /* ------------------------------------------------------------------------ */
 
-/** given a file name and a variable list, read_data reads time series
-    data from the file, (but only for variables in the list) stores
-    the data according to the index in the variable list, calculates
-    the second derivatives for spline interpolation, and returns a
-    pointer to the created data structure. */
+/* The data file is read into memory once, by mmap where available
+   and by a single fread otherwise, and parsed in one pass: the header
+   line is located, and all following data rows are tokenized in
+   place, without per-line allocation.  Large files are split into
+   blocks of whole lines which are parsed by concurrent threads. */
+
+/* files larger than this are parsed by several threads */
+#define READ_DATA_PARALLEL_SIZE (1<<22)
+/* minimal number of bytes per parsing thread */
+#define READ_DATA_BLOCK_SIZE    (1<<20)
+/* upper bound for the number of parsing threads */
+#define READ_DATA_MAX_THREADS   16
+
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\r')
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+/* contents of a data file */
+typedef struct data_file {
+    char   *buf;     /* file contents (not '\0' terminated) */
+    size_t size;     /* number of bytes in buf */
+    int    mapped;   /* 1 if buf is mmap'ed, 0 if allocated */
+} data_file_t;
+
+/* data rows parsed from a contiguous part of a data file */
+typedef struct data_block {
+    const char *begin;    /* first byte of the block, at a line start */
+    const char *end;      /* one past the last byte of the block */
+    int        n_col;     /* number of requested columns */
+    const int  *col;      /* requested columns, in ascending order */
+    int        n_row;     /* number of parsed rows */
+    int        capacity;  /* number of allocated rows */
+    double     *row;      /* n_row x (n_col+1) values, row by row */
+    int        error;     /* 0: ok, 1: column missing, 2: no number,
+			     3: out of memory */
+    const char *where;    /* line at which the error occured */
+} data_block_t;
+
+/* exact powers of ten, used by the fast path of parse_double */
+static const double pow10_exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-time_series_t *read_data(const char *file, int n_var, char **var)
+/* ------------------------------------------------------------------------ */
+
+/* reads the complete file into df, returns 1 on success */
+
+static int data_file_open(const char *file, data_file_t *df)
 {
-    int i;
-    char *name;
+    FILE *fp;
+    long size;
+
+    df->buf = NULL;
+    df->size = 0;
+    df->mapped = 0;
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && \
+    defined(HAVE_SYS_STAT_H) && defined(HAVE_FCNTL_H) && defined(HAVE_UNISTD_H)
+    {
+	int fd;
+	struct stat st;
+	void *p;
+
+	if ( (fd = open(file, O_RDONLY)) == -1 )
+	    return 0;
+	if ( fstat(fd, &st) == 0 && st.st_size > 0 )
+	    {
+		p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+			 fd, 0);
+		if ( p != MAP_FAILED )
+		    {
+			df->buf = p;
+			df->size = (size_t)st.st_size;
+			df->mapped = 1;
+		    }
+	    }
+	close(fd);
+	if ( df->mapped )
+	    return 1;
+	/* empty files and special files are read by stdio */
+    }
+#endif
 
-    int n_data;      /* number of relevant data columns */
-    int *col;        /* positions of relevant columns in data file */
-    int *index;      /* corresponding indices in variable list */
+    if ( (fp = fopen(file, "rb")) == NULL )
+	return 0;
+    if ( fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 ||
+	 fseek(fp, 0, SEEK_SET) != 0 )
+	{
+	    fclose(fp);
+	    return 0;
+	}
+    df->buf = malloc((size_t)size + 1);
+    if ( df->buf == NULL )
+	{
+	    fclose(fp);
+	    SolverError_error(FATAL_ERROR_TYPE, SOLVER_ERROR_NO_MORE_MEMORY_AVAILABLE,
+			      "read_data(): no memory for file %s", file);
+	    return 0;
+	}
+    df->size = fread(df->buf, 1, (size_t)size, fp);
+    fclose(fp);
+
+    return 1;
+}
+
+/* releases the file contents */
+
+static void data_file_close(data_file_t *df)
+{
+    if ( df->buf == NULL ) return;
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && \
+    defined(HAVE_SYS_STAT_H) && defined(HAVE_FCNTL_H) && defined(HAVE_UNISTD_H)
+    if ( df->mapped )
+	munmap(df->buf, df->size);
+    else
+#endif
+	free(df->buf);
+    df->buf = NULL;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* returns the end of the line starting at p, i.e. the position of
+   the next '\n' or end */
+
+static const char *line_end(const char *p, const char *end)
+{
+    const char *q;
+
+    q = memchr(p, '\n', (size_t)(end - p));
+    return q != NULL ? q : end;
+}
+
+static const char *skip_blanks(const char *p, const char *end)
+{
+    while ( p < end && IS_BLANK(*p) ) p++;
+    return p;
+}
+
+static const char *skip_token(const char *p, const char *end)
+{
+    while ( p < end && !IS_BLANK(*p) && *p != '\n' ) p++;
+    return p;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* parse_double converts the token starting at p into *v and returns 1,
+   or returns 0 if the token does not start with a number.  Decimal
+   numbers with at most 15 significant digits and a decimal exponent
+   of at most 22 are converted exactly by a single multiplication or
+   division; everything else (long mantissas, large exponents, inf,
+   nan) is passed on to strtod.  Values that underflow to a denormal
+   or zero are accepted, values that overflow are not.  As with
+   scan_double, trailing characters of the token are ignored. */
+
+static int parse_double(const char *p, const char *end, double *v)
+{
+    const char *s, *tend;
+    double m;
+    int neg, nd, e, ex, eneg, any, ok;
+    char tmp[64], *buf, *endp;
+    size_t len;
+
+    tend = skip_token(p, end);
+    s = p;
+    neg = 0;
+    if ( s < tend && (*s == '-' || *s == '+') )
+	{
+	    neg = (*s == '-');
+	    s++;
+	}
+
+    /* mantissa digits, leading zeros are not significant */
+    m = 0.0;
+    nd = 0;
+    e = 0;
+    any = 0;
+    while ( s < tend && IS_DIGIT(*s) )
+	{
+	    if ( nd > 0 || *s != '0' )
+		{
+		    m = 10.0 * m + (*s - '0');
+		    nd++;
+		}
+	    any = 1;
+	    s++;
+	}
+    if ( s < tend && *s == '.' )
+	{
+	    s++;
+	    while ( s < tend && IS_DIGIT(*s) )
+		{
+		    if ( nd > 0 || *s != '0' )
+			{
+			    m = 10.0 * m + (*s - '0');
+			    nd++;
+			}
+		    e--;
+		    any = 1;
+		    s++;
+		}
+	}
+    if ( !any )
+	goto fallback;
+
+    /* exponent */
+    if ( s < tend && (*s == 'e' || *s == 'E') )
+	{
+	    s++;
+	    eneg = 0;
+	    if ( s < tend && (*s == '-' || *s == '+') )
+		{
+		    eneg = (*s == '-');
+		    s++;
+		}
+	    if ( s == tend || !IS_DIGIT(*s) )
+		goto fallback;
+	    ex = 0;
+	    while ( s < tend && IS_DIGIT(*s) )
+		{
+		    if ( ex < 10000 ) ex = 10 * ex + (*s - '0');
+		    s++;
+		}
+	    e += eneg ? -ex : ex;
+	}
+
+    if ( s != tend || nd > 15 )
+	goto fallback;
+
+    if ( nd == 0 )
+	*v = 0.0;
+    else if ( e < -22 || e > 22 )
+	goto fallback;
+    else if ( e < 0 )
+	*v = m / pow10_exact[-e];
+    else
+	*v = m * pow10_exact[e];
+    if ( neg ) *v = -*v;
+    return 1;
+
+ fallback:
+    len = (size_t)(tend - p);
+    if ( len == 0 )
+	return 0;
+    buf = tmp;
+    if ( len >= sizeof(tmp) && (buf = malloc(len + 1)) == NULL )
+	return 0;
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    errno = 0;
+    *v = strtod(buf, &endp);
+    ok = endp != buf &&
+	!(errno == ERANGE && (*v == HUGE_VAL || *v == -HUGE_VAL));
+    if ( buf != tmp )
+	free(buf);
+    return ok;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* finds the header line in the buffer, finds the columns of the
+   variables in the header line, returns the number of found columns
+   and sets *body to the line following the header line; works like
+   read_header_line */
+
+static int parse_header(const char *p, const char *end, const char **body,
+			int n_var, char **var, int *col, int *index)
+{
+    const char *eol, *tok, *tend;
+    int i, j, count;
+    int *flag; /* flag for found variables */
+
+    /* find header line */
+    for ( ; p < end; p = (eol < end) ? eol + 1 : end )
+	{
+	    eol = line_end(p, end);
+	    tok = skip_blanks(p, eol);
+	    tend = skip_token(tok, eol);
+
+	    /* header line found */
+	    if ( tend - tok == 2 && strncmp(tok, "#t", 2) == 0 )
+		break;
+
+	    /* skip empty lines and comment lines, exit otherwise */
+	    if ( tok != eol && *tok != '#' )
+		fatal(stderr, "read_data(): read_header_line(): "
+		      "no header line found");
+	}
+    if ( p == end )
+	fatal(stderr, "read_data(): read_header_line(): no header line found");
+
+    ASSIGN_NEW_MEMORY_BLOCK(flag, n_var, int, 0);
+
+    /* read other columns */
+    count = 0;
+    for ( i=1; (tok = skip_blanks(tend, eol)) != eol; i++ )
+	{
+	    tend = skip_token(tok, eol);
+
+	    /* find column name in variable list */
+	    for ( j=0; j<n_var; j++ )
+		if ( strlen(var[j]) == (size_t)(tend - tok) &&
+		     strncmp(tok, var[j], tend - tok) == 0 )
+		    break;
+
+	    /* column name found */
+	    if ( j != n_var )
+		{
+		    col[count]   = i;
+		    index[count] = j;
+		    count++;
+		    flag[j] = 1;
+		}
+	}
+
+    for ( i=0; i<n_var; i++ )
+	if ( flag[i] == 0 )
+	    Warn(stderr, "read_data(): read_header_line(): "
+		 "no column for variable %s found", var[i]);
+
+    free(flag);
+
+    *body = (eol < end) ? eol + 1 : end;
+    return count;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* reads column 0 and the columns col[0..n_col-1] of the data row
+   starting at p into v[0..n_col], returns 0 on success, 1 if a column
+   is missing and 2 if a column does not contain a number */
+
+static int parse_row(const char *p, const char *eol,
+		     int n_col, const int *col, double *v)
+{
+    int j, k, c;
+
+    k = 0;
+    for ( j=-1; j<n_col; j++ )
+	{
+	    c = (j < 0) ? 0 : col[j];
+	    while ( k < c )
+		{
+		    p = skip_blanks(skip_token(p, eol), eol);
+		    if ( p == eol )
+			return 1;
+		    k++;
+		}
+	    if ( !parse_double(p, eol, &v[j+1]) )
+		return 2;
+	}
+    return 0;
+}
+
+/* parses all data rows of a block, skipping empty and comment lines;
+   has the signature of a thread start routine */
+
+static void *parse_block(void *arg)
+{
+    data_block_t *b = (data_block_t *) arg;
+    const char *p, *eol, *tok;
+    double *row;
+    int width, capacity;
 
-    int n_time;      /* number of data rows */
+    width = b->n_col + 1;
+    for ( p=b->begin; p<b->end; p = (eol < b->end) ? eol + 1 : b->end )
+	{
+	    eol = line_end(p, b->end);
+	    tok = skip_blanks(p, eol);
+	    if ( tok == eol || *tok == '#' )
+		continue;
 
+	    if ( b->n_row == b->capacity )
+		{
+		    capacity = b->capacity ? 2 * b->capacity : 1024;
+		    row = realloc(b->row, (size_t)capacity * width * sizeof(double));
+		    if ( row == NULL )
+			{
+			    b->error = 3;
+			    b->where = p;
+			    return NULL;
+			}
+		    b->row = row;
+		    b->capacity = capacity;
+		}
+
+	    b->error = parse_row(tok, eol, b->n_col, b->col,
+				 b->row + (size_t)b->n_row * width);
+	    if ( b->error != 0 )
+		{
+		    b->where = p;
+		    return NULL;
+		}
+	    b->n_row++;
+	}
+
+    return NULL;
+}
+
+/* returns the number of blocks the data part of a file of the
+   given size is split into */
+
+static int count_blocks(size_t size)
+{
+    long n;
+
+    n = 1;
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H) && \
+    defined(HAVE_SYSCONF) && defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+    if ( size >= READ_DATA_PARALLEL_SIZE )
+	{
+	    n = sysconf(_SC_NPROCESSORS_ONLN);
+	    if ( n > (long)(size / READ_DATA_BLOCK_SIZE) )
+		n = (long)(size / READ_DATA_BLOCK_SIZE);
+	    if ( n > READ_DATA_MAX_THREADS )
+		n = READ_DATA_MAX_THREADS;
+	    if ( n < 1 )
+		n = 1;
+	}
+#else
+    (void) size;
+#endif
+    return (int) n;
+}
+
+/* parses the data rows between body and the end of the file into
+   ts->time and ts->data[index[j]], allocates ts->time, ts->data and
+   ts->data2 and sets ts->n_time; returns 1 on success */
+
+static int parse_body(const data_file_t *df, const char *body,
+		      int n_col, const int *col, const int *index,
+		      time_series_t *ts)
+{
+    const char *end, *p;
+    data_block_t *block;
+    int i, j, k, r, n_block, n_time, width, ok;
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+    pthread_t *thread;
+    int *started;
+#endif
+
+    end = df->buf + df->size;
+    n_block = count_blocks((size_t)(end - body));
+
+    ASSIGN_NEW_MEMORY_BLOCK(block, n_block, data_block_t, 0);
+
+    /* split the data part at line boundaries */
+    p = body;
+    for ( i=0; i<n_block; i++ )
+	{
+	    block[i].begin = p;
+	    if ( i == n_block - 1 )
+		p = end;
+	    else
+		{
+		    p = body + (size_t)(end - body) / n_block * (i + 1);
+		    if ( p < block[i].begin )
+			p = block[i].begin;
+		    p = line_end(p, end);
+		    if ( p < end ) p++;
+		}
+	    block[i].end = p;
+	    block[i].n_col = n_col;
+	    block[i].col = col;
+	    block[i].n_row = 0;
+	    block[i].capacity = 0;
+	    block[i].row = NULL;
+	    block[i].error = 0;
+	    block[i].where = NULL;
+	}
+
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+    if ( n_block > 1 )
+	{
+	    ASSIGN_NEW_MEMORY_BLOCK(thread, n_block, pthread_t, 0);
+	    ASSIGN_NEW_MEMORY_BLOCK(started, n_block, int, 0);
+	    for ( i=1; i<n_block; i++ )
+		started[i] =
+		    pthread_create(&thread[i], NULL, parse_block, &block[i]) == 0;
+	    parse_block(&block[0]);
+	    for ( i=1; i<n_block; i++ )
+		{
+		    if ( started[i] )
+			pthread_join(thread[i], NULL);
+		    else
+			parse_block(&block[i]);
+		}
+	    free(thread);
+	    free(started);
+	}
+    else
+#endif
+	parse_block(&block[0]);
+
+    /* report the first error */
+    ok = 1;
+    for ( i=0; i<n_block && ok; i++ )
+	{
+	    if ( block[i].error == 0 )
+		continue;
+	    ok = 0;
+	    r = 1;
+	    for ( p=df->buf; p<block[i].where; p++ )
+		if ( *p == '\n' ) r++;
+	    if ( block[i].error == 3 )
+		SolverError_error(FATAL_ERROR_TYPE,
+				  SOLVER_ERROR_NO_MORE_MEMORY_AVAILABLE,
+				  "read_data(): no memory for data rows");
+	    else
+		fatal(stderr, "read_data(): line %d: %s", r,
+		      block[i].error == 1 ? "too few columns" :
+		      "could not convert column to double");
+	}
+
+    /* collect data rows */
+    n_time = 0;
+    for ( i=0; i<n_block; i++ )
+	n_time += block[i].n_row;
+    ts->n_time = n_time;
+
+    if ( ok )
+	{
+	    ASSIGN_NEW_MEMORY_BLOCK(ts->time, n_time, double, 0);
+	    for ( j=0; j<n_col; j++ )
+		if ( ts->data[index[j]] == NULL )
+		    {
+			ASSIGN_NEW_MEMORY_BLOCK(ts->data[index[j]],  n_time, double, 0);
+			ASSIGN_NEW_MEMORY_BLOCK(ts->data2[index[j]], n_time, double, 0);
+		    }
+
+	    width = n_col + 1;
+	    k = 0;
+	    for ( i=0; i<n_block; i++ )
+		for ( r=0; r<block[i].n_row; r++, k++ )
+		    {
+			const double *v = block[i].row + (size_t)r * width;
+			ts->time[k] = v[0];
+			for ( j=0; j<n_col; j++ )
+			    ts->data[index[j]][k] = v[j+1];
+		    }
+	}
+
+    for ( i=0; i<n_block; i++ )
+	free(block[i].row);
+    free(block);
+
+    return ok;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* allocates a time series for the variable list, without data */
+
+static time_series_t *time_series_create(int n_var, char **var)
+{
+    int i;
+    char *name;
     time_series_t *ts;
 
     /* alloc mem */
@@ -166,8 +732,8 @@ time_series_t *read_data(const char *file, int n_var, char **var)
     /* alloc mem for index lists */
     ts->n_var = n_var;
     ASSIGN_NEW_MEMORY_BLOCK(ts->var,   n_var, char *,   NULL);
-    ASSIGN_NEW_MEMORY_BLOCK(ts->data,  n_var, double *, NULL); 
-    ASSIGN_NEW_MEMORY_BLOCK(ts->data2, n_var, double *, NULL);    
+    ASSIGN_NEW_MEMORY_BLOCK(ts->data,  n_var, double *, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(ts->data2, n_var, double *, NULL);
 
     /* initialize index lists */
     for ( i=0; i<n_var; i++ )
@@ -179,57 +745,320 @@ time_series_t *read_data(const char *file, int n_var, char **var)
 	    ts->data2[i] = NULL;
 	}
 
+    ts->time = NULL;
+    ts->mess = NULL;
+    ts->warn = NULL;
+    ts->n_spline = 0;
+    ts->spline_var = NULL;
+    ts->coeff = NULL;
+
+    return ts;
+}
+
+/* sets interpolation type, interval and warnings of a time series
+   with data */
+
+static int time_series_init(time_series_t *ts)
+{
+    int i;
+
+    /* initialize interpolation type */
+    ts->type = 3;
+    ts->last = 0;
+
+    /* alloc mem for warnings */
+    ASSIGN_NEW_MEMORY_BLOCK(ts->mess, 2, char *, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ts->warn, 2, int,    0);
+
+    /* initialize warnings */
+    ts->mess[0] = "argument out of range (left) ";
+    ts->mess[1] = "argument out of range (right)";
+    for ( i=0; i<2; i++ )
+	ts->warn[i] = 0;
+
+    return 1;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/** given a file name and a variable list, read_data reads time series
+    data from the file, (but only for variables in the list) stores
+    the data according to the index in the variable list, calculates
+    the second derivatives for spline interpolation, and returns a
+    pointer to the created data structure. */
+
+time_series_t *read_data(const char *file, int n_var, char **var)
+{
+    int i;
+    data_file_t df;
+    const char *body;
+
+    int n_data;      /* number of relevant data columns */
+    int *col;        /* positions of relevant columns in data file */
+    int *index;      /* corresponding indices in variable list */
+
+    time_series_t *ts;
+
+    /* read file */
+    if ( !data_file_open(file, &df) )
+	fatal(stderr, "read_data(): file %s not found", file);
+
+    ts = time_series_create(n_var, var);
+    if ( ts == NULL )
+	{
+	    data_file_close(&df);
+	    return NULL;
+	}
+
     /* alloc temp mem for column info */
     ASSIGN_NEW_MEMORY_BLOCK(col,   n_var, int, NULL);
     ASSIGN_NEW_MEMORY_BLOCK(index, n_var, int, NULL);
 
     /* read header line */
-    n_data = read_header_line(file, n_var, var, col, index);
+    n_data = parse_header(df.buf, df.buf + df.size, &body,
+			  n_var, var, col, index);
     ts->n_data = n_data;
-	
-    /* count number of lines */
-    n_time = read_columns(file, 0, NULL, NULL, NULL);
-    ts->n_time = n_time;
-
-    /* alloc mem for data */
-    for ( i=0; i<n_data; i++ )
-	{
-	    ASSIGN_NEW_MEMORY_BLOCK(ts->data[index[i]],  n_time, double, NULL);
-	    ASSIGN_NEW_MEMORY_BLOCK(ts->data2[index[i]], n_time, double, NULL);
-	}
-    ASSIGN_NEW_MEMORY_BLOCK(ts->time,  n_time, double, NULL);
 
     /* read data */
-    read_columns(file, n_data, col, index, ts);
+    i = parse_body(&df, body, n_data, col, index, ts);
 
     /* free temp mem */
     free(col);
     free(index);
+    data_file_close(&df);
+
+    if ( !i || !time_series_init(ts) )
+	{
+	    free_data(ts);
+	    return NULL;
+	}
 
-    /* initialize interpolation type */
-    ts->type = 3;
     /* calculate second derivatives */
     for ( i=0; i<n_var; i++ )
 	if ( ts->data[i] != NULL )
 	    {
 		if ( spline(ts->n_time, ts->time, ts->data[i], ts->data2[i]) != 1 )
-		    return NULL; /* ran out of memory during spline routine */
+		    {
+			/* ran out of memory during spline routine */
+			free_data(ts);
+			return NULL;
+		    }
 	    }
 
-    ts->last = 0;
-    
-    /* alloc mem for warnings */
-    ASSIGN_NEW_MEMORY_BLOCK(ts->mess, 2, char *, NULL);
-    ASSIGN_NEW_MEMORY_BLOCK(ts->warn, 2, int,    NULL);   
+    /* tabulate spline coefficients per interval */
+    if ( spline_coefficients(ts) != 1 )
+	{
+	    free_data(ts);
+	    return NULL;
+	}
 
-    /* initialize warnings */
-    ts->mess[0] = "argument out of range (left) ";
-    ts->mess[1] = "argument out of range (right)";
-    for ( i=0; i<2; i++ )
-	ts->warn[i] = 0;  
+    return ts;
+
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* Binary cache of a time series: after a magic string and a version
+   number, the cache stores a byte order and type size probe, size and
+   modification time of the original data file, the dimensions, the
+   variable list and the data and second derivative arrays, all in
+   native representation.  A cache is only used if all of these match,
+   otherwise read_data_cached falls back to the data file. */
+
+#define DATA_CACHE_MAGIC   "SOSLIBTS"
+#define DATA_CACHE_VERSION 1
+#define DATA_CACHE_PROBE   0x01020304
+
+/* gets size and modification time of the data file */
+
+static int data_file_stamp(const char *file, double *stamp)
+{
+#ifdef HAVE_SYS_STAT_H
+    struct stat st;
+
+    if ( stat(file, &st) != 0 )
+	return 0;
+    stamp[0] = (double) st.st_size;
+    stamp[1] = (double) st.st_mtime;
+    return 1;
+#else
+    (void) file;
+    (void) stamp;
+    return 0;
+#endif
+}
+
+#define CACHE_WRITE(ptr, size, n, fp) \
+    if ( fwrite((ptr), (size), (n), (fp)) != (size_t)(n) ) goto error
+#define CACHE_READ(ptr, size, n, fp) \
+    if ( fread((ptr), (size), (n), (fp)) != (size_t)(n) ) goto error
+
+/** writes the time series ts, read from the data file `file', into
+    the binary cache file `cache', and returns 1 on success and 0
+    on failure. */
+
+int write_data_cache(const time_series_t *ts, const char *file,
+		     const char *cache)
+{
+    FILE *fp;
+    int i, len, head[8];
+    double stamp[2];
+
+    if ( !data_file_stamp(file, stamp) )
+	return 0;
+    if ( (fp = fopen(cache, "wb")) == NULL )
+	return 0;
+
+    head[0] = DATA_CACHE_VERSION;
+    head[1] = DATA_CACHE_PROBE;
+    head[2] = (int) sizeof(double);
+    head[3] = (int) sizeof(int);
+    head[4] = ts->n_var;
+    head[5] = ts->n_data;
+    head[6] = ts->n_time;
+    head[7] = ts->type;
+
+    CACHE_WRITE(DATA_CACHE_MAGIC, 1, 8, fp);
+    CACHE_WRITE(head, sizeof(int), 8, fp);
+    CACHE_WRITE(stamp, sizeof(double), 2, fp);
+    for ( i=0; i<ts->n_var; i++ )
+	{
+	    len = (int) strlen(ts->var[i]);
+	    CACHE_WRITE(&len, sizeof(int), 1, fp);
+	    CACHE_WRITE(ts->var[i], 1, len, fp);
+	    len = ts->data[i] != NULL;
+	    CACHE_WRITE(&len, sizeof(int), 1, fp);
+	}
+    CACHE_WRITE(ts->time, sizeof(double), ts->n_time, fp);
+    for ( i=0; i<ts->n_var; i++ )
+	if ( ts->data[i] != NULL )
+	    {
+		CACHE_WRITE(ts->data[i],  sizeof(double), ts->n_time, fp);
+		CACHE_WRITE(ts->data2[i], sizeof(double), ts->n_time, fp);
+	    }
+
+    if ( fclose(fp) != 0 )
+	{
+	    remove(cache);
+	    return 0;
+	}
+    return 1;
+
+ error:
+    fclose(fp);
+    remove(cache);
+    return 0;
+}
+
+/* loads a time series for the variable list from the binary cache,
+   returns NULL if the cache does not exist or does not match the data
+   file and variable list */
+
+static time_series_t *load_data_cache(const char *file, const char *cache,
+				      int n_var, char **var)
+{
+    FILE *fp;
+    int i, len, has_data, head[8];
+    char magic[8], *name;
+    double stamp[2], cached[2];
+    time_series_t *ts;
+
+    if ( !data_file_stamp(file, stamp) )
+	return NULL;
+    if ( (fp = fopen(cache, "rb")) == NULL )
+	return NULL;
+
+    ts = NULL;
+    name = NULL;
+    CACHE_READ(magic, 1, 8, fp);
+    CACHE_READ(head, sizeof(int), 8, fp);
+    CACHE_READ(cached, sizeof(double), 2, fp);
+    if ( memcmp(magic, DATA_CACHE_MAGIC, 8) != 0 ||
+	 head[0] != DATA_CACHE_VERSION || head[1] != DATA_CACHE_PROBE ||
+	 head[2] != (int) sizeof(double) || head[3] != (int) sizeof(int) ||
+	 head[4] != n_var || head[6] < 0 ||
+	 cached[0] != stamp[0] || cached[1] != stamp[1] )
+	goto error;
+
+    if ( (ts = time_series_create(n_var, var)) == NULL )
+	goto error;
+    ts->n_data = head[5];
+    ts->n_time = head[6];
+
+    /* variable list must match, allocate data for cached variables */
+    for ( i=0; i<n_var; i++ )
+	{
+	    CACHE_READ(&len, sizeof(int), 1, fp);
+	    if ( len != (int) strlen(var[i]) )
+		goto error;
+	    if ( (name = malloc(len + 1)) == NULL )
+		goto error;
+	    CACHE_READ(name, 1, len, fp);
+	    name[len] = '\0';
+	    if ( strcmp(name, var[i]) != 0 )
+		goto error;
+	    free(name);
+	    name = NULL;
+
+	    CACHE_READ(&has_data, sizeof(int), 1, fp);
+	    if ( has_data )
+		{
+		    ts->data[i]  = malloc(ts->n_time * sizeof(double));
+		    ts->data2[i] = malloc(ts->n_time * sizeof(double));
+		    if ( ts->data[i] == NULL || ts->data2[i] == NULL )
+			goto error;
+		}
+	}
+
+    if ( (ts->time = malloc(ts->n_time * sizeof(double))) == NULL )
+	goto error;
+    CACHE_READ(ts->time, sizeof(double), ts->n_time, fp);
+    for ( i=0; i<n_var; i++ )
+	if ( ts->data[i] != NULL )
+	    {
+		CACHE_READ(ts->data[i],  sizeof(double), ts->n_time, fp);
+		CACHE_READ(ts->data2[i], sizeof(double), ts->n_time, fp);
+	    }
+    fclose(fp);
+
+    if ( !time_series_init(ts) || spline_coefficients(ts) != 1 )
+	{
+	    free_data(ts);
+	    return NULL;
+	}
+    ts->type = head[7];
+
+    return ts;
+
+ error:
+    fclose(fp);
+    free(name);
+    free_data(ts);
+    return NULL;
+}
+
+#undef CACHE_WRITE
+#undef CACHE_READ
+
+/** like read_data, but first tries to load the time series from the
+    binary cache file `cache'.  If the cache is missing or outdated,
+    the data file is parsed and the cache is (re)written. */
+
+time_series_t *read_data_cached(const char *file, const char *cache,
+				int n_var, char **var)
+{
+    time_series_t *ts;
+
+    ts = load_data_cache(file, cache, n_var, var);
+    if ( ts != NULL )
+	return ts;
+
+    ts = read_data(file, n_var, var);
+    if ( ts != NULL && !write_data_cache(ts, file, cache) )
+	Warn(stderr, "read_data_cached(): could not write cache file %s",
+	     cache);
 
     return ts;
-    
 }
 
 /* ------------------------------------------------------------------------ */
@@ -242,72 +1071,22 @@ time_series_t *read_data(const char *file, int n_var, char **var)
 
 int read_header_line(const char *file, int n_var, char **var,
 		     int *col, int *index)
-{    
-    FILE *fp;
-    char *line, *token;
-    
-    int i, j;
-    int count; /* counter for relevant columns */
-    int *flag; /* flag for found variables */
-    
+{
+    data_file_t df;
+    const char *body;
+    int count;
+
     /* open file */
-    if ( (fp = fopen(file, "r")) == NULL )
+    if ( !data_file_open(file, &df) )
 	fatal(stderr, "read_data(): read_header_line(): file not found");
-    
-    /* find header line */
-    for ( i=0; (line = get_line(fp)) != NULL; i++ ) {
-	
-	/* read column 0 */
-	token = strtok(line, " ");
-	
-	/* header line found */	
-	if (token != NULL && strcmp(token, "#t") == 0)
-	    break;
-	
-	/* skip empty lines and comment lines */
-	if ( token == NULL || *token == '#' ) {
-	    free(line);
-	    continue;
-	}	
-	/* exit otherwise */
-	else
-	    fatal(stderr, "read_data(): read_header_line(): no header line found");
-    }
-    
-    /* reset counter and flag */
-    count = 0;
-    flag = (int *) space(n_var * sizeof(int));
-    for ( i=0; i<n_var; i++)
-	flag[i] = 0;
-    
-    /* read other columns */
-    for ( i=1; (token = strtok(NULL, " ")) != NULL; i++ ) {
-	
-	/* find column name in variable list */
-	for ( j=0; j<n_var; j++ )
-	    if ( strcmp(token, var[j]) == 0 )
-		break;
-	
-	/* column name found */
-	if ( j != n_var ) {
-	    col[count]   = i;
-	    index[count] = j;
-	    count++;
-	    flag[j] = 1;
-	}
-    }
 
-    for ( i=0; i<n_var; i++)
-	if ( flag[i] == 0 )
-	    Warn(stderr, "read_data(): read_header_line(): no column for variable %s found", var[i]);   
-	
-    /* free */
-    free(line);
-    free(flag);
-    fclose(fp);
-	
+    count = parse_header(df.buf, df.buf + df.size, &body,
+			 n_var, var, col, index);
+
+    data_file_close(&df);
+
     return count;
-	
+
 }
 
 /* ------------------------------------------------------------------------ */
@@ -440,6 +1219,218 @@ double call(int i, double x, time_series_t *ts)
 
 /* ------------------------------------------------------------------------ */
 
+/* given time series data with second derivatives, */
+/* spline_coefficients tabulates the cubic polynomial */
+/* of each interval for all variables with data, */
+/* such that the values of all variables at one time point */
+/* can be evaluated from one contiguous block of coefficients. */
+
+int spline_coefficients(time_series_t *ts)
+{
+    int i, k, v, n;
+    double h, *p;
+
+    free(ts->spline_var);
+    free(ts->coeff);
+    ts->spline_var = NULL;
+    ts->coeff = NULL;
+
+    n = 0;
+    for ( i=0; i<ts->n_var; i++ )
+	if ( ts->data[i] != NULL ) n++;
+    ts->n_spline = n;
+
+    ASSIGN_NEW_MEMORY_BLOCK(ts->spline_var, n, int, 0);
+    for ( i=0, v=0; i<ts->n_var; i++ )
+	if ( ts->data[i] != NULL ) ts->spline_var[v++] = i;
+
+    if ( ts->n_time < 2 )
+	return 1;
+
+    ASSIGN_NEW_MEMORY_BLOCK(ts->coeff, 4 * (ts->n_time-1) * n, double, 0);
+    p = ts->coeff;
+    for ( k=0; k<ts->n_time-1; k++ )
+	{
+	    h = ts->time[k+1] - ts->time[k];
+	    for ( v=0; v<n; v++ )
+		{
+		    const double *y  = ts->data[ts->spline_var[v]];
+		    const double *y2 = ts->data2[ts->spline_var[v]];
+		    p[0] = y[k];
+		    p[1] = (y[k+1] - y[k]) / h - h * (2.0 * y2[k] + y2[k+1]) / 6.0;
+		    p[2] = y2[k] / 2.0;
+		    p[3] = (y2[k+1] - y2[k]) / (6.0 * h);
+		    p += 4;
+		}
+	}
+
+    return 1;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* given time series data, */
+/* create_cursor returns a new interpolation state for the data, */
+/* i.e. an interval cursor and a buffer for the values at one time point; */
+/* each integrator uses its own cursor on the shared data, */
+/* which must not change, so the spline coefficients must */
+/* have been tabulated when the data were read. */
+
+ts_cursor_t *create_cursor(time_series_t *ts)
+{
+    ts_cursor_t *c;
+
+    if ( ts->spline_var == NULL )
+	{
+	    SolverError_error(FATAL_ERROR_TYPE,
+			      SOLVER_ERROR_AST_EVALUATION_FAILED_MISSING_VALUE,
+			      "create_cursor(): no spline coefficients "
+			      "for the time series");
+	    return NULL;
+	}
+
+    ASSIGN_NEW_MEMORY(c, ts_cursor_t, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(c->value, ts->n_var, double, NULL);
+    c->ts = ts;
+    c->last = 0;
+    c->valid = 0;
+    c->t = 0.0;
+    c->warn[0] = 0;
+    c->warn[1] = 0;
+
+    return c;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* free_cursor reports the warnings of the cursor and frees it; */
+/* the time series may already be freed. */
+
+void free_cursor(ts_cursor_t *c)
+{
+    if ( c == NULL ) return;
+
+    if ( c->warn[0] != 0 )
+	Warn(stderr, "call_cursor(): argument out of range (left): %d times\n",
+	     c->warn[0]);
+    if ( c->warn[1] != 0 )
+	Warn(stderr, "call_cursor(): argument out of range (right): %d times\n",
+	     c->warn[1]);
+
+    free(c->value);
+    free(c);
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* given a cursor and a time point x, */
+/* locate returns the interval of x like hunt, */
+/* but first tries the current and the next interval, */
+/* which is the common case for monotonic integration time. */
+
+static int locate(const ts_cursor_t *c, double x)
+{
+    int n, k;
+    const double *xs;
+
+    n = c->ts->n_time;
+    xs = c->ts->time;
+
+    if ( x < xs[0] )
+	return -1;
+    if ( x >= xs[n-1] )
+	return n-1;
+
+    k = c->last;
+    if ( k < 0 ) k = 0;
+    if ( k > n-2 ) k = n-2;
+
+    if ( x >= xs[k] )
+	{
+	    if ( x < xs[k+1] )
+		return k;
+	    if ( k+2 < n && x < xs[k+2] )
+		return k+1;
+	}
+    else if ( x >= xs[k-1] )
+	return k-1; /* k > 0, as x >= xs[0] */
+
+    hunt(n, xs, x, &k);
+    return k;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* given a time point x and a cursor, */
+/* call_all evaluates the cubic-spline interpolation */
+/* of all variables with data at the time point */
+/* into c->value (and stores the interpolation interval). */
+
+void call_all(double x, ts_cursor_t *c)
+{
+    time_series_t *ts;
+    int k, v, n, nv;
+    double h;
+    const double *p;
+
+    ts = c->ts;
+    n = ts->n_time;
+    nv = ts->n_spline;
+    if ( n == 0 )
+	fatal(stderr, "call_all(): no data stored");
+
+    k = locate(c, x);
+    c->last = k;
+
+    /* check if x is out of range (and warn) */
+    if ( k == -1 )
+	{
+	    for ( v=0; v<nv; v++ )
+		c->value[ts->spline_var[v]] = ts->data[ts->spline_var[v]][0];
+	    c->warn[0]++;
+	}
+    else if ( k == n-1 )
+	{
+	    for ( v=0; v<nv; v++ )
+		c->value[ts->spline_var[v]] = ts->data[ts->spline_var[v]][n-1];
+	    c->warn[1]++;
+	}
+    /* interpolate all variables from the coefficients of interval k */
+    else
+	{
+	    h = x - ts->time[k];
+	    p = ts->coeff + 4 * k * nv;
+	    for ( v=0; v<nv; v++, p+=4 )
+		c->value[ts->spline_var[v]] = p[0] + h * (p[1] + h * (p[2] + h * p[3]));
+	}
+
+    c->t = x;
+    c->valid = 1;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* given a variable index i, a time point x, and a cursor, */
+/* call_cursor returns the cubic-spline interpolation i(x) */
+/* like call; all variables are interpolated at once */
+/* and reused for subsequent calls at the same time point. */
+
+double call_cursor(int i, double x, ts_cursor_t *c)
+{
+    /* check if data is available */
+    if ( i < 0 || i >= c->ts->n_var )
+	fatal(stderr, "call_cursor(): variable index out of range");
+    if ( c->ts->data[i] == NULL )
+	fatal(stderr, "call_cursor(): no data stored for variable");
+
+    if ( !c->valid || x != c->t )
+	call_all(x, c);
+
+    return c->value[i];
+}
+
+/* ------------------------------------------------------------------------ */
+
 /* given arrays x[0..n-1] and y[0..n-1] */
 /* tabulating a function f, i.e. y[i] = f(x[i]) */
 /* spline returns y2[0..n-1] */
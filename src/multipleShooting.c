@@ -0,0 +1,538 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup multipleShooting Multiple Shooting
+  \ingroup integrator
+  \brief This module splits the time horizon of the time series data
+  of an integratorInstance into segments that are integrated
+  concurrently.
+
+  The segments end at data time points. Each has its own
+  integratorInstance of the shared odeModel and, except for the
+  first, its own initial state, which becomes an unknown of the fit
+  besides the parameters. An integration of all segments yields the
+  weighted data residuals and the continuity residuals between
+  consecutive segments, with their derivatives from the forward
+  sensitivities with respect to the parameters and the segment
+  initial states, for a least-squares estimator.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/integratorInstance.h"
+#include "sbmlsolver/compiler.h"
+#include "sbmlsolver/threadPool.h"
+#include "sbmlsolver/interpol.h"
+#include "sbmlsolver/multipleShooting.h"
+
+static int MultipleShooting_createSegment(multipleShooting_t *, int s,
+					  integratorInstance_t *, char **ids);
+static void MultipleShooting_task(void *, int);
+static int ShootingSegment_integrate(multipleShooting_t *, int s);
+
+
+/** Creates the multiple shooting of the time series data of the
+    integratorInstance (see IntegratorInstance_readTimeSeriesData)
+    for the nrparams parameters with the given ids.
+
+    The data time points after the initial time are split into
+    nsegments segments of about equal numbers of time points. The
+    first segment starts at the initial values of the model; the
+    initial states of the other segments are taken from the data at
+    their initial times, where available, and from the initial values
+    otherwise. Each segment gets an integratorInstance with the
+    settings of the integratorInstance, its data time points and
+    sensitivity analysis for its initial state and the parameters.
+    The residuals are weighted with the weights of
+    IntegratorInstance_setFIMweights, if they were set.
+
+    Models with events are not supported, as the event state at the
+    start of a segment is not known. Returns NULL on failure.
+*/
+
+SBML_ODESOLVER_API multipleShooting_t *IntegratorInstance_createMultipleShooting(integratorInstance_t *engine, int nrparams, char **ids, int nsegments)
+{
+  int i, j, s, first, ntimes;
+  odeModel_t *om = engine->om;
+  time_series_t *ts = om->time_series;
+  multipleShooting_t *ms;
+  shootingSegment_t *seg;
+  double x;
+
+  if ( ts == NULL )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_OBJECTIVE_FUNCTION_FAILED,
+		      "Multiple shooting requires time series data, "
+		      "see IntegratorInstance_readTimeSeriesData.");
+    return NULL;
+  }
+  if ( om->nevents > 0 || engine->opt->Indefinitely )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Multiple shooting is not available for models "
+		      "with events or indefinite integration.");
+    return NULL;
+  }
+
+  first = 0;
+  while ( first < ts->n_time && ts->time[first] <= 0.0 )
+    first++;
+  ntimes = ts->n_time - first;
+  if ( nsegments < 1 || nsegments > ntimes )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "%d segments requested for %d data time points "
+		      "after the initial time.", nsegments, ntimes);
+    return NULL;
+  }
+
+  ASSIGN_NEW_MEMORY(ms, multipleShooting_t, NULL);
+  ms->om = om;
+  ms->neq = om->neq;
+  ms->nrparams = nrparams;
+  ms->nsegments = nsegments;
+  ASSIGN_NEW_MEMORY_BLOCK(ms->vi, nrparams+1, variableIndex_t *, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(ms->p, nrparams+1, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(ms->weight, om->neq+1, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(ms->segment, nsegments, shootingSegment_t, NULL);
+
+  for ( j=0; j<nrparams; j++ )
+  {
+    ms->vi[j] = ODEModel_getVariableIndex(om, ids[j]);
+    /* initial values are unknowns of the segments already */
+    if ( ms->vi[j] != NULL && ms->vi[j]->index < om->neq + om->nass )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_REQUESTED_PARAMETER_NOT_FOUND,
+			"%s is not a constant parameter.", ids[j]);
+      VariableIndex_free(ms->vi[j]);
+      ms->vi[j] = NULL;
+    }
+    if ( ms->vi[j] == NULL )
+    {
+      MultipleShooting_free(ms);
+      return NULL;
+    }
+    ms->p[j] = om->values[ms->vi[j]->index];
+  }
+
+  for ( i=0; i<om->neq; i++ )
+    ms->weight[i] = engine->data->weights != NULL ?
+      sqrt(engine->data->weights[i]) : 1.0;
+
+  /* segment s ends at data time point first-1 + (s+1)*ntimes/S */
+  for ( s=0; s<nsegments; s++ )
+  {
+    seg = &ms->segment[s];
+    seg->first = s == 0 ? 0 : ms->segment[s-1].last + 1;
+    seg->last = first - 1 + (int) (((long) (s+1) * ntimes) / nsegments);
+    seg->t0 = s == 0 ? 0.0 : ts->time[seg->first-1];
+    seg->t1 = ts->time[seg->last];
+
+    ASSIGN_NEW_MEMORY_BLOCK(seg->x0, om->neq+1, double, NULL);
+    for ( i=0; i<om->neq; i++ )
+    {
+      seg->x0[i] = om->values[i];
+      if ( s == 0 || ts->data[i] == NULL )
+	continue;
+      /* missing values are NaN */
+      x = ts->data[i][seg->first-1];
+      if ( x == x )
+	seg->x0[i] = x;
+    }
+
+    if ( !MultipleShooting_createSegment(ms, s, engine, ids) )
+    {
+      MultipleShooting_free(ms);
+      return NULL;
+    }
+  }
+
+  return ms;
+}
+
+
+/** Sets the values of the parameters for the next integration
+*/
+
+SBML_ODESOLVER_API int MultipleShooting_setParameters(multipleShooting_t *ms, const double *p)
+{
+  int j;
+
+  for ( j=0; j<ms->nrparams; j++ )
+    ms->p[j] = p[j];
+
+  return 1;
+}
+
+
+/** Sets the initial state of a segment other than the first for the
+    next integration, i.e. the values of all ODE variables at its
+    initial time
+*/
+
+SBML_ODESOLVER_API int MultipleShooting_setState(multipleShooting_t *ms, int segment, const double *x)
+{
+  int i;
+
+  if ( segment < 1 || segment >= ms->nsegments )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "The initial state of segment %d can not be set.",
+		      segment);
+    return 0;
+  }
+
+  for ( i=0; i<ms->neq; i++ )
+    ms->segment[segment].x0[i] = x[i];
+
+  return 1;
+}
+
+
+/** Integrates all segments from their initial states with the
+    current parameters and computes the residuals and their
+    derivatives.
+
+    The segments are integrated concurrently in nthreads threads (the
+    number of processors if nthreads < 1). Returns 1 if all segments
+    were integrated successfully and 0 otherwise; the segments that
+    failed have completed set to 0.
+*/
+
+SBML_ODESOLVER_API int MultipleShooting_integrate(multipleShooting_t *ms, int nthreads)
+{
+  int s, nworkers, completed;
+  threadPool_t *pool;
+
+  nworkers = nthreads < 1 ? Compiler_getNumProcessors() : nthreads;
+  if ( nworkers > ms->nsegments )
+    nworkers = ms->nsegments;
+
+  pool = ThreadPool_create(nworkers);
+  if ( pool == NULL )
+    return 0;
+  ThreadPool_run(pool, ms->nsegments, MultipleShooting_task, ms);
+  ThreadPool_free(pool);
+
+  completed = 1;
+  for ( s=0; s<ms->nsegments; s++ )
+    completed = completed && ms->segment[s].completed;
+
+  return completed;
+}
+
+
+/** Returns the number of unknowns: the parameters and the initial
+    states of all but the first segment
+*/
+
+SBML_ODESOLVER_API int MultipleShooting_getNumUnknowns(const multipleShooting_t *ms)
+{
+  return ms->nrparams + (ms->nsegments - 1) * ms->neq;
+}
+
+
+/** Returns the number of residuals: the data residuals of all
+    segments and the continuity residuals between them
+*/
+
+SBML_ODESOLVER_API int MultipleShooting_getNumResiduals(const multipleShooting_t *ms)
+{
+  int s, n;
+
+  n = (ms->nsegments - 1) * ms->neq;
+  for ( s=0; s<ms->nsegments; s++ )
+    n += ms->segment[s].nres;
+
+  return n;
+}
+
+
+/** Writes the residuals of the last integration to r: the data
+    residuals of all segments, followed by the continuity residuals
+*/
+
+SBML_ODESOLVER_API void MultipleShooting_getResiduals(const multipleShooting_t *ms, double *r)
+{
+  int i, s, n;
+  shootingSegment_t *seg;
+
+  n = 0;
+  for ( s=0; s<ms->nsegments; s++ )
+  {
+    seg = &ms->segment[s];
+    for ( i=0; i<seg->nres; i++ )
+      r[n++] = seg->residual[i];
+  }
+  for ( s=0; s<ms->nsegments-1; s++ )
+    for ( i=0; i<ms->neq; i++ )
+      r[n++] = ms->segment[s].continuity[i];
+}
+
+
+/** Writes the Jacobian of the residuals with respect to the unknowns
+    to J, as a dense matrix with MultipleShooting_getNumResiduals
+    rows of MultipleShooting_getNumUnknowns values. The unknowns are
+    the parameters, followed by the initial states of the second to
+    last segment.
+*/
+
+SBML_ODESOLVER_API void MultipleShooting_getJacobian(const multipleShooting_t *ms, double *J)
+{
+  int i, j, k, s, n, nz, np = ms->nrparams, neq = ms->neq;
+  shootingSegment_t *seg;
+  double *row;
+
+  nz = MultipleShooting_getNumUnknowns(ms);
+  n = MultipleShooting_getNumResiduals(ms);
+  for ( k=0; k<n*nz; k++ )
+    J[k] = 0.0;
+
+  /* the initial state of segment s > 0 is at column np+(s-1)*neq */
+  n = 0;
+  for ( s=0; s<ms->nsegments; s++ )
+  {
+    seg = &ms->segment[s];
+    for ( k=0; k<seg->nres; k++ )
+    {
+      row = J + (size_t) n++ * nz;
+      for ( j=0; j<np; j++ )
+	row[j] = seg->dRdp[k*np+j];
+      if ( s > 0 )
+	for ( j=0; j<neq; j++ )
+	  row[np+(s-1)*neq+j] = seg->dRdx[k*neq+j];
+    }
+  }
+  for ( s=0; s<ms->nsegments-1; s++ )
+  {
+    seg = &ms->segment[s];
+    for ( i=0; i<neq; i++ )
+    {
+      row = J + (size_t) n++ * nz;
+      for ( j=0; j<np; j++ )
+	row[j] = seg->dCdp[i*np+j];
+      if ( s > 0 )
+	for ( j=0; j<neq; j++ )
+	  row[np+(s-1)*neq+j] = seg->dCdx[i*neq+j];
+      row[np+s*neq+i] = -1.0;
+    }
+  }
+}
+
+
+/** Frees the multiple shooting with the integratorInstances of its
+    segments
+*/
+
+SBML_ODESOLVER_API void MultipleShooting_free(multipleShooting_t *ms)
+{
+  int j, s;
+  shootingSegment_t *seg;
+
+  if ( ms == NULL )
+    return;
+
+  for ( s=0; s<ms->nsegments; s++ )
+  {
+    seg = &ms->segment[s];
+    if ( seg->ii != NULL )
+      IntegratorInstance_free(seg->ii);
+    if ( seg->opt != NULL )
+      CvodeSettings_free(seg->opt);
+    free(seg->x0);
+    free(seg->residual);
+    free(seg->dRdp);
+    free(seg->dRdx);
+    free(seg->continuity);
+    free(seg->dCdp);
+    free(seg->dCdx);
+  }
+  for ( j=0; j<ms->nrparams; j++ )
+    if ( ms->vi[j] != NULL )
+      VariableIndex_free(ms->vi[j]);
+  free(ms->vi);
+  free(ms->p);
+  free(ms->weight);
+  free(ms->segment);
+  free(ms);
+}
+
+
+/************* internal functions ************/
+
+/* creates the integratorInstance and the residual arrays of segment
+   s; the sensitivities are taken with respect to the initial state,
+   except for the first segment, and the parameters */
+static int MultipleShooting_createSegment(multipleShooting_t *ms, int s,
+					  integratorInstance_t *engine,
+					  char **ids)
+{
+  int i, j, k, nsens, neq = ms->neq, np = ms->nrparams;
+  shootingSegment_t *seg = &ms->segment[s];
+  time_series_t *ts = ms->om->time_series;
+  char **sensIDs;
+  int from;
+
+  seg->nres = 0;
+  for ( k=seg->first; k<=seg->last; k++ )
+    for ( i=0; i<neq; i++ )
+      if ( ts->data[i] != NULL && ts->data[i][k] == ts->data[i][k] )
+	seg->nres++;
+
+  ASSIGN_NEW_MEMORY_BLOCK(seg->residual, seg->nres+1, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(seg->dRdp, seg->nres*np+1, double, 0);
+  if ( s > 0 )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(seg->dRdx, seg->nres*neq+1, double, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(seg->dCdx, neq*neq+1, double, 0);
+  }
+  if ( s < ms->nsegments - 1 )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(seg->continuity, neq+1, double, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(seg->dCdp, neq*np+1, double, 0);
+  }
+
+  nsens = s > 0 ? neq + np : np;
+  ASSIGN_NEW_MEMORY_BLOCK(sensIDs, nsens+1, char *, 0);
+  for ( i=0; i<nsens-np; i++ )
+    sensIDs[i] = ms->om->names[i];
+  for ( j=0; j<np; j++ )
+    sensIDs[nsens-np+j] = ids[j];
+
+  /* the output times are the data time points after t0 */
+  from = s == 0 ? 0 : seg->first;
+  while ( ts->time[from] <= seg->t0 )
+    from++;
+  seg->opt = CvodeSettings_clone(engine->opt);
+  CvodeSettings_setTimeSeries(seg->opt, ts->time + from, seg->last - from + 1);
+  CvodeSettings_setHaltOnEvent(seg->opt, 0);
+  CvodeSettings_setHaltOnSteadyState(seg->opt, 0);
+  CvodeSettings_setStoreResults(seg->opt, 0);
+  CvodeSettings_unsetDoAdj(seg->opt);
+  CvodeSettings_unsetFIM(seg->opt);
+  /* the built-in solvers have no sensitivity analysis */
+  if ( seg->opt->CvodeMethod > 2 )
+    CvodeSettings_setMethod(seg->opt, 0, seg->opt->MaxOrder);
+  CvodeSettings_setSensitivity(seg->opt, 1);
+  CvodeSettings_setSensParams(seg->opt, sensIDs, nsens);
+  free(sensIDs);
+
+  /* created here, such that the threads only reset and integrate */
+  seg->ii = IntegratorInstance_create(ms->om, seg->opt);
+
+  return seg->ii != NULL;
+}
+
+
+/* integrates segment s, each segment has its own
+   integratorInstance */
+static void MultipleShooting_task(void *arg, int s)
+{
+  multipleShooting_t *ms = arg;
+
+  ms->segment[s].completed = ShootingSegment_integrate(ms, s);
+}
+
+
+/* integrates segment s from its initial state and writes its
+   residuals and their derivatives, returns 0 if the integration
+   failed */
+static int ShootingSegment_integrate(multipleShooting_t *ms, int s)
+{
+  int i, j, k, l, n, neq = ms->neq, np = ms->nrparams, off;
+  shootingSegment_t *seg = &ms->segment[s];
+  integratorInstance_t *engine = seg->ii;
+  cvodeData_t *data = engine->data;
+  time_series_t *ts = ms->om->time_series;
+  double w, **sens;
+
+  IntegratorInstance_reset(engine);
+  for ( j=0; j<np; j++ )
+    IntegratorInstance_setVariableValue(engine, ms->vi[j], ms->p[j]);
+  if ( s > 0 )
+  {
+    /* the solver takes the initial state from the data values */
+    for ( i=0; i<neq; i++ )
+      data->value[i] = seg->x0[i];
+    if ( !IntegratorInstance_setInitialTime(engine, seg->t0) )
+      return 0;
+  }
+
+  /* the columns of the parameters follow those of the initial state */
+  off = s > 0 ? neq : 0;
+  sens = data->sensitivity;
+  n = 0;
+  for ( k=seg->first; k<=seg->last; k++ )
+  {
+    /* data up to t0 of the first segment refer to the initial values */
+    if ( ts->time[k] > seg->t0 &&
+	 !IntegratorInstance_integrateOneStep(engine) )
+      return 0;
+
+    for ( i=0; i<neq; i++ )
+    {
+      if ( ts->data[i] == NULL || ts->data[i][k] != ts->data[i][k] )
+	continue;
+      w = ms->weight[i];
+      seg->residual[n] = w * (data->value[i] - ts->data[i][k]);
+      for ( j=0; j<np; j++ )
+	seg->dRdp[n*np+j] = w * sens[i][off+j];
+      for ( l=0; l<off; l++ )
+	seg->dRdx[n*neq+l] = w * sens[i][l];
+      n++;
+    }
+  }
+
+  /* continuity with the initial state of the next segment */
+  if ( s < ms->nsegments - 1 )
+    for ( i=0; i<neq; i++ )
+    {
+      seg->continuity[i] = data->value[i] - ms->segment[s+1].x0[i];
+      for ( j=0; j<np; j++ )
+	seg->dCdp[i*np+j] = sens[i][off+j];
+      for ( l=0; l<off; l++ )
+	seg->dCdx[i*neq+l] = sens[i][l];
+    }
+
+  return 1;
+}
+
+/*! @} */
+/* End of file */
@@ -37,28 +37,36 @@
 #include "config.h"
 #endif
 
-/*! \defgroup nullSolver KINSOL Root Finder:  f(x,p,t) = dx/dt = 0
+/*! \defgroup nullSolver Steady State Solver:  f(x,p,t) = dx/dt = 0
   \ingroup integrator
-  \brief NOT FUNCTIONAL YET: An interface to SUNDIALS KinSolver
-  to find a local root of a system of non-linear equations.
-
-  This code is working. It is, however, not functional. The
-  KinSolver interface could be used to locally search for steady
-  states. It would need better input settings. The example file
-  `findRoot' in the examples folder can be used to play with
-  settings and develop this functionality. Contact us, if you want
-  to help!
+  \brief Finds a steady state of the ODE system by a damped Newton
+  method with a direct solver for the linear systems.
+
+  Conservation laws, i.e. linear combinations of ODE variables that
+  are constant over time, are detected numerically from the ODEs
+  around the initial values. Each law replaces the ODE of one of its
+  variables, such that the Jacobian matrix of the Newton system is
+  not singular and the steady state keeps the conserved totals of
+  the initial values. The Jacobian matrix is evaluated from its
+  symbolic form (see CvodeSettings_setJacobian) or by difference
+  quotients.
+
+  If Newton's method doesn't converge from the initial values, the
+  solver falls back to pseudo-transient continuation, i.e. linearly
+  implicit Euler steps of growing size along the trajectory, and
+  retries Newton's method whenever the ODE values have sufficiently
+  decreased.
 */
 /** @{ */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <float.h>
 
-/* Header Files for CVODE */
-#include <kinsol/kinsol.h>
-#include <kinsol/kinsol_spgmr.h>
-#include <cvodes/cvodes_dense.h>
+#include <cvodes/cvodes.h>
 #include <nvector/nvector_serial.h>
+#include <sundials/sundials_dense.h>
 
 #include "sbmlsolver/cvodeData.h"
 #include "sbmlsolver/processAST.h"
@@ -68,299 +76,959 @@
 #include "sbmlsolver/cvodeSolver.h"
 #include "sbmlsolver/nullSolver.h"
 
+/* maximal Newton iterations from the initial values and from
+   iterates of pseudo-transient continuation */
+#define NS_MAXITER 50
+#define NS_POLISHITER 10
+/* minimal damping factor of the Newton step */
+#define NS_MINLAMBDA 1e-4
+/* number of samples in addition to neq, and relative threshold
+   for the detection of conservation laws */
+#define NS_NSAMPLES 3
+#define NS_LAWTOL 1e-9
+/* pseudo-transient continuation: relative change of the variables
+   in the first step, maximal relative change in a step, and bounds
+   of the growth of the step size */
+#define NS_PTC_CHANGE 0.1
+#define NS_PTC_MAXCHANGE 1.0
+#define NS_PTC_MINGROW 1.2
+#define NS_PTC_MAXGROW 10.0
 
-/* Prototypes of functions called by KINSOL */
-static int func(N_Vector y, N_Vector dy, void *data);
-static int JacV(N_Vector v, N_Vector Jv, N_Vector y,
-		booleantype *new_u, void *data);
+static int IntegratorInstance_nsSolve(integratorInstance_t *, int warm);
+static void IntegratorInstance_nsResetStatistics(integratorInstance_t *);
+static int IntegratorInstance_nsResidual(integratorInstance_t *,
+					 realtype *x, realtype *f);
+static int IntegratorInstance_nsFindConservationLaws(integratorInstance_t *);
+static int IntegratorInstance_nsNewton(integratorInstance_t *, int maxiter);
+static int IntegratorInstance_nsPseudoTransient(integratorInstance_t *);
+static int IntegratorInstance_nsIsFeasible(integratorInstance_t *);
+static realtype IntegratorInstance_nsNorm(nullSolver_t *, realtype *v);
+static realtype IntegratorInstance_nsMaxNorm(nullSolver_t *, realtype *v);
+static realtype IntegratorInstance_nsWrmsNorm(integratorInstance_t *,
+					      realtype *v, realtype *x);
 
 
-/* The Hot Stuff! */
-/** 
- */
+/** Searches a steady state f(x) = dx/dt = 0 of the ODE system,
+    starting from the current values, at the current time.
+
+    Returns 1 on success, where the current values are set to the
+    steady state, and 0 otherwise, where the current values are kept
+    and an error message is produced. The solver structures are set
+    invalid, such that a subsequent integration starts from the
+    steady state. Conserved totals are taken from the current values.
+    See IntegratorInstance_printNullSolverStatistics for the method
+    that converged.
+*/
 
 SBML_ODESOLVER_API int IntegratorInstance_nullSolver(integratorInstance_t *engine)
 {
-  int i, flag;
-  realtype *ydata = NULL;
-    
-  cvodeSolver_t *solver = engine->solver;
+  if ( !IntegratorInstance_createNullSolverStructures(engine) )
+    return 0;
+
+  IntegratorInstance_nsResetStatistics(engine);
+  return IntegratorInstance_nsSolve(engine, 0);
+}
+
+
+/** Searches steady states for a series of design points.
+
+    For each design point i, the integratorInstance is reset, the
+    nrparams variables vi (e.g. parameters or initial values) are set
+    to the values params[i], and the steady state is written to x[i],
+    an array of size neq (see ODEModel_getNeq). Newton's method starts
+    from the steady state of the previous design point, if that was
+    found, and otherwise proceeds as IntegratorInstance_nullSolver.
+    If the array converged is not NULL, converged[i] is set to 1 if
+    a steady state was found and to 0 otherwise, where x[i] contains
+    the initial values of design point i. Returns the number of design
+    points where a steady state was found.
+*/
+
+SBML_ODESOLVER_API int IntegratorInstance_nullSolverBatch(integratorInstance_t *engine, int nrparams, variableIndex_t **vi, int nrdesignpoints, double **params, double **x, int *converged)
+{
+  int i, j, found, success, warm;
+
+  if ( !IntegratorInstance_createNullSolverStructures(engine) )
+    return 0;
+
+  IntegratorInstance_nsResetStatistics(engine);
+  found = warm = 0;
+  for ( i=0; i<nrdesignpoints; i++ )
+  {
+    IntegratorInstance_reset(engine);
+    for ( j=0; j<nrparams; j++ )
+      IntegratorInstance_setVariableValue(engine, vi[j], params[i][j]);
+
+    success = IntegratorInstance_nsSolve(engine, warm);
+    for ( j=0; j<engine->om->neq; j++ )
+      x[i][j] = engine->data->value[j];
+    if ( converged != NULL )
+      converged[i] = success;
+
+    found += success;
+    warm = success;
+  }
+
+  return found;
+}
+
+
+/** Calculates the sensitivities dx/dp = -J^-1 df/dp of a steady
+    state at the current values.
+
+    The current values must be a steady state, found e.g. by
+    IntegratorInstance_nullSolver or by integration with
+    CvodeSettings_setHaltOnSteadyState. Sensitivity analysis must have
+    been initialized via CvodeSettings_setSensitivity (and optionally
+    CvodeSettings_setSensParams) before the integratorInstance was
+    created or reset. The result replaces the forward sensitivities
+    and is available via IntegratorInstance_getSensitivity.
+
+    df/dp is evaluated from the symbolic matrix, if it was constructed
+    (i.e. with the Jacobian matrix), and by difference quotients
+    otherwise. The Jacobian matrix of the system with conservation
+    laws (see IntegratorInstance_nullSolver) is factorized once for
+    all parameters. Sensitivities to initial values are only non-zero
+    via the conserved totals. Returns 1 on success and 0 if the
+    Jacobian matrix is singular or sensitivity analysis has not been
+    initialized.
+*/
+
+SBML_ODESOLVER_API int IntegratorInstance_steadyStateSensitivity(integratorInstance_t *engine)
+{
+  int i, j, k, neq, idx, flag;
+  realtype inc, save, srur, *b;
   cvodeData_t *data = engine->data;
-  odeModel_t *om = engine->om;
+  odeSense_t *os = engine->os;
+  nullSolver_t *ns;
 
-  /* IntegratorInstance_freeCVODESolverStructures(engine); */
-  if (!IntegratorInstance_createKINSolverStructures(engine))
+  if ( os == NULL || data->sensitivity == NULL )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Steady state sensitivities: sensitivity analysis "
+		      "has not been initialized, see "
+		      "CvodeSettings_setSensitivity.");
     return 0;
-    
-  /* !!!! calling KINSOL !!!! */
-  flag = KINSol(solver->cvode_mem, solver->y, KIN_LINESEARCH, 
-		solver->abstol, solver->abstol);
-  /* !!! should use different scalings, first is D*y second
-     is D*f(y) !!!*/
-
-  if ( flag != KIN_SUCCESS )
+  }
+
+  neq = engine->om->neq;
+  if ( neq == 0 )
+    return 1;
+
+  if ( !IntegratorInstance_createNullSolverStructures(engine) )
+    return 0;
+  ns = engine->solver->ns;
+
+  for ( i=0; i<neq; i++ )
+    ns->x0[i] = ns->x[i] = data->value[i];
+  if ( !IntegratorInstance_nsFindConservationLaws(engine) )
+    return 0;
+
+  /* factorize the Jacobian matrix of the reduced system */
+  if ( IntegratorInstance_nsRhs(ns, data, ns->x, ns->f) != 0 ||
+       !IntegratorInstance_nsJacobian(engine, ns->x, ns->f, 1) ||
+       denseGETRF(ns->J, neq, neq, ns->pivot) != 0 )
   {
     SolverError_error(ERROR_ERROR_TYPE,
-		      SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,	 
-		      "Null Solver not successful with flag %d.", flag);
-    /* return 0 ;  *//* Error */
+		      SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+		      "Steady state sensitivities: the Jacobian matrix is "
+		      "singular at time %g.", data->currenttime);
+    for ( i=0; i<neq; i++ )
+      data->value[i] = ns->x[i];
+    data->allRulesUpdated = 0;
+    return 0;
   }
-    
-  ydata = NV_DATA_S(solver->y);
 
-    
-  /* update cvodeData with foun steady state values */    
-  for ( i=0; i<om->neq; i++ )
+  /* df/dp into the sensitivity matrix, evaluated at the steady state */
+  if ( IntegratorInstance_nsRhs(ns, data, ns->x, ns->f) != 0 )
+    return 0;
+  for ( i=0; i<neq; i++ )
+    for ( j=0; j<os->nsens; j++ )
+      data->sensitivity[i][j] = 0.0;
+
+  if ( os->sensitivity )
   {
-    data->value[i] = ydata[i];
-#ifdef VERBOSE
-    printf("%s = %g,  f(%s): %g\n",
-	   om->names[i], data->value[i], om->names[i],
-	   evaluateAST(data->model->ode[i], data));
-#endif
+    for ( i=0; i<neq; i++ )
+      data->value[i] = ns->x[i];
+    for ( k=0; k<os->sparsesize; k++ )
+    {
+      nonzeroElem_t *nonzero = os->sensSparse[k];
+      data->sensitivity[nonzero->i][nonzero->j] =
+	evaluateAST(nonzero->ij, data);
+    }
+  }
+  else
+  {
+    srur = sqrt(UNIT_ROUNDOFF);
+    for ( j=0; j<os->nsens; j++ )
+    {
+      if ( os->index_sensP[j] == -1 )
+	continue;
+      idx = os->index_sens[j];
+      save = data->value[idx];
+      inc = srur * (fabs(save) > 0.0 ? fabs(save) : 1.0);
+      data->value[idx] = save + inc;
+      flag = IntegratorInstance_nsRhs(ns, data, ns->x, ns->ftrial);
+      data->value[idx] = save;
+      if ( flag != 0 )
+	return 0;
+      for ( i=0; i<neq; i++ )
+	data->sensitivity[i][j] = (ns->ftrial[i] - ns->f[i]) / inc;
+    }
+    /* restore assignment rules */
+    if ( IntegratorInstance_nsRhs(ns, data, ns->x, ns->f) != 0 )
+      return 0;
+  }
+
+  /* solve J dx/dp = -dG/dp, where the totals G of the conservation
+     laws only depend on initial values */
+  b = ns->dx;
+  for ( j=0; j<os->nsens; j++ )
+  {
+    for ( i=0; i<neq; i++ )
+      b[i] = -data->sensitivity[i][j];
+    for ( k=0; k<ns->ncons; k++ )
+      b[ns->dep[k]] = os->index_sensP[j] == -1 ?
+	ns->cons[k][os->index_sens[j]] : 0.0;
+    denseGETRS(ns->J, neq, ns->pivot, b);
+    for ( i=0; i<neq; i++ )
+      data->sensitivity[i][j] = b[i];
   }
-  /* IntegratorInstance_freeKINSolverStructures(engine); */
-  /* update data? */
-  return 1; /* correct ?*/
+
+  for ( i=0; i<neq; i++ )
+    data->value[i] = ns->x[i];
+  data->allRulesUpdated = 0;
+
+  return 1;
 }
 
 
-/************* CVODES integrator setup functions ************/
+/** Returns the number of conservation laws found in the last call
+    of the steady state solver
+*/
 
+SBML_ODESOLVER_API int IntegratorInstance_getNumConservationLaws(const integratorInstance_t *engine)
+{
+  if ( engine->solver->ns == NULL )
+    return 0;
+  return engine->solver->ns->ncons;
+}
 
-/* creates CVODES structures and fills cvodeSolver 
-   return 1 => success
-   return 0 => failure
+
+/** Prints some final statistics of the last call of the steady state
+    solver
 */
-int IntegratorInstance_createKINSolverStructures(integratorInstance_t *engine)
+
+SBML_ODESOLVER_API void IntegratorInstance_printNullSolverStatistics(const integratorInstance_t *engine, FILE *f)
 {
-  int i, flag, neq;
-  realtype *ydata, *scale, *constr;
-  N_Vector constraints;
-    
-  odeModel_t *om = engine->om;
-  cvodeData_t *data = engine->data;
+  nullSolver_t *ns = engine->solver->ns;
+
+  if ( ns == NULL )
+  {
+    fprintf(f, "## No statistics available.\n");
+    return;
+  }
+
+  fprintf(f, "\n## Steady State Solver Statistics:\n");
+  fprintf(f, "## conservation laws = %d\n", ns->ncons);
+  fprintf(f, "## nni = %-6ld nfe  = %-6ld nje = %ld\n",
+	  ns->nni, ns->nfe, ns->nje);
+  fprintf(f, "## nbt = %-6ld nptc = %ld\n", ns->nbt, ns->nptc);
+  if ( ns->method == 0 )
+    fprintf(f, "## not converged\n");
+  else
+    fprintf(f, "## converged by %s, max |dx/dt| = %g\n",
+	    ns->method == 1 ? "Newton's method" :
+	    "pseudo-transient continuation", ns->residual);
+}
+
+
+/** Prints some final statistics of the steady state solver, kept for
+    backwards compatibility, see
+    IntegratorInstance_printNullSolverStatistics
+*/
+
+SBML_ODESOLVER_API void IntegratorInstance_printKINSOLStatistics(integratorInstance_t *engine, FILE *f)
+{
+  IntegratorInstance_printNullSolverStatistics(engine, f);
+}
+
+
+/************* internal functions ************/
+
+/* creates the work arrays of the steady state solver, if not yet
+   available; returns 1 on success or 0 on failure */
+int IntegratorInstance_createNullSolverStructures(integratorInstance_t *engine)
+{
+  int neq;
+  nullSolver_t *ns;
   cvodeSolver_t *solver = engine->solver;
-  cvodeSettings_t *opt = engine->opt;
 
-  neq = engine->om->neq; /* number of equations */
+  neq = engine->om->neq;
+  if ( neq == 0 )
+    return 1;
 
-  /* construct jacobian, if wanted and not yet existing */
-  if ( opt->UseJacobian && om->jacob == NULL ) 
-    /* reset UseJacobian option, depending on success */
-    engine->UseJacobian = ODEModel_constructJacobian(om);
-  else if ( !opt->UseJacobian )
+  if ( solver->ns != NULL && solver->ns->neq != neq )
+    IntegratorInstance_freeNullSolverStructures(engine);
+
+  if ( solver->ns == NULL )
   {
-    /* free jacobian from former runs (not necessary, frees also
-       unsuccessful jacobians from former runs ) */
-    ODEModel_freeJacobian(om);
-    SolverError_error(WARNING_ERROR_TYPE,
-		      SOLVER_ERROR_MODEL_NOT_SIMPLIFIED,
-		      "Jacobian matrix construction skipped.");
-    engine->UseJacobian = om->jacobian;
+    ASSIGN_NEW_MEMORY(solver->ns, struct nullSolver, 0);
+    ns = solver->ns;
+    ns->neq = neq;
+    ASSIGN_NEW_MEMORY_BLOCK(ns->dep, neq, int, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->law, neq, int, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->pivot, neq, int, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->total, neq, realtype, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->x0, neq, realtype, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->x, neq, realtype, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->xp, neq, realtype, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->f, neq, realtype, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->dx, neq, realtype, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->xtrial, neq, realtype, 0);
+    ASSIGN_NEW_MEMORY_BLOCK(ns->ftrial, neq, realtype, 0);
+
+    ns->cons = newDenseMat(neq, neq);
+    CVODE_HANDLE_ERROR((void *)ns->cons, "newDenseMat", 0);
+    ns->J = newDenseMat(neq, neq);
+    CVODE_HANDLE_ERROR((void *)ns->J, "newDenseMat", 0);
+    ns->S = newDenseMat(neq + NS_NSAMPLES, neq);
+    CVODE_HANDLE_ERROR((void *)ns->S, "newDenseMat", 0);
+
+    /* the RHS function expects N_Vectors, their data
+       pointers are set before each call */
+    ns->yv = N_VMake_Serial(neq, ns->x);
+    CVODE_HANDLE_ERROR((void *)ns->yv, "N_VMake_Serial", 0);
+    ns->fv = N_VMake_Serial(neq, ns->f);
+    CVODE_HANDLE_ERROR((void *)ns->fv, "N_VMake_Serial", 0);
   }
-  
-  /* CVODESolverStructures from former runs must be freed */
-  if ( engine->run > 1 )
-    IntegratorInstance_freeKINSolverStructures(engine);
-    
-  /*
-   * Allocate y, abstol vectors, abstol is used as a scaling vector
-   * for KINSol
-   */
-  solver->y = N_VNew_Serial(neq);
-  CVODE_HANDLE_ERROR((void *)solver->y,
-		     "N_VNew_Serial for vector y failed", 0);
-    
-  /* scaling factor for y, diagonal elements of a matrix Du,
-     such that Du*u vector has all components roughly of the
-     same magnitude as y close to a solution */
-  solver->abstol = N_VNew_Serial(neq);
-  CVODE_HANDLE_ERROR((void *)solver->abstol, "N_VNew_Serial for abstol", 0);
-    
-  /* scaling factor for f(y), diagonal elements of a matrix Df,
-     such that Df*f(u) vector has all components of roughly the
-     same magnitude as y (?)not too close(?) to a solution  */
-  /*     solver->abstol = N_VNew_Serial(neq); */
-  /*     CVODE_HANDLE_ERROR((void *)solver->abstol, "N_VNew_Serial for abstol", 0); */
-    
-  /* constraints for solutions */
-  constraints = N_VNew_Serial(neq);
-  CVODE_HANDLE_ERROR((void *)constraints,
-		     "N_VNew_Serial for constraints", 0);
-    
-
-  /*
-   * Initialize y, scale and constraint vectors
-   */
-  ydata       = NV_DATA_S(solver->y);    
-  scale       = NV_DATA_S(solver->abstol);    
-  constr      = NV_DATA_S(constraints);    
-  for ( i=0; i<neq; i++ )
+  ns = solver->ns;
+
+  ns->rhs = IntegratorInstance_getRHSFunction(engine);
+  if ( ns->rhs == NULL )
+    return 0; /* error */
+
+  return 1;
+}
+
+
+/* frees the work arrays of the steady state solver */
+void IntegratorInstance_freeNullSolverStructures(integratorInstance_t *engine)
+{
+  nullSolver_t *ns = engine->solver->ns;
+
+  if ( ns == NULL )
+    return;
+
+  free(ns->dep);
+  free(ns->law);
+  free(ns->pivot);
+  free(ns->total);
+  free(ns->x0);
+  free(ns->x);
+  free(ns->xp);
+  free(ns->f);
+  free(ns->dx);
+  free(ns->xtrial);
+  free(ns->ftrial);
+  if ( ns->cons != NULL )
+    destroyMat(ns->cons);
+  if ( ns->J != NULL )
+    destroyMat(ns->J);
+  if ( ns->S != NULL )
+    destroyMat(ns->S);
+  if ( ns->yv != NULL )
+    N_VDestroy_Serial(ns->yv);
+  if ( ns->fv != NULL )
+    N_VDestroy_Serial(ns->fv);
+
+  free(ns);
+  engine->solver->ns = NULL;
+}
+
+
+/* resets the statistics of the steady state solver */
+static void IntegratorInstance_nsResetStatistics(integratorInstance_t *engine)
+{
+  nullSolver_t *ns = engine->solver->ns;
+
+  if ( ns == NULL )
+    return;
+
+  ns->ncons = 0;
+  ns->method = 0;
+  ns->residual = 0.0;
+  ns->nni = ns->nfe = ns->nje = ns->nbt = ns->nptc = 0;
+}
+
+
+/* searches a steady state from the current values, by Newton's
+   method from the last solution (if warm), Newton's method from the
+   current values and finally pseudo-transient continuation, and sets
+   the current values to the result; returns 1 on success and 0 on
+   failure */
+static int IntegratorInstance_nsSolve(integratorInstance_t *engine, int warm)
+{
+  int i, success;
+  realtype *x;
+  cvodeData_t *data = engine->data;
+  nullSolver_t *ns = engine->solver->ns;
+
+  if ( engine->om->neq == 0 )
+    return 1;
+
+  ns->method = 0;
+  ns->residual = 0.0;
+  for ( i=0; i<ns->neq; i++ )
+    ns->x0[i] = data->value[i];
+
+  if ( !IntegratorInstance_nsFindConservationLaws(engine) )
+    return 0;
+
+  success = warm &&
+    IntegratorInstance_nsNewton(engine, NS_MAXITER) &&
+    IntegratorInstance_nsIsFeasible(engine);
+  if ( !success )
   {
-    /* Set initial value vector components of y and scaling factor
-     */
-    ydata[i]  = data->value[i];
-    scale[i]  = 0.138; /* !!!good scaling factors required!!! */
-    constr[i] = 0; /* !!!does not fit to kin_guide instructions,
-		      where 1 is claimed to been y>0, while
-		      2 should mean y >= 0. Two gives however an error
-		      message !!!*/
+    for ( i=0; i<ns->neq; i++ )
+      ns->x[i] = ns->x0[i];
+    success = IntegratorInstance_nsNewton(engine, NS_MAXITER) &&
+      IntegratorInstance_nsIsFeasible(engine);
   }
-  /*
-   * Call KINCreate to create the solver memory:
-   *
-   */
-  solver->cvode_mem = KINCreate();
-  CVODE_HANDLE_ERROR((void *)(solver->cvode_mem), "KINCreate", 0);
-
-
-  /*
-   * Call KINInit to initialize the integrator memory:
-   * cvode_mem  pointer to the KINSOL memory block returned by KINCreate
-   * func       user's right hand side function
-   * y          the dependent variable vector
-   */
-  flag = KINInit(solver->cvode_mem, func, solver->y);
-  CVODE_HANDLE_ERROR(&flag, "KINInit", 1);
-
-#ifdef VERBOSE
-  /* for debugging */
-  KINSetPrintLevel(solver->cvode_mem, 1);
-#endif
+  if ( success )
+    ns->method = 1;
+  else if ( IntegratorInstance_nsPseudoTransient(engine) )
+  {
+    success = 1;
+    ns->method = 2;
+  }
+
+  /* set current values and update assignment rules */
+  x = success ? ns->x : ns->x0;
+  if ( IntegratorInstance_nsRhs(ns, data, x, ns->f) == 0 && success )
+    ns->residual = IntegratorInstance_nsMaxNorm(ns, ns->f);
+  for ( i=0; i<ns->neq; i++ )
+    data->value[i] = x[i];
+  data->allRulesUpdated = 0;
+  engine->isValid = 0;
 
-  /* set constraints for solutions */
-  flag = KINSetConstraints(solver->cvode_mem, constraints);
-  CVODE_HANDLE_ERROR(&flag, "KINSetConstraints", 1);
-
-  N_VDestroy_Serial(constraints);
-   
-  /* 
-   * Link the solver with data for right-hand side function
-   */ 
-  flag = KINSetUserData(solver->cvode_mem, engine->data);
-  CVODE_HANDLE_ERROR(&flag, "KINSetUserData", 1);
-    
-  /* Call KINSpgmr to specify the linear solver KINSPGMR  */
-  flag = KINSpgmr(solver->cvode_mem, 100);
-  CVODE_HANDLE_ERROR(&flag, "KINSpgmr", 1);
-
-  /*
-   * Set the routine used by the KINDense linear solver
-   * to approximate the Jacobian matrix to ...
-   */
-  if ( opt->UseJacobian == 1 )
+  if ( !success )
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+		      "Steady state solver not successful at time %g: "
+		      "neither Newton's method nor pseudo-transient "
+		      "continuation converged.", data->currenttime);
+
+  return success;
+}
+
+
+/* evaluates the ODEs at the current time and the plain array x,
+   returns the flag of the RHS function, or 1 if some value is not
+   finite */
+int IntegratorInstance_nsRhs(nullSolver_t *ns, cvodeData_t *data,
+			     realtype *x, realtype *f)
+{
+  int i, flag;
+
+  NV_DATA_S(ns->yv) = x;
+  NV_DATA_S(ns->fv) = f;
+  ns->nfe++;
+  flag = ns->rhs(data->currenttime, ns->yv, ns->fv, data);
+  if ( flag != 0 )
+    return flag;
+
+  for ( i=0; i<ns->neq; i++ )
+    if ( !(fabs(f[i]) <= DBL_MAX) )
+      return 1;
+
+  return 0;
+}
+
+
+/* evaluates the residual of the Newton system: the ODEs, where the
+   ODE of each dependent variable is replaced by its conservation
+   law */
+static int IntegratorInstance_nsResidual(integratorInstance_t *engine,
+					 realtype *x, realtype *f)
+{
+  int i, k, flag;
+  realtype sum;
+  nullSolver_t *ns = engine->solver->ns;
+
+  flag = IntegratorInstance_nsRhs(ns, engine->data, x, f);
+  if ( flag != 0 )
+    return flag;
+
+  for ( k=0; k<ns->ncons; k++ )
   {
-    /* ... user-supplied routine JacV when working */
-    /* flag = KINSpgmrSetJacTimesVecFn(solver->cvode_mem, JacV, data); */
+    sum = 0.0;
+    for ( i=0; i<ns->neq; i++ )
+      sum += ns->cons[k][i] * x[i];
+    f[ns->dep[k]] = sum - ns->total[k];
+  }
+
+  return 0;
+}
+
+
+/* evaluates the Jacobian matrix at x into J, where f are the ODE
+   values at x, via the symbolic Jacobian if available or difference
+   quotients otherwise; if reduce is set, the rows of dependent
+   variables are replaced by their conservation laws;
+   returns 1 on success and 0 on failure */
+int IntegratorInstance_nsJacobian(integratorInstance_t *engine,
+				  realtype *x, realtype *f, int reduce)
+{
+  int i, j, k;
+  realtype inc, scale, srur;
+  cvodeData_t *data = engine->data;
+  odeModel_t *om = engine->om;
+  nullSolver_t *ns = engine->solver->ns;
+
+  srur = sqrt(UNIT_ROUNDOFF);
+  ns->nje++;
+
+  if ( engine->UseJacobian )
+  {
+    /* as in JacODE, with assignment rules updated at x */
+    if ( IntegratorInstance_nsRhs(ns, data, x, ns->ftrial) != 0 )
+      return 0;
+    for ( i=0; i<ns->neq; i++ )
+      data->value[i] = x[i];
+
+    for ( j=0; j<ns->neq; j++ )
+      for ( i=0; i<ns->neq; i++ )
+	ns->J[j][i] = 0.0;
+    for ( i=0; i<om->sparsesize; i++ )
+    {
+      nonzeroElem_t *nonzero = om->jacobSparse[i];
+      ns->J[nonzero->j][nonzero->i] = evaluateAST(nonzero->ij, data);
+    }
   }
   else
   {
-    /* ... the internal default difference
-       quotient routine KINDenseDQJac */      
+    scale = IntegratorInstance_nsMaxNorm(ns, x);
+    for ( j=0; j<ns->neq; j++ )
+    {
+      inc = fabs(x[j]) > 1e-3*scale ? fabs(x[j]) : 1e-3*scale;
+      if ( inc < engine->opt->Error )
+	inc = engine->opt->Error;
+      inc = srur * (inc > 0.0 ? inc : 1.0);
+
+      for ( i=0; i<ns->neq; i++ )
+	ns->xtrial[i] = x[i];
+      ns->xtrial[j] += inc;
+      if ( IntegratorInstance_nsRhs(ns, data, ns->xtrial, ns->ftrial) != 0 )
+	return 0;
+      for ( i=0; i<ns->neq; i++ )
+	ns->J[j][i] = (ns->ftrial[i] - f[i]) / inc;
+    }
   }
-    
-  CVODE_HANDLE_ERROR(&flag, "KINSpgmrSetJacTimesVecFn", 1);
-     
-  return 1; /* OK */
+
+  if ( reduce )
+    for ( k=0; k<ns->ncons; k++ )
+      for ( j=0; j<ns->neq; j++ )
+	ns->J[j][ns->dep[k]] = ns->cons[k][j];
+
+  return 1;
 }
 
-/* frees N_V vector structures, and the cvode_mem solver */
-void IntegratorInstance_freeKINSolverStructures(integratorInstance_t *engine)
+
+/* finds the conservation laws c * f(x) = 0 as the null space of the
+   ODE values at sample points around the initial values, which are
+   all linear combinations of ODEs that vanish for all x (e.g. the
+   left null space of the stoichiometric matrix); the laws are in
+   reduced row echelon form, where the free variables of the null
+   space are the dependent variables;
+   returns 1 on success and 0 on failure */
+static int IntegratorInstance_nsFindConservationLaws(integratorInstance_t *engine)
 {
-  N_VDestroy_Serial(engine->solver->y);
-  N_VDestroy_Serial(engine->solver->abstol);
-  KINFree(&engine->solver->cvode_mem);
+  int i, j, k, m, p, q, r, neq, tries;
+  unsigned long seed;
+  realtype scale, u, tmp, max, *c;
+  nullSolver_t *ns = engine->solver->ns;
+  realtype **S = ns->S;           /* S[j][k]: ODE j at sample k */
+  realtype *colmax = ns->dx;      /* work arrays */
+  int *pivcol = ns->pivot;
+
+  neq = ns->neq;
+  m = neq + NS_NSAMPLES;
+  ns->ncons = 0;
+
+  scale = IntegratorInstance_nsMaxNorm(ns, ns->x0);
+  if ( scale == 0.0 )
+    scale = 1.0;
+
+  /* samples around the initial values, with the same sign; the
+     fixed seed makes the results reproducible */
+  seed = 1;
+  k = tries = 0;
+  while ( k < m && tries++ < 10*m )
+  {
+    for ( i=0; i<neq; i++ )
+    {
+      seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+      u = (realtype) seed / 2147483648.0;
+      tmp = (fabs(ns->x0[i]) + 1e-3*scale) * (0.5 + u);
+      ns->xtrial[i] = ns->x0[i] < 0.0 ? -tmp : tmp;
+    }
+    if ( IntegratorInstance_nsRhs(ns, engine->data,
+				  ns->xtrial, ns->ftrial) != 0 )
+      continue;
+    for ( j=0; j<neq; j++ )
+      S[j][k] = ns->ftrial[j];
+    k++;
+  }
+
+  if ( k < m )
+  {
+    /* can't even evaluate the ODEs at the initial values? */
+    if ( IntegratorInstance_nsRhs(ns, engine->data,
+				  ns->x0, ns->ftrial) != 0 )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+			"Steady state solver: evaluation of the ODEs "
+			"failed at the initial values.");
+      return 0;
+    }
+    SolverError_error(WARNING_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+		      "Steady state solver: ODEs could not be evaluated "
+		      "around the initial values, conservation laws are "
+		      "not considered.");
+    return 1;
+  }
+
+  /* equilibrate columns and rows */
+  for ( j=0; j<neq; j++ )
+  {
+    colmax[j] = 0.0;
+    for ( k=0; k<m; k++ )
+      if ( fabs(S[j][k]) > colmax[j] )
+	colmax[j] = fabs(S[j][k]);
+    if ( colmax[j] > 0.0 )
+      for ( k=0; k<m; k++ )
+	S[j][k] /= colmax[j];
+  }
+  for ( k=0; k<m; k++ )
+  {
+    max = 0.0;
+    for ( j=0; j<neq; j++ )
+      if ( fabs(S[j][k]) > max )
+	max = fabs(S[j][k]);
+    if ( max > 0.0 )
+      for ( j=0; j<neq; j++ )
+	S[j][k] /= max;
+  }
+
+  /* reduced row echelon form by Gauss-Jordan elimination with
+     partial pivoting */
+  r = 0;
+  for ( j=0; j<neq; j++ )
+  {
+    p = r;
+    for ( k=r+1; k<m; k++ )
+      if ( fabs(S[j][k]) > fabs(S[j][p]) )
+	p = k;
+    if ( fabs(S[j][p]) <= NS_LAWTOL )
+      continue;
+
+    for ( q=0; q<neq; q++ )
+    {
+      tmp = S[q][p];
+      S[q][p] = S[q][r];
+      S[q][r] = tmp;
+    }
+    tmp = S[j][r];
+    for ( q=0; q<neq; q++ )
+      S[q][r] /= tmp;
+    for ( k=0; k<m; k++ )
+      if ( k != r && S[j][k] != 0.0 )
+      {
+	tmp = S[j][k];
+	for ( q=0; q<neq; q++ )
+	  S[q][k] -= tmp * S[q][r];
+      }
+    pivcol[r++] = j;
+  }
+
+  /* one law for each column q without pivot: c_q = 1 and c_p = -S_kq
+     for the pivot column p of row k, then undo the scaling */
+  for ( i=0; i<neq; i++ )
+    ns->law[i] = -1;
+  for ( k=0; k<r; k++ )
+    ns->law[pivcol[k]] = -2;
+
+  for ( q=0; q<neq; q++ )
+  {
+    if ( ns->law[q] == -2 )
+      continue;
+
+    c = ns->cons[ns->ncons];
+    for ( i=0; i<neq; i++ )
+      c[i] = 0.0;
+    c[q] = 1.0;
+    for ( k=0; k<r; k++ )
+      c[pivcol[k]] = -S[q][k];
+
+    max = 1.0;
+    for ( i=0; i<neq; i++ )
+    {
+      if ( i != q && colmax[i] > 0.0 )
+	c[i] *= (colmax[q] > 0.0 ? colmax[q] : 1.0) / colmax[i];
+      if ( fabs(c[i]) > max )
+	max = fabs(c[i]);
+    }
+    for ( i=0; i<neq; i++ )
+      if ( fabs(c[i]) <= NS_LAWTOL * max )
+	c[i] = 0.0;
+
+    ns->total[ns->ncons] = 0.0;
+    for ( i=0; i<neq; i++ )
+      ns->total[ns->ncons] += c[i] * ns->x0[i];
+    ns->dep[ns->ncons] = q;
+    ns->law[q] = ns->ncons;
+    ns->ncons++;
+  }
+
+  for ( i=0; i<neq; i++ )
+    if ( ns->law[i] == -2 )
+      ns->law[i] = -1;
+
+  return 1;
 }
 
-/** \brief Prints some final statistics of the calls to CVODE routines
- */
 
-SBML_ODESOLVER_API void IntegratorInstance_printKINSOLStatistics(integratorInstance_t *engine, FILE *f)
+/* damped Newton's method for the reduced system from x, with at most
+   maxiter iterations; returns 1 if converged, i.e. the last full
+   Newton step was within the error tolerances, and 0 otherwise */
+static int IntegratorInstance_nsNewton(integratorInstance_t *engine,
+				       int maxiter)
 {
-  /* print KIN statistics */
+  int i, iter, neq;
+  realtype lambda, fnorm, ftnorm, step, *tmp;
+  nullSolver_t *ns = engine->solver->ns;
+
+  neq = ns->neq;
+
+  if ( IntegratorInstance_nsResidual(engine, ns->x, ns->f) != 0 )
+    return 0;
+  fnorm = IntegratorInstance_nsNorm(ns, ns->f);
+
+  for ( iter=0; iter<maxiter; iter++ )
+  {
+    if ( !IntegratorInstance_nsJacobian(engine, ns->x, ns->f, 1) )
+      return 0;
+    if ( denseGETRF(ns->J, neq, neq, ns->pivot) != 0 )
+      return 0;
+    for ( i=0; i<neq; i++ )
+      ns->dx[i] = -ns->f[i];
+    denseGETRS(ns->J, neq, ns->pivot, ns->dx);
+    ns->nni++;
+    step = IntegratorInstance_nsWrmsNorm(engine, ns->dx, ns->x);
+
+    /* backtracking line search on the residual norm */
+    lambda = 1.0;
+    while ( 1 )
+    {
+      for ( i=0; i<neq; i++ )
+	ns->xtrial[i] = ns->x[i] + lambda*ns->dx[i];
+      if ( IntegratorInstance_nsResidual(engine, ns->xtrial, ns->ftrial) == 0 )
+      {
+	ftnorm = IntegratorInstance_nsNorm(ns, ns->ftrial);
+	if ( ftnorm <= (1.0 - 1e-4*lambda) * fnorm )
+	  break;
+      }
+      /* no decrease of the residual within round-off */
+      if ( step <= 1.0 )
+	return 1;
+      lambda *= 0.5;
+      ns->nbt++;
+      if ( lambda < NS_MINLAMBDA )
+	return 0;
+    }
+
+    tmp = ns->x;
+    ns->x = ns->xtrial;
+    ns->xtrial = tmp;
+    tmp = ns->f;
+    ns->f = ns->ftrial;
+    ns->ftrial = tmp;
+    fnorm = ftnorm;
+
+    if ( lambda == 1.0 && step <= 1.0 )
+      return 1;
+  }
+
+  return 0;
 }
 
 
+/* pseudo-transient continuation from the initial values: linearly
+   implicit Euler steps (I/delta - J) dx = f(x) with step sizes
+   delta growing as the ODE values decrease (switched evolution
+   relaxation), and Newton's method whenever the ODE values have
+   decreased by a factor of 10; returns 1 if Newton's method
+   converged within mxstep steps and 0 otherwise */
+static int IntegratorInstance_nsPseudoTransient(integratorInstance_t *engine)
+{
+  int i, j, step, neq;
+  realtype delta, fnorm, ftnorm, attempt, scale, change, grow, *tmp;
+  nullSolver_t *ns = engine->solver->ns;
+  cvodeSettings_t *opt = engine->opt;
+
+  neq = ns->neq;
+  for ( i=0; i<neq; i++ )
+    ns->xp[i] = ns->x0[i];
+  if ( IntegratorInstance_nsRhs(ns, engine->data, ns->xp, ns->f) != 0 )
+    return 0;
+  fnorm = attempt = IntegratorInstance_nsNorm(ns, ns->f);
+
+  /* the first step changes the variables by about NS_PTC_CHANGE */
+  scale = IntegratorInstance_nsMaxNorm(ns, ns->xp);
+  change = 0.0;
+  for ( i=0; i<neq; i++ )
+    if ( fabs(ns->f[i]) / (fabs(ns->xp[i]) + 1e-3*scale + opt->Error) > change )
+      change = fabs(ns->f[i]) / (fabs(ns->xp[i]) + 1e-3*scale + opt->Error);
+  delta = change > 0.0 ? NS_PTC_CHANGE / change : 1.0;
+
+  for ( step=0; step<opt->Mxstep; step++ )
+  {
+    if ( !IntegratorInstance_nsJacobian(engine, ns->xp, ns->f, 0) )
+      return 0;
+    for ( j=0; j<neq; j++ )
+      for ( i=0; i<neq; i++ )
+	ns->J[j][i] = (i == j ? 1.0/delta : 0.0) - ns->J[j][i];
+    if ( denseGETRF(ns->J, neq, neq, ns->pivot) != 0 )
+    {
+      delta *= 0.25;
+      continue;
+    }
+    for ( i=0; i<neq; i++ )
+      ns->dx[i] = ns->f[i];
+    denseGETRS(ns->J, neq, ns->pivot, ns->dx);
 
+    /* reject steps with too large changes or failing ODEs */
+    scale = IntegratorInstance_nsMaxNorm(ns, ns->xp);
+    change = 0.0;
+    for ( i=0; i<neq; i++ )
+    {
+      ns->xtrial[i] = ns->xp[i] + ns->dx[i];
+      if ( fabs(ns->dx[i]) / (fabs(ns->xp[i]) + 1e-3*scale + opt->Error) > change )
+	change = fabs(ns->dx[i]) / (fabs(ns->xp[i]) + 1e-3*scale + opt->Error);
+    }
+    if ( change > NS_PTC_MAXCHANGE ||
+	 IntegratorInstance_nsRhs(ns, engine->data,
+				  ns->xtrial, ns->ftrial) != 0 )
+    {
+      delta *= 0.25;
+      continue;
+    }
 
+    ns->nptc++;
+    tmp = ns->xp;
+    ns->xp = ns->xtrial;
+    ns->xtrial = tmp;
+    tmp = ns->f;
+    ns->f = ns->ftrial;
+    ns->ftrial = tmp;
 
-/***************** Functions Called by the CVODE Solver ******************/
+    ftnorm = IntegratorInstance_nsNorm(ns, ns->f);
+    grow = ftnorm > 0.0 ? fnorm / ftnorm : NS_PTC_MAXGROW;
+    if ( grow < NS_PTC_MINGROW )
+      grow = NS_PTC_MINGROW;
+    if ( grow > NS_PTC_MAXGROW )
+      grow = NS_PTC_MAXGROW;
+    delta *= grow;
+    fnorm = ftnorm;
 
-/**
-   f routine. Compute the system R.H.S. f(y)
-   This function is called by KIN's solving routines every time
-   needed. 
-*/
-static int func(N_Vector y, N_Vector dydt, void *f_data)
+    if ( fnorm <= 0.1 * attempt )
+    {
+      attempt = fnorm;
+      for ( i=0; i<neq; i++ )
+	ns->x[i] = ns->xp[i];
+      if ( IntegratorInstance_nsNewton(engine, NS_POLISHITER) &&
+	   IntegratorInstance_nsIsFeasible(engine) )
+	return 1;
+      /* continue from xp */
+      if ( IntegratorInstance_nsRhs(ns, engine->data, ns->xp, ns->f) != 0 )
+	return 0;
+    }
+  }
+
+  return 0;
+}
+
+
+/* a steady state is rejected if variables with non-negative initial
+   values became negative beyond the error tolerances */
+static int IntegratorInstance_nsIsFeasible(integratorInstance_t *engine)
 {
   int i;
-  realtype *ydata, *dydata;
-  cvodeData_t *data;
-  data   = (cvodeData_t *) f_data;
-  ydata  = NV_DATA_S(y);
-  dydata = NV_DATA_S(dydt);
-  
-  /* update ODE variables from CVODE */
-  for ( i=0; i<data->model->neq; i++ ) 
-    data->value[i] = ydata[i];
-  
-  /* update assignment rules */
-  for ( i=0; i<data->model->nass; i++ ) 
-    data->value[data->model->neq+i] =
-      evaluateAST(data->model->assignment[i],data);
-  
-  /* !!! update time : null solver doesn't work for time dependent
-     ODEs !!!*/
-  /* data->currenttime = 0.0; */
-
-  /* evaluate f(y) = dy/dt */
-  for ( i=0; i<data->model->neq; i++ ) 
-    dydata[i] = evaluateAST(data->model->ode[i],data);
-
-  return (0);
+  nullSolver_t *ns = engine->solver->ns;
+  cvodeSettings_t *opt = engine->opt;
+
+  for ( i=0; i<ns->neq; i++ )
+    if ( ns->x0[i] >= 0.0 &&
+	 ns->x[i] < -(opt->Error + opt->RError * fabs(ns->x[i])) )
+      return 0;
+
+  return 1;
 }
 
 
-/*
-  Jacobian Vector function. Compute J x v
-  This function is (optionally) called by KIN's integration routines
-  every time needed.
-*/
-static int JacV(N_Vector v, N_Vector Jv, N_Vector y,
-		booleantype *new_u, void *f_data)
-{  
-  int i, j;
-  realtype *ydata, *JvData, *vdata;
-  cvodeData_t *data;
-  data  = (cvodeData_t *) f_data;
-  ydata = NV_DATA_S(y);
-  vdata = NV_DATA_S(v);
-  JvData = NV_DATA_S(Jv);
-
-  /* update ODE variables from CVODE */
-  for ( i=0; i<data->model->neq; i++ )
-    data->value[i] = ydata[i];
-
-  /* update assignment rules */
-  for ( i=0; i<data->model->nass; i++ )
-    data->value[data->model->neq+i] =
-      evaluateAST(data->model->assignment[i], data);
-
-  /* evaluate Jacobian */
-  for ( i=0; i<data->model->neq; i++ )
-  {
-    JvData[i] = 0.0;
-    for ( j=0; j<data->model->neq; j++ )
-      JvData[j] += evaluateAST(data->model->jacob[i][j], data) * vdata[j];
-    /*!!! not sure whether this is correct, needs checking !!!*/
-  }
+/* Euclidean norm */
+static realtype IntegratorInstance_nsNorm(nullSolver_t *ns, realtype *v)
+{
+  int i;
+  realtype sum = 0.0;
 
-  *new_u = TRUE;      
+  for ( i=0; i<ns->neq; i++ )
+    sum += v[i]*v[i];
 
-  return 0;
+  return sqrt(sum);
 }
 
 
+/* maximum norm */
+static realtype IntegratorInstance_nsMaxNorm(nullSolver_t *ns, realtype *v)
+{
+  int i;
+  realtype max = 0.0;
+
+  for ( i=0; i<ns->neq; i++ )
+    if ( fabs(v[i]) > max )
+      max = fabs(v[i]);
+
+  return max;
+}
+
+
+/* weighted root mean square norm of a step v at x, with the weights
+   of CVODES and a lower bound at the round-off level of x */
+static realtype IntegratorInstance_nsWrmsNorm(integratorInstance_t *engine,
+					      realtype *v, realtype *x)
+{
+  int i;
+  realtype sum, w, floor;
+  nullSolver_t *ns = engine->solver->ns;
+
+  floor = 1e3 * UNIT_ROUNDOFF * IntegratorInstance_nsMaxNorm(ns, x);
+  if ( floor == 0.0 )
+    floor = UNIT_ROUNDOFF;
+  sum = 0.0;
+  for ( i=0; i<ns->neq; i++ )
+  {
+    w = v[i] / (engine->opt->Error + engine->opt->RError * fabs(x[i]) + floor);
+    sum += w*w;
+  }
+
+  return sqrt(sum/ns->neq);
+}
+
 
+/** @} */
 /* End of file */
@@ -0,0 +1,486 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup nvectorThreaded Threaded N_Vector
+  \ingroup integrator
+  \brief This module contains an N_Vector implementation for SUNDIALS
+  whose norms and linear combinations are computed by the threads of
+  a threadPool.
+
+  The data are laid out as in the serial N_Vector of SUNDIALS, and the
+  operations of the serial N_Vector are used where threads do not
+  pay: for vectors shorter than NVECTOR_THREADED_MIN_LENGTH and for
+  the rarely called tests of the nonlinear solvers. The vector is
+  divided into one contiguous chunk per thread, and the partial
+  results of reductions are combined in the order of the chunks, such
+  that results do not depend on the scheduling of the threads.
+*/
+/*@{*/
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/nvectorThreaded.h"
+
+/* most chunks of an operation */
+#define NVECTOR_THREADED_MAX_CHUNKS 64
+
+/* vector operations of the threads */
+enum
+{
+  NV_LINEARSUM,
+  NV_CONST,
+  NV_PROD,
+  NV_DIV,
+  NV_SCALE,
+  NV_ABS,
+  NV_INV,
+  NV_ADDCONST,
+  NV_COMPARE,
+  NV_DOTPROD,
+  NV_MAXNORM,
+  NV_WSQRSUM,
+  NV_WSQRSUMMASK,
+  NV_MIN,
+  NV_L1NORM
+};
+
+/* a vector operation z = op(a, x, b, y), or a reduction of x, y and
+   the mask z */
+typedef struct nvectorJob
+{
+  int op;
+  long int length;
+  int nchunks;
+  realtype a, b;
+  realtype *x, *y, *z;
+  realtype partial[NVECTOR_THREADED_MAX_CHUNKS]; /* of reductions */
+} nvectorJob_t;
+
+static N_Vector N_VCloneEmpty_Threaded(N_Vector);
+static N_Vector N_VClone_Threaded(N_Vector);
+static void N_VLinearSum_Threaded(realtype, N_Vector, realtype, N_Vector, N_Vector);
+static void N_VConst_Threaded(realtype, N_Vector);
+static void N_VProd_Threaded(N_Vector, N_Vector, N_Vector);
+static void N_VDiv_Threaded(N_Vector, N_Vector, N_Vector);
+static void N_VScale_Threaded(realtype, N_Vector, N_Vector);
+static void N_VAbs_Threaded(N_Vector, N_Vector);
+static void N_VInv_Threaded(N_Vector, N_Vector);
+static void N_VAddConst_Threaded(N_Vector, realtype, N_Vector);
+static realtype N_VDotProd_Threaded(N_Vector, N_Vector);
+static realtype N_VMaxNorm_Threaded(N_Vector);
+static realtype N_VWrmsNorm_Threaded(N_Vector, N_Vector);
+static realtype N_VWrmsNormMask_Threaded(N_Vector, N_Vector, N_Vector);
+static realtype N_VMin_Threaded(N_Vector);
+static realtype N_VWL2Norm_Threaded(N_Vector, N_Vector);
+static realtype N_VL1Norm_Threaded(N_Vector);
+static void N_VCompare_Threaded(realtype, N_Vector, N_Vector);
+static int N_VThreaded(N_Vector);
+static realtype N_VRun_Threaded(N_Vector, int, realtype, realtype *,
+			       realtype, realtype *, realtype *);
+static void N_VTask_Threaded(void *, int);
+
+
+/** Creates a threaded N_Vector of length without data, whose
+    operations run on the threads of pool.
+
+    The pool must not be freed before the vector and its clones.
+*/
+
+SBML_ODESOLVER_API N_Vector N_VNewEmpty_Threaded(long int length, threadPool_t *pool)
+{
+  N_Vector v;
+  N_VectorContent_Threaded content;
+
+  v = N_VNewEmpty_Serial(length);
+  if ( v == NULL )
+    return NULL;
+
+  content = SolverError_calloc(1, sizeof(struct _N_VectorContent_Threaded));
+  if ( content == NULL )
+  {
+    N_VDestroy_Serial(v);
+    return NULL;
+  }
+  content->length = length;
+  content->own_data = FALSE;
+  content->data = NULL;
+  content->pool = pool;
+  free(v->content);
+  v->content = content;
+
+  v->ops->nvclone = N_VClone_Threaded;
+  v->ops->nvcloneempty = N_VCloneEmpty_Threaded;
+  v->ops->nvlinearsum = N_VLinearSum_Threaded;
+  v->ops->nvconst = N_VConst_Threaded;
+  v->ops->nvprod = N_VProd_Threaded;
+  v->ops->nvdiv = N_VDiv_Threaded;
+  v->ops->nvscale = N_VScale_Threaded;
+  v->ops->nvabs = N_VAbs_Threaded;
+  v->ops->nvinv = N_VInv_Threaded;
+  v->ops->nvaddconst = N_VAddConst_Threaded;
+  v->ops->nvdotprod = N_VDotProd_Threaded;
+  v->ops->nvmaxnorm = N_VMaxNorm_Threaded;
+  v->ops->nvwrmsnorm = N_VWrmsNorm_Threaded;
+  v->ops->nvwrmsnormmask = N_VWrmsNormMask_Threaded;
+  v->ops->nvmin = N_VMin_Threaded;
+  v->ops->nvwl2norm = N_VWL2Norm_Threaded;
+  v->ops->nvl1norm = N_VL1Norm_Threaded;
+  v->ops->nvcompare = N_VCompare_Threaded;
+
+  return v;
+}
+
+
+/** Creates a threaded N_Vector of length with its own data, whose
+    operations run on the threads of pool; it is freed with
+    N_VDestroy or N_VDestroy_Serial
+*/
+
+SBML_ODESOLVER_API N_Vector N_VNew_Threaded(long int length, threadPool_t *pool)
+{
+  N_Vector v;
+  realtype *data;
+
+  v = N_VNewEmpty_Threaded(length, pool);
+  if ( v == NULL )
+    return NULL;
+
+  data = SolverError_calloc(length+1, sizeof(realtype));
+  if ( data == NULL )
+  {
+    N_VDestroy_Serial(v);
+    return NULL;
+  }
+  NV_OWN_DATA_S(v) = TRUE;
+  NV_DATA_S(v) = data;
+
+  return v;
+}
+
+
+/** Creates a threaded N_Vector of length on data, which is not freed
+    with the vector
+*/
+
+SBML_ODESOLVER_API N_Vector N_VMake_Threaded(long int length, realtype *data, threadPool_t *pool)
+{
+  N_Vector v;
+
+  v = N_VNewEmpty_Threaded(length, pool);
+  if ( v != NULL )
+    NV_DATA_S(v) = data;
+
+  return v;
+}
+
+
+/************* internal functions ************/
+
+/* vector operations: the operations of the serial N_Vector run short
+   vectors, the thread pool of the first vector the others */
+
+static N_Vector N_VCloneEmpty_Threaded(N_Vector w)
+{
+  return N_VNewEmpty_Threaded(NV_LENGTH_S(w), NV_POOL_T(w));
+}
+
+static N_Vector N_VClone_Threaded(N_Vector w)
+{
+  return N_VNew_Threaded(NV_LENGTH_S(w), NV_POOL_T(w));
+}
+
+static void N_VLinearSum_Threaded(realtype a, N_Vector x, realtype b,
+				  N_Vector y, N_Vector z)
+{
+  if ( N_VThreaded(x) )
+    N_VRun_Threaded(x, NV_LINEARSUM, a, NV_DATA_S(x), b, NV_DATA_S(y),
+		    NV_DATA_S(z));
+  else
+    N_VLinearSum_Serial(a, x, b, y, z);
+}
+
+static void N_VConst_Threaded(realtype c, N_Vector z)
+{
+  if ( N_VThreaded(z) )
+    N_VRun_Threaded(z, NV_CONST, c, NULL, 0., NULL, NV_DATA_S(z));
+  else
+    N_VConst_Serial(c, z);
+}
+
+static void N_VProd_Threaded(N_Vector x, N_Vector y, N_Vector z)
+{
+  if ( N_VThreaded(x) )
+    N_VRun_Threaded(x, NV_PROD, 0., NV_DATA_S(x), 0., NV_DATA_S(y),
+		    NV_DATA_S(z));
+  else
+    N_VProd_Serial(x, y, z);
+}
+
+static void N_VDiv_Threaded(N_Vector x, N_Vector y, N_Vector z)
+{
+  if ( N_VThreaded(x) )
+    N_VRun_Threaded(x, NV_DIV, 0., NV_DATA_S(x), 0., NV_DATA_S(y),
+		    NV_DATA_S(z));
+  else
+    N_VDiv_Serial(x, y, z);
+}
+
+static void N_VScale_Threaded(realtype c, N_Vector x, N_Vector z)
+{
+  if ( N_VThreaded(x) )
+    N_VRun_Threaded(x, NV_SCALE, c, NV_DATA_S(x), 0., NULL, NV_DATA_S(z));
+  else
+    N_VScale_Serial(c, x, z);
+}
+
+static void N_VAbs_Threaded(N_Vector x, N_Vector z)
+{
+  if ( N_VThreaded(x) )
+    N_VRun_Threaded(x, NV_ABS, 0., NV_DATA_S(x), 0., NULL, NV_DATA_S(z));
+  else
+    N_VAbs_Serial(x, z);
+}
+
+static void N_VInv_Threaded(N_Vector x, N_Vector z)
+{
+  if ( N_VThreaded(x) )
+    N_VRun_Threaded(x, NV_INV, 0., NV_DATA_S(x), 0., NULL, NV_DATA_S(z));
+  else
+    N_VInv_Serial(x, z);
+}
+
+static void N_VAddConst_Threaded(N_Vector x, realtype b, N_Vector z)
+{
+  if ( N_VThreaded(x) )
+    N_VRun_Threaded(x, NV_ADDCONST, 0., NV_DATA_S(x), b, NULL, NV_DATA_S(z));
+  else
+    N_VAddConst_Serial(x, b, z);
+}
+
+static void N_VCompare_Threaded(realtype c, N_Vector x, N_Vector z)
+{
+  if ( N_VThreaded(x) )
+    N_VRun_Threaded(x, NV_COMPARE, c, NV_DATA_S(x), 0., NULL, NV_DATA_S(z));
+  else
+    N_VCompare_Serial(c, x, z);
+}
+
+static realtype N_VDotProd_Threaded(N_Vector x, N_Vector y)
+{
+  if ( N_VThreaded(x) )
+    return N_VRun_Threaded(x, NV_DOTPROD, 0., NV_DATA_S(x), 0., NV_DATA_S(y),
+			   NULL);
+  return N_VDotProd_Serial(x, y);
+}
+
+static realtype N_VMaxNorm_Threaded(N_Vector x)
+{
+  if ( N_VThreaded(x) )
+    return N_VRun_Threaded(x, NV_MAXNORM, 0., NV_DATA_S(x), 0., NULL, NULL);
+  return N_VMaxNorm_Serial(x);
+}
+
+static realtype N_VWrmsNorm_Threaded(N_Vector x, N_Vector w)
+{
+  if ( N_VThreaded(x) )
+    return sqrt(N_VRun_Threaded(x, NV_WSQRSUM, 0., NV_DATA_S(x), 0.,
+				NV_DATA_S(w), NULL) / NV_LENGTH_S(x));
+  return N_VWrmsNorm_Serial(x, w);
+}
+
+static realtype N_VWrmsNormMask_Threaded(N_Vector x, N_Vector w, N_Vector id)
+{
+  if ( N_VThreaded(x) )
+    return sqrt(N_VRun_Threaded(x, NV_WSQRSUMMASK, 0., NV_DATA_S(x), 0.,
+				NV_DATA_S(w), NV_DATA_S(id)) / NV_LENGTH_S(x));
+  return N_VWrmsNormMask_Serial(x, w, id);
+}
+
+static realtype N_VMin_Threaded(N_Vector x)
+{
+  if ( N_VThreaded(x) )
+    return N_VRun_Threaded(x, NV_MIN, 0., NV_DATA_S(x), 0., NULL, NULL);
+  return N_VMin_Serial(x);
+}
+
+static realtype N_VWL2Norm_Threaded(N_Vector x, N_Vector w)
+{
+  if ( N_VThreaded(x) )
+    return sqrt(N_VRun_Threaded(x, NV_WSQRSUM, 0., NV_DATA_S(x), 0.,
+				NV_DATA_S(w), NULL));
+  return N_VWL2Norm_Serial(x, w);
+}
+
+static realtype N_VL1Norm_Threaded(N_Vector x)
+{
+  if ( N_VThreaded(x) )
+    return N_VRun_Threaded(x, NV_L1NORM, 0., NV_DATA_S(x), 0., NULL, NULL);
+  return N_VL1Norm_Serial(x);
+}
+
+
+/* whether operations on v are run by threads */
+static int N_VThreaded(N_Vector v)
+{
+  return NV_POOL_T(v) != NULL &&
+    ThreadPool_getNumThreads(NV_POOL_T(v)) > 1 &&
+    NV_LENGTH_S(v) >= NVECTOR_THREADED_MIN_LENGTH;
+}
+
+
+/* runs an operation on the chunks of the vectors in the thread pool
+   of v and returns the combined results of the chunks of reductions */
+static realtype N_VRun_Threaded(N_Vector v, int op, realtype a, realtype *x,
+			       realtype b, realtype *y, realtype *z)
+{
+  nvectorJob_t job;
+  int k;
+  realtype r;
+
+  job.op = op;
+  job.length = NV_LENGTH_S(v);
+  job.nchunks = ThreadPool_getNumThreads(NV_POOL_T(v));
+  if ( job.nchunks > NVECTOR_THREADED_MAX_CHUNKS )
+    job.nchunks = NVECTOR_THREADED_MAX_CHUNKS;
+  job.a = a;
+  job.b = b;
+  job.x = x;
+  job.y = y;
+  job.z = z;
+
+  ThreadPool_run(NV_POOL_T(v), job.nchunks, N_VTask_Threaded, &job);
+
+  r = job.partial[0];
+  for ( k=1; k<job.nchunks; k++ )
+    switch ( op )
+    {
+    case NV_MAXNORM:
+      if ( job.partial[k] > r )
+	r = job.partial[k];
+      break;
+    case NV_MIN:
+      if ( job.partial[k] < r )
+	r = job.partial[k];
+      break;
+    default:
+      r += job.partial[k];
+      break;
+    }
+
+  return r;
+}
+
+
+/* runs the operation of a job on chunk k */
+static void N_VTask_Threaded(void *arg, int k)
+{
+  nvectorJob_t *job = arg;
+  long int i, start, end;
+  realtype a = job->a, b = job->b, r;
+  realtype *x = job->x, *y = job->y, *z = job->z;
+
+  start = job->length / job->nchunks * k;
+  end = k == job->nchunks-1 ? job->length : start + job->length / job->nchunks;
+
+  r = 0.;
+  switch ( job->op )
+  {
+  case NV_LINEARSUM:
+    for ( i=start; i<end; i++ )
+      z[i] = a*x[i] + b*y[i];
+    break;
+  case NV_CONST:
+    for ( i=start; i<end; i++ )
+      z[i] = a;
+    break;
+  case NV_PROD:
+    for ( i=start; i<end; i++ )
+      z[i] = x[i] * y[i];
+    break;
+  case NV_DIV:
+    for ( i=start; i<end; i++ )
+      z[i] = x[i] / y[i];
+    break;
+  case NV_SCALE:
+    for ( i=start; i<end; i++ )
+      z[i] = a * x[i];
+    break;
+  case NV_ABS:
+    for ( i=start; i<end; i++ )
+      z[i] = fabs(x[i]);
+    break;
+  case NV_INV:
+    for ( i=start; i<end; i++ )
+      z[i] = 1. / x[i];
+    break;
+  case NV_ADDCONST:
+    for ( i=start; i<end; i++ )
+      z[i] = x[i] + b;
+    break;
+  case NV_COMPARE:
+    for ( i=start; i<end; i++ )
+      z[i] = fabs(x[i]) >= a ? 1. : 0.;
+    break;
+  case NV_DOTPROD:
+    for ( i=start; i<end; i++ )
+      r += x[i] * y[i];
+    break;
+  case NV_MAXNORM:
+    for ( i=start; i<end; i++ )
+      if ( fabs(x[i]) > r )
+	r = fabs(x[i]);
+    break;
+  case NV_WSQRSUM:
+    for ( i=start; i<end; i++ )
+      r += x[i]*y[i] * x[i]*y[i];
+    break;
+  case NV_WSQRSUMMASK:
+    for ( i=start; i<end; i++ )
+      if ( z[i] > 0. )
+	r += x[i]*y[i] * x[i]*y[i];
+    break;
+  case NV_MIN:
+    r = x[start];
+    for ( i=start+1; i<end; i++ )
+      if ( x[i] < r )
+	r = x[i];
+    break;
+  case NV_L1NORM:
+    for ( i=start; i<end; i++ )
+      r += fabs(x[i]);
+    break;
+  }
+  job->partial[k] = r;
+}
+
+
+/*! @} */
+/* End of file */
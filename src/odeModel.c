@@ -51,6 +51,7 @@
 #include "sbmlsolver/variableIndex.h"
 #include "sbmlsolver/compiler.h"
 #include "sbmlsolver/arithmeticCompiler.h"
+#include "sbmlsolver/odePartition.h"
 
 #include <sbml/util/List.h>
 
@@ -58,9 +59,27 @@
 #define COMPILED_ADJOINT_RHS_FUNCTION_NAME "adjode_f"
 #define COMPILED_JACOBIAN_FUNCTION_NAME "jacobi_f"
 #define COMPILED_ADJOINT_JACOBIAN_FUNCTION_NAME "adj_jacobi_f"
+#define COMPILED_ADJOINT_JACV_FUNCTION_NAME "adj_jacv_f"
 #define COMPILED_EVENT_FUNCTION_NAME "event_f"
 #define COMPILED_SENSITIVITY_FUNCTION_NAME "sense_f"
 #define COMPILED_ADJOINT_QUAD_FUNCTION_NAME "adj_quad"
+#define COMPILED_ASSIGNMENT_FUNCTION_NAME "assignment_f"
+#define COMPILED_ODE_ASSIGNMENT_FUNCTION_NAME "ode_assignment_f"
+#define COMPILED_STEADYSTATE_FUNCTION_NAME "steadystate_f"
+#define COMPILED_IDA_RESIDUAL_FUNCTION_NAME "ida_res"
+#define COMPILED_IDA_JACOBIAN_FUNCTION_NAME "ida_jac"
+#define COMPILED_OBJECTIVE_FUNCTION_NAME "objective_f"
+#define COMPILED_VECTOR_V_FUNCTION_NAME "vector_v_f"
+#define COMPILED_ENSEMBLE_RHS_FUNCTION_NAME "ensemble_f"
+#define COMPILED_ENSEMBLE_ASSIGNMENT_FUNCTION_NAME "ensemble_assignment_f"
+#define COMPILED_STOCHASTIC_PROPENSITY_FUNCTION_NAME "stochastic_propensity_f"
+#define COMPILED_STOCHASTIC_ASSIGNMENT_FUNCTION_NAME "stochastic_assignment_f"
+#define COMPILED_PARTITION_RULE_FUNCTION_NAME "partition_rule_f"
+#define COMPILED_PARTITION_ODE_FUNCTION_NAME "partition_ode_f"
+#define COMPILED_PARTITION_JACOBIAN_FUNCTION_NAME "partition_jacobian_f"
+
+/* default number of statements per generated helper function */
+#define ODEMODEL_COMPILE_CHUNK_SIZE 1000
 
 
 /* model allocation */
@@ -71,6 +90,13 @@ static int ODEModel_allocateDiscontinuities(odeModel_t *om, int nvalues,
 					    int ninitAss);
 static int ODEModel_setDiscontinuities(odeModel_t *om, Model_t *ode);
 static int ODEModel_freeDiscontinuities(odeModel_t *);
+static int ODEModel_setTimedEvents(odeModel_t *om);
+static int ODEModel_isEventConstant(odeModel_t *om, const ASTNode_t *node,
+				    const int *eventAssigned);
+static int ODEModel_setPiecewiseRoots(odeModel_t *om);
+static int ODEModel_addPiecewiseRoots(odeModel_t *om, const ASTNode_t *node,
+				      int isCondition);
+static void ODEModel_freePiecewiseRoots(odeModel_t *om);
 static void ODEModel_initializeValuesFromSBML(odeModel_t *, Model_t *);
 
 /* rule sorting */
@@ -179,6 +205,14 @@ SBML_ODESOLVER_API int ODEModel_getNumAssignmentsBeforeODEs(const odeModel_t *om
 {
   return om->nassbeforeodes;
 }
+/** Returns the number of root functions constructed from relational
+    piecewise conditions, which allow CVODES to locate discontinuities
+    of the ODE system without running in TSTOP mode
+*/
+SBML_ODESOLVER_API int ODEModel_getNumRoots(const odeModel_t *om)
+{
+  return om->nroots;
+}
 SBML_ODESOLVER_API int ODEModel_getNumAssignmentsBeforeEvents(const odeModel_t *om)
 {
   return om->nassbeforeevents;
@@ -1035,9 +1069,133 @@ static odeModel_t *ODEModel_fillStructures(Model_t *ode)
     ODEModel_freeDiscontinuities(om);
   }
 
+  /* 3: ROOT FUNCTIONS of piecewise conditions */
+
+  flag = ODEModel_setPiecewiseRoots(om);
+  if ( flag == -1 ) /* -1 memory allocation failures */
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_ODE_MODEL_SET_DISCONTINUITIES_FAILED,
+		      "setting root functions of piecewise conditions failed.");
+    ODEModel_freePiecewiseRoots(om);
+  }
+
   return om;
 }
 
+/* collects root functions g = a - b for all relational conditions
+   a op b of piecewise expressions in ODEs and assignment rules,
+   returns 1 for success or -1 for memory allocation failure */
+static int ODEModel_setPiecewiseRoots(odeModel_t *om)
+{
+  int i;
+
+  om->nroots = 0;
+  om->root = NULL;
+  om->npiecewiseUnrooted = 0;
+
+  if ( !om->npiecewise )
+    return 1;
+
+  for ( i=0; i<om->neq; i++ )
+    if ( ODEModel_addPiecewiseRoots(om, om->ode[i], 0) == -1 )
+      return -1;
+  for ( i=0; i<om->nass; i++ )
+    if ( ODEModel_addPiecewiseRoots(om, om->assignment[i], 0) == -1 )
+      return -1;
+
+  return 1;
+}
+
+/* recursively adds root functions for the piecewise conditions in
+   AST node; conditions other than (logical combinations of)
+   relations and constants are counted in om->npiecewiseUnrooted */
+static int ODEModel_addPiecewiseRoots(odeModel_t *om, const ASTNode_t *node,
+				      int isCondition)
+{
+  unsigned int i, nvalues;
+  ASTNodeType_t type;
+  ASTNode_t *diff, *root, **tmp;
+
+  type = ASTNode_getType(node);
+
+  if ( isCondition )
+  {
+    switch ( type )
+    {
+    case AST_RELATIONAL_EQ:
+    case AST_RELATIONAL_GEQ:
+    case AST_RELATIONAL_GT:
+    case AST_RELATIONAL_LEQ:
+    case AST_RELATIONAL_LT:
+    case AST_RELATIONAL_NEQ:
+      nvalues = om->neq + om->nass + om->nconst;
+      /* one root for each consecutive pair of n-ary relations */
+      for ( i=1; i<ASTNode_getNumChildren(node); i++ )
+      {
+	diff = ASTNode_create();
+	ASTNode_setType(diff, AST_MINUS);
+	ASTNode_addChild(diff, copyAST(ASTNode_getChild(node, i-1)));
+	ASTNode_addChild(diff, copyAST(ASTNode_getChild(node, i)));
+	root = indexAST(diff, nvalues, om->names);
+	ASTNode_free(diff);
+
+	tmp = realloc(om->root, (om->nroots+1) * sizeof(ASTNode_t *));
+	if ( tmp == NULL )
+	{
+	  ASTNode_free(root);
+	  return -1;
+	}
+	om->root = tmp;
+	om->root[om->nroots++] = root;
+      }
+      break;
+    case AST_LOGICAL_AND:
+    case AST_LOGICAL_OR:
+    case AST_LOGICAL_XOR:
+    case AST_LOGICAL_NOT:
+      for ( i=0; i<ASTNode_getNumChildren(node); i++ )
+	if ( ODEModel_addPiecewiseRoots(om, ASTNode_getChild(node, i), 1)
+	     == -1 )
+	  return -1;
+      return 1;
+    case AST_CONSTANT_TRUE:
+    case AST_CONSTANT_FALSE:
+    case AST_INTEGER:
+    case AST_REAL:
+    case AST_REAL_E:
+    case AST_RATIONAL:
+      return 1;
+    default:
+      om->npiecewiseUnrooted++;
+      break;
+    }
+  }
+
+  /* operands of conditions or pieces can contain nested piecewise
+     expressions, the conditions are the odd children of piecewise */
+  for ( i=0; i<ASTNode_getNumChildren(node); i++ )
+    if ( ODEModel_addPiecewiseRoots(om, ASTNode_getChild(node, i),
+				    !isCondition &&
+				    type == AST_FUNCTION_PIECEWISE &&
+				    i % 2 == 1) == -1 )
+      return -1;
+
+  return 1;
+}
+
+/* free root functions of piecewise conditions */
+static void ODEModel_freePiecewiseRoots(odeModel_t *om)
+{
+  int i;
+
+  for ( i=0; i<om->nroots; i++ )
+    ASTNode_free(om->root[i]);
+  free(om->root);
+  om->root = NULL;
+  om->nroots = 0;
+}
+
 /* returns 1 for success or -1 for memory allocation failure */
 static int ODEModel_setDiscontinuities(odeModel_t *om, Model_t *ode)
 {
@@ -1118,6 +1276,91 @@ static int ODEModel_setDiscontinuities(odeModel_t *om, Model_t *ode)
 #endif
     }
   }
+
+  /* recognize time-only triggers */
+  return ODEModel_setTimedEvents(om);
+}
+
+/* finds event triggers of the form time >= e or e <= time, with e
+   depending only on constants that are not changed by events; the
+   firing time e of these triggers is known in advance, such that the
+   integrator can stop exactly there (see CvodeData_scheduleEvents);
+   returns 1 for success or -1 for memory allocation failure */
+static int ODEModel_setTimedEvents(odeModel_t *om)
+{
+  int i, j, child, nvalues;
+  int *eventAssigned;
+  const ASTNode_t *trigger;
+
+  nvalues = om->neq + om->nass + om->nconst;
+
+  om->ntimedEvents = 0;
+  ASSIGN_NEW_MEMORY_BLOCK(om->eventTimeChild, om->nevents, int, -1);
+  ASSIGN_NEW_MEMORY_BLOCK(eventAssigned, nvalues, int, -1);
+
+  for ( i=0; i<om->nevents; i++ )
+    for ( j=0; j<om->neventAss[i]; j++ )
+      if ( om->eventIndex[i][j] >= 0 )
+	eventAssigned[om->eventIndex[i][j]] = 1;
+
+  for ( i=0; i<om->nevents; i++ )
+  {
+    trigger = om->event[i];
+    child = -1;
+    if ( ASTNode_getNumChildren(trigger) == 2 )
+    {
+      if ( ASTNode_getType(trigger) == AST_RELATIONAL_GEQ &&
+	   ASTNode_getType(ASTNode_getChild(trigger, 0)) == AST_NAME_TIME )
+	child = 1;
+      else if ( ASTNode_getType(trigger) == AST_RELATIONAL_LEQ &&
+		ASTNode_getType(ASTNode_getChild(trigger, 1)) == AST_NAME_TIME )
+	child = 0;
+    }
+    if ( child != -1 &&
+	 ODEModel_isEventConstant(om, ASTNode_getChild(trigger, child),
+				  eventAssigned) )
+    {
+      om->eventTimeChild[i] = child;
+      om->ntimedEvents++;
+    }
+    else
+      om->eventTimeChild[i] = -1;
+  }
+
+  free(eventAssigned);
+  return 1;
+}
+
+/* returns 1 if the indexed AST node only depends on numbers and
+   constants that are not changed by events, 0 otherwise */
+static int ODEModel_isEventConstant(odeModel_t *om, const ASTNode_t *node,
+				    const int *eventAssigned)
+{
+  unsigned int i, idx;
+
+  switch ( ASTNode_getType(node) )
+  {
+  case AST_NAME_TIME:
+  case AST_FUNCTION_DELAY:
+  case AST_FUNCTION:
+  case AST_LAMBDA:
+    return 0;
+  case AST_NAME:
+    if ( !ASTNode_isSetIndex(node) )
+      return 0;
+    idx = ASTNode_getIndex(node);
+    if ( (int)idx < om->neq + om->nass || eventAssigned[idx] )
+      return 0;
+    break;
+  default:
+    break;
+  }
+
+  for ( i=0; i<ASTNode_getNumChildren(node); i++ )
+    if ( !ODEModel_isEventConstant(om, ASTNode_getChild(node, i),
+				   eventAssigned) )
+      return 0;
+
   return 1;
 }
 
@@ -1194,6 +1437,7 @@ static int ODEModel_freeDiscontinuities(odeModel_t *om)
   free(om->eventIndex);
   free(om->eventAssignment);
   free(om->eventAssignmentcode);
+  free(om->eventTimeChild);
 
   /* rule ordering */
   for ( i=0; i<om->nassbeforeevents; i++ )
@@ -1234,7 +1478,7 @@ static int ODEModel_allocateDiscontinuities(odeModel_t *om, int nvalues,
 static odeModel_t *ODEModel_allocate(int neq, int nconst, int nass, int nalg)
 {
   odeModel_t *om;
-  int nvalues;
+  int i, nvalues;
 
   ASSIGN_NEW_MEMORY(om, odeModel_t, NULL);
   /* init. to 0 first */
@@ -1280,6 +1524,20 @@ static odeModel_t *ODEModel_allocate(int neq, int nconst, int nass, int nalg)
   om->compiledCVODERhsFunction = NULL;
   om->compiledCVODEAdjointRhsFunction = NULL;
   om->compiledCVODEAdjointJacobianFunction = NULL;
+  om->compiledCVODEAdjointJacobianTimesVectorFunction = NULL;
+  om->compiledEventFunction = NULL;
+  om->compiledAssignmentFunction = NULL;
+  om->compiledAssignmentsBeforeODEsFunction = NULL;
+  om->compiledSteadyStateFunction = NULL;
+  om->compiledIDAResidualFunction = NULL;
+  om->compiledIDAJacobianFunction = NULL;
+
+  /* split generated code where it can be compiled in parallel */
+  om->compileChunkSize =
+    COMPILER_MULTIPLE_SOURCES ? ODEMODEL_COMPILE_CHUNK_SIZE : 0;
+  for ( i=0; i<COMPILE_NKINDS; i++ )
+    om->compileOptimization[i] = COMPILER_DEFAULT_OPTIMIZATION;
+  om->compileBackend = COMPILER_SYSTEM;
 
   /* objective function */
   /*!!!TODO : move to separate structure */
@@ -1288,6 +1546,16 @@ static odeModel_t *ODEModel_allocate(int neq, int nconst, int nass, int nalg)
   om->discrete_observation_data = 0;
   om->compute_vector_v = 0;
   om->time_series = NULL;
+  om->compiledObjectiveCode = NULL;
+  om->recompileObjective = 1;
+  om->compiledObjectiveFunction = NULL;
+  om->compiledVectorVFunction = NULL;
+  om->compiledEnsembleCode = NULL;
+  om->compiledEnsembleRhsFunction = NULL;
+  om->compiledEnsembleAssignmentFunction = NULL;
+  om->compiledStochasticCode = NULL;
+  om->compiledStochasticPropensityFunction = NULL;
+  om->compiledStochasticAssignmentFunction = NULL;
 
   return om ;
 }
@@ -1497,6 +1765,7 @@ SBML_ODESOLVER_API void ODEModel_free(odeModel_t *om)
 
   /* free discontinuities */
   ODEModel_freeDiscontinuities(om);
+  ODEModel_freePiecewiseRoots(om);
 
 
   /* free objective function AST if it has been constructed */
@@ -1529,6 +1798,21 @@ SBML_ODESOLVER_API void ODEModel_free(odeModel_t *om)
     CompiledCode_free(om->compiledCVODEFunctionCode);
     om->compiledCVODEFunctionCode = NULL;
   }
+  if ( om->compiledObjectiveCode != NULL )
+  {
+    CompiledCode_free(om->compiledObjectiveCode);
+    om->compiledObjectiveCode = NULL;
+  }
+  if ( om->compiledEnsembleCode != NULL )
+  {
+    CompiledCode_free(om->compiledEnsembleCode);
+    om->compiledEnsembleCode = NULL;
+  }
+  if ( om->compiledStochasticCode != NULL )
+  {
+    CompiledCode_free(om->compiledStochasticCode);
+    om->compiledStochasticCode = NULL;
+  }
 
   /* free assignment evaulation ordering */
   for ( i=0; i<om->nassbeforeodes; i++ )
@@ -2561,6 +2845,272 @@ SBML_ODESOLVER_API void VariableIndex_free(variableIndex_t *vi)
 
 /****************COMPILATION*******************/
 
+/* appends the includes and macros required by all compiled code */
+static void ODEModel_generateHeader(charBuffer_t *buffer)
+{
+#ifdef _WIN32
+  CharBuffer_append(buffer,
+		    "#include <windows.h>\n"\
+		    "#include <math.h>\n"\
+		    "#include <sbmlsolver/sundialstypes.h>\n"\
+		    "#include <sbmlsolver/nvector.h>\n"\
+		    "#include <sbmlsolver/nvector_serial.h>\n"\
+		    "#include <sbmlsolver/dense.h>\n" 
+		    "#include <sbmlsolver/cvodes.h>\n"\
+		    "#include <sbmlsolver/cvodea.h>\n"\
+		    "#include <sbmlsolver/cvdense.h>\n"\
+		    "#include <sbmlsolver/cvodeData.h>\n"\
+		    "#include <sbmlsolver/cvodeSettings.h>\n"\
+		    "#include <sbmlsolver/processAST.h>\n"\
+		    "#include <sbmlsolver/odeModel.h>\n"\
+		    "#define DLL_EXPORT __declspec(dllexport)\n");
+#else
+  CharBuffer_append(buffer,
+		    "#include <math.h>\n"
+		    "#include \"cvodes/cvodes.h\"\n"
+		    "#include \"cvodes/cvodes_dense.h\"\n"
+		    "#include \"nvector/nvector_serial.h\"\n"
+		    "#include \"sbmlsolver/cvodeData.h\"\n"
+		    "#include \"sbmlsolver/processAST.h\"\n"
+#if __GNUC__ >= 4
+		    /* the system compiler is g++, libtcc compiles C */
+		    "#ifdef __cplusplus\n"
+		    "#define DLL_EXPORT extern \"C\" __attribute__ ((visibility (\"default\")))\n"
+		    "#else\n"
+		    "#define DLL_EXPORT\n"
+		    "#endif\n\n");
+#else
+		    "#define DLL_EXPORT\n\n");
+#endif
+#endif
+
+  generateMacros(buffer);
+}
+
+/* Generated code is collected by a code generator, which splits
+   large function bodies into helper functions of at most
+   om->compileChunkSize statements.  The helpers of each kind of
+   code are distributed round-robin over up to one source file per
+   processor, so that the compiler sees small functions and the
+   files can be compiled in parallel, each with the optimization
+   level set for its kind.  The exported functions, which call the
+   helpers in order, remain in the main source. */
+struct codeGenerator
+{
+  odeModel_t *om;
+  int nfiles;                /* helper source files per kind */
+  charBuffer_t *prototypes;  /* helper prototypes for the main source */
+  charBuffer_t *main;        /* exported functions */
+  charBuffer_t **files;      /* helper sources, [kind*nfiles + k] */
+  int nhelpers[COMPILE_NKINDS];
+
+  /* the function currently generated */
+  compileKind_t kind;
+  const char *name;          /* name of the exported function */
+  const char *params;        /* parameter list of its helpers */
+  const char *args;          /* argument list of helper calls */
+  charBuffer_t *chunk;       /* body of the current helper */
+  int nstatements;           /* statements in the current helper */
+  int nchunks;               /* helpers of the current function */
+};
+typedef struct codeGenerator codeGenerator_t;
+
+/* creates a code generator for the given model */
+static codeGenerator_t *CodeGenerator_create(odeModel_t *om)
+{
+  int i;
+  codeGenerator_t *gen;
+
+  ASSIGN_NEW_MEMORY(gen, codeGenerator_t, NULL);
+  gen->om = om;
+  gen->nfiles = 0;
+  if ( COMPILER_MULTIPLE_SOURCES && om->compileChunkSize > 0 &&
+       om->compileBackend == COMPILER_SYSTEM )
+    gen->nfiles = Compiler_getNumProcessors();
+  ASSIGN_NEW_MEMORY_BLOCK(gen->files, COMPILE_NKINDS*gen->nfiles + 1,
+			  charBuffer_t *, NULL);
+  for ( i=0; i<COMPILE_NKINDS*gen->nfiles; i++ )
+    gen->files[i] = NULL;
+  for ( i=0; i<COMPILE_NKINDS; i++ )
+    gen->nhelpers[i] = 0;
+  gen->prototypes = CharBuffer_create();
+  gen->main = CharBuffer_create();
+  gen->chunk = NULL;
+  gen->nstatements = 0;
+  gen->nchunks = 0;
+
+  return gen;
+}
+
+/* frees the code generator and all generated code */
+static void CodeGenerator_free(codeGenerator_t *gen)
+{
+  int i;
+
+  for ( i=0; i<COMPILE_NKINDS*gen->nfiles; i++ )
+    if ( gen->files[i] != NULL )
+      CharBuffer_free(gen->files[i]);
+  free(gen->files);
+  if ( gen->chunk != NULL )
+    CharBuffer_free(gen->chunk);
+  CharBuffer_free(gen->prototypes);
+  CharBuffer_free(gen->main);
+  free(gen);
+}
+
+/* starts the body of an exported function of the given kind, whose
+   head must be written to the main buffer before; helpers are
+   called with the given parameters and arguments, which have to
+   be declared in the exported function */
+static void CodeGenerator_beginFunction(codeGenerator_t *gen,
+					compileKind_t kind, const char *name,
+					const char *params, const char *args)
+{
+  gen->kind = kind;
+  gen->name = name;
+  gen->params = params;
+  gen->args = args;
+  gen->nchunks = 0;
+  gen->nstatements = 0;
+}
+
+/* moves the current helper to a source file of its kind and appends
+   a call to it to the exported function */
+static void CodeGenerator_flush(codeGenerator_t *gen)
+{
+  int k;
+  charBuffer_t *file;
+
+  if ( gen->chunk == NULL )
+    return;
+
+  k = gen->kind * gen->nfiles + gen->nhelpers[gen->kind]++ % gen->nfiles;
+  if ( gen->files[k] == NULL )
+  {
+    gen->files[k] = CharBuffer_create();
+    ODEModel_generateHeader(gen->files[k]);
+  }
+  file = gen->files[k];
+
+  CharBuffer_append(file, "void ");
+  CharBuffer_append(file, gen->name);
+  CharBuffer_append(file, "_");
+  CharBuffer_appendInt(file, gen->nchunks);
+  CharBuffer_append(file, "(");
+  CharBuffer_append(file, gen->params);
+  CharBuffer_append(file, ")\n{\n");
+  CharBuffer_append(file, CharBuffer_getBuffer(gen->chunk));
+  CharBuffer_append(file, "}\n\n");
+
+  CharBuffer_append(gen->prototypes, "void ");
+  CharBuffer_append(gen->prototypes, gen->name);
+  CharBuffer_append(gen->prototypes, "_");
+  CharBuffer_appendInt(gen->prototypes, gen->nchunks);
+  CharBuffer_append(gen->prototypes, "(");
+  CharBuffer_append(gen->prototypes, gen->params);
+  CharBuffer_append(gen->prototypes, ");\n");
+
+  CharBuffer_append(gen->main, gen->name);
+  CharBuffer_append(gen->main, "_");
+  CharBuffer_appendInt(gen->main, gen->nchunks);
+  CharBuffer_append(gen->main, gen->args);
+  CharBuffer_append(gen->main, ";\n");
+
+  CharBuffer_free(gen->chunk);
+  gen->chunk = NULL;
+  gen->nstatements = 0;
+  gen->nchunks++;
+}
+
+/* returns the buffer of the exported function, for code that can
+   not be moved to helpers, e.g. control structures and returns */
+static charBuffer_t *CodeGenerator_direct(codeGenerator_t *gen)
+{
+  CodeGenerator_flush(gen);
+  return gen->main;
+}
+
+/* returns the buffer to which exactly one complete statement is
+   written next; statements are collected in helpers */
+static charBuffer_t *CodeGenerator_statement(codeGenerator_t *gen)
+{
+  if ( gen->nfiles == 0 )
+    return gen->main;
+
+  if ( gen->nstatements == gen->om->compileChunkSize )
+    CodeGenerator_flush(gen);
+  if ( gen->chunk == NULL )
+    gen->chunk = CharBuffer_create();
+  gen->nstatements++;
+
+  return gen->chunk;
+}
+
+/* compiles the main source and all helper sources into one code
+   object; `debugName' is the file name prefix of the sources
+   written for debugging */
+static compiled_code_t *CodeGenerator_compile(codeGenerator_t *gen,
+					      const char *debugName)
+{
+  int i, n;
+  int *levels;
+  const char **sources;
+  charBuffer_t *mainSource;
+  compiled_code_t *code;
+
+  CodeGenerator_flush(gen);
+
+  mainSource = CharBuffer_create();
+  ODEModel_generateHeader(mainSource);
+  CharBuffer_append(mainSource, CharBuffer_getBuffer(gen->prototypes));
+  CharBuffer_append(mainSource, "\n");
+  CharBuffer_append(mainSource, CharBuffer_getBuffer(gen->main));
+
+  ASSIGN_NEW_MEMORY_BLOCK(sources, COMPILE_NKINDS*gen->nfiles+1,
+			  const char *, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(levels, COMPILE_NKINDS*gen->nfiles+1, int, NULL);
+  sources[0] = CharBuffer_getBuffer(mainSource);
+  levels[0] = gen->om->compileOptimization[COMPILE_MAIN];
+  n = 1;
+  for ( i=0; i<COMPILE_NKINDS*gen->nfiles; i++ )
+  {
+    if ( gen->files[i] != NULL )
+    {
+      sources[n] = CharBuffer_getBuffer(gen->files[i]);
+      levels[n] = gen->om->compileOptimization[i / gen->nfiles];
+      n++;
+    }
+  }
+
+#ifdef _DEBUG /* write out source files for debugging*/
+  for ( i=0; i<n; i++ )
+  {
+    FILE *src;
+    char srcname[MAX_PATH+1];
+    if ( i == 0 )
+      sprintf(srcname, "%s.c", debugName);
+    else
+      sprintf(srcname, "%s_%d.c", debugName, i);
+    src = fopen(srcname, "w");
+    fprintf(src, "%s", sources[i]);
+    fclose(src);
+  }
+#else
+  (void) debugName;
+#endif
+
+  /* now all required sourcecode is in `sources' and can be sent
+     to the compiler */
+  code = Compiler_compileSourcesWithBackend(gen->om->compileBackend,
+					    n, sources, levels);
+
+  free(sources);
+  free(levels);
+  CharBuffer_free(mainSource);
+
+  return code;
+}
+
 /* appends a compilable assignment to the buffer.
    The assignment is made to the 'value' array item indexed by 'index'.
    The value assigned is computed from the given AST. */
@@ -2581,27 +3131,62 @@ static void ODEModel_generateAssignmentCode(int index, ASTNode_t *node,
    order as the 'assignment' array on the given model. */
 static void ODEModel_generateAssignmentRuleCode(int nass,
 					 nonzeroElem_t **orderedList,
-					 charBuffer_t *buffer)
+					 codeGenerator_t *gen)
 {
   int i ;
 
   for ( i=0; i<nass; i++ )
   {
     nonzeroElem_t *ordered = orderedList[i];
-    ODEModel_generateAssignmentCode(ordered->i, ordered->ij, buffer);
+    ODEModel_generateAssignmentCode(ordered->i, ordered->ij,
+				    CodeGenerator_statement(gen));
+  }
+}
+
+/* appends code updating the 'value' array with ODE variables
+   from the array 'ydata' */
+static void ODEModel_generateVariableUpdate(odeModel_t *om,
+					    codeGenerator_t *gen)
+{
+  int i;
+  charBuffer_t *buffer;
+
+  for ( i=0; i<om->neq; i++ )
+  {
+    buffer = CodeGenerator_statement(gen);
+    CharBuffer_append(buffer, "value[");
+    CharBuffer_appendInt(buffer, i);
+    CharBuffer_append(buffer, "] = ydata[");
+    CharBuffer_appendInt(buffer, i);
+    CharBuffer_append(buffer, "];\n");
   }
 }
 
+/* returns 0 if the given AST is the number 0, i.e. a Jacobi or
+   parametric matrix entry that does not need to be generated */
+static int ODEModel_isNonzero(ASTNode_t *node)
+{
+  double val = 1;
+  if ( ASTNode_isInteger(node) )
+    val = (double) ASTNode_getInteger(node) ;
+  if ( ASTNode_isReal(node) )
+    val = ASTNode_getReal(node) ;
+  return val != 0.0;
+}
+
 /** appends compiled code to the given buffer for the function called by
     the value of 'COMPILED_EVENT_FUNCTION_NAME' which implements the
     evaluation event triggers and assignment rules required for event
     triggers and event assignments.
 */
-static void ODEModel_generateEventFunction(odeModel_t *om, charBuffer_t *buffer)
+static void ODEModel_generateEventFunction(odeModel_t *om,
+					   codeGenerator_t *gen)
 {
   int i, j, idx;
   ASTNode_t *trigger, *assignment;
+  charBuffer_t *buffer;
 
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,"DLL_EXPORT int ");
   CharBuffer_append(buffer,COMPILED_EVENT_FUNCTION_NAME);
   CharBuffer_append(buffer,"(cvodeData_t *data, int *engineIsValid)\n"\
@@ -2610,8 +3195,16 @@ static void ODEModel_generateEventFunction(odeModel_t *om, charBuffer_t *buffer)
 		    "    int fired = 0;\n"\
 		    "    int *trigger = data->trigger;\n");
 
+  CodeGenerator_beginFunction(gen, COMPILE_MAIN,
+			      COMPILED_EVENT_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value",
+			      "(data, value)");
   ODEModel_generateAssignmentRuleCode(om->nassbeforeevents,
-				      om->assignmentsBeforeEvents, buffer);
+				      om->assignmentsBeforeEvents, gen);
+
+  /* event triggers remain in the main function, as they change
+     the local `fired' */
+  buffer = CodeGenerator_direct(gen);
 
   for ( i=0; i<om->nevents; i++ )
   {
@@ -2670,10 +3263,13 @@ static void ODEModel_generateEventFunction(odeModel_t *om, charBuffer_t *buffer)
 /* appends compiled code to the given buffer for the function called
    by the value of 'COMPILED_RHS_FUNCTION_NAME' which calculates the
    right hand side ODE values for the set of ODEs being solved. */
-static void ODEModel_generateCVODERHSFunction(odeModel_t *om, charBuffer_t *buffer)
+static void ODEModel_generateCVODERHSFunction(odeModel_t *om,
+					      codeGenerator_t *gen)
 {
   int i ;
+  charBuffer_t *buffer;
 
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,"DLL_EXPORT int ");
   CharBuffer_append(buffer,COMPILED_RHS_FUNCTION_NAME);
   CharBuffer_append(buffer,
@@ -2688,19 +3284,19 @@ static void ODEModel_generateCVODERHSFunction(odeModel_t *om, charBuffer_t *buff
 		    "    ydata = NV_DATA_S(y);\n"\
 		    "    dydata = NV_DATA_S(ydot);\n");
 
+  CodeGenerator_beginFunction(gen, COMPILE_RHS, COMPILED_RHS_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, realtype *dydata",
+			      "(data, value, ydata, dydata)");
+
   /* update time  */
   CharBuffer_append(buffer, "data->currenttime = t;\n");
 
   /* UPDATE ODE VARIABLES from CVODE */
-  for ( i=0; i<om->neq; i++ )
-  {
-    CharBuffer_append(buffer, "value[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "] = ydata[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "];\n");
-  }
+  ODEModel_generateVariableUpdate(om, gen);
+
   /* negative state detection */
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer, "if ( data->opt->DetectNegState  )\n");
   CharBuffer_append(buffer, "  for ( i=0; i<data->model->neq; i++ )\n");
   CharBuffer_append(buffer, "    if (data->value[i] < 0) return (1);\n");
@@ -2714,19 +3310,22 @@ static void ODEModel_generateCVODERHSFunction(odeModel_t *om, charBuffer_t *buff
 		    "    value[data->os->index_sens[i]] = data->p[i];\n");
 
   ODEModel_generateAssignmentRuleCode(om->nass,
-				      om->assignmentOrder, buffer);
+				      om->assignmentOrder, gen);
 
   /* in case sensitivity or jacobi matrix are available */
   /* CharBuffer_append(buffer, "\n printf(\"HALLO\\n\");\n"); */
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer, "\n}\nelse\n{\n");
   ODEModel_generateAssignmentRuleCode(om->nassbeforeodes,
-				      om->assignmentsBeforeODEs, buffer);
+				      om->assignmentsBeforeODEs, gen);
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer, "}\n");
 
 
   /* EVALUATE ODEs f(x,p,t) = dx/dt */
   for ( i=0; i<om->neq; i++ )
   {
+    buffer = CodeGenerator_statement(gen);
     CharBuffer_append(buffer, "dydata[");
     CharBuffer_appendInt(buffer, i);
     CharBuffer_append(buffer, "] = ");
@@ -2734,6 +3333,7 @@ static void ODEModel_generateCVODERHSFunction(odeModel_t *om, charBuffer_t *buff
     CharBuffer_append(buffer, ";\n");
   }
   /* reset parameters for printout etc. */
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,
 		    "if ( data->use_p )\n"\
 		    "{"\
@@ -2741,7 +3341,8 @@ static void ODEModel_generateCVODERHSFunction(odeModel_t *om, charBuffer_t *buff
 		    "    value[data->os->index_sens[i]] = data->p_orig[i];\n");
 
   ODEModel_generateAssignmentRuleCode(om->nass,
-				      om->assignmentOrder, buffer);
+				      om->assignmentOrder, gen);
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer, "}\n");
 
   CharBuffer_append(buffer, "return (0);\n");
@@ -2752,11 +3353,14 @@ static void ODEModel_generateCVODERHSFunction(odeModel_t *om, charBuffer_t *buff
 /* appends compiled code to the given buffer for the function called
    by the value of 'COMPILED_ADJRHS_FUNCTION_NAME' which calculates the
    right hand side ODE values for the adjoint ODEs being solved. */
-static void ODEModel_generateCVODEAdjointRHSFunction(odeModel_t *om, charBuffer_t *buffer)
+static void ODEModel_generateCVODEAdjointRHSFunction(odeModel_t *om,
+						     codeGenerator_t *gen)
 {
   int i,j ;
   ASTNode_t *jacob_ji;
-  double val;
+  charBuffer_t *buffer;
+
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,"DLL_EXPORT int ");
   CharBuffer_append(buffer,COMPILED_ADJOINT_RHS_FUNCTION_NAME);
   CharBuffer_append(buffer,
@@ -2773,40 +3377,36 @@ static void ODEModel_generateCVODEAdjointRHSFunction(odeModel_t *om, charBuffer_
 		    "    yAdata = NV_DATA_S(yA);\n"\
 		    "    dyAdata = NV_DATA_S(yAdot);\n" );
 
+  CodeGenerator_beginFunction(gen, COMPILE_ADJOINT,
+			      COMPILED_ADJOINT_RHS_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, realtype *yAdata,"\
+			      " realtype *dyAdata",
+			      "(data, value, ydata, yAdata, dyAdata)");
 
   /*  update ODE variables from CVODE */
-  for ( i=0; i<om->neq; i++ )
-  {
-    CharBuffer_append(buffer,  "value[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer,  "] = ydata[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer,  "];\n" );
-  }
+  ODEModel_generateVariableUpdate(om, gen);
 
   /* update time  */
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer, "data->currenttime = t;\n");
 
 
   /*  evaluate adjoint sensitivity RHS: -[df/dx]^T * yA + v */
   for ( i=0; i<om->neq; i++ )
   {
+    buffer = CodeGenerator_statement(gen);
     CharBuffer_append(buffer, "dyAdata[");
     CharBuffer_appendInt(buffer, i);
     CharBuffer_append(buffer, "] = 0.0;\n");
     for ( j=0; j<om->neq; j++ )
     {
       jacob_ji = om->jacob[j][i];
-      /*  check whether jacobian is 0  */
-      val = 1;
-      if ( ASTNode_isInteger(jacob_ji) )
-	val = (double) ASTNode_getInteger(jacob_ji) ;
-      if ( ASTNode_isReal(jacob_ji) )
-	val = ASTNode_getReal(jacob_ji) ;
 
       /* write Jacobi evaluation only if entry is not 0 */
-      if ( val != 0.0 )
+      if ( ODEModel_isNonzero(jacob_ji) )
       {
+	buffer = CodeGenerator_statement(gen);
 	CharBuffer_append(buffer, "dyAdata[");
 	CharBuffer_appendInt(buffer, i);
 	CharBuffer_append(buffer, "]");
@@ -2817,18 +3417,15 @@ static void ODEModel_generateCVODEAdjointRHSFunction(odeModel_t *om, charBuffer_
 	CharBuffer_append(buffer, "];\n");
       }
     }
-
-    CharBuffer_append(buffer,
-		      "if (data->model->discrete_observation_data == 0)\n ");
-    CharBuffer_append(buffer, "dyAdata[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "] +=");
-    CharBuffer_append(buffer, " evaluateAST( data->model->vector_v[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "], data);\n");
-
   }
 
+  /* vector v contribution, if continuous data is used; vector v is
+     compiled separately as it can change after model compilation */
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer,
+		    "if (data->model->discrete_observation_data == 0)\n"\
+		    "    CvodeData_addVectorV(data, dyAdata, 1.0);\n");
+
   CharBuffer_append(buffer, "return (0);\n");
 
   CharBuffer_append(buffer, "}\n\n");
@@ -2838,12 +3435,13 @@ static void ODEModel_generateCVODEAdjointRHSFunction(odeModel_t *om, charBuffer_
    the value of 'COMPILED_JACOBIAN_FUNCTION_NAME' which
    calculates the Jacobian for the set of ODEs being solved. */
 static void ODEModel_generateCVODEJacobianFunction(odeModel_t *om,
-					    charBuffer_t *buffer)
+						   codeGenerator_t *gen)
 {
   int i, j ;
   ASTNode_t *jacob_ij;
-  float val;
+  charBuffer_t *buffer;
 
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,"DLL_EXPORT int ");
   CharBuffer_append(buffer,COMPILED_JACOBIAN_FUNCTION_NAME);
   CharBuffer_append(buffer,
@@ -2867,16 +3465,14 @@ static void ODEModel_generateCVODEJacobianFunction(odeModel_t *om,
 		    "        value[data->os->index_sens[i]] = "\
 		    "data->p[i];\n\n");
 
+  CodeGenerator_beginFunction(gen, COMPILE_JACOBIAN,
+			      COMPILED_JACOBIAN_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, DlsMat J",
+			      "(data, value, ydata, J)");
 
   /** update ODE variables from CVODE */
-  for ( i=0; i<om->neq; i++ )
-  {
-    CharBuffer_append(buffer, "value[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "] = ydata[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "];\n");
-  }
+  ODEModel_generateVariableUpdate(om, gen);
 
   /** evaluate Jacobian J = df/dx */
   for ( i=0; i<om->neq; i++ )
@@ -2884,16 +3480,11 @@ static void ODEModel_generateCVODEJacobianFunction(odeModel_t *om,
     for ( j=0; j<om->neq; j++ )
     {
       jacob_ij = om->jacob[i][j];
-      /*  check whether jacobian is 0  */
-      val = 1;
-      if ( ASTNode_isInteger(jacob_ij) )
-	val = (double) ASTNode_getInteger(jacob_ij) ;
-      if ( ASTNode_isReal(jacob_ij) )
-	val = ASTNode_getReal(jacob_ij) ;
 
       /* write Jacobi evaluation only if entry is not 0 */
-      if ( val != 0.0 )
+      if ( ODEModel_isNonzero(jacob_ij) )
       {
+	buffer = CodeGenerator_statement(gen);
 	CharBuffer_append(buffer, "DENSE_ELEM(J,");
 	CharBuffer_appendInt(buffer, i);
 	CharBuffer_append(buffer, ",");
@@ -2905,6 +3496,7 @@ static void ODEModel_generateCVODEJacobianFunction(odeModel_t *om,
     }
   }
   /* reset parameters for printout etc. */
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,
 		    "if (  (data->opt->Sensitivity && data->os ) &&"\
 		    " (!data->os->sensitivity || !data->model->jacobian))\n"\
@@ -2921,12 +3513,13 @@ static void ODEModel_generateCVODEJacobianFunction(odeModel_t *om,
    the value of 'COMPILED_JACOBIAN_FUNCTION_NAME' which
    calculates the Jacobian for the set of ODEs being solved. */
 static void ODEModel_generateCVODEAdjointJacobianFunction(odeModel_t *om,
-						   charBuffer_t *buffer)
+							  codeGenerator_t *gen)
 {
   int i, j ;
   ASTNode_t *jacob_ji;
-  float val;
+  charBuffer_t *buffer;
 
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,"DLL_EXPORT int ");
   CharBuffer_append(buffer,COMPILED_ADJOINT_JACOBIAN_FUNCTION_NAME);
   CharBuffer_append(buffer,
@@ -2945,15 +3538,14 @@ static void ODEModel_generateCVODEAdjointJacobianFunction(odeModel_t *om,
 		    "data->currenttime = t;\n"				\
 		    "\n");
 
+  CodeGenerator_beginFunction(gen, COMPILE_ADJOINT,
+			      COMPILED_ADJOINT_JACOBIAN_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, DlsMat JB",
+			      "(data, value, ydata, JB)");
+
   /** update ODE variables from CVODE */
-  for ( i=0; i<om->neq; i++ )
-  {
-    CharBuffer_append(buffer, "value[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "] = ydata[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "];\n");
-  }
+  ODEModel_generateVariableUpdate(om, gen);
 
   /** evaluate Jacobian J = df/dx */
   for ( i=0; i<om->neq; i++ )
@@ -2961,16 +3553,11 @@ static void ODEModel_generateCVODEAdjointJacobianFunction(odeModel_t *om,
     for ( j=0; j<om->neq; j++ )
     {
       jacob_ji = om->jacob[j][i];
-      /*  check whether jacobian is 0  */
-      val = 1;
-      if ( ASTNode_isInteger(jacob_ji) )
-	val = (double) ASTNode_getInteger(jacob_ji) ;
-      if ( ASTNode_isReal(jacob_ji) )
-	val = ASTNode_getReal(jacob_ji) ;
 
       /* write Jacobi evaluation only if entry is not 0 */
-      if ( val != 0.0 )
+      if ( ODEModel_isNonzero(jacob_ji) )
       {
+	buffer = CodeGenerator_statement(gen);
 	CharBuffer_append(buffer, "DENSE_ELEM(JB,");
 	CharBuffer_appendInt(buffer, i);
 	CharBuffer_append(buffer, ",");
@@ -2982,53 +3569,124 @@ static void ODEModel_generateCVODEAdjointJacobianFunction(odeModel_t *om,
     }
   }
   /* CharBuffer_append(buffer, "printf(\"JA\");"); */
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer, "return (0);\n");
 
   CharBuffer_append(buffer, "}\n");
 }
 
 /* appends compiled code to the given buffer for the function called
-   by the value of 'COMPILED_SENSITIVITY_FUNCTION_NAME' which
-   calculates the sensitivities (derived from Jacobian and parametrix
-   matrices) for the set of ODEs being solved. */
-static void ODESense_generateCVODESensitivityFunction(odeSense_t *os,
-					       charBuffer_t *buffer)
+   by the value of 'COMPILED_ADJOINT_JACV_FUNCTION_NAME' which
+   calculates the product of the adjoint Jacobian -[df/dx]^T with a
+   vector for the Krylov solver of the backward phase; only the
+   non-zero entries of the Jacobian are generated */
+static void ODEModel_generateCVODEAdjointJacobianTimesVectorFunction(odeModel_t *om,
+								     codeGenerator_t *gen)
 {
-  int i, j, k;
-  double val;
-  ASTNode_t *jacob_ij, *sens_ik;
+  int i;
+  nonzeroElem_t *nonzero;
+  charBuffer_t *buffer;
 
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,"DLL_EXPORT int ");
-  CharBuffer_append(buffer,COMPILED_SENSITIVITY_FUNCTION_NAME);
+  CharBuffer_append(buffer,COMPILED_ADJOINT_JACV_FUNCTION_NAME);
   CharBuffer_append(buffer,
-		    "(int Ns, realtype t, N_Vector y, N_Vector ydot,\n"\
-		    " int iS, N_Vector yS, N_Vector ySdot, \n"
-		    " void *fs_data, N_Vector tmp1, N_Vector tmp2)\n"\
+		    "(N_Vector vB, N_Vector JvB, realtype t, N_Vector y,\n"\
+		    "    N_Vector yB, N_Vector fyB, void *jac_dataB,"\
+		    " N_Vector tmpB)\n"\
 		    "{\n"\
-		    "  \n"\
-		    "realtype *ydata, *ySdata, *dySdata;\n"\
-		    "cvodeData_t *data;\n"\
-		    "realtype *value;\n"\
-		    "data = (cvodeData_t *) fs_data;\n"\
-		    "value = data->value ;\n"\
-		    "ydata = NV_DATA_S(y);\n"\
-		    "ySdata = NV_DATA_S(yS);\n"\
-		    "dySdata = NV_DATA_S(ySdot);\n"\
-		    "data->currenttime = t;\n");
-
+		    "    realtype *ydata, *vBdata, *JvBdata;\n"\
+		    "    cvodeData_t *data;\n"\
+		    "    realtype *value ;\n"\
+		    "    data = (cvodeData_t *) jac_dataB;\n"\
+		    "    value = data->value;\n"\
+		    "    ydata = NV_DATA_S(y);\n"\
+		    "    vBdata = NV_DATA_S(vB);\n"\
+		    "    JvBdata = NV_DATA_S(JvB);\n"\
+		    "    data->currenttime = t;\n");
+
+  CodeGenerator_beginFunction(gen, COMPILE_ADJOINT,
+			      COMPILED_ADJOINT_JACV_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, realtype *vBdata,"\
+			      " realtype *JvBdata",
+			      "(data, value, ydata, vBdata, JvBdata)");
+
   /** update ODE variables from CVODE */
-  for ( i=0; i<os->om->neq; i++ )
+  ODEModel_generateVariableUpdate(om, gen);
+
+  for ( i=0; i<om->neq; i++ )
   {
-    CharBuffer_append(buffer, "value[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "] = ydata[");
+    buffer = CodeGenerator_statement(gen);
+    CharBuffer_append(buffer, "JvBdata[");
     CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "];\n\n");
+    CharBuffer_append(buffer, "] = 0.0;\n");
+  }
+
+  /** evaluate -[df/dx]^T * vB, transposed over the non-zero
+      Jacobi elements */
+  for ( i=0; i<om->sparsesize; i++ )
+  {
+    nonzero = om->jacobSparse[i];
+    buffer = CodeGenerator_statement(gen);
+    CharBuffer_append(buffer, "JvBdata[");
+    CharBuffer_appendInt(buffer, nonzero->j);
+    CharBuffer_append(buffer, "] -= ( ");
+    generateAST(buffer, nonzero->ij);
+    CharBuffer_append(buffer, " ) * vBdata[");
+    CharBuffer_appendInt(buffer, nonzero->i);
+    CharBuffer_append(buffer, "];\n");
   }
 
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer, "return (0);\n");
+  CharBuffer_append(buffer, "}\n\n");
+}
+
+/* appends compiled code to the given buffer for the function called
+   by the value of 'COMPILED_SENSITIVITY_FUNCTION_NAME' which
+   calculates the sensitivities (derived from Jacobian and parametrix
+   matrices) for the set of ODEs being solved. */
+static void ODESense_generateCVODESensitivityFunction(odeSense_t *os,
+						      codeGenerator_t *gen)
+{
+  int i, j, k;
+  ASTNode_t *jacob_ij, *sens_ik;
+  charBuffer_t *buffer;
+
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer,"DLL_EXPORT int ");
+  CharBuffer_append(buffer,COMPILED_SENSITIVITY_FUNCTION_NAME);
+  CharBuffer_append(buffer,
+		    "(int Ns, realtype t, N_Vector y, N_Vector ydot,\n"\
+		    " int iS, N_Vector yS, N_Vector ySdot, \n"
+		    " void *fs_data, N_Vector tmp1, N_Vector tmp2)\n"\
+		    "{\n"\
+		    "  \n"\
+		    "realtype *ydata, *ySdata, *dySdata;\n"\
+		    "cvodeData_t *data;\n"\
+		    "realtype *value;\n"\
+		    "data = (cvodeData_t *) fs_data;\n"\
+		    "value = data->value ;\n"\
+		    "ydata = NV_DATA_S(y);\n"\
+		    "ySdata = NV_DATA_S(yS);\n"\
+		    "dySdata = NV_DATA_S(ySdot);\n"\
+		    "data->currenttime = t;\n");
+
+  CodeGenerator_beginFunction(gen, COMPILE_SENSITIVITY,
+			      COMPILED_SENSITIVITY_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, realtype *ySdata,"\
+			      " realtype *dySdata, int iS",
+			      "(data, value, ydata, ySdata, dySdata, iS)");
+
+  /** update ODE variables from CVODE */
+  ODEModel_generateVariableUpdate(os->om, gen);
+
   /** evaluate sensitivity RHS: df/dx * s + df/dp for one p */
   for ( i=0; i<os->om->neq; i++ )
   {
+    buffer = CodeGenerator_statement(gen);
     CharBuffer_append(buffer, "dySdata[");
     CharBuffer_appendInt(buffer, i);
     CharBuffer_append(buffer, "] = 0.0;\n");
@@ -3036,16 +3694,11 @@ static void ODESense_generateCVODESensitivityFunction(odeSense_t *os,
     {
       /* only non-zero Jacobi elements */
       jacob_ij = os->om->jacob[i][j];
-      /*  check whether jacobian is 0  */
-      val = 1;
-      if ( ASTNode_isInteger(jacob_ij) )
-	val = (double) ASTNode_getInteger(jacob_ij) ;
-      if ( ASTNode_isReal(jacob_ij) )
-	val = ASTNode_getReal(jacob_ij) ;
 
       /* write Jacobi evaluation only if entry is not 0 */
-      if ( val != 0.0 )
+      if ( ODEModel_isNonzero(jacob_ij) )
       {
+	buffer = CodeGenerator_statement(gen);
 	CharBuffer_append(buffer, "dySdata[");
 	CharBuffer_appendInt(buffer, i);
 	CharBuffer_append(buffer, "] += ( ");
@@ -3067,15 +3720,10 @@ static void ODESense_generateCVODESensitivityFunction(odeSense_t *os,
       {
 	/* only non-zero Jacobi elements */
 	sens_ik = os->sens[i][os->index_sensP[k]];
-	/*  check whether jacobian is 0  */
-	val = 1;
-	if ( ASTNode_isInteger(sens_ik) )
-	  val = (double) ASTNode_getInteger(sens_ik) ;
-	if ( ASTNode_isReal(sens_ik) )
-	  val = ASTNode_getReal(sens_ik) ;
 
-	if ( val != 0.0 )
+	if ( ODEModel_isNonzero(sens_ik) )
 	{
+	  buffer = CodeGenerator_statement(gen);
 	  CharBuffer_append(buffer, "if ( ");
 	  CharBuffer_appendInt(buffer, k);
 	  CharBuffer_append(buffer, " == iS ) ");
@@ -3094,6 +3742,7 @@ static void ODESense_generateCVODESensitivityFunction(odeSense_t *os,
     }
   }
   /* CharBuffer_append(buffer, "printf(\"S\");"); */
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer, "return (0);\n");
 
   CharBuffer_append(buffer, "}\n\n");
@@ -3103,12 +3752,13 @@ static void ODESense_generateCVODESensitivityFunction(odeSense_t *os,
 /* appends compiled code to the given buffer for the function called
    by the value of 'COMPILED_ADJOINT_QUAD_FUNCTION_NAME' */
 static void ODESense_generateCVODEAdjointQuadFunction(odeSense_t *os,
-					       charBuffer_t *buffer)
+						      codeGenerator_t *gen)
 {
   int i, k;
-  double val;
   ASTNode_t *sens_ik;
+  charBuffer_t *buffer;
 
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer,"DLL_EXPORT int ");
   CharBuffer_append(buffer,COMPILED_ADJOINT_QUAD_FUNCTION_NAME);
   CharBuffer_append(buffer,
@@ -3126,19 +3776,20 @@ static void ODESense_generateCVODEAdjointQuadFunction(odeSense_t *os,
 		    "dqAdata = NV_DATA_S(qAdot);\n"\
 		    "data->currenttime = t;\n");
 
+  CodeGenerator_beginFunction(gen, COMPILE_SENSITIVITY,
+			      COMPILED_ADJOINT_QUAD_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, realtype *yAdata,"\
+			      " realtype *dqAdata",
+			      "(data, value, ydata, yAdata, dqAdata)");
+
   /** update ODE variables from CVODE */
-  for ( i=0; i<os->om->neq; i++ )
-  {
-    CharBuffer_append(buffer, "value[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "] = ydata[");
-    CharBuffer_appendInt(buffer, i);
-    CharBuffer_append(buffer, "];\n\n");
-  }
+  ODEModel_generateVariableUpdate(os->om, gen);
 
   /** evaluate quadrature integrand: yA^T * df/dp */
   for ( k=0; k<os->nsens; k++ )
   {
+    buffer = CodeGenerator_statement(gen);
     CharBuffer_append(buffer, "dqAdata[");
     CharBuffer_appendInt(buffer, k);
     CharBuffer_append(buffer, "] = 0.0;\n");
@@ -3150,15 +3801,9 @@ static void ODESense_generateCVODEAdjointQuadFunction(odeSense_t *os,
 	/* only non-zero param matrix elements */
 	sens_ik = os->sens[i][os->index_sensP[k]];
 
-	/*  check whether element is 0  */
-	val = 1;
-	if ( ASTNode_isInteger(sens_ik) )
-	  val = (double) ASTNode_getInteger(sens_ik) ;
-	if ( ASTNode_isReal(sens_ik) )
-	  val = ASTNode_getReal(sens_ik) ;
-
-	if ( val != 0.0 )
+	if ( ODEModel_isNonzero(sens_ik) )
 	{
+	  buffer = CodeGenerator_statement(gen);
 	  CharBuffer_append(buffer, "dqAdata[");
 	  CharBuffer_appendInt(buffer, k);
 	  CharBuffer_append(buffer, "] += ");
@@ -3176,12 +3821,519 @@ static void ODESense_generateCVODEAdjointQuadFunction(odeSense_t *os,
     }
   }
 
+  buffer = CodeGenerator_direct(gen);
   CharBuffer_append(buffer, "return (0);\n");
 
   /* CharBuffer_append(buffer, "printf(\"qa\");"); */
   CharBuffer_append(buffer, "}\n\n");
 }
 
+/* appends compiled code to the given buffer for a function called by
+   the value of 'name' which evaluates the given set of assignment
+   rules, e.g. for the refresh of all rules in
+   IntegratorInstance_updateData */
+static void ODEModel_generateAssignmentFunction(const char *name, int nass,
+						nonzeroElem_t **orderedList,
+						codeGenerator_t *gen)
+{
+  charBuffer_t *buffer;
+
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer,"DLL_EXPORT void ");
+  CharBuffer_append(buffer, name);
+  CharBuffer_append(buffer,"(cvodeData_t *data)\n"\
+		    "{\n"\
+		    "    realtype *value = data->value;\n");
+
+  CodeGenerator_beginFunction(gen, COMPILE_MAIN, name,
+			      "cvodeData_t *data, realtype *value",
+			      "(data, value)");
+  ODEModel_generateAssignmentRuleCode(nass, orderedList, gen);
+
+  CharBuffer_append(CodeGenerator_direct(gen), "}\n\n");
+}
+
+/* appends compiled code to the given buffer for the function called
+   by the value of 'COMPILED_STEADYSTATE_FUNCTION_NAME' which
+   evaluates each ODE once and writes the sums of |f|, f and f^2
+   to 'sums', from which IntegratorInstance_checkSteadyState
+   calculates mean and standard deviation of rates */
+static void ODEModel_generateSteadyStateFunction(odeModel_t *om,
+						 codeGenerator_t *gen)
+{
+  int i;
+  charBuffer_t *buffer;
+
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer,"DLL_EXPORT void ");
+  CharBuffer_append(buffer,COMPILED_STEADYSTATE_FUNCTION_NAME);
+  CharBuffer_append(buffer,"(cvodeData_t *data, double *sums)\n"\
+		    "{\n"\
+		    "    realtype *value = data->value;\n"\
+		    "    sums[0] = sums[1] = sums[2] = 0.0;\n");
+
+  CodeGenerator_beginFunction(gen, COMPILE_MAIN,
+			      COMPILED_STEADYSTATE_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " double *sums",
+			      "(data, value, sums)");
+
+  for ( i=0; i<om->neq; i++ )
+  {
+    buffer = CodeGenerator_statement(gen);
+    CharBuffer_append(buffer, "{ realtype f = ");
+    generateAST(buffer, om->ode[i]);
+    CharBuffer_append(buffer, ";\n"\
+		      "sums[0] += fabs(f); sums[1] += f; sums[2] += f*f; }\n");
+  }
+
+  CharBuffer_append(CodeGenerator_direct(gen), "}\n\n");
+}
+
+/* appends compiled code to the given buffer for the function called
+   by the value of 'COMPILED_IDA_RESIDUAL_FUNCTION_NAME' which
+   calculates the residual function for the IDA DAE solver, the same
+   residual as calculated by fRes in daeSolver.c */
+static void ODEModel_generateIDAResidualFunction(odeModel_t *om,
+						 codeGenerator_t *gen)
+{
+  int i;
+  charBuffer_t *buffer;
+
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer,"DLL_EXPORT int ");
+  CharBuffer_append(buffer,COMPILED_IDA_RESIDUAL_FUNCTION_NAME);
+  CharBuffer_append(buffer,
+		    "(realtype t, N_Vector y, N_Vector dy, N_Vector r,"\
+		    " void *f_data)\n"\
+		    "{\n"\
+		    "    realtype *ydata, *dydata, *resdata;\n"\
+		    "    cvodeData_t *data;\n"\
+		    "    realtype *value ;\n"\
+		    "    data = (cvodeData_t *) f_data;\n"\
+		    "    value = data->value;\n"\
+		    "    ydata = NV_DATA_S(y);\n"\
+		    "    dydata = NV_DATA_S(dy);\n"\
+		    "    resdata = NV_DATA_S(r);\n"\
+		    "    data->currenttime = t;\n");
+
+  CodeGenerator_beginFunction(gen, COMPILE_MAIN,
+			      COMPILED_IDA_RESIDUAL_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, realtype *dydata,"\
+			      " realtype *resdata",
+			      "(data, value, ydata, dydata, resdata)");
+
+  ODEModel_generateVariableUpdate(om, gen);
+  ODEModel_generateAssignmentRuleCode(om->nass, om->assignmentOrder, gen);
+
+  for ( i=0; i<om->neq; i++ )
+  {
+    buffer = CodeGenerator_statement(gen);
+    CharBuffer_append(buffer, "resdata[");
+    CharBuffer_appendInt(buffer, i);
+    CharBuffer_append(buffer, "] = ");
+    generateAST(buffer, om->ode[i]);
+    CharBuffer_append(buffer, " - dydata[");
+    CharBuffer_appendInt(buffer, i);
+    CharBuffer_append(buffer, "];\n");
+  }
+  for ( i=0; i<om->nalg; i++ )
+  {
+    buffer = CodeGenerator_statement(gen);
+    CharBuffer_append(buffer, "resdata[");
+    CharBuffer_appendInt(buffer, i);
+    CharBuffer_append(buffer, "] = ");
+    generateAST(buffer, om->algebraic[i]);
+    CharBuffer_append(buffer, ";\n");
+  }
+
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer, "return (0);\n");
+  CharBuffer_append(buffer, "}\n\n");
+}
+
+/* appends compiled code to the given buffer for the function called
+   by the value of 'COMPILED_IDA_JACOBIAN_FUNCTION_NAME' which
+   calculates the residual Jacobian df/dy - cj*I for the IDA DAE
+   solver; IDA passes a zeroed matrix, so only non-zero elements
+   are written */
+static void ODEModel_generateIDAJacobianFunction(odeModel_t *om,
+						 codeGenerator_t *gen)
+{
+  int i;
+  nonzeroElem_t *nonzero;
+  charBuffer_t *buffer;
+
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer,"DLL_EXPORT int ");
+  CharBuffer_append(buffer,COMPILED_IDA_JACOBIAN_FUNCTION_NAME);
+  CharBuffer_append(buffer,
+		    "(int N, realtype t, realtype cj, N_Vector y,"\
+		    " N_Vector dy,\n"\
+		    "    N_Vector resvec, DlsMat J, void *jac_data,\n"\
+		    "    N_Vector tmp1, N_Vector tmp2, N_Vector tmp3)\n"\
+		    "{\n"\
+		    "    int i, j;\n"\
+		    "    realtype *ydata;\n"\
+		    "    cvodeData_t *data;\n"\
+		    "    realtype *value ;\n"\
+		    "    data = (cvodeData_t *) jac_data;\n"\
+		    "    value = data->value;\n"\
+		    "    ydata = NV_DATA_S(y);\n"\
+		    "    data->currenttime = t;\n");
+
+  CodeGenerator_beginFunction(gen, COMPILE_MAIN,
+			      COMPILED_IDA_JACOBIAN_FUNCTION_NAME,
+			      "cvodeData_t *data, realtype *value,"\
+			      " realtype *ydata, DlsMat J",
+			      "(data, value, ydata, J)");
+
+  ODEModel_generateVariableUpdate(om, gen);
+  ODEModel_generateAssignmentRuleCode(om->nass, om->assignmentOrder, gen);
+
+  for ( i=0; i<om->sparsesize; i++ )
+  {
+    nonzero = om->jacobSparse[i];
+    buffer = CodeGenerator_statement(gen);
+    CharBuffer_append(buffer, "DENSE_ELEM(J,");
+    CharBuffer_appendInt(buffer, nonzero->i);
+    CharBuffer_append(buffer, ",");
+    CharBuffer_appendInt(buffer, nonzero->j);
+    CharBuffer_append(buffer, ") = ");
+    generateAST(buffer, nonzero->ij);
+    CharBuffer_append(buffer, ";\n");
+  }
+
+  buffer = CodeGenerator_direct(gen);
+  CharBuffer_append(buffer, "for ( i=0; i<");
+  CharBuffer_appendInt(buffer, om->neq);
+  CharBuffer_append(buffer, "; i++ )\n"\
+		    "    DENSE_ELEM(J,i,i) -= cj;\n");
+
+  /* algebraic jacobian, as in JacRes */
+  CharBuffer_append(buffer, "for ( i=0; i<");
+  CharBuffer_appendInt(buffer, om->nalg);
+  CharBuffer_append(buffer, "; i++ )\n"\
+		    "    for ( j=0; j<");
+  CharBuffer_appendInt(buffer, om->nalg);
+  CharBuffer_append(buffer, "; j++ )\n"\
+		    "        DENSE_ELEM(J,i,j) = 1.;\n");
+
+  CharBuffer_append(buffer, "return (0);\n");
+  CharBuffer_append(buffer, "}\n\n");
+}
+
+/* appends compiled code to the given buffer for the functions called
+   by the values of 'COMPILED_OBJECTIVE_FUNCTION_NAME', which returns
+   the general objective function, and of
+   'COMPILED_VECTOR_V_FUNCTION_NAME', which adds 'scale' times the
+   vector v of the linear objective to the array 'out'; each function
+   is only generated if its expression has been set */
+static void ODEModel_generateObjectiveFunctions(odeModel_t *om,
+						charBuffer_t *buffer)
+{
+  int i;
+
+  if ( om->ObjectiveFunction != NULL )
+  {
+    CharBuffer_append(buffer,"DLL_EXPORT double ");
+    CharBuffer_append(buffer,COMPILED_OBJECTIVE_FUNCTION_NAME);
+    CharBuffer_append(buffer,"(cvodeData_t *data)\n"\
+		      "{\n"\
+		      "    realtype *value = data->value;\n"\
+		      "    return ");
+    generateAST(buffer, om->ObjectiveFunction);
+    CharBuffer_append(buffer, ";\n}\n\n");
+  }
+
+  if ( om->vector_v != NULL )
+  {
+    CharBuffer_append(buffer,"DLL_EXPORT void ");
+    CharBuffer_append(buffer,COMPILED_VECTOR_V_FUNCTION_NAME);
+    CharBuffer_append(buffer,"(cvodeData_t *data, double *out,"\
+		      " double scale)\n"\
+		      "{\n"\
+		      "    realtype *value = data->value;\n");
+    for ( i=0; i<om->neq; i++ )
+    {
+      CharBuffer_append(buffer, "out[");
+      CharBuffer_appendInt(buffer, i);
+      CharBuffer_append(buffer, "] += scale * ( ");
+      generateAST(buffer, om->vector_v[i]);
+      CharBuffer_append(buffer, " );\n");
+    }
+    CharBuffer_append(buffer, "}\n\n");
+  }
+}
+
+/* appends a loop over the W lanes for one assignment to the buffer,
+   to `target[W*index+l]' from the given AST */
+static void ODEModel_generateLaneAssignment(const char *target, int index,
+					    ASTNode_t *node,
+					    charBuffer_t *buffer)
+{
+  CharBuffer_append(buffer, "for ( l=0; l<W; l++ )\n    ");
+  CharBuffer_append(buffer, target);
+  CharBuffer_append(buffer, "[W*");
+  CharBuffer_appendInt(buffer, index);
+  CharBuffer_append(buffer, "+l] = ");
+  generateLaneAST(buffer, node);
+  CharBuffer_append(buffer, ";\n");
+}
+
+/* appends compiled code to the given buffer for the functions of the
+   ensemble solver called by the values of
+   'COMPILED_ENSEMBLE_RHS_FUNCTION_NAME', which evaluates the ODEs for
+   W parameter sets (lanes) at once, and of
+   'COMPILED_ENSEMBLE_ASSIGNMENT_FUNCTION_NAME', which evaluates all
+   assignment rules of W lanes.  All arrays store the lanes of one
+   index contiguously, such that each statement is a loop over the
+   lanes, which the compiler vectorizes; with gcc on x86-64 the
+   functions are compiled for AVX-512, AVX2 and the default
+   instruction set, and the best version is chosen at load time. */
+static void ODEModel_generateEnsembleFunctions(odeModel_t *om,
+					       charBuffer_t *buffer)
+{
+  int i;
+  nonzeroElem_t *ordered;
+
+  CharBuffer_append(buffer,
+		    "#if defined(__GNUC__) && __GNUC__ >= 6 && "\
+		    "defined(__x86_64__) && !defined(__TINYC__) && "\
+		    "!defined(__clang__)\n"\
+		    "#define ENSEMBLE_TARGETS __attribute__ ((target_clones"\
+		    "(\"avx512f\", \"avx2\", \"default\")))\n"\
+		    "#else\n"\
+		    "#define ENSEMBLE_TARGETS\n"\
+		    "#endif\n\n");
+
+  CharBuffer_append(buffer, "DLL_EXPORT ENSEMBLE_TARGETS void ");
+  CharBuffer_append(buffer, COMPILED_ENSEMBLE_RHS_FUNCTION_NAME);
+  CharBuffer_append(buffer,
+		    "(int W, double t, void *f_data, double *value,\n"\
+		    "    const double *y, double *dy)\n"\
+		    "{\n"\
+		    "    int l;\n"\
+		    "    cvodeData_t *data = (cvodeData_t *) f_data;\n"\
+		    "    data->currenttime = t;\n");
+
+  /* update ODE variables, the first neq values */
+  CharBuffer_append(buffer, "for ( l=0; l<W*");
+  CharBuffer_appendInt(buffer, om->neq);
+  CharBuffer_append(buffer, "; l++ )\n    value[l] = y[l];\n");
+
+  for ( i=0; i<om->nassbeforeodes; i++ )
+  {
+    ordered = om->assignmentsBeforeODEs[i];
+    ODEModel_generateLaneAssignment("value", ordered->i, ordered->ij, buffer);
+  }
+
+  for ( i=0; i<om->neq; i++ )
+    ODEModel_generateLaneAssignment("dy", i, om->ode[i], buffer);
+
+  CharBuffer_append(buffer, "}\n\n");
+
+  CharBuffer_append(buffer, "DLL_EXPORT ENSEMBLE_TARGETS void ");
+  CharBuffer_append(buffer, COMPILED_ENSEMBLE_ASSIGNMENT_FUNCTION_NAME);
+  CharBuffer_append(buffer,
+		    "(int W, void *f_data, double *value)\n"\
+		    "{\n"\
+		    "    int l;\n"\
+		    "    cvodeData_t *data = (cvodeData_t *) f_data;\n");
+
+  for ( i=0; i<om->nass; i++ )
+  {
+    ordered = om->assignmentOrder[i];
+    ODEModel_generateLaneAssignment("value", ordered->i, ordered->ij, buffer);
+  }
+
+  /* data is only used by observation data and time */
+  CharBuffer_append(buffer, "(void) data;\n}\n\n");
+}
+
+/* appends compiled code to the given buffer for the functions of the
+   stochastic solver called by the values of
+   'COMPILED_STOCHASTIC_PROPENSITY_FUNCTION_NAME', which evaluates the
+   kinetic law of reaction j of the SBML input model, and of
+   'COMPILED_STOCHASTIC_ASSIGNMENT_FUNCTION_NAME', which evaluates all
+   assignment rules */
+static void ODEModel_generateStochasticFunctions(odeModel_t *om,
+						 charBuffer_t *buffer)
+{
+  int i, idx;
+  unsigned int j;
+  nonzeroElem_t *ordered;
+
+  CharBuffer_append(buffer, "DLL_EXPORT double ");
+  CharBuffer_append(buffer, COMPILED_STOCHASTIC_PROPENSITY_FUNCTION_NAME);
+  CharBuffer_append(buffer,
+		    "(void *f_data, int j)\n"\
+		    "{\n"\
+		    "    cvodeData_t *data = (cvodeData_t *) f_data;\n"\
+		    "    realtype *value = data->value;\n"\
+		    "    switch ( j )\n"\
+		    "    {\n");
+
+  for ( j=0; j<Model_getNumReactions(om->m); j++ )
+  {
+    idx = ODEModel_getVariableIndexFields(om,
+		 Reaction_getId(Model_getReaction(om->m, j)));
+    if ( idx < om->neq || idx >= om->neq + om->nass )
+      continue;
+    CharBuffer_append(buffer, "    case ");
+    CharBuffer_appendInt(buffer, j);
+    CharBuffer_append(buffer, ": return ");
+    generateAST(buffer, om->assignment[idx - om->neq]);
+    CharBuffer_append(buffer, ";\n");
+  }
+
+  CharBuffer_append(buffer,
+		    "    }\n"\
+		    "    (void) value;\n"\
+		    "    return 0.0;\n"\
+		    "}\n\n");
+
+  CharBuffer_append(buffer, "DLL_EXPORT void ");
+  CharBuffer_append(buffer, COMPILED_STOCHASTIC_ASSIGNMENT_FUNCTION_NAME);
+  CharBuffer_append(buffer,
+		    "(void *f_data)\n"\
+		    "{\n"\
+		    "    cvodeData_t *data = (cvodeData_t *) f_data;\n"\
+		    "    realtype *value = data->value;\n");
+
+  for ( i=0; i<om->nass; i++ )
+  {
+    ordered = om->assignmentOrder[i];
+    ODEModel_generateAssignmentCode(ordered->i, ordered->ij, buffer);
+  }
+
+  CharBuffer_append(buffer, "(void) value;\n}\n\n");
+}
+
+/* appends compiled code to the given buffers for chunk c of a
+   partitioned model: the functions called by the values of
+   'COMPILED_PARTITION_RULE_FUNCTION_NAME'_l_c for the rules of each
+   level l and 'COMPILED_PARTITION_ODE_FUNCTION_NAME'_c for the ODEs
+   to rhs, and 'COMPILED_PARTITION_JACOBIAN_FUNCTION_NAME'_c for the
+   Jacobian entries to jacobian, if not NULL */
+static void ODEModel_generatePartitionFunctions(odePartition_t *partition,
+						int c, charBuffer_t *rhs,
+						charBuffer_t *jacobian)
+{
+  int k, l;
+  const int *bound;
+  nonzeroElem_t *nonzero;
+  odeModel_t *om = partition->om;
+
+  for ( l=0; l<partition->nlevels; l++ )
+  {
+    bound = partition->ruleBound + l*partition->nchunks;
+    CharBuffer_append(rhs, "DLL_EXPORT void ");
+    CharBuffer_append(rhs, COMPILED_PARTITION_RULE_FUNCTION_NAME);
+    CharBuffer_append(rhs, "_");
+    CharBuffer_appendInt(rhs, l);
+    CharBuffer_append(rhs, "_");
+    CharBuffer_appendInt(rhs, c);
+    CharBuffer_append(rhs,
+		      "(void *f_data, double *value)\n"\
+		      "{\n"\
+		      "    cvodeData_t *data = (cvodeData_t *) f_data;\n");
+    for ( k=bound[c]; k<bound[c+1]; k++ )
+      ODEModel_generateAssignmentCode(partition->rule[k]->i,
+				      partition->rule[k]->ij, rhs);
+    CharBuffer_append(rhs, "(void) data;\n}\n\n");
+  }
+
+  CharBuffer_append(rhs, "DLL_EXPORT void ");
+  CharBuffer_append(rhs, COMPILED_PARTITION_ODE_FUNCTION_NAME);
+  CharBuffer_append(rhs, "_");
+  CharBuffer_appendInt(rhs, c);
+  CharBuffer_append(rhs,
+		    "(void *f_data, double *value, double *dydata)\n"\
+		    "{\n"\
+		    "    cvodeData_t *data = (cvodeData_t *) f_data;\n");
+  for ( k=partition->odeBound[c]; k<partition->odeBound[c+1]; k++ )
+  {
+    CharBuffer_append(rhs, "dydata[");
+    CharBuffer_appendInt(rhs, k);
+    CharBuffer_append(rhs, "] = ");
+    generateAST(rhs, om->ode[k]);
+    CharBuffer_append(rhs, ";\n");
+  }
+  CharBuffer_append(rhs, "(void) data;\n(void) value;\n}\n\n");
+
+  if ( jacobian == NULL )
+    return;
+
+  CharBuffer_append(jacobian, "DLL_EXPORT void ");
+  CharBuffer_append(jacobian, COMPILED_PARTITION_JACOBIAN_FUNCTION_NAME);
+  CharBuffer_append(jacobian, "_");
+  CharBuffer_appendInt(jacobian, c);
+  CharBuffer_append(jacobian,
+		    "(void *f_data, double *value, double **jac)\n"\
+		    "{\n"\
+		    "    cvodeData_t *data = (cvodeData_t *) f_data;\n");
+  for ( k=partition->jacobianBound[c]; k<partition->jacobianBound[c+1]; k++ )
+  {
+    nonzero = om->jacobSparse[k];
+    CharBuffer_append(jacobian, "jac[");
+    CharBuffer_appendInt(jacobian, nonzero->j);
+    CharBuffer_append(jacobian, "][");
+    CharBuffer_appendInt(jacobian, nonzero->i);
+    CharBuffer_append(jacobian, "] = ");
+    generateAST(jacobian, nonzero->ij);
+    CharBuffer_append(jacobian, ";\n");
+  }
+  CharBuffer_append(jacobian, "(void) data;\n(void) value;\n}\n\n");
+}
+
+/** Sets the maximal number of statements in the helper functions
+    into which large generated functions are split before
+    compilation; the helpers are spread over several source files
+    which are compiled in parallel.  0 disables splitting, which is
+    the default on platforms without gcc.  Takes effect when the
+    model functions are compiled next.
+*/
+SBML_ODESOLVER_API void ODEModel_setCompileChunkSize(odeModel_t *om, int n)
+{
+  om->compileChunkSize = n < 0 ? 0 : n;
+}
+
+/** Sets the optimization level (0-3) for compiling the code of the
+    given kind (a compileKind_t), or for all kinds if kind is -1.
+    Returns 0 if kind or level are invalid, 1 otherwise.  Takes
+    effect when the model functions are compiled next.
+*/
+SBML_ODESOLVER_API int ODEModel_setCompileOptimization(odeModel_t *om, int kind, int level)
+{
+  int i;
+
+  if ( kind < -1 || kind >= COMPILE_NKINDS || level < 0 || level > 3 )
+    return 0;
+
+  for ( i=0; i<COMPILE_NKINDS; i++ )
+    if ( kind == -1 || kind == i )
+      om->compileOptimization[i] = level;
+  return 1;
+}
+
+/** Sets the compiler used for the model functions, COMPILER_SYSTEM
+    (default) or COMPILER_LIBTCC, which compiles in memory within
+    milliseconds but generates slower code, e.g. for short
+    simulations.  Returns 0 if the backend is not available, 1
+    otherwise.  Takes effect when the model functions are compiled
+    next.
+*/
+SBML_ODESOLVER_API int ODEModel_setCompileBackend(odeModel_t *om, compilerBackend_t backend)
+{
+  if ( !Compiler_hasBackend(backend) )
+    return 0;
+
+  om->compileBackend = backend;
+  return 1;
+}
+
 /* dynamically generates and complies the ODE RHS, Jacobian and
    Events handling functions for the given model.
    The jacobian function is not generated if the jacobian AST
@@ -3190,7 +4342,7 @@ static void ODESense_generateCVODEAdjointQuadFunction(odeSense_t *os,
 */
 int ODEModel_compileCVODEFunctions(odeModel_t *om)
 {
-  charBuffer_t *buffer = CharBuffer_create();
+  codeGenerator_t *gen;
 
 
   /* if available, the whole code needs recompilation, can happen
@@ -3200,74 +4352,39 @@ int ODEModel_compileCVODEFunctions(odeModel_t *om)
     CompiledCode_free(om->compiledCVODEFunctionCode);
     om->compiledCVODEFunctionCode = NULL;
   }
+  om->compiledIDAJacobianFunction = NULL;
+  om->compiledCVODEAdjointJacobianTimesVectorFunction = NULL;
 
-#ifdef _WIN32
-  CharBuffer_append(buffer,
-		    "#include <windows.h>\n"\
-		    "#include <math.h>\n"\
-		    "#include <sbmlsolver/sundialstypes.h>\n"\
-		    "#include <sbmlsolver/nvector.h>\n"\
-		    "#include <sbmlsolver/nvector_serial.h>\n"\
-		    "#include <sbmlsolver/dense.h>\n"\
-		    "#include <sbmlsolver/cvodes.h>\n"\
-		    "#include <sbmlsolver/cvodea.h>\n"\
-		    "#include <sbmlsolver/cvdense.h>\n"\
-		    "#include <sbmlsolver/cvodeData.h>\n"\
-		    "#include <sbmlsolver/cvodeSettings.h>\n"\
-		    "#include <sbmlsolver/odeModel.h>\n"\
-		    "#define DLL_EXPORT __declspec(dllexport)\n");
-
-#else
-  CharBuffer_append(buffer,
-		    "#include <math.h>\n"
-		    "#include \"cvodes/cvodes.h\"\n"
-		    "#include \"cvodes/cvodes_dense.h\"\n"
-		    "#include \"nvector/nvector_serial.h\"\n"
-		    "#include \"sbmlsolver/cvodeData.h\"\n"
-		    "#include \"sbmlsolver/processAST.h\"\n"
-#if __GNUC__ >= 4
-        "#define DLL_EXPORT extern \"C\" __attribute__ ((visibility (\"default\")))\n\n");
-#else
-        "#define DLL_EXPORT\n\n");
-#endif
-#endif
-
-  generateMacros(buffer);
+  gen = CodeGenerator_create(om);
+  if ( gen == NULL )
+    return 0;
 
   if ( om->jacobian )
   {
-    ODEModel_generateCVODEJacobianFunction(om, buffer);
-    ODEModel_generateCVODEAdjointJacobianFunction(om, buffer);
-    ODEModel_generateCVODEAdjointRHSFunction(om, buffer);
+    ODEModel_generateCVODEJacobianFunction(om, gen);
+    ODEModel_generateCVODEAdjointJacobianFunction(om, gen);
+    ODEModel_generateCVODEAdjointRHSFunction(om, gen);
+    ODEModel_generateCVODEAdjointJacobianTimesVectorFunction(om, gen);
+    ODEModel_generateIDAJacobianFunction(om, gen);
   }
 
-  ODEModel_generateEventFunction(om, buffer);
-  ODEModel_generateCVODERHSFunction(om, buffer);
-
-
-#ifdef _DEBUG /* write out source file for debugging*/
-  {
-    FILE *src;
-    char *srcname =  "rhsfunctions.c";
-    src = fopen(srcname, "w");
-    fprintf(src, "%s", CharBuffer_getBuffer(buffer));
-    fclose(src);
-  }
-#endif
-
-  /* now all required sourcecode is in `buffer' and can be sent
+  ODEModel_generateEventFunction(om, gen);
+  ODEModel_generateCVODERHSFunction(om, gen);
+  ODEModel_generateAssignmentFunction(COMPILED_ASSIGNMENT_FUNCTION_NAME,
+				      om->nass, om->assignmentOrder, gen);
+  ODEModel_generateAssignmentFunction(COMPILED_ODE_ASSIGNMENT_FUNCTION_NAME,
+				      om->nassbeforeodes,
+				      om->assignmentsBeforeODEs, gen);
+  ODEModel_generateSteadyStateFunction(om, gen);
+  ODEModel_generateIDAResidualFunction(om, gen);
+
+  /* now all required sourcecode is generated and can be sent
      to the compiler */
-  om->compiledCVODEFunctionCode =
-    Compiler_compile(CharBuffer_getBuffer(buffer));
-
+  om->compiledCVODEFunctionCode = CodeGenerator_compile(gen, "rhsfunctions");
+  CodeGenerator_free(gen);
 
   if ( om->compiledCVODEFunctionCode == NULL )
-  {
-    CharBuffer_free(buffer);
     return 0;
-  }
-
-  CharBuffer_free(buffer);
 
   /* attach pointers */
   om->compiledCVODERhsFunction =
@@ -3278,6 +4395,22 @@ int ODEModel_compileCVODEFunctions(odeModel_t *om)
     CompiledCode_getFunction(om->compiledCVODEFunctionCode,
 			     COMPILED_EVENT_FUNCTION_NAME);
 
+  om->compiledAssignmentFunction =
+    CompiledCode_getFunction(om->compiledCVODEFunctionCode,
+			     COMPILED_ASSIGNMENT_FUNCTION_NAME);
+
+  om->compiledAssignmentsBeforeODEsFunction =
+    CompiledCode_getFunction(om->compiledCVODEFunctionCode,
+			     COMPILED_ODE_ASSIGNMENT_FUNCTION_NAME);
+
+  om->compiledSteadyStateFunction =
+    CompiledCode_getFunction(om->compiledCVODEFunctionCode,
+			     COMPILED_STEADYSTATE_FUNCTION_NAME);
+
+  om->compiledIDAResidualFunction =
+    CompiledCode_getFunction(om->compiledCVODEFunctionCode,
+			     COMPILED_IDA_RESIDUAL_FUNCTION_NAME);
+
 
   if ( om->jacobian )
   {
@@ -3294,75 +4427,292 @@ int ODEModel_compileCVODEFunctions(odeModel_t *om)
       CompiledCode_getFunction(om->compiledCVODEFunctionCode,
 			       COMPILED_ADJOINT_RHS_FUNCTION_NAME);
 
+    om->compiledCVODEAdjointJacobianTimesVectorFunction =
+      CompiledCode_getFunction(om->compiledCVODEFunctionCode,
+			       COMPILED_ADJOINT_JACV_FUNCTION_NAME);
+
+    om->compiledIDAJacobianFunction =
+      CompiledCode_getFunction(om->compiledCVODEFunctionCode,
+			       COMPILED_IDA_JACOBIAN_FUNCTION_NAME);
   }
   return 1;
 }
 
 
-/* dynamically generates and compiles the ODE Sensitivity RHS
-   for the given model */
-int ODESense_compileCVODESenseFunctions(odeSense_t *os)
+/* dynamically generates and compiles the general objective function
+   and the vector v of the linear objective, if set; these are
+   compiled separately from the model functions, as they are usually
+   set after the model has been compiled.
+   Returns 1 if successful, 0 otherwise
+*/
+SBML_ODESOLVER_API int ODEModel_compileObjectiveFunctions(odeModel_t *om)
 {
-  charBuffer_t *buffer = CharBuffer_create();
+  charBuffer_t *buffer;
 
-#ifdef _WIN32
-  CharBuffer_append(buffer,
-		    "#include <windows.h>\n"\
-		    "#include <math.h>\n"\
-		    "#include <sbmlsolver/sundialstypes.h>\n"\
-		    "#include <sbmlsolver/nvector.h>\n"\
-		    "#include <sbmlsolver/nvector_serial.h>\n"\
-		    "#include <sbmlsolver/dense.h>\n" 
-		    "#include <sbmlsolver/cvodes.h>\n"\
-		    "#include <sbmlsolver/cvodea.h>\n"\
-		    "#include <sbmlsolver/cvdense.h>\n"\
-		    "#include <sbmlsolver/cvodeData.h>\n"\
-		    "#include <sbmlsolver/cvodeSettings.h>\n"\
-		    "#include <sbmlsolver/processAST.h>\n"\
-		    "#include <sbmlsolver/odeModel.h>\n"\
-		    "#define DLL_EXPORT __declspec(dllexport)\n");
-#else
-  CharBuffer_append(buffer,
-		    "#include <math.h>\n"
-		    "#include \"cvodes/cvodes.h\"\n"
-		    "#include \"cvodes/cvodes_dense.h\"\n"
-		    "#include \"nvector/nvector_serial.h\"\n"
-		    "#include \"sbmlsolver/cvodeData.h\"\n"
-		    "#include \"sbmlsolver/processAST.h\"\n"
-#if __GNUC__ >= 4
-        "#define DLL_EXPORT extern \"C\" __attribute__ ((visibility (\"default\")))\n\n");
-#else
-		    "#define DLL_EXPORT\n\n");
+  if ( om->compiledObjectiveCode != NULL )
+  {
+    CompiledCode_free(om->compiledObjectiveCode);
+    om->compiledObjectiveCode = NULL;
+  }
+  om->compiledObjectiveFunction = NULL;
+  om->compiledVectorVFunction = NULL;
+
+  /* don't retry upon failure, until the objective is set again */
+  om->recompileObjective = 0;
+
+  if ( om->ObjectiveFunction == NULL && om->vector_v == NULL )
+    return 1;
+
+  buffer = CharBuffer_create();
+  ODEModel_generateHeader(buffer);
+  ODEModel_generateObjectiveFunctions(om, buffer);
+
+#ifdef _DEBUG /* write out source file for debugging*/
+  {
+    FILE *src;
+    char *srcname =  "objfunctions.c";
+    src = fopen(srcname, "w");
+    fprintf(src, "%s", CharBuffer_getBuffer(buffer));
+    fclose(src);
+  }
 #endif
+
+  {
+    const char *source = CharBuffer_getBuffer(buffer);
+    om->compiledObjectiveCode =
+      Compiler_compileSourcesWithBackend(om->compileBackend, 1, &source,
+					 &om->compileOptimization[COMPILE_MAIN]);
+  }
+  CharBuffer_free(buffer);
+
+  if ( om->compiledObjectiveCode == NULL )
+    return 0;
+
+  if ( om->ObjectiveFunction != NULL )
+    om->compiledObjectiveFunction =
+      CompiledCode_getFunction(om->compiledObjectiveCode,
+			       COMPILED_OBJECTIVE_FUNCTION_NAME);
+
+  if ( om->vector_v != NULL )
+    om->compiledVectorVFunction =
+      CompiledCode_getFunction(om->compiledObjectiveCode,
+			       COMPILED_VECTOR_V_FUNCTION_NAME);
+
+  return 1;
+}
+
+
+/** dynamically generates and compiles the functions of the ensemble
+    solver, which evaluate the ODEs and assignment rules for several
+    parameter sets at once; these are compiled separately from the
+    model functions, with optimization level 3 for the vectorization
+    of the loops over the parameter sets.
+    Returns 1 if successful, 0 otherwise
+*/
+SBML_ODESOLVER_API int ODEModel_compileEnsembleFunctions(odeModel_t *om)
+{
+  int level = 3;
+  charBuffer_t *buffer;
+  const char *source;
+
+  if ( om->compiledEnsembleCode != NULL )
+    return 1;
+
+  buffer = CharBuffer_create();
+  ODEModel_generateHeader(buffer);
+  ODEModel_generateEnsembleFunctions(om, buffer);
+
+#ifdef _DEBUG /* write out source file for debugging*/
+  {
+    FILE *src;
+    char *srcname =  "ensemblefunctions.c";
+    src = fopen(srcname, "w");
+    fprintf(src, "%s", CharBuffer_getBuffer(buffer));
+    fclose(src);
+  }
 #endif
 
-  generateMacros(buffer);
+  source = CharBuffer_getBuffer(buffer);
+  om->compiledEnsembleCode =
+    Compiler_compileSourcesWithBackend(om->compileBackend, 1, &source,
+				       &level);
+  CharBuffer_free(buffer);
+
+  if ( om->compiledEnsembleCode == NULL )
+    return 0;
 
-  ODESense_generateCVODESensitivityFunction(os, buffer);
-  ODESense_generateCVODEAdjointQuadFunction(os, buffer);
+  om->compiledEnsembleRhsFunction =
+    CompiledCode_getFunction(om->compiledEnsembleCode,
+			     COMPILED_ENSEMBLE_RHS_FUNCTION_NAME);
+  om->compiledEnsembleAssignmentFunction =
+    CompiledCode_getFunction(om->compiledEnsembleCode,
+			     COMPILED_ENSEMBLE_ASSIGNMENT_FUNCTION_NAME);
+
+  return 1;
+}
+
+
+/** dynamically generates and compiles the functions of the
+    stochastic solver, which evaluate the propensities of the
+    reactions of the SBML input model and the assignment rules;
+    these are compiled separately from the model functions, with
+    the optimization level of the ODEs.
+    Returns 1 if successful, 0 otherwise, also for models without
+    an SBML reaction network
+*/
+SBML_ODESOLVER_API int ODEModel_compileStochasticFunctions(odeModel_t *om)
+{
+  charBuffer_t *buffer;
+  const char *source;
+
+  if ( om->compiledStochasticCode != NULL )
+    return 1;
+  if ( om->m == NULL )
+    return 0;
+
+  buffer = CharBuffer_create();
+  ODEModel_generateHeader(buffer);
+  ODEModel_generateStochasticFunctions(om, buffer);
 
 #ifdef _DEBUG /* write out source file for debugging*/
   {
     FILE *src;
-    char *srcname =  "sensfunctions.c";
+    char *srcname =  "stochasticfunctions.c";
     src = fopen(srcname, "w");
     fprintf(src, "%s", CharBuffer_getBuffer(buffer));
     fclose(src);
   }
 #endif
 
-  /* now all required sourcecode is in `buffer' and can be sent
-     to the compiler */
-  os->compiledCVODESensitivityCode =
-    Compiler_compile(CharBuffer_getBuffer(buffer));
+  source = CharBuffer_getBuffer(buffer);
+  om->compiledStochasticCode =
+    Compiler_compileSourcesWithBackend(om->compileBackend, 1, &source,
+				       &om->compileOptimization[COMPILE_RHS]);
+  CharBuffer_free(buffer);
 
-  if ( os->compiledCVODESensitivityCode == NULL )
+  if ( om->compiledStochasticCode == NULL )
+    return 0;
+
+  om->compiledStochasticPropensityFunction =
+    CompiledCode_getFunction(om->compiledStochasticCode,
+			     COMPILED_STOCHASTIC_PROPENSITY_FUNCTION_NAME);
+  om->compiledStochasticAssignmentFunction =
+    CompiledCode_getFunction(om->compiledStochasticCode,
+			     COMPILED_STOCHASTIC_ASSIGNMENT_FUNCTION_NAME);
+
+  return 1;
+}
+
+
+/** dynamically generates and compiles the chunks of a partition of
+    the model, see odePartition.h, which are then used instead of
+    evaluateAST; each chunk is compiled from its own source, the
+    rules and ODEs with the optimization level of the ODEs and the
+    Jacobian entries with that of the Jacobian, and the sources are
+    compiled in parallel.
+    Returns 1 if successful, 0 otherwise
+*/
+SBML_ODESOLVER_API int ODEModel_compilePartitionFunctions(odeModel_t *om, odePartition_t *partition)
+{
+  int c, l, n, nsources;
+  int *levels;
+  char name[64];
+  charBuffer_t **buffer;
+  const char **sources;
+
+  if ( partition->compiledCode != NULL )
+    return 1;
+
+  n = partition->nchunks;
+  nsources = partition->jacobian ? 2*n : n;
+  ASSIGN_NEW_MEMORY_BLOCK(buffer, nsources, charBuffer_t *, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(sources, nsources, const char *, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(levels, nsources, int, 0);
+
+  for ( c=0; c<nsources; c++ )
+  {
+    buffer[c] = CharBuffer_create();
+    ODEModel_generateHeader(buffer[c]);
+    levels[c] = om->compileOptimization[c < n ? COMPILE_RHS : COMPILE_JACOBIAN];
+  }
+  for ( c=0; c<n; c++ )
+    ODEModel_generatePartitionFunctions(partition, c, buffer[c],
+					partition->jacobian ? buffer[n+c] : NULL);
+
+#ifdef _DEBUG /* write out source files for debugging*/
+  for ( c=0; c<nsources; c++ )
   {
-    CharBuffer_free(buffer);
+    FILE *src;
+    sprintf(name, "partitionfunctions%d.c", c);
+    src = fopen(name, "w");
+    fprintf(src, "%s", CharBuffer_getBuffer(buffer[c]));
+    fclose(src);
+  }
+#endif
+
+  for ( c=0; c<nsources; c++ )
+    sources[c] = CharBuffer_getBuffer(buffer[c]);
+  partition->compiledCode =
+    Compiler_compileSourcesWithBackend(om->compileBackend, nsources,
+				       sources, levels);
+  for ( c=0; c<nsources; c++ )
+    CharBuffer_free(buffer[c]);
+  free(buffer);
+  free(sources);
+  free(levels);
+
+  if ( partition->compiledCode == NULL )
     return 0;
+
+  ASSIGN_NEW_MEMORY_BLOCK(partition->compiledRule,
+			  partition->nlevels*n+1, PartitionRuleFn, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(partition->compiledOde, n, PartitionOdeFn, 0);
+  if ( partition->jacobian )
+    ASSIGN_NEW_MEMORY_BLOCK(partition->compiledJacobian, n,
+			    PartitionJacobianFn, 0);
+  for ( c=0; c<n; c++ )
+  {
+    for ( l=0; l<partition->nlevels; l++ )
+    {
+      sprintf(name, "%s_%d_%d", COMPILED_PARTITION_RULE_FUNCTION_NAME, l, c);
+      partition->compiledRule[l*n+c] =
+	CompiledCode_getFunction(partition->compiledCode, name);
+    }
+    sprintf(name, "%s_%d", COMPILED_PARTITION_ODE_FUNCTION_NAME, c);
+    partition->compiledOde[c] =
+      CompiledCode_getFunction(partition->compiledCode, name);
+    if ( partition->jacobian )
+    {
+      sprintf(name, "%s_%d", COMPILED_PARTITION_JACOBIAN_FUNCTION_NAME, c);
+      partition->compiledJacobian[c] =
+	CompiledCode_getFunction(partition->compiledCode, name);
+    }
   }
 
-  CharBuffer_free(buffer);
+  return 1;
+}
+
+
+/* dynamically generates and compiles the ODE Sensitivity RHS
+   for the given model */
+int ODESense_compileCVODESenseFunctions(odeSense_t *os)
+{
+  codeGenerator_t *gen = CodeGenerator_create(os->om);
+
+  if ( gen == NULL )
+    return 0;
+
+  ODESense_generateCVODESensitivityFunction(os, gen);
+  ODESense_generateCVODEAdjointQuadFunction(os, gen);
+
+  /* now all required sourcecode is generated and can be sent
+     to the compiler */
+  os->compiledCVODESensitivityCode =
+    CodeGenerator_compile(gen, "sensfunctions");
+  CodeGenerator_free(gen);
+
+  if ( os->compiledCVODESensitivityCode == NULL )
+    return 0;
 
   os->compiledCVODESenseFunction =
     CompiledCode_getFunction(os->compiledCVODESensitivityCode,
@@ -3487,6 +4837,28 @@ SBML_ODESOLVER_API CVDlsDenseJacFnB ODEModel_getCompiledCVODEAdjointJacobianFunc
   return om->compiledCVODEAdjointJacobianFunction;
 }
 
+/** returns the compiled adjoint jacobian times vector function for
+    the given model, used by the Krylov solver of the backward phase */
+SBML_ODESOLVER_API CVSpilsJacTimesVecFnB ODEModel_getCompiledCVODEAdjointJacobianTimesVectorFunction(odeModel_t *om)
+{
+  if ( !om->jacobian )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_CANNOT_COMPILE_JACOBIAN_NOT_COMPUTED,
+		      "Attempting to compile adjoint jacobian before "\
+		      "the jacobian is computed\n"\
+		      "Call ODEModel_constructJacobian before calling\n"\
+		      "ODEModel_getCompiledCVODEAdjointJacobianTimesVectorFunction\n");
+    return NULL;
+  }
+
+  if ( !om->compiledCVODEAdjointJacobianTimesVectorFunction )
+    if ( !ODEModel_compileCVODEFunctions(om) )
+      return NULL;
+
+  return om->compiledCVODEAdjointJacobianTimesVectorFunction;
+}
+
 /** returns the compiled adjoint quadrature function for the given model */
 SBML_ODESOLVER_API CVQuadRhsFnB ODESense_getCompiledCVODEAdjointQuadFunction(odeSense_t *os)
 {
@@ -3515,6 +4887,27 @@ SBML_ODESOLVER_API CVQuadRhsFnB ODESense_getCompiledCVODEAdjointQuadFunction(ode
   return os->compiledCVODEAdjointQuadFunction;
 }
 
+/** returns the compiled general objective function for the given
+    model, or NULL if no objective function is set or compilation
+    failed */
+SBML_ODESOLVER_API ObjectiveFn ODEModel_getCompiledObjectiveFunction(odeModel_t *om)
+{
+  if ( om->recompileObjective )
+    ODEModel_compileObjectiveFunctions(om);
+
+  return om->compiledObjectiveFunction;
+}
+
+/** returns the compiled vector v of the linear objective for the
+    given model, or NULL if no vector v is set or compilation failed */
+SBML_ODESOLVER_API VectorVFn ODEModel_getCompiledVectorVFunction(odeModel_t *om)
+{
+  if ( om->recompileObjective )
+    ODEModel_compileObjectiveFunctions(om);
+
+  return om->compiledVectorVFunction;
+}
+
 /** @} */
 
 
@@ -0,0 +1,397 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup odePartition Partitioned Model Evaluation
+  \ingroup integrator
+  \brief This module contains functions to evaluate the assignment
+  rules, ODEs and Jacobian of very large models with the threads of
+  a threadPool.
+
+  Each phase of an evaluation, the assignment rules of one level, the
+  ODEs and the nonzero entries of the Jacobian, is divided into one
+  contiguous chunk of equations per thread. The chunks are balanced
+  by the cost of the equations, counted in AST nodes with function
+  calls and powers weighted more, and are computed once for the
+  model. The chunks write into distinct values, ODE and Jacobian
+  entries and read only values of lower levels, such that no
+  locking is required. Phases of little cost are evaluated by the
+  calling thread alone.
+*/
+/*@{*/
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "sbmlsolver/odePartition.h"
+#include "sbmlsolver/processAST.h"
+#include "sbmlsolver/solverError.h"
+
+/* cost of a function call or power relative to other AST nodes */
+#define FUNCTION_COST 10
+
+static double ODEPartition_cost(const ASTNode_t *);
+static int ODEPartition_readsData(const ASTNode_t *);
+static int ODEPartition_level(const ASTNode_t *, const int *);
+static void ODEPartition_balance(const double *, int, int, double, int, int *);
+static void ODEPartition_run(odePartition_t *, const int *, threadTask_t);
+static void ODEPartition_ruleTask(void *, int);
+static void ODEPartition_odeTask(void *, int);
+static void ODEPartition_jacobianTask(void *, int);
+
+
+/** Divides the model into one chunk per thread of pool for the
+    assignment rules before the ODEs, the ODEs and the Jacobian, if
+    it is available; phases of less cost than mincost are evaluated
+    by the calling thread alone. Models reading observation data are
+    evaluated by the calling thread alone, as the data are
+    interpolated with the single cursor of their cvodeData.
+
+    The partition evaluates with evaluateAST until compiled chunks
+    are generated with ODEModel_compilePartitionFunctions. Returns
+    NULL on failures.
+*/
+
+SBML_ODESOLVER_API odePartition_t *ODEPartition_create(odeModel_t *om, threadPool_t *pool, double mincost)
+{
+  int i, k, l, n;
+  int *level, *start;
+  double *cost;
+  odePartition_t *partition;
+
+  ASSIGN_NEW_MEMORY(partition, struct odePartition, NULL);
+  partition->om = om;
+  partition->pool = pool;
+  partition->nchunks = n = ThreadPool_getNumThreads(pool);
+
+  /* observation data nodes move the interpolation cursor */
+  for ( i=0; i<om->nassbeforeodes; i++ )
+    if ( ODEPartition_readsData(om->assignmentsBeforeODEs[i]->ij) )
+      mincost = HUGE_VAL;
+  for ( i=0; i<om->neq; i++ )
+    if ( ODEPartition_readsData(om->ode[i]) )
+      mincost = HUGE_VAL;
+  if ( om->jacobian )
+    for ( i=0; i<om->sparsesize; i++ )
+      if ( ODEPartition_readsData(om->jacobSparse[i]->ij) )
+	mincost = HUGE_VAL;
+
+  /* levels of the rules: 1 + the highest level of the rules they
+     depend on, 0 for all other values */
+  ASSIGN_NEW_MEMORY_BLOCK(level, om->neq+om->nass+om->nconst, int, NULL);
+  for ( i=0; i<om->nassbeforeodes; i++ )
+  {
+    nonzeroElem_t *ordered = om->assignmentsBeforeODEs[i];
+    level[ordered->i] = ODEPartition_level(ordered->ij, level) + 1;
+    if ( level[ordered->i] > partition->nlevels )
+      partition->nlevels = level[ordered->i];
+  }
+
+  /* sort the rules by level, keeping their order within levels */
+  ASSIGN_NEW_MEMORY_BLOCK(start, partition->nlevels+1, int, NULL);
+  for ( i=0; i<om->nassbeforeodes; i++ )
+    start[level[om->assignmentsBeforeODEs[i]->i]]++;
+  for ( l=1, k=0; l<=partition->nlevels; l++ )
+  {
+    int m = start[l];
+    start[l-1] = k;
+    k += m;
+  }
+  ASSIGN_NEW_MEMORY_BLOCK(partition->rule, om->nassbeforeodes+1,
+			  nonzeroElem_t *, NULL);
+  for ( i=0; i<om->nassbeforeodes; i++ )
+  {
+    nonzeroElem_t *ordered = om->assignmentsBeforeODEs[i];
+    partition->rule[start[level[ordered->i]-1]++] = ordered;
+  }
+  free(start);
+
+  /* balance each phase by cost */
+  k = om->nassbeforeodes;
+  if ( om->neq > k )
+    k = om->neq;
+  if ( om->jacobian && om->sparsesize > k )
+    k = om->sparsesize;
+  ASSIGN_NEW_MEMORY_BLOCK(cost, k+1, double, NULL);
+
+  ASSIGN_NEW_MEMORY_BLOCK(partition->ruleBound,
+			  partition->nlevels*n+1, int, NULL);
+  for ( l=0, k=0; l<partition->nlevels; l++ )
+  {
+    for ( i=k; i<om->nassbeforeodes &&
+	    level[partition->rule[i]->i] == l+1; i++ )
+      cost[i-k] = ODEPartition_cost(partition->rule[i]->ij);
+    ODEPartition_balance(cost, i-k, n, mincost, k,
+			 partition->ruleBound + l*n);
+    k = i;
+  }
+  free(level);
+
+  ASSIGN_NEW_MEMORY_BLOCK(partition->odeBound, n+1, int, NULL);
+  for ( i=0; i<om->neq; i++ )
+    cost[i] = ODEPartition_cost(om->ode[i]);
+  ODEPartition_balance(cost, om->neq, n, mincost, 0, partition->odeBound);
+
+  ASSIGN_NEW_MEMORY_BLOCK(partition->jacobianBound, n+1, int, NULL);
+  partition->jacobian = om->jacobian;
+  if ( partition->jacobian )
+  {
+    for ( i=0; i<om->sparsesize; i++ )
+      cost[i] = ODEPartition_cost(om->jacobSparse[i]->ij);
+    ODEPartition_balance(cost, om->sparsesize, n, mincost, 0,
+			 partition->jacobianBound);
+  }
+  free(cost);
+
+  return partition;
+}
+
+
+/** Evaluates the assignment rules before the ODEs with the current
+    time and values of data, level by level
+*/
+
+SBML_ODESOLVER_API void ODEPartition_evaluateRules(odePartition_t *partition, cvodeData_t *data)
+{
+  int l;
+
+  partition->data = data;
+  for ( l=0; l<partition->nlevels; l++ )
+  {
+    partition->level = l;
+    ODEPartition_run(partition, partition->ruleBound + l*partition->nchunks,
+		     ODEPartition_ruleTask);
+  }
+}
+
+
+/** Evaluates the ODEs with the current time and values of data
+    into dydata; the assignment rules must have been evaluated
+*/
+
+SBML_ODESOLVER_API void ODEPartition_evaluateODEs(odePartition_t *partition, cvodeData_t *data, realtype *dydata)
+{
+  partition->data = data;
+  partition->dydata = dydata;
+  ODEPartition_run(partition, partition->odeBound, ODEPartition_odeTask);
+}
+
+
+/** Evaluates the nonzero entries of the Jacobian with the current
+    time and values of data into the columns of a dense matrix; the
+    Jacobian must be partitioned
+*/
+
+SBML_ODESOLVER_API void ODEPartition_evaluateJacobian(odePartition_t *partition, cvodeData_t *data, realtype **jacobian)
+{
+  partition->data = data;
+  partition->jac = jacobian;
+  ODEPartition_run(partition, partition->jacobianBound,
+		   ODEPartition_jacobianTask);
+}
+
+
+/** Frees a partition and its compiled code, but not its thread pool
+*/
+
+SBML_ODESOLVER_API void ODEPartition_free(odePartition_t *partition)
+{
+  if ( partition == NULL )
+    return;
+
+  if ( partition->compiledCode != NULL )
+    CompiledCode_free(partition->compiledCode);
+  free(partition->compiledRule);
+  free(partition->compiledOde);
+  free(partition->compiledJacobian);
+  free(partition->rule);
+  free(partition->ruleBound);
+  free(partition->odeBound);
+  free(partition->jacobianBound);
+  free(partition);
+}
+
+
+/************* internal functions ************/
+
+/* estimates the evaluation cost of an AST */
+static double ODEPartition_cost(const ASTNode_t *node)
+{
+  unsigned int i;
+  double cost;
+
+  if ( node == NULL )
+    return 0.;
+
+  if ( ASTNode_isFunction(node) || ASTNode_getType(node) == AST_POWER )
+    cost = FUNCTION_COST;
+  else
+    cost = 1.;
+
+  for ( i=0; i<ASTNode_getNumChildren(node); i++ )
+    cost += ODEPartition_cost(ASTNode_getChild(node, i));
+
+  return cost;
+}
+
+
+/* returns 1 if an AST reads observation data, 0 otherwise */
+static int ODEPartition_readsData(const ASTNode_t *node)
+{
+  unsigned int i;
+
+  if ( ASTNode_isSetIndex(node) && ASTNode_isSetData(node) )
+    return 1;
+
+  for ( i=0; i<ASTNode_getNumChildren(node); i++ )
+    if ( ODEPartition_readsData(ASTNode_getChild(node, i)) )
+      return 1;
+
+  return 0;
+}
+
+
+/* returns the highest level of the values in an indexed AST */
+static int ODEPartition_level(const ASTNode_t *node, const int *level)
+{
+  unsigned int i;
+  int l, max = 0;
+
+  if ( ASTNode_isSetIndex(node) )
+    max = level[ASTNode_getIndex(node)];
+
+  for ( i=0; i<ASTNode_getNumChildren(node); i++ )
+  {
+    l = ODEPartition_level(ASTNode_getChild(node, i), level);
+    if ( l > max )
+      max = l;
+  }
+
+  return max;
+}
+
+
+/* divides the n equations offset..offset+n-1 of the given costs into
+   nchunks contiguous chunks of similar cost, chunk c being
+   bound[c]..bound[c+1]-1; all equations go into the first chunk if
+   their total cost is less than mincost */
+static void ODEPartition_balance(const double *cost, int n, int nchunks,
+				 double mincost, int offset, int *bound)
+{
+  int c, k;
+  double total, sum;
+
+  total = 0.;
+  for ( k=0; k<n; k++ )
+    total += cost[k];
+
+  bound[0] = offset;
+  k = 0;
+  sum = 0.;
+  for ( c=1; c<nchunks; c++ )
+  {
+    if ( total < mincost )
+      k = n;
+    else
+      while ( k < n && sum + cost[k]/2 < total*c/nchunks )
+	sum += cost[k++];
+    bound[c] = offset + k;
+  }
+  bound[nchunks] = offset + n;
+}
+
+
+/* runs the chunks of a phase, in the calling thread if only the
+   first chunk has equations */
+static void ODEPartition_run(odePartition_t *partition, const int *bound,
+			     threadTask_t task)
+{
+  int n = partition->nchunks;
+
+  if ( bound[1] == bound[n] )
+    task(partition, 0);
+  else
+    ThreadPool_run(partition->pool, n, task, partition);
+}
+
+
+/* evaluates chunk c of the rules of the current level */
+static void ODEPartition_ruleTask(void *arg, int c)
+{
+  int k;
+  odePartition_t *partition = arg;
+  cvodeData_t *data = partition->data;
+  const int *bound = partition->ruleBound + partition->level*partition->nchunks;
+
+  if ( partition->compiledRule != NULL )
+    partition->compiledRule[partition->level*partition->nchunks + c]
+      (data, data->value);
+  else
+    for ( k=bound[c]; k<bound[c+1]; k++ )
+      data->value[partition->rule[k]->i] =
+	evaluateAST(partition->rule[k]->ij, data);
+}
+
+
+/* evaluates chunk c of the ODEs */
+static void ODEPartition_odeTask(void *arg, int c)
+{
+  int k;
+  odePartition_t *partition = arg;
+  cvodeData_t *data = partition->data;
+
+  if ( partition->compiledOde != NULL )
+    partition->compiledOde[c](data, data->value, partition->dydata);
+  else
+    for ( k=partition->odeBound[c]; k<partition->odeBound[c+1]; k++ )
+      partition->dydata[k] = evaluateAST(partition->om->ode[k], data);
+}
+
+
+/* evaluates chunk c of the nonzero Jacobian entries */
+static void ODEPartition_jacobianTask(void *arg, int c)
+{
+  int k;
+  nonzeroElem_t *nonzero;
+  odePartition_t *partition = arg;
+  cvodeData_t *data = partition->data;
+
+  if ( partition->compiledJacobian != NULL )
+    partition->compiledJacobian[c](data, data->value, partition->jac);
+  else
+    for ( k=partition->jacobianBound[c];
+	  k<partition->jacobianBound[c+1]; k++ )
+    {
+      nonzero = partition->om->jacobSparse[k];
+      partition->jac[nonzero->j][nonzero->i] =
+	evaluateAST(nonzero->ij, data);
+    }
+}
+
+/*! @} */
+/* End of file */
@@ -61,8 +61,12 @@
 
 #include <sbml/SBMLTypes.h>
 
+#include "sbmlsolver/batchProcesses.h"
+#include "sbmlsolver/batchStream.h"
 #include "sbmlsolver/cvodeData.h"
 #include "sbmlsolver/drawGraph.h"
+#include "sbmlsolver/ensembleSolver.h"
+#include "sbmlsolver/globalSensitivity.h"
 #include "sbmlsolver/modelSimplify.h"
 #include "sbmlsolver/odeModel.h"
 #include "sbmlsolver/odeSolver.h"
@@ -73,7 +77,11 @@
 
 static int globalizeParameter(Model_t *, const char *id, const char *rid);
 static int localizeParameter(Model_t *, const char *id, const char *rid);
+static variableIndex_t **getVaryIndices(odeModel_t *, varySettings_t *);
 static int SBMLResults_createSens(SBMLResults_t *, cvodeData_t *);
+static SBMLResults_t *SBMLResults_fromResults(Model_t *, odeModel_t *,
+					      cvodeData_t *,
+					      const cvodeResults_t *);
 
 /** Solves the timeCourses for a SBML model, passed via a libSBML
     SBMLDocument structure and according to passed integration
@@ -240,8 +248,6 @@ SBML_ODESOLVER_API SBMLResultsArray_t *Model_odeSolverBatch(Model_t *m, cvodeSet
   variableIndex_t **vi = NULL;
   SBMLResultsArray_t *resA;
 
-  char *local_param;
-
 
   resA = SBMLResultsArray_allocate(vs->nrdesignpoints);
   if ( resA == NULL ) return NULL;
@@ -287,27 +293,8 @@ SBML_ODESOLVER_API SBMLResultsArray_t *Model_odeSolverBatch(Model_t *m, cvodeSet
     return NULL;
   }
 
-  ASSIGN_NEW_MEMORY_BLOCK(vi, vs->nrparams, struct variableIndex *, NULL);
-			  
-  for ( j=0; j<vs->nrparams; j++ )
-  {
-    /* get the index for parameter i
-    ** modified after suggestion by Norihiro Kikuchi ** */ 
-    if ( vs->rid[j] != NULL  && strlen(vs->rid[j]) > 0 )
-    {
-      ASSIGN_NEW_MEMORY_BLOCK(local_param,
-			      strlen(vs->id[j]) + strlen(vs->rid[j]) + 4,
-			      char , 0);
-      sprintf(local_param, "r_%s_%s", vs->rid[j], vs->id[j]);
-      
-      vi[j] = ODEModel_getVariableIndex(om, local_param);
-      free(local_param);
-    }
-    else
-      vi[j] = ODEModel_getVariableIndex(om, vs->id[j]);
-
-    if ( vi[j] == NULL ) return NULL; /*!!! TODO : handle NULL */
-  }
+  vi = getVaryIndices(om, vs);
+  if ( vi == NULL ) return NULL; /*!!! TODO : handle NULL */
       
   /** now, work through the passed designpoints in varySettings */
   for ( i=0; i<vs->nrdesignpoints; i++ )
@@ -351,6 +338,344 @@ SBML_ODESOLVER_API SBMLResultsArray_t *Model_odeSolverBatch(Model_t *m, cvodeSet
 
 }
 
+
+/** Solves the timeCourses for a SBML model like Model_odeSolverBatch,
+    but integrates ENSEMBLE_LANES design points at once with the
+    ensemble solver; not available for models with events.
+
+    The results are equal to Model_odeSolverBatch with the built-in
+    RK45 solver (CvodeSettings_setMethod(set, 3, 5)) up to the
+    requested tolerances, but the design points of one group share
+    the step size of the fastest one.
+*/
+
+SBML_ODESOLVER_API SBMLResultsArray_t *Model_odeSolverEnsemble(Model_t *m, cvodeSettings_t *set, varySettings_t *vs)
+{
+  int i, j, l, p;
+  odeModel_t *om;
+  ensembleSolver_t *ens;
+  variableIndex_t **vi = NULL;
+  SBMLResultsArray_t *resA;
+
+  resA = SBMLResultsArray_allocate(vs->nrdesignpoints);
+  if ( resA == NULL ) return NULL;
+
+  for ( i=0; i<vs->nrparams; i++ )
+    if ( vs->rid[i] != NULL && strlen(vs->rid[i]) > 0 )
+      globalizeParameter(m, vs->id[i], vs->rid[i]);
+
+  om = ODEModel_create(m);
+  ens = om == NULL ? NULL : EnsembleSolver_create(om, set, ENSEMBLE_LANES);
+  if ( ens != NULL )
+    vi = getVaryIndices(om, vs);
+
+  if ( vi != NULL )
+  {
+    /** work through the design points in groups of ENSEMBLE_LANES,
+	the last group is filled up with its last design point */
+    for ( i=0; i<vs->nrdesignpoints; i+=ENSEMBLE_LANES )
+    {
+      for ( l=0; l<ENSEMBLE_LANES; l++ )
+      {
+	p = i+l < vs->nrdesignpoints ? i+l : vs->nrdesignpoints-1;
+	for ( j=0; j<vs->nrparams; j++ )
+	  EnsembleSolver_setValue(ens, vi[j], l, vs->params[p][j]);
+      }
+
+      EnsembleSolver_integrate(ens);
+
+      for ( l=0; l<ENSEMBLE_LANES && i+l<vs->nrdesignpoints; l++ )
+	resA->results[i+l] =
+	  SBMLResults_fromResults(m, om, ens->data,
+				  EnsembleSolver_getResults(ens, l));
+      EnsembleSolver_reset(ens);
+    }
+
+    for ( j=0; j<vs->nrparams; j++ )
+      VariableIndex_free(vi[j]);
+    free(vi);
+  }
+  else
+  {
+    SBMLResultsArray_free(resA);
+    resA = NULL;
+  }
+
+  /** localize parameters again, unfortunately the new globalized
+     parameter cannot be freed currently  */
+  for ( i=0; i<vs->nrparams; i++ )
+    if ( vs->rid[i] != NULL && strlen(vs->rid[i]) > 0 )
+      localizeParameter(m, vs->id[i], vs->rid[i]);
+
+  EnsembleSolver_free(ens);
+  if ( om != NULL )
+    ODEModel_free(om);
+
+  return resA;
+}
+
+
+/** Solves the timeCourses for a SBML model like Model_odeSolverBatch,
+    but in a pool of nworkers worker processes, see
+    IntegratorInstance_batchProcesses.
+
+    A crash or a call of exit while integrating one design point
+    doesn't end the batch run, and design points taking longer than
+    timeout seconds are stopped (no limit if timeout <= 0). The
+    results of such design points are NULL. If status is not NULL,
+    status[i] is set to the batchStatus of design point i.
+*/
+
+SBML_ODESOLVER_API SBMLResultsArray_t *Model_odeSolverBatchProcesses(Model_t *m, cvodeSettings_t *set, varySettings_t *vs, int nworkers, double timeout, int *status)
+{
+  int i, j;
+  odeModel_t *om;
+  integratorInstance_t *ii = NULL;
+  variableIndex_t **vi = NULL;
+  cvodeResults_t **results = NULL;
+  SBMLResultsArray_t *resA;
+
+  resA = SBMLResultsArray_allocate(vs->nrdesignpoints);
+  if ( resA == NULL ) return NULL;
+
+  for ( i=0; i<vs->nrparams; i++ )
+    if ( vs->rid[i] != NULL && strlen(vs->rid[i]) > 0 )
+      globalizeParameter(m, vs->id[i], vs->rid[i]);
+
+  om = ODEModel_create(m);
+  if ( om != NULL )
+    ii = IntegratorInstance_create(om, set);
+  if ( ii != NULL )
+    vi = getVaryIndices(om, vs);
+
+  if ( vi != NULL )
+  {
+    /* at least one element, also without design points */
+    ASSIGN_NEW_MEMORY_BLOCK(results, vs->nrdesignpoints+1, cvodeResults_t *,
+			    NULL);
+    IntegratorInstance_batchProcesses(ii, vs->nrparams, vi,
+				      vs->nrdesignpoints, vs->params,
+				      nworkers, timeout, results, status);
+
+    /** map cvode results back to SBML compartments, species and
+	parameters  */
+    for ( i=0; i<vs->nrdesignpoints; i++ )
+    {
+      if ( results[i] == NULL )
+	continue;
+      resA->results[i] = SBMLResults_fromResults(m, om, ii->data, results[i]);
+      CvodeResults_free(results[i]);
+    }
+    free(results);
+
+    for ( j=0; j<vs->nrparams; j++ )
+      VariableIndex_free(vi[j]);
+    free(vi);
+  }
+  else
+  {
+    SBMLResultsArray_free(resA);
+    resA = NULL;
+  }
+
+  /** localize parameters again, unfortunately the new globalized
+     parameter cannot be freed currently  */
+  for ( i=0; i<vs->nrparams; i++ )
+    if ( vs->rid[i] != NULL && strlen(vs->rid[i]) > 0 )
+      localizeParameter(m, vs->id[i], vs->rid[i]);
+
+  if ( ii != NULL )
+    IntegratorInstance_free(ii);
+  if ( om != NULL )
+    ODEModel_free(om);
+
+  return resA;
+}
+
+
+/** Solves the timeCourses for a SBML model like Model_odeSolverBatch,
+    but instead of returning the results of all design points, the
+    callback is called with the results of the nobs observables
+    (SBML IDs of compartments, species or parameters) of each design
+    point as soon as it is finished, see
+    IntegratorInstance_batchStream.
+
+    Returns the number of design points passed to the callback, or -1
+    on failure.
+*/
+
+SBML_ODESOLVER_API int Model_odeSolverBatchStream(Model_t *m, cvodeSettings_t *set, varySettings_t *vs, int nobs, char **observables, batchCallback_t callback, void *userData)
+{
+  int i, j, n = -1;
+  odeModel_t *om;
+  integratorInstance_t *ii = NULL;
+  variableIndex_t **vi = NULL;
+  variableIndex_t **obs = NULL;
+
+  for ( i=0; i<vs->nrparams; i++ )
+    if ( vs->rid[i] != NULL && strlen(vs->rid[i]) > 0 )
+      globalizeParameter(m, vs->id[i], vs->rid[i]);
+
+  om = ODEModel_create(m);
+  if ( om != NULL )
+    ii = IntegratorInstance_create(om, set);
+  if ( ii != NULL )
+    vi = getVaryIndices(om, vs);
+
+  if ( vi != NULL )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(obs, nobs+1, variableIndex_t *, -1);
+    for ( j=0; j<nobs; j++ )
+    {
+      obs[j] = ODEModel_getVariableIndex(om, observables[j]);
+      if ( obs[j] == NULL )
+	break;
+    }
+
+    if ( j == nobs )
+      n = IntegratorInstance_batchStream(ii, vs->nrparams, vi,
+					 vs->nrdesignpoints, vs->params,
+					 nobs, obs, callback, userData);
+
+    while ( j-- > 0 )
+      VariableIndex_free(obs[j]);
+    free(obs);
+    for ( j=0; j<vs->nrparams; j++ )
+      VariableIndex_free(vi[j]);
+    free(vi);
+  }
+
+  /** localize parameters again, unfortunately the new globalized
+     parameter cannot be freed currently  */
+  for ( i=0; i<vs->nrparams; i++ )
+    if ( vs->rid[i] != NULL && strlen(vs->rid[i]) > 0 )
+      localizeParameter(m, vs->id[i], vs->rid[i]);
+
+  if ( ii != NULL )
+    IntegratorInstance_free(ii);
+  if ( om != NULL )
+    ODEModel_free(om);
+
+  return n;
+}
+
+
+/** Estimates first order and total Sobol indices of the varied
+    parameters for the nobs observables (SBML IDs of compartments,
+    species or parameters) of a SBML model, from the Saltelli design
+    in the varySettings (see VarySettings_setSaltelliDesign) and with
+    the output (sobolOutput) and number of worker processes of
+    IntegratorInstance_sobolIndices.
+
+    Returns the estimators, which the caller has to free with
+    SobolIndices_free, or NULL on failure.
+*/
+
+SBML_ODESOLVER_API sobolIndices_t *Model_sobolIndices(Model_t *m, cvodeSettings_t *set, varySettings_t *vs, int nobs, char **observables, int output, int nworkers)
+{
+  int i, j, n = -1;
+  odeModel_t *om;
+  integratorInstance_t *ii = NULL;
+  variableIndex_t **vi = NULL;
+  variableIndex_t **obs = NULL;
+  sobolIndices_t *si = NULL;
+
+  for ( i=0; i<vs->nrparams; i++ )
+    if ( vs->rid[i] != NULL && strlen(vs->rid[i]) > 0 )
+      globalizeParameter(m, vs->id[i], vs->rid[i]);
+
+  om = ODEModel_create(m);
+  if ( om != NULL )
+    ii = IntegratorInstance_create(om, set);
+  if ( ii != NULL )
+    vi = getVaryIndices(om, vs);
+
+  if ( vi != NULL )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(obs, nobs+1, variableIndex_t *, NULL);
+    for ( j=0; j<nobs; j++ )
+    {
+      obs[j] = ODEModel_getVariableIndex(om, observables[j]);
+      if ( obs[j] == NULL )
+	break;
+    }
+
+    if ( j == nobs )
+    {
+      si = SobolIndices_create(vs->nrparams, nobs);
+      if ( si != NULL )
+	n = IntegratorInstance_sobolIndices(ii, vs->nrparams, vi,
+					    vs->nrdesignpoints, vs->params,
+					    nobs, obs, output, nworkers, si);
+      if ( n < 0 )
+      {
+	SobolIndices_free(si);
+	si = NULL;
+      }
+    }
+
+    while ( j-- > 0 )
+      VariableIndex_free(obs[j]);
+    free(obs);
+    for ( j=0; j<vs->nrparams; j++ )
+      VariableIndex_free(vi[j]);
+    free(vi);
+  }
+
+  /** localize parameters again, unfortunately the new globalized
+     parameter cannot be freed currently  */
+  for ( i=0; i<vs->nrparams; i++ )
+    if ( vs->rid[i] != NULL && strlen(vs->rid[i]) > 0 )
+      localizeParameter(m, vs->id[i], vs->rid[i]);
+
+  if ( ii != NULL )
+    IntegratorInstance_free(ii);
+  if ( om != NULL )
+    ODEModel_free(om);
+
+  return si;
+}
+
+
+/* returns the variableIndex of each parameter to be varied, or NULL
+   if one of them is not found */
+static variableIndex_t **getVaryIndices(odeModel_t *om, varySettings_t *vs)
+{
+  int j;
+  variableIndex_t **vi;
+  char *local_param;
+
+  ASSIGN_NEW_MEMORY_BLOCK(vi, vs->nrparams, struct variableIndex *, NULL);
+
+  for ( j=0; j<vs->nrparams; j++ )
+  {
+    /* get the index for parameter i
+    ** modified after suggestion by Norihiro Kikuchi ** */ 
+    if ( vs->rid[j] != NULL  && strlen(vs->rid[j]) > 0 )
+    {
+      ASSIGN_NEW_MEMORY_BLOCK(local_param,
+			      strlen(vs->id[j]) + strlen(vs->rid[j]) + 4,
+			      char , NULL);
+      sprintf(local_param, "r_%s_%s", vs->rid[j], vs->id[j]);
+      
+      vi[j] = ODEModel_getVariableIndex(om, local_param);
+      free(local_param);
+    }
+    else
+      vi[j] = ODEModel_getVariableIndex(om, vs->id[j]);
+
+    if ( vi[j] == NULL )
+    {
+      while ( j-- > 0 )
+	VariableIndex_free(vi[j]);
+      free(vi);
+      return NULL;
+    }
+  }
+
+  return vi;
+}
+
 static int globalizeParameter(Model_t *m, const char *id, const char *rid)
 {
   unsigned int i;
@@ -440,17 +765,9 @@ static int localizeParameter(Model_t *m, const char *id, const char *rid)
 
 SBML_ODESOLVER_API SBMLResults_t *SBMLResults_fromIntegrator(Model_t *m, integratorInstance_t *ii)
 {
-  unsigned int i;
-  int j, k, n;
   int flag;
-  Reaction_t *r;
-  KineticLaw_t *kl;
-  ASTNode_t **kls;
-  timeCourseArray_t *tcA;
-  timeCourse_t *tc;
   SBMLResults_t *sbml_results;
 
-  odeModel_t *om = ii->om;
   cvodeData_t *data = ii->data;
   cvodeResults_t *cv_results = ii->results;
 
@@ -458,6 +775,34 @@ SBML_ODESOLVER_API SBMLResults_t *SBMLResults_fromIntegrator(Model_t *m, integra
   if ( data == NULL ) return(NULL);
   else if ( cv_results == NULL ) return(NULL);
 
+  sbml_results = SBMLResults_fromResults(m, ii->om, data, cv_results);
+  if ( sbml_results == NULL ) return(NULL);
+
+  /* filling sensitivities */
+  flag = 0;
+  if ( cv_results->nsens > 0 )
+    flag = SBMLResults_createSens(sbml_results, data);
+  if ( flag == 0 )
+    sbml_results->nsens = 0;
+   
+  return(sbml_results);
+}
+
+/* maps time courses of cvodeResults to SBML structures, the values
+   of data are used for the evaluation of reaction fluxes */
+static SBMLResults_t *SBMLResults_fromResults(Model_t *m, odeModel_t *om,
+					      cvodeData_t *data,
+					      const cvodeResults_t *cv_results)
+{
+  unsigned int i;
+  int j, k, n;
+  Reaction_t *r;
+  KineticLaw_t *kl;
+  ASTNode_t **kls;
+  timeCourseArray_t *tcA;
+  timeCourse_t *tc;
+  SBMLResults_t *sbml_results;
+
   sbml_results = SBMLResults_create(m, cv_results->nout+1);
 
   /* Allocating temporary kinetic law ASTs, for evaluation of fluxes */
@@ -532,13 +877,6 @@ SBML_ODESOLVER_API SBMLResults_t *SBMLResults_fromIntegrator(Model_t *m, integra
     ASTNode_free(kls[i]);
   free(kls);
 
-  /* filling sensitivities */
-  flag = 0;
-  if ( cv_results->nsens > 0 )
-    flag = SBMLResults_createSens(sbml_results, data);
-  if ( flag == 0 )
-    sbml_results->nsens = 0;
-   
   return(sbml_results);
 }
 
@@ -0,0 +1,829 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup parameterEstimation Parameter Estimation
+  \ingroup integrator
+  \brief This module contains a least-squares estimation of model
+  parameters from the time series data of an integratorInstance.
+
+  The weighted residuals between the ODE variables and the data
+  read by IntegratorInstance_readTimeSeriesData are minimized by a
+  Levenberg-Marquardt method in the logarithms of the parameters,
+  within bounds. The residual Jacobian comes from the forward
+  sensitivities at the data time points, such that one integration
+  yields the residuals and their derivatives. Several starts, the
+  current parameter values and a Latin hypercube sample of the
+  bounds, run in threads with one integratorInstance each. The fit
+  of the best start comes with the Fisher Information Matrix and
+  confidence intervals of the parameters and with the convergence
+  traces of all starts.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/integratorInstance.h"
+#include "sbmlsolver/compiler.h"
+#include "sbmlsolver/threadPool.h"
+#include "sbmlsolver/interpol.h"
+#include "sbmlsolver/odeSolver.h"
+#include "sbmlsolver/globalSensitivity.h"
+#include "sbmlsolver/parameterEstimation.h"
+
+#define FIT_MAXITER   100    /* trial steps per start */
+#define FIT_FTOL      1e-8   /* relative decrease of the ssr */
+#define FIT_XTOL      1e-6   /* step length in log parameters */
+#define FIT_LAMBDA0   1e-3   /* initial damping */
+#define FIT_LAMBDAMIN 1e-12
+#define FIT_LAMBDAMAX 1e12
+#define FIT_QUANTILE  1.959964 /* 97.5% quantile of the normal
+				  distribution */
+
+/* the data and the start points shared by all threads; each start
+   only writes its own trace */
+typedef struct fitProblem
+{
+  int nrparams;
+  variableIndex_t **vi;
+  double *lower;     /* log bounds */
+  double *upper;
+  time_series_t *ts;
+  int first;         /* first data time after the initial time */
+  int neq;
+  double *weight;    /* square roots of the weights of the ODE
+			variables */
+  int nres;
+  double **start;    /* start points in log parameters */
+  parameterFit_t *fit;
+  threadPool_t *pool;   /* the threads running the starts */
+  integratorInstance_t **engine; /* one integratorInstance per
+				    thread */
+} fitProblem_t;
+
+static parameterFit_t *ParameterFit_create(int nrparams, char **ids, int nstarts);
+static void Fit_task(void *, int);
+static int Fit_levenbergMarquardt(fitProblem_t *, integratorInstance_t *, int);
+static int Fit_evaluate(fitProblem_t *, integratorInstance_t *,
+			const double *theta, double *r, double *J,
+			double *ssr);
+static void Fit_normalEquations(int nres, int n, const double *r,
+				const double *J, double *A, double *g);
+static int Fit_cholesky(int n, const double *A, double *L);
+static void Fit_solve(int n, const double *L, const double *b, double *x);
+static int Fit_confidence(fitProblem_t *, const double *J);
+
+
+/** Estimates the nrparams parameters or initial values with the
+    given ids from the time series data of the integratorInstance,
+    see IntegratorInstance_readTimeSeriesData.
+
+    The weighted sum of squared differences between the ODE variables
+    and the data at the data time points is minimized, with the
+    weights of IntegratorInstance_setFIMweights if they were set.
+    The parameters are bounded by lower and upper, which must be
+    positive. The first of nstarts starts is the current parameter
+    values of the model, clipped to the bounds, the others are a
+    Latin hypercube sample of the bounds in log space, determined by
+    the seed. The starts are run in nthreads threads (the number of
+    processors if nthreads < 1), each with its own integratorInstance
+    of the odeModel and with the integrator settings, where
+    sensitivity analysis for the ids and the data time points are
+    set.
+
+    The confidence intervals are scaled by the residual variance
+    ssr/(nres-nrparams). If there are no more residuals than
+    parameters or the fit is perfect, the residual variance can not
+    be estimated and is 1, i.e. the weights are taken as the inverse
+    variances of the data.
+
+    Returns the fit, which the caller has to free with
+    ParameterFit_free, or NULL if no start was successful.
+*/
+
+SBML_ODESOLVER_API parameterFit_t *IntegratorInstance_fitParameters(integratorInstance_t *engine, int nrparams, char **ids, const double *lower, const double *upper, int nstarts, int nthreads, unsigned long seed)
+{
+  int i, j, k, w, nworkers, failed;
+  odeModel_t *om = engine->om;
+  time_series_t *ts = om->time_series;
+  fitProblem_t fp;
+  cvodeSettings_t *set;
+  varySettings_t *vs;
+  parameterFit_t *fit;
+  int *logscale;
+  double x, *theta, *r, *J, ssr;
+
+  if ( ts == NULL )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_OBJECTIVE_FUNCTION_FAILED,
+		      "Parameter estimation requires time series data, "
+		      "see IntegratorInstance_readTimeSeriesData.");
+    return NULL;
+  }
+  if ( nrparams < 1 || nstarts < 1 )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Parameter estimation requires at least one "
+		      "parameter and one start.");
+    return NULL;
+  }
+  for ( j=0; j<nrparams; j++ )
+    if ( lower[j] <= 0.0 || upper[j] < lower[j] )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_VARY_SETTINGS,
+			"Invalid bounds [%g, %g] for parameter %s, "
+			"bounds must be positive.",
+			lower[j], upper[j], ids[j]);
+      return NULL;
+    }
+
+  /* the residuals: data of ODE variables at the output times */
+  fp.nrparams = nrparams;
+  fp.ts = ts;
+  fp.neq = om->neq;
+  fp.first = 0;
+  while ( fp.first < ts->n_time && ts->time[fp.first] <= 0.0 )
+    fp.first++;
+  fp.nres = 0;
+  for ( k=0; k<ts->n_time; k++ )
+    for ( i=0; i<om->neq; i++ )
+      if ( ts->data[i] != NULL && ts->data[i][k] == ts->data[i][k] )
+	fp.nres++;
+  if ( fp.nres == 0 || fp.first == ts->n_time )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_OBJECTIVE_FUNCTION_FAILED,
+		      "The time series data contain no data of ODE "
+		      "variables after the initial time.");
+    return NULL;
+  }
+
+  ASSIGN_NEW_MEMORY_BLOCK(fp.vi, nrparams, variableIndex_t *, NULL);
+  for ( j=0; j<nrparams; j++ )
+  {
+    fp.vi[j] = ODEModel_getVariableIndex(om, ids[j]);
+    if ( fp.vi[j] != NULL && fp.vi[j]->index >= om->neq &&
+	 fp.vi[j]->index < om->neq + om->nass )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_ATTEMPT_TO_SET_ASSIGNED_VALUE,
+			"%s is an assigned variable and can not be "
+			"estimated.", ids[j]);
+      VariableIndex_free(fp.vi[j]);
+      fp.vi[j] = NULL;
+    }
+    if ( fp.vi[j] == NULL )
+    {
+      while ( j-- > 0 )
+	VariableIndex_free(fp.vi[j]);
+      free(fp.vi);
+      return NULL;
+    }
+  }
+
+  fit = ParameterFit_create(nrparams, ids, nstarts);
+  if ( fit == NULL )
+    return NULL;
+  fit->nres = fp.nres;
+  fp.fit = fit;
+
+  ASSIGN_NEW_MEMORY_BLOCK(fp.weight, om->neq+1, double, NULL);
+  for ( i=0; i<om->neq; i++ )
+    fp.weight[i] = engine->data->weights != NULL ?
+      sqrt(engine->data->weights[i]) : 1.0;
+
+  /* start points: the model values and a Latin hypercube sample */
+  ASSIGN_NEW_MEMORY_BLOCK(fp.lower, nrparams, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(fp.upper, nrparams, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(fp.start, nstarts, double *, NULL);
+  for ( i=0; i<nstarts; i++ )
+    ASSIGN_NEW_MEMORY_BLOCK(fp.start[i], nrparams, double, NULL);
+  for ( j=0; j<nrparams; j++ )
+  {
+    fp.lower[j] = log(lower[j]);
+    fp.upper[j] = log(upper[j]);
+    x = om->values[fp.vi[j]->index];
+    x = x < lower[j] ? lower[j] : x > upper[j] ? upper[j] : x;
+    fp.start[0][j] = log(x);
+  }
+  if ( nstarts > 1 )
+  {
+    vs = VarySettings_allocate(nrparams, nstarts-1);
+    ASSIGN_NEW_MEMORY_BLOCK(logscale, nrparams, int, NULL);
+    for ( j=0; j<nrparams; j++ )
+      logscale[j] = 1;
+    VarySettings_setLatinHypercube(vs, lower, upper, logscale, seed);
+    for ( i=1; i<nstarts; i++ )
+      for ( j=0; j<nrparams; j++ )
+	fp.start[i][j] = log(vs->params[i-1][j]);
+    free(logscale);
+    VarySettings_free(vs);
+  }
+
+  /* forward sensitivities for the ids at the data time points */
+  set = CvodeSettings_clone(engine->opt);
+  CvodeSettings_setTimeSeries(set, ts->time + fp.first,
+			      ts->n_time - fp.first);
+  CvodeSettings_setIndefinitely(set, 0);
+  CvodeSettings_setHaltOnEvent(set, 0);
+  CvodeSettings_setHaltOnSteadyState(set, 0);
+  CvodeSettings_setStoreResults(set, 0);
+  CvodeSettings_unsetDoAdj(set);
+  CvodeSettings_unsetFIM(set);
+  /* the built-in solvers have no sensitivity analysis */
+  if ( set->CvodeMethod > 2 )
+    CvodeSettings_setMethod(set, 0, set->MaxOrder);
+  CvodeSettings_setSensitivity(set, 1);
+  CvodeSettings_setSensParams(set, ids, nrparams);
+
+  /* the integratorInstances are created here, such that the
+     threads only reset and integrate them */
+  nworkers = nthreads < 1 ? Compiler_getNumProcessors() : nthreads;
+  if ( nworkers > nstarts )
+    nworkers = nstarts;
+  if ( nworkers < 1 )
+    nworkers = 1;
+  ASSIGN_NEW_MEMORY_BLOCK(fp.engine, nworkers, integratorInstance_t *, NULL);
+  for ( w=0; w<nworkers; w++ )
+  {
+    fp.engine[w] = IntegratorInstance_create(om, set);
+    if ( fp.engine[w] == NULL )
+      break;
+  }
+  nworkers = w;
+
+  if ( nworkers > 0 )
+  {
+    fp.pool = ThreadPool_create(nworkers);
+    if ( fp.pool != NULL )
+      ThreadPool_run(fp.pool, nstarts, Fit_task, &fp);
+    ThreadPool_free(fp.pool);
+  }
+
+  /* the best start */
+  fit->best = -1;
+  failed = 0;
+  for ( i=0; i<nstarts; i++ )
+  {
+    if ( fit->trace[i].status == FIT_FAILED )
+      failed++;
+    else if ( fit->trace[i].status != FIT_PENDING &&
+	      (fit->best < 0 ||
+	       fit->trace[i].ssr < fit->trace[fit->best].ssr) )
+      fit->best = i;
+    failed += fit->trace[i].nfail;
+  }
+
+  /* integration failures at trial points are part of the search */
+  if ( failed )
+    SolverError_clear();
+
+  if ( fit->best >= 0 )
+  {
+    fit->ssr = fit->trace[fit->best].ssr;
+    for ( j=0; j<nrparams; j++ )
+      fit->p[j] = fit->trace[fit->best].p[j];
+
+    /* residual Jacobian at the fit for the FIM */
+    ASSIGN_NEW_MEMORY_BLOCK(theta, nrparams, double, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(r, fp.nres, double, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(J, fp.nres*nrparams, double, NULL);
+    for ( j=0; j<nrparams; j++ )
+      theta[j] = log(fit->p[j]);
+    if ( Fit_evaluate(&fp, fp.engine[0], theta, r, J, &ssr) )
+      Fit_confidence(&fp, J);
+    free(theta);
+    free(r);
+    free(J);
+  }
+  else
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+		      "Parameter estimation failed, the integration "
+		      "failed for all %d starts.", nstarts);
+    ParameterFit_free(fit);
+    fit = NULL;
+  }
+
+  for ( w=0; w<nworkers; w++ )
+    IntegratorInstance_free(fp.engine[w]);
+  free(fp.engine);
+  CvodeSettings_free(set);
+  for ( i=0; i<nstarts; i++ )
+    free(fp.start[i]);
+  free(fp.start);
+  free(fp.lower);
+  free(fp.upper);
+  free(fp.weight);
+  for ( j=0; j<nrparams; j++ )
+    VariableIndex_free(fp.vi[j]);
+  free(fp.vi);
+
+  return fit;
+}
+
+
+/** Returns the fitted value of the i-th parameter
+*/
+
+SBML_ODESOLVER_API double ParameterFit_getValue(const parameterFit_t *fit, int i)
+{
+  return fit->p[i];
+}
+
+
+/** Returns the lower bound of the 95% confidence interval of the
+    i-th parameter, 0 if the parameters are not identifiable from
+    the data
+*/
+
+SBML_ODESOLVER_API double ParameterFit_getLowerBound(const parameterFit_t *fit, int i)
+{
+  return fit->lower[i];
+}
+
+
+/** Returns the upper bound of the 95% confidence interval of the
+    i-th parameter, HUGE_VAL if the parameters are not identifiable
+    from the data
+*/
+
+SBML_ODESOLVER_API double ParameterFit_getUpperBound(const parameterFit_t *fit, int i)
+{
+  return fit->upper[i];
+}
+
+
+/** Returns the weighted residual sum of squares of the fit
+*/
+
+SBML_ODESOLVER_API double ParameterFit_getSSR(const parameterFit_t *fit)
+{
+  return fit->ssr;
+}
+
+
+/** Returns the entry (i, j) of the Fisher Information Matrix of the
+    log parameters at the fit
+*/
+
+SBML_ODESOLVER_API double ParameterFit_getFIM(const parameterFit_t *fit, int i, int j)
+{
+  return fit->FIM[i][j];
+}
+
+
+/** Prints the fitted parameters with their confidence intervals and
+    the outcome of each start
+*/
+
+SBML_ODESOLVER_API void ParameterFit_print(const parameterFit_t *fit, FILE *f)
+{
+  int i, j;
+  fitTrace_t *trace;
+  static const char *status[] =
+    { "pending", "converged", "max. iterations", "stalled", "failed" };
+
+  fprintf(f, "## Parameter estimation: %d data points, SSR = %g\n",
+	  fit->nres, fit->ssr);
+  for ( j=0; j<fit->nrparams; j++ )
+    fprintf(f, "%s = %g  [%g, %g]\n",
+	    fit->id[j], fit->p[j], fit->lower[j], fit->upper[j]);
+  fprintf(f, "## Starts:\n");
+  for ( i=0; i<fit->nstarts; i++ )
+  {
+    trace = &fit->trace[i];
+    fprintf(f, "#%d%s %s after %d iterations (%d failed), SSR %g -> %g\n",
+	    i, i == fit->best ? "*" : "", status[trace->status],
+	    trace->niter, trace->nfail, trace->ssrTrace[0], trace->ssr);
+  }
+}
+
+
+/** Frees the fit
+*/
+
+SBML_ODESOLVER_API void ParameterFit_free(parameterFit_t *fit)
+{
+  int i;
+
+  if ( fit == NULL )
+    return;
+
+  for ( i=0; i<fit->nrparams; i++ )
+  {
+    free(fit->id[i]);
+    free(fit->FIM[i]);
+    if ( fit->covariance != NULL )
+      free(fit->covariance[i]);
+  }
+  free(fit->id);
+  free(fit->FIM);
+  free(fit->covariance);
+  free(fit->p);
+  free(fit->lower);
+  free(fit->upper);
+  for ( i=0; i<fit->nstarts; i++ )
+  {
+    free(fit->trace[i].start);
+    free(fit->trace[i].p);
+    free(fit->trace[i].ssrTrace);
+    free(fit->trace[i].lambda);
+  }
+  free(fit->trace);
+  free(fit);
+}
+
+
+/************* internal functions ************/
+
+static parameterFit_t *ParameterFit_create(int nrparams, char **ids, int nstarts)
+{
+  int i;
+  parameterFit_t *fit;
+
+  ASSIGN_NEW_MEMORY(fit, parameterFit_t, NULL);
+  fit->nrparams = nrparams;
+  fit->nstarts = nstarts;
+  fit->best = -1;
+  fit->covariance = NULL;
+  ASSIGN_NEW_MEMORY_BLOCK(fit->id, nrparams, char *, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(fit->FIM, nrparams, double *, NULL);
+  for ( i=0; i<nrparams; i++ )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(fit->id[i], strlen(ids[i])+1, char, NULL);
+    strcpy(fit->id[i], ids[i]);
+    ASSIGN_NEW_MEMORY_BLOCK(fit->FIM[i], nrparams, double, NULL);
+  }
+  ASSIGN_NEW_MEMORY_BLOCK(fit->p, nrparams, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(fit->lower, nrparams, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(fit->upper, nrparams, double, NULL);
+
+  ASSIGN_NEW_MEMORY_BLOCK(fit->trace, nstarts, fitTrace_t, NULL);
+  for ( i=0; i<nstarts; i++ )
+  {
+    fit->trace[i].status = FIT_PENDING;
+    ASSIGN_NEW_MEMORY_BLOCK(fit->trace[i].start, nrparams, double, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(fit->trace[i].p, nrparams, double, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(fit->trace[i].ssrTrace, FIT_MAXITER+1,
+			    double, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(fit->trace[i].lambda, FIT_MAXITER, double, NULL);
+  }
+
+  return fit;
+}
+
+
+/* runs start s with the integratorInstance of the calling thread */
+static void Fit_task(void *arg, int s)
+{
+  fitProblem_t *fp = arg;
+
+  Fit_levenbergMarquardt(fp, fp->engine[ThreadPool_getThread(fp->pool)], s);
+}
+
+
+/* Levenberg-Marquardt iteration from start s: the step d solves
+   (J^T J + lambda diag(J^T J)) d = -J^T r and is projected onto the
+   bounds; the damping lambda decreases after a step that reduces the
+   residual sum of squares and increases otherwise */
+static int Fit_levenbergMarquardt(fitProblem_t *fp, integratorInstance_t *engine, int s)
+{
+  int j, iter, ok, n = fp->nrparams, nres = fp->nres;
+  fitTrace_t *trace = &fp->fit->trace[s];
+  double *theta, *trial, *r, *rt, *J, *Jt, *A, *M, *L, *g, *d, *swap;
+  double ssr, ssrt, lambda, step;
+
+  ASSIGN_NEW_MEMORY_BLOCK(theta, n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(trial, n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(r, nres, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(rt, nres, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(J, nres*n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(Jt, nres*n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(A, n*n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(M, n*n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(L, n*n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(g, n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(d, n, double, 0);
+
+  for ( j=0; j<n; j++ )
+  {
+    theta[j] = fp->start[s][j];
+    trace->start[j] = trace->p[j] = exp(theta[j]);
+  }
+
+  trace->status = FIT_FAILED;
+  if ( Fit_evaluate(fp, engine, theta, r, J, &ssr) )
+  {
+    trace->ssrTrace[0] = ssr;
+    trace->status = ssr > 0.0 ? FIT_MAXITER : FIT_CONVERGED;
+    lambda = FIT_LAMBDA0;
+
+    for ( iter=0; iter<FIT_MAXITER && trace->status == FIT_MAXITER; iter++ )
+    {
+      Fit_normalEquations(nres, n, r, J, A, g);
+      for ( j=0; j<n*n; j++ )
+	M[j] = A[j];
+      for ( j=0; j<n; j++ )
+      {
+	M[j*n+j] += lambda * (A[j*n+j] > 0.0 ? A[j*n+j] : 1.0);
+	g[j] = -g[j];
+      }
+
+      step = 0.0;
+      ok = Fit_cholesky(n, M, L);
+      if ( ok )
+      {
+	Fit_solve(n, L, g, d);
+	for ( j=0; j<n; j++ )
+	{
+	  trial[j] = theta[j] + d[j];
+	  if ( trial[j] < fp->lower[j] )
+	    trial[j] = fp->lower[j];
+	  if ( trial[j] > fp->upper[j] )
+	    trial[j] = fp->upper[j];
+	  step += (trial[j] - theta[j]) * (trial[j] - theta[j]);
+	}
+	step = sqrt(step);
+	ok = Fit_evaluate(fp, engine, trial, rt, Jt, &ssrt);
+	if ( !ok )
+	  trace->nfail++;
+      }
+
+      trace->lambda[iter] = lambda;
+      trace->niter = iter + 1;
+
+      if ( ok && ssrt < ssr )
+      {
+	if ( (ssr - ssrt) <= FIT_FTOL * ssr || step <= FIT_XTOL )
+	  trace->status = FIT_CONVERGED;
+	ssr = ssrt;
+	for ( j=0; j<n; j++ )
+	  theta[j] = trial[j];
+	swap = r; r = rt; rt = swap;
+	swap = J; J = Jt; Jt = swap;
+	lambda = lambda / 10 > FIT_LAMBDAMIN ? lambda / 10 : FIT_LAMBDAMIN;
+      }
+      else
+      {
+	/* no decrease, although the step became negligible */
+	if ( ok && step <= FIT_XTOL )
+	  trace->status = FIT_CONVERGED;
+	lambda *= 10;
+	if ( lambda > FIT_LAMBDAMAX && trace->status == FIT_MAXITER )
+	  trace->status = FIT_STALLED;
+      }
+      trace->ssrTrace[iter+1] = ssr;
+    }
+
+    trace->ssr = ssr;
+    for ( j=0; j<n; j++ )
+      trace->p[j] = exp(theta[j]);
+  }
+
+  free(theta);
+  free(trial);
+  free(r);
+  free(rt);
+  free(J);
+  free(Jt);
+  free(A);
+  free(M);
+  free(L);
+  free(g);
+  free(d);
+
+  return 1;
+}
+
+
+/* integrates the time course with the log parameters theta and
+   writes the weighted residuals r, their Jacobian J with respect to
+   theta (nres rows of nrparams values) and the residual sum of
+   squares; returns 0 if the integration failed */
+static int Fit_evaluate(fitProblem_t *fp, integratorInstance_t *engine,
+			const double *theta, double *r, double *J,
+			double *ssr)
+{
+  int i, j, k, n, nrparams = fp->nrparams;
+  time_series_t *ts = fp->ts;
+  cvodeData_t *data = engine->data;
+  double x, w;
+
+  IntegratorInstance_reset(engine);
+  for ( j=0; j<nrparams; j++ )
+    IntegratorInstance_setVariableValue(engine, fp->vi[j], exp(theta[j]));
+  /* the parameters of the sensitivity analysis are taken over when
+     the solver is initialized */
+  engine->isValid = 0;
+
+  n = 0;
+  *ssr = 0.0;
+  for ( k=0; k<ts->n_time; k++ )
+  {
+    /* data up to the initial time refer to the initial values */
+    if ( k >= fp->first && !IntegratorInstance_integrateOneStep(engine) )
+      return 0;
+
+    for ( i=0; i<fp->neq; i++ )
+    {
+      /* missing values are NaN */
+      if ( ts->data[i] == NULL || ts->data[i][k] != ts->data[i][k] )
+	continue;
+      w = fp->weight[i];
+      r[n] = w * (data->value[i] - ts->data[i][k]);
+      *ssr += r[n] * r[n];
+      for ( j=0; j<nrparams; j++ )
+      {
+	/* dx/dlog(p) = p dx/dp */
+	x = data->sensitivity[i][j] * exp(theta[j]);
+	J[n*nrparams+j] = w * x;
+      }
+      n++;
+    }
+  }
+
+  return *ssr == *ssr;
+}
+
+
+/* A = J^T J and g = J^T r */
+static void Fit_normalEquations(int nres, int n, const double *r,
+				const double *J, double *A, double *g)
+{
+  int i, j, k;
+
+  for ( i=0; i<n; i++ )
+  {
+    g[i] = 0.0;
+    for ( j=0; j<n; j++ )
+      A[i*n+j] = 0.0;
+  }
+  for ( k=0; k<nres; k++ )
+    for ( i=0; i<n; i++ )
+    {
+      g[i] += J[k*n+i] * r[k];
+      for ( j=0; j<=i; j++ )
+	A[i*n+j] += J[k*n+i] * J[k*n+j];
+    }
+  for ( i=0; i<n; i++ )
+    for ( j=0; j<i; j++ )
+      A[j*n+i] = A[i*n+j];
+}
+
+
+/* Cholesky factorization A = L L^T of a symmetric matrix, returns
+   0 if A is not positive definite */
+static int Fit_cholesky(int n, const double *A, double *L)
+{
+  int i, j, k;
+  double sum;
+
+  for ( i=0; i<n; i++ )
+    for ( j=0; j<=i; j++ )
+    {
+      sum = A[i*n+j];
+      for ( k=0; k<j; k++ )
+	sum -= L[i*n+k] * L[j*n+k];
+      if ( i == j )
+      {
+	if ( !(sum > 0.0) )
+	  return 0;
+	L[i*n+i] = sqrt(sum);
+      }
+      else
+	L[i*n+j] = sum / L[j*n+j];
+    }
+
+  return 1;
+}
+
+
+/* solves L L^T x = b */
+static void Fit_solve(int n, const double *L, const double *b, double *x)
+{
+  int i, k;
+
+  for ( i=0; i<n; i++ )
+  {
+    x[i] = b[i];
+    for ( k=0; k<i; k++ )
+      x[i] -= L[i*n+k] * x[k];
+    x[i] /= L[i*n+i];
+  }
+  for ( i=n-1; i>=0; i-- )
+  {
+    for ( k=i+1; k<n; k++ )
+      x[i] -= L[k*n+i] * x[k];
+    x[i] /= L[i*n+i];
+  }
+}
+
+
+/* the FIM J^T J / sigma^2 of the log parameters at the fit, its
+   inverse and the confidence intervals of the parameters */
+static int Fit_confidence(fitProblem_t *fp, const double *J)
+{
+  int i, j, k, n = fp->nrparams;
+  parameterFit_t *fit = fp->fit;
+  double *A, *L, *e, *col, half;
+
+  ASSIGN_NEW_MEMORY_BLOCK(A, n*n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(L, n*n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(e, n, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(col, n, double, 0);
+
+  for ( k=0; k<fp->nres; k++ )
+    for ( i=0; i<n; i++ )
+      for ( j=0; j<n; j++ )
+	A[i*n+j] += J[k*n+i] * J[k*n+j];
+
+  /* the residual variance; without degrees of freedom or for a
+     perfect fit it can not be estimated, and the weights are taken
+     as the inverse variances of the data, i.e. unit variance */
+  if ( fp->nres > n && fit->ssr > 0.0 )
+    fit->sigma2 = fit->ssr / (fp->nres - n);
+  else
+    fit->sigma2 = 1.0;
+  for ( i=0; i<n; i++ )
+    for ( j=0; j<n; j++ )
+      fit->FIM[i][j] = A[i*n+j] / fit->sigma2;
+
+  if ( Fit_cholesky(n, A, L) )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(fit->covariance, n, double *, 0);
+    for ( i=0; i<n; i++ )
+      ASSIGN_NEW_MEMORY_BLOCK(fit->covariance[i], n, double, 0);
+    for ( j=0; j<n; j++ )
+    {
+      for ( i=0; i<n; i++ )
+	e[i] = i == j ? 1.0 : 0.0;
+      Fit_solve(n, L, e, col);
+      for ( i=0; i<n; i++ )
+	fit->covariance[i][j] = fit->sigma2 * col[i];
+    }
+    for ( j=0; j<n; j++ )
+    {
+      half = FIT_QUANTILE * sqrt(fit->covariance[j][j]);
+      fit->lower[j] = fit->p[j] * exp(-half);
+      fit->upper[j] = fit->p[j] * exp(half);
+    }
+  }
+  else
+  {
+    SolverError_error(WARNING_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+		      "The Fisher Information Matrix of the fit is "
+		      "singular, the parameters are not identifiable "
+		      "from the data.");
+    for ( j=0; j<n; j++ )
+    {
+      fit->lower[j] = 0.0;
+      fit->upper[j] = HUGE_VAL;
+    }
+  }
+
+  free(A);
+  free(L);
+  free(e);
+  free(col);
+
+  return 1;
+}
+
+/*! @} */
+/* End of file */
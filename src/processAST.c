@@ -1879,12 +1879,16 @@ int ASTNode_containsPiecewise(const ASTNode_t *node)
 
 /* ------------------------------------------------------------------------ */
 
+/* appends the given AST in compilable form to the given buffer, for
+   lane l of the value array if lanes is set, see generateLaneAST */
+static void ASTNode_generate(charBuffer_t *expressionStream,
+			     const ASTNode_t *node, int lanes);
 
 /* appends the given AST in compilable form to the given buffer.
    The form is enclosed in brackets when necessary so that the AST
    can be incorporated as a sub expression of another expression. */
 static void ASTNode_generateNestedExpression(charBuffer_t *expressionStream,
-				      const ASTNode_t *node)
+				      const ASTNode_t *node, int lanes)
 {
   switch ( ASTNode_getType(node) )
   {
@@ -1933,13 +1937,13 @@ static void ASTNode_generateNestedExpression(charBuffer_t *expressionStream,
   case AST_FUNCTION_TANH :
   case AST_LOGICAL_XOR :
   case AST_FUNCTION :
-    generateAST(expressionStream, node);
+    ASTNode_generate(expressionStream, node, lanes);
     break;
 
     /* expressions that do */
   default :
     CharBuffer_append(expressionStream, "(") ;
-    generateAST(expressionStream, node);
+    ASTNode_generate(expressionStream, node, lanes);
     CharBuffer_append(expressionStream, ")");
     break;
   }
@@ -1949,25 +1953,27 @@ static void ASTNode_generateNestedExpression(charBuffer_t *expressionStream,
    the node is a unary operator.
    'op' is the compilable operator string for the node. */
 static void ASTNode_generateUnaryOperator(charBuffer_t *expressionStream,
-				   const ASTNode_t *node, const char *op)
+				   const ASTNode_t *node, const char *op,
+				   int lanes)
 {
   CharBuffer_append(expressionStream,op); ;
   ASTNode_generateNestedExpression(expressionStream,
-				   ASTNode_getChild(node, 0));
+				   ASTNode_getChild(node, 0), lanes);
 }
 
 /* appends the given node to the given buffer in compilable form assuming
    the node is a Nary operator.
    'op' is the compilable operator string for the node. */
 static void ASTNode_generateNaryOperator(charBuffer_t *expressionStream,
-				  const ASTNode_t *node, const char *op)
+				  const ASTNode_t *node, const char *op,
+				  int lanes)
 {
   unsigned int i;
     
   for ( i = 0 ; i != ASTNode_getNumChildren(node); i++ )
   {
     ASTNode_generateNestedExpression(expressionStream,
-				     ASTNode_getChild(node, i));
+				     ASTNode_getChild(node, i), lanes);
     if ( i != ASTNode_getNumChildren(node) - 1 )
     {
       CharBuffer_append(expressionStream, " ");
@@ -1981,7 +1987,8 @@ static void ASTNode_generateNaryOperator(charBuffer_t *expressionStream,
    the node is a function.
    'func' is the compilable function string for the node. */
 static void ASTNode_generateFunctionCall(charBuffer_t *expressionStream,
-				  const ASTNode_t *node, const char *func)
+				  const ASTNode_t *node, const char *func,
+				  int lanes)
 {
   unsigned int i;
 
@@ -1989,7 +1996,7 @@ static void ASTNode_generateFunctionCall(charBuffer_t *expressionStream,
   CharBuffer_append(expressionStream, "(");
   for ( i = 0 ; i != ASTNode_getNumChildren(node); i++ )
   {
-    generateAST(expressionStream, ASTNode_getChild(node, i));
+    ASTNode_generate(expressionStream, ASTNode_getChild(node, i), lanes);
     if ( i != ASTNode_getNumChildren(node) - 1 )
       CharBuffer_append(expressionStream, ", ") ;
   }
@@ -1999,9 +2006,12 @@ static void ASTNode_generateFunctionCall(charBuffer_t *expressionStream,
 /* appends compilable code to represent the given AST_Name node to the
    give buffer.  The code consists of a reference to an item in the
    array 'value' indexed by the the index associated with the node by
-   the function 'indexAST'.  If the ASTNode doesn't have an index
+   the function 'indexAST' (of lane l, see generateLaneAST), or for
+   observation data nodes a call retrieving the data value of that
+   index from the cvodeData_t structure 'data'.  If the ASTNode doesn't have an index
    value then an error is created and '0' is appended to the buffer. */
-static void ASTNode_generateName(charBuffer_t *expressionStream, const ASTNode_t *n)
+static void ASTNode_generateName(charBuffer_t *expressionStream,
+				 const ASTNode_t *n, int lanes)
 {
   int found = 0;
 
@@ -2009,14 +2019,18 @@ static void ASTNode_generateName(charBuffer_t *expressionStream, const ASTNode_t
   {
     if ( ASTNode_isSetData((ASTNode_t *)n) )
     {
-      SolverError_error(FATAL_ERROR_TYPE,
-			SOLVER_ERROR_AST_COMPILATION_FAILED_DATA_AST_NODE_NOT_SUPPORTED_YET,
-			"Compilation process ignoring data state on name ",
-			"node %s - Not supported yet\n",
-			ASTNode_getName(n));
+      CharBuffer_append(expressionStream,
+			"CvodeData_getTimeSeriesValue(data, ");
+      CharBuffer_appendInt(expressionStream, ASTNode_getIndex((ASTNode_t *)n));
+      CharBuffer_append(expressionStream, ")");
     }
-        
-    /* else */
+    else if ( lanes )
+    {
+      CharBuffer_append(expressionStream, "value[W*");
+      CharBuffer_appendInt(expressionStream, ASTNode_getIndex((ASTNode_t *)n));
+      CharBuffer_append(expressionStream, "+l]");
+    }
+    else
     {
       CharBuffer_append(expressionStream, "value[");
       CharBuffer_appendInt(expressionStream, ASTNode_getIndex((ASTNode_t *)n));
@@ -2081,7 +2095,7 @@ SBML_ODESOLVER_API void generateMacros(charBuffer_t *buffer)
 		    "#define atanh(x) ((log(1.0 + (x)) - log(1.0-(x)))/2.0)\n"\
 		    "#define csc(x) (1.0/sin(x))\n"\
 		    "\n"\
-		    "double factorial(double x)\n"\
+		    "static double factorial(double x)\n"\
 		    "{\n"\
 		    "    double result ;\n"\
 		    "    int j = floor(x);\n"\
@@ -2093,7 +2107,8 @@ SBML_ODESOLVER_API void generateMacros(charBuffer_t *buffer)
 
 /* appends compilable code to the given buffer for the given AST assuming
    the AST is an XOR expression. */
-static void ASTNode_generateXOR(charBuffer_t *expressionStream, const ASTNode_t *node)
+static void ASTNode_generateXOR(charBuffer_t *expressionStream,
+				const ASTNode_t *node, int lanes)
 {
   unsigned int i;
     
@@ -2103,7 +2118,7 @@ static void ASTNode_generateXOR(charBuffer_t *expressionStream, const ASTNode_t
   {
     CharBuffer_append(expressionStream, "(");
     ASTNode_generateNestedExpression(expressionStream,
-				     ASTNode_getChild(node, i));
+				     ASTNode_getChild(node, i), lanes);
     CharBuffer_append(expressionStream, " ? 1 : 0)");
     if ( i != ASTNode_getNumChildren(node) - 1 )
       CharBuffer_append(expressionStream, " + ");
@@ -2115,26 +2130,42 @@ static void ASTNode_generateXOR(charBuffer_t *expressionStream, const ASTNode_t
 /* appends compilable code to the given buffer that
    implements the given AST. */
 SBML_ODESOLVER_API void generateAST(charBuffer_t *expressionStream, const ASTNode_t *node)
+{
+  ASTNode_generate(expressionStream, node, 0);
+}
+
+/** appends compilable code to the given buffer that implements the
+    given AST for lane l of W parameter sets, which are evaluated at
+    once; the values of all lanes are stored in the array 'value' with
+    the lanes running fastest, i.e. value[W*i+l] is the value of index
+    i in lane l.  The code requires 'W' and 'l' to be declared. */
+SBML_ODESOLVER_API void generateLaneAST(charBuffer_t *expressionStream, const ASTNode_t *node)
+{
+  ASTNode_generate(expressionStream, node, 1);
+}
+
+static void ASTNode_generate(charBuffer_t *expressionStream,
+			     const ASTNode_t *node, int lanes)
 {
   switch (ASTNode_getType(node))
   {
   case AST_PLUS :
-    ASTNode_generateNaryOperator(expressionStream, node, "+");
+    ASTNode_generateNaryOperator(expressionStream, node, "+", lanes);
     break;
   case AST_TIMES :
-    ASTNode_generateNaryOperator(expressionStream, node, "*");
+    ASTNode_generateNaryOperator(expressionStream, node, "*", lanes);
     break;
   case AST_MINUS :
     if (ASTNode_getNumChildren(node) == 1)
-      ASTNode_generateUnaryOperator(expressionStream, node, "-");
+      ASTNode_generateUnaryOperator(expressionStream, node, "-", lanes);
     else
-      ASTNode_generateNaryOperator(expressionStream, node, "-");
+      ASTNode_generateNaryOperator(expressionStream, node, "-", lanes);
     break;
   case AST_DIVIDE : 
-    ASTNode_generateNaryOperator(expressionStream, node, "/");
+    ASTNode_generateNaryOperator(expressionStream, node, "/", lanes);
     break;
   case AST_POWER :
-    ASTNode_generateFunctionCall(expressionStream, node, "pow");
+    ASTNode_generateFunctionCall(expressionStream, node, "pow", lanes);
     break;
   case AST_INTEGER :
     CharBuffer_append(expressionStream, "((realtype)");
@@ -2149,7 +2180,7 @@ SBML_ODESOLVER_API void generateAST(charBuffer_t *expressionStream, const ASTNod
     CharBuffer_append(expressionStream, ")");
     break;
   case AST_NAME :
-    ASTNode_generateName(expressionStream, node);
+    ASTNode_generateName(expressionStream, node, lanes);
     break;
   case AST_NAME_TIME :
     CharBuffer_append(expressionStream, "data->currenttime");
@@ -2169,136 +2200,136 @@ SBML_ODESOLVER_API void generateAST(charBuffer_t *expressionStream, const ASTNod
     CharBuffer_appendDouble(expressionStream, 1.0);
     break;
   case AST_FUNCTION_ABS :
-    ASTNode_generateFunctionCall(expressionStream, node, "fabs");
+    ASTNode_generateFunctionCall(expressionStream, node, "fabs", lanes);
     break;
   case AST_FUNCTION_ARCCOS :
-    ASTNode_generateFunctionCall(expressionStream, node, "acos");
+    ASTNode_generateFunctionCall(expressionStream, node, "acos", lanes);
     break;
   case AST_FUNCTION_ARCCOSH :
-    ASTNode_generateFunctionCall(expressionStream, node, "acosh");
+    ASTNode_generateFunctionCall(expressionStream, node, "acosh", lanes);
     break;
   case AST_FUNCTION_ARCCOT :
-    ASTNode_generateFunctionCall(expressionStream, node, "acot");
+    ASTNode_generateFunctionCall(expressionStream, node, "acot", lanes);
     break;
   case AST_FUNCTION_ARCCOTH :
-    ASTNode_generateFunctionCall(expressionStream, node, "acoth");
+    ASTNode_generateFunctionCall(expressionStream, node, "acoth", lanes);
     break;
   case AST_FUNCTION_ARCCSC :
-    ASTNode_generateFunctionCall(expressionStream, node, "acsc");
+    ASTNode_generateFunctionCall(expressionStream, node, "acsc", lanes);
     break;
   case AST_FUNCTION_ARCCSCH :
-    ASTNode_generateFunctionCall(expressionStream, node, "acsch");
+    ASTNode_generateFunctionCall(expressionStream, node, "acsch", lanes);
     break;
   case AST_FUNCTION_ARCSEC :
-    ASTNode_generateFunctionCall(expressionStream, node, "asec");
+    ASTNode_generateFunctionCall(expressionStream, node, "asec", lanes);
     break;
   case AST_FUNCTION_ARCSECH :
-    ASTNode_generateFunctionCall(expressionStream, node, "asech");
+    ASTNode_generateFunctionCall(expressionStream, node, "asech", lanes);
     break;
   case AST_FUNCTION_ARCSIN :
-    ASTNode_generateFunctionCall(expressionStream, node, "asin");
+    ASTNode_generateFunctionCall(expressionStream, node, "asin", lanes);
     break;
   case AST_FUNCTION_ARCSINH :
-    ASTNode_generateFunctionCall(expressionStream, node, "asinh");
+    ASTNode_generateFunctionCall(expressionStream, node, "asinh", lanes);
     break;
   case AST_FUNCTION_ARCTAN :
-    ASTNode_generateFunctionCall(expressionStream, node, "atan");
+    ASTNode_generateFunctionCall(expressionStream, node, "atan", lanes);
     break;
   case AST_FUNCTION_ARCTANH :
-    ASTNode_generateFunctionCall(expressionStream, node, "atanh");
+    ASTNode_generateFunctionCall(expressionStream, node, "atanh", lanes);
     break;
   case AST_FUNCTION_CEILING :
-    ASTNode_generateFunctionCall(expressionStream, node, "ceil");
+    ASTNode_generateFunctionCall(expressionStream, node, "ceil", lanes);
     break;
   case AST_FUNCTION_COS :
-    ASTNode_generateFunctionCall(expressionStream, node, "cos");
+    ASTNode_generateFunctionCall(expressionStream, node, "cos", lanes);
     break;
   case AST_FUNCTION_COSH :
-    ASTNode_generateFunctionCall(expressionStream, node, "cosh");
+    ASTNode_generateFunctionCall(expressionStream, node, "cosh", lanes);
     break;
   case AST_FUNCTION_COT :
-    ASTNode_generateFunctionCall(expressionStream, node, "cot");
+    ASTNode_generateFunctionCall(expressionStream, node, "cot", lanes);
     break;
   case AST_FUNCTION_COTH :
-    ASTNode_generateFunctionCall(expressionStream, node, "coth");
+    ASTNode_generateFunctionCall(expressionStream, node, "coth", lanes);
     break;
   case AST_FUNCTION_CSC :
-    ASTNode_generateFunctionCall(expressionStream, node, "csc");
+    ASTNode_generateFunctionCall(expressionStream, node, "csc", lanes);
     break;
   case AST_FUNCTION_CSCH :
-    ASTNode_generateFunctionCall(expressionStream, node, "csch");
+    ASTNode_generateFunctionCall(expressionStream, node, "csch", lanes);
     break;
   case AST_FUNCTION_EXP :
-    ASTNode_generateFunctionCall(expressionStream, node, "exp");
+    ASTNode_generateFunctionCall(expressionStream, node, "exp", lanes);
     break;
   case AST_FUNCTION_FACTORIAL :
-    ASTNode_generateFunctionCall(expressionStream, node, "factorial");
+    ASTNode_generateFunctionCall(expressionStream, node, "factorial", lanes);
     break;
   case AST_FUNCTION_FLOOR :
-    ASTNode_generateFunctionCall(expressionStream, node, "floor");
+    ASTNode_generateFunctionCall(expressionStream, node, "floor", lanes);
     break;
   case AST_FUNCTION_LN :
-    ASTNode_generateFunctionCall(expressionStream, node, "log");
+    ASTNode_generateFunctionCall(expressionStream, node, "log", lanes);
     break;
   case AST_FUNCTION_LOG :
-    ASTNode_generateFunctionCall(expressionStream, node, "MyLog");
+    ASTNode_generateFunctionCall(expressionStream, node, "MyLog", lanes);
     break;
   case AST_FUNCTION_PIECEWISE :
-    ASTNode_generateFunctionCall(expressionStream, node, "piecewise");
+    ASTNode_generateFunctionCall(expressionStream, node, "piecewise", lanes);
     break;
   case AST_FUNCTION_POWER :
-    ASTNode_generateFunctionCall(expressionStream, node, "pow");
+    ASTNode_generateFunctionCall(expressionStream, node, "pow", lanes);
     break;
   case AST_FUNCTION_ROOT :
-    ASTNode_generateFunctionCall(expressionStream, node, "root");
+    ASTNode_generateFunctionCall(expressionStream, node, "root", lanes);
     break;
   case AST_FUNCTION_SEC :
-    ASTNode_generateFunctionCall(expressionStream, node, "sec");
+    ASTNode_generateFunctionCall(expressionStream, node, "sec", lanes);
     break;
   case AST_FUNCTION_SECH :
-    ASTNode_generateFunctionCall(expressionStream, node, "sech");
+    ASTNode_generateFunctionCall(expressionStream, node, "sech", lanes);
     break;
   case AST_FUNCTION_SIN :
-    ASTNode_generateFunctionCall(expressionStream, node, "sin");
+    ASTNode_generateFunctionCall(expressionStream, node, "sin", lanes);
     break;
   case AST_FUNCTION_SINH :
-    ASTNode_generateFunctionCall(expressionStream, node, "sinh");
+    ASTNode_generateFunctionCall(expressionStream, node, "sinh", lanes);
     break;
   case AST_FUNCTION_TAN :
-    ASTNode_generateFunctionCall(expressionStream, node, "tan");
+    ASTNode_generateFunctionCall(expressionStream, node, "tan", lanes);
     break;
   case AST_FUNCTION_TANH :
-    ASTNode_generateFunctionCall(expressionStream, node, "tanh");
+    ASTNode_generateFunctionCall(expressionStream, node, "tanh", lanes);
     break;
   case AST_LOGICAL_AND :
-    ASTNode_generateNaryOperator(expressionStream, node, "&&");
+    ASTNode_generateNaryOperator(expressionStream, node, "&&", lanes);
     break;
   case AST_LOGICAL_NOT :
-    ASTNode_generateUnaryOperator(expressionStream, node, "!");
+    ASTNode_generateUnaryOperator(expressionStream, node, "!", lanes);
     break;
   case AST_LOGICAL_OR :
-    ASTNode_generateNaryOperator(expressionStream, node, "||");
+    ASTNode_generateNaryOperator(expressionStream, node, "||", lanes);
     break;
   case AST_LOGICAL_XOR :
-    ASTNode_generateXOR(expressionStream, node);
+    ASTNode_generateXOR(expressionStream, node, lanes);
     break;
   case AST_RELATIONAL_EQ :
-    ASTNode_generateNaryOperator(expressionStream, node, "==");
+    ASTNode_generateNaryOperator(expressionStream, node, "==", lanes);
     break;
   case AST_RELATIONAL_GEQ :
-    ASTNode_generateNaryOperator(expressionStream, node, ">=");
+    ASTNode_generateNaryOperator(expressionStream, node, ">=", lanes);
     break;
   case AST_RELATIONAL_GT :
-    ASTNode_generateNaryOperator(expressionStream, node, ">");
+    ASTNode_generateNaryOperator(expressionStream, node, ">", lanes);
     break;
   case AST_RELATIONAL_LEQ :
-    ASTNode_generateNaryOperator(expressionStream, node, "<=");
+    ASTNode_generateNaryOperator(expressionStream, node, "<=", lanes);
     break;
   case AST_RELATIONAL_LT :
-    ASTNode_generateNaryOperator(expressionStream, node, "<");
+    ASTNode_generateNaryOperator(expressionStream, node, "<", lanes);
     break;
   case AST_RELATIONAL_NEQ :
-    ASTNode_generateNaryOperator(expressionStream, node, "!=");
+    ASTNode_generateNaryOperator(expressionStream, node, "!=", lanes);
     break;
   default :
     SolverError_error(FATAL_ERROR_TYPE,
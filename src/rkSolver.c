@@ -0,0 +1,679 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup rk Built-in Runge-Kutta and Rosenbrock ODE Solvers:  x(t)
+  \ingroup integrator
+  \brief This module contains light-weight one-step solvers for small
+  ODE systems, where setup and bookkeeping of CVODES cost more than
+  the evaluation of the ODEs: the embedded Runge-Kutta 5(4) pair of
+  Dormand and Prince for non-stiff systems, and the Rosenbrock 2(3)
+  triple of Shampine and Reichelt (ode23s) for stiff systems.
+
+  The solvers are selected via CvodeSettings_setMethod and work on
+  plain arrays. Sensitivity analysis, adjoint runs and objective
+  functions are left to CVODES.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <cvodes/cvodes.h>
+#include <nvector/nvector_serial.h>
+#include <sundials/sundials_dense.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/processAST.h"
+#include "sbmlsolver/odeModel.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/cvodeSolver.h"
+#include "sbmlsolver/rkSolver.h"
+
+/* step size control: safety factor and bounds of the change */
+#define RK_SAFETY 0.9
+#define RK_MINFAC 0.2
+#define RK_MAXFAC 5.0
+
+/* Dormand-Prince 5(4): nodes, coefficients with the 5th order weights
+   in the last row, and the differences to the 4th order weights */
+static const realtype rkC[7] =
+  { 0.0, 1.0/5.0, 3.0/10.0, 4.0/5.0, 8.0/9.0, 1.0, 1.0 };
+static const realtype rkA[7][6] = {
+  { 0.0 },
+  { 1.0/5.0 },
+  { 3.0/40.0, 9.0/40.0 },
+  { 44.0/45.0, -56.0/15.0, 32.0/9.0 },
+  { 19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0 },
+  { 9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0,
+    -5103.0/18656.0 },
+  { 35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0,
+    11.0/84.0 }
+};
+static const realtype rkE[7] =
+  { 71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0,
+    22.0/525.0, -1.0/40.0 };
+
+static int RKSolver_rhs(rkSolver_t *, void *fdata,
+			realtype t, realtype *y, realtype *ydot);
+static realtype RKSolver_initialStep(rkSolver_t *, const cvodeSettings_t *,
+				     realtype t, realtype tout);
+static realtype RKSolver_errorNorm(rkSolver_t *, const cvodeSettings_t *);
+static int RKSolver_dormandPrince(rkSolver_t *, void *fdata,
+				  realtype t, realtype h);
+static int RKSolver_jacobian(rkSolver_t *, const cvodeSettings_t *,
+			     cvodeData_t *, realtype t, realtype h);
+static int RKSolver_rosenbrock(rkSolver_t *, cvodeData_t *,
+			       realtype t, realtype h);
+
+
+/** Calls the built-in Runge-Kutta (RK45) or Rosenbrock solver to move
+    the current simulation one time step.
+
+    Produces appropriate error messages on failures and returns 1 if
+    the integration can continue, 0 otherwise. Like
+    IntegratorInstance_cvodeOneStep, the solver stops exactly at the
+    firing times of time-only event triggers, and uses the default
+    update of events, results and steady state detection at output
+    times. This function is called by IntegratorInstance_integrateOneStep
+    if the built-in solvers are requested via CvodeSettings_setMethod.
+*/
+
+SBML_ODESOLVER_API int IntegratorInstance_rkOneStep(integratorInstance_t *engine)
+{
+  int i;
+  double tevent;
+  cvodeSolver_t *solver = engine->solver;
+  cvodeData_t *data = engine->data;
+
+  if ( !engine->isValid )
+  {
+    solver->t0 = solver->t;
+    if ( !IntegratorInstance_createRKSolverStructures(engine) )
+      return 0;
+  }
+
+  if ( !engine->clockStarted )
+  {
+    engine->startTime = clock();
+    engine->clockStarted = 1;
+  }
+
+  /* stop exactly at the firing times of time-only event
+     triggers before tout, and process events there */
+  while ( engine->processEvents &&
+	  IntegratorInstance_getNextEventTime(engine, &tevent) &&
+	  tevent < solver->tout )
+  {
+    if ( !RKSolver_integrateTo(solver->rk, engine->opt, &solver->t,
+			       tevent, data) )
+      return 0;
+
+    data->currenttime = solver->t;
+    for ( i=0; i<engine->om->neq; i++ )
+      data->value[i] = solver->rk->y[i];
+    data->allRulesUpdated = 0;
+    if ( !IntegratorInstance_handleEvents(engine) )
+      return 0;
+
+    if ( !engine->isValid )
+    {
+      solver->t0 = solver->t;
+      if ( !IntegratorInstance_createRKSolverStructures(engine) )
+	return 0;
+    }
+  }
+
+  if ( !RKSolver_integrateTo(solver->rk, engine->opt, &solver->t,
+			     solver->tout, data) )
+    return 0;
+
+  /* update cvodeData time dependent variables */
+  for ( i=0; i<engine->om->neq; i++ )
+    data->value[i] = solver->rk->y[i];
+
+  /* update rest of data with internal default function */
+  return IntegratorInstance_updateData(engine);
+}
+
+
+/** Prints some final statistics of the built-in solvers
+*/
+
+SBML_ODESOLVER_API void IntegratorInstance_printRKStatistics(const integratorInstance_t *engine, FILE *f)
+{
+  cvodeSettings_t *opt = engine->opt;
+  rkSolver_t *rk = engine->solver->rk;
+
+  if ( rk == NULL )
+  {
+    fprintf(f, "## No statistics available.\n");
+    return;
+  }
+
+  fprintf(f, "\n## Integration Parameters:\n");
+  fprintf(f, "## mxstep   = %d rel.err. = %g abs.err. = %g \n",
+	  opt->Mxstep, opt->RError, opt->Error);
+  fprintf(f, "## %s Statistics:\n",
+	  rk->method == 3 ? "RK45" : "Rosenbrock");
+  fprintf(f, "## nst = %-6ld nfe  = %-6ld netf = %ld\n",
+	  rk->nst, rk->nfe, rk->netf);
+  if ( rk->method == 4 )
+    fprintf(f, "## nje = %-6ld nlu  = %ld\n", rk->nje, rk->nlu);
+}
+
+
+/************* internal functions ************/
+
+/* the built-in solvers are requested and can be used, i.e. no
+   sensitivities, adjoint solutions or quadratures are required,
+   which are left to CVODES */
+int IntegratorInstance_useRKSolver(const integratorInstance_t *engine)
+{
+  cvodeSettings_t *opt = engine->opt;
+
+  return (opt->CvodeMethod == 3 || opt->CvodeMethod == 4) &&
+    !opt->Sensitivity && !opt->DoAdjoint &&
+    engine->om->ObjectiveFunction == NULL;
+}
+
+
+/* creates the work arrays of the built-in solvers, if not yet
+   available, and initializes the solution from cvodeData,
+   returns 1 on success or 0 on failure */
+int IntegratorInstance_createRKSolverStructures(integratorInstance_t *engine)
+{
+  int i, neq;
+  rkSolver_t *rk;
+  cvodeSolver_t *solver = engine->solver;
+
+  neq = engine->om->neq;
+
+  if ( solver->rk != NULL && solver->rk->neq != neq )
+    IntegratorInstance_freeRKSolverStructures(engine);
+
+  if ( solver->rk == NULL )
+  {
+    solver->rk = RKSolver_create(neq, 1);
+    if ( solver->rk == NULL )
+      return 0;
+  }
+  rk = solver->rk;
+
+  rk->method = engine->opt->CvodeMethod;
+  if ( rk->method == 4 && rk->J == NULL )
+  {
+    rk->J = newDenseMat(neq, neq);
+    CVODE_HANDLE_ERROR((void *)rk->J, "newDenseMat", 0);
+    rk->W = newDenseMat(neq, neq);
+    CVODE_HANDLE_ERROR((void *)rk->W, "newDenseMat", 0);
+    ASSIGN_NEW_MEMORY_BLOCK(rk->pivot, neq, int, 0);
+  }
+
+  rk->useJacobian = engine->UseJacobian;
+  rk->rhs = IntegratorInstance_getRHSFunction(engine);
+  if ( rk->rhs == NULL )
+    return 0; /* error */
+
+  /* statistics are collected over a run */
+  if ( rk->run != engine->run )
+  {
+    rk->run = engine->run;
+    rk->nst = rk->nfe = rk->netf = rk->nje = rk->nlu = 0;
+  }
+
+  /* (re)start at the current values with a new initial step */
+  for ( i=0; i<neq; i++ )
+    rk->y[i] = engine->data->value[i];
+  rk->f0Valid = 0;
+  rk->h = 0.0;
+
+  engine->isValid = 1;
+
+  return 1;
+}
+
+
+/* frees the work arrays of the built-in solvers */
+void IntegratorInstance_freeRKSolverStructures(integratorInstance_t *engine)
+{
+  RKSolver_free(engine->solver->rk);
+  engine->solver->rk = NULL;
+}
+
+
+/* creates the vectors of the built-in solvers for nlanes systems of
+   neq ODEs, stored lane-contiguous, i.e. variable i of lane l at
+   position nlanes*i+l; returns NULL on failure */
+rkSolver_t *RKSolver_create(int neq, int nlanes)
+{
+  int i, n = nlanes*neq;
+  rkSolver_t *rk;
+
+  ASSIGN_NEW_MEMORY(rk, struct rkSolver, NULL);
+  rk->neq = neq;
+  rk->nlanes = nlanes;
+  /* at least one element, also for models without ODEs */
+  ASSIGN_NEW_MEMORY_BLOCK(rk->y, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(rk->ynew, n+1, realtype, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(rk->err, n+1, realtype, NULL);
+  for ( i=0; i<7; i++ )
+    ASSIGN_NEW_MEMORY_BLOCK(rk->k[i], n+1, realtype, NULL);
+
+  /* the RHS function expects N_Vectors, their data
+     pointers are set before each call */
+  rk->yv = N_VMake_Serial(n, rk->y);
+  CVODE_HANDLE_ERROR((void *)rk->yv, "N_VMake_Serial", 0);
+  rk->fv = N_VMake_Serial(n, rk->k[0]);
+  CVODE_HANDLE_ERROR((void *)rk->fv, "N_VMake_Serial", 0);
+
+  return rk;
+}
+
+
+/* frees the vectors and matrices of the built-in solvers */
+void RKSolver_free(rkSolver_t *rk)
+{
+  int i;
+
+  if ( rk == NULL )
+    return;
+
+  free(rk->y);
+  free(rk->ynew);
+  free(rk->err);
+  for ( i=0; i<7; i++ )
+    free(rk->k[i]);
+  if ( rk->J != NULL )
+    destroyMat(rk->J);
+  if ( rk->W != NULL )
+    destroyMat(rk->W);
+  free(rk->pivot);
+  if ( rk->yv != NULL )
+    N_VDestroy_Serial(rk->yv);
+  if ( rk->fv != NULL )
+    N_VDestroy_Serial(rk->fv);
+
+  free(rk);
+}
+
+
+/* integrates the nlanes systems from time t to tout with a common
+   error controlled step size, the last step ends exactly at tout; the
+   largest error of all lanes decides. fdata is passed to the RHS
+   function, the Rosenbrock method expects the cvodeData. Returns 1 on
+   success and 0 on failure */
+int RKSolver_integrateTo(rkSolver_t *rk, const cvodeSettings_t *opt,
+			 realtype *t, realtype tout, void *fdata)
+{
+  int flag, nsteps, clipped, jacobianValid, fsal;
+  realtype h, hprop, errNorm, factor, order, *tmp;
+
+  if ( !rk->f0Valid )
+  {
+    flag = RKSolver_rhs(rk, fdata, *t, rk->y, rk->k[0]);
+    if ( flag != 0 )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+			"Evaluation of the ODEs failed at time %g.", *t);
+      return 0;
+    }
+    rk->f0Valid = 1;
+  }
+
+  if ( rk->h <= 0.0 )
+    rk->h = RKSolver_initialStep(rk, opt, *t, tout);
+
+  /* error estimates are O(h^5) for RK45 and O(h^3) for Rosenbrock,
+     the last stage is the first stage of the next step */
+  order = rk->method == 3 ? 5.0 : 3.0;
+  fsal = rk->method == 3 ? 6 : 5;
+
+  jacobianValid = 0;
+  nsteps = 0;
+  while ( *t < tout )
+  {
+    if ( nsteps++ >= opt->Mxstep )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+			"Too much work, mxstep = %d steps taken before "
+			"reaching tout = %g.", opt->Mxstep, tout);
+      return 0;
+    }
+
+    /* hit tout exactly, and avoid a tiny last step */
+    hprop = h = rk->h;
+    clipped = *t + 1.1*h >= tout;
+    if ( clipped )
+      h = tout - *t;
+
+    if ( h <= 16.0*UNIT_ROUNDOFF*fabs(*t) )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+			"Step size too small at time %g.", *t);
+      return 0;
+    }
+
+    if ( rk->method == 3 )
+      flag = RKSolver_dormandPrince(rk, fdata, *t, h);
+    else
+    {
+      if ( !jacobianValid )
+      {
+	if ( !RKSolver_jacobian(rk, opt, fdata, *t, h) )
+	  return 0;
+	jacobianValid = 1;
+      }
+      flag = RKSolver_rosenbrock(rk, fdata, *t, h);
+    }
+
+    if ( flag < 0 )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+			"Evaluation of the ODEs failed at time %g.", *t);
+      return 0;
+    }
+
+    /* recoverable failure (e.g. negative states or a singular
+       iteration matrix) or too large error: retry smaller step; a
+       non-finite error (NaN) is handled as a failure of the step */
+    errNorm = flag > 0 ? 0.0 : RKSolver_errorNorm(rk, opt);
+    if ( flag > 0 || !(errNorm <= 1.0) )
+    {
+      rk->netf++;
+      factor = errNorm > 1.0 ? RK_SAFETY * pow(errNorm, -1.0/order) : 0.25;
+      rk->h = h * (factor < RK_MINFAC ? RK_MINFAC : factor);
+      continue;
+    }
+
+    /* accept step */
+    rk->nst++;
+    *t = clipped ? tout : *t + h;
+    tmp = rk->y;
+    rk->y = rk->ynew;
+    rk->ynew = tmp;
+    tmp = rk->k[0];
+    rk->k[0] = rk->k[fsal];
+    rk->k[fsal] = tmp;
+    jacobianValid = 0;
+
+    factor = errNorm > 0.0 ? RK_SAFETY * pow(errNorm, -1.0/order) : RK_MAXFAC;
+    rk->h = h * (factor > RK_MAXFAC ? RK_MAXFAC : factor);
+    /* a step shortened to hit tout doesn't limit the next one */
+    if ( clipped && rk->h < hprop )
+      rk->h = hprop;
+  }
+
+  return 1;
+}
+
+
+/* evaluates the ODEs at time t and the plain array y */
+static int RKSolver_rhs(rkSolver_t *rk, void *fdata,
+			realtype t, realtype *y, realtype *ydot)
+{
+  NV_DATA_S(rk->yv) = y;
+  NV_DATA_S(rk->fv) = ydot;
+  rk->nfe++;
+  return rk->rhs(t, rk->yv, rk->fv, fdata);
+}
+
+
+/* maximum over all lanes of the weighted root mean square norm of
+   the local error estimate, with the same weights as CVODES */
+static realtype RKSolver_errorNorm(rkSolver_t *rk, const cvodeSettings_t *opt)
+{
+  int i, l, W = rk->nlanes;
+  realtype sum, w, y, norm, max;
+
+  if ( rk->neq == 0 )
+    return 0.0;
+
+  max = 0.0;
+  for ( l=0; l<W; l++ )
+  {
+    sum = 0.0;
+    for ( i=0; i<rk->neq; i++ )
+    {
+      y = fabs(rk->y[W*i+l]) > fabs(rk->ynew[W*i+l]) ?
+	fabs(rk->y[W*i+l]) : fabs(rk->ynew[W*i+l]);
+      w = rk->err[W*i+l] / (opt->Error + opt->RError * y);
+      sum += w*w;
+    }
+    norm = sqrt(sum/rk->neq);
+    /* propagates NaN */
+    if ( !(norm <= max) )
+      max = norm;
+  }
+
+  return max;
+}
+
+
+/* initial step size from the norms of x and dx/dt (Hairer, Norsett
+   and Wanner), the smallest of all lanes */
+static realtype RKSolver_initialStep(rkSolver_t *rk, const cvodeSettings_t *opt,
+				     realtype t, realtype tout)
+{
+  int i, l, W = rk->nlanes;
+  realtype d0, d1, w, h, hmin;
+
+  hmin = tout - t;
+  if ( rk->neq == 0 )
+    return hmin;
+
+  for ( l=0; l<W; l++ )
+  {
+    d0 = d1 = 0.0;
+    for ( i=0; i<rk->neq; i++ )
+    {
+      w = opt->Error + opt->RError * fabs(rk->y[W*i+l]);
+      d0 += (rk->y[W*i+l]/w) * (rk->y[W*i+l]/w);
+      d1 += (rk->k[0][W*i+l]/w) * (rk->k[0][W*i+l]/w);
+    }
+    d0 = sqrt(d0/rk->neq);
+    d1 = sqrt(d1/rk->neq);
+
+    h = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0/d1;
+    if ( h < hmin )
+      hmin = h;
+  }
+
+  return hmin;
+}
+
+
+/* attempts a Dormand-Prince step of size h from time t, writes the
+   solution to ynew and the error estimate to err; returns the flag of
+   the RHS function */
+static int RKSolver_dormandPrince(rkSolver_t *rk, void *fdata,
+				  realtype t, realtype h)
+{
+  int i, j, s, flag, n = rk->nlanes*rk->neq;
+  realtype sum;
+
+  for ( s=1; s<7; s++ )
+  {
+    for ( i=0; i<n; i++ )
+    {
+      sum = 0.0;
+      for ( j=0; j<s; j++ )
+	sum += rkA[s][j] * rk->k[j][i];
+      rk->ynew[i] = rk->y[i] + h*sum;
+    }
+    flag = RKSolver_rhs(rk, fdata, t + rkC[s]*h, rk->ynew, rk->k[s]);
+    if ( flag != 0 )
+      return flag;
+  }
+
+  /* the last stage was evaluated at the 5th order solution */
+  for ( i=0; i<n; i++ )
+  {
+    sum = 0.0;
+    for ( j=0; j<7; j++ )
+      sum += rkE[j] * rk->k[j][i];
+    rk->err[i] = h*sum;
+  }
+
+  return 0;
+}
+
+
+/* evaluates the Jacobian matrix J at the solution at time t, via the
+   analytic Jacobian if available or difference quotients otherwise,
+   and df/dt into k[6], with a time increment relative to t or the
+   step size h; returns 1 on success and 0 on failure */
+static int RKSolver_jacobian(rkSolver_t *rk, const cvodeSettings_t *opt,
+			     cvodeData_t *data, realtype t, realtype h)
+{
+  int i, j;
+  realtype inc, ymax, srur;
+  odeModel_t *om = data->model;
+  realtype *f0 = rk->k[0], *fj = rk->k[4];
+
+  srur = sqrt(UNIT_ROUNDOFF);
+  rk->nje++;
+
+  if ( rk->useJacobian )
+  {
+    /* as in JacODE */
+    for ( i=0; i<rk->neq; i++ )
+      data->value[i] = rk->y[i];
+    data->currenttime = t;
+
+    for ( j=0; j<rk->neq; j++ )
+      for ( i=0; i<rk->neq; i++ )
+	rk->J[j][i] = 0.0;
+    for ( i=0; i<om->sparsesize; i++ )
+    {
+      nonzeroElem_t *nonzero = om->jacobSparse[i];
+      rk->J[nonzero->j][nonzero->i] = evaluateAST(nonzero->ij, data);
+    }
+  }
+  else
+  {
+    ymax = 0.0;
+    for ( i=0; i<rk->neq; i++ )
+      if ( fabs(rk->y[i]) > ymax )
+	ymax = fabs(rk->y[i]);
+
+    for ( j=0; j<rk->neq; j++ )
+    {
+      inc = fabs(rk->y[j]) > 1e-3*ymax ? fabs(rk->y[j]) : 1e-3*ymax;
+      if ( inc < opt->Error )
+	inc = opt->Error;
+      inc = srur * (inc > 0.0 ? inc : 1.0);
+
+      for ( i=0; i<rk->neq; i++ )
+	rk->ynew[i] = rk->y[i];
+      rk->ynew[j] += inc;
+      if ( RKSolver_rhs(rk, data, t, rk->ynew, fj) != 0 )
+	return 0;
+      for ( i=0; i<rk->neq; i++ )
+	rk->J[j][i] = (fj[i] - f0[i]) / inc;
+    }
+  }
+
+  /* df/dt by a forward difference */
+  inc = srur * (fabs(t) > h ? fabs(t) : h);
+  if ( inc == 0.0 )
+    inc = srur;
+  if ( RKSolver_rhs(rk, data, t + inc, rk->y, rk->k[6]) != 0 )
+    return 0;
+  for ( i=0; i<rk->neq; i++ )
+    rk->k[6][i] = (rk->k[6][i] - f0[i]) / inc;
+
+  return 1;
+}
+
+
+/* attempts a step of size h of the L-stable Rosenbrock 2(3) triple
+   of Shampine and Reichelt from time t, writes the solution
+   to ynew and the error estimate to err; returns the flag of the RHS
+   function, or 1 if the iteration matrix is singular */
+static int RKSolver_rosenbrock(rkSolver_t *rk, cvodeData_t *data,
+			       realtype t, realtype h)
+{
+  int i, j, flag, neq;
+  realtype d, e32;
+  realtype *f0 = rk->k[0], *k1 = rk->k[1], *k2 = rk->k[2], *k3 = rk->k[3];
+  realtype *f1 = rk->k[4], *f2 = rk->k[5], *dfdt = rk->k[6];
+
+  neq = rk->neq;
+  d = 1.0 / (2.0 + sqrt(2.0));
+  e32 = 6.0 + sqrt(2.0);
+
+  /* W = I - h*d*J */
+  for ( j=0; j<neq; j++ )
+    for ( i=0; i<neq; i++ )
+      rk->W[j][i] = (i == j ? 1.0 : 0.0) - h*d*rk->J[j][i];
+  rk->nlu++;
+  if ( denseGETRF(rk->W, neq, neq, rk->pivot) != 0 )
+    return 1;
+
+  for ( i=0; i<neq; i++ )
+    k1[i] = f0[i] + h*d*dfdt[i];
+  denseGETRS(rk->W, neq, rk->pivot, k1);
+
+  for ( i=0; i<neq; i++ )
+    rk->ynew[i] = rk->y[i] + 0.5*h*k1[i];
+  flag = RKSolver_rhs(rk, data, t + 0.5*h, rk->ynew, f1);
+  if ( flag != 0 )
+    return flag;
+
+  for ( i=0; i<neq; i++ )
+    k2[i] = f1[i] - k1[i];
+  denseGETRS(rk->W, neq, rk->pivot, k2);
+  for ( i=0; i<neq; i++ )
+  {
+    k2[i] += k1[i];
+    rk->ynew[i] = rk->y[i] + h*k2[i];
+  }
+
+  flag = RKSolver_rhs(rk, data, t + h, rk->ynew, f2);
+  if ( flag != 0 )
+    return flag;
+
+  for ( i=0; i<neq; i++ )
+    k3[i] = f2[i] - e32*(k2[i] - f1[i]) - 2.0*(k1[i] - f0[i]) + h*d*dfdt[i];
+  denseGETRS(rk->W, neq, rk->pivot, k3);
+
+  for ( i=0; i<neq; i++ )
+    rk->err[i] = h/6.0 * (k1[i] - 2.0*k2[i] + k3[i]);
+
+  return 0;
+}
+
+
+/*! @} */
+/* End of file */
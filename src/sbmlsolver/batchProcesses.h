@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_BATCHPROCESSES_H_
+#define SBMLSOLVER_BATCHPROCESSES_H_
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+
+/** Outcome of one design point of a batch run in worker processes */
+enum batchStatus
+{
+  BATCH_PENDING = 0,    /**< not (yet) integrated */
+  BATCH_COMPLETED,      /**< the time course was completed */
+  BATCH_FAILED,         /**< the integration failed, the results
+			   contain the output times reached */
+  BATCH_CRASHED,        /**< the worker process died, e.g. by a
+			   segmentation fault or a call of exit */
+  BATCH_TIMEOUT         /**< the worker process was killed after the
+			   time limit */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* BATCH INTEGRATION IN WORKER PROCESSES */
+  SBML_ODESOLVER_API int IntegratorInstance_batchProcesses(integratorInstance_t *, int nrparams, variableIndex_t **vi, int nrdesignpoints, double **params, int nworkers, double timeout, cvodeResults_t **results, int *status);
+  SBML_ODESOLVER_API int BatchProcesses_isIsolated(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
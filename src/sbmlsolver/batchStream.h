@@ -0,0 +1,82 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_BATCHSTREAM_H_
+#define SBMLSOLVER_BATCHSTREAM_H_
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+
+typedef struct batchPoint batchPoint_t;
+
+/** A view of the results of one design point of a streaming batch
+    run, which is valid during the call of the batchCallback only */
+struct batchPoint
+{
+  int point;              /**< index of the design point */
+  int nrparams;           /**< number of varied variables */
+  const double *params;   /**< values of the varied variables */
+  int completed;          /**< 1 if the time course was completed, 0 if
+			     the integration failed */
+  int nout;               /**< output steps reached, without the
+			     initial time */
+  const double *time;     /**< output times 0..nout, NULL if results
+			     are not stored (CvodeSettings_setStoreResults) */
+  int nobs;               /**< number of observables */
+  variableIndex_t **observable; /**< the observables */
+  const double **value;   /**< time courses of the observables at the
+			     output times, NULL if results are not stored */
+  const double *final;    /**< values of the observables at the last
+			     output time reached */
+  const double *min;      /**< minima of the observables over the
+			     output times reached */
+  const double *max;      /**< maxima of the observables over the
+			     output times reached */
+  int hasObjective;       /**< 1 if objective holds the value of the
+			     objective function */
+  double objective;       /**< value of the objective function, see
+			     IntegratorInstance_setObjectiveFunction */
+};
+
+/** Called for each finished design point of a streaming batch run
+    with the user data passed to the batch function; the batch run
+    stops if it returns 0 */
+typedef int (*batchCallback_t)(const batchPoint_t *, void *);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* STREAMING BATCH INTEGRATION */
+  SBML_ODESOLVER_API int IntegratorInstance_batchStream(integratorInstance_t *, int nrparams, variableIndex_t **vi, int nrdesignpoints, double **params, int nobs, variableIndex_t **observable, batchCallback_t, void *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
@@ -0,0 +1,121 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_BLOCKDECOMPOSITION_H_
+#define SBMLSOLVER_BLOCKDECOMPOSITION_H_
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+
+typedef struct odeBlock odeBlock_t;
+typedef struct blockDecomposition blockDecomposition_t;
+
+/** A strongly connected block of ODE variables, integrated by its
+    own CVODES solver with the upstream variables it reads taken from
+    the dense output of their blocks */
+struct odeBlock
+{
+  int size;               /**< number of ODE variables */
+  int *variable;          /**< their indices, ascending */
+  int level;              /**< 1 + the highest level of the upstream
+			     blocks, 0 for blocks without inputs */
+  int ninputs;            /**< number of upstream ODE variables read */
+  int *input;             /**< their indices */
+  int nrules;             /**< number of assignment rules required */
+  nonzeroElem_t **rule;   /**< these rules, in om->assignmentOrder */
+  int njacobian;          /**< number of Jacobian entries within the
+			     block */
+  nonzeroElem_t **jacobian; /**< these entries of om->jacobSparse */
+
+  /* settings of the solver */
+  double abstol;          /**< absolute tolerance */
+  double reltol;          /**< relative tolerance */
+  int method;             /**< BDF (0) or ADAMS-MOULTON (1) */
+  int iteration;          /**< Newton (0) or functional (1) iteration */
+  int useJacobian;        /**< 1 for the Jacobian entries of the block,
+			     0 for difference quotients */
+
+  /* dense output: step n covers time[n-1] to time[n] by the
+     polynomial sum_k dense[offset[n]+k*size+i] (t-time[n])^k of
+     degree order[n] for variable i, step 0 holds the initial
+     values */
+  int nsteps;             /**< number of stored steps */
+  int allocated;          /**< number of allocated steps */
+  double *time;           /**< end times of the steps */
+  int *order;             /**< order of the steps */
+  int *offset;            /**< offsets of the coefficients of the steps */
+  double *dense;          /**< Taylor coefficients of the steps */
+  int ndense;             /**< number of stored coefficients */
+  int ndenseAllocated;    /**< number of allocated coefficients */
+  int completed;          /**< 1 if the last integration was successful */
+};
+
+/** The block-triangular decomposition of the ODE system of an
+    integratorInstance into strongly connected blocks of mutually
+    dependent ODE variables: blocks only read variables of blocks
+    before them, and blocks of one level are independent */
+struct blockDecomposition
+{
+  odeModel_t *om;         /**< the decomposed model */
+  cvodeSettings_t *opt;   /**< settings of the integratorInstance, the
+			     output times */
+  cvodeData_t *data;      /**< initial values and evaluation of the
+			     results */
+  int nblocks;            /**< number of blocks */
+  int nlevels;            /**< number of levels */
+  int *levelStart;        /**< level l consists of the blocks
+			     levelStart[l] to levelStart[l+1]-1 */
+  int *block;             /**< block of each ODE variable */
+  int *local;             /**< index of each ODE variable in its block */
+  odeBlock_t *blocks;     /**< the blocks, upstream first */
+  cvodeResults_t *results; /**< all values at the output times */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* BLOCK DECOMPOSITION */
+  SBML_ODESOLVER_API blockDecomposition_t *IntegratorInstance_createBlockDecomposition(integratorInstance_t *);
+  SBML_ODESOLVER_API int BlockDecomposition_getNumBlocks(const blockDecomposition_t *);
+  SBML_ODESOLVER_API int BlockDecomposition_getNumLevels(const blockDecomposition_t *);
+  SBML_ODESOLVER_API int BlockDecomposition_getBlock(const blockDecomposition_t *, int variable);
+  SBML_ODESOLVER_API int BlockDecomposition_getBlockSize(const blockDecomposition_t *, int block);
+  SBML_ODESOLVER_API int BlockDecomposition_setBlockErrors(blockDecomposition_t *, int block, double abstol, double reltol);
+  SBML_ODESOLVER_API int BlockDecomposition_setBlockMethod(blockDecomposition_t *, int block, int method, int iteration);
+  SBML_ODESOLVER_API int BlockDecomposition_setBlockJacobian(blockDecomposition_t *, int block, int useJacobian);
+  SBML_ODESOLVER_API int BlockDecomposition_integrate(blockDecomposition_t *, int nthreads);
+  SBML_ODESOLVER_API double BlockDecomposition_getValue(const blockDecomposition_t *, int variable, double t);
+  SBML_ODESOLVER_API const cvodeResults_t *BlockDecomposition_getResults(const blockDecomposition_t *);
+  SBML_ODESOLVER_API void BlockDecomposition_free(blockDecomposition_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
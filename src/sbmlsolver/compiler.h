@@ -51,6 +51,17 @@ extern "C" {
 #define MAX_PATH 256
 #endif
 
+  /* whether several sources can be compiled in parallel and linked
+     into one library, only supported with gcc */
+#if defined(_WIN32) || defined(_AIX) || defined(__AIX) || defined(__AIX__) || defined(__aix) || defined(__aix__)
+#define COMPILER_MULTIPLE_SOURCES 0
+#else
+#define COMPILER_MULTIPLE_SOURCES 1
+#endif
+
+  /* optimization level used if none is given */
+#define COMPILER_DEFAULT_OPTIMIZATION 1
+
 
 #if USE_TCC == 1
 #include <libtcc.h>
@@ -64,18 +75,28 @@ extern "C" {
   {
 
 #if USE_TCC == 1
-    TCCState *s;
-#else
+    TCCState *s;  /* code compiled in memory, NULL for a library */
+#endif /* USE_TCC == 1 */
 #ifdef _WIN32
     HMODULE dllHandle;
 #else
     void *dllHandle;
 #endif /* _WIN32 */
     char *dllFileName;
-#endif /* USE_TCC == 1 */
 
   };
 
+  /** compiler backends */
+  enum compilerBackend
+    {
+      COMPILER_SYSTEM, /**< the system compiler, i.e. gcc, xlc or
+			  tcc.exe on windows, writing a shared library;
+			  falls back to COMPILER_LIBTCC if that fails */
+      COMPILER_LIBTCC  /**< in-memory compilation with libtcc, if
+			  configured --with-libtcc */
+    } ;
+  typedef enum compilerBackend compilerBackend_t;
+
   /* the compiled code structure */
   typedef struct compiled_code compiled_code_t ;
 
@@ -83,17 +104,48 @@ extern "C" {
    * create compiled code from C source
    
    *   On windows this creates a DLL and loads it
-   *   On Liunx it will use libtcc and in memory compilation
-   *   -- this is better!!
+   *   On Linux this compiles a shared library with gcc and loads it
    */
   SBML_ODESOLVER_API compiled_code_t *Compiler_compile(const char *sourceCode);
 
+  /**
+   * create compiled code from n C sources, each compiled with
+   * the optimization level (0-3) given in `levels', or with
+   * COMPILER_DEFAULT_OPTIMIZATION if `levels' is NULL.
+   
+   *   With gcc the sources are compiled in parallel, one compiler
+   *   process per processor, and linked into one shared library.
+   *   Other platforms only support n = 1.
+   */
+  SBML_ODESOLVER_API compiled_code_t *Compiler_compileSources(int n, const char **sources, const int *levels);
+
+  /**
+   * as Compiler_compileSources, with the given backend
+   
+   *   libtcc compiles all sources into one in-memory state without
+   *   temporary files or subprocesses and ignores optimization
+   *   levels; compilation is serialized, but the code of different
+   *   models can be compiled and used from several threads.
+   */
+  SBML_ODESOLVER_API compiled_code_t *Compiler_compileSourcesWithBackend(compilerBackend_t backend, int n, const char **sources, const int *levels);
+
+  /**
+   * returns 1 if the given backend is available, 0 otherwise
+   */
+  SBML_ODESOLVER_API int Compiler_hasBackend(compilerBackend_t backend);
+
+  /**
+   * number of processors online, i.e. the maximal number of
+   * compiler processes run in parallel by Compiler_compileSources
+   */
+  SBML_ODESOLVER_API int Compiler_getNumProcessors(void);
+
   /**
    * get pointer to given function corresponding to the symbol
    * in the compiled code
    
    *   On windows use WIN32 API to locate function in dll
-   *   On Linux use libtcc to locate function
+   *   On Linux use dlsym, or libtcc for in memory code
    */
   SBML_ODESOLVER_API void *CompiledCode_getFunction(compiled_code_t *, const char *symbol);
 
@@ -102,7 +154,8 @@ extern "C" {
    * calling the functions returned by getFunction.
    
    *   On windows use Win32 to unlink dll and delete dll
-   *   On Linux use libtcc to discard in memory code
+   *   On Linux unload and delete the shared library, or use
+   *   libtcc to discard in memory code
    */
   SBML_ODESOLVER_API void CompiledCode_free(compiled_code_t *);
 
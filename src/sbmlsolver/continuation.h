@@ -0,0 +1,109 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_CONTINUATION_H_
+#define SBMLSOLVER_CONTINUATION_H_
+
+#include <stdio.h>
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+#include <sbmlsolver/variableIndex.h>
+
+typedef struct bifurcationPoint bifurcationPoint_t;
+typedef struct continuationBranch continuationBranch_t;
+
+/** bifurcations of steady states detected along a branch */
+enum bifurcationType
+  {
+    BIFURCATION_FOLD = 1, /**< saddle-node: the branch turns back in
+			     the parameter, a real eigenvalue crosses
+			     zero */
+    BIFURCATION_HOPF      /**< a pair of complex eigenvalues crosses
+			     the imaginary axis */
+  } ;
+typedef enum bifurcationType bifurcationType_t;
+
+/** A bifurcation between two points of a branch, located by linear
+    interpolation of its test function */
+struct bifurcationPoint
+{
+  bifurcationType_t type; /**< fold or Hopf bifurcation */
+  int point;              /**< the first branch point after the
+			     bifurcation */
+  double p;               /**< parameter value */
+  double *x;              /**< steady state, neq values */
+  double omega;           /**< Hopf bifurcation: angular frequency of
+			     the critical eigenvalues, fold: 0 */
+};
+
+/** A branch of steady states f(x, p) = 0 traced by pseudo-arclength
+    continuation in one parameter p */
+struct continuationBranch
+{
+  odeModel_t *om;         /**< the model */
+  int neq;                /**< number of ODEs */
+  int index;              /**< index of the parameter in the values */
+  int ncons;              /**< number of conservation laws, whose
+			     totals are constant along the branch */
+  int npoints;            /**< number of points */
+  double *p;              /**< parameter values */
+  double **x;             /**< steady states, npoints rows of neq
+			     values */
+  int *nunstable;         /**< number of eigenvalues of the Jacobian
+			     matrix with positive real part, 0 for
+			     stable steady states */
+  int nbifurcations;      /**< number of bifurcations */
+  bifurcationPoint_t *bifurcation; /**< the bifurcations in the order
+				      of the branch */
+  /** statistics */
+  long int nni;           /**< Newton iterations of the corrector */
+  long int nfail;         /**< rejected steps */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* PARAMETER CONTINUATION OF STEADY STATES */
+  SBML_ODESOLVER_API continuationBranch_t *IntegratorInstance_continuation(integratorInstance_t *, variableIndex_t *, double pmin, double pmax, double ds, int maxpoints);
+  SBML_ODESOLVER_API int ContinuationBranch_getNumPoints(const continuationBranch_t *);
+  SBML_ODESOLVER_API double ContinuationBranch_getParameter(const continuationBranch_t *, int);
+  SBML_ODESOLVER_API double ContinuationBranch_getValue(const continuationBranch_t *, int, const variableIndex_t *);
+  SBML_ODESOLVER_API int ContinuationBranch_isStable(const continuationBranch_t *, int);
+  SBML_ODESOLVER_API int ContinuationBranch_getNumBifurcations(const continuationBranch_t *);
+  SBML_ODESOLVER_API bifurcationType_t ContinuationBranch_getBifurcationType(const continuationBranch_t *, int);
+  SBML_ODESOLVER_API double ContinuationBranch_getBifurcationParameter(const continuationBranch_t *, int);
+  SBML_ODESOLVER_API void ContinuationBranch_print(const continuationBranch_t *, FILE *);
+  SBML_ODESOLVER_API void ContinuationBranch_free(continuationBranch_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
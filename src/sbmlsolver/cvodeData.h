@@ -46,6 +46,8 @@ typedef struct objFunc objFunc_t;
 #include <sbmlsolver/exportdefs.h>
 #include <sbmlsolver/odeModel.h>
 #include <sbmlsolver/variableIndex.h>
+#include <sbmlsolver/eventQueue.h>
+#include <sbmlsolver/threadPool.h>
 
 /* required for realtype */
 #include <sundials/sundials_types.h>
@@ -135,6 +137,9 @@ struct cvodeData {
       at the previous time step */
   int nevents;
   int *trigger;
+  /** firing times of time-only triggers ahead of the current time,
+      NULL if the model has no such triggers */
+  eventQueue_t *eventQueue;
 
   /** steady state flag: check if steady state was found */
   int steadystate; 
@@ -148,15 +153,26 @@ struct cvodeData {
   /** value array is used to write and read the current values of
       all adjoint variables \psi(t) (of which there are `neq') */  
   double *adjvalue;  
+  /** diagonal of the Newton matrix I - gamma*[-df/dx]^T for the
+      preconditioner of the adjoint Krylov solver, allocated on its
+      first use */
+  double *adjPrecond;
  
   /* for computing vector_v using discrete observation data */
   int TimeSeriesIndex;
+  /** interpolation state for continuous observation data */
+  ts_cursor_t *TimeSeriesCursor;
 
   /* Fisher Information Matrix */
 
   double** FIM;
   double* weights; /* for the inner product defining the entries of the FIM */
 
+  /** threads and chunks for the evaluation of very large models,
+      NULL for serial evaluation, see CvodeSettings_setThreads */
+  threadPool_t *pool;
+  odePartition_t *partition;
+
 } ;
 
 /** Stores CVODE specific integration results, data correspond
@@ -214,6 +230,10 @@ extern "C" {
   SBML_ODESOLVER_API void CvodeResults_computeDirectional(cvodeResults_t *results, const double *dp);
   SBML_ODESOLVER_API void CvodeResults_free(cvodeResults_t *);
 
+  /* observation data and objective, also called from compiled code */
+  SBML_ODESOLVER_API double CvodeData_getTimeSeriesValue(cvodeData_t *, int);
+  SBML_ODESOLVER_API void CvodeData_addVectorV(cvodeData_t *, double *, double);
+
 #ifdef __cplusplus
 }
 #endif
@@ -224,6 +244,8 @@ cvodeResults_t *CvodeResults_create(cvodeData_t *, int);
 int CvodeResults_allocateSens(cvodeResults_t *, int neq, int nsens, int nout);
 int CvodeData_initializeSensitivities(cvodeData_t *,cvodeSettings_t *,
 				      odeModel_t *, odeSense_t *);
+double CvodeData_evaluateObjective(cvodeData_t *);
+void CvodeData_scheduleEvents(cvodeData_t *);
 
 #endif
 
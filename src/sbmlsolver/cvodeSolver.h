@@ -56,9 +56,11 @@ extern "C" {
 
   /* internal functions that are not part of the API (yet?) */
   int IntegratorInstance_createCVODESolverStructures(integratorInstance_t *);
+  CVRhsFn IntegratorInstance_getRHSFunction(integratorInstance_t *);
   void IntegratorInstance_freeCVODESolverStructures(integratorInstance_t *);
   void IntegratorInstance_freeForwardSensitivity(integratorInstance_t *);
   void IntegratorInstance_freeAdjointSensitivity(integratorInstance_t *);
+  double IntegratorInstance_getCheckpointMemory(const integratorInstance_t *, int ncheck, int nd, int interpolation);
   int check_flag(void *flagvalue, const char *funcname, int opt);
   
 #ifdef __cplusplus
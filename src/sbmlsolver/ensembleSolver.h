@@ -0,0 +1,88 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_ENSEMBLESOLVER_H_
+#define SBMLSOLVER_ENSEMBLESOLVER_H_
+
+#include <stdio.h>
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/odeModel.h>
+#include <sbmlsolver/cvodeData.h>
+#include <sbmlsolver/integratorSettings.h>
+#include <sbmlsolver/rkSolver.h>
+
+/** number of lanes used by the ensemble batch functions, a multiple
+    of the vector width of AVX-512 */
+#define ENSEMBLE_LANES 8
+
+typedef struct ensembleSolver ensembleSolver_t;
+
+/** An ensemble of W integration runs of the same model with
+    different values (lanes), integrated in lockstep.  Values and
+    solution vectors are stored lane-contiguous: the value of variable
+    i in lane l is found at position W*i+l */
+struct ensembleSolver
+{
+  odeModel_t *om;       /**< the model */
+  cvodeSettings_t *opt; /**< integration settings, owned by the caller */
+  cvodeData_t *data;    /**< work data of the interpreted functions */
+  int nlanes;           /**< number of lanes W */
+  int neq;              /**< number of ODEs */
+  int nvalues;          /**< number of values */
+  double *initialValue; /**< initial values of the model, nvalues */
+  double *value;        /**< values of all lanes, nvalues*W */
+  rkSolver_t *rk;       /**< the built-in RK45 solver of all lanes,
+			   with the ODE variables at time t, neq*W */
+  double t;             /**< current time */
+  int iout;             /**< output step counter */
+  cvodeResults_t **results; /**< results of the lanes */
+  EnsembleRhsFn rhs;    /**< compiled ODEs, NULL if interpreted */
+  EnsembleAssignmentFn assignment; /**< compiled assignments, NULL if
+				      interpreted */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* ENSEMBLE INTEGRATION OF SEVERAL PARAMETER SETS */
+  SBML_ODESOLVER_API ensembleSolver_t *EnsembleSolver_create(odeModel_t *, cvodeSettings_t *, int nlanes);
+  SBML_ODESOLVER_API int EnsembleSolver_setValue(ensembleSolver_t *, variableIndex_t *, int lane, double);
+  SBML_ODESOLVER_API double EnsembleSolver_getValue(const ensembleSolver_t *, variableIndex_t *, int lane);
+  SBML_ODESOLVER_API int EnsembleSolver_integrate(ensembleSolver_t *);
+  SBML_ODESOLVER_API void EnsembleSolver_reset(ensembleSolver_t *);
+  SBML_ODESOLVER_API const cvodeResults_t *EnsembleSolver_getResults(const ensembleSolver_t *, int lane);
+  SBML_ODESOLVER_API void EnsembleSolver_printStatistics(const ensembleSolver_t *, FILE *);
+  SBML_ODESOLVER_API void EnsembleSolver_free(ensembleSolver_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
@@ -0,0 +1,49 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* 
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ */
+
+#ifndef SBMLSOLVER_EVENTQUEUE_H_
+#define SBMLSOLVER_EVENTQUEUE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct eventQueue eventQueue_t;
+
+  eventQueue_t *EventQueue_create(void);
+  void EventQueue_free(eventQueue_t *);
+  void EventQueue_clear(eventQueue_t *);
+  void EventQueue_push(eventQueue_t *, double time, int event);
+  void EventQueue_pop(eventQueue_t *);
+  int EventQueue_isEmpty(const eventQueue_t *);
+  int EventQueue_getSize(const eventQueue_t *);
+  double EventQueue_getTime(const eventQueue_t *);
+  int EventQueue_getEvent(const eventQueue_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
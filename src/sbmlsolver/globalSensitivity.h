@@ -0,0 +1,88 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_GLOBALSENSITIVITY_H_
+#define SBMLSOLVER_GLOBALSENSITIVITY_H_
+
+#include <sbml/SBMLTypes.h>
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+#include <sbmlsolver/odeSolver.h>
+
+/** Output of a design point used for variance-based sensitivity
+    indices, taken from the time course of each observable */
+enum sobolOutput
+{
+  SOBOL_FINAL = 0,  /**< value at the end time */
+  SOBOL_MIN,        /**< minimum over the output times */
+  SOBOL_MAX         /**< maximum over the output times */
+};
+
+typedef struct sobolIndices sobolIndices_t;
+
+/** Accumulated estimators of first order and total Sobol indices of
+    nrparams parameters for nobs outputs, from a Saltelli design */
+struct sobolIndices
+{
+  int nrparams;     /**< number of parameters k */
+  int nobs;         /**< number of outputs */
+  int nsamples;     /**< number of accumulated base samples N */
+  int nskipped;     /**< base samples skipped, because the
+		       integration of a design point failed */
+  double *mean;     /**< running mean of the outputs of A and B */
+  double *m2;       /**< running sum of squared deviations from mean */
+  double **first;   /**< sums of f_B (f_ABi - f_A), nrparams x nobs */
+  double **total;   /**< sums of (f_A - f_ABi)^2, nrparams x nobs */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* DESIGNS FOR GLOBAL SENSITIVITY ANALYSIS */
+  SBML_ODESOLVER_API int VarySettings_setLatinHypercube(varySettings_t *, const double *lower, const double *upper, const int *logscale, unsigned long seed);
+  SBML_ODESOLVER_API int VarySettings_setSaltelliDesign(varySettings_t *, const double *lower, const double *upper, const int *logscale, unsigned long seed);
+
+  /* VARIANCE-BASED SENSITIVITY INDICES */
+  SBML_ODESOLVER_API sobolIndices_t *SobolIndices_create(int nrparams, int nobs);
+  SBML_ODESOLVER_API void SobolIndices_addSample(sobolIndices_t *, const double *fA, const double *fB, double **fAB);
+  SBML_ODESOLVER_API int SobolIndices_getNumSamples(const sobolIndices_t *);
+  SBML_ODESOLVER_API double SobolIndices_getVariance(const sobolIndices_t *, int obs);
+  SBML_ODESOLVER_API double SobolIndices_getFirstOrder(const sobolIndices_t *, int param, int obs);
+  SBML_ODESOLVER_API double SobolIndices_getTotal(const sobolIndices_t *, int param, int obs);
+  SBML_ODESOLVER_API void SobolIndices_free(sobolIndices_t *);
+
+  SBML_ODESOLVER_API int IntegratorInstance_sobolIndices(integratorInstance_t *, int nrparams, variableIndex_t **vi, int nrdesignpoints, double **params, int nobs, variableIndex_t **observable, int output, int nworkers, sobolIndices_t *);
+  SBML_ODESOLVER_API sobolIndices_t *Model_sobolIndices(Model_t *, cvodeSettings_t *, varySettings_t *, int nobs, char **observables, int output, int nworkers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
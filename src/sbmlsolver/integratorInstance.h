@@ -38,6 +38,8 @@
 #define SBMLSOLVER_INTEGRATORINSTANCE_H_
 
 typedef struct cvodeSolver cvodeSolver_t;
+typedef struct rkSolver rkSolver_t;
+typedef struct nullSolver nullSolver_t;
 typedef struct integratorInstance integratorInstance_t ;
 
 #include <sbmlsolver/exportdefs.h>
@@ -64,6 +66,24 @@ struct cvodeSolver
     N_Vector q;       /**< quadrature of integral functional for x(t) */ 
 
     void *cvode_mem;  /**< pointer to the CVode Solver structure */    
+    int method;       /**< method of cvode_mem: BDF (0) or
+			 ADAMS-MOULTON (1) */
+    int iteration;    /**< iteration of cvode_mem: CV_NEWTON or
+			 CV_FUNCTIONAL */
+    int stiff;        /**< automatic method switching: the problem is
+			 currently considered stiff (use BDF) */
+    int nswitch;      /**< number of automatic method switches */
+    long int nstCheck, ncfnCheck; /**< step and convergence failure
+				     counters at the last stiffness check */
+    realtype hAdams;  /**< last step size before switching to BDF */
+    realtype hin;     /**< initial step size for the next solver
+			 (re)initialization, 0 for an estimate */
+    int statsRun;     /**< run of the per-method statistics */
+    long int methodStats[2][6]; /**< nst, nfe, nni, ncfn, netf and nje
+				   of former CVODES memories of this run,
+				   per method */
+    int nroots;       /**< number of active root functions, i.e.
+			 piecewise conditions located by CVODES */
     int nsens;        /**< number of requested sensitivities */
     N_Vector *yS;     /**< the sensitivities matrix, dx(t)/dp ! */    
     N_Vector senstol; /**< absolute tolerance for sensitivity error control */
@@ -77,9 +97,17 @@ struct cvodeSolver
     realtype reltolA, reltolQA;
     N_Vector abstolA, abstolQA; 
     N_Vector qA;
+    int nSaveSteps;   /**< steps between two checkpoints of the forward
+			 phase */
+    int interpolation;/**< interpolation type of the forward phase:
+			 CV_HERMITE or CV_POLYNOMIAL */
+    long int nstF;    /**< number of steps of the last forward phase */
     /** FIM */
     N_Vector qFIM;    /** quadrature for Fisher Information Matrix: < yS_i , yS_j > */
 
+    rkSolver_t *rk;   /**< built-in Runge-Kutta and Rosenbrock solvers */
+    nullSolver_t *ns; /**< steady state solver */
+
 };
 
 
@@ -214,5 +242,14 @@ int IntegratorInstance_updateData(integratorInstance_t *);
    specific ...OneStep functions */
 int IntegratorInstance_updateAdjData(integratorInstance_t *);
 
+/* event trigger evaluation and assignments at the current time, as
+   done by IntegratorInstance_updateData; for solvers that stop at
+   the firing times of time-only triggers between output times */
+int IntegratorInstance_handleEvents(integratorInstance_t *);
+
+/* the next firing time of a time-only event trigger ahead of the
+   current time, returns 0 if there is none */
+int IntegratorInstance_getNextEventTime(integratorInstance_t *, double *);
+
 
 #endif
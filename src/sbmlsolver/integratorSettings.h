@@ -76,13 +76,18 @@ typedef struct cvodeSettings cvodeSettings_t;
 			        (i.e., a recoverable error)
 			        if negative state inputs are encountered */
     int CvodeMethod;      /**< set ADAMS-MOULTON (1) or BDF (0)
-			     nonlinear solver */
+			     nonlinear solver, or switch automatically
+			     between them (2), or use the built-in RK45 (3)
+			     or Rosenbrock (4) solvers */
     int IterMethod;       /**< set type of nonlinear solver iteration
 			     Newton (0) or Functional (1) */
     int MaxOrder;         /**< set maximum order of ADAMS or BDF method */
     int ResetCvodeOnEvent; /**< restart CVODE when event is triggered */
     int SetTStop;          /**< runs CVODES with TSTOP, save mode for using
 			      IntegratorInstance_setVariableValue */
+    int DenseOutput;       /**< if not 0: CVODES takes its internal steps
+			      independently of output times, values at
+			      output times are interpolated */
     
     int Sensitivity;      /**< if not 0: use CVODES for sensitivity analysis */
     char **sensIDs;       /**< ID's for parameters and initial conditions 
@@ -105,6 +110,10 @@ typedef struct cvodeSettings cvodeSettings_t;
 
     int compileFunctions ;  /**< if 1 use compiled functions for ODE,
 			       Jacobian and events */
+    int nthreads;         /**< threads evaluating the ODEs, Jacobian and
+			     vector operations of CVODES: 0 or 1 for
+			     serial evaluation, < 0 for one thread per
+			     processor */
 
     /* ADJOINT */
     int observation_data_type;    /**< 0: continuous data observed
@@ -129,6 +138,13 @@ typedef struct cvodeSettings cvodeSettings_t;
 				AdjTime and AdjPrintSteps */
 
     int nSaveSteps;           /**< Number of steps saved in forward phase  */
+    double AdjMemory;         /**< memory budget in bytes for checkpoints
+				 and interpolation data of the forward
+				 phase, 0 to use nSaveSteps */
+    int AdjExpectedSteps;     /**< expected number of forward steps for
+				 the memory budget, 0 for an estimate */
+    int AdjLinearSolver;      /**< linear solver of the backward phase:
+				 0: dense, 1: matrix-free Krylov (SPGMR) */
     int ncheck;              /**< Number of checkpoints, as returned by
 				CvodeF */
 
@@ -191,7 +207,9 @@ extern "C" {
   SBML_ODESOLVER_API void CvodeSettings_setMxstep(cvodeSettings_t *, int);
   SBML_ODESOLVER_API void CvodeSettings_setDetectNegState(cvodeSettings_t *, int);
   SBML_ODESOLVER_API void CvodeSettings_setTStop(cvodeSettings_t *, int);
+  SBML_ODESOLVER_API void CvodeSettings_setDenseOutput(cvodeSettings_t *, int);
   SBML_ODESOLVER_API void CvodeSettings_setCompileFunctions(cvodeSettings_t *, int);
+  SBML_ODESOLVER_API void CvodeSettings_setThreads(cvodeSettings_t *, int);
 
   /* Adjoint setttings */
   SBML_ODESOLVER_API void CvodeSettings_setDoAdj(cvodeSettings_t *);
@@ -200,6 +218,8 @@ extern "C" {
   SBML_ODESOLVER_API void CvodeSettings_setAdjError(cvodeSettings_t *, double);
   SBML_ODESOLVER_API void CvodeSettings_setAdjRError(cvodeSettings_t *, double);
   SBML_ODESOLVER_API void CvodeSettings_setnSaveSteps(cvodeSettings_t *, int);
+  SBML_ODESOLVER_API void CvodeSettings_setAdjMemory(cvodeSettings_t *, double, int);
+  SBML_ODESOLVER_API void CvodeSettings_setAdjLinearSolver(cvodeSettings_t *, int);
   SBML_ODESOLVER_API int CvodeSettings_setAdjTime(cvodeSettings_t *, double EndTime, int PrintStep);
   SBML_ODESOLVER_API  int CvodeSettings_setAdjTimeSeries(cvodeSettings_t *set, double *timeseries, int AdjPrintStep, double EndTime);
 
@@ -233,7 +253,11 @@ extern "C" {
   SBML_ODESOLVER_API const char *CvodeSettings_getIterMethod(const cvodeSettings_t *);
   SBML_ODESOLVER_API int CvodeSettings_getMaxOrder(cvodeSettings_t *);
   SBML_ODESOLVER_API int CvodeSettings_getCompileFunctions(cvodeSettings_t *);
+  SBML_ODESOLVER_API int CvodeSettings_getThreads(cvodeSettings_t *);
   SBML_ODESOLVER_API int CvodeSettings_getResetCvodeOnEvent(cvodeSettings_t *);
+  SBML_ODESOLVER_API int CvodeSettings_getDenseOutput(cvodeSettings_t *);
+  SBML_ODESOLVER_API double CvodeSettings_getAdjMemory(cvodeSettings_t *);
+  SBML_ODESOLVER_API const char *CvodeSettings_getAdjLinearSolver(const cvodeSettings_t *);
 
   SBML_ODESOLVER_API int CvodeSettings_getJacobian(cvodeSettings_t *);
   SBML_ODESOLVER_API int CvodeSettings_getIndefinitely(cvodeSettings_t *);
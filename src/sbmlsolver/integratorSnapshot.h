@@ -0,0 +1,92 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_INTEGRATORSNAPSHOT_H_
+#define SBMLSOLVER_INTEGRATORSNAPSHOT_H_
+
+#include <stdio.h>
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+
+typedef struct integratorSnapshot integratorSnapshot_t;
+
+/** The state of an integratorInstance at some time of a forward
+    run, which can be restored into an integratorInstance of the
+    same model */
+struct integratorSnapshot
+{
+  odeModel_t *om;       /**< the model of the captured instance, NULL
+			   for snapshots read from a file */
+  int neq;              /**< number of ODEs */
+  int nvalues;          /**< number of values */
+  int nsens;            /**< number of sensitivities, 0 if sensitivity
+			   analysis was off */
+  int nevents;          /**< number of events */
+  int quadrature;       /**< the active quadrature: none (0), objective
+			   function q (1), linear objective qS (2) or
+			   FIM qFIM (3) */
+  int nq;               /**< length of q */
+  int nfim;             /**< dimension of FIM, 0 if not available */
+
+  double t;             /**< current time */
+  double tout;          /**< next output time */
+  int iout;             /**< output step counter */
+  double *value;        /**< all values: variables x(t) and parameters */
+  double *sensitivity;  /**< sensitivities dx(t)/dp, neq rows of
+			   nsens values */
+  double *q;            /**< quadratures */
+  double *FIM;          /**< Fisher Information Matrix from discrete
+			   observation data, nfim rows of nfim values */
+  int *trigger;         /**< event trigger flags */
+  int steadystate;      /**< steady state flag */
+
+  double h;             /**< step size for the next step */
+  int order;            /**< method order of the last step, 0 for the
+			   built-in solvers */
+  int stiff;            /**< automatic method switching: stiff phase */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* SNAPSHOTS OF THE INTEGRATOR STATE */
+  SBML_ODESOLVER_API integratorSnapshot_t *IntegratorInstance_snapshot(integratorInstance_t *);
+  SBML_ODESOLVER_API int IntegratorInstance_restore(integratorInstance_t *, const integratorSnapshot_t *);
+  SBML_ODESOLVER_API integratorInstance_t *IntegratorInstance_fork(integratorInstance_t *);
+  SBML_ODESOLVER_API double IntegratorSnapshot_getTime(const integratorSnapshot_t *);
+  SBML_ODESOLVER_API int IntegratorSnapshot_write(const integratorSnapshot_t *, FILE *);
+  SBML_ODESOLVER_API integratorSnapshot_t *IntegratorSnapshot_read(FILE *);
+  SBML_ODESOLVER_API void IntegratorSnapshot_free(integratorSnapshot_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
@@ -38,6 +38,7 @@
 #define SBMLSOLVER_INTERPOL_H_
 
 typedef struct ts time_series_t;
+typedef struct ts_cursor ts_cursor_t;
 
   /** Stores Interpolation Data */
   struct ts {
@@ -56,6 +57,23 @@ typedef struct ts time_series_t;
 
     char   **mess;  /**< list of warning messages */
     int    *warn;   /**< number of warnings */
+
+    int    n_spline;   /**< number of variables with spline coefficients */
+    int    *spline_var; /**< indices of these variables */
+    double *coeff;  /**< cubic coefficients a, b, c, d of the spline
+		       a + b h + c h^2 + d h^3, h = x - time[k], for
+		       interval k and variable spline_var[v] stored at
+		       coeff[4*(k*n_spline + v)] */
+  } ;
+
+  /** Interpolation state of one integrator for a shared time series */
+  struct ts_cursor {
+    time_series_t *ts; /**< interpolated time series */
+    int    last;    /**< current interpolation interval */
+    int    valid;   /**< 1 if value holds the interpolation at t */
+    double t;       /**< time of the interpolated values */
+    double *value;  /**< interpolated values for all variables at t */
+    int    warn[2]; /**< number of out of range warnings */
   } ;
 
 
@@ -73,9 +91,19 @@ extern "C" {
   void test_interpol(time_series_t *ts);
 
   time_series_t *read_data(const char *file, int num, char **var);
+  time_series_t *read_data_cached(const char *file, const char *cache,
+				  int num, char **var);
+  int write_data_cache(const time_series_t *ts, const char *file,
+		       const char *cache);
 
   double call(int i, double x, time_series_t *ts);
 
+  int spline_coefficients(time_series_t *ts);
+  ts_cursor_t *create_cursor(time_series_t *ts);
+  void free_cursor(ts_cursor_t *c);
+  void call_all(double x, ts_cursor_t *c);
+  double call_cursor(int i, double x, ts_cursor_t *c);
+
   int spline(int n, const double *x, const double *y, double *y2);
   void splint(int n, const double *x, const double *y, const double *y2,
 	      double x_, double *y_, int *j);
@@ -0,0 +1,103 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_MULTIPLESHOOTING_H_
+#define SBMLSOLVER_MULTIPLESHOOTING_H_
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+
+typedef struct shootingSegment shootingSegment_t;
+typedef struct multipleShooting multipleShooting_t;
+
+/** A segment of the time horizon between two data time points,
+    integrated by its own integratorInstance from its own initial
+    state */
+struct shootingSegment
+{
+  integratorInstance_t *ii; /**< the integrator of this segment */
+  cvodeSettings_t *opt; /**< its settings: data time points and
+			   sensitivities */
+  double t0;            /**< initial time */
+  double t1;            /**< end time, a data time point */
+  int first;            /**< first data time point of the segment */
+  int last;             /**< last data time point, at t1 */
+  int completed;        /**< 1 if the last integration was successful */
+  double *x0;           /**< initial state, neq values, the model
+			   values for the first segment */
+  int nres;             /**< number of data residuals */
+  double *residual;     /**< weighted data residuals */
+  double *dRdp;         /**< their derivatives with respect to the
+			   parameters, nres rows of nrparams values */
+  double *dRdx;         /**< with respect to x0, nres rows of neq
+			   values, NULL for the first segment */
+  double *continuity;   /**< x(t1) minus x0 of the next segment, NULL
+			   for the last segment */
+  double *dCdp;         /**< derivatives of the continuity residuals
+			   with respect to the parameters, neq rows of
+			   nrparams values */
+  double *dCdx;         /**< with respect to x0, neq rows of neq values,
+			   NULL for the first segment */
+};
+
+/** Multiple shooting of the time series data of an odeModel: the
+    unknowns are the nrparams parameters followed by the initial
+    states of all but the first segment */
+struct multipleShooting
+{
+  odeModel_t *om;       /**< the shared odeModel */
+  int neq;              /**< number of ODEs */
+  int nrparams;         /**< number of parameters */
+  variableIndex_t **vi; /**< the parameters */
+  double *p;            /**< current parameter values */
+  double *weight;       /**< square roots of the weights of the ODE
+			   variables */
+  int nsegments;        /**< number of segments */
+  shootingSegment_t *segment; /**< the segments */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* MULTIPLE SHOOTING */
+  SBML_ODESOLVER_API multipleShooting_t *IntegratorInstance_createMultipleShooting(integratorInstance_t *, int nrparams, char **ids, int nsegments);
+  SBML_ODESOLVER_API int MultipleShooting_setParameters(multipleShooting_t *, const double *);
+  SBML_ODESOLVER_API int MultipleShooting_setState(multipleShooting_t *, int segment, const double *);
+  SBML_ODESOLVER_API int MultipleShooting_integrate(multipleShooting_t *, int nthreads);
+  SBML_ODESOLVER_API int MultipleShooting_getNumUnknowns(const multipleShooting_t *);
+  SBML_ODESOLVER_API int MultipleShooting_getNumResiduals(const multipleShooting_t *);
+  SBML_ODESOLVER_API void MultipleShooting_getResiduals(const multipleShooting_t *, double *);
+  SBML_ODESOLVER_API void MultipleShooting_getJacobian(const multipleShooting_t *, double *);
+  SBML_ODESOLVER_API void MultipleShooting_free(multipleShooting_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
@@ -37,15 +37,57 @@
 #ifndef SBMLSOLVER_NULLSOLVER_H_
 #define SBMLSOLVER_NULLSOLVER_H_
 
+#include <stdio.h>
+
 #include <sbmlsolver/exportdefs.h>
 #include <sbmlsolver/integratorInstance.h>
+#include <sbmlsolver/variableIndex.h>
+
+/** State of the steady state solver, all vectors are plain arrays of
+    length neq */
+struct nullSolver
+{
+  int neq;          /**< number of ODEs */
+  /** CONSERVATION LAWS c_k * x = total_k, each replaces the ODE of
+      one species, which is otherwise linearly dependent on the others
+      and makes the Jacobian matrix singular */
+  int ncons;        /**< number of conservation laws */
+  realtype **cons;  /**< cons[k][i]: coefficient of x_i in law k, with
+		       cons[k][dep[k]] = 1 */
+  int *dep;         /**< dep[k]: species whose ODE is replaced by law k */
+  int *law;         /**< law[i]: law replacing the ODE of x_i, or -1 */
+  realtype *total;  /**< conserved totals of the initial values */
+  realtype *x0;     /**< initial values */
+  realtype *x;      /**< Newton iterate, the steady state on success */
+  realtype *xp;     /**< pseudo-transient continuation iterate */
+  realtype *f;      /**< residual at x */
+  realtype *dx;     /**< Newton step */
+  realtype *xtrial; /**< trial iterate of the line search */
+  realtype *ftrial; /**< residual at xtrial */
+  realtype **J;     /**< Jacobian matrix, column-wise, and its LU factors */
+  int *pivot;       /**< pivots of the LU factorization */
+  realtype **S;     /**< ODE values at sample points, to find the
+		       conservation laws */
+  CVRhsFn rhs;      /**< RHS function, interpreted or compiled */
+  N_Vector yv, fv;  /**< N_Vector headers for the RHS function,
+		       pointing into the arrays above */
+  /** statistics of the last call */
+  int method;       /**< 0: failed, 1: Newton, 2: pseudo-transient
+		       continuation */
+  realtype residual; /**< max |dx/dt| at the solution */
+  long int nni, nfe, nje, nbt, nptc;
+};
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-  /* KINSOL SOLVER */
+  /* STEADY STATE SOLVER */
   SBML_ODESOLVER_API int IntegratorInstance_nullSolver(integratorInstance_t *);
+  SBML_ODESOLVER_API int IntegratorInstance_nullSolverBatch(integratorInstance_t *, int nrparams, variableIndex_t **, int nrdesignpoints, double **params, double **x, int *converged);
+  SBML_ODESOLVER_API int IntegratorInstance_steadyStateSensitivity(integratorInstance_t *);
+  SBML_ODESOLVER_API int IntegratorInstance_getNumConservationLaws(const integratorInstance_t *);
+  SBML_ODESOLVER_API void IntegratorInstance_printNullSolverStatistics(const integratorInstance_t *, FILE *f);
   SBML_ODESOLVER_API void IntegratorInstance_printKINSOLStatistics(integratorInstance_t *, FILE *f);
 
 #ifdef __cplusplus
@@ -53,8 +95,12 @@ extern "C" {
 #endif
 
 /* internal functions that are not part of the API (yet?) */
-int IntegratorInstance_createKINSolverStructures(integratorInstance_t *);
-void IntegratorInstance_freeKINSolverStructures(integratorInstance_t *);
+int IntegratorInstance_createNullSolverStructures(integratorInstance_t *);
+void IntegratorInstance_freeNullSolverStructures(integratorInstance_t *);
+int IntegratorInstance_nsRhs(nullSolver_t *, cvodeData_t *,
+			     realtype *x, realtype *f);
+int IntegratorInstance_nsJacobian(integratorInstance_t *,
+				  realtype *x, realtype *f, int reduce);
   
 #endif
 
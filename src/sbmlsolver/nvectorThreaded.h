@@ -0,0 +1,71 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_NVECTORTHREADED_H_
+#define SBMLSOLVER_NVECTORTHREADED_H_
+
+#include <sundials/sundials_nvector.h>
+#include <nvector/nvector_serial.h>
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/threadPool.h>
+
+/** The content of a threaded N_Vector: the content of a serial
+    N_Vector, followed by the thread pool of its operations, such
+    that the serial accessor macros NV_DATA_S and NV_LENGTH_S and the
+    serial functions apply to threaded N_Vectors */
+struct _N_VectorContent_Threaded
+{
+  long int length;      /**< vector length */
+  booleantype own_data; /**< data is freed with the vector */
+  realtype *data;       /**< vector data */
+  threadPool_t *pool;   /**< threads of the vector operations, not
+			   owned by the vector */
+};
+
+typedef struct _N_VectorContent_Threaded *N_VectorContent_Threaded;
+
+#define NV_POOL_T(v) ( ((N_VectorContent_Threaded)(v)->content)->pool )
+
+/** Vectors shorter than this are operated on serially */
+#define NVECTOR_THREADED_MIN_LENGTH 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* THREADED N_VECTOR */
+  SBML_ODESOLVER_API N_Vector N_VNewEmpty_Threaded(long int length, threadPool_t *);
+  SBML_ODESOLVER_API N_Vector N_VNew_Threaded(long int length, threadPool_t *);
+  SBML_ODESOLVER_API N_Vector N_VMake_Threaded(long int length, realtype *data, threadPool_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
@@ -40,13 +40,51 @@
 typedef struct odeModel odeModel_t;
 typedef struct odeSense odeSense_t;
 typedef struct nonzeroElem nonzeroElem_t;
+typedef struct odePartition odePartition_t;
 typedef int (*EventFn)(void *, int *); /* RM: replaced cvodeData_t
 					    pointer with void pointer
 					    because of dependency
 					    problems */
+/* signatures of compiled assignment rule, steady state and objective
+   function code, see EventFn for the void pointer */
+typedef void (*AssignmentFn)(void *);
+typedef void (*SteadyStateFn)(void *, double *);
+typedef double (*ObjectiveFn)(void *);
+typedef void (*VectorVFn)(void *, double *, double);
+/* signatures of the compiled ensemble code, which evaluates the ODEs
+   f(t, y) and the assignment rules of W lanes at once, see
+   ensembleSolver.h */
+typedef void (*EnsembleRhsFn)(int W, double t, void *, double *value,
+			      const double *y, double *dy);
+typedef void (*EnsembleAssignmentFn)(int W, void *, double *value);
+/* signature of the compiled propensity of reaction j of the
+   stochastic solver, see stochasticSolver.h */
+typedef double (*StochasticPropensityFn)(void *, int j);
+/* signatures of the compiled chunks of a partitioned model, which
+   write into value and dydata, and entry (i,j) of the Jacobian into
+   column jac[j], see odePartition.h */
+typedef void (*PartitionRuleFn)(void *, double *value);
+typedef void (*PartitionOdeFn)(void *, double *value, double *dydata);
+typedef void (*PartitionJacobianFn)(void *, double *value, double **jac);
+
+/** kinds of generated code, each compiled with its own optimization
+    level, see ODEModel_setCompileOptimization */
+enum compileKind
+  {
+    COMPILE_MAIN,        /**< events, assignment rules, IDA */
+    COMPILE_RHS,         /**< ODE right hand side */
+    COMPILE_JACOBIAN,    /**< Jacobian matrix */
+    COMPILE_ADJOINT,     /**< adjoint right hand side and Jacobian */
+    COMPILE_SENSITIVITY, /**< sensitivity and adjoint quadrature */
+    COMPILE_NKINDS
+  } ;
+typedef enum compileKind compileKind_t;
 
 #include <cvodes/cvodes.h>
 #include <cvodes/cvodes_dense.h>
+#include <cvodes/cvodes_spils.h>
+#include <ida/ida.h>
+#include <ida/ida_dense.h>
 #include <sbml/SBMLTypes.h>
 
 #include <sbmlsolver/exportdefs.h>
@@ -125,6 +163,13 @@ struct odeModel
       the next requested timestep */
     
   int npiecewise;  /**< number of piecewise expression in equations */
+  /** ROOTS: relational piecewise conditions a op b in ODEs and
+      assignment rules, as CVODES root functions g = a - b; CVODES
+      then locates the switching times and only falls back to TSTOP
+      mode if some condition could not be expressed this way */
+  int nroots;      /**< number of root functions */
+  ASTNode_t **root;
+  int npiecewiseUnrooted; /**< number of conditions without root function */
 
   /** INITIAL ASSIGNMENTS: only evaluated at time <= 0, only
       ODE variables and constants can be affected */
@@ -143,6 +188,12 @@ struct odeModel
   int **eventIndex;  /**< index map from event assignments to om->names */
   ASTNode_t ***eventAssignment;
   directCode_t ***eventAssignmentcode;
+  /** time-only triggers time >= e (or e <= time), where e depends
+      only on constants that are not changed by events; their firing
+      times can be scheduled in advance */
+  int ntimedEvents;  /**< number of time-only triggers */
+  int *eventTimeChild; /**< child of the trigger holding e, -1 if the
+			  trigger is not time-only */
   /** topological order of event assignments incl. other assignments */
   nonzeroElem_t **eventAssignmentOrder; /* size : nIass + nass */
  
@@ -185,6 +236,31 @@ struct odeModel
   CVDlsDenseJacFnB compiledCVODEAdjointJacobianFunction;
   /* remember which function is used (compiled or hard-coded) */
   CVDlsDenseJacFnB current_AdjJAC;
+  /** CVODE adjoint jacobian times vector function for the Krylov
+      solver of the backward phase, created by compiling code
+      generated from model */
+  CVSpilsJacTimesVecFnB compiledCVODEAdjointJacobianTimesVectorFunction;
+
+  /* compilation of the remaining evaluations */
+  /** all assignment rules, in assignmentOrder */
+  AssignmentFn compiledAssignmentFunction;
+  /** assignment rules required before ODE evaluation,
+      assignmentsBeforeODEs */
+  AssignmentFn compiledAssignmentsBeforeODEsFunction;
+  /** sums of |f|, f and f^2 over the ODEs, for steady state detection */
+  SteadyStateFn compiledSteadyStateFunction;
+  /** IDA residual function and its Jacobian */
+  IDAResFn compiledIDAResidualFunction;
+  IDADlsDenseJacFn compiledIDAJacobianFunction;
+
+  /** large function bodies are split into helper functions of at
+      most compileChunkSize statements, which are spread over several
+      source files that are compiled in parallel; 0 disables splitting */
+  int compileChunkSize;
+  /** optimization level (0-3) for each compileKind_t */
+  int compileOptimization[COMPILE_NKINDS];
+  /** compiler used for the generated code */
+  compilerBackend_t compileBackend;
     
 
   /* ADJOINT */
@@ -209,6 +285,36 @@ struct odeModel
 			       objective used in sensitivity solvers */
   ASTNode_t *ObjectiveFunction;  /**< expression for a general (nonlinear)
 				    objective function */
+
+  /** compiled code containing the objective function and vector v;
+      compiled separately from the model code as both can be set
+      after the model code has been compiled */
+  compiled_code_t *compiledObjectiveCode;
+  /** flag that indicates whether compilation is required, upon first
+      request or when the objective function or vector v has changed */
+  int recompileObjective;
+  /** objective function integrand or data point contribution */
+  ObjectiveFn compiledObjectiveFunction;
+  /** adds scale * vector v to an array of size neq */
+  VectorVFn compiledVectorVFunction;
+
+  /** compiled code of the ensemble solver, which evaluates the model
+      for W parameter sets in lanes; compiled separately upon first
+      request */
+  compiled_code_t *compiledEnsembleCode;
+  /** ODEs, with the assignment rules they require, of W lanes */
+  EnsembleRhsFn compiledEnsembleRhsFunction;
+  /** all assignment rules of W lanes */
+  EnsembleAssignmentFn compiledEnsembleAssignmentFunction;
+
+  /** compiled code of the stochastic solver, which evaluates the
+      propensities of the reactions; compiled separately upon first
+      request */
+  compiled_code_t *compiledStochasticCode;
+  /** propensity of one reaction */
+  StochasticPropensityFn compiledStochasticPropensityFunction;
+  /** all assignment rules */
+  AssignmentFn compiledStochasticAssignmentFunction;
 };
 
 struct odeSense
@@ -298,6 +404,7 @@ extern "C" {
   /* Topological sorting */
   SBML_ODESOLVER_API int ODEModel_hasCycle(const odeModel_t *);
   SBML_ODESOLVER_API int ODEModel_getNumAssignmentsBeforeODEs(const odeModel_t *);
+  SBML_ODESOLVER_API int ODEModel_getNumRoots(const odeModel_t *);
   SBML_ODESOLVER_API int ODEModel_getNumAssignmentsBeforeEvents(const odeModel_t *);
   SBML_ODESOLVER_API int ODEModel_getNumJacobiElements(const odeModel_t *);
   SBML_ODESOLVER_API const nonzeroElem_t *ODEModel_getAssignmentOrder(odeModel_t *, int);
@@ -353,14 +460,24 @@ extern "C" {
   SBML_ODESOLVER_API const ASTNode_t *ODESense_getSensEntry(const odeSense_t *, const variableIndex_t *, const variableIndex_t *);
 
   /* ODEModel compilation */
+  SBML_ODESOLVER_API void ODEModel_setCompileChunkSize(odeModel_t *, int);
+  SBML_ODESOLVER_API int ODEModel_setCompileOptimization(odeModel_t *, int kind, int level);
+  SBML_ODESOLVER_API int ODEModel_setCompileBackend(odeModel_t *, compilerBackend_t);
   SBML_ODESOLVER_API int ODEModel_compileCVODEFunctions(odeModel_t *);
   SBML_ODESOLVER_API int ODESense_compileCVODESenseFunctions(odeSense_t *);
   SBML_ODESOLVER_API CVRhsFn ODEModel_getCompiledCVODERHSFunction(odeModel_t *);
   SBML_ODESOLVER_API CVDlsDenseJacFn ODEModel_getCompiledCVODEJacobianFunction(odeModel_t *);
   SBML_ODESOLVER_API CVRhsFnB ODEModel_getCompiledCVODEAdjointRHSFunction(odeModel_t *);
   SBML_ODESOLVER_API CVDlsDenseJacFnB ODEModel_getCompiledCVODEAdjointJacobianFunction(odeModel_t *);
+  SBML_ODESOLVER_API CVSpilsJacTimesVecFnB ODEModel_getCompiledCVODEAdjointJacobianTimesVectorFunction(odeModel_t *);
   SBML_ODESOLVER_API CVQuadRhsFnB ODESense_getCompiledCVODEAdjointQuadFunction(odeSense_t *);
   SBML_ODESOLVER_API CVSensRhs1Fn ODESense_getCompiledCVODESenseFunction(odeSense_t *);
+  SBML_ODESOLVER_API int ODEModel_compileObjectiveFunctions(odeModel_t *);
+  SBML_ODESOLVER_API ObjectiveFn ODEModel_getCompiledObjectiveFunction(odeModel_t *);
+  SBML_ODESOLVER_API VectorVFn ODEModel_getCompiledVectorVFunction(odeModel_t *);
+  SBML_ODESOLVER_API int ODEModel_compileEnsembleFunctions(odeModel_t *);
+  SBML_ODESOLVER_API int ODEModel_compileStochasticFunctions(odeModel_t *);
+  SBML_ODESOLVER_API int ODEModel_compilePartitionFunctions(odeModel_t *, odePartition_t *);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,100 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_ODEPARTITION_H_
+#define SBMLSOLVER_ODEPARTITION_H_
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/compiler.h>
+#include <sbmlsolver/cvodeData.h>
+#include <sbmlsolver/threadPool.h>
+
+/* required for realtype */
+#include <sundials/sundials_types.h>
+
+/** Phases of less cost, roughly the number of AST nodes, are
+    evaluated by the calling thread alone */
+#define ODEPARTITION_MIN_COST 2000
+
+/** The assignment rules, ODEs and Jacobian entries of a model divided
+    into contiguous chunks of similar evaluation cost, one per thread
+    of a threadPool.
+
+    The assignment rules evaluated before the ODEs are grouped into
+    levels of rules which only depend on rules of lower levels; the
+    chunks of a level are evaluated at once. */
+struct odePartition
+{
+  odeModel_t *om;         /**< the partitioned model */
+  threadPool_t *pool;     /**< threads evaluating the chunks, not owned
+			     by the partition */
+  int nchunks;            /**< chunks of each phase */
+  int nlevels;            /**< levels of the assignment rules */
+  nonzeroElem_t **rule;   /**< om->assignmentsBeforeODEs ordered by
+			     level */
+  int *ruleBound;         /**< chunk c of level l consists of the rules
+			     ruleBound[l*nchunks+c] to
+			     ruleBound[l*nchunks+c+1]-1 */
+  int *odeBound;          /**< chunk c consists of the ODEs odeBound[c]
+			     to odeBound[c+1]-1 */
+  int jacobian;           /**< 1 if the Jacobian is partitioned, 0 if it
+			     was not available on creation */
+  int *jacobianBound;     /**< chunk c consists of the entries
+			     jacobianBound[c] to jacobianBound[c+1]-1
+			     of om->jacobSparse */
+
+  /** compiled code of the chunks, NULL for evaluation by
+      evaluateAST, see ODEModel_compilePartitionFunctions */
+  compiled_code_t *compiledCode;
+  PartitionRuleFn *compiledRule;         /**< nlevels*nchunks rule chunks */
+  PartitionOdeFn *compiledOde;           /**< nchunks ODE chunks */
+  PartitionJacobianFn *compiledJacobian; /**< nchunks Jacobian chunks */
+
+  /* the current evaluation */
+  cvodeData_t *data;
+  int level;
+  realtype *dydata;
+  realtype **jac;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* PARTITIONED EVALUATION OF LARGE MODELS */
+  SBML_ODESOLVER_API odePartition_t *ODEPartition_create(odeModel_t *, threadPool_t *, double mincost);
+  SBML_ODESOLVER_API void ODEPartition_evaluateRules(odePartition_t *, cvodeData_t *);
+  SBML_ODESOLVER_API void ODEPartition_evaluateODEs(odePartition_t *, cvodeData_t *, realtype *dydata);
+  SBML_ODESOLVER_API void ODEPartition_evaluateJacobian(odePartition_t *, cvodeData_t *, realtype **jacobian);
+  SBML_ODESOLVER_API void ODEPartition_free(odePartition_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
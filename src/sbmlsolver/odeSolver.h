@@ -46,6 +46,7 @@ typedef struct varySettings varySettings_t;
 #include <sbmlsolver/integratorSettings.h>
 #include <sbmlsolver/integratorInstance.h>
 #include <sbmlsolver/sbmlResults.h>
+#include <sbmlsolver/batchStream.h>
 #include <sbmlsolver/exportdefs.h>
 
 
@@ -74,6 +75,9 @@ extern "C" {
   SBML_ODESOLVER_API SBMLResultsArray_t *SBML_odeSolverBatch(SBMLDocument_t *, cvodeSettings_t *, varySettings_t *);
   SBML_ODESOLVER_API SBMLResults_t *Model_odeSolver(Model_t *, cvodeSettings_t *);
   SBML_ODESOLVER_API SBMLResultsArray_t *Model_odeSolverBatch(Model_t *, cvodeSettings_t *, varySettings_t *);
+  SBML_ODESOLVER_API SBMLResultsArray_t *Model_odeSolverEnsemble(Model_t *, cvodeSettings_t *, varySettings_t *);
+  SBML_ODESOLVER_API SBMLResultsArray_t *Model_odeSolverBatchProcesses(Model_t *, cvodeSettings_t *, varySettings_t *, int nworkers, double timeout, int *status);
+  SBML_ODESOLVER_API int Model_odeSolverBatchStream(Model_t *, cvodeSettings_t *, varySettings_t *, int nobs, char **observables, batchCallback_t, void *);
   SBML_ODESOLVER_API SBMLResults_t *SBMLResults_fromIntegrator(Model_t *, integratorInstance_t *);
 
   /* settings for parameter variation batch runs */
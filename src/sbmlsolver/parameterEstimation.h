@@ -0,0 +1,107 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_PARAMETERESTIMATION_H_
+#define SBMLSOLVER_PARAMETERESTIMATION_H_
+
+#include <stdio.h>
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+
+/** Outcome of one start of the parameter estimation */
+enum fitStatus
+{
+  FIT_PENDING = 0,  /**< not run (yet) */
+  FIT_CONVERGED,    /**< the relative decrease of the residual sum of
+		       squares or the step became small */
+  FIT_MAXITER,      /**< the maximum number of iterations was reached */
+  FIT_STALLED,      /**< no decrease was found for the maximal
+		       damping */
+  FIT_FAILED        /**< the integration failed at the start point */
+};
+
+typedef struct fitTrace fitTrace_t;
+typedef struct parameterFit parameterFit_t;
+
+/** The convergence trace of one start of the parameter estimation */
+struct fitTrace
+{
+  int status;       /**< fitStatus of this start */
+  int niter;        /**< number of iterations, i.e. trial steps */
+  int nfail;        /**< trial steps where the integration failed */
+  double *start;    /**< start parameter values */
+  double *p;        /**< final parameter values */
+  double ssr;       /**< final weighted residual sum of squares */
+  double *ssrTrace; /**< residual sum of squares at the start and
+		       after each iteration, niter+1 values */
+  double *lambda;   /**< damping of each iteration, niter values */
+};
+
+/** Result of a least-squares fit of nrparams parameters to the time
+    series data of an odeModel, with the traces of all starts */
+struct parameterFit
+{
+  int nrparams;     /**< number of estimated parameters */
+  char **id;        /**< their IDs */
+  int nres;         /**< number of residuals, i.e. data points */
+  int nstarts;      /**< number of starts */
+  int best;         /**< the start with the lowest residual sum of
+		       squares */
+  double *p;        /**< fitted parameter values of the best start */
+  double ssr;       /**< its weighted residual sum of squares */
+  double sigma2;    /**< residual variance ssr/(nres-nrparams), 1 if
+		       nres <= nrparams or ssr is 0 */
+  double **FIM;     /**< Fisher Information Matrix of the log
+		       parameters at the fit, nrparams x nrparams */
+  double **covariance; /**< covariance of the log parameters, NULL if
+			  the FIM is singular */
+  double *lower;    /**< lower bounds of the 95% confidence intervals */
+  double *upper;    /**< upper bounds of the 95% confidence intervals */
+  fitTrace_t *trace; /**< the traces of all starts */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* LEAST-SQUARES PARAMETER ESTIMATION */
+  SBML_ODESOLVER_API parameterFit_t *IntegratorInstance_fitParameters(integratorInstance_t *, int nrparams, char **ids, const double *lower, const double *upper, int nstarts, int nthreads, unsigned long seed);
+  SBML_ODESOLVER_API double ParameterFit_getValue(const parameterFit_t *, int);
+  SBML_ODESOLVER_API double ParameterFit_getLowerBound(const parameterFit_t *, int);
+  SBML_ODESOLVER_API double ParameterFit_getUpperBound(const parameterFit_t *, int);
+  SBML_ODESOLVER_API double ParameterFit_getSSR(const parameterFit_t *);
+  SBML_ODESOLVER_API double ParameterFit_getFIM(const parameterFit_t *, int, int);
+  SBML_ODESOLVER_API void ParameterFit_print(const parameterFit_t *, FILE *);
+  SBML_ODESOLVER_API void ParameterFit_free(parameterFit_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
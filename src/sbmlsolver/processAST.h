@@ -56,6 +56,7 @@ extern "C" {
   SBML_ODESOLVER_API double evaluateAST(ASTNode_t *n, struct cvodeData *data);
   SBML_ODESOLVER_API void generateMacros(charBuffer_t *buffer);
   SBML_ODESOLVER_API void generateAST(charBuffer_t *buffer, const ASTNode_t *n);
+  SBML_ODESOLVER_API void generateLaneAST(charBuffer_t *buffer, const ASTNode_t *n);
   SBML_ODESOLVER_API ASTNode_t *differentiateAST(ASTNode_t *f, char*x);
   SBML_ODESOLVER_API void setUserDefinedFunction(double(*udf)(char*, int, double*));
   SBML_ODESOLVER_API ASTNode_t *copyAST(const ASTNode_t *f);
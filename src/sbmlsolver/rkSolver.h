@@ -0,0 +1,86 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_RKSOLVER_H_
+#define SBMLSOLVER_RKSOLVER_H_
+
+#include <stdio.h>
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/integratorInstance.h>
+
+/** State of the built-in one-step solvers, all vectors are plain
+    arrays of length nlanes*neq */
+struct rkSolver
+{
+  int neq;          /**< number of ODEs */
+  int nlanes;       /**< RK45: number of systems integrated with a
+		       common step size, stored lane-contiguous (see
+		       ensembleSolver), 1 otherwise */
+  int method;       /**< RK45 (3) or ROSENBROCK (4), see CvodeMethod */
+  realtype h;       /**< step size proposed for the next step */
+  realtype *y;      /**< the solution x(t) at the solver's time */
+  realtype *ynew;   /**< solution of an attempted step */
+  realtype *err;    /**< local error estimate of an attempted step */
+  realtype *k[7];   /**< RK45 stages, k[0] is dx/dt at the solver's
+		       time; Rosenbrock: dx/dt, k1, k2, k3, two further
+		       RHS evaluations and df/dt */
+  int f0Valid;      /**< k[0] is up to date */
+  realtype **J;     /**< Rosenbrock: Jacobian matrix, column-wise */
+  realtype **W;     /**< Rosenbrock: LU factors of I - h*d*J */
+  int *pivot;       /**< Rosenbrock: pivots of the LU factorization */
+  int useJacobian;  /**< Rosenbrock: J from the analytic Jacobian */
+  CVRhsFn rhs;      /**< RHS function, interpreted or compiled */
+  N_Vector yv, fv;  /**< N_Vector headers for the RHS function,
+		       pointing into the arrays above */
+  /** statistics of run number `run' */
+  int run;
+  long int nst, nfe, netf, nje, nlu;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* BUILT-IN RUNGE-KUTTA AND ROSENBROCK SOLVERS */
+  SBML_ODESOLVER_API int IntegratorInstance_rkOneStep(integratorInstance_t *);
+  SBML_ODESOLVER_API void IntegratorInstance_printRKStatistics(const integratorInstance_t *, FILE *f);
+
+  /* internal functions that are not part of the API (yet?) */
+  int IntegratorInstance_useRKSolver(const integratorInstance_t *);
+  int IntegratorInstance_createRKSolverStructures(integratorInstance_t *);
+  void IntegratorInstance_freeRKSolverStructures(integratorInstance_t *);
+  rkSolver_t *RKSolver_create(int neq, int nlanes);
+  int RKSolver_integrateTo(rkSolver_t *, const cvodeSettings_t *, realtype *t, realtype tout, void *fdata);
+  void RKSolver_free(rkSolver_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
@@ -52,6 +52,7 @@ extern "C" {
   SBML_ODESOLVER_API int IntegratorInstance_setObjectiveFunctionFromString(integratorInstance_t *, char *);
 
   SBML_ODESOLVER_API int IntegratorInstance_readTimeSeriesData(integratorInstance_t *, char *);
+  SBML_ODESOLVER_API int IntegratorInstance_readTimeSeriesDataCached(integratorInstance_t *, char *, char *);
   SBML_ODESOLVER_API int IntegratorInstance_CVODEQuad(integratorInstance_t *);
   SBML_ODESOLVER_API int IntegratorInstance_printQuad(integratorInstance_t *, FILE *);
   SBML_ODESOLVER_API int IntegratorInstance_writeQuad(integratorInstance_t *, realtype *);
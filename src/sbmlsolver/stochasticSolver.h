@@ -0,0 +1,116 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_STOCHASTICSOLVER_H_
+#define SBMLSOLVER_STOCHASTICSOLVER_H_
+
+#include <stdio.h>
+
+#include <sbmlsolver/exportdefs.h>
+#include <sbmlsolver/odeModel.h>
+#include <sbmlsolver/cvodeData.h>
+#include <sbmlsolver/integratorSettings.h>
+
+typedef struct stochasticSolver stochasticSolver_t;
+typedef struct stochasticWork stochasticWork_t;
+
+/** Called for each finished trajectory of a stochastic ensemble with
+    the user data passed to the ensemble function; the results are
+    valid during the call only.  The calls are serialized, but the
+    trajectories are passed in no particular order.  The ensemble
+    stops if it returns 0 */
+typedef int (*trajectoryCallback_t)(int trajectory,
+				    const cvodeResults_t *, void *);
+
+/** Stochastic simulation of the reaction network of a model.  The
+    species changed by the reactions are the ODE variables of the
+    model, their amounts are molecule numbers; the values of the
+    variables, as in the deterministic integration, are the molecule
+    numbers divided by the volume of the compartment for species in
+    concentration units */
+struct stochasticSolver
+{
+  odeModel_t *om;       /**< the model */
+  cvodeSettings_t *opt; /**< output times, owned by the caller */
+  cvodeData_t *data;    /**< work data of the calling thread */
+  int neq;              /**< number of species changed by reactions */
+  int nvalues;          /**< number of values */
+  int nreactions;       /**< number of reactions */
+  int *reaction;        /**< index of the assigned variable holding
+			   the kinetic law, i.e. the propensity, of
+			   each reaction */
+  int *changeStart;     /**< the species changed by reaction j are
+			   found at changeStart[j]..changeStart[j+1]-1
+			   of changeIndex and change */
+  int *changeIndex;     /**< index of a changed species */
+  double *change;       /**< change of its molecule number */
+  int *dependentStart;  /**< the reactions whose propensities change
+			   by a firing of reaction j are found at
+			   dependentStart[j]..dependentStart[j+1]-1 of
+			   dependent */
+  int *dependent;       /**< dependency graph of the reactions */
+  int nassignments;     /**< number of assignment rules, besides the
+			   kinetic laws, required by the propensities */
+  nonzeroElem_t **assignments; /**< these rules in evaluation order */
+  double *volume;       /**< molecule number of a unit value of each
+			   species, neq */
+  double *initialValue; /**< initial values, nvalues */
+  StochasticPropensityFn propensity; /**< compiled propensities, NULL
+					if interpreted */
+  AssignmentFn assignment; /**< compiled assignment rules, NULL if
+			      interpreted */
+  stochasticWork_t *work;  /**< trajectory state of the calling
+			      thread */
+  cvodeResults_t *mean;    /**< mean of the last ensemble */
+  cvodeResults_t *variance; /**< sample variance of the last ensemble */
+  int ntrajectories;    /**< number of trajectories of the last
+			   ensemble */
+  long int nfired;      /**< reaction events of all trajectories */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* STOCHASTIC SIMULATION OF THE REACTION NETWORK */
+  SBML_ODESOLVER_API stochasticSolver_t *StochasticSolver_create(odeModel_t *, cvodeSettings_t *);
+  SBML_ODESOLVER_API int StochasticSolver_setValue(stochasticSolver_t *, variableIndex_t *, double);
+  SBML_ODESOLVER_API double StochasticSolver_getValue(const stochasticSolver_t *, variableIndex_t *);
+  SBML_ODESOLVER_API int StochasticSolver_simulate(stochasticSolver_t *, unsigned long seed);
+  SBML_ODESOLVER_API const cvodeResults_t *StochasticSolver_getResults(const stochasticSolver_t *);
+  SBML_ODESOLVER_API int StochasticSolver_simulateEnsemble(stochasticSolver_t *, int ntrajectories, unsigned long seed, int nthreads, trajectoryCallback_t, void *);
+  SBML_ODESOLVER_API const cvodeResults_t *StochasticSolver_getMean(const stochasticSolver_t *);
+  SBML_ODESOLVER_API const cvodeResults_t *StochasticSolver_getVariance(const stochasticSolver_t *);
+  SBML_ODESOLVER_API void StochasticSolver_printStatistics(const stochasticSolver_t *, FILE *);
+  SBML_ODESOLVER_API void StochasticSolver_free(stochasticSolver_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
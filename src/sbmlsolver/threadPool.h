@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+
+#ifndef SBMLSOLVER_THREADPOOL_H_
+#define SBMLSOLVER_THREADPOOL_H_
+
+#include <sbmlsolver/exportdefs.h>
+
+typedef struct threadPool threadPool_t;
+
+/** A task of a thread pool job: called once for each task number
+    0..ntasks-1 of ThreadPool_run with the argument of the job */
+typedef void (*threadTask_t)(void *arg, int task);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* PERSISTENT THREAD POOL */
+  SBML_ODESOLVER_API threadPool_t *ThreadPool_create(int nthreads);
+  SBML_ODESOLVER_API int ThreadPool_getNumThreads(const threadPool_t *);
+  SBML_ODESOLVER_API int ThreadPool_getThread(const threadPool_t *);
+  SBML_ODESOLVER_API void ThreadPool_run(threadPool_t *, int ntasks, threadTask_t, void *arg);
+  SBML_ODESOLVER_API void ThreadPool_lock(threadPool_t *);
+  SBML_ODESOLVER_API void ThreadPool_unlock(threadPool_t *);
+  SBML_ODESOLVER_API void ThreadPool_free(threadPool_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* End of file */
@@ -53,6 +53,7 @@
 /* Header Files for CVODE */
 #include <cvodes/cvodes.h>
 #include <cvodes/cvodes_dense.h>
+#include <cvodes/cvodes_spgmr.h>
 #include <nvector/nvector_serial.h>
 
 #include "sbmlsolver/cvodeData.h"
@@ -86,6 +87,19 @@ static int JacA(int NB, realtype t, N_Vector y, N_Vector yA,
         N_Vector fyA, DlsMat JA, void *jac_dataA,
 		N_Vector tmp1A, N_Vector tmp2A, N_Vector tmp3A);
 
+static int JacTimesVecA(N_Vector vA, N_Vector JvA, realtype t,
+			N_Vector y, N_Vector yA, N_Vector fyA,
+			void *jac_dataA, N_Vector tmpA);
+
+static int PrecSetupA(realtype t, N_Vector y, N_Vector yA, N_Vector fyA,
+		      booleantype jokA, booleantype *jcurPtrA,
+		      realtype gammaA, void *P_dataA,
+		      N_Vector tmp1A, N_Vector tmp2A, N_Vector tmp3A);
+
+static int PrecSolveA(realtype t, N_Vector y, N_Vector yA, N_Vector fyA,
+		      N_Vector rA, N_Vector zA, realtype gammaA,
+		      realtype deltaA, int lrA, void *P_dataA, N_Vector tmpA);
+
 static int fQA(realtype t, N_Vector y, N_Vector yA, N_Vector qAdot,
 	       void *fQ_dataA);
 
@@ -121,8 +135,9 @@ int IntegratorInstance_getForwardSens(integratorInstance_t *engine)
   opt = engine->opt;
   results = engine->results;
 
-  /* getting sensitivities */
-  flag = CVodeGetSens(solver->cvode_mem, &solver->t, solver->yS);
+  /* getting sensitivities at the current output time, which may
+     lie behind the last internal step with dense output */
+  flag = CVodeGetSensDky(solver->cvode_mem, solver->t, 0, solver->yS);
     
   if ( flag != CV_SUCCESS )
     return flag;
@@ -207,6 +222,7 @@ IntegratorInstance_createCVODESSolverStructures(integratorInstance_t *engine)
   cvodeSettings_t *opt = engine->opt;
   CVSensRhs1Fn sensRhsFunction = NULL;
   CVDlsDenseJacFnB adjointJACFunction = NULL;
+  CVSpilsJacTimesVecFnB adjointJACVFunction = NULL;
   CVQuadRhsFnB adjointQuadFunction = NULL;
   CVRhsFnB adjointRHSFunction = NULL;
   
@@ -453,6 +469,10 @@ IntegratorInstance_createCVODESSolverStructures(integratorInstance_t *engine)
       adjointJACFunction =
 	ODEModel_getCompiledCVODEAdjointJacobianFunction(om);
       if ( !adjointJACFunction ) return 0;/*!!! use CVODE_HANDLE_ERROR  */
+
+      adjointJACVFunction =
+	ODEModel_getCompiledCVODEAdjointJacobianTimesVectorFunction(om);
+      if ( !adjointJACVFunction ) return 0;
       
       /* set adjoint quadrature function for sensitivity */
       if ( os->sensitivity )
@@ -470,6 +490,7 @@ IntegratorInstance_createCVODESSolverStructures(integratorInstance_t *engine)
     else
     {
       adjointJACFunction = JacA;
+      adjointJACVFunction = JacTimesVecA;
       adjointQuadFunction = fQA ;
       adjointRHSFunction = fA;
     }
@@ -520,7 +541,8 @@ IntegratorInstance_createCVODESSolverStructures(integratorInstance_t *engine)
       om->compute_vector_v=1;
       data->TimeSeriesIndex = data->model->time_series->n_time-1 ;
       for ( i=0; i<om->neq; i++ )
-	data->adjvalue[i] = -evaluateAST( data->model->vector_v[i], data);
+	data->adjvalue[i] = 0.0;
+      CvodeData_addVectorV(data, data->adjvalue, -1.0);
       om->compute_vector_v=0;
 
     } 
@@ -588,10 +610,6 @@ IntegratorInstance_createCVODESSolverStructures(integratorInstance_t *engine)
       flag = CVodeSVtolerancesB(solver->cvode_mem, solver->which,
                                 solver->reltolA, solver->abstolA);
       CVODE_HANDLE_ERROR(&flag, "CVodeSVtolerancesB", 1);
-
-      flag = CVDenseB(solver->cvode_mem, solver->which, om->neq);
-      CVODE_HANDLE_ERROR(&flag, "CVDenseB", 1);
-
     }
     else
     {
@@ -604,9 +622,36 @@ IntegratorInstance_createCVODESSolverStructures(integratorInstance_t *engine)
     flag = CVodeSetUserDataB(solver->cvode_mem, solver->which, engine->data);
     CVODE_HANDLE_ERROR(&flag, "CVodeSetUserDataB", 1);
 
-    /*!!! could NULL be passed here if jacobian is not available ??*/
-    flag = CVDlsSetDenseJacFnB(solver->cvode_mem, solver->which, adjointJACFunction);
-    CVODE_HANDLE_ERROR(&flag, "CVDlsSetDenseJacFnB", 1);
+    /* the linear solver is (re)attached on every run, as the
+       setting may have changed since the last one */
+    if ( opt->AdjLinearSolver == 1 )
+    {
+      /* matrix-free Krylov solver with the sparse product
+	 -[df/dx]^T * v and a diagonal preconditioner */
+      if ( data->adjPrecond == NULL )
+	ASSIGN_NEW_MEMORY_BLOCK(data->adjPrecond, om->neq, double, 0);
+
+      flag = CVSpgmrB(solver->cvode_mem, solver->which, PREC_LEFT, 0);
+      CVODE_HANDLE_ERROR(&flag, "CVSpgmrB", 1);
+
+      flag = CVSpilsSetJacTimesVecFnB(solver->cvode_mem, solver->which,
+				      adjointJACVFunction);
+      CVODE_HANDLE_ERROR(&flag, "CVSpilsSetJacTimesVecFnB", 1);
+
+      flag = CVSpilsSetPreconditionerB(solver->cvode_mem, solver->which,
+				       PrecSetupA, PrecSolveA);
+      CVODE_HANDLE_ERROR(&flag, "CVSpilsSetPreconditionerB", 1);
+    }
+    else
+    {
+      flag = CVDenseB(solver->cvode_mem, solver->which, om->neq);
+      CVODE_HANDLE_ERROR(&flag, "CVDenseB", 1);
+
+      /*!!! could NULL be passed here if jacobian is not available ??*/
+      flag = CVDlsSetDenseJacFnB(solver->cvode_mem, solver->which,
+				 adjointJACFunction);
+      CVODE_HANDLE_ERROR(&flag, "CVDlsSetDenseJacFnB", 1);
+    }
 
     /* set adjoint max steps to be same as that for forward */
     flag = CVodeSetMaxNumStepsB(solver->cvode_mem, solver->which, opt->Mxstep);
@@ -681,7 +726,8 @@ SBML_ODESOLVER_API int IntegratorInstance_printCVODESStatistics(const integrator
 {
   int flag;
   long int nfSe, nfeS, nsetupsS, nniS, ncfnS, netfS;
-  long int nstA, nfeA, nsetupsA, njeA, nniA, ncfnA, netfA;
+  long int nstA, nfeA, nsetupsA, njeA, nniA, ncfnA, netfA, nrec;
+  long int nliA, nlcfA, npsA;
   cvodeSolver_t *solver = engine->solver;
   void *cvode_memB;
 
@@ -719,8 +765,17 @@ SBML_ODESOLVER_API int IntegratorInstance_printCVODESStatistics(const integrator
      CVODE_HANDLE_ERROR(&flag, "CVodeGetNumSensRhsEvals", 1);
      flag = CVodeGetNumLinSolvSetups(cvode_memB, &nsetupsA);
      CVODE_HANDLE_ERROR(&flag, "CVodeGetNumLinSolvSetups", 1);
-     flag = CVDlsGetNumJacEvals(cvode_memB, &njeA);
-     CVODE_HANDLE_ERROR(&flag, "CVDlsGetNumJacEvals", 1);
+     if ( engine->opt->AdjLinearSolver == 1 )
+     {
+       /* Krylov solver: Jacobian times vector evaluations */
+       flag = CVSpilsGetNumJtimesEvals(cvode_memB, &njeA);
+       CVODE_HANDLE_ERROR(&flag, "CVSpilsGetNumJtimesEvals", 1);
+     }
+     else
+     {
+       flag = CVDlsGetNumJacEvals(cvode_memB, &njeA);
+       CVODE_HANDLE_ERROR(&flag, "CVDlsGetNumJacEvals", 1);
+     }
      flag = CVodeGetNonlinSolvStats(cvode_memB, &nniA, &ncfnA);
      CVODE_HANDLE_ERROR(&flag, "CVodeGetNonlinSolvStats", 1);
      flag = CVodeGetNumErrTestFails(cvode_memB, &netfA);
@@ -729,7 +784,32 @@ SBML_ODESOLVER_API int IntegratorInstance_printCVODESStatistics(const integrator
 	     nstA, nfeA, nsetupsA, njeA); 
      fprintf(f, "## nniA = %-6ld ncfnA = %-6ld netfA = %ld\n",
 	     nniA, ncfnA, netfA);
+     if ( engine->opt->AdjLinearSolver == 1 )
+     {
+       flag = CVSpilsGetNumLinIters(cvode_memB, &nliA);
+       CVODE_HANDLE_ERROR(&flag, "CVSpilsGetNumLinIters", 1);
+       flag = CVSpilsGetNumConvFails(cvode_memB, &nlcfA);
+       CVODE_HANDLE_ERROR(&flag, "CVSpilsGetNumConvFails", 1);
+       flag = CVSpilsGetNumPrecSolves(cvode_memB, &npsA);
+       CVODE_HANDLE_ERROR(&flag, "CVSpilsGetNumPrecSolves", 1);
+       fprintf(f, "## nliA = %-6ld nlcfA = %-6ld npsA  = %ld\n",
+	       nliA, nlcfA, npsA);
+     }
      fprintf(f, "## ncheck = %-6d\n", engine->opt->ncheck);
+
+     /* checkpoints: all intervals but the last one are integrated
+	again in the backward phase */
+     nrec = solver->nSaveSteps > 0 && solver->nstF > 0 ?
+       solver->nSaveSteps * ((solver->nstF - 1) / solver->nSaveSteps) : 0;
+     fprintf(f, "## nstF = %-6ld nSaveSteps = %-6d interpolation = %s\n",
+	     solver->nstF, solver->nSaveSteps,
+	     solver->interpolation == CV_POLYNOMIAL ? "polynomial" : "Hermite");
+     fprintf(f, "## checkpoint memory (est.) = %g bytes\n",
+	     IntegratorInstance_getCheckpointMemory(engine,
+	       engine->opt->ncheck, solver->nSaveSteps,
+	       solver->interpolation));
+     fprintf(f, "## recomputed forward steps (est.) = %ld (%.1f%%)\n",
+	     nrec, solver->nstF > 0 ? 100.0 * nrec / solver->nstF : 0.0);
   }
 
   return(1);
@@ -806,6 +886,7 @@ SBML_ODESOLVER_API int IntegratorInstance_setLinearObjectiveFunction(integratorI
 		      "in file %s", om->neq, i, v_file); 
   }
   om->vector_v = vector_v;
+  om->recompileObjective = 1;
   
   return 1;
 }
@@ -826,6 +907,7 @@ SBML_ODESOLVER_API int IntegratorInstance_setObjectiveFunction(integratorInstanc
   {
     ASTNode_free(om->ObjectiveFunction);
     om->ObjectiveFunction = NULL;
+    om->recompileObjective = 1;
   }
 
   if ( (fp = fopen(ObjFunc_file, "r")) == NULL )
@@ -880,6 +962,7 @@ SBML_ODESOLVER_API int IntegratorInstance_setObjectiveFunction(integratorInstanc
     free(line_formula);  
 
   om->ObjectiveFunction = ObjectiveFunction;
+  om->recompileObjective = 1;
   
   return 1;
 }
@@ -897,12 +980,14 @@ SBML_ODESOLVER_API int IntegratorInstance_setObjectiveFunctionFromString(integra
   {
     ASTNode_free(om->ObjectiveFunction);
     om->ObjectiveFunction = NULL;
+    om->recompileObjective = 1;
   }
 
  
   temp_ast = SBML_parseFormula(str);
   ast = indexAST(temp_ast, om->neq, om->names);
   om->ObjectiveFunction = ast;
+  om->recompileObjective = 1;
   
   ASTNode_free(temp_ast);
   
@@ -935,6 +1020,7 @@ static int ODEModel_construct_vector_v_FromObjectiveFunction(odeModel_t *om)
   /******************** Calculate dJ/dx ************************/
   failed = 0; 
   ASSIGN_NEW_MEMORY_BLOCK(om->vector_v, om->neq, ASTNode_t *, 0);
+  om->recompileObjective = 1;
 
   ObjFun = copyAST(om->ObjectiveFunction);
 
@@ -971,100 +1057,47 @@ static int ODEModel_construct_vector_v_FromObjectiveFunction(odeModel_t *om)
 
 
 
-/** \brief Sets a general objective function (for ODE solution) via a
-    text input file
+/** \brief Reads experimental time series data for the ODE variables
+    from a text file, to be used in objective functions
 */
 SBML_ODESOLVER_API int IntegratorInstance_readTimeSeriesData(integratorInstance_t *engine, char *TimeSeriesData_file)
 {
-  int i;
-  char *name;
-
-  int n_data;      /* number of relevant data columns */
-  int *col;        /* positions of relevant columns in data file */
-  int *index;      /* corresponding indices in variable list */
-  int n_time;      /* number of data rows */
- 
-  
-  odeModel_t *om = engine->om;
-  int n_var = om->neq;       /* number ofvariable names */
-  char **var = om->names;      /* variable names */
-  time_series_t *ts;  /*   = om->time_series; */
-
-
-  if ( om->time_series != NULL )
-    free_data( om->time_series );
-  
-  /* alloc mem */
-  /* ts = space(sizeof(time_series_t)); */
-  ASSIGN_NEW_MEMORY_BLOCK(ts, 1, time_series_t, 0);
-
-  /* alloc mem for index lists */
-  ts->n_var = n_var;
-  ASSIGN_NEW_MEMORY_BLOCK(ts->var,   n_var, char   *, 0);
-  ASSIGN_NEW_MEMORY_BLOCK(ts->data,  n_var, double *, 0); 
-  ASSIGN_NEW_MEMORY_BLOCK(ts->data2, n_var, double *, 0);
-    
-  /* initialize index lists */
-  for ( i=0; i<n_var; i++ )
-  {
-    ASSIGN_NEW_MEMORY_BLOCK(name,  strlen(var[i])+1, char , 0);
-    strcpy(name, var[i]);
-    ts->var[i]   = name;
-    ts->data[i]  = NULL;
-    ts->data2[i] = NULL;
-  }
-
-  /* alloc temp mem for column info */
-  ASSIGN_NEW_MEMORY_BLOCK(col,   n_var, int, 0);
-  ASSIGN_NEW_MEMORY_BLOCK(index, n_var, int, 0);
-
-  /* read header line */
-  n_data = read_header_line(TimeSeriesData_file, n_var, var, col, index);
-  ts->n_data = n_data;
-	
-  /* count number of lines */
-  n_time = read_columns(TimeSeriesData_file, 0, NULL, NULL, NULL);
-  ts->n_time = n_time;
-
-  /* alloc mem for data */
-  for ( i=0; i<n_data; i++ )
-  {
-    ASSIGN_NEW_MEMORY_BLOCK(ts->data[index[i]], n_time, double, 0);
-    ASSIGN_NEW_MEMORY_BLOCK(ts->data2[index[i]], n_time, double, 0);
-  }
-  /* ts->time = space(n_time * sizeof(double)); */
-  ASSIGN_NEW_MEMORY_BLOCK(ts->time,  n_time, double, 0);
+  return IntegratorInstance_readTimeSeriesDataCached(engine,
+						     TimeSeriesData_file, NULL);
+}
 
-  /* read data */
-  read_columns(TimeSeriesData_file, n_data, col, index, ts);
 
-  /* free temp mem */
-  free(col);
-  free(index);
+/** \brief Reads experimental time series data like
+    IntegratorInstance_readTimeSeriesData, but loads the parsed data
+    from the binary cache file TimeSeriesCache_file, if that is
+    up-to-date with the data file, and (re)writes the cache otherwise.
 
-  /* initialize interpolation type */
-  ts->type = 3;
+    If TimeSeriesCache_file is NULL, no cache is used.
+*/
+SBML_ODESOLVER_API int IntegratorInstance_readTimeSeriesDataCached(integratorInstance_t *engine, char *TimeSeriesData_file, char *TimeSeriesCache_file)
+{
+  odeModel_t *om = engine->om;
+  time_series_t *ts;
 
-  /* calculate second derivatives, if data is treated as being continuous */
-  for ( i=0; i<n_var; i++ )
-    if ( ts->data[i] != NULL )
-      spline(ts->n_time, ts->time, ts->data[i], ts->data2[i]);
+  /* data for the ODE variables */
+  if ( TimeSeriesCache_file != NULL )
+    ts = read_data_cached(TimeSeriesData_file, TimeSeriesCache_file,
+			  om->neq, om->names);
+  else
+    ts = read_data(TimeSeriesData_file, om->neq, om->names);
 
-  ts->last = 0;
-    
-  /* alloc mem for warnings */
-  ASSIGN_NEW_MEMORY_BLOCK(ts->mess,  2, char *, 0);
-  ASSIGN_NEW_MEMORY_BLOCK(ts->warn,  2, int, 0); 
+  if ( ts == NULL )
+    return 0;
 
-  /* initialize warnings */
-  ts->mess[0] = "argument out of range (left) ";
-  ts->mess[1] = "argument out of range (right)";
-  for ( i=0; i<2; i++ )
-    ts->warn[i] = 0;   
+  /* the interpolation state refers to the old data */
+  free_cursor(engine->data->TimeSeriesCursor);
+  engine->data->TimeSeriesCursor = NULL;
 
+  if ( om->time_series != NULL )
+    free_data(om->time_series);
   om->time_series = ts;
 
- return 1;
+  return 1;
 }
 
 
@@ -1113,7 +1146,7 @@ SBML_ODESOLVER_API int IntegratorInstance_CVODEQuad(integratorInstance_t *engine
       /* If an objective function exists */
       if( om->ObjectiveFunction != NULL )
       {
-	flag = CVodeGetQuad(solver->cvode_mem, &solver->t, solver->q);
+	flag = CVodeGetQuadDky(solver->cvode_mem, solver->t, 0, solver->q);
 	CVODE_HANDLE_ERROR(&flag, "CVodeGetQuad ObjectiveFunction", 1);
       }
 
@@ -1124,13 +1157,13 @@ SBML_ODESOLVER_API int IntegratorInstance_CVODEQuad(integratorInstance_t *engine
 	if( opt->Sensitivity && om->ObjectiveFunction == NULL &&
 	    om->vector_v != NULL  )
 	{
-	  flag = CVodeGetQuad(solver->cvode_mem, &solver->t, solver->qS);
+	  flag = CVodeGetQuadDky(solver->cvode_mem, solver->t, 0, solver->qS);
 	  CVODE_HANDLE_ERROR(&flag, "CVodeGetQuad V_Vector", 1);
 	}
       }
       else /* doFIM */
       {
-	flag = CVodeGetQuad(solver->cvode_mem, &solver->t, solver->qFIM);
+	flag = CVodeGetQuadDky(solver->cvode_mem, solver->t, 0, solver->qFIM);
 	CVODE_HANDLE_ERROR(&flag, "CVodeGetQuad FIM", 1);
 	
 	/* copy results to matrix FIM */
@@ -1416,12 +1449,10 @@ static int fA(realtype t, N_Vector y, N_Vector yA, N_Vector yAdot,
 
   /* evaluate adjoint sensitivity RHS: -[df/dx]^T * yA + v */
   for(i=0; i<data->model->neq; i++)
-  {
     dyAdata[i] = 0;  
-    /*  Vector v contribution, if continuous data is used */
-    if(data->model->discrete_observation_data==0)
-      dyAdata[i] += evaluateAST(data->model->vector_v[i], data);
-  }
+  /*  Vector v contribution, if continuous data is used */
+  if(data->model->discrete_observation_data==0)
+    CvodeData_addVectorV(data, dyAdata, 1.0);
      
   for ( i=0; i<data->model->sparsesize; i++ )
   {
@@ -1478,6 +1509,122 @@ static int JacA(int NB, realtype t,	N_Vector y, N_Vector yB,
 }
 
 
+/**
+   Adjoint Jacobian times vector routine for the Krylov solver:
+   Compute JvA = -[df/dx]^T * vA
+
+   Like fA, the transposed product runs over the non-zero elements of
+   the Jacobian only, and no dense matrix is set up.
+*/
+
+static int JacTimesVecA(N_Vector vA, N_Vector JvA, realtype t,
+			N_Vector y, N_Vector yA, N_Vector fyA,
+			void *jac_dataA, N_Vector tmpA)
+{
+  int i;
+  realtype *ydata, *vAdata, *JvAdata;
+  cvodeData_t *data;
+  data  = (cvodeData_t *) jac_dataA;
+
+  ydata = NV_DATA_S(y);
+  vAdata = NV_DATA_S(vA);
+  JvAdata = NV_DATA_S(JvA);
+
+  /* update ODE variables from CVODE  */
+  for ( i=0; i<data->model->neq; i++ ) data->value[i] = ydata[i];
+
+  /* update time */
+  data->currenttime = t;
+
+  for ( i=0; i<data->model->neq; i++ )
+    JvAdata[i] = 0.0;
+
+  for ( i=0; i<data->model->sparsesize; i++ )
+  {
+    nonzeroElem_t *nonzero = data->model->jacobSparse[i];
+#ifdef ARITHMETIC_TEST
+    JvAdata[nonzero->j] -= nonzero->ijcode->evaluate(data) * vAdata[nonzero->i];
+#else
+    JvAdata[nonzero->j] -= evaluateAST(nonzero->ij, data) * vAdata[nonzero->i];
+#endif
+  }
+  return (0);
+}
+
+
+/**
+   Preconditioner setup for the adjoint Krylov solver: stores the
+   diagonal of the Newton matrix I - gammaA * JA, JA = -[df/dx]^T,
+   i.e. 1 + gammaA * df_j/dx_j
+*/
+
+static int PrecSetupA(realtype t, N_Vector y, N_Vector yA, N_Vector fyA,
+		      booleantype jokA, booleantype *jcurPtrA,
+		      realtype gammaA, void *P_dataA,
+		      N_Vector tmp1A, N_Vector tmp2A, N_Vector tmp3A)
+{
+  int i;
+  realtype *ydata;
+  cvodeData_t *data;
+  data  = (cvodeData_t *) P_dataA;
+
+  ydata = NV_DATA_S(y);
+
+  /* update ODE variables from CVODE  */
+  for ( i=0; i<data->model->neq; i++ ) data->value[i] = ydata[i];
+
+  /* update time */
+  data->currenttime = t;
+
+  for ( i=0; i<data->model->neq; i++ )
+    data->adjPrecond[i] = 1.0;
+
+  for ( i=0; i<data->model->sparsesize; i++ )
+  {
+    nonzeroElem_t *nonzero = data->model->jacobSparse[i];
+    if ( nonzero->i != nonzero->j )
+      continue;
+#ifdef ARITHMETIC_TEST
+    data->adjPrecond[nonzero->i] += gammaA * nonzero->ijcode->evaluate(data);
+#else
+    data->adjPrecond[nonzero->i] += gammaA * evaluateAST(nonzero->ij, data);
+#endif
+  }
+
+  /* a zero diagonal element is left unpreconditioned */
+  for ( i=0; i<data->model->neq; i++ )
+    if ( data->adjPrecond[i] == 0.0 )
+      data->adjPrecond[i] = 1.0;
+
+  *jcurPtrA = TRUE;
+  return (0);
+}
+
+
+/**
+   Preconditioner solve for the adjoint Krylov solver: zA = P^-1 * rA
+   with the diagonal P set up by PrecSetupA
+*/
+
+static int PrecSolveA(realtype t, N_Vector y, N_Vector yA, N_Vector fyA,
+		      N_Vector rA, N_Vector zA, realtype gammaA,
+		      realtype deltaA, int lrA, void *P_dataA, N_Vector tmpA)
+{
+  int i;
+  realtype *rAdata, *zAdata;
+  cvodeData_t *data;
+  data  = (cvodeData_t *) P_dataA;
+
+  rAdata = NV_DATA_S(rA);
+  zAdata = NV_DATA_S(zA);
+
+  for ( i=0; i<data->model->neq; i++ )
+    zAdata[i] = rAdata[i] / data->adjPrecond[i];
+
+  return (0);
+}
+
+
 static int fQA(realtype t, N_Vector y, N_Vector yA, 
 	       N_Vector qAdot, void *fA_data)
 { 
@@ -1540,7 +1687,6 @@ static int fQS(realtype t, N_Vector y, N_Vector qdot, void *fQ_data)
   /* update sensitivities */
   yy = N_VNew_Serial(data->model->neq);
   yS = N_VCloneVectorArray_Serial(data->os->nsens, yy);
-  N_VDestroy_Serial(yy);
 
   /*  At t=0, yS is initialized to 0. In this case, CvodeGetSens
       shouldn't be used as it gives nan's */
@@ -1557,16 +1703,20 @@ static int fQS(realtype t, N_Vector y, N_Vector qdot, void *fQ_data)
   }  
 
 
+  /* evaluate vector v = (y-ydata) once, into yy */
+  N_VConst(0.0, yy);
+  CvodeData_addVectorV(data, NV_DATA_S(yy), 1.0);
+
   /* evaluate quadrature integrand: (y-ydata) * yS_i for each i */
   for ( i=0; i<data->os->nsens; i++ )
   {
     dqdata[i] = 0.0;
     for ( j=0; j<data->model->neq; j++ )
-      dqdata[i] += evaluateAST(engine->om->vector_v[j], data) *
-	NV_Ith_S(yS[i], j);
+      dqdata[i] += NV_Ith_S(yy, j) * NV_Ith_S(yS[i], j);
   }
 
   N_VDestroyVectorArray_Serial(yS, data->os->nsens);
+  N_VDestroy_Serial(yy);
 
   return (0);
 }
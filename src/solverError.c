@@ -58,6 +58,18 @@
 
 #include <sbml/util/List.h>
 
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+/* errors may be stored by integrators running in threads, e.g. the
+   starts of IntegratorInstance_fitParameters */
+static pthread_mutex_t SolverError_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define SOLVER_ERROR_LOCK() pthread_mutex_lock(&SolverError_mutex)
+#define SOLVER_ERROR_UNLOCK() pthread_mutex_unlock(&SolverError_mutex)
+#else
+#define SOLVER_ERROR_LOCK()
+#define SOLVER_ERROR_UNLOCK()
+#endif
+
 /** error message, including errorCode */
 typedef struct solverErrorMessage
 {
@@ -127,6 +139,7 @@ SBML_ODESOLVER_API void SolverError_clear(void)
 {
   int i ;
 
+  SOLVER_ERROR_LOCK();
   for ( i = 0; i != NUMBER_OF_ERROR_TYPES; i++ )
   {
     List_t *l = solverErrors[i];
@@ -147,6 +160,7 @@ SBML_ODESOLVER_API void SolverError_clear(void)
   }
 
   memoryExhaustion = 0;
+  SOLVER_ERROR_UNLOCK();
 }
 
 SBML_ODESOLVER_API void SolverError_dumpAndClearErrors(void)
@@ -161,7 +175,7 @@ SBML_ODESOLVER_API void SolverError_error(errorType_t type, errorCode_t errorCod
 										  const char *fmt, ...)
 {
   static const size_t BUFFER_SIZE = 2000;
-  List_t *errors = solverErrors[type];
+  List_t *errors;
   char buffer[BUFFER_SIZE], *variableLengthBuffer;
   va_list args;
   solverErrorMessage_t *message =
@@ -184,10 +198,13 @@ SBML_ODESOLVER_API void SolverError_error(errorType_t type, errorCode_t errorCod
     {
       message->message = strcpy(variableLengthBuffer, buffer);
 
+      SOLVER_ERROR_LOCK();
+      errors = solverErrors[type];
       if ( !errors )
 	errors = solverErrors[type] = List_create();
 
       List_add(errors, message);
+      SOLVER_ERROR_UNLOCK();
     }
   }
 }
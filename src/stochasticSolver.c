@@ -0,0 +1,1123 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup stochastic Stochastic Simulation:  Trajectories of the Reaction Network
+  \ingroup integrator
+  \brief This module contains a stochastic simulation of the
+  reactions of the SBML input model, before they are folded into
+  ODEs.
+
+  The trajectories are exact realizations of the chemical master
+  equation by the next reaction method of Gibson and Bruck: the
+  putative firing times of all reactions are kept in an indexed
+  priority queue, and after a firing only the propensities of the
+  reactions in the dependency graph of the fired reaction are
+  evaluated again, by the interpreted or the compiled kinetic laws.
+  The species values at the output times are stored in cvodeResults
+  structures.
+
+  Ensembles of trajectories are simulated on all processors, each
+  trajectory with its own random number stream derived from the seed
+  and the number of the trajectory, such that the trajectories do not
+  depend on the number of threads. The mean and variance of an
+  ensemble are accumulated on the fly, the trajectories themselves
+  are only passed to an optional callback.
+
+  Models with events, rate or algebraic rules, time dependent
+  propensities or non-integer stoichiometries are not supported.
+*/
+/*@{*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <sbml/SBMLTypes.h>
+
+#include "sbmlsolver/cvodeData.h"
+#include "sbmlsolver/processAST.h"
+#include "sbmlsolver/odeModel.h"
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/compiler.h"
+#include "sbmlsolver/threadPool.h"
+#include "sbmlsolver/stochasticSolver.h"
+
+/* 32 bit arithmetic of the random number generator */
+#define RANDOM_MASK 0xffffffffUL
+#define RANDOM_ROTL(x, k) ((((x) << (k)) | ((x) >> (32 - (k)))) & RANDOM_MASK)
+
+/* an ensemble of trajectories, simulated by the threads of a pool
+   with one stochasticWork each; stop and failed are changed and the
+   callback is called with the pool locked */
+typedef struct stochasticEnsemble
+{
+  stochasticSolver_t *ss;
+  unsigned long seed;
+  threadPool_t *pool;
+  stochasticWork_t **work;
+  int stop;
+  int failed;
+  trajectoryCallback_t callback;
+  void *userData;
+} stochasticEnsemble_t;
+
+/* the state of the trajectory simulated by one thread */
+struct stochasticWork
+{
+  cvodeData_t *data;        /* values of the current state */
+  cvodeResults_t *results;  /* the current trajectory */
+  double *count;            /* molecule numbers of the species */
+  double *a;                /* propensities */
+  double *tau;              /* putative absolute firing times */
+  int *heap;                /* reactions, binary min-heap of tau */
+  int *pos;                 /* position of each reaction in heap */
+  unsigned long rng[4];     /* xoshiro128** state */
+  long int nfired;          /* reaction events */
+  int n;                    /* trajectories in mean and m2 */
+  double **mean;            /* running mean of the values */
+  double **m2;              /* sums of squared deviations */
+};
+
+static int StochasticSolver_createNetwork(stochasticSolver_t *);
+static int StochasticSolver_createDependencies(stochasticSolver_t *);
+static void StochasticSolver_collect(odeModel_t *, int i, int *flag,
+				     int *touched, int *ntouched);
+static stochasticWork_t *StochasticWork_create(stochasticSolver_t *);
+static void StochasticWork_free(stochasticWork_t *, int nvalues);
+static int StochasticWork_simulate(stochasticSolver_t *, stochasticWork_t *,
+				   unsigned long seed, int trajectory);
+static int StochasticWork_propensity(stochasticSolver_t *, stochasticWork_t *,
+				     int j, double t);
+static void StochasticWork_updateAssignments(stochasticSolver_t *,
+					     stochasticWork_t *, int all);
+static void StochasticWork_storeResults(stochasticSolver_t *,
+					stochasticWork_t *, int iout);
+static void StochasticWork_accumulate(stochasticSolver_t *,
+				      stochasticWork_t *);
+static void StochasticWork_siftUp(stochasticWork_t *, int p);
+static void StochasticWork_siftDown(stochasticWork_t *, int p, int n);
+static void StochasticSolver_task(void *, int);
+static void Random_seed(unsigned long *state, unsigned long seed,
+			int trajectory);
+static unsigned long Random_next(unsigned long *state);
+static double Random_exponential(unsigned long *state);
+
+
+/** Creates a stochastic simulation of the reactions of the SBML
+    input model with the output times of the passed settings.
+
+    The propensities are the kinetic laws of the reactions, in
+    molecules per time, and are compiled if compilation is requested
+    via CvodeSettings_setCompileFunctions.  Species amounts are
+    molecule numbers, initial values are rounded to the nearest
+    number.  Returns NULL for models without reactions, with events,
+    rate or algebraic rules, time dependent propensities or
+    non-integer stoichiometries, for indefinite integration and on
+    failures.
+*/
+
+SBML_ODESOLVER_API stochasticSolver_t *StochasticSolver_create(odeModel_t *om, cvodeSettings_t *opt)
+{
+  int i;
+  stochasticSolver_t *ss;
+
+  if ( om->m == NULL || Model_getNumReactions(om->m) == 0 )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Stochastic simulation requires a model with "
+		      "reactions.");
+    return NULL;
+  }
+  if ( om->nevents > 0 || om->hasCycle )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Stochastic simulation is not available for models "
+		      "with events or algebraic cycles.");
+    return NULL;
+  }
+  if ( opt->Indefinitely )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "Stochastic simulation requires output times, "
+		      "indefinite integration is not supported.");
+    return NULL;
+  }
+
+  ASSIGN_NEW_MEMORY(ss, struct stochasticSolver, NULL);
+  ss->om = om;
+  ss->opt = opt;
+  ss->neq = om->neq;
+  ss->nreactions = Model_getNumReactions(om->m);
+
+  ss->data = CvodeData_create(om);
+  if ( ss->data == NULL )
+  {
+    free(ss);
+    return NULL;
+  }
+  CvodeData_initialize(ss->data, opt, om, 0);
+  ss->nvalues = ss->data->nvalues;
+
+  if ( !StochasticSolver_createNetwork(ss) ||
+       !StochasticSolver_createDependencies(ss) )
+  {
+    StochasticSolver_free(ss);
+    return NULL;
+  }
+
+  ASSIGN_NEW_MEMORY_BLOCK(ss->initialValue, ss->nvalues+1, double, NULL);
+  for ( i=0; i<ss->nvalues; i++ )
+    ss->initialValue[i] = ss->data->value[i];
+
+  ss->work = StochasticWork_create(ss);
+  ss->mean = CvodeResults_create(ss->data, opt->PrintStep);
+  ss->variance = CvodeResults_create(ss->data, opt->PrintStep);
+  if ( ss->work == NULL || ss->mean == NULL || ss->variance == NULL )
+  {
+    StochasticSolver_free(ss);
+    return NULL;
+  }
+
+  if ( opt->compileFunctions )
+  {
+    if ( !ODEModel_compileStochasticFunctions(om) )
+    {
+      StochasticSolver_free(ss);
+      return NULL;
+    }
+    ss->propensity = om->compiledStochasticPropensityFunction;
+    ss->assignment = om->compiledStochasticAssignmentFunction;
+  }
+
+  return ss;
+}
+
+
+/** Sets the initial value of a species or parameter of all
+    following trajectories.
+
+    Returns 1 on success and 0 for assigned variables.
+*/
+
+SBML_ODESOLVER_API int StochasticSolver_setValue(stochasticSolver_t *ss, variableIndex_t *vi, double value)
+{
+  odeModel_t *om = ss->om;
+
+  if ( vi->index >= om->neq && vi->index < om->neq+om->nass )
+  {
+    SolverError_error(WARNING_ERROR_TYPE,
+		      SOLVER_ERROR_ATTEMPT_TO_SET_ASSIGNED_VALUE,
+		      "Attempted to set a new value for an assigned "
+		      "variable: %s. This is not possible. New value ignored!",
+		      om->names[vi->index]);
+    return 0;
+  }
+
+  ss->initialValue[vi->index] = value;
+  return 1;
+}
+
+
+/** Returns the initial value of a variable or parameter
+*/
+
+SBML_ODESOLVER_API double StochasticSolver_getValue(const stochasticSolver_t *ss, variableIndex_t *vi)
+{
+  return ss->initialValue[vi->index];
+}
+
+
+/** Simulates one trajectory from the initial values over all output
+    times of the settings, with the random number stream of the
+    first trajectory of an ensemble with the same seed.
+
+    Returns 1 on success and 0 on failure, when the results contain
+    the output times reached so far.
+*/
+
+SBML_ODESOLVER_API int StochasticSolver_simulate(stochasticSolver_t *ss, unsigned long seed)
+{
+  int completed;
+
+  ss->work->nfired = 0;
+  completed = StochasticWork_simulate(ss, ss->work, seed, 0);
+  ss->nfired += ss->work->nfired;
+
+  return completed;
+}
+
+
+/** Returns the results of the trajectory of the last call of
+    StochasticSolver_simulate
+*/
+
+SBML_ODESOLVER_API const cvodeResults_t *StochasticSolver_getResults(const stochasticSolver_t *ss)
+{
+  return ss->work->results;
+}
+
+
+/** Simulates an ensemble of trajectories and accumulates their mean
+    and variance at the output times.
+
+    Trajectory i uses the i-th random number stream of the seed,
+    StochasticSolver_simulate the first.  The trajectories are
+    simulated concurrently in nthreads threads (the number of
+    processors if nthreads < 1), each finished trajectory is passed
+    to the callback, if not NULL.  The statistics do not depend on
+    the number of threads up to the rounding of their summation
+    order.  Returns the number of trajectories in the statistics,
+    which is smaller than ntrajectories if the callback stopped the
+    ensemble, or -1 on failure.
+*/
+
+SBML_ODESOLVER_API int StochasticSolver_simulateEnsemble(stochasticSolver_t *ss, int ntrajectories, unsigned long seed, int nthreads, trajectoryCallback_t callback, void *userData)
+{
+  int i, k, w, n, nworkers, nout = ss->opt->PrintStep;
+  double delta;
+  stochasticEnsemble_t ens;
+  stochasticWork_t **work;
+
+  if ( ntrajectories < 1 )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+		      "An ensemble requires at least one trajectory, "
+		      "%d requested.", ntrajectories);
+    return -1;
+  }
+
+  nworkers = nthreads < 1 ? Compiler_getNumProcessors() : nthreads;
+  if ( nworkers > ntrajectories )
+    nworkers = ntrajectories;
+
+  ens.ss = ss;
+  ens.seed = seed;
+  ens.stop = 0;
+  ens.failed = 0;
+  ens.callback = callback;
+  ens.userData = userData;
+  ens.pool = ThreadPool_create(nworkers);
+  if ( ens.pool == NULL )
+    return -1;
+  nworkers = ThreadPool_getNumThreads(ens.pool);
+
+  /* created here, such that the threads only simulate */
+  ASSIGN_NEW_MEMORY_BLOCK(work, nworkers, stochasticWork_t *, -1);
+  work[0] = ss->work;
+  for ( w=1; w<nworkers; w++ )
+  {
+    work[w] = StochasticWork_create(ss);
+    if ( work[w] == NULL )
+    {
+      for ( w--; w>0; w-- )
+	StochasticWork_free(work[w], ss->nvalues);
+      free(work);
+      ThreadPool_free(ens.pool);
+      return -1;
+    }
+  }
+  ens.work = work;
+  for ( w=0; w<nworkers; w++ )
+  {
+    work[w]->nfired = 0;
+    work[w]->n = 0;
+    for ( i=0; i<ss->nvalues; i++ )
+      for ( k=0; k<=nout; k++ )
+	work[w]->mean[i][k] = work[w]->m2[i][k] = 0.0;
+  }
+
+  ThreadPool_run(ens.pool, ntrajectories, StochasticSolver_task, &ens);
+  ThreadPool_free(ens.pool);
+
+  /* merge the statistics of the threads in a fixed order */
+  n = 0;
+  for ( i=0; i<ss->nvalues; i++ )
+    for ( k=0; k<=nout; k++ )
+      ss->mean->value[i][k] = ss->variance->value[i][k] = 0.0;
+  for ( w=0; w<nworkers; w++ )
+  {
+    ss->nfired += work[w]->nfired;
+    if ( work[w]->n == 0 )
+      continue;
+    for ( i=0; i<ss->nvalues; i++ )
+      for ( k=0; k<=nout; k++ )
+      {
+	delta = work[w]->mean[i][k] - ss->mean->value[i][k];
+	ss->mean->value[i][k] += delta * work[w]->n / (n + work[w]->n);
+	ss->variance->value[i][k] += work[w]->m2[i][k] +
+	  delta * delta * n * work[w]->n / (n + work[w]->n);
+      }
+    n += work[w]->n;
+  }
+  for ( i=0; i<ss->nvalues; i++ )
+    for ( k=0; k<=nout; k++ )
+      ss->variance->value[i][k] = n > 1 ?
+	ss->variance->value[i][k] / (n - 1) : 0.0;
+  for ( k=0; k<=nout; k++ )
+    ss->mean->time[k] = ss->variance->time[k] = ss->opt->TimePoints[k];
+  ss->mean->nout = ss->variance->nout = n > 0 ? nout : 0;
+  ss->ntrajectories = n;
+
+  for ( w=1; w<nworkers; w++ )
+    StochasticWork_free(work[w], ss->nvalues);
+  free(work);
+
+  return ens.failed ? -1 : n;
+}
+
+
+/** Returns the mean of all values of the trajectories of the last
+    ensemble at the output times
+*/
+
+SBML_ODESOLVER_API const cvodeResults_t *StochasticSolver_getMean(const stochasticSolver_t *ss)
+{
+  return ss->mean;
+}
+
+
+/** Returns the sample variance of all values of the trajectories of
+    the last ensemble at the output times
+*/
+
+SBML_ODESOLVER_API const cvodeResults_t *StochasticSolver_getVariance(const stochasticSolver_t *ss)
+{
+  return ss->variance;
+}
+
+
+/** Prints some final statistics of the stochastic simulation
+*/
+
+SBML_ODESOLVER_API void StochasticSolver_printStatistics(const stochasticSolver_t *ss, FILE *f)
+{
+  int j, ndependent;
+
+  ndependent = 0;
+  for ( j=0; j<ss->nreactions; j++ )
+    ndependent += ss->dependentStart[j+1] - ss->dependentStart[j];
+
+  fprintf(f, "\n## Stochastic Simulation Statistics (%d reactions, %s):\n",
+	  ss->nreactions, ss->propensity != NULL ? "compiled" : "interpreted");
+  fprintf(f, "## mean dependent reactions = %g\n",
+	  (double) ndependent / ss->nreactions);
+  fprintf(f, "## trajectories = %-6d reaction events = %ld\n",
+	  ss->ntrajectories, ss->nfired);
+}
+
+
+/** Frees the stochastic solver and its results, but not the model
+    and the settings
+*/
+
+SBML_ODESOLVER_API void StochasticSolver_free(stochasticSolver_t *ss)
+{
+  if ( ss == NULL )
+    return;
+
+  if ( ss->work != NULL )
+    StochasticWork_free(ss->work, ss->nvalues);
+  if ( ss->mean != NULL )
+    CvodeResults_free(ss->mean);
+  if ( ss->variance != NULL )
+    CvodeResults_free(ss->variance);
+  free(ss->reaction);
+  free(ss->changeStart);
+  free(ss->changeIndex);
+  free(ss->change);
+  free(ss->dependentStart);
+  free(ss->dependent);
+  free(ss->assignments);
+  free(ss->volume);
+  free(ss->initialValue);
+  if ( ss->data != NULL )
+    CvodeData_free(ss->data);
+  free(ss);
+}
+
+
+/************* internal functions ************/
+
+/* finds the propensities of the reactions of the SBML input model,
+   their state changes and the volumes of the species; returns 0 for
+   unsupported models */
+static int StochasticSolver_createNetwork(stochasticSolver_t *ss)
+{
+  int i, j, k, n, idx, nchange, *touched, *listed;
+  unsigned int l;
+  double s, *delta;
+  odeModel_t *om = ss->om;
+  Model_t *m = om->m;
+  Reaction_t *r;
+  SpeciesReference_t *sref;
+  Species_t *sp;
+  Compartment_t *c;
+  SBMLTypeCode_t type;
+
+  for ( l=0; l<Model_getNumRules(m); l++ )
+  {
+    type = SBase_getTypeCode((SBase_t *)Model_getRule(m, l));
+    if ( type == SBML_RATE_RULE || type == SBML_ALGEBRAIC_RULE )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_INTEGRATOR_SETTINGS,
+			"Stochastic simulation is not available for models "
+			"with rate or algebraic rules.");
+      return 0;
+    }
+  }
+
+  /* molecule numbers per unit of the values of the species */
+  ASSIGN_NEW_MEMORY_BLOCK(ss->volume, ss->neq+1, double, 0);
+  for ( i=0; i<ss->neq; i++ )
+    ss->volume[i] = 1.0;
+  for ( l=0; l<Model_getNumSpecies(m); l++ )
+  {
+    sp = Model_getSpecies(m, l);
+    i = ODEModel_getVariableIndexFields(om, Species_getId(sp));
+    if ( i < 0 || i >= ss->neq )
+      continue;
+    c = Model_getCompartmentById(m, Species_getCompartment(sp));
+    if ( Species_getHasOnlySubstanceUnits(sp) ||
+	 Compartment_getSpatialDimensions(c) == 0 )
+      continue;
+    idx = ODEModel_getVariableIndexFields(om, Species_getCompartment(sp));
+    if ( idx < om->neq + om->nass )
+    {
+      SolverError_error(ERROR_ERROR_TYPE,
+			SOLVER_ERROR_INTEGRATOR_SETTINGS,
+			"Stochastic simulation requires constant "
+			"compartments, the size of %s changes.",
+			Species_getCompartment(sp));
+      return 0;
+    }
+    ss->volume[i] = ss->data->value[idx];
+  }
+
+  ASSIGN_NEW_MEMORY_BLOCK(ss->reaction, ss->nreactions, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(ss->changeStart, ss->nreactions+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(delta, ss->neq+1, double, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(touched, ss->neq+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(listed, ss->neq+1, int, 0);
+
+  /* first pass counts, second pass fills the state changes */
+  for ( n=0; n<2; n++ )
+  {
+    nchange = 0;
+    for ( j=0; j<ss->nreactions; j++ )
+    {
+      r = Model_getReaction(m, j);
+      ss->changeStart[j] = nchange;
+      ss->reaction[j] = ODEModel_getVariableIndexFields(om, Reaction_getId(r));
+      if ( ss->reaction[j] < om->neq ||
+	   ss->reaction[j] >= om->neq + om->nass )
+      {
+	SolverError_error(ERROR_ERROR_TYPE,
+			  SOLVER_ERROR_NO_KINETIC_LAW_FOUND_FOR_REACTION,
+			  "No kinetic law found for reaction %s.",
+			  Reaction_getId(r));
+	free(delta);
+	free(touched);
+	free(listed);
+	return 0;
+      }
+
+      k = 0;
+      for ( l=0; l<Reaction_getNumReactants(r)+Reaction_getNumProducts(r); l++ )
+      {
+	if ( l < Reaction_getNumReactants(r) )
+	  sref = Reaction_getReactant(r, l);
+	else
+	  sref = Reaction_getProduct(r, l - Reaction_getNumReactants(r));
+	s = SpeciesReference_getStoichiometry(sref);
+	if ( SpeciesReference_isSetStoichiometryMath(sref) || s != floor(s) )
+	{
+	  SolverError_error(ERROR_ERROR_TYPE,
+			    SOLVER_ERROR_INTEGRATOR_SETTINGS,
+			    "Stochastic simulation requires constant integer "
+			    "stoichiometries, found in reaction %s.",
+			    Reaction_getId(r));
+	  free(delta);
+	  free(touched);
+	  free(listed);
+	  return 0;
+	}
+	/* boundary, constant and assigned species do not change */
+	i = ODEModel_getVariableIndexFields(om,
+					    SpeciesReference_getSpecies(sref));
+	if ( i < 0 || i >= ss->neq )
+	  continue;
+	if ( !listed[i] )
+	{
+	  listed[i] = 1;
+	  touched[k++] = i;
+	}
+	delta[i] += l < Reaction_getNumReactants(r) ? -s : s;
+      }
+
+      /* species which are consumed and produced do not change */
+
+      for ( l=0; l<(unsigned int)k; l++ )
+      {
+	i = touched[l];
+	if ( delta[i] != 0.0 )
+	{
+	  if ( n == 1 )
+	  {
+	    ss->changeIndex[nchange] = i;
+	    ss->change[nchange] = delta[i];
+	  }
+	  nchange++;
+	}
+	delta[i] = 0.0;
+	listed[i] = 0;
+      }
+    }
+    ss->changeStart[ss->nreactions] = nchange;
+
+    if ( n == 0 )
+    {
+      ASSIGN_NEW_MEMORY_BLOCK(ss->changeIndex, nchange+1, int, 0);
+      ASSIGN_NEW_MEMORY_BLOCK(ss->change, nchange+1, double, 0);
+    }
+  }
+
+  free(delta);
+  free(touched);
+  free(listed);
+
+  return 1;
+}
+
+
+/* builds the dependency graph of the reactions from the variables
+   their kinetic laws depend on, directly or via assignment rules,
+   and collects the assignment rules required by the propensities;
+   returns 0 for time dependent propensities */
+static int StochasticSolver_createDependencies(stochasticSolver_t *ss)
+{
+  int i, j, k, l, n, nvalues, ndep, ntouched, *flag, *touched, *needed,
+    *speciesStart, *speciesReaction, *mark;
+  odeModel_t *om = ss->om;
+
+  nvalues = om->neq + om->nass + om->nconst;
+  ASSIGN_NEW_MEMORY_BLOCK(flag, nvalues+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(touched, nvalues+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(needed, om->nass+1, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(speciesStart, ss->neq+2, int, 0);
+
+  /* the reactions depending on each species: count, then fill */
+  for ( n=0; n<2; n++ )
+  {
+    for ( j=0; j<ss->nreactions; j++ )
+    {
+      ntouched = 0;
+      flag[ss->reaction[j]] = 1;
+      touched[ntouched++] = ss->reaction[j];
+      StochasticSolver_collect(om, ss->reaction[j], flag, touched, &ntouched);
+      for ( l=0; l<ntouched; l++ )
+      {
+	i = touched[l];
+	flag[i] = 0;
+	if ( i < ss->neq )
+	{
+	  if ( n == 0 )
+	    speciesStart[i+2]++;
+	  else
+	    speciesReaction[speciesStart[i+1]++] = j;
+	}
+	else if ( i < om->neq + om->nass && n == 0 )
+	{
+	  if ( ASTNode_containsTime(om->assignment[i - om->neq]) )
+	  {
+	    SolverError_error(ERROR_ERROR_TYPE,
+			      SOLVER_ERROR_INTEGRATOR_SETTINGS,
+			      "Stochastic simulation requires propensities "
+			      "that do not depend on time, found in reaction "
+			      "%s.", om->names[ss->reaction[j]]);
+	    free(flag);
+	    free(touched);
+	    free(needed);
+	    free(speciesStart);
+	    return 0;
+	  }
+	  if ( i != ss->reaction[j] )
+	    needed[i - om->neq] = 1;
+	}
+      }
+    }
+    if ( n == 0 )
+    {
+      for ( i=0; i<ss->neq; i++ )
+	speciesStart[i+2] += speciesStart[i+1];
+      ASSIGN_NEW_MEMORY_BLOCK(speciesReaction, speciesStart[ss->neq+1]+1,
+			      int, 0);
+    }
+  }
+
+  /* the assignment rules required by the propensities, in their
+     evaluation order */
+  ASSIGN_NEW_MEMORY_BLOCK(ss->assignments, om->nass+1, nonzeroElem_t *, 0);
+  ss->nassignments = 0;
+  for ( i=0; i<om->nass; i++ )
+    if ( needed[om->assignmentOrder[i]->i - om->neq] )
+      ss->assignments[ss->nassignments++] = om->assignmentOrder[i];
+
+  /* the reactions depending on the species changed by a reaction,
+     which always includes the reaction itself: count, then fill */
+  ASSIGN_NEW_MEMORY_BLOCK(mark, ss->nreactions, int, 0);
+  ASSIGN_NEW_MEMORY_BLOCK(ss->dependentStart, ss->nreactions+1, int, 0);
+  for ( n=0; n<2; n++ )
+  {
+    for ( j=0; j<ss->nreactions; j++ )
+      mark[j] = -1;
+    ndep = 0;
+    for ( j=0; j<ss->nreactions; j++ )
+    {
+      ss->dependentStart[j] = ndep;
+      if ( n == 1 )
+	ss->dependent[ndep] = j;
+      mark[j] = j;
+      ndep++;
+      for ( l=ss->changeStart[j]; l<ss->changeStart[j+1]; l++ )
+      {
+	i = ss->changeIndex[l];
+	for ( k=speciesStart[i]; k<speciesStart[i+1]; k++ )
+	  if ( mark[speciesReaction[k]] != j )
+	  {
+	    mark[speciesReaction[k]] = j;
+	    if ( n == 1 )
+	      ss->dependent[ndep] = speciesReaction[k];
+	    ndep++;
+	  }
+      }
+    }
+    ss->dependentStart[ss->nreactions] = ndep;
+    if ( n == 0 )
+      ASSIGN_NEW_MEMORY_BLOCK(ss->dependent, ndep, int, 0);
+  }
+
+  free(flag);
+  free(touched);
+  free(needed);
+  free(speciesStart);
+  free(speciesReaction);
+  free(mark);
+
+  return 1;
+}
+
+
+/* flags all variables the assigned variable i depends on, directly
+   or via other assignment rules, and appends them to touched */
+static void StochasticSolver_collect(odeModel_t *om, int i, int *flag,
+				     int *touched, int *ntouched)
+{
+  int j, nvalues = om->neq + om->nass + om->nconst;
+
+  for ( j=0; j<nvalues; j++ )
+    if ( om->dependencyMatrix[i][j] && !flag[j] )
+    {
+      flag[j] = 1;
+      touched[(*ntouched)++] = j;
+      if ( j >= om->neq && j < om->neq + om->nass )
+	StochasticSolver_collect(om, j, flag, touched, ntouched);
+    }
+}
+
+
+/* creates the trajectory state of one thread with its own values */
+static stochasticWork_t *StochasticWork_create(stochasticSolver_t *ss)
+{
+  int i, nout = ss->opt->PrintStep;
+  stochasticWork_t *w;
+
+  ASSIGN_NEW_MEMORY(w, struct stochasticWork, NULL);
+  w->data = CvodeData_create(ss->om);
+  if ( w->data == NULL )
+  {
+    free(w);
+    return NULL;
+  }
+  CvodeData_initialize(w->data, ss->opt, ss->om, 0);
+  w->results = CvodeResults_create(w->data, nout);
+  if ( w->results == NULL )
+  {
+    StochasticWork_free(w, ss->nvalues);
+    return NULL;
+  }
+
+  ASSIGN_NEW_MEMORY_BLOCK(w->count, ss->neq+1, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->a, ss->nreactions, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->tau, ss->nreactions, double, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->heap, ss->nreactions, int, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->pos, ss->nreactions, int, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->mean, ss->nvalues+1, double *, NULL);
+  ASSIGN_NEW_MEMORY_BLOCK(w->m2, ss->nvalues+1, double *, NULL);
+  for ( i=0; i<ss->nvalues; i++ )
+  {
+    ASSIGN_NEW_MEMORY_BLOCK(w->mean[i], nout+1, double, NULL);
+    ASSIGN_NEW_MEMORY_BLOCK(w->m2[i], nout+1, double, NULL);
+  }
+
+  return w;
+}
+
+
+static void StochasticWork_free(stochasticWork_t *w, int nvalues)
+{
+  int i;
+
+  if ( w->mean != NULL )
+    for ( i=0; i<nvalues; i++ )
+      free(w->mean[i]);
+  if ( w->m2 != NULL )
+    for ( i=0; i<nvalues; i++ )
+      free(w->m2[i]);
+  free(w->mean);
+  free(w->m2);
+  free(w->count);
+  free(w->a);
+  free(w->tau);
+  free(w->heap);
+  free(w->pos);
+  if ( w->results != NULL )
+    CvodeResults_free(w->results);
+  if ( w->data != NULL )
+    CvodeData_free(w->data);
+  free(w);
+}
+
+
+/* simulates one trajectory with the next reaction method of Gibson
+   and Bruck; returns 0 for invalid propensities */
+static int StochasticWork_simulate(stochasticSolver_t *ss, stochasticWork_t *w,
+				   unsigned long seed, int trajectory)
+{
+  int i, j, k, l, mu, iout, nr = ss->nreactions;
+  double t, aold, *tp = ss->opt->TimePoints;
+  cvodeData_t *data = w->data;
+
+  Random_seed(w->rng, seed, trajectory);
+
+  for ( i=0; i<ss->nvalues; i++ )
+    data->value[i] = ss->initialValue[i];
+  for ( i=0; i<ss->neq; i++ )
+  {
+    w->count[i] = floor(data->value[i] * ss->volume[i] + 0.5);
+    data->value[i] = w->count[i] / ss->volume[i];
+  }
+  t = tp[0];
+  data->currenttime = t;
+  w->results->nout = 0;
+
+  StochasticWork_updateAssignments(ss, w, 1);
+  StochasticWork_storeResults(ss, w, 0);
+
+  for ( j=0; j<nr; j++ )
+  {
+    if ( !StochasticWork_propensity(ss, w, j, t) )
+      return 0;
+    w->tau[j] = w->a[j] > 0.0 ?
+      t + Random_exponential(w->rng) / w->a[j] : HUGE_VAL;
+    w->heap[j] = j;
+    w->pos[j] = j;
+  }
+  for ( l=nr/2-1; l>=0; l-- )
+    StochasticWork_siftDown(w, l, nr);
+
+  iout = 1;
+  while ( 1 )
+  {
+    /* the state is constant until the next firing */
+    mu = w->heap[0];
+    while ( iout <= ss->opt->PrintStep && tp[iout] < w->tau[mu] )
+    {
+      data->currenttime = tp[iout];
+      StochasticWork_updateAssignments(ss, w, 1);
+      StochasticWork_storeResults(ss, w, iout);
+      iout++;
+    }
+    if ( iout > ss->opt->PrintStep )
+      break;
+
+    /* fire reaction mu */
+    t = w->tau[mu];
+    data->currenttime = t;
+    for ( l=ss->changeStart[mu]; l<ss->changeStart[mu+1]; l++ )
+    {
+      i = ss->changeIndex[l];
+      w->count[i] += ss->change[l];
+      data->value[i] = w->count[i] / ss->volume[i];
+    }
+    w->nfired++;
+    StochasticWork_updateAssignments(ss, w, 0);
+
+    /* new firing time of mu, rescaled times of the others */
+    for ( l=ss->dependentStart[mu]; l<ss->dependentStart[mu+1]; l++ )
+    {
+      k = ss->dependent[l];
+      aold = w->a[k];
+      if ( !StochasticWork_propensity(ss, w, k, t) )
+	return 0;
+      if ( w->a[k] <= 0.0 )
+	w->tau[k] = HUGE_VAL;
+      else if ( k != mu && aold > 0.0 )
+	w->tau[k] = t + aold / w->a[k] * (w->tau[k] - t);
+      else
+	w->tau[k] = t + Random_exponential(w->rng) / w->a[k];
+      StochasticWork_siftUp(w, w->pos[k]);
+      StochasticWork_siftDown(w, w->pos[k], nr);
+    }
+  }
+
+  return 1;
+}
+
+
+/* evaluates the propensity of reaction j, returns 0 if it is
+   negative or not a number */
+static int StochasticWork_propensity(stochasticSolver_t *ss, stochasticWork_t *w,
+				     int j, double t)
+{
+  odeModel_t *om = ss->om;
+
+  if ( ss->propensity != NULL )
+    w->a[j] = ss->propensity(w->data, j);
+  else
+    w->a[j] = evaluateAST(om->assignment[ss->reaction[j] - om->neq], w->data);
+
+  if ( !(w->a[j] >= 0.0) )
+  {
+    SolverError_error(ERROR_ERROR_TYPE,
+		      SOLVER_ERROR_INTEGRATION_NOT_SUCCESSFUL,
+		      "Invalid propensity %g of reaction %s at time %g.",
+		      w->a[j], om->names[ss->reaction[j]], t);
+    return 0;
+  }
+  return 1;
+}
+
+
+/* evaluates all assignment rules, or only those required by the
+   propensities */
+static void StochasticWork_updateAssignments(stochasticSolver_t *ss,
+					     stochasticWork_t *w, int all)
+{
+  int i;
+  odeModel_t *om = ss->om;
+  cvodeData_t *data = w->data;
+  nonzeroElem_t *ordered;
+
+  if ( all && ss->assignment != NULL )
+    ss->assignment(data);
+  else if ( all )
+    for ( i=0; i<om->nass; i++ )
+    {
+      ordered = om->assignmentOrder[i];
+      data->value[ordered->i] = evaluateAST(ordered->ij, data);
+    }
+  else
+    for ( i=0; i<ss->nassignments; i++ )
+    {
+      ordered = ss->assignments[i];
+      data->value[ordered->i] = evaluateAST(ordered->ij, data);
+    }
+}
+
+
+/* stores time and values of the trajectory at output step iout */
+static void StochasticWork_storeResults(stochasticSolver_t *ss,
+					stochasticWork_t *w, int iout)
+{
+  int i;
+  cvodeResults_t *results = w->results;
+
+  results->time[iout] = ss->opt->TimePoints[iout];
+  for ( i=0; i<ss->nvalues; i++ )
+    results->value[i][iout] = w->data->value[i];
+  results->nout = iout;
+}
+
+
+/* adds the finished trajectory to the running mean and sums of
+   squared deviations of the thread (Welford) */
+static void StochasticWork_accumulate(stochasticSolver_t *ss,
+				      stochasticWork_t *w)
+{
+  int i, k;
+  double x, delta;
+
+  w->n++;
+  for ( i=0; i<ss->nvalues; i++ )
+    for ( k=0; k<=ss->opt->PrintStep; k++ )
+    {
+      x = w->results->value[i][k];
+      delta = x - w->mean[i][k];
+      w->mean[i][k] += delta / w->n;
+      w->m2[i][k] += delta * (x - w->mean[i][k]);
+    }
+}
+
+
+/* restores the heap order from position p towards the root */
+static void StochasticWork_siftUp(stochasticWork_t *w, int p)
+{
+  int parent, k = w->heap[p];
+
+  while ( p > 0 )
+  {
+    parent = (p - 1) / 2;
+    if ( !(w->tau[k] < w->tau[w->heap[parent]]) )
+      break;
+    w->heap[p] = w->heap[parent];
+    w->pos[w->heap[p]] = p;
+    p = parent;
+  }
+  w->heap[p] = k;
+  w->pos[k] = p;
+}
+
+
+/* restores the heap order of n elements from position p towards the
+   leaves */
+static void StochasticWork_siftDown(stochasticWork_t *w, int p, int n)
+{
+  int child, k = w->heap[p];
+
+  while ( (child = 2*p + 1) < n )
+  {
+    if ( child + 1 < n && w->tau[w->heap[child+1]] < w->tau[w->heap[child]] )
+      child++;
+    if ( !(w->tau[w->heap[child]] < w->tau[k]) )
+      break;
+    w->heap[p] = w->heap[child];
+    w->pos[w->heap[p]] = p;
+    p = child;
+  }
+  w->heap[p] = k;
+  w->pos[k] = p;
+}
+
+
+/* simulates a trajectory with the stochasticWork of the calling
+   thread, unless the ensemble has been stopped */
+static void StochasticSolver_task(void *arg, int trajectory)
+{
+  stochasticEnsemble_t *ens = arg;
+  stochasticWork_t *w = ens->work[ThreadPool_getThread(ens->pool)];
+  int stop, completed;
+
+  ThreadPool_lock(ens->pool);
+  stop = ens->stop;
+  ThreadPool_unlock(ens->pool);
+  if ( stop )
+    return;
+
+  completed = StochasticWork_simulate(ens->ss, w, ens->seed, trajectory);
+  if ( completed )
+    StochasticWork_accumulate(ens->ss, w);
+
+  ThreadPool_lock(ens->pool);
+  if ( !completed )
+    ens->stop = ens->failed = 1;
+  else if ( ens->callback != NULL && !ens->stop &&
+	    !ens->callback(trajectory, w->results, ens->userData) )
+    ens->stop = 1;
+  ThreadPool_unlock(ens->pool);
+}
+
+
+/* seeds the xoshiro128** state of a trajectory: the seed and the
+   number of the trajectory are hashed, such that each trajectory has
+   its own stream */
+static void Random_seed(unsigned long *state, unsigned long seed,
+			int trajectory)
+{
+  int k;
+  unsigned long x, h;
+
+  h = (seed ^ ((seed >> 16) >> 16)) & RANDOM_MASK;
+  for ( k=0; k<5; k++ )
+  {
+    /* the hash of Chris Wellons */
+    x = k == 0 ? h :
+      (h + 0x9e3779b9UL * (4UL * (unsigned long) trajectory + k)) & RANDOM_MASK;
+    x ^= x >> 16;
+    x = (x * 0x7feb352dUL) & RANDOM_MASK;
+    x ^= x >> 15;
+    x = (x * 0x846ca68bUL) & RANDOM_MASK;
+    x ^= x >> 16;
+    if ( k == 0 )
+      h = x;
+    else
+      state[k-1] = x;
+  }
+  if ( (state[0] | state[1] | state[2] | state[3]) == 0 )
+    state[0] = 1;
+}
+
+
+/* returns the next 32 bit number of the xoshiro128** generator of
+   Blackman and Vigna */
+static unsigned long Random_next(unsigned long *s)
+{
+  unsigned long result, t;
+
+  result = (RANDOM_ROTL((s[1] * 5) & RANDOM_MASK, 7) * 9) & RANDOM_MASK;
+  t = (s[1] << 9) & RANDOM_MASK;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = RANDOM_ROTL(s[3], 11);
+
+  return result;
+}
+
+
+/* returns an exponentially distributed number with mean 1, from a
+   uniform number with 53 bits in (0, 1) */
+static double Random_exponential(unsigned long *s)
+{
+  unsigned long a, b;
+
+  a = Random_next(s) >> 5;
+  b = Random_next(s) >> 6;
+  return -log((a * 67108864.0 + b + 0.5) / 9007199254740992.0);
+}
+
+/*! @} */
+/* End of file */
@@ -0,0 +1,318 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, WITHOUT EVEN THE IMPLIED WARRANTY OF
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. The software and
+ * documentation provided hereunder is on an "as is" basis, and the
+ * authors have no obligations to provide maintenance, support,
+ * updates, enhancements or modifications.  In no event shall the
+ * authors be liable to any party for direct, indirect, special,
+ * incidental or consequential damages, including lost profits, arising
+ * out of the use of this software and its documentation, even if the
+ * authors have been advised of the possibility of such damage.  See
+ * the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*! \defgroup threadPool Thread Pool
+  \ingroup integrator
+  \brief This module contains a pool of threads which persist over
+  many jobs, for the parallel evaluation of one large model.
+
+  The threads of the pool wait for a job, which consists of a number
+  of tasks. The calling thread takes part in the job and returns when
+  all tasks are done, such that short jobs, like the evaluation of
+  the ODEs or a vector operation in each step of an integration, do
+  not pay for the creation of threads. Without POSIX threads, the
+  jobs run in the calling thread, as they do in a child process
+  forked from the process of the pool, which doesn't inherit its
+  threads.
+*/
+/*@{*/
+
+#include <stdlib.h>
+
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#ifdef HAVE_UNISTD_H
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+#endif
+
+#include "sbmlsolver/solverError.h"
+#include "sbmlsolver/compiler.h"
+#include "sbmlsolver/threadPool.h"
+
+struct threadPool
+{
+  int nthreads;         /* threads of a job, with the calling thread */
+  threadTask_t task;    /* the current job */
+  void *arg;
+  int ntasks;
+  int next;             /* next task to be taken */
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  pthread_t *thread;    /* nthreads-1 pool threads */
+  int nstarted;
+  pthread_mutex_t mutex;
+  pthread_cond_t start; /* signals a new job or the shutdown */
+  pthread_cond_t done;  /* signals the end of a job */
+  unsigned long job;    /* job counter */
+  int running;          /* pool threads still working on the job */
+  int shutdown;
+#ifdef HAVE_UNISTD_H
+  pid_t pid;            /* process of the pool threads */
+#endif
+#endif
+};
+
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+static int ThreadPool_isForked(const threadPool_t *);
+static void *ThreadPool_worker(void *);
+static void ThreadPool_work(threadPool_t *);
+#endif
+
+
+/** Creates a pool for jobs run by nthreads threads, the calling
+    thread included, or by as many threads as processors if
+    nthreads < 1.
+
+    Returns NULL on failures.
+*/
+
+SBML_ODESOLVER_API threadPool_t *ThreadPool_create(int nthreads)
+{
+  threadPool_t *pool;
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  int w;
+#endif
+
+  ASSIGN_NEW_MEMORY(pool, struct threadPool, NULL);
+  pool->nthreads = nthreads < 1 ? Compiler_getNumProcessors() : nthreads;
+
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+#ifdef HAVE_UNISTD_H
+  pool->pid = getpid();
+#endif
+  ASSIGN_NEW_MEMORY_BLOCK(pool->thread, pool->nthreads, pthread_t, NULL);
+  for ( w=1; w<pool->nthreads; w++ )
+  {
+    if ( pthread_create(&pool->thread[pool->nstarted], NULL,
+			ThreadPool_worker, pool) != 0 )
+      break;
+    pool->nstarted++;
+  }
+  /* run with the threads that could be started */
+  pool->nthreads = pool->nstarted + 1;
+#else
+  pool->nthreads = 1;
+#endif
+
+  return pool;
+}
+
+
+/** Returns the number of threads of a job, the calling thread
+    included
+*/
+
+SBML_ODESOLVER_API int ThreadPool_getNumThreads(const threadPool_t *pool)
+{
+  return pool->nthreads;
+}
+
+
+/** Returns the number 1..nthreads-1 of the pool thread which calls
+    it, or 0 in the thread that runs the job and in threads outside
+    of the pool, such that a task can use data of its thread
+*/
+
+SBML_ODESOLVER_API int ThreadPool_getThread(const threadPool_t *pool)
+{
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  int w;
+  pthread_t self = pthread_self();
+
+  if ( ThreadPool_isForked(pool) )
+    return 0;
+  for ( w=0; w<pool->nstarted; w++ )
+    if ( pthread_equal(pool->thread[w], self) )
+      return w + 1;
+#endif
+
+  return 0;
+}
+
+
+/** Runs the tasks 0..ntasks-1 of a job in the threads of the pool and
+    the calling thread, and returns when all are done.
+
+    The tasks are taken in ascending order; which thread runs a task
+    is not defined. Jobs must not be started from the tasks of a
+    job.
+*/
+
+SBML_ODESOLVER_API void ThreadPool_run(threadPool_t *pool, int ntasks, threadTask_t task, void *arg)
+{
+  int k;
+
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  if ( pool->nstarted > 0 && ntasks > 1 && !ThreadPool_isForked(pool) )
+  {
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->arg = arg;
+    pool->ntasks = ntasks;
+    pool->next = 0;
+    pool->running = pool->nstarted;
+    pool->job++;
+    pthread_cond_broadcast(&pool->start);
+    ThreadPool_work(pool);
+    while ( pool->running > 0 )
+      pthread_cond_wait(&pool->done, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+    return;
+  }
+#endif
+
+  for ( k=0; k<ntasks; k++ )
+    task(arg, k);
+}
+
+
+/** Locks the pool for a critical section of a task, such as the
+    update of a result shared by the tasks of a job. The tasks of
+    the job are not handed out until ThreadPool_unlock is called.
+*/
+
+SBML_ODESOLVER_API void ThreadPool_lock(threadPool_t *pool)
+{
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  if ( !ThreadPool_isForked(pool) )
+    pthread_mutex_lock(&pool->mutex);
+#endif
+}
+
+
+/** Ends a critical section of a task, see ThreadPool_lock
+*/
+
+SBML_ODESOLVER_API void ThreadPool_unlock(threadPool_t *pool)
+{
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  if ( !ThreadPool_isForked(pool) )
+    pthread_mutex_unlock(&pool->mutex);
+#endif
+}
+
+
+/** Stops the threads of the pool and frees it; in a forked child
+    process, which has none of the threads, only the memory is freed
+*/
+
+SBML_ODESOLVER_API void ThreadPool_free(threadPool_t *pool)
+{
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  int w;
+#endif
+
+  if ( pool == NULL )
+    return;
+
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+  if ( ThreadPool_isForked(pool) )
+  {
+    /* the mutex may have been locked by a thread of the parent */
+    free(pool->thread);
+    free(pool);
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->mutex);
+  for ( w=0; w<pool->nstarted; w++ )
+    pthread_join(pool->thread[w], NULL);
+  free(pool->thread);
+  pthread_cond_destroy(&pool->start);
+  pthread_cond_destroy(&pool->done);
+  pthread_mutex_destroy(&pool->mutex);
+#endif
+  free(pool);
+}
+
+
+/************* internal functions ************/
+
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+
+/* returns 1 in a child process forked from the process of the pool
+   threads, which runs the jobs in the calling thread, 0 otherwise */
+static int ThreadPool_isForked(const threadPool_t *pool)
+{
+#ifdef HAVE_UNISTD_H
+  return pool->pid != getpid();
+#else
+  return 0;
+#endif
+}
+
+/* waits for jobs and takes part in them until the shutdown */
+static void *ThreadPool_worker(void *arg)
+{
+  threadPool_t *pool = arg;
+  unsigned long job = 0;
+
+  pthread_mutex_lock(&pool->mutex);
+  while ( 1 )
+  {
+    while ( pool->job == job && !pool->shutdown )
+      pthread_cond_wait(&pool->start, &pool->mutex);
+    if ( pool->shutdown )
+      break;
+    job = pool->job;
+    ThreadPool_work(pool);
+    if ( --pool->running == 0 )
+      pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+
+  return NULL;
+}
+
+
+/* runs tasks of the current job until all have been taken, called
+   and returning with the mutex locked */
+static void ThreadPool_work(threadPool_t *pool)
+{
+  int k;
+
+  while ( pool->next < pool->ntasks )
+  {
+    k = pool->next++;
+    pthread_mutex_unlock(&pool->mutex);
+    pool->task(pool->arg, k);
+    pthread_mutex_lock(&pool->mutex);
+  }
+}
+
+#endif
+
+/*! @} */
+/* End of file */
@@ -15,23 +15,35 @@ int main(void)
 	if (!sr) return EXIT_FAILURE;
 
 	srunner_add_suite(sr, create_suite_ASTIndexNameNode());
+	srunner_add_suite(sr, create_suite_batchProcesses());
+	srunner_add_suite(sr, create_suite_batchStream());
+	srunner_add_suite(sr, create_suite_blockDecomposition());
 	srunner_add_suite(sr, create_suite_charBuffer());
+	srunner_add_suite(sr, create_suite_continuation());
 	srunner_add_suite(sr, create_suite_cvodeData());
 	srunner_add_suite(sr, create_suite_cvodeSolver());
 	srunner_add_suite(sr, create_suite_daeSolver());
+	srunner_add_suite(sr, create_suite_ensembleSolver());
+	srunner_add_suite(sr, create_suite_eventQueue());
+	srunner_add_suite(sr, create_suite_globalSensitivity());
 	srunner_add_suite(sr, create_suite_integratorInstance());
 	srunner_add_suite(sr, create_suite_integratorSettings());
+	srunner_add_suite(sr, create_suite_integratorSnapshot());
 	srunner_add_suite(sr, create_suite_interpol());
 	srunner_add_suite(sr, create_suite_modelSimplify());
+	srunner_add_suite(sr, create_suite_multipleShooting());
 	srunner_add_suite(sr, create_suite_nullSolver());
 	srunner_add_suite(sr, create_suite_odeConstruct());
 	srunner_add_suite(sr, create_suite_odeModel());
+	srunner_add_suite(sr, create_suite_odePartition());
 	srunner_add_suite(sr, create_suite_odeSolver());
+	srunner_add_suite(sr, create_suite_parameterEstimation());
 	srunner_add_suite(sr, create_suite_processAST());
 	srunner_add_suite(sr, create_suite_sbml());
 	srunner_add_suite(sr, create_suite_sbmlResults());
 	srunner_add_suite(sr, create_suite_sensSolver());
 	srunner_add_suite(sr, create_suite_solverError());
+	srunner_add_suite(sr, create_suite_stochasticSolver());
 	srunner_add_suite(sr, create_suite_util());
 
 	srunner_run_all(sr, CK_ENV);
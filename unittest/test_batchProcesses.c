@@ -0,0 +1,234 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/batchProcesses.h>
+#include <sbmlsolver/odePartition.h>
+#include <sbmlsolver/odeSolver.h>
+#include <sbmlsolver/sbml.h>
+
+/* the failing workers are only tested if they run in their own
+   processes, see BatchProcesses_isIsolated */
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#define TEST_WORKER_FAILURES 1
+#endif
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static integratorInstance_t *ii = NULL;
+
+static void setup_integratorInstance(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("basic.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 5.0, 10);
+	CvodeSettings_setMethod(cs, 3, 5);
+	CvodeSettings_setErrors(cs, 1e-25, 1e-8, 1000);
+	ii = IntegratorInstance_create(model, cs);
+}
+
+static void teardown_integratorInstance(void)
+{
+	IntegratorInstance_free(ii);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+#ifdef TEST_WORKER_FAILURES
+/* the compiled ODEs of the model, and the index of k_1 */
+static CVRhsFn compiledRhs = NULL;
+
+static int k1 = -1;
+
+/* wraps the compiled ODEs to let the worker abort for k_1 = -1 and
+   hang for k_1 = -2 */
+static int failingRhs(realtype t, N_Vector y, N_Vector ydot, void *data)
+{
+	double k = ((cvodeData_t *)data)->value[k1];
+	if (k == -1.0)
+		abort();
+	if (k == -2.0)
+		for (;;)
+			pause();
+	return compiledRhs(t, y, ydot, data);
+}
+#endif
+
+/* test cases */
+START_TEST(test_IntegratorInstance_batchProcesses)
+{
+	variableIndex_t *vi;
+	cvodeResults_t *results[5];
+	double p[5][1] = { { 0.1 }, { 0.2 }, { 1e6 }, { 0.4 }, { 0.5 } };
+	double *params[5];
+	int status[5], i, n;
+	vi = ODEModel_getVariableIndex(model, "k_1");
+	for (i = 0; i < 5; i++)
+		params[i] = p[i];
+	n = IntegratorInstance_batchProcesses(ii, 1, &vi, 5, params, 2, 0.0, results, status);
+	/* the stiff design point exceeds mxstep */
+	ck_assert_int_eq(n, 4);
+	ck_assert_int_eq(status[2], BATCH_FAILED);
+	ck_assert(results[2] != NULL);
+	ck_assert(results[2]->nout < 10);
+	for (i = 0; i < 5; i++) {
+		if (i == 2)
+			continue;
+		ck_assert_int_eq(status[i], BATCH_COMPLETED);
+		ck_assert_int_eq(results[i]->nout, 10);
+		ck_assert(fabs(results[i]->value[0][10] - results[i]->value[0][0] * exp(-5.0 * p[i][0])) <= 1e-6 * results[i]->value[0][0]);
+	}
+	for (i = 0; i < 5; i++)
+		CvodeResults_free(results[i]);
+	VariableIndex_free(vi);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_batchProcesses_threads)
+{
+	integratorInstance_t *engine;
+	cvodeSettings_t *set;
+	variableIndex_t *vi;
+	cvodeResults_t *results[3];
+	double p[3][1] = { { 0.1 }, { 0.2 }, { 0.3 } };
+	double *params[3];
+	int status[3], i, n;
+	vi = ODEModel_getVariableIndex(model, "k_1");
+	set = CvodeSettings_clone(cs);
+	CvodeSettings_setThreads(set, 2);
+	engine = IntegratorInstance_create(model, set);
+	ck_assert(engine != NULL);
+	ck_assert(engine->data->partition != NULL);
+	/* let the threads of the pool evaluate every phase */
+	ODEPartition_free(engine->data->partition);
+	engine->data->partition = ODEPartition_create(model, engine->data->pool, 0.0);
+	ck_assert(engine->data->partition != NULL);
+	ck_assert_int_eq(IntegratorInstance_integrate(engine), 1);
+	for (i = 0; i < 3; i++)
+		params[i] = p[i];
+	/* the workers inherit the pool without its threads */
+	n = IntegratorInstance_batchProcesses(engine, 1, &vi, 3, params, 2, 5.0, results, status);
+	ck_assert_int_eq(n, 3);
+	for (i = 0; i < 3; i++) {
+		ck_assert_int_eq(status[i], BATCH_COMPLETED);
+		ck_assert_int_eq(results[i]->nout, 10);
+		ck_assert(fabs(results[i]->value[0][10] - results[i]->value[0][0] * exp(-5.0 * p[i][0])) <= 1e-6 * results[i]->value[0][0]);
+		CvodeResults_free(results[i]);
+	}
+	IntegratorInstance_free(engine);
+	CvodeSettings_free(set);
+	VariableIndex_free(vi);
+}
+END_TEST
+
+#ifdef TEST_WORKER_FAILURES
+START_TEST(test_IntegratorInstance_batchProcesses_workerFailures)
+{
+	integratorInstance_t *engine;
+	cvodeSettings_t *set;
+	variableIndex_t *vi;
+	cvodeResults_t *results[5];
+	double p[5][1] = { { 0.1 }, { -1.0 }, { 0.3 }, { -2.0 }, { 0.5 } };
+	double *params[5];
+	int status[5], i, n;
+	vi = ODEModel_getVariableIndex(model, "k_1");
+	k1 = VariableIndex_getIndex(vi);
+	compiledRhs = ODEModel_getCompiledCVODERHSFunction(model);
+	ck_assert(compiledRhs != NULL);
+	model->compiledCVODERhsFunction = failingRhs;
+	set = CvodeSettings_clone(cs);
+	CvodeSettings_setCompileFunctions(set, 1);
+	engine = IntegratorInstance_create(model, set);
+	ck_assert(engine != NULL);
+	for (i = 0; i < 5; i++)
+		params[i] = p[i];
+	n = IntegratorInstance_batchProcesses(engine, 1, &vi, 5, params, 2, 1.0, results, status);
+	/* the aborting and the hanging worker are replaced */
+	ck_assert_int_eq(n, 3);
+	ck_assert_int_eq(status[1], BATCH_CRASHED);
+	ck_assert(results[1] == NULL);
+	ck_assert_int_eq(status[3], BATCH_TIMEOUT);
+	ck_assert(results[3] == NULL);
+	for (i = 0; i < 5; i += 2) {
+		ck_assert_int_eq(status[i], BATCH_COMPLETED);
+		ck_assert_int_eq(results[i]->nout, 10);
+		ck_assert(fabs(results[i]->value[0][10] - results[i]->value[0][0] * exp(-5.0 * p[i][0])) <= 1e-6 * results[i]->value[0][0]);
+		CvodeResults_free(results[i]);
+	}
+	model->compiledCVODERhsFunction = compiledRhs;
+	IntegratorInstance_free(engine);
+	CvodeSettings_free(set);
+	VariableIndex_free(vi);
+}
+END_TEST
+#endif
+
+START_TEST(test_Model_odeSolverBatchProcesses)
+{
+	SBMLDocument_t *doc;
+	SBMLResultsArray_t *resA, *resB;
+	timeCourse_t *tc, *tcB;
+	varySettings_t *vs;
+	double k;
+	int status[6], i, n;
+	doc = parseModel(EXAMPLES_FILENAME("basic.xml"), 0, 1);
+	vs = VarySettings_allocate(1, 6);
+	VarySettings_addParameter(vs, "k_1", "");
+	for (i = 0; i < 6; i++) {
+		k = 0.1 * (i + 1);
+		VarySettings_addDesignPoint(vs, &k);
+	}
+	resA = Model_odeSolverBatchProcesses(SBMLDocument_getModel(doc), cs, vs, 3, 60.0, status);
+	ck_assert(resA != NULL);
+	resB = Model_odeSolverBatch(SBMLDocument_getModel(doc), cs, vs);
+	ck_assert(resB != NULL);
+	for (i = 0; i < 6; i++) {
+		ck_assert_int_eq(status[i], BATCH_COMPLETED);
+		tc = SBMLResults_getTimeCourse(SBMLResultsArray_getResults(resA, i), "S2");
+		tcB = SBMLResults_getTimeCourse(SBMLResultsArray_getResults(resB, i), "S2");
+		for (n = 0; n <= 10; n++)
+			ck_assert(TimeCourse_getValue(tc, n) == TimeCourse_getValue(tcB, n));
+	}
+	SBMLResultsArray_free(resA);
+	SBMLResultsArray_free(resB);
+	VarySettings_free(vs);
+	SBMLDocument_free(doc);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_batchProcesses(void)
+{
+	Suite *s;
+	TCase *tc_IntegratorInstance_batchProcesses;
+	TCase *tc_Model_odeSolverBatchProcesses;
+
+	s = suite_create("batchProcesses");
+
+	tc_IntegratorInstance_batchProcesses = tcase_create("IntegratorInstance_batchProcesses");
+	tcase_add_checked_fixture(tc_IntegratorInstance_batchProcesses,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_batchProcesses, test_IntegratorInstance_batchProcesses);
+	tcase_add_test(tc_IntegratorInstance_batchProcesses, test_IntegratorInstance_batchProcesses_threads);
+#ifdef TEST_WORKER_FAILURES
+	if (BatchProcesses_isIsolated()) {
+		/* the hanging worker is killed after 1-2 s */
+		tcase_set_timeout(tc_IntegratorInstance_batchProcesses, 20);
+		tcase_add_test(tc_IntegratorInstance_batchProcesses, test_IntegratorInstance_batchProcesses_workerFailures);
+	}
+#endif
+	suite_add_tcase(s, tc_IntegratorInstance_batchProcesses);
+
+	tc_Model_odeSolverBatchProcesses = tcase_create("Model_odeSolverBatchProcesses");
+	tcase_add_checked_fixture(tc_Model_odeSolverBatchProcesses,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_Model_odeSolverBatchProcesses, test_Model_odeSolverBatchProcesses);
+	suite_add_tcase(s, tc_Model_odeSolverBatchProcesses);
+
+	return s;
+}
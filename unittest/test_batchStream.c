@@ -0,0 +1,165 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/batchStream.h>
+#include <sbmlsolver/odeSolver.h>
+#include <sbmlsolver/sbml.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static integratorInstance_t *ii = NULL;
+
+static variableIndex_t *vi[2];
+
+static double p[4][1] = { { 0.1 }, { 0.2 }, { 0.3 }, { 0.4 } };
+
+static double *params[4];
+
+static void setup_integratorInstance(void)
+{
+	int i;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("basic.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 5.0, 10);
+	CvodeSettings_setErrors(cs, 1e-25, 1e-8, 10000);
+	ii = IntegratorInstance_create(model, cs);
+	vi[0] = ODEModel_getVariableIndex(model, "k_1");
+	vi[1] = ODEModel_getVariableIndex(model, "S1");
+	for (i = 0; i < 4; i++)
+		params[i] = p[i];
+}
+
+static void teardown_integratorInstance(void)
+{
+	VariableIndex_free(vi[0]);
+	VariableIndex_free(vi[1]);
+	IntegratorInstance_free(ii);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+/* records the design points, stops after `stop' of them */
+struct record
+{
+	int stop;
+	int n;
+	int stored;
+};
+
+static int check_point(const batchPoint_t *view, void *userData)
+{
+	struct record *rec = userData;
+	double s0;
+	ck_assert_int_eq(view->point, rec->n);
+	ck_assert(view->params[0] == p[rec->n][0]);
+	ck_assert_int_eq(view->completed, 1);
+	ck_assert_int_eq(view->nout, 10);
+	ck_assert_int_eq(view->nobs, 1);
+	ck_assert_int_eq(view->hasObjective, 0);
+	/* S1 decays from its initial value */
+	s0 = view->max[0];
+	ck_assert(fabs(view->final[0] - s0 * exp(-5.0 * p[rec->n][0])) <= 1e-6 * s0);
+	ck_assert(view->min[0] == view->final[0]);
+	if (rec->stored) {
+		ck_assert(view->time != NULL);
+		ck_assert(view->time[10] == 5.0);
+		ck_assert(view->value[0][0] == s0);
+		ck_assert(view->value[0][10] == view->final[0]);
+	}
+	else {
+		ck_assert(view->time == NULL);
+		ck_assert(view->value == NULL);
+	}
+	rec->n++;
+	return rec->n != rec->stop;
+}
+
+/* test cases */
+START_TEST(test_IntegratorInstance_batchStream)
+{
+	struct record rec = { 0, 0, 1 };
+	int n;
+	n = IntegratorInstance_batchStream(ii, 1, vi, 4, params, 1, &vi[1], check_point, &rec);
+	ck_assert_int_eq(n, 4);
+	ck_assert_int_eq(rec.n, 4);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_batchStream_noResults)
+{
+	struct record rec = { 0, 0, 0 };
+	int n;
+	IntegratorInstance_free(ii);
+	CvodeSettings_setStoreResults(cs, 0);
+	ii = IntegratorInstance_create(model, cs);
+	n = IntegratorInstance_batchStream(ii, 1, vi, 4, params, 1, &vi[1], check_point, &rec);
+	ck_assert_int_eq(n, 4);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_batchStream_stop)
+{
+	struct record rec = { 2, 0, 1 };
+	int n;
+	n = IntegratorInstance_batchStream(ii, 1, vi, 4, params, 1, &vi[1], check_point, &rec);
+	ck_assert_int_eq(n, 2);
+}
+END_TEST
+
+START_TEST(test_Model_odeSolverBatchStream)
+{
+	SBMLDocument_t *doc;
+	varySettings_t *vs;
+	struct record rec = { 0, 0, 1 };
+	char *observables[1];
+	int i, n;
+	doc = parseModel(EXAMPLES_FILENAME("basic.xml"), 0, 1);
+	vs = VarySettings_allocate(1, 4);
+	VarySettings_addParameter(vs, "k_1", "");
+	for (i = 0; i < 4; i++)
+		VarySettings_addDesignPoint(vs, p[i]);
+	observables[0] = "S1";
+	n = Model_odeSolverBatchStream(SBMLDocument_getModel(doc), cs, vs, 1, observables, check_point, &rec);
+	ck_assert_int_eq(n, 4);
+	/* unknown observable */
+	observables[0] = "S3";
+	n = Model_odeSolverBatchStream(SBMLDocument_getModel(doc), cs, vs, 1, observables, check_point, &rec);
+	ck_assert_int_eq(n, -1);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE), SOLVER_ERROR_SYMBOL_IS_NOT_IN_MODEL);
+	SolverError_clear();
+	VarySettings_free(vs);
+	SBMLDocument_free(doc);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_batchStream(void)
+{
+	Suite *s;
+	TCase *tc_IntegratorInstance_batchStream;
+	TCase *tc_Model_odeSolverBatchStream;
+
+	s = suite_create("batchStream");
+
+	tc_IntegratorInstance_batchStream = tcase_create("IntegratorInstance_batchStream");
+	tcase_add_checked_fixture(tc_IntegratorInstance_batchStream,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_batchStream, test_IntegratorInstance_batchStream);
+	tcase_add_test(tc_IntegratorInstance_batchStream, test_IntegratorInstance_batchStream_noResults);
+	tcase_add_test(tc_IntegratorInstance_batchStream, test_IntegratorInstance_batchStream_stop);
+	suite_add_tcase(s, tc_IntegratorInstance_batchStream);
+
+	tc_Model_odeSolverBatchStream = tcase_create("Model_odeSolverBatchStream");
+	tcase_add_checked_fixture(tc_Model_odeSolverBatchStream,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_Model_odeSolverBatchStream, test_Model_odeSolverBatchStream);
+	suite_add_tcase(s, tc_Model_odeSolverBatchStream);
+
+	return s;
+}
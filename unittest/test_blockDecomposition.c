@@ -0,0 +1,215 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/integratorInstance.h>
+#include <sbmlsolver/blockDecomposition.h>
+#include <sbmlsolver/processAST.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static integratorInstance_t *ii = NULL;
+
+/* a feed-forward system: x0 and x4 drive the cycle of x1 and x2,
+   which drives x3 through the rule r, and x3 and x4 drive x5 */
+static void setup_feedForward(void)
+{
+	const char *formula[7] = {
+		"-x0", "x0 - x1*x2", "x1 - x2", "r - x3", "-0.5*x4",
+		"x4 + x3 - k*x5", "x2*x2"
+	};
+	char *names[8] = { "x0", "x1", "x2", "x3", "x4", "x5", "r", "k" };
+	double values[8] = { 1.0, 1.1, 1.2, 1.3, 1.4, 1.5, 1.44, 2.0 };
+	ASTNode_t *f[7];
+	int i;
+
+	for (i = 0; i < 7; i++)
+		f[i] = SBML_parseFormula(formula[i]);
+	model = ODEModel_createFromODEs(f, 6, 1, 1, names, values, NULL);
+	for (i = 0; i < 7; i++)
+		ASTNode_free(f[i]);
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 10.0, 20);
+	CvodeSettings_setErrors(cs, 1e-12, 1e-10, 10000);
+	ii = IntegratorInstance_create(model, cs);
+}
+
+static void setup_MAPK(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 1000.0, 100);
+	CvodeSettings_setErrors(cs, 1e-12, 1e-10, 10000);
+	ii = IntegratorInstance_create(model, cs);
+}
+
+static void teardown_blockDecomposition(void)
+{
+	IntegratorInstance_free(ii);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+/* compares the results of the blocks with those of ii */
+static void check_results(blockDecomposition_t *bd, double tolerance)
+{
+	const cvodeResults_t *res, *res2;
+	int i, k;
+	ck_assert_int_eq(IntegratorInstance_integrate(ii), 1);
+	res = IntegratorInstance_getResults(ii);
+	res2 = BlockDecomposition_getResults(bd);
+	ck_assert_int_eq(res2->nout, res->nout);
+	for (k = 0; k <= res->nout; k++)
+	{
+		CHECK_DOUBLE_WITH_TOLERANCE(res2->time[k], res->time[k]);
+		for (i = 0; i < model->neq + model->nass; i++)
+			ck_assert(fabs(res2->value[i][k] - res->value[i][k]) <=
+					  tolerance * (fabs(res->value[i][k]) + 1e-6));
+	}
+}
+
+/* test cases */
+START_TEST(test_IntegratorInstance_createBlockDecomposition)
+{
+	blockDecomposition_t *bd;
+	int b, l;
+	bd = IntegratorInstance_createBlockDecomposition(ii);
+	ck_assert(bd != NULL);
+	ck_assert_int_eq(BlockDecomposition_getNumBlocks(bd), 5);
+	ck_assert_int_eq(BlockDecomposition_getNumLevels(bd), 4);
+	/* the cycle is one block */
+	ck_assert_int_eq(BlockDecomposition_getBlock(bd, 1),
+					 BlockDecomposition_getBlock(bd, 2));
+	ck_assert_int_eq(BlockDecomposition_getBlockSize(bd,
+					 BlockDecomposition_getBlock(bd, 1)), 2);
+	ck_assert_int_eq(BlockDecomposition_getBlockSize(bd,
+					 BlockDecomposition_getBlock(bd, 3)), 1);
+	ck_assert_int_eq(BlockDecomposition_getBlock(bd, 6), -1);
+	ck_assert_int_eq(BlockDecomposition_getBlockSize(bd, 5), 0);
+	/* upstream first */
+	ck_assert(BlockDecomposition_getBlock(bd, 0) < BlockDecomposition_getBlock(bd, 1));
+	ck_assert(BlockDecomposition_getBlock(bd, 1) < BlockDecomposition_getBlock(bd, 3));
+	ck_assert(BlockDecomposition_getBlock(bd, 3) < BlockDecomposition_getBlock(bd, 5));
+	ck_assert(BlockDecomposition_getBlock(bd, 4) < BlockDecomposition_getBlock(bd, 5));
+	/* x0 and x4 are independent, the first level */
+	ck_assert_int_eq(bd->levelStart[1], 2);
+	ck_assert(BlockDecomposition_getBlock(bd, 0) < 2);
+	ck_assert(BlockDecomposition_getBlock(bd, 4) < 2);
+	for (l = 0; l < bd->nlevels; l++)
+		for (b = bd->levelStart[l]; b < bd->levelStart[l+1]; b++)
+			ck_assert_int_eq(bd->blocks[b].level, l);
+	/* x3 reads x2 through the rule */
+	b = BlockDecomposition_getBlock(bd, 3);
+	ck_assert_int_eq(bd->blocks[b].ninputs, 1);
+	ck_assert_int_eq(bd->blocks[b].input[0], 2);
+	ck_assert_int_eq(bd->blocks[b].nrules, 1);
+	BlockDecomposition_free(bd);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_createBlockDecomposition_events)
+{
+	IntegratorInstance_free(ii);
+	ODEModel_free(model);
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("events-1-event-1-assignment-l2.xml"));
+	ii = IntegratorInstance_create(model, cs);
+	ck_assert(IntegratorInstance_createBlockDecomposition(ii) == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE),
+					 SOLVER_ERROR_INTEGRATOR_SETTINGS);
+	SolverError_clear();
+}
+END_TEST
+
+START_TEST(test_BlockDecomposition_setBlockErrors)
+{
+	blockDecomposition_t *bd;
+	bd = IntegratorInstance_createBlockDecomposition(ii);
+	ck_assert_int_eq(BlockDecomposition_setBlockErrors(bd, 0, 1e-14, 1e-12), 1);
+	CHECK_DOUBLE_WITH_TOLERANCE(bd->blocks[0].reltol, 1e-12);
+	ck_assert_int_eq(BlockDecomposition_setBlockErrors(bd, 5, 1e-14, 1e-12), 0);
+	ck_assert_int_eq(BlockDecomposition_setBlockMethod(bd, 4, 1, 1), 1);
+	ck_assert_int_eq(bd->blocks[4].iteration, 1);
+	ck_assert_int_eq(BlockDecomposition_setBlockJacobian(bd, -1, 0), 0);
+	SolverError_clear();
+	BlockDecomposition_free(bd);
+}
+END_TEST
+
+START_TEST(test_BlockDecomposition_integrate)
+{
+	blockDecomposition_t *bd;
+	const cvodeResults_t *res;
+	double x[8];
+	int i;
+	bd = IntegratorInstance_createBlockDecomposition(ii);
+	/* the non-stiff source blocks by ADAMS-MOULTON without Newton matrix */
+	BlockDecomposition_setBlockMethod(bd, BlockDecomposition_getBlock(bd, 0), 1, 1);
+	BlockDecomposition_setBlockMethod(bd, BlockDecomposition_getBlock(bd, 4), 1, 1);
+	ck_assert_int_eq(BlockDecomposition_integrate(bd, 1), 1);
+	check_results(bd, 1e-6);
+	/* exp(-t) from the dense output between the output times */
+	ck_assert(fabs(BlockDecomposition_getValue(bd, 0, 2.25) - exp(-2.25)) <= 1e-7);
+	res = BlockDecomposition_getResults(bd);
+	for (i = 0; i < 8; i++)
+		x[i] = res->value[i][res->nout];
+	/* the blocks of a level concurrently */
+	ck_assert_int_eq(BlockDecomposition_integrate(bd, 2), 1);
+	for (i = 0; i < 8; i++)
+		ck_assert(res->value[i][res->nout] == x[i]);
+	BlockDecomposition_free(bd);
+}
+END_TEST
+
+START_TEST(test_BlockDecomposition_integrate_MAPK)
+{
+	blockDecomposition_t *bd;
+	int b, n;
+	bd = IntegratorInstance_createBlockDecomposition(ii);
+	ck_assert(bd != NULL);
+	for (b = 0, n = 0; b < BlockDecomposition_getNumBlocks(bd); b++)
+		n += BlockDecomposition_getBlockSize(bd, b);
+	ck_assert_int_eq(n, model->neq);
+	ck_assert_int_eq(BlockDecomposition_integrate(bd, 0), 1);
+	check_results(bd, 1e-6);
+	BlockDecomposition_free(bd);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_blockDecomposition(void)
+{
+	Suite *s;
+	TCase *tc_IntegratorInstance_createBlockDecomposition;
+	TCase *tc_BlockDecomposition_integrate;
+	TCase *tc_BlockDecomposition_integrate_MAPK;
+
+	s = suite_create("blockDecomposition");
+
+	tc_IntegratorInstance_createBlockDecomposition = tcase_create("IntegratorInstance_createBlockDecomposition");
+	tcase_add_checked_fixture(tc_IntegratorInstance_createBlockDecomposition,
+							  setup_feedForward,
+							  teardown_blockDecomposition);
+	tcase_add_test(tc_IntegratorInstance_createBlockDecomposition, test_IntegratorInstance_createBlockDecomposition);
+	tcase_add_test(tc_IntegratorInstance_createBlockDecomposition, test_IntegratorInstance_createBlockDecomposition_events);
+	tcase_add_test(tc_IntegratorInstance_createBlockDecomposition, test_BlockDecomposition_setBlockErrors);
+	suite_add_tcase(s, tc_IntegratorInstance_createBlockDecomposition);
+
+	tc_BlockDecomposition_integrate = tcase_create("BlockDecomposition_integrate");
+	tcase_add_checked_fixture(tc_BlockDecomposition_integrate,
+							  setup_feedForward,
+							  teardown_blockDecomposition);
+	tcase_add_test(tc_BlockDecomposition_integrate, test_BlockDecomposition_integrate);
+	suite_add_tcase(s, tc_BlockDecomposition_integrate);
+
+	tc_BlockDecomposition_integrate_MAPK = tcase_create("BlockDecomposition_integrate_MAPK");
+	tcase_add_checked_fixture(tc_BlockDecomposition_integrate_MAPK,
+							  setup_MAPK,
+							  teardown_blockDecomposition);
+	tcase_add_test(tc_BlockDecomposition_integrate_MAPK, test_BlockDecomposition_integrate_MAPK);
+	suite_add_tcase(s, tc_BlockDecomposition_integrate_MAPK);
+
+	return s;
+}
@@ -0,0 +1,164 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/continuation.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static integratorInstance_t *ii = NULL;
+
+static void setup_integratorInstance(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("bistable.xml"));
+	cs = CvodeSettings_create();
+	ii = IntegratorInstance_create(model, cs);
+}
+
+static void teardown_integratorInstance(void)
+{
+	IntegratorInstance_free(ii);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+/* test cases */
+START_TEST(test_IntegratorInstance_continuation_fold)
+{
+	continuationBranch_t *cb;
+	variableIndex_t *k0, *X;
+	int i, n;
+	k0 = ODEModel_getVariableIndex(model, "k0");
+	X = ODEModel_getVariableIndex(model, "X");
+	cb = IntegratorInstance_continuation(ii, k0, 0.0, 0.2, 0.01, 500);
+	ck_assert(cb != NULL);
+	n = ContinuationBranch_getNumPoints(cb);
+	ck_assert(n > 2);
+	/* X = 0 at k0 = 0, and the upper branch at k0 = 0.2 */
+	ck_assert(ContinuationBranch_getParameter(cb, 0) == 0.0);
+	ck_assert(fabs(ContinuationBranch_getValue(cb, 0, X)) <= 1e-10);
+	ck_assert(ContinuationBranch_getValue(cb, n-1, X) > 1.0);
+	/* the branch turns back twice, around the unstable middle part */
+	ck_assert_int_eq(ContinuationBranch_getNumBifurcations(cb), 2);
+	ck_assert_int_eq(ContinuationBranch_getBifurcationType(cb, 0), BIFURCATION_FOLD);
+	ck_assert_int_eq(ContinuationBranch_getBifurcationType(cb, 1), BIFURCATION_FOLD);
+	ck_assert(fabs(ContinuationBranch_getBifurcationParameter(cb, 0) - 0.08339) <= 1e-3);
+	ck_assert(fabs(ContinuationBranch_getBifurcationParameter(cb, 1) - 0.04749) <= 1e-3);
+	for (i = 0; i < n; i++) {
+		if (i < cb->bifurcation[0].point || i >= cb->bifurcation[1].point)
+			ck_assert_int_eq(ContinuationBranch_isStable(cb, i), 1);
+		else
+			ck_assert_int_eq(ContinuationBranch_isStable(cb, i), 0);
+	}
+	/* the current values are the first steady state */
+	ck_assert(IntegratorInstance_getVariableValue(ii, k0) == 0.0);
+	ContinuationBranch_free(cb);
+	VariableIndex_free(k0);
+	VariableIndex_free(X);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_continuation_Hopf)
+{
+	continuationBranch_t *cb;
+	odeModel_t *om;
+	integratorInstance_t *ii2;
+	variableIndex_t *b;
+	int n;
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("brusselator.xml"));
+	ii2 = IntegratorInstance_create(om, cs);
+	b = ODEModel_getVariableIndex(om, "b");
+	cb = IntegratorInstance_continuation(ii2, b, 0.5, 3.0, 0.05, 500);
+	ck_assert(cb != NULL);
+	n = ContinuationBranch_getNumPoints(cb);
+	/* with a = 1, the steady state loses its stability at b = 2,
+	   with eigenvalues +-i */
+	ck_assert_int_eq(ContinuationBranch_getNumBifurcations(cb), 1);
+	ck_assert_int_eq(ContinuationBranch_getBifurcationType(cb, 0), BIFURCATION_HOPF);
+	ck_assert(fabs(ContinuationBranch_getBifurcationParameter(cb, 0) - 2.0) <= 1e-3);
+	ck_assert(fabs(cb->bifurcation[0].omega - 1.0) <= 1e-2);
+	ck_assert_int_eq(ContinuationBranch_isStable(cb, 0), 1);
+	ck_assert_int_eq(ContinuationBranch_isStable(cb, n-1), 0);
+	ck_assert_int_eq(cb->nunstable[n-1], 2);
+	ContinuationBranch_free(cb);
+	VariableIndex_free(b);
+	IntegratorInstance_free(ii2);
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_continuation_conservationLaws)
+{
+	continuationBranch_t *cb;
+	odeModel_t *om;
+	integratorInstance_t *ii2;
+	variableIndex_t *V1;
+	int i, n;
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	ii2 = IntegratorInstance_create(om, cs);
+	V1 = ODEModel_getVariableIndex(om, "V1");
+	IntegratorInstance_setVariableValue(ii2, V1, 0.1);
+	cb = IntegratorInstance_continuation(ii2, V1, 0.1, 2.5, 2.0, 1000);
+	ck_assert(cb != NULL);
+	ck_assert_int_eq(cb->ncons, 3);
+	n = ContinuationBranch_getNumPoints(cb);
+	/* the totals of the kinase levels stay constant */
+	for (i = 0; i < n; i++) {
+		ck_assert(fabs(cb->x[i][0] + cb->x[i][1] - 100.0) <= 1e-6);
+		ck_assert(fabs(cb->x[i][2] + cb->x[i][3] + cb->x[i][4] - 300.0) <= 1e-6);
+	}
+	/* the cascade oscillates at V1 = 2.5 */
+	ck_assert_int_eq(ContinuationBranch_isStable(cb, 0), 1);
+	ck_assert_int_eq(ContinuationBranch_isStable(cb, n-1), 0);
+	ck_assert_int_eq(ContinuationBranch_getNumBifurcations(cb), 1);
+	ck_assert_int_eq(ContinuationBranch_getBifurcationType(cb, 0), BIFURCATION_HOPF);
+	ck_assert(ContinuationBranch_getBifurcationParameter(cb, 0) > 0.3);
+	ck_assert(ContinuationBranch_getBifurcationParameter(cb, 0) < 0.5);
+	ContinuationBranch_free(cb);
+	VariableIndex_free(V1);
+	IntegratorInstance_free(ii2);
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_continuation_invalid)
+{
+	variableIndex_t *k0, *X;
+	k0 = ODEModel_getVariableIndex(model, "k0");
+	X = ODEModel_getVariableIndex(model, "X");
+	/* ODE variables are not parameters */
+	ck_assert(IntegratorInstance_continuation(ii, X, 0.0, 1.0, 0.01, 10) == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE), SOLVER_ERROR_REQUESTED_PARAMETER_NOT_FOUND);
+	SolverError_clear();
+	/* the current value must be within the bounds */
+	ck_assert(IntegratorInstance_continuation(ii, k0, 0.1, 0.2, 0.01, 10) == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE), SOLVER_ERROR_INTEGRATOR_SETTINGS);
+	SolverError_clear();
+	VariableIndex_free(k0);
+	VariableIndex_free(X);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_continuation(void)
+{
+	Suite *s;
+	TCase *tc_IntegratorInstance_continuation;
+
+	s = suite_create("continuation");
+
+	tc_IntegratorInstance_continuation = tcase_create("IntegratorInstance_continuation");
+	tcase_add_checked_fixture(tc_IntegratorInstance_continuation,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_continuation, test_IntegratorInstance_continuation_fold);
+	tcase_add_test(tc_IntegratorInstance_continuation, test_IntegratorInstance_continuation_Hopf);
+	tcase_add_test(tc_IntegratorInstance_continuation, test_IntegratorInstance_continuation_conservationLaws);
+	tcase_add_test(tc_IntegratorInstance_continuation, test_IntegratorInstance_continuation_invalid);
+	suite_add_tcase(s, tc_IntegratorInstance_continuation);
+
+	return s;
+}
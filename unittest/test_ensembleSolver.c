@@ -0,0 +1,190 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/ensembleSolver.h>
+#include <sbmlsolver/odeSolver.h>
+#include <sbmlsolver/sbml.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static ensembleSolver_t *ens = NULL;
+
+static void setup_ensembleSolver(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 1000.0, 100);
+	CvodeSettings_setMethod(cs, 3, 5);
+	CvodeSettings_setCompileFunctions(cs, 0);
+	ens = NULL;
+}
+
+static void teardown_ensembleSolver(void)
+{
+	EnsembleSolver_free(ens);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+static const double V1[3] = { 2.5, 2.0, 3.0 };
+
+/* integrates lane l with the scalar RK45 solver and compares */
+static void compare_lane(int l)
+{
+	integratorInstance_t *ii;
+	variableIndex_t *vi;
+	const cvodeResults_t *res, *lane;
+	int i, k;
+	vi = ODEModel_getVariableIndex(model, "V1");
+	ii = IntegratorInstance_create(model, cs);
+	IntegratorInstance_setVariableValue(ii, vi, V1[l]);
+	ck_assert_int_eq(IntegratorInstance_integrate(ii), 1);
+	res = IntegratorInstance_getResults(ii);
+	lane = EnsembleSolver_getResults(ens, l);
+	ck_assert_int_eq(lane->nout, res->nout);
+	for (k = 0; k <= res->nout; k++) {
+		ck_assert(lane->time[k] == res->time[k]);
+		for (i = 0; i < 8; i++)
+			ck_assert(fabs(lane->value[i][k] - res->value[i][k]) <= 1e-3 * fabs(res->value[i][k]) + 1e-6);
+	}
+	IntegratorInstance_free(ii);
+	VariableIndex_free(vi);
+}
+
+static void integrate_lanes(void)
+{
+	variableIndex_t *vi;
+	int l;
+	ens = EnsembleSolver_create(model, cs, 3);
+	ck_assert(ens != NULL);
+	vi = ODEModel_getVariableIndex(model, "V1");
+	for (l = 0; l < 3; l++)
+		ck_assert_int_eq(EnsembleSolver_setValue(ens, vi, l, V1[l]), 1);
+	ck_assert(EnsembleSolver_getValue(ens, vi, 1) == 2.0);
+	VariableIndex_free(vi);
+	ck_assert_int_eq(EnsembleSolver_integrate(ens), 1);
+}
+
+/* test cases */
+START_TEST(test_EnsembleSolver_integrate)
+{
+	int l;
+	integrate_lanes();
+	for (l = 0; l < 3; l++)
+		compare_lane(l);
+	EnsembleSolver_printStatistics(ens, stdout);
+}
+END_TEST
+
+START_TEST(test_EnsembleSolver_integrate_compiled)
+{
+	CvodeSettings_setCompileFunctions(cs, 1);
+	integrate_lanes();
+	ck_assert(ens->rhs != NULL);
+	compare_lane(0);
+	compare_lane(2);
+}
+END_TEST
+
+START_TEST(test_EnsembleSolver_reset)
+{
+	variableIndex_t *vi;
+	const cvodeResults_t *res;
+	integrate_lanes();
+	EnsembleSolver_reset(ens);
+	vi = ODEModel_getVariableIndex(model, "V1");
+	ck_assert(EnsembleSolver_getValue(ens, vi, 2) == 2.5);
+	VariableIndex_free(vi);
+	res = EnsembleSolver_getResults(ens, 0);
+	ck_assert_int_eq(res->nout, 0);
+	ck_assert(EnsembleSolver_getResults(ens, 3) == NULL);
+}
+END_TEST
+
+START_TEST(test_EnsembleSolver_create_events)
+{
+	odeModel_t *om;
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("events-1-event-1-assignment-l2.xml"));
+	ck_assert(om != NULL);
+	ens = EnsembleSolver_create(om, cs, 4);
+	ck_assert(ens == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE),
+					 SOLVER_ERROR_INTEGRATOR_SETTINGS);
+	SolverError_clear();
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_Model_odeSolverEnsemble)
+{
+	SBMLDocument_t *doc;
+	SBMLResultsArray_t *resA;
+	SBMLResults_t *res;
+	timeCourse_t *tc;
+	varySettings_t *vs;
+	double k, s0;
+	int i;
+	doc = parseModel(EXAMPLES_FILENAME("basic.xml"), 0, 1);
+	CvodeSettings_setTime(cs, 5.0, 10);
+	CvodeSettings_setErrors(cs, 1e-25, 1e-8, 100000);
+	/* more design points than lanes */
+	vs = VarySettings_allocate(1, 10);
+	VarySettings_addParameter(vs, "k_1", "");
+	for (i = 0; i < 10; i++) {
+		k = 0.1 * (i + 1);
+		VarySettings_addDesignPoint(vs, &k);
+	}
+	resA = Model_odeSolverEnsemble(SBMLDocument_getModel(doc), cs, vs);
+	ck_assert(resA != NULL);
+	ck_assert_int_eq(SBMLResultsArray_getNumResults(resA), 10);
+	for (i = 0; i < 10; i++) {
+		res = SBMLResultsArray_getResults(resA, i);
+		tc = SBMLResults_getTimeCourse(res, "S1");
+		s0 = TimeCourse_getValue(tc, 0);
+		ck_assert(fabs(TimeCourse_getValue(tc, 10) - s0 * exp(-0.5 * (i + 1))) <= 1e-6 * s0);
+	}
+	SBMLResultsArray_free(resA);
+	VarySettings_free(vs);
+	SBMLDocument_free(doc);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_ensembleSolver(void)
+{
+	Suite *s;
+	TCase *tc_EnsembleSolver_integrate;
+	TCase *tc_EnsembleSolver_create;
+	TCase *tc_Model_odeSolverEnsemble;
+
+	s = suite_create("ensembleSolver");
+
+	tc_EnsembleSolver_integrate = tcase_create("EnsembleSolver_integrate");
+	tcase_add_checked_fixture(tc_EnsembleSolver_integrate,
+							  setup_ensembleSolver,
+							  teardown_ensembleSolver);
+	tcase_add_test(tc_EnsembleSolver_integrate, test_EnsembleSolver_integrate);
+	tcase_add_test(tc_EnsembleSolver_integrate, test_EnsembleSolver_integrate_compiled);
+	tcase_add_test(tc_EnsembleSolver_integrate, test_EnsembleSolver_reset);
+	suite_add_tcase(s, tc_EnsembleSolver_integrate);
+
+	tc_EnsembleSolver_create = tcase_create("EnsembleSolver_create");
+	tcase_add_checked_fixture(tc_EnsembleSolver_create,
+							  setup_ensembleSolver,
+							  teardown_ensembleSolver);
+	tcase_add_test(tc_EnsembleSolver_create, test_EnsembleSolver_create_events);
+	suite_add_tcase(s, tc_EnsembleSolver_create);
+
+	tc_Model_odeSolverEnsemble = tcase_create("Model_odeSolverEnsemble");
+	tcase_add_checked_fixture(tc_Model_odeSolverEnsemble,
+							  setup_ensembleSolver,
+							  teardown_ensembleSolver);
+	tcase_add_test(tc_Model_odeSolverEnsemble, test_Model_odeSolverEnsemble);
+	suite_add_tcase(s, tc_Model_odeSolverEnsemble);
+
+	return s;
+}
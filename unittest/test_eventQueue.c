@@ -0,0 +1,100 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/eventQueue.h>
+
+/* test cases */
+START_TEST(test_EventQueue_create)
+{
+  eventQueue_t *q;
+
+  q = EventQueue_create();
+  ck_assert(q != NULL);
+  ck_assert_int_eq(EventQueue_isEmpty(q), 1);
+  ck_assert_int_eq(EventQueue_getSize(q), 0);
+  EventQueue_free(q);
+}
+END_TEST
+
+START_TEST(test_EventQueue_free)
+{
+  EventQueue_free(NULL); /* deleting NULL is safe */
+}
+END_TEST
+
+START_TEST(test_EventQueue_push)
+{
+  eventQueue_t *q;
+  int i;
+
+  q = EventQueue_create();
+  /* more events than the initial capacity, in reverse order */
+  for (i = 0; i < 20; i++)
+    EventQueue_push(q, 24.0 * (20 - i), i);
+  EventQueue_push(q, 48.0, 0); /* simultaneous with event 18 */
+  ck_assert_int_eq(EventQueue_getSize(q), 21);
+  CHECK_DOUBLE_WITH_TOLERANCE(EventQueue_getTime(q), 24.0);
+  ck_assert_int_eq(EventQueue_getEvent(q), 19);
+  EventQueue_pop(q);
+  /* simultaneous events are ordered by their index */
+  CHECK_DOUBLE_WITH_TOLERANCE(EventQueue_getTime(q), 48.0);
+  ck_assert_int_eq(EventQueue_getEvent(q), 0);
+  EventQueue_pop(q);
+  CHECK_DOUBLE_WITH_TOLERANCE(EventQueue_getTime(q), 48.0);
+  ck_assert_int_eq(EventQueue_getEvent(q), 18);
+  EventQueue_free(q);
+}
+END_TEST
+
+START_TEST(test_EventQueue_pop)
+{
+  eventQueue_t *q;
+  double last;
+  int i;
+
+  q = EventQueue_create();
+  for (i = 0; i < 50; i++)
+    EventQueue_push(q, (double)((i * 37) % 50), i);
+  last = -1.0;
+  for (i = 0; i < 50; i++) {
+    ck_assert(EventQueue_getTime(q) > last);
+    last = EventQueue_getTime(q);
+    EventQueue_pop(q);
+  }
+  ck_assert_int_eq(EventQueue_isEmpty(q), 1);
+  EventQueue_push(q, 1.0, 3);
+  EventQueue_clear(q);
+  ck_assert_int_eq(EventQueue_isEmpty(q), 1);
+  EventQueue_free(q);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_eventQueue(void)
+{
+  Suite *s;
+  TCase *tc_EventQueue_create;
+  TCase *tc_EventQueue_free;
+  TCase *tc_EventQueue_push;
+  TCase *tc_EventQueue_pop;
+
+  s = suite_create("eventQueue");
+
+  tc_EventQueue_create = tcase_create("EventQueue_create");
+  tcase_add_test(tc_EventQueue_create, test_EventQueue_create);
+  suite_add_tcase(s, tc_EventQueue_create);
+
+  tc_EventQueue_free = tcase_create("EventQueue_free");
+  tcase_add_test(tc_EventQueue_free, test_EventQueue_free);
+  suite_add_tcase(s, tc_EventQueue_free);
+
+  tc_EventQueue_push = tcase_create("EventQueue_push");
+  tcase_add_test(tc_EventQueue_push, test_EventQueue_push);
+  suite_add_tcase(s, tc_EventQueue_push);
+
+  tc_EventQueue_pop = tcase_create("EventQueue_pop");
+  tcase_add_test(tc_EventQueue_pop, test_EventQueue_pop);
+  suite_add_tcase(s, tc_EventQueue_pop);
+
+  return s;
+}
@@ -0,0 +1,188 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/globalSensitivity.h>
+#include <sbmlsolver/odeSolver.h>
+#include <sbmlsolver/sbml.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static varySettings_t *vs = NULL;
+
+static const double lower[2] = { 0.1, 0.01 };
+
+static const double upper[2] = { 1.0, 1.0 };
+
+static const int logscale[2] = { 0, 1 };
+
+static void setup_vs(void)
+{
+	vs = VarySettings_allocate(2, 64 * 4);
+	VarySettings_addParameter(vs, "k_1", "");
+	VarySettings_addParameter(vs, "k_2", "");
+}
+
+static void teardown_vs(void)
+{
+	VarySettings_free(vs);
+}
+
+/* test cases */
+START_TEST(test_VarySettings_setLatinHypercube)
+{
+	int i, j, r, count[2][256];
+	double u;
+	r = VarySettings_setLatinHypercube(vs, lower, upper, logscale, 42);
+	ck_assert_int_eq(r, 1);
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < 256; i++) {
+		ck_assert(vs->params[i][0] >= lower[0] && vs->params[i][0] <= upper[0]);
+		ck_assert(vs->params[i][1] >= lower[1] && vs->params[i][1] <= upper[1]);
+		/* each stratum is hit once */
+		u = (vs->params[i][0] - lower[0]) / (upper[0] - lower[0]);
+		count[0][(int) (u * 256)]++;
+		u = log(vs->params[i][1] / lower[1]) / log(upper[1] / lower[1]);
+		count[1][(int) (u * 256)]++;
+	}
+	for (j = 0; j < 2; j++)
+		for (i = 0; i < 256; i++)
+			ck_assert_int_eq(count[j][i], 1);
+}
+END_TEST
+
+START_TEST(test_VarySettings_setSaltelliDesign)
+{
+	int i, r;
+	double **p;
+	r = VarySettings_setSaltelliDesign(vs, lower, upper, NULL, 0);
+	ck_assert_int_eq(r, 1);
+	p = vs->params;
+	/* the first Sobol point is the center */
+	ck_assert(fabs(p[0][0] - 0.55) <= 1e-12);
+	for (i = 0; i < 256; i += 4) {
+		ck_assert(p[i+2][0] == p[i+1][0]);
+		ck_assert(p[i+2][1] == p[i][1]);
+		ck_assert(p[i+3][0] == p[i][0]);
+		ck_assert(p[i+3][1] == p[i+1][1]);
+	}
+}
+END_TEST
+
+START_TEST(test_VarySettings_setSaltelliDesign_invalid)
+{
+	varySettings_t *vs2;
+	double lo[3] = { 1.0, 1.0, 1.0 }, up[3] = { 2.0, 2.0, 2.0 };
+	int lg[3] = { 1, 0, 0 };
+	vs2 = VarySettings_allocate(3, 12);
+	/* not a multiple of 5 */
+	ck_assert_int_eq(VarySettings_setSaltelliDesign(vs2, lo, up, NULL, 0), 0);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE), SOLVER_ERROR_VARY_SETTINGS);
+	SolverError_clear();
+	VarySettings_free(vs2);
+	/* log ranges must be positive */
+	lo[0] = 0.0;
+	vs2 = VarySettings_allocate(3, 15);
+	ck_assert_int_eq(VarySettings_setSaltelliDesign(vs2, lo, up, lg, 0), 0);
+	SolverError_clear();
+	VarySettings_free(vs2);
+}
+END_TEST
+
+START_TEST(test_SobolIndices_additive)
+{
+	varySettings_t *vs2;
+	sobolIndices_t *si;
+	double lo[2] = { 0.0, 0.0 }, up[2] = { 1.0, 1.0 };
+	double fA[1], fB[1], fAB0[1], fAB1[1], *fAB[2];
+	double **p;
+	int i;
+	/* f = x + 2y on the unit square: S = ST = 1/5, 4/5 */
+	vs2 = VarySettings_allocate(2, 1024 * 4);
+	VarySettings_setSaltelliDesign(vs2, lo, up, NULL, 0);
+	p = vs2->params;
+	si = SobolIndices_create(2, 1);
+	fAB[0] = fAB0;
+	fAB[1] = fAB1;
+	for (i = 0; i < 1024 * 4; i += 4) {
+		fA[0] = p[i][0] + 2 * p[i][1];
+		fB[0] = p[i+1][0] + 2 * p[i+1][1];
+		fAB0[0] = p[i+2][0] + 2 * p[i+2][1];
+		fAB1[0] = p[i+3][0] + 2 * p[i+3][1];
+		SobolIndices_addSample(si, fA, fB, fAB);
+	}
+	ck_assert_int_eq(SobolIndices_getNumSamples(si), 1024);
+	ck_assert(fabs(SobolIndices_getVariance(si, 0) - 5.0 / 12) <= 0.01);
+	ck_assert(fabs(SobolIndices_getFirstOrder(si, 0, 0) - 0.2) <= 0.02);
+	ck_assert(fabs(SobolIndices_getFirstOrder(si, 1, 0) - 0.8) <= 0.02);
+	ck_assert(fabs(SobolIndices_getTotal(si, 0, 0) - 0.2) <= 0.02);
+	ck_assert(fabs(SobolIndices_getTotal(si, 1, 0) - 0.8) <= 0.02);
+	SobolIndices_free(si);
+	VarySettings_free(vs2);
+}
+END_TEST
+
+START_TEST(test_Model_sobolIndices)
+{
+	SBMLDocument_t *doc;
+	cvodeSettings_t *cs;
+	sobolIndices_t *si, *si2;
+	char *observables[1];
+	int i;
+	doc = parseModel(EXAMPLES_FILENAME("basic.xml"), 0, 1);
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 5.0, 10);
+	CvodeSettings_setErrors(cs, 1e-25, 1e-8, 10000);
+	VarySettings_setSaltelliDesign(vs, lower, upper, logscale, 0);
+	observables[0] = "S1";
+	si = Model_sobolIndices(SBMLDocument_getModel(doc), cs, vs, 1, observables, SOBOL_FINAL, 1);
+	ck_assert(si != NULL);
+	ck_assert_int_eq(SobolIndices_getNumSamples(si), 64);
+	ck_assert(SobolIndices_getVariance(si, 0) > 0.0);
+	for (i = 0; i < 2; i++) {
+		ck_assert(SobolIndices_getFirstOrder(si, i, 0) > -0.1);
+		ck_assert(SobolIndices_getTotal(si, i, 0) < 1.1);
+		ck_assert(SobolIndices_getTotal(si, i, 0) >= SobolIndices_getFirstOrder(si, i, 0) - 0.1);
+	}
+	/* worker processes give the same estimators */
+	si2 = Model_sobolIndices(SBMLDocument_getModel(doc), cs, vs, 1, observables, SOBOL_FINAL, 2);
+	ck_assert(si2 != NULL);
+	ck_assert_int_eq(SobolIndices_getNumSamples(si2), 64);
+	for (i = 0; i < 2; i++) {
+		ck_assert(SobolIndices_getFirstOrder(si2, i, 0) == SobolIndices_getFirstOrder(si, i, 0));
+		ck_assert(SobolIndices_getTotal(si2, i, 0) == SobolIndices_getTotal(si, i, 0));
+	}
+	SobolIndices_free(si);
+	SobolIndices_free(si2);
+	CvodeSettings_free(cs);
+	SBMLDocument_free(doc);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_globalSensitivity(void)
+{
+	Suite *s;
+	TCase *tc_VarySettings_design;
+	TCase *tc_SobolIndices;
+
+	s = suite_create("globalSensitivity");
+
+	tc_VarySettings_design = tcase_create("VarySettings_design");
+	tcase_add_checked_fixture(tc_VarySettings_design,
+							  setup_vs,
+							  teardown_vs);
+	tcase_add_test(tc_VarySettings_design, test_VarySettings_setLatinHypercube);
+	tcase_add_test(tc_VarySettings_design, test_VarySettings_setSaltelliDesign);
+	tcase_add_test(tc_VarySettings_design, test_VarySettings_setSaltelliDesign_invalid);
+	suite_add_tcase(s, tc_VarySettings_design);
+
+	tc_SobolIndices = tcase_create("SobolIndices");
+	tcase_add_checked_fixture(tc_SobolIndices,
+							  setup_vs,
+							  teardown_vs);
+	tcase_add_test(tc_SobolIndices, test_SobolIndices_additive);
+	tcase_add_test(tc_SobolIndices, test_Model_sobolIndices);
+	suite_add_tcase(s, tc_SobolIndices);
+
+	return s;
+}
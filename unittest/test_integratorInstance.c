@@ -2,6 +2,7 @@
 #include "unittest.h"
 
 #include <sbmlsolver/integratorInstance.h>
+#include <sbmlsolver/processAST.h>
 
 /* fixtures */
 static odeModel_t *model;
@@ -46,6 +47,232 @@ START_TEST(test_IntegratorInstance_integrate)
 }
 END_TEST
 
+START_TEST(test_IntegratorInstance_integrate_piecewise)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	variableIndex_t *vx, *vy;
+	int r, tstop;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("piecewise.xml"));
+	ck_assert_int_eq(ODEModel_getNumRoots(model), 2);
+	vx = ODEModel_getVariableIndex(model, "x");
+	vy = ODEModel_getVariableIndex(model, "y");
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 10.0, 10);
+	/* root functions locate the switches, TSTOP mode is still available */
+	for (tstop = 0; tstop <= 1; tstop++) {
+		CvodeSettings_setTStop(cs, tstop);
+		ii = IntegratorInstance_create(model, cs);
+		r = IntegratorInstance_integrate(ii);
+		ck_assert_int_eq(r, 1);
+		ck_assert(fabs(IntegratorInstance_getVariableValue(ii, vx)) <= 1e-4);
+		ck_assert(fabs(IntegratorInstance_getVariableValue(ii, vy) - 4.0) <= 1e-4);
+		IntegratorInstance_free(ii);
+	}
+	VariableIndex_free(vx);
+	VariableIndex_free(vy);
+	CvodeSettings_free(cs);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_integrate_timedEvents)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	variableIndex_t *vx;
+	double expected;
+	int r;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("dosing.xml"));
+	ck_assert_int_eq(model->ntimedEvents, 2);
+	vx = ODEModel_getVariableIndex(model, "x");
+	/* doses at t = 2.5 and t = 3.75 lie between output times */
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 4.0, 4);
+	CvodeSettings_setErrors(cs, 1e-12, 1e-10, 10000);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	expected = ((exp(-1.25) + 1.0) * exp(-0.625) + 1.0) * exp(-0.125);
+	ck_assert(fabs(IntegratorInstance_getVariableValue(ii, vx) - expected) <= 1e-6);
+	IntegratorInstance_free(ii);
+	VariableIndex_free(vx);
+	CvodeSettings_free(cs);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_integrate_denseOutput)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	variableIndex_t *vi;
+	double stepped, dense, expected;
+	int r;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	vi = ODEModel_getVariableIndex(model, "MAPK_PP");
+	/* a fine output grid */
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 1000.0, 2000);
+	CvodeSettings_setErrors(cs, 1e-12, 1e-10, 10000);
+	ck_assert_int_eq(CvodeSettings_getDenseOutput(cs), 0);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	stepped = IntegratorInstance_getVariableValue(ii, vi);
+	IntegratorInstance_free(ii);
+	CvodeSettings_setDenseOutput(cs, 1);
+	ck_assert_int_eq(CvodeSettings_getDenseOutput(cs), 1);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	CHECK_DOUBLE_WITH_TOLERANCE(IntegratorInstance_getTime(ii), 1000.0);
+	dense = IntegratorInstance_getVariableValue(ii, vi);
+	ck_assert(fabs(dense - stepped) <= 1e-6 * fabs(stepped));
+	IntegratorInstance_free(ii);
+	VariableIndex_free(vi);
+	ODEModel_free(model);
+	/* events between output times still stop the solver */
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("dosing.xml"));
+	vi = ODEModel_getVariableIndex(model, "x");
+	CvodeSettings_setTime(cs, 4.0, 4);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	expected = ((exp(-1.25) + 1.0) * exp(-0.625) + 1.0) * exp(-0.125);
+	ck_assert(fabs(IntegratorInstance_getVariableValue(ii, vi) - expected) <= 1e-6);
+	IntegratorInstance_free(ii);
+	VariableIndex_free(vi);
+	CvodeSettings_free(cs);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_integrate_autoMethod)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	variableIndex_t *vi;
+	double bdf, automatic;
+	int r;
+	FILE *fp;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	vi = ODEModel_getVariableIndex(model, "MAPK_PP");
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 1000.0, 100);
+	CvodeSettings_setErrors(cs, 1e-12, 1e-10, 10000);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	bdf = IntegratorInstance_getVariableValue(ii, vi);
+	IntegratorInstance_free(ii);
+	CvodeSettings_setMethod(cs, 2, 5);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	automatic = IntegratorInstance_getVariableValue(ii, vi);
+	ck_assert(fabs(automatic - bdf) <= 1e-6 * fabs(bdf));
+	/* a rerun starts with Adams-Moulton again */
+	IntegratorInstance_reset(ii);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	ck_assert(fabs(IntegratorInstance_getVariableValue(ii, vi) - automatic) <= 1e-6 * fabs(bdf));
+	OPEN_TMPFILE_OR_ABORT(fp);
+	IntegratorInstance_printStatistics(ii, fp);
+	fclose(fp);
+	VariableIndex_free(vi);
+	CvodeSettings_free(cs);
+	IntegratorInstance_free(ii);
+}
+END_TEST
+
+/* Robertson's stiff chemical kinetics */
+START_TEST(test_IntegratorInstance_integrate_autoMethod_stiff)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	const char *formula[3] = {
+		"-0.04*y1 + 1e4*y2*y3", "0.04*y1 - 1e4*y2*y3 - 3e7*y2*y2", "3e7*y2*y2"
+	};
+	char *names[3] = { "y1", "y2", "y3" };
+	double values[3] = { 1.0, 0.0, 0.0 };
+	double bdf[3];
+	ASTNode_t *f[3];
+	int i, r;
+	for (i = 0; i < 3; i++)
+		f[i] = SBML_parseFormula(formula[i]);
+	model = ODEModel_createFromODEs(f, 3, 0, 0, names, values, NULL);
+	for (i = 0; i < 3; i++)
+		ASTNode_free(f[i]);
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 10.0, 1000);
+	CvodeSettings_setErrors(cs, 1e-12, 1e-8, 10000);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	for (i = 0; i < 3; i++)
+		bdf[i] = ii->data->value[i];
+	IntegratorInstance_free(ii);
+	CvodeSettings_setMethod(cs, 2, 5);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	/* the fast transient makes Adams-Moulton switch to BDF */
+	ck_assert(ii->solver->nswitch >= 1);
+	ck_assert_int_eq(ii->solver->stiff, 1);
+	for (i = 0; i < 3; i++)
+		ck_assert(fabs(ii->data->value[i] - bdf[i]) <= 1e-5 * fabs(bdf[i]) + 1e-10);
+	CvodeSettings_free(cs);
+	IntegratorInstance_free(ii);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_integrate_rk)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	variableIndex_t *vi;
+	double bdf, expected;
+	int r, method;
+	FILE *fp;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	vi = ODEModel_getVariableIndex(model, "MAPK_PP");
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 1000.0, 100);
+	CvodeSettings_setErrors(cs, 1e-12, 1e-10, 100000);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	bdf = IntegratorInstance_getVariableValue(ii, vi);
+	IntegratorInstance_free(ii);
+	/* RK45 and Rosenbrock */
+	for ( method = 3; method < 5; method++ )
+	{
+		CvodeSettings_setMethod(cs, method, 5);
+		ii = IntegratorInstance_create(model, cs);
+		r = IntegratorInstance_integrate(ii);
+		ck_assert_int_eq(r, 1);
+		ck_assert(fabs(IntegratorInstance_getVariableValue(ii, vi) - bdf) <= 1e-4 * fabs(bdf));
+		OPEN_TMPFILE_OR_ABORT(fp);
+		IntegratorInstance_printStatistics(ii, fp);
+		fclose(fp);
+		IntegratorInstance_free(ii);
+	}
+	VariableIndex_free(vi);
+	ODEModel_free(model);
+	/* events between output times */
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("dosing.xml"));
+	vi = ODEModel_getVariableIndex(model, "x");
+	CvodeSettings_setTime(cs, 4.0, 4);
+	CvodeSettings_setMethod(cs, 3, 5);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	expected = ((exp(-1.25) + 1.0) * exp(-0.625) + 1.0) * exp(-0.125);
+	ck_assert(fabs(IntegratorInstance_getVariableValue(ii, vi) - expected) <= 1e-6);
+	IntegratorInstance_free(ii);
+	VariableIndex_free(vi);
+	CvodeSettings_free(cs);
+}
+END_TEST
+
 START_TEST(test_IntegratorInstance_getResults)
 {
 	integratorInstance_t *ii;
@@ -140,6 +367,107 @@ START_TEST(test_IntegratorInstance_printStatistics)
 }
 END_TEST
 
+START_TEST(test_IntegratorInstance_compileFunctions)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	variableIndex_t *vi;
+	double interpreted, compiled;
+	int r, steady;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	vi = ODEModel_getVariableIndex(model, "MAPK_PP");
+	cs = CvodeSettings_create();
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	interpreted = IntegratorInstance_getVariableValue(ii, vi);
+	steady = IntegratorInstance_checkSteadyState(ii);
+	IntegratorInstance_free(ii);
+	/* the same run with compiled functions */
+	CvodeSettings_setCompileFunctions(cs, 1);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	ck_assert(model->compiledAssignmentFunction != NULL);
+	ck_assert(model->compiledSteadyStateFunction != NULL);
+	compiled = IntegratorInstance_getVariableValue(ii, vi);
+	ck_assert(fabs(compiled - interpreted) <= 1e-6 * fabs(interpreted));
+	ck_assert_int_eq(IntegratorInstance_checkSteadyState(ii), steady);
+	VariableIndex_free(vi);
+	CvodeSettings_free(cs);
+	IntegratorInstance_free(ii);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_compileFunctions_chunked)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	variableIndex_t *vi;
+	double interpreted, compiled;
+	int r;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	vi = ODEModel_getVariableIndex(model, "MAPK_PP");
+	cs = CvodeSettings_create();
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	interpreted = IntegratorInstance_getVariableValue(ii, vi);
+	IntegratorInstance_free(ii);
+	/* split all functions into helpers of 2 statements */
+	ODEModel_setCompileChunkSize(model, 2);
+	ck_assert_int_eq(ODEModel_setCompileOptimization(model, -1, 0), 1);
+	ck_assert_int_eq(ODEModel_setCompileOptimization(model, COMPILE_RHS, 2), 1);
+	ck_assert_int_eq(ODEModel_setCompileOptimization(model, COMPILE_NKINDS, 2), 0);
+	ck_assert_int_eq(ODEModel_setCompileOptimization(model, COMPILE_RHS, 4), 0);
+	CvodeSettings_setCompileFunctions(cs, 1);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	ck_assert(model->compiledCVODERhsFunction != NULL);
+	compiled = IntegratorInstance_getVariableValue(ii, vi);
+	ck_assert(fabs(compiled - interpreted) <= 1e-6 * fabs(interpreted));
+	VariableIndex_free(vi);
+	CvodeSettings_free(cs);
+	IntegratorInstance_free(ii);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_compileFunctions_libtcc)
+{
+	integratorInstance_t *ii;
+	cvodeSettings_t *cs;
+	variableIndex_t *vi;
+	double interpreted, compiled;
+	int r;
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	ck_assert_int_eq(ODEModel_setCompileBackend(model, COMPILER_SYSTEM), 1);
+	if (!Compiler_hasBackend(COMPILER_LIBTCC)) {
+		ck_assert_int_eq(ODEModel_setCompileBackend(model, COMPILER_LIBTCC), 0);
+		return;
+	}
+	vi = ODEModel_getVariableIndex(model, "MAPK_PP");
+	cs = CvodeSettings_create();
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	interpreted = IntegratorInstance_getVariableValue(ii, vi);
+	IntegratorInstance_free(ii);
+	/* the same run compiled in memory */
+	ck_assert_int_eq(ODEModel_setCompileBackend(model, COMPILER_LIBTCC), 1);
+	CvodeSettings_setCompileFunctions(cs, 1);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	ck_assert(model->compiledCVODEFunctionCode != NULL);
+	compiled = IntegratorInstance_getVariableValue(ii, vi);
+	ck_assert(fabs(compiled - interpreted) <= 1e-6 * fabs(interpreted));
+	VariableIndex_free(vi);
+	CvodeSettings_free(cs);
+	IntegratorInstance_free(ii);
+}
+END_TEST
+
 START_TEST(test_IntegratorInstance_free)
 {
 	IntegratorInstance_free(NULL); /* freeing NULL is safe */
@@ -157,6 +485,7 @@ Suite *create_suite_integratorInstance(void)
 	TCase *tc_IntegratorInstance_printResults;
 	TCase *tc_IntegratorInstance_updateModel;
 	TCase *tc_IntegratorInstance_printStatistics;
+	TCase *tc_IntegratorInstance_compileFunctions;
 	TCase *tc_IntegratorInstance_free;
 
 	s = suite_create("integratorInstance");
@@ -173,6 +502,12 @@ Suite *create_suite_integratorInstance(void)
 							  NULL,
 							  teardown_model);
 	tcase_add_test(tc_IntegratorInstance_integrate, test_IntegratorInstance_integrate);
+	tcase_add_test(tc_IntegratorInstance_integrate, test_IntegratorInstance_integrate_piecewise);
+	tcase_add_test(tc_IntegratorInstance_integrate, test_IntegratorInstance_integrate_timedEvents);
+	tcase_add_test(tc_IntegratorInstance_integrate, test_IntegratorInstance_integrate_denseOutput);
+	tcase_add_test(tc_IntegratorInstance_integrate, test_IntegratorInstance_integrate_autoMethod);
+	tcase_add_test(tc_IntegratorInstance_integrate, test_IntegratorInstance_integrate_autoMethod_stiff);
+	tcase_add_test(tc_IntegratorInstance_integrate, test_IntegratorInstance_integrate_rk);
 	suite_add_tcase(s, tc_IntegratorInstance_integrate);
 
 	tc_IntegratorInstance_getResults = tcase_create("IntegratorInstance_getResults");
@@ -210,6 +545,15 @@ Suite *create_suite_integratorInstance(void)
 	tcase_add_test(tc_IntegratorInstance_printStatistics, test_IntegratorInstance_printStatistics);
 	suite_add_tcase(s, tc_IntegratorInstance_printStatistics);
 
+	tc_IntegratorInstance_compileFunctions = tcase_create("IntegratorInstance_compileFunctions");
+	tcase_add_checked_fixture(tc_IntegratorInstance_compileFunctions,
+							  NULL,
+							  teardown_model);
+	tcase_add_test(tc_IntegratorInstance_compileFunctions, test_IntegratorInstance_compileFunctions);
+	tcase_add_test(tc_IntegratorInstance_compileFunctions, test_IntegratorInstance_compileFunctions_chunked);
+	tcase_add_test(tc_IntegratorInstance_compileFunctions, test_IntegratorInstance_compileFunctions_libtcc);
+	suite_add_tcase(s, tc_IntegratorInstance_compileFunctions);
+
 	tc_IntegratorInstance_free = tcase_create("IntegratorInstance_free");
 	tcase_add_test(tc_IntegratorInstance_free, test_IntegratorInstance_free);
 	suite_add_tcase(s, tc_IntegratorInstance_free);
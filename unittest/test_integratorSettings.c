@@ -67,6 +67,14 @@ START_TEST(test_CvodeSettings_getMethod)
   cvodeSettings_t *cs;
   cs = CvodeSettings_create();
   ck_assert_str_eq(CvodeSettings_getMethod(cs), "BDF");
+  CvodeSettings_setMethod(cs, 2, 5);
+  ck_assert_str_eq(CvodeSettings_getMethod(cs), "AUTO");
+  CvodeSettings_setMethod(cs, 3, 5);
+  ck_assert_str_eq(CvodeSettings_getMethod(cs), "RK45");
+  CvodeSettings_setMethod(cs, 4, 5);
+  ck_assert_str_eq(CvodeSettings_getMethod(cs), "ROSENBROCK");
+  CvodeSettings_setMethod(cs, 5, 5); /* invalid, ignored */
+  ck_assert_str_eq(CvodeSettings_getMethod(cs), "ROSENBROCK");
   CvodeSettings_free(cs);
 }
 END_TEST
@@ -89,6 +97,18 @@ START_TEST(test_CvodeSettings_getSensMethod)
 }
 END_TEST
 
+START_TEST(test_CvodeSettings_getAdjMemory)
+{
+  cvodeSettings_t *cs;
+  cs = CvodeSettings_create();
+  ck_assert(CvodeSettings_getAdjMemory(cs) == 0.0);
+  CvodeSettings_setAdjMemory(cs, 1e6, 1000);
+  ck_assert(CvodeSettings_getAdjMemory(cs) == 1e6);
+  ck_assert_int_eq(cs->AdjExpectedSteps, 1000);
+  CvodeSettings_free(cs);
+}
+END_TEST
+
 /* public */
 Suite *create_suite_integratorSettings(void)
 {
@@ -102,6 +122,7 @@ Suite *create_suite_integratorSettings(void)
   TCase *tc_CvodeSettings_getMethod;
   TCase *tc_CvodeSettings_getIterMethod;
   TCase *tc_CvodeSettings_getSensMethod;
+  TCase *tc_CvodeSettings_getAdjMemory;
 
 	s = suite_create("integratorSettings");
 
@@ -141,5 +162,9 @@ Suite *create_suite_integratorSettings(void)
   tcase_add_test(tc_CvodeSettings_getSensMethod, test_CvodeSettings_getSensMethod);
   suite_add_tcase(s, tc_CvodeSettings_getSensMethod);
 
+  tc_CvodeSettings_getAdjMemory = tcase_create("CvodeSettings_getAdjMemory");
+  tcase_add_test(tc_CvodeSettings_getAdjMemory, test_CvodeSettings_getAdjMemory);
+  suite_add_tcase(s, tc_CvodeSettings_getAdjMemory);
+
 	return s;
 }
@@ -0,0 +1,195 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/integratorSnapshot.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static integratorInstance_t *ii = NULL;
+
+static void setup_integratorInstance(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 1000.0, 100);
+	ii = IntegratorInstance_create(model, cs);
+}
+
+static void teardown_integratorInstance(void)
+{
+	IntegratorInstance_free(ii);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+static void integrate_steps(integratorInstance_t *ii, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+		ck_assert_int_eq(IntegratorInstance_integrateOneStep(ii), 1);
+}
+
+/* test cases */
+START_TEST(test_IntegratorInstance_restore)
+{
+	integratorSnapshot_t *snap;
+	double x[8];
+	int i, r;
+	integrate_steps(ii, 50);
+	snap = IntegratorInstance_snapshot(ii);
+	ck_assert(snap != NULL);
+	CHECK_DOUBLE_WITH_TOLERANCE(IntegratorSnapshot_getTime(snap), 500.0);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	for (i = 0; i < 8; i++)
+		x[i] = ii->data->value[i];
+	/* go back to t = 500 and integrate again */
+	r = IntegratorInstance_restore(ii, snap);
+	ck_assert_int_eq(r, 1);
+	CHECK_DOUBLE_WITH_TOLERANCE(IntegratorInstance_getTime(ii), 500.0);
+	ck_assert_int_eq(IntegratorInstance_timeCourseCompleted(ii), 0);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	CHECK_DOUBLE_WITH_TOLERANCE(IntegratorInstance_getTime(ii), 1000.0);
+	for (i = 0; i < 8; i++)
+		ck_assert(fabs(ii->data->value[i] - x[i]) <= 1e-6 * fabs(x[i]));
+	IntegratorSnapshot_free(snap);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_restore_differentModel)
+{
+	integratorSnapshot_t *snap;
+	integratorInstance_t *ii2;
+	odeModel_t *om;
+	int r;
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("basic.xml"));
+	ii2 = IntegratorInstance_create(om, cs);
+	snap = IntegratorInstance_snapshot(ii2);
+	ck_assert(snap != NULL);
+	r = IntegratorInstance_restore(ii, snap);
+	ck_assert_int_eq(r, 0);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE),
+					 SOLVER_ERROR_ATTEMPTING_TO_COPY_VARIABLE_STATE_BETWEEN_INSTANCES_OF_DIFFERENT_MODELS);
+	SolverError_clear();
+	IntegratorSnapshot_free(snap);
+	IntegratorInstance_free(ii2);
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_fork)
+{
+	integratorInstance_t *ii2;
+	const cvodeResults_t *res, *res2;
+	int i, k, r;
+	/* the built-in RK45 solver continues exactly */
+	IntegratorInstance_free(ii);
+	CvodeSettings_setMethod(cs, 3, 5);
+	ii = IntegratorInstance_create(model, cs);
+	integrate_steps(ii, 50);
+	ii2 = IntegratorInstance_fork(ii);
+	ck_assert(ii2 != NULL);
+	ck_assert(ii2->om == ii->om);
+	CHECK_DOUBLE_WITH_TOLERANCE(IntegratorInstance_getTime(ii2), 500.0);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	r = IntegratorInstance_integrate(ii2);
+	ck_assert_int_eq(r, 1);
+	res = IntegratorInstance_getResults(ii);
+	res2 = IntegratorInstance_getResults(ii2);
+	ck_assert_int_eq(res2->nout, res->nout);
+	for (k = 0; k <= res->nout; k++)
+		for (i = 0; i < 8; i++)
+			ck_assert(fabs(res2->value[i][k] - res->value[i][k]) <= 1e-12 * fabs(res->value[i][k]));
+	IntegratorInstance_free(ii2);
+}
+END_TEST
+
+START_TEST(test_IntegratorSnapshot_write)
+{
+	integratorSnapshot_t *snap, *snap2;
+	integratorInstance_t *ii2;
+	FILE *fp;
+	int i, r;
+	integrate_steps(ii, 10);
+	snap = IntegratorInstance_snapshot(ii);
+	OPEN_TMPFILE_OR_ABORT(fp);
+	r = IntegratorSnapshot_write(snap, fp);
+	ck_assert_int_eq(r, 1);
+	rewind(fp);
+	snap2 = IntegratorSnapshot_read(fp);
+	fclose(fp);
+	ck_assert(snap2 != NULL);
+	ck_assert(snap2->om == NULL);
+	ck_assert(snap2->t == snap->t);
+	ck_assert(snap2->h == snap->h);
+	ck_assert_int_eq(snap2->iout, snap->iout);
+	for (i = 0; i < snap->nvalues; i++)
+		ck_assert(snap2->value[i] == snap->value[i]);
+	/* continue in a fresh instance */
+	ii2 = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_restore(ii2, snap2);
+	ck_assert_int_eq(r, 1);
+	CHECK_DOUBLE_WITH_TOLERANCE(IntegratorInstance_getTime(ii2), 100.0);
+	for (i = 0; i < 8; i++)
+		ck_assert(ii2->data->value[i] == ii->data->value[i]);
+	r = IntegratorInstance_integrate(ii2);
+	ck_assert_int_eq(r, 1);
+	IntegratorInstance_free(ii2);
+	IntegratorSnapshot_free(snap);
+	IntegratorSnapshot_free(snap2);
+}
+END_TEST
+
+START_TEST(test_IntegratorSnapshot_read_invalid)
+{
+	FILE *fp;
+	OPEN_TMPFILE_OR_ABORT(fp);
+	fprintf(fp, "no snapshot\n");
+	rewind(fp);
+	ck_assert(IntegratorSnapshot_read(fp) == NULL);
+	fclose(fp);
+	SolverError_clear();
+}
+END_TEST
+
+/* public */
+Suite *create_suite_integratorSnapshot(void)
+{
+	Suite *s;
+	TCase *tc_IntegratorInstance_restore;
+	TCase *tc_IntegratorInstance_fork;
+	TCase *tc_IntegratorSnapshot_write;
+
+	s = suite_create("integratorSnapshot");
+
+	tc_IntegratorInstance_restore = tcase_create("IntegratorInstance_restore");
+	tcase_add_checked_fixture(tc_IntegratorInstance_restore,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_restore, test_IntegratorInstance_restore);
+	tcase_add_test(tc_IntegratorInstance_restore, test_IntegratorInstance_restore_differentModel);
+	suite_add_tcase(s, tc_IntegratorInstance_restore);
+
+	tc_IntegratorInstance_fork = tcase_create("IntegratorInstance_fork");
+	tcase_add_checked_fixture(tc_IntegratorInstance_fork,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_fork, test_IntegratorInstance_fork);
+	suite_add_tcase(s, tc_IntegratorInstance_fork);
+
+	tc_IntegratorSnapshot_write = tcase_create("IntegratorSnapshot_write");
+	tcase_add_checked_fixture(tc_IntegratorSnapshot_write,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorSnapshot_write, test_IntegratorSnapshot_write);
+	tcase_add_test(tc_IntegratorSnapshot_write, test_IntegratorSnapshot_read_invalid);
+	suite_add_tcase(s, tc_IntegratorSnapshot_write);
+
+	return s;
+}
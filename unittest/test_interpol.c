@@ -2,6 +2,7 @@
 #include "unittest.h"
 
 #include <sbmlsolver/interpol.h>
+#include <sbmlsolver/solverError.h>
 
 /* fixtures */
 static const char *vars[] = {"MAPK", "MAPK_PP", "MKKK", "MKK_PP"};
@@ -93,7 +94,93 @@ START_TEST(test_read_data)
   ck_assert(ts->warn != NULL);
   ck_assert_int_eq(ts->warn[0], 0);
   ck_assert_int_eq(ts->warn[1], 0);
+  ck_assert(ts->time[1] == 10);
+  ck_assert(ts->data[0][1] == 279.88);
+  ck_assert(ts->data[1][1] == 9.01507);
+  ck_assert(ts->data[2][1] == 80.718);
+  ck_assert(ts->data[3][1] == 8.68109);
+  ck_assert(ts->time[10] == 100);
+  ck_assert(ts->data[3][10] == 56.6475);
+  free_data(ts);
+}
+END_TEST
+
+START_TEST(test_read_data_formats)
+{
+  static const char *file = "test_interpol.dat";
+  static const char *names[] = {"y", "x"};
+  time_series_t *ts;
+  FILE *fp;
+  fp = fopen(file, "w");
+  ck_assert(fp != NULL);
+  fprintf(fp, "# comment before header\n");
+  fprintf(fp, "\n");
+  fprintf(fp, "#t\tx  z y\n");
+  fprintf(fp, "0 1e-3 -7 -2.5E+2\n");
+  fprintf(fp, "# comment between rows\n");
+  fprintf(fp, "\t0.5\t.25 0 +0.1\r\n");
+  fprintf(fp, "1.0 0.30000000000000004441 1 1e30\n");
+  fprintf(fp, "2 000123.4500 2 -0");
+  fclose(fp);
+  ts = read_data(file, 2, (char **)names);
+  remove(file);
+  ck_assert(ts != NULL);
+  ck_assert_int_eq(ts->n_data, 2);
+  ck_assert_int_eq(ts->n_time, 4);
+  ck_assert(ts->time[0] == 0.0);
+  ck_assert(ts->time[1] == 0.5);
+  ck_assert(ts->time[2] == 1.0);
+  ck_assert(ts->time[3] == 2.0);
+  ck_assert(ts->data[1][0] == 1e-3);
+  ck_assert(ts->data[1][1] == 0.25);
+  ck_assert(ts->data[1][2] == 0.30000000000000004441);
+  ck_assert(ts->data[1][3] == 123.45);
+  ck_assert(ts->data[0][0] == -250.0);
+  ck_assert(ts->data[0][1] == 0.1);
+  ck_assert(ts->data[0][2] == 1e30);
+  ck_assert(ts->data[0][3] == 0.0);
+  free_data(ts);
+}
+END_TEST
+
+START_TEST(test_read_data_cached)
+{
+  static const char *cache = "test_interpol.tsc";
+  time_series_t *ts, *tc;
+  int i, j;
+  remove(cache);
+  ts = read_data_cached(EXAMPLES_FILENAME("MAPK_10pt.dat"), cache,
+                        n_vars, (char **)vars);
+  ck_assert(ts != NULL);
+  /* second call loads the cache written by the first one */
+  tc = read_data_cached(EXAMPLES_FILENAME("MAPK_10pt.dat"), cache,
+                        n_vars, (char **)vars);
+  ck_assert(tc != NULL);
+  ck_assert_int_eq(tc->n_var, ts->n_var);
+  ck_assert_int_eq(tc->n_data, ts->n_data);
+  ck_assert_int_eq(tc->n_time, ts->n_time);
+  ck_assert_int_eq(tc->type, ts->type);
+  ck_assert(tc->warn != NULL);
+  for (i=0;i<n_vars;i++) {
+    ck_assert_str_eq(tc->var[i], vars[i]);
+    for (j=0;j<ts->n_time;j++) {
+      ck_assert(tc->data[i][j] == ts->data[i][j]);
+      ck_assert(tc->data2[i][j] == ts->data2[i][j]);
+    }
+  }
+  for (j=0;j<ts->n_time;j++) {
+    ck_assert(tc->time[j] == ts->time[j]);
+  }
+  free_data(tc);
+  /* a different variable list does not match the cache */
+  tc = read_data_cached(EXAMPLES_FILENAME("MAPK_10pt.dat"), cache,
+                        n_vars - 1, (char **)vars);
+  ck_assert(tc != NULL);
+  ck_assert_int_eq(tc->n_var, n_vars - 1);
+  ck_assert_int_eq(tc->n_data, n_vars - 1);
+  free_data(tc);
   free_data(ts);
+  remove(cache);
 }
 END_TEST
 
@@ -258,6 +345,57 @@ START_TEST(test_linint)
 }
 END_TEST
 
+START_TEST(test_call_cursor)
+{
+  time_series_t *ts;
+  ts_cursor_t *c;
+  double x, y;
+  int i, j, k;
+  ts = read_data(EXAMPLES_FILENAME("MAPK_10pt.dat"), n_vars, (char **)vars);
+  ck_assert(ts != NULL);
+  ck_assert_int_eq(ts->n_spline, n_vars);
+  /* the cursor does not tabulate missing coefficients itself */
+  free(ts->spline_var);
+  ts->spline_var = NULL;
+  ck_assert(create_cursor(ts) == NULL);
+  ck_assert_int_eq(SolverError_getLastCode(FATAL_ERROR_TYPE), SOLVER_ERROR_AST_EVALUATION_FAILED_MISSING_VALUE);
+  SolverError_clear();
+  ck_assert_int_eq(spline_coefficients(ts), 1);
+  c = create_cursor(ts);
+  ck_assert(c != NULL);
+  /* forward, then backward: the cursor agrees with splint */
+  for (k=0;k<2;k++) {
+    for (i=0;i<=200;i++) {
+      x = (k == 0) ? 0.5 * i : 100.0 - 0.5 * i;
+      for (j=0;j<n_vars;j++) {
+        int last = 0;
+        if (x >= 100.0) y = ts->data[j][ts->n_time-1];
+        else splint(ts->n_time, ts->time, ts->data[j], ts->data2[j], x, &y, &last);
+        ck_assert(fabs(call_cursor(j, x, c) - y) <= 1e-10 * (1.0 + fabs(y)));
+      }
+    }
+  }
+  ck_assert_int_eq(c->warn[0], 0);
+  ck_assert_int_eq(c->warn[1], 1); /* x = 100 is the right boundary */
+  /* out of range */
+  call_all(-1.0, c);
+  ck_assert_int_eq(c->last, -1);
+  ck_assert(c->value[0] == ts->data[0][0]);
+  ck_assert_int_eq(c->warn[0], 1);
+  call_all(1000.0, c);
+  ck_assert_int_eq(c->last, ts->n_time - 1);
+  ck_assert(c->value[3] == ts->data[3][ts->n_time-1]);
+  ck_assert_int_eq(c->warn[1], 2);
+  /* data points */
+  call_all(20.0, c);
+  ck_assert_int_eq(c->last, 2);
+  CHECK_DOUBLE_WITH_TOLERANCE(c->value[0], 280.012);
+  CHECK_DOUBLE_WITH_TOLERANCE(c->value[1], 8.13013);
+  free_cursor(c);
+  free_data(ts);
+}
+END_TEST
+
 /* public */
 Suite *create_suite_interpol(void)
 {
@@ -266,11 +404,13 @@ Suite *create_suite_interpol(void)
   TCase *tc_read_columns;
   TCase *tc_free_data;
   TCase *tc_read_data;
+  TCase *tc_read_data_cached;
   TCase *tc_bisection;
   TCase *tc_hunt;
   TCase *tc_spline;
   TCase *tc_splint;
   TCase *tc_linint;
+  TCase *tc_call_cursor;
 
   s = suite_create("interpol");
 
@@ -288,8 +428,13 @@ Suite *create_suite_interpol(void)
 
   tc_read_data = tcase_create("read_data");
   tcase_add_test(tc_read_data, test_read_data);
+  tcase_add_test(tc_read_data, test_read_data_formats);
   suite_add_tcase(s, tc_read_data);
 
+  tc_read_data_cached = tcase_create("read_data_cached");
+  tcase_add_test(tc_read_data_cached, test_read_data_cached);
+  suite_add_tcase(s, tc_read_data_cached);
+
   tc_bisection = tcase_create("bisection");
   tcase_add_test(tc_bisection, test_bisection);
   suite_add_tcase(s, tc_bisection);
@@ -310,5 +455,9 @@ Suite *create_suite_interpol(void)
   tcase_add_test(tc_linint, test_linint);
   suite_add_tcase(s, tc_linint);
 
+  tc_call_cursor = tcase_create("call_cursor");
+  tcase_add_test(tc_call_cursor, test_call_cursor);
+  suite_add_tcase(s, tc_call_cursor);
+
   return s;
 }
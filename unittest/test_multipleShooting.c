@@ -0,0 +1,132 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/multipleShooting.h>
+#include <sbmlsolver/sensSolver.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static integratorInstance_t *ii = NULL;
+
+static char *ids[2] = { "V1", "k3" };
+
+static void setup_integratorInstance(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 100.0, 10);
+	CvodeSettings_setErrors(cs, 1e-10, 1e-10, 100000);
+	ii = IntegratorInstance_create(model, cs);
+	IntegratorInstance_readTimeSeriesData(ii, EXAMPLES_FILENAME("MAPK_10pt.dat"));
+}
+
+static void teardown_integratorInstance(void)
+{
+	IntegratorInstance_free(ii);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+/* test cases */
+START_TEST(test_IntegratorInstance_createMultipleShooting)
+{
+	multipleShooting_t *ms;
+	int s;
+	ms = IntegratorInstance_createMultipleShooting(ii, 2, ids, 5);
+	ck_assert(ms != NULL);
+	ck_assert_int_eq(ms->nsegments, 5);
+	/* 10 data time points after t = 0 give segments of two points */
+	for (s = 0; s < 5; s++) {
+		CHECK_DOUBLE_WITH_TOLERANCE(ms->segment[s].t1, 20.0 * (s + 1));
+		CHECK_DOUBLE_WITH_TOLERANCE(ms->segment[s].t0, 20.0 * s);
+		if (s > 0)
+			ck_assert_int_eq(ms->segment[s].first, ms->segment[s-1].last + 1);
+	}
+	ck_assert_int_eq(ms->segment[4].last, 10);
+	ck_assert_int_eq(MultipleShooting_getNumUnknowns(ms), 2 + 4 * 8);
+	ck_assert_int_eq(MultipleShooting_getNumResiduals(ms), 88 + 4 * 8);
+	MultipleShooting_free(ms);
+}
+END_TEST
+
+START_TEST(test_MultipleShooting_integrate)
+{
+	multipleShooting_t *ms;
+	double x[4][8], *r, *r2, *J;
+	int i, k, s, nz, nr;
+	/* states of a single run at the segment boundaries */
+	for (k = 1; k <= 8; k++) {
+		ck_assert_int_eq(IntegratorInstance_integrateOneStep(ii), 1);
+		if (k % 2 == 0)
+			for (i = 0; i < 8; i++)
+				x[k/2-1][i] = ii->data->value[i];
+	}
+	ms = IntegratorInstance_createMultipleShooting(ii, 2, ids, 5);
+	ck_assert(ms != NULL);
+	for (s = 1; s < 5; s++)
+		ck_assert_int_eq(MultipleShooting_setState(ms, s, x[s-1]), 1);
+	nz = MultipleShooting_getNumUnknowns(ms);
+	nr = MultipleShooting_getNumResiduals(ms);
+	r = calloc(nr, sizeof(double));
+	r2 = calloc(nr, sizeof(double));
+	J = calloc(nr * nz, sizeof(double));
+	ck_assert_int_eq(MultipleShooting_integrate(ms, 1), 1);
+	MultipleShooting_getResiduals(ms, r);
+	/* the segments join continuously */
+	for (s = 0; s < 4; s++)
+		for (i = 0; i < 8; i++)
+			ck_assert(fabs(r[88 + s*8 + i]) <= 1e-5 * (fabs(x[s][i]) + 1.0));
+	/* the segments are independent of the number of threads */
+	ck_assert_int_eq(MultipleShooting_integrate(ms, 4), 1);
+	MultipleShooting_getResiduals(ms, r2);
+	for (i = 0; i < nr; i++)
+		ck_assert(r2[i] == r[i]);
+	/* the next initial state enters the continuity with -1 */
+	MultipleShooting_getJacobian(ms, J);
+	for (s = 0; s < 4; s++)
+		for (i = 0; i < 8; i++)
+			ck_assert(J[(88 + s*8 + i) * nz + 2 + s*8 + i] == -1.0);
+	free(r);
+	free(r2);
+	free(J);
+	MultipleShooting_free(ms);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_createMultipleShooting_invalid)
+{
+	char *bad[1] = { "MKKK" };
+	/* more segments than data time points */
+	ck_assert(IntegratorInstance_createMultipleShooting(ii, 2, ids, 11) == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE), SOLVER_ERROR_INTEGRATOR_SETTINGS);
+	SolverError_clear();
+	/* initial values of ODE variables are not parameters */
+	ck_assert(IntegratorInstance_createMultipleShooting(ii, 1, bad, 2) == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE), SOLVER_ERROR_REQUESTED_PARAMETER_NOT_FOUND);
+	SolverError_clear();
+}
+END_TEST
+
+/* public */
+Suite *create_suite_multipleShooting(void)
+{
+	Suite *s;
+	TCase *tc_MultipleShooting;
+
+	s = suite_create("multipleShooting");
+
+	tc_MultipleShooting = tcase_create("MultipleShooting");
+	tcase_add_checked_fixture(tc_MultipleShooting,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_MultipleShooting, test_IntegratorInstance_createMultipleShooting);
+	tcase_add_test(tc_MultipleShooting, test_MultipleShooting_integrate);
+	tcase_add_test(tc_MultipleShooting, test_IntegratorInstance_createMultipleShooting_invalid);
+	suite_add_tcase(s, tc_MultipleShooting);
+
+	return s;
+}
@@ -19,29 +19,27 @@ static void setup_integratorInstance(void)
 
 static void teardown_integratorInstance(void)
 {
-#if 0 /* FIXME */
 	IntegratorInstance_free(ii);
-#endif
 	CvodeSettings_free(cs);
 	ODEModel_free(model);
 }
 
 /* test cases */
-START_TEST(test_IntegratorInstance_createKINSolverStructures)
+START_TEST(test_IntegratorInstance_createNullSolverStructures)
 {
 	int r;
-	r = IntegratorInstance_createKINSolverStructures(ii);
+	r = IntegratorInstance_createNullSolverStructures(ii);
 	ck_assert_int_eq(r, 1);
 }
 END_TEST
 
-START_TEST(test_IntegratorInstance_freeKINSolverStructures)
+START_TEST(test_IntegratorInstance_freeNullSolverStructures)
 {
 #if 0 /* FIXME */
-	IntegratorInstance_createKINSolverStructures(ii);
-	/* It is OK to call IntegratorInstance_freeKINSolverStructures consecutively. */
-	IntegratorInstance_freeKINSolverStructures(ii);
-	IntegratorInstance_freeKINSolverStructures(ii);
+	IntegratorInstance_createNullSolverStructures(ii);
+	/* It is OK to call IntegratorInstance_freeNullSolverStructures consecutively. */
+	IntegratorInstance_freeNullSolverStructures(ii);
+	IntegratorInstance_freeNullSolverStructures(ii);
 #endif
 }
 END_TEST
@@ -49,16 +47,166 @@ END_TEST
 START_TEST(test_IntegratorInstance_nullSolver)
 {
 	int r;
-	IntegratorInstance_createKINSolverStructures(ii);
+	IntegratorInstance_createNullSolverStructures(ii);
+	r = IntegratorInstance_nullSolver(ii);
+	ck_assert_int_eq(r, 1);
+}
+END_TEST
+
+static double sum_of_values(integratorInstance_t *ii, const char **ids, int n)
+{
+	variableIndex_t *vi;
+	double sum = 0;
+	int i;
+	for (i = 0; i < n; i++) {
+		vi = ODEModel_getVariableIndex(model, ids[i]);
+		sum += IntegratorInstance_getVariableValue(ii, vi);
+		VariableIndex_free(vi);
+	}
+	return sum;
+}
+
+START_TEST(test_IntegratorInstance_nullSolver_conservationLaws)
+{
+	const char *mkkk[] = {"MKKK", "MKKK_P"};
+	const char *mkk[] = {"MKK", "MKK_P", "MKK_PP"};
+	const char *mapk[] = {"MAPK", "MAPK_P", "MAPK_PP"};
+	int r;
 	r = IntegratorInstance_nullSolver(ii);
 	ck_assert_int_eq(r, 1);
+	ck_assert_int_eq(IntegratorInstance_getNumConservationLaws(ii), 3);
+	ck_assert(fabs(sum_of_values(ii, mkkk, 2) - 100) <= 1e-8);
+	ck_assert(fabs(sum_of_values(ii, mkk, 3) - 300) <= 1e-8);
+	ck_assert(fabs(sum_of_values(ii, mapk, 3) - 300) <= 1e-8);
+	/* the steady state is not the initial state */
+	ck_assert(fabs(sum_of_values(ii, mkkk, 1) - 90) > 1);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_nullSolver_singularJacobian)
+{
+	integratorInstance_t *ii2;
+	odeModel_t *om;
+	variableIndex_t *vi;
+	int r;
+	/* S1 -> S2: the Jacobian matrix is singular without the
+	   conservation law S1 + S2 */
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("basic.xml"));
+	ii2 = IntegratorInstance_create(om, cs);
+	r = IntegratorInstance_nullSolver(ii2);
+	ck_assert_int_eq(r, 1);
+	ck_assert_int_eq(IntegratorInstance_getNumConservationLaws(ii2), 1);
+	vi = ODEModel_getVariableIndex(om, "S2");
+	ck_assert(fabs(IntegratorInstance_getVariableValue(ii2, vi) - 3e-15) <= 1e-24);
+	VariableIndex_free(vi);
+	IntegratorInstance_free(ii2);
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_nullSolverBatch)
+{
+	double values[3][1] = {{90}, {50}, {20}};
+	double *params[3], *x[3];
+	int converged[3], i, r, neq, idx[2];
+	variableIndex_t *vi[2];
+	vi[0] = ODEModel_getVariableIndex(model, "MKKK");
+	vi[1] = ODEModel_getVariableIndex(model, "MKKK_P");
+	idx[0] = VariableIndex_getIndex(vi[0]);
+	idx[1] = VariableIndex_getIndex(vi[1]);
+	neq = ODEModel_getNeq(model);
+	for (i = 0; i < 3; i++) {
+		params[i] = values[i];
+		x[i] = malloc(neq * sizeof(double));
+	}
+	r = IntegratorInstance_nullSolverBatch(ii, 1, vi, 3, params, x, converged);
+	ck_assert_int_eq(r, 3);
+	for (i = 0; i < 3; i++) {
+		ck_assert_int_eq(converged[i], 1);
+		/* conserved total of the initial values of each design point */
+		ck_assert(fabs(x[i][idx[0]] + x[i][idx[1]] - (values[i][0] + 10)) <= 1e-8);
+		free(x[i]);
+	}
+	VariableIndex_free(vi[0]);
+	VariableIndex_free(vi[1]);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_steadyStateSensitivity)
+{
+	integratorInstance_t *ii2;
+	odeModel_t *om;
+	variableIndex_t *s1, *s2, *k1;
+	char *sensIDs[2] = {"S1", "k_1"};
+	int r;
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("basic.xml"));
+	CvodeSettings_setSensitivity(cs, 1);
+	CvodeSettings_setSensParams(cs, sensIDs, 2);
+	ii2 = IntegratorInstance_create(om, cs);
+	r = IntegratorInstance_nullSolver(ii2);
+	ck_assert_int_eq(r, 1);
+	r = IntegratorInstance_steadyStateSensitivity(ii2);
+	ck_assert_int_eq(r, 1);
+	s1 = ODEModel_getVariableIndex(om, "S1");
+	s2 = ODEModel_getVariableIndex(om, "S2");
+	k1 = ODEModel_getVariableIndex(om, "k_1");
+	/* all of S1 ends up in S2, independent of k_1 */
+	ck_assert(fabs(IntegratorInstance_getSensitivity(ii2, s1, s1)) <= 1e-8);
+	ck_assert(fabs(IntegratorInstance_getSensitivity(ii2, s2, s1) - 1) <= 1e-8);
+	ck_assert(fabs(IntegratorInstance_getSensitivity(ii2, s1, k1)) <= 1e-8);
+	ck_assert(fabs(IntegratorInstance_getSensitivity(ii2, s2, k1)) <= 1e-8);
+	VariableIndex_free(s1);
+	VariableIndex_free(s2);
+	VariableIndex_free(k1);
+	IntegratorInstance_free(ii2);
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_steadyStateSensitivity_differences)
+{
+	integratorInstance_t *ii2;
+	variableIndex_t *vi;
+	char *sensIDs[1] = {"MKKK"};
+	double *sens, *xp, h = 1e-2;
+	int i, r, neq;
+	CvodeSettings_setSensitivity(cs, 1);
+	CvodeSettings_setSensParams(cs, sensIDs, 1);
+	ii2 = IntegratorInstance_create(model, cs);
+	vi = ODEModel_getVariableIndex(model, "MKKK");
+	neq = ODEModel_getNeq(model);
+	sens = malloc(neq * sizeof(double));
+	xp = malloc(neq * sizeof(double));
+	r = IntegratorInstance_nullSolver(ii2);
+	ck_assert_int_eq(r, 1);
+	r = IntegratorInstance_steadyStateSensitivity(ii2);
+	ck_assert_int_eq(r, 1);
+	for (i = 0; i < neq; i++)
+		sens[i] = IntegratorInstance_getSensitivityByNum(ii2, i, 0);
+	/* central differences of steady states with MKKK(0) = 90 +- h */
+	IntegratorInstance_reset(ii2);
+	IntegratorInstance_setVariableValue(ii2, vi, 90 + h);
+	r = IntegratorInstance_nullSolver(ii2);
+	ck_assert_int_eq(r, 1);
+	for (i = 0; i < neq; i++)
+		xp[i] = ii2->data->value[i];
+	IntegratorInstance_reset(ii2);
+	IntegratorInstance_setVariableValue(ii2, vi, 90 - h);
+	r = IntegratorInstance_nullSolver(ii2);
+	ck_assert_int_eq(r, 1);
+	for (i = 0; i < neq; i++)
+		ck_assert(fabs(sens[i] - (xp[i] - ii2->data->value[i]) / (2 * h)) <= 1e-5);
+	free(sens);
+	free(xp);
+	VariableIndex_free(vi);
+	IntegratorInstance_free(ii2);
 }
 END_TEST
 
 START_TEST(test_IntegratorInstance_printKINSOLStatistics)
 {
 	FILE *fp;
-	IntegratorInstance_createKINSolverStructures(ii);
+	IntegratorInstance_createNullSolverStructures(ii);
 	IntegratorInstance_nullSolver(ii);
 	OPEN_TMPFILE_OR_ABORT(fp);
 	IntegratorInstance_printKINSOLStatistics(ii, fp);
@@ -71,29 +219,33 @@ END_TEST
 Suite *create_suite_nullSolver(void)
 {
 	Suite *s;
-	TCase *tc_IntegratorInstance_createKINSolverStructures;
-	TCase *tc_IntegratorInstance_freeKINSolverStructures;
+	TCase *tc_IntegratorInstance_createNullSolverStructures;
+	TCase *tc_IntegratorInstance_freeNullSolverStructures;
 	TCase *tc_IntegratorInstance_nullSolver;
 	TCase *tc_IntegratorInstance_printKINSOLStatistics;
+	TCase *tc_IntegratorInstance_nullSolverBatch;
+	TCase *tc_IntegratorInstance_steadyStateSensitivity;
 
 	s = suite_create("nullSolver");
 
-	tc_IntegratorInstance_createKINSolverStructures = tcase_create("IntegratorInstance_createKINSolverStructures");
-	tcase_add_checked_fixture(tc_IntegratorInstance_createKINSolverStructures,
+	tc_IntegratorInstance_createNullSolverStructures = tcase_create("IntegratorInstance_createNullSolverStructures");
+	tcase_add_checked_fixture(tc_IntegratorInstance_createNullSolverStructures,
 							  setup_integratorInstance,
 							  teardown_integratorInstance);
-	tcase_add_test(tc_IntegratorInstance_createKINSolverStructures, test_IntegratorInstance_createKINSolverStructures);
-	suite_add_tcase(s, tc_IntegratorInstance_createKINSolverStructures);
+	tcase_add_test(tc_IntegratorInstance_createNullSolverStructures, test_IntegratorInstance_createNullSolverStructures);
+	suite_add_tcase(s, tc_IntegratorInstance_createNullSolverStructures);
 
-	tc_IntegratorInstance_freeKINSolverStructures = tcase_create("IntegratorInstance_freeKINSolverStructures");
-	tcase_add_test(tc_IntegratorInstance_freeKINSolverStructures, test_IntegratorInstance_freeKINSolverStructures);
-	suite_add_tcase(s, tc_IntegratorInstance_freeKINSolverStructures);
+	tc_IntegratorInstance_freeNullSolverStructures = tcase_create("IntegratorInstance_freeNullSolverStructures");
+	tcase_add_test(tc_IntegratorInstance_freeNullSolverStructures, test_IntegratorInstance_freeNullSolverStructures);
+	suite_add_tcase(s, tc_IntegratorInstance_freeNullSolverStructures);
 
 	tc_IntegratorInstance_nullSolver = tcase_create("IntegratorInstance_nullSolver");
 	tcase_add_checked_fixture(tc_IntegratorInstance_nullSolver,
 							  setup_integratorInstance,
 							  teardown_integratorInstance);
 	tcase_add_test(tc_IntegratorInstance_nullSolver, test_IntegratorInstance_nullSolver);
+	tcase_add_test(tc_IntegratorInstance_nullSolver, test_IntegratorInstance_nullSolver_conservationLaws);
+	tcase_add_test(tc_IntegratorInstance_nullSolver, test_IntegratorInstance_nullSolver_singularJacobian);
 	suite_add_tcase(s, tc_IntegratorInstance_nullSolver);
 
 	tc_IntegratorInstance_printKINSOLStatistics = tcase_create("IntegratorInstance_printKINSOLStatistics");
@@ -103,5 +255,20 @@ Suite *create_suite_nullSolver(void)
 	tcase_add_test(tc_IntegratorInstance_printKINSOLStatistics, test_IntegratorInstance_printKINSOLStatistics);
 	suite_add_tcase(s, tc_IntegratorInstance_printKINSOLStatistics);
 
+	tc_IntegratorInstance_nullSolverBatch = tcase_create("IntegratorInstance_nullSolverBatch");
+	tcase_add_checked_fixture(tc_IntegratorInstance_nullSolverBatch,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_nullSolverBatch, test_IntegratorInstance_nullSolverBatch);
+	suite_add_tcase(s, tc_IntegratorInstance_nullSolverBatch);
+
+	tc_IntegratorInstance_steadyStateSensitivity = tcase_create("IntegratorInstance_steadyStateSensitivity");
+	tcase_add_checked_fixture(tc_IntegratorInstance_steadyStateSensitivity,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_steadyStateSensitivity, test_IntegratorInstance_steadyStateSensitivity);
+	tcase_add_test(tc_IntegratorInstance_steadyStateSensitivity, test_IntegratorInstance_steadyStateSensitivity_differences);
+	suite_add_tcase(s, tc_IntegratorInstance_steadyStateSensitivity);
+
 	return s;
 }
@@ -0,0 +1,340 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/integratorInstance.h>
+#include <sbmlsolver/odePartition.h>
+#include <sbmlsolver/nvectorThreaded.h>
+#include <sbmlsolver/processAST.h>
+#include <sbmlsolver/sensSolver.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static integratorInstance_t *ii = NULL;
+
+static threadPool_t *pool = NULL;
+
+static void setup_odePartition(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 1000.0, 100);
+	ii = IntegratorInstance_create(model, cs);
+	pool = ThreadPool_create(3);
+}
+
+static void teardown_odePartition(void)
+{
+	ThreadPool_free(pool);
+	IntegratorInstance_free(ii);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+/* compares the evaluation of a partition with a serial evaluation
+   at the current values of ii */
+static void check_partition(odePartition_t *p, double tolerance)
+{
+	cvodeData_t *data = ii->data;
+	double dy[8], dyp[8], J[8][8], Jp[8][8], *cols[8], x;
+	int i, j;
+	nonzeroElem_t *nonzero;
+
+	for (i = 0; i < model->nassbeforeodes; i++)
+		data->value[model->assignmentsBeforeODEs[i]->i] =
+			evaluateAST(model->assignmentsBeforeODEs[i]->ij, data);
+	for (i = 0; i < 8; i++)
+		dy[i] = evaluateAST(model->ode[i], data);
+	for (i = 0; i < 8; i++)
+		for (j = 0; j < 8; j++)
+			J[i][j] = Jp[i][j] = 0.0;
+	for (i = 0; i < model->sparsesize; i++)
+	{
+		nonzero = model->jacobSparse[i];
+		J[nonzero->j][nonzero->i] = evaluateAST(nonzero->ij, data);
+	}
+
+	/* the partition must recompute the rules */
+	for (i = 0; i < model->nassbeforeodes; i++)
+		data->value[model->assignmentsBeforeODEs[i]->i] = 0.0;
+	ODEPartition_evaluateRules(p, data);
+	ODEPartition_evaluateODEs(p, data, dyp);
+	for (j = 0; j < 8; j++)
+		cols[j] = Jp[j];
+	ODEPartition_evaluateJacobian(p, data, cols);
+
+	for (i = 0; i < 8; i++)
+	{
+		x = fabs(dy[i]) > 1.0 ? fabs(dy[i]) : 1.0;
+		ck_assert(fabs(dyp[i] - dy[i]) <= tolerance * x);
+		for (j = 0; j < 8; j++)
+		{
+			x = fabs(J[i][j]) > 1.0 ? fabs(J[i][j]) : 1.0;
+			ck_assert(fabs(Jp[i][j] - J[i][j]) <= tolerance * x);
+		}
+	}
+}
+
+/* test cases */
+START_TEST(test_ODEPartition_create)
+{
+	odePartition_t *p;
+	int c, n;
+	p = ODEPartition_create(model, pool, 0.0);
+	ck_assert(p != NULL);
+	n = p->nchunks;
+	ck_assert_int_eq(n, ThreadPool_getNumThreads(pool));
+	ck_assert_int_eq(p->jacobian, 1);
+	/* the chunks cover all equations in order */
+	ck_assert_int_eq(p->odeBound[0], 0);
+	ck_assert_int_eq(p->odeBound[n], model->neq);
+	ck_assert_int_eq(p->jacobianBound[n], model->sparsesize);
+	ck_assert_int_eq(p->ruleBound[p->nlevels*n], model->nassbeforeodes);
+	for (c = 0; c < n; c++)
+		ck_assert(p->odeBound[c] <= p->odeBound[c+1]);
+	ODEPartition_free(p);
+	/* cheap phases are not divided */
+	p = ODEPartition_create(model, pool, 1e9);
+	ck_assert(p != NULL);
+	ck_assert_int_eq(p->odeBound[1], model->neq);
+	ODEPartition_free(p);
+}
+END_TEST
+
+START_TEST(test_ODEPartition_evaluate)
+{
+	odePartition_t *p;
+	ck_assert_int_eq(IntegratorInstance_integrateOneStep(ii), 1);
+	p = ODEPartition_create(model, pool, 0.0);
+	ck_assert(p != NULL);
+	check_partition(p, 0.0);
+	ODEPartition_free(p);
+}
+END_TEST
+
+START_TEST(test_ODEPartition_evaluate_compiled)
+{
+	odePartition_t *p;
+	ck_assert_int_eq(IntegratorInstance_integrateOneStep(ii), 1);
+	p = ODEPartition_create(model, pool, 0.0);
+	ck_assert(p != NULL);
+	ck_assert_int_eq(ODEModel_compilePartitionFunctions(model, p), 1);
+	ck_assert(p->compiledOde != NULL);
+	check_partition(p, 1e-12);
+	ODEPartition_free(p);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_threads)
+{
+	integratorInstance_t *ii2;
+	const cvodeResults_t *res, *res2;
+	int i, k, r;
+	CvodeSettings_setThreads(cs, 3);
+	ck_assert_int_eq(CvodeSettings_getThreads(cs), 3);
+	ii2 = IntegratorInstance_create(model, cs);
+	ck_assert(ii2->data->partition != NULL);
+	r = IntegratorInstance_integrate(ii);
+	ck_assert_int_eq(r, 1);
+	r = IntegratorInstance_integrate(ii2);
+	ck_assert_int_eq(r, 1);
+	res = IntegratorInstance_getResults(ii);
+	res2 = IntegratorInstance_getResults(ii2);
+	ck_assert_int_eq(res2->nout, res->nout);
+	for (k = 0; k <= res->nout; k++)
+		for (i = 0; i < 8; i++)
+			ck_assert(fabs(res2->value[i][k] - res->value[i][k]) <= 1e-12 * fabs(res->value[i][k]));
+	IntegratorInstance_free(ii2);
+}
+END_TEST
+
+/* observation data share the interpolation cursor of the data */
+START_TEST(test_IntegratorInstance_threads_timeSeries)
+{
+	static char *vars[8] = { "MKKK", "MKKK_P", "MKK", "MKK_P", "MKK_PP",
+							 "MAPK", "MAPK_P", "MAPK_PP" };
+	char *names[9], formula[64];
+	double values[9];
+	ASTNode_t *f[8];
+	odeModel_t *om;
+	odePartition_t *p;
+	cvodeSettings_t *set;
+	integratorInstance_t *ii1, *ii2;
+	const cvodeResults_t *res, *res2;
+	int i, k;
+
+	/* relaxation of the variables to their data */
+	for (i = 0; i < 8; i++)
+	{
+		sprintf(formula, "k * (%s_data - %s)", vars[i], vars[i]);
+		f[i] = SBML_parseFormula(formula);
+		names[i] = vars[i];
+		values[i] = 0.0;
+	}
+	names[8] = "k";
+	values[8] = 0.1;
+	om = ODEModel_createFromODEs(f, 8, 0, 1, names, values, NULL);
+	for (i = 0; i < 8; i++)
+		ASTNode_free(f[i]);
+	ck_assert(om != NULL);
+
+	/* the partition is not divided */
+	p = ODEPartition_create(om, pool, 0.0);
+	ck_assert(p != NULL);
+	ck_assert_int_eq(p->odeBound[1], om->neq);
+	ODEPartition_free(p);
+
+	set = CvodeSettings_create();
+	CvodeSettings_setTime(set, 100.0, 10);
+	ii1 = IntegratorInstance_create(om, set);
+	ck_assert_int_eq(IntegratorInstance_readTimeSeriesData(ii1, EXAMPLES_FILENAME("MAPK_10pt.dat")), 1);
+	CvodeSettings_setThreads(set, 3);
+	ii2 = IntegratorInstance_create(om, set);
+	ck_assert(ii2->data->partition != NULL);
+	ck_assert_int_eq(IntegratorInstance_integrate(ii1), 1);
+	ck_assert_int_eq(IntegratorInstance_integrate(ii2), 1);
+	res = IntegratorInstance_getResults(ii1);
+	res2 = IntegratorInstance_getResults(ii2);
+	ck_assert_int_eq(res2->nout, res->nout);
+	for (k = 0; k <= res->nout; k++)
+		for (i = 0; i < 8; i++)
+			ck_assert(fabs(res2->value[i][k] - res->value[i][k]) <= 1e-12 * fabs(res->value[i][k]));
+	/* the data pull the variables from 0 towards their values */
+	ck_assert(res->value[0][res->nout] > 0.0);
+	IntegratorInstance_free(ii2);
+	IntegratorInstance_free(ii1);
+	CvodeSettings_free(set);
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_N_VNew_Threaded)
+{
+	N_Vector x, y, z, xs, ys, zs;
+	long int i, n = 3 * NVECTOR_THREADED_MIN_LENGTH + 7;
+	x = N_VNew_Threaded(n, pool);
+	ck_assert(x != NULL);
+	y = N_VClone(x);
+	z = N_VClone(x);
+	ck_assert(NV_POOL_T(y) == pool);
+	for (i = 0; i < n; i++)
+	{
+		NV_Ith_S(x, i) = sin(i);
+		NV_Ith_S(y, i) = 1.0 + cos(i) * cos(i);
+	}
+	xs = N_VMake_Serial(n, NV_DATA_S(x));
+	ys = N_VMake_Serial(n, NV_DATA_S(y));
+	zs = N_VNew_Serial(n);
+	N_VLinearSum(2.0, x, -0.5, y, z);
+	N_VLinearSum(2.0, xs, -0.5, ys, zs);
+	for (i = 0; i < n; i++)
+		ck_assert(NV_Ith_S(z, i) == NV_Ith_S(zs, i));
+	N_VDiv(x, y, z);
+	N_VDiv(xs, ys, zs);
+	for (i = 0; i < n; i++)
+		ck_assert(NV_Ith_S(z, i) == NV_Ith_S(zs, i));
+	ck_assert(fabs(N_VDotProd(x, y) - N_VDotProd(xs, ys)) <= 1e-12 * n);
+	ck_assert(fabs(N_VWrmsNorm(x, y) - N_VWrmsNorm(xs, ys)) <= 1e-12);
+	ck_assert(fabs(N_VL1Norm(x) - N_VL1Norm(xs)) <= 1e-12 * n);
+	ck_assert(N_VMaxNorm(x) == N_VMaxNorm(xs));
+	ck_assert(N_VMin(x) == N_VMin(xs));
+	N_VDestroy_Serial(xs);
+	N_VDestroy_Serial(ys);
+	N_VDestroy_Serial(zs);
+	N_VDestroy(z);
+	N_VDestroy(y);
+	N_VDestroy(x);
+}
+END_TEST
+
+static void record_thread(void *arg, int task)
+{
+	int *thread = arg;
+	thread[task] = ThreadPool_getThread(pool);
+}
+
+START_TEST(test_ThreadPool_getThread)
+{
+	int thread[64], k;
+	for (k = 0; k < 64; k++)
+		thread[k] = -1;
+	ThreadPool_run(pool, 64, record_thread, thread);
+	for (k = 0; k < 64; k++) {
+		ck_assert(thread[k] >= 0);
+		ck_assert(thread[k] < ThreadPool_getNumThreads(pool));
+	}
+	/* the calling thread */
+	ck_assert_int_eq(ThreadPool_getThread(pool), 0);
+}
+END_TEST
+
+static void count_task(void *arg, int task)
+{
+	int *count = arg;
+	ThreadPool_lock(pool);
+	(*count)++;
+	ThreadPool_unlock(pool);
+}
+
+START_TEST(test_ThreadPool_lock)
+{
+	int count = 0;
+	ThreadPool_run(pool, 1000, count_task, &count);
+	ck_assert_int_eq(count, 1000);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_odePartition(void)
+{
+	Suite *s;
+	TCase *tc_ODEPartition_create;
+	TCase *tc_ODEPartition_evaluate;
+	TCase *tc_IntegratorInstance_threads;
+	TCase *tc_N_VNew_Threaded;
+	TCase *tc_ThreadPool;
+
+	s = suite_create("odePartition");
+
+	tc_ODEPartition_create = tcase_create("ODEPartition_create");
+	tcase_add_checked_fixture(tc_ODEPartition_create,
+							  setup_odePartition,
+							  teardown_odePartition);
+	tcase_add_test(tc_ODEPartition_create, test_ODEPartition_create);
+	suite_add_tcase(s, tc_ODEPartition_create);
+
+	tc_ODEPartition_evaluate = tcase_create("ODEPartition_evaluate");
+	tcase_add_checked_fixture(tc_ODEPartition_evaluate,
+							  setup_odePartition,
+							  teardown_odePartition);
+	tcase_add_test(tc_ODEPartition_evaluate, test_ODEPartition_evaluate);
+	tcase_add_test(tc_ODEPartition_evaluate, test_ODEPartition_evaluate_compiled);
+	suite_add_tcase(s, tc_ODEPartition_evaluate);
+
+	tc_IntegratorInstance_threads = tcase_create("IntegratorInstance_threads");
+	tcase_add_checked_fixture(tc_IntegratorInstance_threads,
+							  setup_odePartition,
+							  teardown_odePartition);
+	tcase_add_test(tc_IntegratorInstance_threads, test_IntegratorInstance_threads);
+	tcase_add_test(tc_IntegratorInstance_threads, test_IntegratorInstance_threads_timeSeries);
+	suite_add_tcase(s, tc_IntegratorInstance_threads);
+
+	tc_N_VNew_Threaded = tcase_create("N_VNew_Threaded");
+	tcase_add_checked_fixture(tc_N_VNew_Threaded,
+							  setup_odePartition,
+							  teardown_odePartition);
+	tcase_add_test(tc_N_VNew_Threaded, test_N_VNew_Threaded);
+	suite_add_tcase(s, tc_N_VNew_Threaded);
+
+	tc_ThreadPool = tcase_create("ThreadPool");
+	tcase_add_checked_fixture(tc_ThreadPool,
+							  setup_odePartition,
+							  teardown_odePartition);
+	tcase_add_test(tc_ThreadPool, test_ThreadPool_getThread);
+	tcase_add_test(tc_ThreadPool, test_ThreadPool_lock);
+	suite_add_tcase(s, tc_ThreadPool);
+
+	return s;
+}
@@ -0,0 +1,177 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/parameterEstimation.h>
+#include <sbmlsolver/sensSolver.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static integratorInstance_t *ii = NULL;
+
+static char *ids[2] = { "V1", "k3" };
+
+static const double lower[2] = { 1.0, 0.01 };
+
+static const double upper[2] = { 5.0, 0.1 };
+
+static void setup_integratorInstance(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 100.0, 10);
+	CvodeSettings_setErrors(cs, 1e-10, 1e-10, 100000);
+	ii = IntegratorInstance_create(model, cs);
+	IntegratorInstance_readTimeSeriesData(ii, EXAMPLES_FILENAME("MAPK_10pt.dat"));
+}
+
+static void teardown_integratorInstance(void)
+{
+	IntegratorInstance_free(ii);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+/* test cases */
+START_TEST(test_IntegratorInstance_fitParameters)
+{
+	parameterFit_t *fit;
+	fitTrace_t *trace;
+	int i;
+	fit = IntegratorInstance_fitParameters(ii, 2, ids, lower, upper, 4, 1, 1);
+	ck_assert(fit != NULL);
+	ck_assert_int_eq(fit->nres, 88);
+	ck_assert_int_eq(fit->nstarts, 4);
+	ck_assert(fit->best >= 0);
+	/* the data were generated with V1 = 2.5 and k3 = 0.025 */
+	ck_assert(fabs(ParameterFit_getValue(fit, 0) - 2.5) <= 1e-2 * 2.5);
+	ck_assert(fabs(ParameterFit_getValue(fit, 1) - 0.025) <= 1e-2 * 0.025);
+	ck_assert(ParameterFit_getSSR(fit) < 1e-2);
+	for (i = 0; i < 2; i++) {
+		ck_assert(ParameterFit_getLowerBound(fit, i) < ParameterFit_getValue(fit, i));
+		ck_assert(ParameterFit_getUpperBound(fit, i) > ParameterFit_getValue(fit, i));
+		ck_assert(ParameterFit_getFIM(fit, i, i) > 0.0);
+	}
+	ck_assert(ParameterFit_getFIM(fit, 0, 1) == ParameterFit_getFIM(fit, 1, 0));
+	/* the first start is the model values, where the data fit */
+	trace = &fit->trace[0];
+	ck_assert(fabs(trace->start[0] - 2.5) <= 1e-12);
+	ck_assert(fabs(trace->start[1] - 0.025) <= 1e-12);
+	/* the traces decrease monotonically */
+	for (i = 0; i < 4; i++) {
+		trace = &fit->trace[i];
+		ck_assert(trace->status == FIT_CONVERGED || trace->status == FIT_MAXITER ||
+				  trace->status == FIT_STALLED);
+		ck_assert(trace->ssrTrace[trace->niter] == trace->ssr);
+		ck_assert(trace->ssr <= trace->ssrTrace[0]);
+	}
+	ParameterFit_free(fit);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_fitParameters_threads)
+{
+	parameterFit_t *fit, *fit2;
+	int i, j;
+	/* each start gives the same result in any thread */
+	fit = IntegratorInstance_fitParameters(ii, 2, ids, lower, upper, 3, 1, 7);
+	fit2 = IntegratorInstance_fitParameters(ii, 2, ids, lower, upper, 3, 3, 7);
+	ck_assert(fit != NULL);
+	ck_assert(fit2 != NULL);
+	ck_assert_int_eq(fit2->best, fit->best);
+	for (i = 0; i < 3; i++) {
+		ck_assert_int_eq(fit2->trace[i].niter, fit->trace[i].niter);
+		for (j = 0; j < 2; j++) {
+			ck_assert(fit2->trace[i].start[j] == fit->trace[i].start[j]);
+			ck_assert(fit2->trace[i].p[j] == fit->trace[i].p[j]);
+		}
+	}
+	ParameterFit_free(fit);
+	ParameterFit_free(fit2);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_fitParameters_invalid)
+{
+	char *bad[1] = { "MKKK_P_" };
+	double lo[1] = { 0.0 }, up[1] = { 1.0 };
+	/* bounds must be positive */
+	ck_assert(IntegratorInstance_fitParameters(ii, 1, ids, lo, up, 1, 1, 0) == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE), SOLVER_ERROR_VARY_SETTINGS);
+	SolverError_clear();
+	lo[0] = 0.5;
+	ck_assert(IntegratorInstance_fitParameters(ii, 1, bad, lo, up, 1, 1, 0) == NULL);
+	SolverError_clear();
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_fitParameters_noData)
+{
+	odeModel_t *om;
+	integratorInstance_t *ii2;
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("MAPK.xml"));
+	ii2 = IntegratorInstance_create(om, cs);
+	ck_assert(IntegratorInstance_fitParameters(ii2, 2, ids, lower, upper, 1, 1, 0) == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE), SOLVER_ERROR_OBJECTIVE_FUNCTION_FAILED);
+	SolverError_clear();
+	IntegratorInstance_free(ii2);
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_fitParameters_noResidualVariance)
+{
+	static const char *file = "test_parameterEstimation.dat";
+	static char *ids2[2] = { "V1", "V2" };
+	static const double lower2[2] = { 1.0, 0.1 };
+	static const double upper2[2] = { 5.0, 1.0 };
+	parameterFit_t *fit;
+	FILE *fp;
+	int i;
+	/* as many data points as parameters */
+	fp = fopen(file, "w");
+	ck_assert(fp != NULL);
+	fprintf(fp, "#t MKKK\n10 80.718\n20 71.2642\n");
+	fclose(fp);
+	ck_assert_int_eq(IntegratorInstance_readTimeSeriesData(ii, (char *)file), 1);
+	remove(file);
+	fit = IntegratorInstance_fitParameters(ii, 2, ids2, lower2, upper2, 1, 1, 0);
+	ck_assert(fit != NULL);
+	ck_assert_int_eq(fit->nres, 2);
+	/* the residual variance can not be estimated, the intervals
+	   have the unit variance of the weights */
+	ck_assert(fit->sigma2 == 1.0);
+	ck_assert(fit->covariance != NULL);
+	for (i = 0; i < 2; i++) {
+		ck_assert(ParameterFit_getFIM(fit, i, i) > 0.0);
+		ck_assert(ParameterFit_getLowerBound(fit, i) < ParameterFit_getValue(fit, i));
+		ck_assert(ParameterFit_getUpperBound(fit, i) > ParameterFit_getValue(fit, i));
+	}
+	ParameterFit_free(fit);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_parameterEstimation(void)
+{
+	Suite *s;
+	TCase *tc_IntegratorInstance_fitParameters;
+
+	s = suite_create("parameterEstimation");
+
+	tc_IntegratorInstance_fitParameters = tcase_create("IntegratorInstance_fitParameters");
+	tcase_add_checked_fixture(tc_IntegratorInstance_fitParameters,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_fitParameters, test_IntegratorInstance_fitParameters);
+	tcase_add_test(tc_IntegratorInstance_fitParameters, test_IntegratorInstance_fitParameters_threads);
+	tcase_add_test(tc_IntegratorInstance_fitParameters, test_IntegratorInstance_fitParameters_invalid);
+	tcase_add_test(tc_IntegratorInstance_fitParameters, test_IntegratorInstance_fitParameters_noData);
+	tcase_add_test(tc_IntegratorInstance_fitParameters, test_IntegratorInstance_fitParameters_noResidualVariance);
+	suite_add_tcase(s, tc_IntegratorInstance_fitParameters);
+
+	return s;
+}
@@ -1,8 +1,11 @@
 /* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
 #include "unittest.h"
 
+#include <nvector/nvector_serial.h>
+
 #include <sbmlsolver/cvodeSolver.h>
 #include <sbmlsolver/sensSolver.h>
+#include <sbmlsolver/solverError.h>
 
 /* fixtures */
 static odeModel_t *model = NULL;
@@ -94,6 +97,96 @@ START_TEST(test_IntegratorInstance_printCVODESStatistics)
 }
 END_TEST
 
+static void adjoint_run(integratorInstance_t *ii, double *qA)
+{
+	int i;
+	IntegratorInstance_reset(ii);
+	while (!IntegratorInstance_timeCourseCompleted(ii)) {
+		if (!IntegratorInstance_integrateOneStep(ii)) {
+			ck_abort_msg("failed to integrate forward");
+		}
+	}
+	IntegratorInstance_resetAdjPhase(ii);
+	while (!IntegratorInstance_timeCourseCompleted(ii)) {
+		if (!IntegratorInstance_integrateOneStep(ii)) {
+			ck_abort_msg("failed to integrate backward");
+		}
+	}
+	ck_assert_int_eq(IntegratorInstance_CVODEQuad(ii), 1);
+	for (i = 0; i < PARAMS_SIZE; i++)
+		qA[i] = NV_Ith_S(ii->solver->qA, i);
+}
+
+START_TEST(test_IntegratorInstance_adjLinearSolver)
+{
+	double qDense[4], qKrylov[4];
+	FILE *fp;
+	int i, r;
+	IntegratorInstance_free(ii);
+	CvodeSettings_setTime(cs, 1000, 10);
+	CvodeSettings_setDoAdj(cs);
+	CvodeSettings_setAdjTime(cs, 1000, 100);
+	CvodeSettings_setAdjErrors(cs, 1e-15, 1e-8);
+	CvodeSettings_setnSaveSteps(cs, 1000);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_setLinearObjectiveFunction(ii, EXAMPLES_FILENAME("MAPK.linobjfun"));
+	ck_assert_int_eq(r, 1);
+	adjoint_run(ii, qDense);
+	/* the Krylov solver of the backward phase gives the same gradient */
+	CvodeSettings_setAdjLinearSolver(cs, 1);
+	ck_assert_str_eq(CvodeSettings_getAdjLinearSolver(cs), "SPGMR");
+	adjoint_run(ii, qKrylov);
+	for (i = 0; i < PARAMS_SIZE; i++)
+		ck_assert(fabs(qKrylov[i] - qDense[i]) <= 1e-4 * fabs(qDense[i]) + 1e-10);
+	OPEN_TMPFILE_OR_ABORT(fp);
+	r = IntegratorInstance_printCVODESStatistics(ii, fp);
+	ck_assert_int_eq(r, 1);
+	fclose(fp);
+}
+END_TEST
+
+START_TEST(test_IntegratorInstance_adjMemory)
+{
+	double qRef[4], qA[4], ck, dt, budget;
+	int i, r;
+	IntegratorInstance_free(ii);
+	CvodeSettings_setTime(cs, 1000, 10);
+	CvodeSettings_setDoAdj(cs);
+	CvodeSettings_setAdjTime(cs, 1000, 100);
+	CvodeSettings_setAdjErrors(cs, 1e-15, 1e-8);
+	CvodeSettings_setnSaveSteps(cs, 1000);
+	ii = IntegratorInstance_create(model, cs);
+	r = IntegratorInstance_setLinearObjectiveFunction(ii, EXAMPLES_FILENAME("MAPK.linobjfun"));
+	ck_assert_int_eq(r, 1);
+	/* without a budget, checkpoints every nSaveSteps steps */
+	adjoint_run(ii, qRef);
+	ck_assert_int_eq(ii->solver->nSaveSteps, 1000);
+	ck_assert_int_eq(ii->solver->interpolation, CV_HERMITE);
+	/* a budget for 10 checkpoints of 1000 expected BDF steps, i.e.
+	   every 100 steps, with their Hermite interpolation data */
+	budget = IntegratorInstance_getCheckpointMemory(ii, 10, 100, CV_HERMITE);
+	dt = IntegratorInstance_getCheckpointMemory(ii, 0, 1, CV_HERMITE) / 2.0;
+	CvodeSettings_setAdjMemory(cs, budget + 0.5 * dt, 1000);
+	adjoint_run(ii, qA);
+	ck_assert_int_eq(ii->solver->nSaveSteps, 100);
+	ck_assert_int_eq(ii->solver->interpolation, CV_HERMITE);
+	for (i = 0; i < PARAMS_SIZE; i++)
+		ck_assert(fabs(qA[i] - qRef[i]) <= 1e-6 * fabs(qRef[i]) + 1e-10);
+	/* a budget too small for any spacing: the spacing of minimal
+	   memory with polynomial interpolation */
+	ck = IntegratorInstance_getCheckpointMemory(ii, 1, 0, 0);
+	dt = IntegratorInstance_getCheckpointMemory(ii, 0, 1, CV_POLYNOMIAL) / 2.0;
+	CvodeSettings_setAdjMemory(cs, 1.0, 1000);
+	adjoint_run(ii, qA);
+	ck_assert(SolverError_getNum(WARNING_ERROR_TYPE) >= 1);
+	SolverError_clear();
+	ck_assert_int_eq(ii->solver->nSaveSteps, (int)sqrt(1000 * ck / dt));
+	ck_assert_int_eq(ii->solver->interpolation, CV_POLYNOMIAL);
+	for (i = 0; i < PARAMS_SIZE; i++)
+		ck_assert(fabs(qA[i] - qRef[i]) <= 1e-4 * fabs(qRef[i]) + 1e-10);
+}
+END_TEST
+
 /* public */
 Suite *create_suite_sensSolver(void)
 {
@@ -102,6 +195,8 @@ Suite *create_suite_sensSolver(void)
 	TCase *tc_IntegratorInstance_CVODEQuad;
 	TCase *tc_IntegratorInstance_printQuad;
 	TCase *tc_IntegratorInstance_printCVODESStatistics;
+	TCase *tc_IntegratorInstance_adjLinearSolver;
+	TCase *tc_IntegratorInstance_adjMemory;
 
 	s = suite_create("sensSolver");
 
@@ -133,5 +228,19 @@ Suite *create_suite_sensSolver(void)
 	tcase_add_test(tc_IntegratorInstance_printCVODESStatistics, test_IntegratorInstance_printCVODESStatistics);
 	suite_add_tcase(s, tc_IntegratorInstance_printCVODESStatistics);
 
+	tc_IntegratorInstance_adjLinearSolver = tcase_create("IntegratorInstance_adjLinearSolver");
+	tcase_add_checked_fixture(tc_IntegratorInstance_adjLinearSolver,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_adjLinearSolver, test_IntegratorInstance_adjLinearSolver);
+	suite_add_tcase(s, tc_IntegratorInstance_adjLinearSolver);
+
+	tc_IntegratorInstance_adjMemory = tcase_create("IntegratorInstance_adjMemory");
+	tcase_add_checked_fixture(tc_IntegratorInstance_adjMemory,
+							  setup_integratorInstance,
+							  teardown_integratorInstance);
+	tcase_add_test(tc_IntegratorInstance_adjMemory, test_IntegratorInstance_adjMemory);
+	suite_add_tcase(s, tc_IntegratorInstance_adjMemory);
+
 	return s;
 }
@@ -0,0 +1,215 @@
+/* -*- Mode: C; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+#include "unittest.h"
+
+#include <sbmlsolver/stochasticSolver.h>
+#include <sbmlsolver/solverError.h>
+
+/* fixtures */
+static odeModel_t *model = NULL;
+
+static cvodeSettings_t *cs = NULL;
+
+static stochasticSolver_t *ss = NULL;
+
+static void setup_stochasticSolver(void)
+{
+	model = ODEModel_createFromFile(EXAMPLES_FILENAME("birthdeath.xml"));
+	cs = CvodeSettings_create();
+	CvodeSettings_setTime(cs, 50.0, 10);
+	CvodeSettings_setCompileFunctions(cs, 0);
+	ss = NULL;
+}
+
+static void teardown_stochasticSolver(void)
+{
+	StochasticSolver_free(ss);
+	CvodeSettings_free(cs);
+	ODEModel_free(model);
+}
+
+/* final values of X of the trajectories of an ensemble */
+static double final[200];
+
+static int store_final(int trajectory, const cvodeResults_t *res, void *userData)
+{
+	int *n = userData;
+	final[trajectory] = res->value[0][res->nout];
+	(*n)++;
+	return 1;
+}
+
+static int stop_ensemble(int trajectory, const cvodeResults_t *res, void *userData)
+{
+	(void) trajectory;
+	(void) res;
+	(void) userData;
+	return 0;
+}
+
+/* the number of X is Poisson distributed with mean and variance
+   k0/k1 (1 - exp(-k1 t)) */
+static void check_birthDeath(int n)
+{
+	const cvodeResults_t *mean, *var;
+	double lambda;
+	int k;
+	mean = StochasticSolver_getMean(ss);
+	var = StochasticSolver_getVariance(ss);
+	ck_assert_int_eq(mean->nout, 10);
+	for (k = 1; k <= 10; k++) {
+		lambda = 100.0 * (1.0 - exp(-0.1 * mean->time[k]));
+		ck_assert(fabs(mean->value[0][k] - lambda) <= 5.0 * sqrt(lambda / n));
+		ck_assert(fabs(var->value[0][k] - lambda) <= 0.15 * lambda);
+	}
+}
+
+/* test cases */
+START_TEST(test_StochasticSolver_simulate)
+{
+	odeModel_t *om;
+	variableIndex_t *vi;
+	const cvodeResults_t *res;
+	int k;
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("basic.xml"));
+	ss = StochasticSolver_create(om, cs);
+	ck_assert(ss != NULL);
+	ck_assert_int_eq(ss->nreactions, 2);
+	vi = ODEModel_getVariableIndex(om, "S1");
+	ck_assert_int_eq(StochasticSolver_setValue(ss, vi, 100.0), 1);
+	ck_assert(StochasticSolver_getValue(ss, vi) == 100.0);
+	VariableIndex_free(vi);
+	vi = ODEModel_getVariableIndex(om, "S2");
+	StochasticSolver_setValue(ss, vi, 0.0);
+	ck_assert_int_eq(StochasticSolver_simulate(ss, 1), 1);
+	res = StochasticSolver_getResults(ss);
+	ck_assert_int_eq(res->nout, 10);
+	/* S1 -> S2 conserves the molecules */
+	for (k = 0; k <= 10; k++) {
+		CHECK_DOUBLE_WITH_TOLERANCE(res->time[k], 5.0 * k);
+		ck_assert(res->value[vi->index][k] == floor(res->value[vi->index][k]));
+		ck_assert(res->value[0][k] + res->value[1][k] == 100.0);
+		if (k > 0)
+			ck_assert(res->value[vi->index][k] >= res->value[vi->index][k-1]);
+	}
+	ck_assert(res->value[vi->index][10] == 100.0);
+	VariableIndex_free(vi);
+	StochasticSolver_free(ss);
+	ss = NULL;
+	ODEModel_free(om);
+}
+END_TEST
+
+START_TEST(test_StochasticSolver_simulateEnsemble)
+{
+	int n;
+	ss = StochasticSolver_create(model, cs);
+	ck_assert(ss != NULL);
+	n = StochasticSolver_simulateEnsemble(ss, 4000, 7, 0, NULL, NULL);
+	ck_assert_int_eq(n, 4000);
+	check_birthDeath(n);
+	StochasticSolver_printStatistics(ss, stdout);
+}
+END_TEST
+
+START_TEST(test_StochasticSolver_simulateEnsemble_compiled)
+{
+	int n;
+	CvodeSettings_setCompileFunctions(cs, 1);
+	ss = StochasticSolver_create(model, cs);
+	ck_assert(ss != NULL);
+	ck_assert(ss->propensity != NULL);
+	n = StochasticSolver_simulateEnsemble(ss, 4000, 7, 0, NULL, NULL);
+	ck_assert_int_eq(n, 4000);
+	check_birthDeath(n);
+}
+END_TEST
+
+START_TEST(test_StochasticSolver_simulateEnsemble_threads)
+{
+	const cvodeResults_t *res;
+	double x[200], mean;
+	int i, n;
+	ss = StochasticSolver_create(model, cs);
+	/* the trajectories do not depend on the number of threads */
+	n = 0;
+	ck_assert_int_eq(StochasticSolver_simulateEnsemble(ss, 200, 3, 1, store_final, &n), 200);
+	ck_assert_int_eq(n, 200);
+	for (i = 0; i < 200; i++)
+		x[i] = final[i];
+	mean = StochasticSolver_getMean(ss)->value[0][10];
+	n = 0;
+	ck_assert_int_eq(StochasticSolver_simulateEnsemble(ss, 200, 3, 4, store_final, &n), 200);
+	ck_assert_int_eq(n, 200);
+	for (i = 0; i < 200; i++)
+		ck_assert(final[i] == x[i]);
+	ck_assert(fabs(StochasticSolver_getMean(ss)->value[0][10] - mean) <= 1e-12 * mean);
+	/* a single trajectory is the first of the ensemble */
+	ck_assert_int_eq(StochasticSolver_simulate(ss, 3), 1);
+	res = StochasticSolver_getResults(ss);
+	ck_assert(res->value[0][10] == x[0]);
+	/* another seed, other trajectories */
+	n = 0;
+	StochasticSolver_simulateEnsemble(ss, 200, 4, 2, store_final, &n);
+	for (i = 0; i < 200; i++)
+		if (final[i] != x[i])
+			break;
+	ck_assert(i < 200);
+}
+END_TEST
+
+START_TEST(test_StochasticSolver_simulateEnsemble_stop)
+{
+	ss = StochasticSolver_create(model, cs);
+	ck_assert_int_eq(StochasticSolver_simulateEnsemble(ss, 100, 1, 1, stop_ensemble, NULL), 1);
+	ck_assert_int_eq(StochasticSolver_getMean(ss)->nout, 10);
+	ck_assert(StochasticSolver_getVariance(ss)->value[0][10] == 0.0);
+	ck_assert_int_eq(StochasticSolver_simulateEnsemble(ss, 0, 1, 1, NULL, NULL), -1);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE),
+					 SOLVER_ERROR_INTEGRATOR_SETTINGS);
+	SolverError_clear();
+}
+END_TEST
+
+START_TEST(test_StochasticSolver_create_events)
+{
+	odeModel_t *om;
+	om = ODEModel_createFromFile(EXAMPLES_FILENAME("events-1-event-1-assignment-l2.xml"));
+	ck_assert(om != NULL);
+	ss = StochasticSolver_create(om, cs);
+	ck_assert(ss == NULL);
+	ck_assert_int_eq(SolverError_getLastCode(ERROR_ERROR_TYPE),
+					 SOLVER_ERROR_INTEGRATOR_SETTINGS);
+	SolverError_clear();
+	ODEModel_free(om);
+}
+END_TEST
+
+/* public */
+Suite *create_suite_stochasticSolver(void)
+{
+	Suite *s;
+	TCase *tc_StochasticSolver_simulate;
+	TCase *tc_StochasticSolver_create;
+
+	s = suite_create("stochasticSolver");
+
+	tc_StochasticSolver_simulate = tcase_create("StochasticSolver_simulate");
+	tcase_add_checked_fixture(tc_StochasticSolver_simulate,
+							  setup_stochasticSolver,
+							  teardown_stochasticSolver);
+	tcase_add_test(tc_StochasticSolver_simulate, test_StochasticSolver_simulate);
+	tcase_add_test(tc_StochasticSolver_simulate, test_StochasticSolver_simulateEnsemble);
+	tcase_add_test(tc_StochasticSolver_simulate, test_StochasticSolver_simulateEnsemble_compiled);
+	tcase_add_test(tc_StochasticSolver_simulate, test_StochasticSolver_simulateEnsemble_threads);
+	tcase_add_test(tc_StochasticSolver_simulate, test_StochasticSolver_simulateEnsemble_stop);
+	suite_add_tcase(s, tc_StochasticSolver_simulate);
+
+	tc_StochasticSolver_create = tcase_create("StochasticSolver_create");
+	tcase_add_checked_fixture(tc_StochasticSolver_create,
+							  setup_stochasticSolver,
+							  teardown_stochasticSolver);
+	tcase_add_test(tc_StochasticSolver_create, test_StochasticSolver_create_events);
+	suite_add_tcase(s, tc_StochasticSolver_create);
+
+	return s;
+}
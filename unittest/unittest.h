@@ -51,23 +51,35 @@
 	} while (0)
 
 Suite *create_suite_ASTIndexNameNode(void);
+Suite *create_suite_batchProcesses(void);
+Suite *create_suite_batchStream(void);
+Suite *create_suite_blockDecomposition(void);
 Suite *create_suite_charBuffer(void);
+Suite *create_suite_continuation(void);
 Suite *create_suite_cvodeData(void);
 Suite *create_suite_cvodeSolver(void);
 Suite *create_suite_daeSolver(void);
+Suite *create_suite_ensembleSolver(void);
+Suite *create_suite_eventQueue(void);
+Suite *create_suite_globalSensitivity(void);
 Suite *create_suite_integratorInstance(void);
 Suite *create_suite_integratorSettings(void);
+Suite *create_suite_integratorSnapshot(void);
 Suite *create_suite_interpol(void);
 Suite *create_suite_modelSimplify(void);
+Suite *create_suite_multipleShooting(void);
 Suite *create_suite_nullSolver(void);
 Suite *create_suite_odeConstruct(void);
 Suite *create_suite_odeModel(void);
+Suite *create_suite_odePartition(void);
 Suite *create_suite_odeSolver(void);
+Suite *create_suite_parameterEstimation(void);
 Suite *create_suite_processAST(void);
 Suite *create_suite_sbml(void);
 Suite *create_suite_sbmlResults(void);
 Suite *create_suite_sensSolver(void);
 Suite *create_suite_solverError(void);
+Suite *create_suite_stochasticSolver(void);
 Suite *create_suite_util(void);
 
 #endif